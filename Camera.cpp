@@ -51,6 +51,22 @@ void CCamera::UpdateMatrices()
 }
 
 
+// Get the world space ray from the camera through a point on the viewport, given in pixels from the top-left
+void CCamera::GetPickRay( float x, float y, D3DXVECTOR3* origin, D3DXVECTOR3* direction )
+{
+	// Convert the point to -1 to 1 across the viewport (y up), then undo the projection's scaling of x and y to get the direction in camera
+	// space at a depth of 1. Uses the projection matrix itself so the ray matches what was rendered, whatever aspect ratio it was built with
+	float viewX = (2.0f * x / g_ViewportWidth - 1.0f) / m_ProjMatrix._11;
+	float viewY = (1.0f - 2.0f * y / g_ViewportHeight) / m_ProjMatrix._22;
+	D3DXVECTOR3 viewDirection( viewX, viewY, 1.0f );
+
+	// The camera's world matrix takes camera space into the world
+	*origin = D3DXVECTOR3( m_WorldMatrix._41, m_WorldMatrix._42, m_WorldMatrix._43 );
+	D3DXVec3TransformNormal( direction, &viewDirection, &m_WorldMatrix );
+	D3DXVec3Normalize( direction, direction );
+}
+
+
 // Control the camera's position and rotation using keys provided. Amount of motion performed depends on frame time
 void CCamera::Control( float frameTime, EKeyCode turnUp, EKeyCode turnDown, EKeyCode turnLeft, EKeyCode turnRight,  
                        EKeyCode moveForward, EKeyCode moveBackward, EKeyCode moveLeft, EKeyCode moveRight)
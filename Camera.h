@@ -115,6 +115,11 @@ public:
 	// Update the matrices used for the camera in the rendering pipeline
 	void UpdateMatrices();
 
+	// Get the world space ray from the camera through a point on the viewport, given in pixels from the top-left (e.g. the mouse position).
+	// The ray starts at the camera position and its direction is normalised, so distances along it are world units. Uses the matrices as
+	// of the last UpdateMatrices
+	void GetPickRay( float x, float y, D3DXVECTOR3* origin, D3DXVECTOR3* direction );
+
 	// Control the camera's position and rotation using keys provided
 	void Control( float frameTime, EKeyCode turnUp, EKeyCode turnDown, EKeyCode turnLeft, EKeyCode turnRight,  
 	              EKeyCode moveForward, EKeyCode moveBackward, EKeyCode moveLeft, EKeyCode moveRight);
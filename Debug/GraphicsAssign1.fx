@@ -20,6 +20,13 @@ struct LIGHTS_INPUT
 	float2 UV     : TEXCOORD0;
 };
 
+// Vertex positions alone, for techniques that need nothing else (e.g. a single colour or depth only). Models render these techniques from
+// a separate buffer of positions, which is much smaller than the full vertices
+struct VS_POSITION_INPUT
+{
+    float3 Pos : POSITION;
+};
+
 // Data output from vertex shader to pixel shader for simple techniques. Again different techniques have different requirements
 struct VS_BASIC_OUTPUT
 {
@@ -32,7 +39,17 @@ struct VS_NORMALMAP_INPUT
     float3 Pos : POSITION;
     float3 Normal : NORMAL;
     float2 UV : TEXCOORD0;
-    float3 Tangent : TANGENT;
+    float4 Tangent : TANGENT; // Handedness of the texture space in w
+};
+
+// Normal mapping input in the compact vertex format (see VertexFormat.h in the import code). Position is scaled and biased to fit the
+// mesh bounds into -1 to 1, with the handedness of the texture space in w. Normal and tangent use the octahedral encoding
+struct VS_COMPACT_NORMALMAP_INPUT
+{
+    float4 Pos : POSITION;
+    float2 Normal : NORMAL;
+    float2 UV : TEXCOORD0;
+    float2 Tangent : TANGENT;
 };
 
 struct VS_LIGHTING_OUTPUT
@@ -54,7 +71,7 @@ struct VS_NORMALMAP_OUTPUT
     float4 ProjPos : SV_POSITION;
     float3 WorldPos : POSITION;
     float3 ModelNormal : NORMAL;
-    float3 ModelTangent : TANGENT;
+    float4 ModelTangent : TANGENT;
     float2 UV : TEXCOORD0;
 };
 
@@ -76,6 +93,10 @@ float4x4 ViewMatrix;
 float4x4 ProjMatrix;
 float4x4 ViewProjMatrix;
 
+// Scale and bias to decode the vertex positions of models using the compact vertex format: position = encoded * scale + bias
+float3 PositionScale;
+float3 PositionBias;
+
 // A single colour for an entire model - used for light models and the intial basic shader
 float3 ModelColour;
 int NumberOfSpotLights;
@@ -113,9 +134,6 @@ Texture2D NormalMap;
 float ParallaxDepth;
 
 
-
-float OutlineThickness;
-
 // Sampler to use with the diffuse/normal maps. Specifies texture filtering and addressing mode to use when accessing texture pixels
 SamplerState TrilinearWrap
 {
@@ -155,6 +173,22 @@ VS_BASIC_OUTPUT BasicTransform(LIGHTS_INPUT vIn )
 }
 
 
+// Transform vertex positions alone, for techniques that don't need the other vertex data. The UVs are not used, so are set to 0. Takes
+// decoded positions, position buffers are read with PositionTransformCompact
+VS_BASIC_OUTPUT PositionTransform(VS_POSITION_INPUT vIn)
+{
+	VS_BASIC_OUTPUT vOut;
+
+	float4 modelPos = float4(vIn.Pos, 1.0f);
+	float4 worldPos = mul( modelPos, WorldMatrix );
+	float4 viewPos  = mul( worldPos, ViewMatrix );
+	vOut.ProjPos    = mul( viewPos,  ProjMatrix );
+	vOut.UV = float2(0.0f, 0.0f);
+
+	return vOut;
+}
+
+
 float4 DiffuseTextured(VS_BASIC_OUTPUT vOut) : SV_Target
 {
     return DiffuseMap.Sample(TrilinearWrap, vOut.UV); //Return the texture colour of this pixel
@@ -183,6 +217,29 @@ VS_NORMALMAP_OUTPUT NormalMapTransform(VS_NORMALMAP_INPUT vIn)
 
     return vOut;
 }
+
+// Decode a unit vector from the octahedral encoding - the inverse of the encoding in VertexFormat.cpp
+float3 OctDecode(float2 oct)
+{
+    float3 v = float3(oct, 1.0f - abs(oct.x) - abs(oct.y));
+    if (v.z < 0.0f)
+    {
+        v.xy = (1.0f - abs(v.yx)) * (v.xy >= 0.0f ? 1.0f : -1.0f);
+    }
+    return normalize(v);
+}
+
+// Normal mapping for models in the compact vertex format. Decodes the vertex then continues as the standard normal mapping shader
+VS_NORMALMAP_OUTPUT NormalMapTransformCompact(VS_COMPACT_NORMALMAP_INPUT vIn)
+{
+    VS_NORMALMAP_INPUT decoded;
+    decoded.Pos = vIn.Pos.xyz * PositionScale + PositionBias;
+    decoded.Normal = OctDecode(vIn.Normal);
+    decoded.UV = vIn.UV;
+    decoded.Tangent = float4(OctDecode(vIn.Tangent), vIn.Pos.w);
+    return NormalMapTransform(decoded);
+}
+
 VS_LIGHTING_OUTPUT VertexLightingTex(LIGHTS_INPUT vIn)
 {
     VS_LIGHTING_OUTPUT vOut;
@@ -206,32 +263,13 @@ VS_LIGHTING_OUTPUT VertexLightingTex(LIGHTS_INPUT vIn)
 
     return vOut;
 }
-VS_BASIC_OUTPUT ExpandOutline(LIGHTS_INPUT vIn)
-{
-    VS_BASIC_OUTPUT vOut;
-
-	// Transform model-space vertex position to world-space
-    float4 modelPos = float4(vIn.Pos, 1.0f); // Promote to 1x4 so we can multiply by 4x4 matrix, put 1.0 in 4th element for a point (0.0 for a vector)
-    float4 worldPos = mul(modelPos, WorldMatrix);
 
-	// Next the usual transform from world space to camera space - but we don't go any further here - this will be used to help expand the outline
-	// The result "viewPos" is the xyz position of the vertex as seen from the camera. The z component is the distance from the camera - that's useful...
-    float4 viewPos = mul(worldPos, ViewMatrix);
-
-	// Transform model normal to world space, using the normal to expand the geometry, not for lighting
-    float4 modelNormal = float4(vIn.Normal, 0.0f); // Set 4th element to 0.0 this time as normals are vectors
-    float4 worldNormal = normalize(mul(modelNormal, WorldMatrix)); // Normalise in case of world matrix scaling
-
-	// Now we return to the world position of this vertex and expand it along the world normal - that will expand the geometry outwards.
-	// Use the distance from the camera to decide how much to expand. Use this distance together with a sqrt to creates an outline that
-	// gets thinner in the distance, but always remains clear. Overall thickness is also controlled by the constant "OutlineThickness"
-    worldPos += OutlineThickness * sqrt(viewPos.z) * worldNormal;
-
-    // Transform new expanded world-space vertex position to viewport-space and output
-    viewPos = mul(worldPos, ViewMatrix);
-    vOut.ProjPos = mul(viewPos, ProjMatrix);
-	
-    return vOut;
+// Transform the positions in a model's position buffer alone, decoded with the model's position scale and bias (identity for full float
+// models). Used by every technique that only reads positions
+VS_BASIC_OUTPUT PositionTransformCompact(VS_POSITION_INPUT vIn)
+{
+    vIn.Pos = vIn.Pos * PositionScale + PositionBias;
+    return PositionTransform(vIn);
 }
 
 
@@ -249,6 +287,11 @@ RasterizerState CullBack  // Cull back side of polygon - normal behaviour, only
 {
     CullMode = Back;
 };
+RasterizerState OutlineLines  // Lines drawn along edges of a model - pulled slightly towards the camera so they aren't hidden by the model's own faces
+{
+    CullMode = None;
+    DepthBias = -1000;
+};
 
 
 DepthStencilState DepthWritesOff // Don't write to the depth buffer - polygons rendered will not obscure other polygons
@@ -432,10 +475,11 @@ float4 NormalMapLighting(VS_NORMALMAP_OUTPUT vOut) : SV_Target
 
 	// Renormalise pixel normal/tangent that were *interpolated* from the vertex normals/tangents (and may have been scaled too)
     float3 modelNormal = normalize(vOut.ModelNormal);
-    float3 modelTangent = normalize(vOut.ModelTangent);
+    float3 modelTangent = normalize(vOut.ModelTangent.xyz);
 
-	// Calculate bi-tangent to complete the three axes of tangent space. Then create the *inverse* tangent matrix to convert *from* tangent space into model space
-    float3 modelBiTangent = cross(modelNormal, modelTangent);
+	// Calculate bi-tangent to complete the three axes of tangent space, flipped where the texture is mirrored. Then create the *inverse* tangent matrix to
+	// convert *from* tangent space into model space
+    float3 modelBiTangent = cross(modelNormal, modelTangent) * (vOut.ModelTangent.w < 0.0f ? -1.0f : 1.0f);
     float3x3 invTangentMatrix = float3x3(modelTangent, modelBiTangent, modelNormal);
 
 	//****| INFO |**********************************************************************************//
@@ -586,12 +630,12 @@ float4 CellPS(VS_LIGHTING_OUTPUT vOut) : SV_Target // The ": SV_Target" bit just
 
 // Techniques are used to render models in our scene. They select a combination of vertex, geometry and pixel shader from those provided above. Can also set states.
 
-// Render models unlit in a single colour
-technique10 PlainColour
+// Render models unlit in a single colour. Only reads vertex positions, the annotation tells the C++ to bind the models' position buffers
+technique10 PlainColour < bool PositionOnly = true; >
 {
     pass P0
     {
-        SetVertexShader(CompileShader(vs_4_0, BasicTransform()));
+        SetVertexShader(CompileShader(vs_4_0, PositionTransformCompact()));
         SetGeometryShader(NULL);
         SetPixelShader(CompileShader(ps_4_0, OneColour()));
 
@@ -629,6 +673,22 @@ technique10 ParallaxMapping
     }
 }
 
+// Parallax mapping for models in the compact vertex format
+technique10 ParallaxMappingCompact
+{
+    pass P0
+    {
+        SetVertexShader(CompileShader(vs_4_0, NormalMapTransformCompact()));
+        SetGeometryShader(NULL);
+        SetPixelShader(CompileShader(ps_4_0, NormalMapLighting()));
+
+		// Switch off blending states
+        SetBlendState(NoBlending, float4(0.0f, 0.0f, 0.0f, 0.0f), 0xFFFFFFFF);
+        SetRasterizerState(CullBack);
+        SetDepthStencilState(DepthWritesOn, 0);
+    }
+}
+
 technique10 DiffuseTex
 {
     pass P0
@@ -643,4 +703,17 @@ technique10 DiffuseTex
     }
 }
 
+// Silhouette edges of a model drawn as lines in a single colour, to outline it (see CModel::RenderSilhouette). Only reads vertex positions
+technique10 Outline < bool PositionOnly = true; >
+{
+    pass P0
+    {
+        SetVertexShader(CompileShader(vs_4_0, PositionTransformCompact()));
+        SetGeometryShader(NULL);
+        SetPixelShader(CompileShader(ps_4_0, OneColour()));
 
+        SetBlendState(NoBlending, float4(0.0f, 0.0f, 0.0f, 0.0f), 0xFFFFFFFF);
+        SetRasterizerState(OutlineLines);
+        SetDepthStencilState(DepthWritesOn, 0);
+    }
+}
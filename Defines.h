@@ -46,5 +46,8 @@ extern ID3D10Device* g_pd3dDevice;
 // Dimensions of viewport - shared between setup code and camera class (which needs this to create the projection matrix - see code there)
 extern int g_ViewportWidth, g_ViewportHeight;
 
+// Mouse position in pixels from the top-left of the viewport - updated by the window procedure, used to pick models under the mouse
+extern unsigned int g_MouseX, g_MouseY;
+
 
 #endif // End of header guard - see top of file
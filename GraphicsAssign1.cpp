@@ -36,6 +36,11 @@
 #include "Light.h"
 #include "Camera.h"  // Camera class - encapsulates the camera's view and projection matrix
 #include "Input.h"   // Input functions - not DirectX
+#include "ModelLoadBatch.h" // Loads model files in parallel on worker threads
+#include "CImportStats.h"   // Timings and counts for each stage of loading a mesh
+#include "StaticBatch.h"    // Merges models that never move into a few large vertex/index buffers
+#include "ModelPicker.h"    // Finds the model under the mouse and tests lines of sight
+#include "CTimer.h"         // Timer class - not DirectX
 
 #define NUM_OF_POINT_LIGHTS 4
 #define NUM_OF_SPOT_LIGTHS 3
@@ -52,11 +57,47 @@ CModel* Floor;
 CModel* Sphere;
 CModel* TeaPot;
 CCamera* Camera;
+gen::CThreadPool* WorkerThreads = NULL; // Worker threads kept for the whole run, used to load the models and find their silhouettes
 CModel* Troll;
 Light* SpotLights[3];
 CModel* Models[6];
 Light* PointLights[2];
 
+// A generated yard of props, enough small models to show the cost of a draw call for each. Each prop file has its own texture. Only part
+// of the scene when benchmarking the static batch, the demo scene doesn't need it
+bool BenchmarkPropYard = false;
+const int NUM_PROPS = 400;
+const int NUM_PROP_TYPES = 5;
+const char* PropFiles[NUM_PROP_TYPES] = { "CardboardBox.x", "PlasticDrum.x", "TrafficCone.x", "WoodPallet.x", "SpareTyre.x" };
+const wchar_t* PropTextureFiles[NUM_PROP_TYPES] = { L"BoxA.dds", L"PlasDrmA.dds", L"ConeA.dds", L"PalletA.dds", L"TyreB.dds" };
+CModel* Props[NUM_PROPS];
+
+// Save the time taken by each stage of loading the meshes to ImportStats.json, and append a line for the run to ImportStats.csv to track
+// changes. Off for the demo, MeshBench reports the import times of the model files without running the app
+bool SaveImportStats = false;
+
+// Models that never move are merged into the static batch, rendered with a draw call for each technique and texture set. Key 2 switches
+// between the batch and rendering each static model separately, to compare the time taken to submit them
+CStaticBatch* StaticModels = NULL;
+bool UseStaticBatch = true;
+
+// All the models that can be picked with the mouse. Clicking outlines the model under the mouse, in a colour showing whether the point
+// hit can see the second light. Clicking on nothing clears the outline
+CModelPicker* Picker = NULL;
+CModel* PickedModel = NULL;
+D3DXVECTOR3 PickedColour;
+const D3DXVECTOR3 PickLitColour = D3DXVECTOR3(1, 1, 0);    // Yellow outline if the point picked can see the second light
+const D3DXVECTOR3 PickHiddenColour = D3DXVECTOR3(1, 0, 0); // Red outline if it is hidden from the light
+
+// Frames rendered over the whole run, to average the per-frame statistics
+unsigned int FrameCount = 0;
+
+// Time taken to submit the static models, the frames rendered and the draw calls made - [0] rendering each model, [1] using the batch
+CTimer StaticSubmitTimer;
+float StaticSubmitTime[2] = { 0.0f, 0.0f };
+unsigned int StaticSubmitFrames[2] = { 0, 0 };
+unsigned int StaticSubmitDraws[2] = { 0, 0 };
+
 // Textures - no texture class yet so using DirectX variables
 ID3D10ShaderResourceView* CubeDiffuseMap = NULL;
 ID3D10ShaderResourceView* CubeNormalMap = NULL;
@@ -67,12 +108,17 @@ ID3D10ShaderResourceView* TeapotDiffuseMap = NULL;
 ID3D10ShaderResourceView* TeapotNormalMap = NULL;
 ID3D10ShaderResourceView* TrollDiffuseMap = NULL;
 ID3D10ShaderResourceView* CellMap = NULL;
+ID3D10ShaderResourceView* PropDiffuseMaps[NUM_PROP_TYPES] = { NULL };
 
 
 
-// Cell shading data
+// Outlines - the silhouette edges of the cube and teapot drawn as lines (see CModel::RenderSilhouette)
 D3DXVECTOR3 OutlineColour = D3DXVECTOR3(0, 0, 0); // Black outlines
-float       OutlineThickness = 0.015f;
+bool UseOutlines = true; // Toggle for outlines
+
+// Cluster culling - the faces of each model are drawn in clusters, and those outside the view or facing away from the camera are culled on the
+// CPU each frame (see CModel::CullClusters). Key 4 toggles it to compare the triangles drawn
+bool UseClusterCulling = true;
 
 
 float ParallaxDepth = 0.08f; // Overall depth of bumpiness for parallax mapping
@@ -103,7 +149,9 @@ ID3D10Effect*          Effect = NULL;
 ID3D10EffectTechnique* PlainColourTechnique = NULL;
 ID3D10EffectTechnique* DiffuseTextureTechnique = NULL;
 ID3D10EffectTechnique* ParallaxMappingTechnique = NULL;
+ID3D10EffectTechnique* ParallaxMappingCompactTechnique = NULL; // Same as above for models using the compact vertex format
 ID3D10EffectTechnique* VertexLitDiffuseTechnique = NULL;
+ID3D10EffectTechnique* OutlineTechnique = NULL;
 ID3D10EffectTechnique* test = NULL;
 
 // Matrices
@@ -141,6 +189,10 @@ ID3D10EffectVectorVariable* TintColourVar = NULL;
 // Miscellaneous
 ID3D10EffectVectorVariable* ModelColourVar = NULL;
 
+// Decoding of vertex positions for models using the compact vertex format
+ID3D10EffectVectorVariable* PositionScaleVar = NULL;
+ID3D10EffectVectorVariable* PositionBiasVar = NULL;
+
 
 //--------------------------------------------------------------------------------------
 // DirectX Variables
@@ -259,6 +311,39 @@ void ReleaseResources()
 	// There is similar code in every D3D program, but the list of objects that need to be released depends on what was created
 	// Test each variable to see if it exists before deletion
 	if( g_pd3dDevice )     g_pd3dDevice->ClearState();
+
+	// Report how many triangles the levels of detail saved over the whole run
+	CModel::OutputLODStats();
+
+	// Report how many binds sharing one set of buffers between the sub-meshes of each model saved
+	CModel::OutputDrawStats();
+
+	// Report the vertex data bound each frame, and how much the position buffers saved
+	CModel::OutputVertexStreamStats( FrameCount );
+
+	// Report the vertices processed drawing the outlines as silhouette lines, compared to expanded copies of the models
+	CModel::OutputOutlineStats();
+
+	// Report the clusters and triangles culled each frame
+	CModel::OutputClusterStats( FrameCount );
+
+	// Report the draw calls and submit time of the static models with and without the static batch
+	for (int batched = 0; batched < 2; ++batched)
+	{
+		if (StaticSubmitFrames[batched] > 0)
+		{
+			char text[256];
+			sprintf_s( text, "Static models %s: %u frames, %.1f draws per frame, %.3fms submit per frame\n", batched ? "batched" : "separate",
+			           StaticSubmitFrames[batched], (float)StaticSubmitDraws[batched] / StaticSubmitFrames[batched],
+			           StaticSubmitTime[batched] * 1000.0f / StaticSubmitFrames[batched] );
+			OutputDebugStringA( text );
+		}
+	}
+
+	delete Picker;
+	delete StaticModels;
+	for (int i = 0; i < NUM_PROPS; ++i) delete Props[i];
+
 	for (int i = 0; i < NUM_OF_SPOT_LIGTHS; ++i) delete SpotLights[i];
 	delete Light2;
 	delete Light1;
@@ -267,6 +352,7 @@ void ReleaseResources()
 	delete Floor;
 	delete Cube;
 	delete Camera;
+	delete WorkerThreads;
 	delete Sphere;
 	delete TeaPot;
 
@@ -276,6 +362,7 @@ void ReleaseResources()
 	if (CubeDiffuseMap)   CubeDiffuseMap->Release();
 	if (TeapotNormalMap)  TeapotNormalMap->Release();
 	if (TeapotDiffuseMap) TeapotDiffuseMap->Release();
+	for (int i = 0; i < NUM_PROP_TYPES; ++i) SAFE_RELEASE( PropDiffuseMaps[i] );
 	if( Effect )           Effect->Release();
 	if( DepthStencilView ) DepthStencilView->Release();
 	if( RenderTargetView ) RenderTargetView->Release();
@@ -312,8 +399,13 @@ bool LoadEffectFile()
 	PlainColourTechnique = Effect->GetTechniqueByName( "PlainColour" );
 	DiffuseTextureTechnique =Effect->GetTechniqueByName("DiffuseTex");
 	ParallaxMappingTechnique = Effect->GetTechniqueByName("ParallaxMapping");
+	ParallaxMappingCompactTechnique = Effect->GetTechniqueByName("ParallaxMappingCompact");
 	VertexLitDiffuseTechnique = Effect->GetTechniqueByName("VertexLitTex");
+	OutlineTechnique = Effect->GetTechniqueByName("Outline");
 	test = Effect->GetTechniqueByName("PixelShaderFunctionWithTex");
+
+	// Techniques that only read vertex positions render models from their position buffers, which must be known before the models are loaded
+	CModel::AddPositionOnlyTechniques( Effect );
 	// Create special variables to allow us to access global variables in the shaders from C++
 	WorldMatrixVar    = Effect->GetVariableByName( "WorldMatrix" )->AsMatrix();
 	ViewMatrixVar     = Effect->GetVariableByName( "ViewMatrix"  )->AsMatrix();
@@ -351,6 +443,8 @@ bool LoadEffectFile()
 	ModelColourVar = Effect->GetVariableByName( "ModelColour"  )->AsVector();
 	ParallaxDepthVar = Effect->GetVariableByName("ParallaxDepth")->AsScalar();
 	TintColourVar = Effect->GetVariableByName("TintColour")->AsVector();
+	PositionScaleVar = Effect->GetVariableByName("PositionScale")->AsVector();
+	PositionBiasVar = Effect->GetVariableByName("PositionBias")->AsVector();
 
 	return true;
 }
@@ -388,19 +482,35 @@ bool InitScene()
 
 	PointLights[0] = new Light;
 
+	if (BenchmarkPropYard)
+	{
+		for (int i = 0; i < NUM_PROPS; ++i) Props[i] = new CModel;
+	}
+
 
 	// The model class can load ".X" files. It encapsulates (i.e. hides away from this code) the file loading/parsing and creation of vertex/index buffers
 	// We must pass an example technique used for each model. We can then only render models with techniques that uses matching vertex input data
-	if (!Cube->Load("Cube.x", ParallaxMappingTechnique, true)) return false;
-	if (!Floor->Load("Floor.x", VertexLitDiffuseTechnique)) return false;
-	if (!TeaPot->Load("Teapot.x", ParallaxMappingTechnique, true)) return false;
-	if (!Sphere->Load("Sphere.x", VertexLitDiffuseTechnique)) return false;
-	if (!Light1->Load( "Sphere.x", PlainColourTechnique )) return false;
-	if (!Light2->Load( "Sphere.x", PlainColourTechnique )) return false;
-	if (!SpotLights[0]->Load("Sphere.x", PlainColourTechnique)) return false;
-	if (!SpotLights[1]->Load("Sphere.x", PlainColourTechnique)) return false;
-	if (!SpotLights[2]->Load("Sphere.x", PlainColourTechnique)) return false;
-	if (!PointLights[0]->Load("Sphere.x", PlainColourTechnique)) return false;
+	// The files are loaded in parallel on worker threads while the rest of the scene is set up, the models get their geometry when the batch is finished
+	WorkerThreads = new gen::CThreadPool;
+	CModelLoadBatch modelLoads( WorkerThreads );
+	// The parallax mapped models use the compact vertex format - 20 bytes per vertex rather than 48, see VertexFormat.h
+	Cube->LoadAsync(modelLoads, "Cube.x", ParallaxMappingCompactTechnique, true, &gen::kVertexFormatCompact);
+	Floor->LoadAsync(modelLoads, "Floor.x", VertexLitDiffuseTechnique);
+	TeaPot->LoadAsync(modelLoads, "Teapot.x", ParallaxMappingCompactTechnique, true, &gen::kVertexFormatCompact);
+	Sphere->LoadAsync(modelLoads, "Sphere.x", VertexLitDiffuseTechnique);
+	Light1->LoadAsync(modelLoads, "Sphere.x", PlainColourTechnique);
+	Light2->LoadAsync(modelLoads, "Sphere.x", PlainColourTechnique);
+	SpotLights[0]->LoadAsync(modelLoads, "Sphere.x", PlainColourTechnique);
+	SpotLights[1]->LoadAsync(modelLoads, "Sphere.x", PlainColourTechnique);
+	SpotLights[2]->LoadAsync(modelLoads, "Sphere.x", PlainColourTechnique);
+	PointLights[0]->LoadAsync(modelLoads, "Sphere.x", PlainColourTechnique);
+	if (BenchmarkPropYard)
+	{
+		for (int i = 0; i < NUM_PROPS; ++i)
+		{
+			Props[i]->LoadAsync(modelLoads, PropFiles[i % NUM_PROP_TYPES], VertexLitDiffuseTechnique);
+		}
+	}
 
 	
 	D3DXVECTOR3 Light1Colour = D3DXVECTOR3(1.0f, 0.0f, 0.7f) * 15;
@@ -440,6 +550,104 @@ bool InitScene()
 	if (FAILED(D3DX10CreateShaderResourceViewFromFile(g_pd3dDevice, L"CobbleNormalDepth.dds", NULL, NULL, &FloorNormalMap, NULL))) return false;
 	if (FAILED(D3DX10CreateShaderResourceViewFromFile(g_pd3dDevice, L"StoneDiffuseSpecular.dds", NULL, NULL, &SphereDiffuseMap, NULL))) return false;
 	//if (FAILED(D3DX10CreateShaderResourceViewFromFile(g_pd3dDevice, L"flare.jpg", NULL, NULL, &LightDiffuseMap, NULL))) return false;
+	if (BenchmarkPropYard)
+	{
+		for (int i = 0; i < NUM_PROP_TYPES; ++i)
+		{
+			if (FAILED(D3DX10CreateShaderResourceViewFromFile(g_pd3dDevice, PropTextureFiles[i], NULL, NULL, &PropDiffuseMaps[i], NULL))) return false;
+		}
+	}
+
+	// Wait for the model files to finish loading and create their vertex/index buffers
+	if (!modelLoads.Finish()) return false;
+
+	// Models loaded from the same file share geometry, report how much loading that saved
+	CMeshRegistry::OutputStats();
+
+	// Save the time taken by each stage of loading the meshes, the CSV file collects a line for each run to track changes
+	if (SaveImportStats)
+	{
+		CMeshRegistry::GetImportStats().SaveJSONFile( "ImportStats.json" );
+		CMeshRegistry::GetImportStats().AppendCSVFile( "ImportStats.csv", "GraphicsAssign1" );
+	}
+
+
+	//////////////////
+	// Static batch
+
+	// Lay the props out in a grid beside the main scene, standing on the floor (their bounds are known now they are loaded), with a
+	// scattering of rotations
+	if (BenchmarkPropYard)
+	{
+		const int PropsPerRow = 20;
+		const float PropSpacing = 8.0f;
+		const float PropScale = 4.0f;
+		for (int i = 0; i < NUM_PROPS; ++i)
+		{
+			float baseHeight = Props[i]->GetGeometry()->Bounds.minBounds.y;
+			Props[i]->SetPosition( D3DXVECTOR3(-200.0f + (i % PropsPerRow) * PropSpacing, -baseHeight * PropScale, 40.0f + (i / PropsPerRow) * PropSpacing) );
+			Props[i]->SetRotation( D3DXVECTOR3(0.0f, ToRadians( (float)((i * 137) % 360) ), 0.0f) );
+			Props[i]->SetScale( PropScale );
+		}
+	}
+
+	// Mark the models that never move as static, and merge them into the static batch with the technique and textures they are rendered with.
+	// The batch draws its models at full detail, so the teapot and sphere are left out to keep their levels of detail and cluster culling
+	CModel* staticModels[] = { Floor, SpotLights[0], SpotLights[1], SpotLights[2], PointLights[0] };
+	for (unsigned int i = 0; i < sizeof(staticModels) / sizeof(staticModels[0]); ++i)
+	{
+		staticModels[i]->SetStatic( true );
+		staticModels[i]->UpdateMatrix();
+	}
+	if (BenchmarkPropYard)
+	{
+		for (int i = 0; i < NUM_PROPS; ++i)
+		{
+			Props[i]->SetStatic( true );
+			Props[i]->UpdateMatrix();
+		}
+	}
+	D3DXVECTOR3 Black( 0.0f, 0.0f, 0.0f );
+	D3DXVECTOR3 Blue( 0.0f, 0.0f, 1.0f );
+	StaticModels = new CStaticBatch( WorldMatrixVar, DiffuseMapVar, NormalMapVar, ModelColourVar, PositionScaleVar, PositionBiasVar );
+	StaticModels->Add( Floor, VertexLitDiffuseTechnique, FloorDiffuseMap, NULL, Black );
+	StaticModels->Add( SpotLights[0], PlainColourTechnique, NULL, NULL, Blue );
+	StaticModels->Add( SpotLights[1], PlainColourTechnique, NULL, NULL, Blue );
+	StaticModels->Add( SpotLights[2], PlainColourTechnique, NULL, NULL, Black );
+	StaticModels->Add( PointLights[0], VertexLitDiffuseTechnique, SphereDiffuseMap, NULL, Blue );
+	if (BenchmarkPropYard)
+	{
+		for (int i = 0; i < NUM_PROPS; ++i)
+		{
+			StaticModels->Add( Props[i], VertexLitDiffuseTechnique, PropDiffuseMaps[i % NUM_PROP_TYPES] );
+		}
+	}
+	if (!StaticModels->Build()) return false;
+
+	char text[256];
+	sprintf_s( text, "Static batch: %u models in %u groups, %u draw calls rather than %u\n", StaticModels->GetNumModels(),
+	           StaticModels->GetNumGroups(), StaticModels->GetNumDraws(), StaticModels->GetNumDrawsUnbatched() );
+	OutputDebugStringA( text );
+	StaticSubmitTimer.Start();
+
+
+	//////////////////
+	// Picking
+
+	// Every model can be picked, the hierarchy over them is rebuilt for each pick as some of them move
+	Picker = new CModelPicker;
+	CModel* pickModels[] = { Floor, Cube, Sphere, TeaPot, Light1, Light2, SpotLights[0], SpotLights[1], SpotLights[2], PointLights[0] };
+	for (unsigned int i = 0; i < sizeof(pickModels) / sizeof(pickModels[0]); ++i)
+	{
+		Picker->Add( pickModels[i] );
+	}
+	if (BenchmarkPropYard)
+	{
+		for (int i = 0; i < NUM_PROPS; ++i)
+		{
+			Picker->Add( Props[i] );
+		}
+	}
 
 	return true;
 }
@@ -472,10 +680,100 @@ void UpdateScene( float frameTime )
 //	SpotLight->UpdateMatrix();
 	// Second light doesn't move, but do need to make sure its matrix has been calculated - could do this in InitScene instead
 	Light2->UpdateMatrix();
+
+	// Choose the level of detail of each model from its size on screen, now the model and camera matrices are up to date, and cull the clusters
+	// of the models' faces that can't be seen. The static batch draws its models at full detail, so they are skipped while it is in use
+	CModel* lodModels[] = { Floor, Cube, Sphere, TeaPot, SpotLights[0], SpotLights[1], SpotLights[2], PointLights[0] };
+	for (unsigned int i = 0; i < sizeof(lodModels) / sizeof(lodModels[0]); ++i)
+	{
+		if (UseStaticBatch && lodModels[i]->IsStatic()) continue;
+		lodModels[i]->SelectLOD( Camera, (float)g_ViewportHeight );
+		lodModels[i]->CullClusters( UseClusterCulling ? Camera : NULL );
+	}
 	if (KeyHit(Key_1))
 	{
 		UseParallax = !UseParallax;
 	}
+	if (KeyHit(Key_2))
+	{
+		UseStaticBatch = !UseStaticBatch;
+	}
+	if (KeyHit(Key_3))
+	{
+		UseOutlines = !UseOutlines;
+	}
+	if (KeyHit(Key_4))
+	{
+		UseClusterCulling = !UseClusterCulling;
+	}
+
+	// Pick the model under the mouse to outline it, and test whether the point hit can see the second light (starting just off the surface
+	// so the model hit doesn't block its own line of sight)
+	if (KeyHit(Mouse_LButton))
+	{
+		Picker->Build();
+		D3DXVECTOR3 rayOrigin, rayDirection;
+		Camera->GetPickRay( (float)g_MouseX, (float)g_MouseY, &rayOrigin, &rayDirection );
+		SModelPick pick;
+		PickedModel = NULL;
+		if (Picker->Pick( rayOrigin, rayDirection, Camera->GetFarClip(), &pick ))
+		{
+			D3DXVECTOR3 toLight = Light2->GetPosition() - pick.Position;
+			bool lit = Picker->IsLineOfSight( pick.Position + toLight * 0.001f, Light2->GetPosition(), NULL, Light2 );
+			PickedModel = pick.Model;
+			PickedColour = lit ? PickLitColour : PickHiddenColour;
+		}
+	}
+}
+
+
+// Render each static model separately, setting its own shader variables - the static batch renders the same models with far fewer draw calls
+void RenderStaticModels()
+{
+	// Constant colours used for models in initial shaders
+	D3DXVECTOR3 Black( 0.0f, 0.0f, 0.0f );
+	D3DXVECTOR3 Blue( 0.0f, 0.0f, 1.0f );
+
+	// Render floor
+	WorldMatrixVar->SetMatrix( (float*)Floor->GetWorldMatrix() );
+	DiffuseMapVar->SetResource( FloorDiffuseMap );
+	ModelColourVar->SetRawValue( Black, 0, 12 );
+	Floor->Render(VertexLitDiffuseTechnique);
+
+	// Render spot lights - plain colour decodes the positions with each model's position scale and bias
+	WorldMatrixVar->SetMatrix((float*)SpotLights[0]->GetWorldMatrix());
+	ModelColourVar->SetRawValue(Blue, 0, 12);
+	PositionScaleVar->SetRawValue(SpotLights[0]->GetPositionScale(), 0, 12);
+	PositionBiasVar->SetRawValue(SpotLights[0]->GetPositionBias(), 0, 12);
+	SpotLights[0]->Render(PlainColourTechnique);
+
+	WorldMatrixVar->SetMatrix((float*)SpotLights[1]->GetWorldMatrix());
+	ModelColourVar->SetRawValue(Blue, 0, 12);
+	PositionScaleVar->SetRawValue(SpotLights[1]->GetPositionScale(), 0, 12);
+	PositionBiasVar->SetRawValue(SpotLights[1]->GetPositionBias(), 0, 12);
+	SpotLights[1]->Render(PlainColourTechnique);
+
+	WorldMatrixVar->SetMatrix((float*)SpotLights[2]->GetWorldMatrix());
+	ModelColourVar->SetRawValue(Black, 0, 12);
+	PositionScaleVar->SetRawValue(SpotLights[2]->GetPositionScale(), 0, 12);
+	PositionBiasVar->SetRawValue(SpotLights[2]->GetPositionBias(), 0, 12);
+	SpotLights[2]->Render(PlainColourTechnique);
+
+	// Render point light
+	WorldMatrixVar->SetMatrix((float*)PointLights[0]->GetWorldMatrix());
+	DiffuseMapVar->SetResource(SphereDiffuseMap);
+	ModelColourVar->SetRawValue(Blue, 0, 12);
+	PointLights[0]->Render(VertexLitDiffuseTechnique);
+
+	if (BenchmarkPropYard)
+	{
+		for (int i = 0; i < NUM_PROPS; ++i)
+		{
+			WorldMatrixVar->SetMatrix((float*)Props[i]->GetWorldMatrix());
+			DiffuseMapVar->SetResource(PropDiffuseMaps[i % NUM_PROP_TYPES]);
+			Props[i]->Render(VertexLitDiffuseTechnique);
+		}
+	}
 }
 
 
@@ -486,6 +784,7 @@ void RenderScene()
 	float ClearColor[4] = { 0.2f, 0.2f, 0.3f, 1.0f }; // Good idea to match background to ambient colour
 	g_pd3dDevice->ClearRenderTargetView( RenderTargetView, ClearColor );
 	g_pd3dDevice->ClearDepthStencilView( DepthStencilView, D3D10_CLEAR_DEPTH, 1.0f, 0 ); // Clear the depth buffer too
+	++FrameCount;
 
 
 	//---------------------------
@@ -547,75 +846,75 @@ void RenderScene()
 	//---------------------------
 	// Render each model
 	
-	// Constant colours used for models in initial shaders
-	D3DXVECTOR3 Black( 0.0f, 0.0f, 0.0f );
-	D3DXVECTOR3 Blue( 0.0f, 0.0f, 1.0f );
-
 	// Render cube
 	WorldMatrixVar->SetMatrix((float*)Cube->GetWorldMatrix());  // Send the cube's world matrix to the shader
 	DiffuseMapVar->SetResource(CubeDiffuseMap);                 // Send the cube's diffuse/specular map to the shader
 	NormalMapVar->SetResource(CubeNormalMap);                   // Send the cube's normal/depth map to the shader
-	Cube->Render(ParallaxMappingTechnique);                     // Pass rendering technique to the model class
+	PositionScaleVar->SetRawValue(Cube->GetPositionScale(), 0, 12); // Send the decoding of the cube's compact vertex positions to the shader
+	PositionBiasVar->SetRawValue(Cube->GetPositionBias(), 0, 12);
+	Cube->Render(ParallaxMappingCompactTechnique);              // Pass rendering technique to the model class
 
-																// Same for the other models in the scene
+	// Render teapot
 	WorldMatrixVar->SetMatrix((float*)TeaPot->GetWorldMatrix());
 	DiffuseMapVar->SetResource(TeapotDiffuseMap);
 	NormalMapVar->SetResource(TeapotNormalMap);
-	TeaPot->Render(ParallaxMappingTechnique);
-
-//	WorldMatrixVar->SetMatrix((float*)Floor->GetWorldMatrix());
-//	DiffuseMapVar->SetResource(FloorDiffuseMap);
-//	NormalMapVar->SetResource(FloorNormalMap);
-//	Floor->Render(ParallaxMappingTechnique);
-
-																	 // Render SPHERE
-	WorldMatrixVar->SetMatrix((float*)Sphere->GetWorldMatrix());  // Send the cube's world matrix to the shader
-	DiffuseMapVar->SetResource(SphereDiffuseMap);                 // Send the cube's diffuse/specular map to the shader
-	ModelColourVar->SetRawValue(Blue, 0, 12);           // Set a single colour to render the model
-	Sphere->Render(VertexLitDiffuseTechnique);                         // Pass rendering technique to the model class
+	PositionScaleVar->SetRawValue(TeaPot->GetPositionScale(), 0, 12);
+	PositionBiasVar->SetRawValue(TeaPot->GetPositionBias(), 0, 12);
+	TeaPot->Render(ParallaxMappingCompactTechnique);
 
-//	WorldMatrixVar->SetMatrix((float*)TeaPot->GetWorldMatrix());  // Send the cube's world matrix to the shader
-//	DiffuseMapVar->SetResource(CubeDiffuseMap);                 // Send the cube's diffuse/specular map to the shader
-//	ModelColourVar->SetRawValue(Blue, 0, 12);           // Set a single colour to render the model
-//	TeaPot->Render(PlainColourTechnique);                         // Pass rendering technique to the model class
-
-
-	// Same for the other models in the scene
-	WorldMatrixVar->SetMatrix( (float*)Floor->GetWorldMatrix() );
-    DiffuseMapVar->SetResource( FloorDiffuseMap );
-	ModelColourVar->SetRawValue( Black, 0, 12 );
-	Floor->Render(VertexLitDiffuseTechnique);
+	// Render sphere
+	D3DXVECTOR3 Blue( 0.0f, 0.0f, 1.0f );
+	WorldMatrixVar->SetMatrix((float*)Sphere->GetWorldMatrix());
+	DiffuseMapVar->SetResource(SphereDiffuseMap);
+	ModelColourVar->SetRawValue(Blue, 0, 12);
+	Sphere->Render(VertexLitDiffuseTechnique);
 
-//	WorldMatrixVar->SetMatrix( (float*)Light1->GetWorldMatrix() );
-//	ModelColourVar->SetRawValue( Light1->m_diffuse_colour(), 0, 12 );
-//	Light1->Render( PlainColourTechnique );
-//
-//	WorldMatrixVar->SetMatrix( (float*)Light2->GetWorldMatrix() );
-//	ModelColourVar->SetRawValue( Light2->m_diffuse_colour(), 0, 12 );
-//	Light2->Render( PlainColourTechnique );
 
-//	WorldMatrixVar->SetMatrix((float*)SpotLight->GetWorldMatrix());
-//	ModelColourVar->SetRawValue(SpotLight->m_diffuse_colour(), 0, 12);
-//	SpotLight->Render(PlainColourTechnique);
+	// Render the static models, either from the static batch or each model separately, timing how long the CPU takes to submit them
+	unsigned int drawsBefore = CModel::GetNumDrawCalls();
+	StaticSubmitTimer.Reset();
+	if (UseStaticBatch)
+	{
+		StaticModels->Render();
+	}
+	else
+	{
+		RenderStaticModels();
+	}
+	int batched = UseStaticBatch ? 1 : 0;
+	StaticSubmitTime[batched] += StaticSubmitTimer.GetTime();
+	StaticSubmitDraws[batched] += CModel::GetNumDrawCalls() - drawsBefore;
+	++StaticSubmitFrames[batched];
 
-	WorldMatrixVar->SetMatrix((float*)SpotLights[0]->GetWorldMatrix());
-	ModelColourVar->SetRawValue(Blue, 0, 12);
-	SpotLights[0]->Render(PlainColourTechnique);
 
+	// Outline the cube and teapot with their silhouette edges, found on the CPU for the current camera position and drawn as lines over the
+	// models. Only the edges are drawn, rather than an expanded copy of each model behind it
+	if (UseOutlines)
+	{
+		ModelColourVar->SetRawValue( OutlineColour, 0, 12 );
 
-	WorldMatrixVar->SetMatrix((float*)SpotLights[1]->GetWorldMatrix());
-	ModelColourVar->SetRawValue(Blue, 0, 12);
-	SpotLights[1]->Render(PlainColourTechnique);
+		WorldMatrixVar->SetMatrix( (float*)Cube->GetWorldMatrix() );
+		PositionScaleVar->SetRawValue( Cube->GetPositionScale(), 0, 12 );
+		PositionBiasVar->SetRawValue( Cube->GetPositionBias(), 0, 12 );
+		Cube->RenderSilhouette( OutlineTechnique, Camera, WorkerThreads );
 
-	WorldMatrixVar->SetMatrix((float*)SpotLights[2]->GetWorldMatrix());
-	ModelColourVar->SetRawValue(Black, 0, 12);
-	SpotLights[2]->Render(PlainColourTechnique);
+		WorldMatrixVar->SetMatrix( (float*)TeaPot->GetWorldMatrix() );
+		PositionScaleVar->SetRawValue( TeaPot->GetPositionScale(), 0, 12 );
+		PositionBiasVar->SetRawValue( TeaPot->GetPositionBias(), 0, 12 );
+		TeaPot->RenderSilhouette( OutlineTechnique, Camera, WorkerThreads );
+	}
 
+	// Outline the picked model in the same way, in a colour showing whether the point picked can see the second light. Skinned models
+	// have no silhouette edges so are not outlined
+	if (PickedModel)
+	{
+		ModelColourVar->SetRawValue( PickedColour, 0, 12 );
+		WorldMatrixVar->SetMatrix( (float*)PickedModel->GetWorldMatrix() );
+		PositionScaleVar->SetRawValue( PickedModel->GetPositionScale(), 0, 12 );
+		PositionBiasVar->SetRawValue( PickedModel->GetPositionBias(), 0, 12 );
+		PickedModel->RenderSilhouette( OutlineTechnique, Camera, WorkerThreads );
+	}
 
-	WorldMatrixVar->SetMatrix((float*)PointLights[0]->GetWorldMatrix());  // Send the cube's world matrix to the shader
-	DiffuseMapVar->SetResource(SphereDiffuseMap);                 // Send the cube's diffuse/specular map to the shader
-	ModelColourVar->SetRawValue(Blue, 0, 12);           // Set a single colour to render the model
-	PointLights[0]->Render(VertexLitDiffuseTechnique);
 	//---------------------------
 	// Display the Scene
 
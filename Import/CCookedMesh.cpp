@@ -0,0 +1,893 @@
+/**************************************************************************************************
+	Module:       CCookedMesh.cpp
+	Date created: 18/10/26
+
+	Cooked (pre-processed) mesh cache. Stores the final output of an X-file import - the node
+	hierarchy, interleaved sub-mesh vertex / face data and materials - in a binary file that can
+	be memory-mapped and used directly on later loads
+
+	Change history:
+		V1.0    Created 18/10/26
+		V1.1    Import statistics for each load
+		V1.2    Sub-meshes optimised for the vertex cache, overdraw and vertex fetch
+		V1.3    Levels of detail for each sub-mesh
+		V1.4    Bounding volume hierarchy for each sub-mesh
+		V1.5    Edge adjacency for each sub-mesh
+		V1.6    Clusters of faces for culling in each sub-mesh
+		V1.7    Small sub-meshes keep the optimised face order and have no clusters
+**************************************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "CCookedMesh.h"
+#include "MeshOptimise.h"
+#include "MeshSimplify.h"
+#include "MeshBVH.h"
+#include "MeshEdges.h"
+#include "MeshClusters.h"
+#include "BaseMath.h"
+#include "Error.h"
+
+namespace gen
+{
+
+/*-----------------------------------------------------------------------------------------
+	Cooked file format
+-----------------------------------------------------------------------------------------*/
+// All values are stored in native (little-endian) layout. Every section starts on a 4 byte
+// boundary so the float vertex data can be used in place:
+//   Header
+//   Nodes:      name, depth, parent, numChildren, positionMatrix, invMeshOffset, bounds
+//   Materials:  render method, colours, specular power, texture names
+//   Sub-meshes: node, material, vertex count/size, flags, face count, bounds, level of detail
+//               count and table (kiMaxLODs entries), vertex data, face data (all levels of detail),
+//               hierarchy node count and nodes, leaf count and leaf faces (kiBVHLeafSize per leaf),
+//               edge count and edges, cluster count and clusters
+// Strings are stored as a length followed by the characters. Bounds are stored as the box minimum
+// and maximum, the sphere centre and radius (10 floats)
+
+namespace
+{
+	// File identifier ("GCMF") and version. Increase the version whenever the format or the
+	// import processing changes, so existing cooked files are rebuilt
+	const TUInt32 kiCookedMagic = 0x464d4347;
+	const TUInt32 kiCookedVersion = 12;
+
+	// Import option flags stored in the header
+	const TUInt32 kiOptionTangents = 1;
+
+	// Sub-mesh flags
+	const TUInt32 kiHasSkinningData   = 1;
+	const TUInt32 kiHasNormals        = 2;
+	const TUInt32 kiHasTangents       = 4;
+	const TUInt32 kiHasTextureCoords  = 8;
+	const TUInt32 kiHasVertexColours  = 16;
+	const TUInt32 kiHas32BitIndices   = 32;
+
+	struct SCookedHeader
+	{
+		TUInt32 iMagic;
+		TUInt32 iVersion;
+		TUInt32 iOptions;
+		TUInt32 iSourceSize;
+		TUInt64 iSourceHash;
+		TUInt32 iNumNodes;
+		TUInt32 iNumSubMeshes;
+		TUInt32 iNumMaterials;
+		TUInt32 iPadding;
+	};
+
+	// 64-bit hash of a block of data. FNV-1a style, but mixing 8 bytes at a time in four
+	// independent lanes so hashing the source file costs far less than parsing it
+	TUInt64 HashData
+	(
+		const TUInt8* pData,
+		const TUInt32 iSize
+	)
+	{
+		const TUInt64 kiPrime = 1099511628211ull;
+		TUInt64 aiLanes[4] = { 14695981039346656037ull, 0x9e3779b97f4a7c15ull,
+		                       0xc2b2ae3d27d4eb4full, 0x165667b19e3779f9ull };
+
+		const TUInt8* pBlockEnd = pData + (iSize & ~31u);
+		while (pData != pBlockEnd)
+		{
+			TUInt64 aiWords[4];
+			memcpy( aiWords, pData, sizeof(aiWords) );
+			aiLanes[0] = (aiLanes[0] ^ aiWords[0]) * kiPrime;
+			aiLanes[1] = (aiLanes[1] ^ aiWords[1]) * kiPrime;
+			aiLanes[2] = (aiLanes[2] ^ aiWords[2]) * kiPrime;
+			aiLanes[3] = (aiLanes[3] ^ aiWords[3]) * kiPrime;
+			pData += sizeof(aiWords);
+		}
+
+		TUInt64 iHash = aiLanes[0];
+		for (TUInt32 iLane = 1; iLane < 4; ++iLane)
+		{
+			iHash = (iHash ^ (aiLanes[iLane] >> 29) ^ aiLanes[iLane]) * kiPrime;
+		}
+		const TUInt8* pEnd = pBlockEnd + (iSize & 31u);
+		while (pData != pEnd)
+		{
+			iHash = (iHash ^ *pData++) * kiPrime;
+		}
+		return (iHash ^ iSize) * kiPrime;
+	}
+
+
+	/////////////////////////////////////
+	// Writing
+
+	void WriteData
+	(
+		vector<TUInt8>* pOut,
+		const void*     pData,
+		const TUInt32   iSize
+	)
+	{
+		const TUInt8* pBytes = static_cast<const TUInt8*>(pData);
+		pOut->insert( pOut->end(), pBytes, pBytes + iSize );
+	}
+
+	void WriteUInt
+	(
+		vector<TUInt8>* pOut,
+		const TUInt32   iValue
+	)
+	{
+		WriteData( pOut, &iValue, sizeof(TUInt32) );
+	}
+
+	void WriteAlign( vector<TUInt8>* pOut )
+	{
+		pOut->resize( (pOut->size() + 3) & ~3u, 0 );
+	}
+
+	void WriteString
+	(
+		vector<TUInt8>* pOut,
+		const string&   s
+	)
+	{
+		WriteUInt( pOut, static_cast<TUInt32>(s.length()) );
+		WriteData( pOut, s.data(), static_cast<TUInt32>(s.length()) );
+		WriteAlign( pOut );
+	}
+
+	void WriteBounds
+	(
+		vector<TUInt8>*    pOut,
+		const SMeshBounds& bounds
+	)
+	{
+		WriteData( pOut, &bounds.minBounds.x, 3 * sizeof(TFloat32) );
+		WriteData( pOut, &bounds.maxBounds.x, 3 * sizeof(TFloat32) );
+		WriteData( pOut, &bounds.centre.x, 3 * sizeof(TFloat32) );
+		WriteData( pOut, &bounds.radius, sizeof(TFloat32) );
+	}
+
+
+	/////////////////////////////////////
+	// Reading - each function returns a null pointer / false if the data runs out
+
+	const TUInt8* ReadData
+	(
+		const TUInt8*& pData,
+		const TUInt8*  pEnd,
+		const TUInt32  iSize
+	)
+	{
+		if (static_cast<TUInt32>(pEnd - pData) < iSize)
+		{
+			return 0;
+		}
+		const TUInt8* pResult = pData;
+		pData += (iSize + 3) & ~3u;
+		if (pData > pEnd)
+		{
+			pData = pEnd;
+		}
+		return pResult;
+	}
+
+	bool ReadUInt
+	(
+		const TUInt8*& pData,
+		const TUInt8*  pEnd,
+		TUInt32*       piValue
+	)
+	{
+		const TUInt8* pValue = ReadData( pData, pEnd, sizeof(TUInt32) );
+		if (!pValue)
+		{
+			return false;
+		}
+		memcpy( piValue, pValue, sizeof(TUInt32) );
+		return true;
+	}
+
+	bool ReadString
+	(
+		const TUInt8*& pData,
+		const TUInt8*  pEnd,
+		string&        s
+	)
+	{
+		TUInt32 iLength;
+		if (!ReadUInt( pData, pEnd, &iLength ))
+		{
+			return false;
+		}
+		const TUInt8* pChars = ReadData( pData, pEnd, iLength );
+		if (!pChars)
+		{
+			return false;
+		}
+		s.assign( reinterpret_cast<const char*>(pChars), iLength );
+		return true;
+	}
+
+	bool ReadBounds
+	(
+		const TUInt8*& pData,
+		const TUInt8*  pEnd,
+		SMeshBounds*   pBounds
+	)
+	{
+		const TUInt8* pFloats = ReadData( pData, pEnd, 10 * sizeof(TFloat32) );
+		if (!pFloats)
+		{
+			return false;
+		}
+		memcpy( &pBounds->minBounds.x, pFloats, 3 * sizeof(TFloat32) );
+		memcpy( &pBounds->maxBounds.x, pFloats + 3 * sizeof(TFloat32), 3 * sizeof(TFloat32) );
+		memcpy( &pBounds->centre.x, pFloats + 6 * sizeof(TFloat32), 3 * sizeof(TFloat32) );
+		memcpy( &pBounds->radius, pFloats + 9 * sizeof(TFloat32), sizeof(TFloat32) );
+		return true;
+	}
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Cooking
+-----------------------------------------------------------------------------------------*/
+
+// Name of the cooked file used for the given source file and import options
+string CCookedMesh::GetCookedFileName
+(
+	const string& sSourceFile,
+	const bool    bTangents /*= false*/
+)
+{
+	return sSourceFile + (bTangents ? ".tan.cooked" : ".cooked");
+}
+
+
+// Import the given X-file and write its cooked file, replacing any existing one
+EImportError CCookedMesh::CookFile
+(
+	const string& sSourceFile,
+	const bool    bTangents /*= false*/
+)
+{
+	GEN_GUARD;
+
+	// Hash the source file to key the cooked data
+	CMappedFile sourceFile;
+	if (!sourceFile.Open( sSourceFile ))
+	{
+		return kFileError;
+	}
+	TUInt64 iSourceHash = HashData( sourceFile.GetData(), sourceFile.GetSize() );
+	TUInt32 iSourceSize = sourceFile.GetSize();
+	sourceFile.Close();
+
+	vector<TUInt8> cookedData;
+	TUInt32 iOptions = bTangents ? kiOptionTangents : 0;
+	EImportError eError = CookMesh( sSourceFile, iSourceHash, iSourceSize, iOptions, &cookedData );
+	if (eError != kSuccess)
+	{
+		return eError;
+	}
+
+	if (!WriteCookedFile( GetCookedFileName( sSourceFile, bTangents ), cookedData ))
+	{
+		return kFileError;
+	}
+
+	return kSuccess;
+
+	GEN_ENDGUARD;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Loading
+-----------------------------------------------------------------------------------------*/
+
+// Load the mesh for the given X-file. Uses the cooked file if it exists and matches the source
+// file and options, otherwise imports the source file and writes a new cooked file
+EImportError CCookedMesh::Load
+(
+	const string& sSourceFile,
+	const bool    bTangents /*= false*/
+)
+{
+	GEN_GUARD;
+
+	Clear();
+	m_ImportStats.Clear();
+
+	// Hash the source file to find if the cooked file is up to date
+	TUInt64 iSourceHash;
+	TUInt32 iSourceSize;
+	TUInt32 iOptions = bTangents ? kiOptionTangents : 0;
+	string sCookedFile = GetCookedFileName( sSourceFile, bTangents );
+	{
+		CImportStageTimer cacheTimer( &m_ImportStats, kStageCache );
+		CMappedFile sourceFile;
+		if (!sourceFile.Open( sSourceFile ))
+		{
+			return kFileError;
+		}
+		iSourceHash = HashData( sourceFile.GetData(), sourceFile.GetSize() );
+		iSourceSize = sourceFile.GetSize();
+		sourceFile.Close();
+
+		// Use the cooked file directly if it matches
+		if (m_CookedFile.Open( sCookedFile ))
+		{
+			if (ReadCookedData( m_CookedFile.GetData(), m_CookedFile.GetSize(),
+			                    iSourceHash, iSourceSize, iOptions ))
+			{
+				m_bFromCache = true;
+				m_ImportStats.AddFile( m_CookedFile.GetSize() );
+				for (TUInt32 iSubMesh = 0; iSubMesh < m_SubMeshes.size(); ++iSubMesh)
+				{
+					m_ImportStats.AddCounts( kStageCache, 0, m_SubMeshes[iSubMesh].numVertices,
+					                         0, m_SubMeshes[iSubMesh].numFaces );
+				}
+				return kSuccess;
+			}
+			Clear();
+		}
+	}
+
+	// Otherwise import the source file, use the cooked data from memory and save it for next time
+	EImportError eError = CookMesh( sSourceFile, iSourceHash, iSourceSize, iOptions, &m_CookedData,
+	                                &m_ImportStats );
+	if (eError != kSuccess)
+	{
+		return eError;
+	}
+	CImportStageTimer cacheTimer( &m_ImportStats, kStageCache );
+	if (!ReadCookedData( &m_CookedData[0], static_cast<TUInt32>(m_CookedData.size()),
+	                     iSourceHash, iSourceSize, iOptions ))
+	{
+		Clear();
+		return kInvalidData;
+	}
+	WriteCookedFile( sCookedFile, m_CookedData );
+
+	return kSuccess;
+
+	GEN_ENDGUARD;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Private interface
+-----------------------------------------------------------------------------------------*/
+
+// Import the given X-file and serialise the result into a cooked data block
+EImportError CCookedMesh::CookMesh
+(
+	const string&   sSourceFile,
+	const TUInt64   iSourceHash,
+	const TUInt32   iSourceSize,
+	const TUInt32   iOptions,
+	vector<TUInt8>* pCookedData,
+	CImportStats*   pStats /*= 0*/
+)
+{
+	GEN_GUARD;
+
+	CImportXFile importFile;
+	importFile.SetImportStats( pStats );
+	EImportError eError = importFile.ImportFile( sSourceFile );
+	if (eError != kSuccess)
+	{
+		return eError;
+	}
+
+	// Serialising is part of the cache stage, building the sub-mesh data is timed separately
+	CImportStageTimer cacheTimer( pStats, kStageCache );
+
+	// Header
+	SCookedHeader header;
+	header.iMagic = kiCookedMagic;
+	header.iVersion = kiCookedVersion;
+	header.iOptions = iOptions;
+	header.iSourceSize = iSourceSize;
+	header.iSourceHash = iSourceHash;
+	header.iNumNodes = importFile.GetNumNodes();
+	header.iNumSubMeshes = importFile.GetNumSubMeshes();
+	header.iNumMaterials = importFile.GetNumMaterials();
+	header.iPadding = 0;
+	pCookedData->clear();
+	WriteData( pCookedData, &header, sizeof(SCookedHeader) );
+
+	// Nodes
+	for (TUInt32 iNode = 0; iNode < header.iNumNodes; ++iNode)
+	{
+		SMeshNode node;
+		importFile.GetNode( iNode, &node );
+		WriteString( pCookedData, node.name );
+		WriteUInt( pCookedData, node.depth );
+		WriteUInt( pCookedData, node.parent );
+		WriteUInt( pCookedData, node.numChildren );
+		WriteData( pCookedData, &node.positionMatrix.e00, 16 * sizeof(TFloat32) );
+		WriteData( pCookedData, &node.invMeshOffset.e00, 16 * sizeof(TFloat32) );
+		WriteBounds( pCookedData, node.bounds );
+	}
+
+	// Materials
+	for (TUInt32 iMaterial = 0; iMaterial < header.iNumMaterials; ++iMaterial)
+	{
+		SMeshMaterial material;
+		importFile.GetMaterial( iMaterial, &material );
+		WriteUInt( pCookedData, material.renderMethod );
+		WriteData( pCookedData, &material.diffuseColour.r, 4 * sizeof(TFloat32) );
+		WriteData( pCookedData, &material.specularColour.r, 4 * sizeof(TFloat32) );
+		WriteData( pCookedData, &material.specularPower, sizeof(TFloat32) );
+		WriteUInt( pCookedData, material.numTextures );
+		for (TUInt32 iTexture = 0; iTexture < material.numTextures; ++iTexture)
+		{
+			WriteString( pCookedData, material.textureFileNames[iTexture] );
+		}
+	}
+
+	// Sub-meshes
+	for (TUInt32 iSubMesh = 0; iSubMesh < header.iNumSubMeshes; ++iSubMesh)
+	{
+		SSubMesh subMesh;
+		importFile.GetSubMeshLayout( iSubMesh, &subMesh, (iOptions & kiOptionTangents) != 0 );
+
+		TUInt32 iFlags = (subMesh.hasSkinningData  ? kiHasSkinningData  : 0) |
+		                 (subMesh.hasNormals       ? kiHasNormals       : 0) |
+		                 (subMesh.hasTangents      ? kiHasTangents      : 0) |
+		                 (subMesh.hasTextureCoords ? kiHasTextureCoords : 0) |
+		                 (subMesh.hasVertexColours ? kiHasVertexColours : 0) |
+		                 (subMesh.indexSize == sizeof(TUInt32) ? kiHas32BitIndices : 0);
+		WriteUInt( pCookedData, subMesh.node );
+		WriteUInt( pCookedData, subMesh.material );
+		WriteUInt( pCookedData, subMesh.numVertices );
+		WriteUInt( pCookedData, subMesh.vertexSize );
+		WriteUInt( pCookedData, iFlags );
+		WriteUInt( pCookedData, subMesh.numFaces );
+		WriteBounds( pCookedData, subMesh.bounds );
+
+		// Reserve space for the level of detail table, filled in once the levels are built
+		size_t iLODOffset = pCookedData->size();
+		pCookedData->resize( iLODOffset + sizeof(TUInt32) + kiMaxLODs * sizeof(SMeshLOD) );
+
+		// Reserve space for the vertex and face data and have the importer write directly into it
+		size_t iVertexOffset = pCookedData->size();
+		pCookedData->resize( iVertexOffset + subMesh.numVertices * subMesh.vertexSize );
+		WriteAlign( pCookedData );
+		size_t iFaceOffset = pCookedData->size();
+		pCookedData->resize( iFaceOffset + subMesh.numFaces * 3 * subMesh.indexSize );
+		subMesh.vertices = pCookedData->data() + iVertexOffset;
+		subMesh.faces = pCookedData->data() + iFaceOffset;
+		eError = importFile.GetSubMeshData( iSubMesh, subMesh );
+		if (eError != kSuccess)
+		{
+			return eError;
+		}
+
+		// Reorder the faces and vertices for the vertex cache, overdraw and vertex fetch
+		{
+			CImportStageTimer optimiseTimer( pStats, kStageOptimise );
+			OptimiseSubMesh( subMesh );
+			if (pStats)
+			{
+				pStats->AddCounts( kStageOptimise, subMesh.numVertices, subMesh.numVertices,
+				                   subMesh.numFaces, subMesh.numFaces );
+			}
+		}
+
+		// Partition the faces into clusters for culling, which reorders them again - before any
+		// other data refers to the faces. Small sub-meshes are drawn whole in the order above
+		vector<SMeshCluster> clusters;
+		if (subMesh.numFaces >= kiMinClusteredFaces)
+		{
+			CImportStageTimer clustersTimer( pStats, kStageClusters );
+			BuildMeshClusters( subMesh, &clusters );
+			if (pStats)
+			{
+				pStats->AddCounts( kStageClusters, subMesh.numVertices, subMesh.numVertices,
+				                   subMesh.numFaces, subMesh.numFaces );
+			}
+		}
+
+		// Build the levels of detail from the optimised sub-mesh and add their faces after the
+		// sub-mesh's own, in the same index size
+		CImportStageTimer simplifyTimer( pStats, kStageSimplify );
+		SMeshLOD aLODs[kiMaxLODs];
+		memset( aLODs, 0, sizeof(aLODs) );
+		vector<TUInt32> lodIndices;
+		TUInt32 iNumLODs = BuildLODChain( subMesh, aLODs, &lodIndices );
+		size_t iLODFaceOffset = pCookedData->size();
+		pCookedData->resize( iLODFaceOffset + lodIndices.size() * subMesh.indexSize );
+		if (subMesh.indexSize == sizeof(TUInt32))
+		{
+			memcpy( pCookedData->data() + iLODFaceOffset, lodIndices.data(),
+			        lodIndices.size() * sizeof(TUInt32) );
+		}
+		else
+		{
+			TUInt16* pIndex16 = reinterpret_cast<TUInt16*>(pCookedData->data() + iLODFaceOffset);
+			for (TUInt32 iIndex = 0; iIndex < lodIndices.size(); ++iIndex)
+			{
+				pIndex16[iIndex] = static_cast<TUInt16>(lodIndices[iIndex]);
+			}
+		}
+		WriteAlign( pCookedData );
+		memcpy( pCookedData->data() + iLODOffset, &iNumLODs, sizeof(TUInt32) );
+		memcpy( pCookedData->data() + iLODOffset + sizeof(TUInt32), aLODs, sizeof(aLODs) );
+		if (pStats)
+		{
+			pStats->AddCounts( kStageSimplify, subMesh.numVertices, subMesh.numVertices,
+			                   subMesh.numFaces, static_cast<TUInt32>(lodIndices.size() / 3) );
+		}
+
+		// Adding the levels of detail may have moved the cooked data, so point the sub-mesh at its
+		// vertex and face data again. Likewise after each section below
+		subMesh.vertices = pCookedData->data() + iVertexOffset;
+		subMesh.faces = pCookedData->data() + iFaceOffset;
+
+		// Build the hierarchy over the full detail faces for ray queries
+		CImportStageTimer bvhTimer( pStats, kStageBVH );
+		vector<SBVHNode> bvhNodes;
+		vector<TUInt32> bvhLeafFaces;
+		BuildMeshBVH( subMesh, &bvhNodes, &bvhLeafFaces );
+		WriteUInt( pCookedData, static_cast<TUInt32>(bvhNodes.size()) );
+		WriteData( pCookedData, bvhNodes.data(), static_cast<TUInt32>(bvhNodes.size() * sizeof(SBVHNode)) );
+		WriteUInt( pCookedData, static_cast<TUInt32>(bvhLeafFaces.size() / kiBVHLeafSize) );
+		WriteData( pCookedData, bvhLeafFaces.data(), static_cast<TUInt32>(bvhLeafFaces.size() * sizeof(TUInt32)) );
+		if (pStats)
+		{
+			pStats->AddCounts( kStageBVH, 0, 0, subMesh.numFaces, subMesh.numFaces );
+		}
+
+		subMesh.vertices = pCookedData->data() + iVertexOffset;
+		subMesh.faces = pCookedData->data() + iFaceOffset;
+
+		// Build the edge adjacency of the full detail faces for silhouettes
+		CImportStageTimer edgesTimer( pStats, kStageEdges );
+		vector<SMeshEdge> edges;
+		BuildEdgeAdjacency( subMesh, &edges );
+		WriteUInt( pCookedData, static_cast<TUInt32>(edges.size()) );
+		WriteData( pCookedData, edges.data(), static_cast<TUInt32>(edges.size() * sizeof(SMeshEdge)) );
+		if (pStats)
+		{
+			pStats->AddCounts( kStageEdges, subMesh.numVertices, subMesh.numVertices, subMesh.numFaces, subMesh.numFaces );
+		}
+
+		// Clusters were built above, along with the face order
+		WriteUInt( pCookedData, static_cast<TUInt32>(clusters.size()) );
+		WriteData( pCookedData, clusters.data(), static_cast<TUInt32>(clusters.size() * sizeof(SMeshCluster)) );
+	}
+
+	return kSuccess;
+
+	GEN_ENDGUARD;
+}
+
+
+// Read the given cooked data block into the node, sub-mesh and material lists. Returns false if
+// the data is invalid or does not match the given key
+bool CCookedMesh::ReadCookedData
+(
+	const TUInt8* pData,
+	const TUInt32 iSize,
+	const TUInt64 iSourceHash,
+	const TUInt32 iSourceSize,
+	const TUInt32 iOptions
+)
+{
+	GEN_GUARD;
+
+	const TUInt8* pEnd = pData + iSize;
+
+	// Check header matches the source file and options
+	const TUInt8* pHeader = ReadData( pData, pEnd, sizeof(SCookedHeader) );
+	if (!pHeader)
+	{
+		return false;
+	}
+	SCookedHeader header;
+	memcpy( &header, pHeader, sizeof(SCookedHeader) );
+	if (header.iMagic != kiCookedMagic || header.iVersion != kiCookedVersion ||
+	    header.iOptions != iOptions || header.iSourceSize != iSourceSize ||
+	    header.iSourceHash != iSourceHash)
+	{
+		return false;
+	}
+
+	// Nodes
+	m_Nodes.resize( header.iNumNodes );
+	for (TUInt32 iNode = 0; iNode < header.iNumNodes; ++iNode)
+	{
+		SMeshNode& node = m_Nodes[iNode];
+		if (!ReadString( pData, pEnd, node.name ) || !ReadUInt( pData, pEnd, &node.depth ) ||
+		    !ReadUInt( pData, pEnd, &node.parent ) || !ReadUInt( pData, pEnd, &node.numChildren ))
+		{
+			return false;
+		}
+		const TUInt8* pMatrices = ReadData( pData, pEnd, 32 * sizeof(TFloat32) );
+		if (!pMatrices || node.parent >= header.iNumNodes)
+		{
+			return false;
+		}
+		memcpy( &node.positionMatrix.e00, pMatrices, 16 * sizeof(TFloat32) );
+		memcpy( &node.invMeshOffset.e00, pMatrices + 16 * sizeof(TFloat32), 16 * sizeof(TFloat32) );
+		if (!ReadBounds( pData, pEnd, &node.bounds ))
+		{
+			return false;
+		}
+	}
+
+	// Materials
+	m_Materials.resize( header.iNumMaterials );
+	for (TUInt32 iMaterial = 0; iMaterial < header.iNumMaterials; ++iMaterial)
+	{
+		SMeshMaterial& material = m_Materials[iMaterial];
+		TUInt32 iRenderMethod;
+		if (!ReadUInt( pData, pEnd, &iRenderMethod ) || iRenderMethod >= NumRenderMethods)
+		{
+			return false;
+		}
+		material.renderMethod = static_cast<ERenderMethod>(iRenderMethod);
+		const TUInt8* pColours = ReadData( pData, pEnd, 9 * sizeof(TFloat32) );
+		if (!pColours || !ReadUInt( pData, pEnd, &material.numTextures ) ||
+		    material.numTextures > kiMaxTextures)
+		{
+			return false;
+		}
+		memcpy( &material.diffuseColour.r, pColours, 4 * sizeof(TFloat32) );
+		memcpy( &material.specularColour.r, pColours + 4 * sizeof(TFloat32), 4 * sizeof(TFloat32) );
+		memcpy( &material.specularPower, pColours + 8 * sizeof(TFloat32), sizeof(TFloat32) );
+		for (TUInt32 iTexture = 0; iTexture < material.numTextures; ++iTexture)
+		{
+			if (!ReadString( pData, pEnd, material.textureFileNames[iTexture] ))
+			{
+				return false;
+			}
+		}
+	}
+
+	// Sub-meshes - vertex and face data is used in place
+	m_SubMeshes.resize( header.iNumSubMeshes );
+	m_SubMeshLODs.resize( header.iNumSubMeshes );
+	m_SubMeshBVHs.resize( header.iNumSubMeshes );
+	m_SubMeshEdges.resize( header.iNumSubMeshes );
+	m_SubMeshClusters.resize( header.iNumSubMeshes );
+	for (TUInt32 iSubMesh = 0; iSubMesh < header.iNumSubMeshes; ++iSubMesh)
+	{
+		SSubMesh& subMesh = m_SubMeshes[iSubMesh];
+		SSubMeshLODs& lods = m_SubMeshLODs[iSubMesh];
+		TUInt32 iFlags;
+		if (!ReadUInt( pData, pEnd, &subMesh.node ) || !ReadUInt( pData, pEnd, &subMesh.material ) ||
+		    !ReadUInt( pData, pEnd, &subMesh.numVertices ) ||
+		    !ReadUInt( pData, pEnd, &subMesh.vertexSize ) || !ReadUInt( pData, pEnd, &iFlags ) ||
+		    !ReadUInt( pData, pEnd, &subMesh.numFaces ) ||
+		    !ReadBounds( pData, pEnd, &subMesh.bounds ))
+		{
+			return false;
+		}
+		if (subMesh.node >= header.iNumNodes || subMesh.material >= header.iNumMaterials ||
+		    (subMesh.vertexSize && subMesh.numVertices > 0xffffffffu / subMesh.vertexSize) ||
+		    subMesh.numFaces > 0xffffffffu / sizeof(SMeshFace32))
+		{
+			return false;
+		}
+		subMesh.indexSize = (iFlags & kiHas32BitIndices) ? sizeof(TUInt32) : sizeof(TUInt16);
+		subMesh.hasSkinningData  = (iFlags & kiHasSkinningData) != 0;
+		subMesh.hasNormals       = (iFlags & kiHasNormals) != 0;
+		subMesh.hasTangents      = (iFlags & kiHasTangents) != 0;
+		subMesh.hasTextureCoords = (iFlags & kiHasTextureCoords) != 0;
+		subMesh.hasVertexColours = (iFlags & kiHasVertexColours) != 0;
+
+		// Levels of detail must start with the sub-mesh's own faces and follow on from each other
+		if (!ReadUInt( pData, pEnd, &lods.iNumLODs ) || lods.iNumLODs == 0 || lods.iNumLODs > kiMaxLODs)
+		{
+			return false;
+		}
+		const TUInt8* pLODs = ReadData( pData, pEnd, kiMaxLODs * sizeof(SMeshLOD) );
+		if (!pLODs)
+		{
+			return false;
+		}
+		memcpy( lods.aLODs, pLODs, kiMaxLODs * sizeof(SMeshLOD) );
+		if (lods.aLODs[0].iFirstFace != 0 || lods.aLODs[0].iNumFaces != subMesh.numFaces)
+		{
+			return false;
+		}
+		TUInt32 iTotalFaces = subMesh.numFaces;
+		for (TUInt32 iLOD = 1; iLOD < lods.iNumLODs; ++iLOD)
+		{
+			if (lods.aLODs[iLOD].iFirstFace != iTotalFaces ||
+			    lods.aLODs[iLOD].iNumFaces > 0xffffffffu / sizeof(SMeshFace32) - iTotalFaces)
+			{
+				return false;
+			}
+			iTotalFaces += lods.aLODs[iLOD].iNumFaces;
+		}
+
+		const TUInt8* pVertices = ReadData( pData, pEnd, subMesh.numVertices * subMesh.vertexSize );
+		const TUInt8* pFaces = ReadData( pData, pEnd, iTotalFaces * 3 * subMesh.indexSize );
+		if (!pVertices || !pFaces)
+		{
+			return false;
+		}
+		subMesh.vertices = const_cast<TUInt8*>(pVertices);
+		subMesh.faces = const_cast<TUInt8*>(pFaces);
+
+		// Hierarchy - children must follow their parent within the depth limit and leaves must hold
+		// faces of the sub-mesh, so queries can't leave the data
+		SSubMeshBVH& bvh = m_SubMeshBVHs[iSubMesh];
+		if (!ReadUInt( pData, pEnd, &bvh.iNumNodes ) || bvh.iNumNodes > 0xffffffffu / sizeof(SBVHNode) ||
+		    (bvh.iNumNodes == 0) != (subMesh.numFaces == 0))
+		{
+			return false;
+		}
+		const TUInt8* pNodes = ReadData( pData, pEnd, bvh.iNumNodes * sizeof(SBVHNode) );
+		if (!pNodes || !ReadUInt( pData, pEnd, &bvh.iNumLeaves ) ||
+		    bvh.iNumLeaves > 0xffffffffu / (kiBVHLeafSize * sizeof(TUInt32)))
+		{
+			return false;
+		}
+		const TUInt8* pLeafFaces = ReadData( pData, pEnd, bvh.iNumLeaves * kiBVHLeafSize * sizeof(TUInt32) );
+		if (!pLeafFaces)
+		{
+			return false;
+		}
+		bvh.pNodes = reinterpret_cast<const SBVHNode*>(pNodes);
+		bvh.pLeafFaces = reinterpret_cast<const TUInt32*>(pLeafFaces);
+		vector<TUInt32> nodeDepths( bvh.iNumNodes, 0 );
+		for (TUInt32 iNode = 0; iNode < bvh.iNumNodes; ++iNode)
+		{
+			const SBVHNode& node = bvh.pNodes[iNode];
+			if ((node.iCount == 0 && (node.iFirst <= iNode || node.iFirst >= bvh.iNumNodes - 1 ||
+			                          nodeDepths[iNode] >= kiBVHMaxDepth)) ||
+			    (node.iCount > 0 && (node.iCount > kiBVHLeafSize || node.iFirst >= bvh.iNumLeaves)))
+			{
+				return false;
+			}
+			if (node.iCount == 0)
+			{
+				nodeDepths[node.iFirst] = Max( nodeDepths[node.iFirst], nodeDepths[iNode] + 1 );
+				nodeDepths[node.iFirst + 1] = Max( nodeDepths[node.iFirst + 1], nodeDepths[iNode] + 1 );
+			}
+		}
+		for (TUInt32 iSlot = 0; iSlot < bvh.iNumLeaves * kiBVHLeafSize; ++iSlot)
+		{
+			if (bvh.pLeafFaces[iSlot] >= subMesh.numFaces && bvh.pLeafFaces[iSlot] != kiBVHNoItem)
+			{
+				return false;
+			}
+		}
+
+		// Edges - must join vertices and faces of the sub-mesh
+		SSubMeshEdges& edges = m_SubMeshEdges[iSubMesh];
+		if (!ReadUInt( pData, pEnd, &edges.iNumEdges ) || edges.iNumEdges > 0xffffffffu / sizeof(SMeshEdge))
+		{
+			return false;
+		}
+		const TUInt8* pEdges = ReadData( pData, pEnd, edges.iNumEdges * sizeof(SMeshEdge) );
+		if (!pEdges)
+		{
+			return false;
+		}
+		edges.pEdges = reinterpret_cast<const SMeshEdge*>(pEdges);
+		for (TUInt32 iEdge = 0; iEdge < edges.iNumEdges; ++iEdge)
+		{
+			const SMeshEdge& edge = edges.pEdges[iEdge];
+			if (edge.aiVertices[0] >= subMesh.numVertices || edge.aiVertices[1] >= subMesh.numVertices ||
+			    edge.aiFaces[0] >= subMesh.numFaces ||
+			    (edge.aiFaces[1] >= subMesh.numFaces && edge.aiFaces[1] != kiNoEdgeFace))
+			{
+				return false;
+			}
+		}
+
+		// Clusters - none for a small sub-mesh, otherwise must cover the full detail faces of the
+		// sub-mesh in order
+		SSubMeshClusters& clusters = m_SubMeshClusters[iSubMesh];
+		if (!ReadUInt( pData, pEnd, &clusters.iNumClusters ) || clusters.iNumClusters > 0xffffffffu / sizeof(SMeshCluster))
+		{
+			return false;
+		}
+		const TUInt8* pClusters = ReadData( pData, pEnd, clusters.iNumClusters * sizeof(SMeshCluster) );
+		if (!pClusters)
+		{
+			return false;
+		}
+		clusters.pClusters = reinterpret_cast<const SMeshCluster*>(pClusters);
+		TUInt32 iNextFace = 0;
+		for (TUInt32 iCluster = 0; iCluster < clusters.iNumClusters; ++iCluster)
+		{
+			const SMeshCluster& cluster = clusters.pClusters[iCluster];
+			if (cluster.iFirstFace != iNextFace || cluster.iNumFaces == 0 || cluster.iNumFaces > kiMaxClusterFaces)
+			{
+				return false;
+			}
+			iNextFace += cluster.iNumFaces;
+		}
+		if (clusters.iNumClusters > 0 && iNextFace != subMesh.numFaces)
+		{
+			return false;
+		}
+	}
+
+	// Intern the materials once the data is known to be valid
+	CMaterialTable& materialTable = CMaterialTable::GetShared();
+	m_MaterialIds.resize( header.iNumMaterials );
+	for (TUInt32 iMaterial = 0; iMaterial < header.iNumMaterials; ++iMaterial)
+	{
+		m_MaterialIds[iMaterial] = materialTable.InternMaterial( m_Materials[iMaterial] );
+	}
+
+	return true;
+
+	GEN_ENDGUARD;
+}
+
+
+// Write a cooked data block to a file
+bool CCookedMesh::WriteCookedFile
+(
+	const string&         sCookedFile,
+	const vector<TUInt8>& cookedData
+)
+{
+	GEN_GUARD;
+
+	FILE* pFile = fopen( sCookedFile.c_str(), "wb" );
+	if (!pFile)
+	{
+		return false;
+	}
+	bool bWritten = (fwrite( &cookedData[0], 1, cookedData.size(), pFile ) == cookedData.size());
+	if (fclose( pFile ) != 0 || !bWritten)
+	{
+		remove( sCookedFile.c_str() );
+		return false;
+	}
+
+	return true;
+
+	GEN_ENDGUARD;
+}
+
+
+// Clear all loaded data
+void CCookedMesh::Clear()
+{
+	m_Nodes.clear();
+	m_SubMeshes.clear();
+	m_SubMeshLODs.clear();
+	m_SubMeshBVHs.clear();
+	m_SubMeshEdges.clear();
+	m_SubMeshClusters.clear();
+	m_Materials.clear();
+	m_MaterialIds.clear();
+	m_CookedData.clear();
+	m_CookedFile.Close();
+	m_bFromCache = false;
+}
+
+
+} // namespace gen
@@ -0,0 +1,331 @@
+/**************************************************************************************************
+	Module:       CCookedMesh.h
+	Date created: 18/10/26
+
+	Cooked (pre-processed) mesh cache. Stores the final output of an X-file import - the node
+	hierarchy, interleaved sub-mesh vertex / face data and materials - in a binary file that can
+	be memory-mapped and used directly on later loads
+
+	Change history:
+		V1.0    Created 18/10/26
+		V1.1    Import statistics for each load
+		V1.2    Sub-meshes optimised for the vertex cache, overdraw and vertex fetch
+		V1.3    Levels of detail for each sub-mesh
+		V1.4    Bounds of each node and sub-mesh
+		V1.5    Bounding volume hierarchy for each sub-mesh
+		V1.6    Edge adjacency for each sub-mesh
+		V1.7    Clusters of faces for culling in each sub-mesh
+**************************************************************************************************/
+
+#ifndef GEN_C_COOKED_MESH_H_INCLUDED
+#define GEN_C_COOKED_MESH_H_INCLUDED
+
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "MeshData.h"
+#include "CImportXFile.h"
+#include "CImportStats.h"
+#include "MeshSimplify.h"
+#include "MeshBVH.h"
+#include "MeshEdges.h"
+#include "MeshClusters.h"
+#include "CMappedFile.h"
+
+namespace gen
+{
+
+// A cooked file is keyed on a hash of the source file contents and the import options, so it is
+// rebuilt automatically whenever either changes. The cooked data is laid out so the vertex and
+// face streams of each sub-mesh can be used in place from the mapped file. The faces and
+// vertices of each sub-mesh are reordered for the GPU when cooked (see OptimiseSubMesh) and
+// grouped into clusters for culling (see BuildMeshClusters), a chain of levels of detail is built
+// for each sub-mesh (see BuildLODChain), a bounding volume hierarchy over its full detail faces
+// for ray queries (see BuildMeshBVH) and the adjacency of their edges for silhouettes (see
+// BuildEdgeAdjacency)
+class CCookedMesh
+{
+	GEN_CLASS( CCookedMesh )
+
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+public:
+	// Constructor
+	CCookedMesh()
+	{
+		m_bFromCache = false;
+	}
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CCookedMesh( const CCookedMesh& );
+	CCookedMesh& operator=( const CCookedMesh& );
+
+
+/*-----------------------------------------------------------------------------------------
+	Public interface
+-----------------------------------------------------------------------------------------*/
+public:
+
+	/////////////////////////////////////
+	// Cooking
+
+	// Name of the cooked file used for the given source file and import options
+	static string GetCookedFileName
+	(
+		const string& sSourceFile,
+		const bool    bTangents = false
+	);
+
+	// Import the given X-file and write its cooked file, replacing any existing one. Used to
+	// prepare assets offline, Load will also cook files on demand
+	// Possible return values:
+	//		kSuccess:			...
+	//		kFileError:			Missing source file, or cooked file could not be written
+	//		(Other errors from CImportXFile::ImportFile)
+	static EImportError CookFile
+	(
+		const string& sSourceFile,
+		const bool    bTangents = false
+	);
+
+
+	/////////////////////////////////////
+	// Loading
+
+	// Load the mesh for the given X-file. Uses the cooked file if it exists and matches the
+	// source file and options, otherwise imports the source file and writes a new cooked file
+	// (failure to write the cooked file is not an error)
+	// Possible return values:
+	//		kSuccess:			...
+	//		kFileError:			Missing source file
+	//		(Other errors from CImportXFile::ImportFile)
+	EImportError Load
+	(
+		const string& sSourceFile,
+		const bool    bTangents = false
+	);
+
+	// Was the last successful Load satisfied from the cooked file
+	bool IsFromCache() const
+	{
+		return m_bFromCache;
+	}
+
+	// Get the statistics of the last Load (see CImportStats). Includes the import if the cooked
+	// file was not used
+	const CImportStats& GetImportStats() const
+	{
+		return m_ImportStats;
+	}
+
+
+	/////////////////////////////////////
+	// Data access
+
+	// Get number of nodes in the mesh hierarchy
+	TUInt32 GetNumNodes() const
+	{
+		return static_cast<TUInt32>(m_Nodes.size());
+	}
+
+	// Get a single node from the mesh hierarchy
+	const SMeshNode& GetNode( const TUInt32 iNode ) const
+	{
+		return m_Nodes[iNode];
+	}
+
+	// Get number of sub-meshes in the mesh
+	TUInt32 GetNumSubMeshes() const
+	{
+		return static_cast<TUInt32>(m_SubMeshes.size());
+	}
+
+	// Get the specification and data for given sub-mesh. The vertex and face data belong to this
+	// object and remain valid until the next Load or until it is destroyed. They must not be
+	// modified or deleted
+	const SSubMesh& GetSubMesh( const TUInt32 iSubMesh ) const
+	{
+		return m_SubMeshes[iSubMesh];
+	}
+
+	// Get the number of levels of detail of a given sub-mesh, at least 1
+	TUInt32 GetNumLODs( const TUInt32 iSubMesh ) const
+	{
+		return m_SubMeshLODs[iSubMesh].iNumLODs;
+	}
+
+	// Get a level of detail of a given sub-mesh. Level 0 is the sub-mesh's own faces, the faces of
+	// the later levels follow them in the sub-mesh's face data and use the same vertices
+	const SMeshLOD& GetLOD
+	(
+		const TUInt32 iSubMesh,
+		const TUInt32 iLOD
+	) const
+	{
+		return m_SubMeshLODs[iSubMesh].aLODs[iLOD];
+	}
+
+	// Get the number of nodes in the bounding volume hierarchy of a given sub-mesh, 0 if it has no
+	// faces, and the nodes themselves (see BuildMeshBVH). Pass to CMeshBVH::Init for ray queries
+	TUInt32 GetNumBVHNodes( const TUInt32 iSubMesh ) const
+	{
+		return m_SubMeshBVHs[iSubMesh].iNumNodes;
+	}
+	const SBVHNode* GetBVHNodes( const TUInt32 iSubMesh ) const
+	{
+		return m_SubMeshBVHs[iSubMesh].pNodes;
+	}
+
+	// Get the leaf face list of the bounding volume hierarchy of a given sub-mesh, kiBVHLeafSize
+	// face indices for each leaf
+	const TUInt32* GetBVHLeafFaces( const TUInt32 iSubMesh ) const
+	{
+		return m_SubMeshBVHs[iSubMesh].pLeafFaces;
+	}
+
+	// Get the number of edges of the full detail faces of a given sub-mesh and the edges themselves,
+	// each with the faces either side (see BuildEdgeAdjacency). Pass to CMeshSilhouette::Init to
+	// extract silhouettes
+	TUInt32 GetNumEdges( const TUInt32 iSubMesh ) const
+	{
+		return m_SubMeshEdges[iSubMesh].iNumEdges;
+	}
+	const SMeshEdge* GetEdges( const TUInt32 iSubMesh ) const
+	{
+		return m_SubMeshEdges[iSubMesh].pEdges;
+	}
+
+	// Get the number of clusters of the full detail faces of a given sub-mesh and the clusters
+	// themselves, which cover the faces in order (see BuildMeshClusters). Pass to CullMeshClusters
+	// to find the faces to draw each frame. Sub-meshes with fewer than kiMinClusteredFaces faces
+	// have no clusters and are drawn whole
+	TUInt32 GetNumClusters( const TUInt32 iSubMesh ) const
+	{
+		return m_SubMeshClusters[iSubMesh].iNumClusters;
+	}
+	const SMeshCluster* GetClusters( const TUInt32 iSubMesh ) const
+	{
+		return m_SubMeshClusters[iSubMesh].pClusters;
+	}
+
+	// Get the number of materials used in the mesh
+	TUInt32 GetNumMaterials() const
+	{
+		return static_cast<TUInt32>(m_Materials.size());
+	}
+
+	// Get specification of a given material
+	const SMeshMaterial& GetMaterial( const TUInt32 iMaterial ) const
+	{
+		return m_Materials[iMaterial];
+	}
+
+	// Get the id of a given material in the shared material table (see CMaterialTable). Identical
+	// materials in any loaded mesh have the same id
+	TUInt32 GetMaterialId( const TUInt32 iMaterial ) const
+	{
+		return m_MaterialIds[iMaterial];
+	}
+
+
+/*-----------------------------------------------------------------------------------------
+	Private interface
+-----------------------------------------------------------------------------------------*/
+private:
+
+	// Import the given X-file and serialise the result into a cooked data block, which is keyed
+	// with the given source hash / size and options. Adds to the given statistics if any
+	static EImportError CookMesh
+	(
+		const string&   sSourceFile,
+		const TUInt64   iSourceHash,
+		const TUInt32   iSourceSize,
+		const TUInt32   iOptions,
+		vector<TUInt8>* pCookedData,
+		CImportStats*   pStats = 0
+	);
+
+	// Read the given cooked data block into the node, sub-mesh and material lists, interning the
+	// materials in the shared material table. Returns false if the data is invalid or does not
+	// match the given key. Sub-meshes point into the data
+	bool ReadCookedData
+	(
+		const TUInt8* pData,
+		const TUInt32 iSize,
+		const TUInt64 iSourceHash,
+		const TUInt32 iSourceSize,
+		const TUInt32 iOptions
+	);
+
+	// Write a cooked data block to a file
+	static bool WriteCookedFile
+	(
+		const string&         sCookedFile,
+		const vector<TUInt8>& cookedData
+	);
+
+	// Clear all loaded data
+	void Clear();
+
+
+/*-----------------------------------------------------------------------------------------
+	Data
+-----------------------------------------------------------------------------------------*/
+private:
+
+	// Levels of detail of a sub-mesh
+	struct SSubMeshLODs
+	{
+		TUInt32  iNumLODs;
+		SMeshLOD aLODs[kiMaxLODs];
+	};
+
+	// Bounding volume hierarchy of a sub-mesh, pointing into the cooked data
+	struct SSubMeshBVH
+	{
+		TUInt32         iNumNodes;
+		const SBVHNode* pNodes;
+		TUInt32         iNumLeaves;
+		const TUInt32*  pLeafFaces;
+	};
+
+	// Edge adjacency of a sub-mesh, pointing into the cooked data
+	struct SSubMeshEdges
+	{
+		TUInt32          iNumEdges;
+		const SMeshEdge* pEdges;
+	};
+
+	// Clusters of a sub-mesh, pointing into the cooked data
+	struct SSubMeshClusters
+	{
+		TUInt32             iNumClusters;
+		const SMeshCluster* pClusters;
+	};
+
+	// Cooked data - either a mapped cooked file or a block cooked on demand
+	CMappedFile              m_CookedFile;
+	vector<TUInt8>           m_CookedData;
+	bool                     m_bFromCache;
+
+	// Statistics of the last load
+	CImportStats             m_ImportStats;
+
+	// Mesh data read from the cooked data, sub-meshes point into the cooked data above
+	vector<SMeshNode>        m_Nodes;
+	vector<SSubMesh>         m_SubMeshes;
+	vector<SSubMeshLODs>     m_SubMeshLODs;
+	vector<SSubMeshBVH>      m_SubMeshBVHs;
+	vector<SSubMeshEdges>    m_SubMeshEdges;
+	vector<SSubMeshClusters> m_SubMeshClusters;
+	vector<SMeshMaterial>    m_Materials;
+	vector<TUInt32>          m_MaterialIds;
+};
+
+
+} // namespace gen
+
+#endif // GEN_C_COOKED_MESH_H_INCLUDED
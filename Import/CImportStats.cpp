@@ -0,0 +1,294 @@
+/**************************************************************************************************
+	Module:       CImportStats.cpp
+	Date created: 18/10/26
+
+	Import profiling statistics - wall time, vertex / face counts and memory use for each stage
+	of importing a mesh, which can be collected across many imports and saved as JSON or CSV
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#include <stdio.h>
+#include <sstream>
+#include <iomanip>
+
+#include "CImportStats.h"
+#include "Error.h"
+
+namespace gen
+{
+
+namespace
+{
+	// Stage names used in the output, in the order of EImportStage
+	const char* const kasStageNames[kNumImportStages] =
+	{
+		"read", "parse", "weld", "materials", "bones", "split", "tangents", "vertexData", "optimise",
+		"clusters", "simplify", "bvh", "edges", "cache", "buffers"
+	};
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Collection
+-----------------------------------------------------------------------------------------*/
+
+// Reset all statistics to zero. Must not be called while a stage is being timed
+void CImportStats::Clear()
+{
+	for (TUInt32 iStage = 0; iStage < kNumImportStages; ++iStage)
+	{
+		SImportStageStats& stage = m_aStages[iStage];
+		stage.fTime = 0.0;
+		stage.iCalls = 0;
+		stage.iVerticesIn = 0;
+		stage.iVerticesOut = 0;
+		stage.iFacesIn = 0;
+		stage.iFacesOut = 0;
+	}
+	m_iNumFiles = 0;
+	m_iBytesRead = 0;
+	m_iAllocations = 0;
+	m_iPeakBytes = 0;
+	m_iCurrStage = -1;
+}
+
+// Add another set of statistics to this one. Times and counts are summed, peak memory is the
+// larger of the two
+void CImportStats::Add( const CImportStats& stats )
+{
+	for (TUInt32 iStage = 0; iStage < kNumImportStages; ++iStage)
+	{
+		SImportStageStats& stage = m_aStages[iStage];
+		const SImportStageStats& addStage = stats.m_aStages[iStage];
+		stage.fTime += addStage.fTime;
+		stage.iCalls += addStage.iCalls;
+		stage.iVerticesIn += addStage.iVerticesIn;
+		stage.iVerticesOut += addStage.iVerticesOut;
+		stage.iFacesIn += addStage.iFacesIn;
+		stage.iFacesOut += addStage.iFacesOut;
+	}
+	m_iNumFiles += stats.m_iNumFiles;
+	m_iBytesRead += stats.m_iBytesRead;
+	m_iAllocations += stats.m_iAllocations;
+	RecordMemory( stats.m_iPeakBytes );
+}
+
+
+// Start timing the given stage, pausing the current stage if there is one. Returns the stage
+// that was paused (or -1) to pass to EndStage
+TInt32 CImportStats::BeginStage( const EImportStage eStage )
+{
+	TClock::time_point now = TClock::now();
+	if (m_iCurrStage >= 0)
+	{
+		m_aStages[m_iCurrStage].fTime += chrono::duration<TFloat64>( now - m_StageStart ).count();
+	}
+	TInt32 iResumeStage = m_iCurrStage;
+	m_iCurrStage = eStage;
+	m_StageStart = now;
+	++m_aStages[eStage].iCalls;
+	return iResumeStage;
+}
+
+// Finish timing the current stage and resume the given one (as returned by BeginStage)
+void CImportStats::EndStage( const TInt32 iResumeStage )
+{
+	TClock::time_point now = TClock::now();
+	if (m_iCurrStage >= 0)
+	{
+		m_aStages[m_iCurrStage].fTime += chrono::duration<TFloat64>( now - m_StageStart ).count();
+	}
+	m_iCurrStage = iResumeStage;
+	m_StageStart = now;
+}
+
+
+// Add to the vertices and faces going into and out of a stage
+void CImportStats::AddCounts
+(
+	const EImportStage eStage,
+	const TUInt64      iVerticesIn,
+	const TUInt64      iVerticesOut,
+	const TUInt64      iFacesIn,
+	const TUInt64      iFacesOut
+)
+{
+	SImportStageStats& stage = m_aStages[eStage];
+	stage.iVerticesIn += iVerticesIn;
+	stage.iVerticesOut += iVerticesOut;
+	stage.iFacesIn += iFacesIn;
+	stage.iFacesOut += iFacesOut;
+}
+
+// Count a file loaded and the number of bytes read from it
+void CImportStats::AddFile( const TUInt64 iBytesRead )
+{
+	++m_iNumFiles;
+	m_iBytesRead += iBytesRead;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Data access
+-----------------------------------------------------------------------------------------*/
+
+// Get the name of a stage as used in the JSON and CSV output
+const char* CImportStats::GetStageName( const EImportStage eStage )
+{
+	return kasStageNames[eStage];
+}
+
+// Total time of all stages (seconds)
+TFloat64 CImportStats::GetTotalTime() const
+{
+	TFloat64 fTime = 0.0;
+	for (TUInt32 iStage = 0; iStage < kNumImportStages; ++iStage)
+	{
+		fTime += m_aStages[iStage].fTime;
+	}
+	return fTime;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Output
+-----------------------------------------------------------------------------------------*/
+
+// Get the statistics as a JSON object, with an entry for each stage. Times are in milliseconds
+string CImportStats::GetJSON() const
+{
+	GEN_GUARD;
+
+	stringstream json;
+	json << fixed << setprecision( 3 );
+	json << "{\n";
+	json << "\t\"files\": " << m_iNumFiles << ",\n";
+	json << "\t\"bytesRead\": " << m_iBytesRead << ",\n";
+	json << "\t\"allocations\": " << m_iAllocations << ",\n";
+	json << "\t\"peakBytes\": " << m_iPeakBytes << ",\n";
+	json << "\t\"timeMs\": " << GetTotalTime() * 1000.0 << ",\n";
+	json << "\t\"stages\": {\n";
+	for (TUInt32 iStage = 0; iStage < kNumImportStages; ++iStage)
+	{
+		const SImportStageStats& stage = m_aStages[iStage];
+		json << "\t\t\"" << kasStageNames[iStage] << "\": { "
+		     << "\"timeMs\": " << stage.fTime * 1000.0 << ", "
+		     << "\"calls\": " << stage.iCalls << ", "
+		     << "\"verticesIn\": " << stage.iVerticesIn << ", "
+		     << "\"verticesOut\": " << stage.iVerticesOut << ", "
+		     << "\"facesIn\": " << stage.iFacesIn << ", "
+		     << "\"facesOut\": " << stage.iFacesOut << " }"
+		     << ((iStage + 1 < kNumImportStages) ? ",\n" : "\n");
+	}
+	json << "\t}\n";
+	json << "}\n";
+	return json.str();
+
+	GEN_ENDGUARD;
+}
+
+
+// Get the statistics as a single CSV line, starting with the given label then the totals and a
+// time, call and count column for each stage
+string CImportStats::GetCSV( const string& sLabel ) const
+{
+	GEN_GUARD;
+
+	// Quote the label if it would break the line up
+	stringstream csv;
+	csv << fixed << setprecision( 3 );
+	if (sLabel.find_first_of( ",\"\n" ) != string::npos)
+	{
+		csv << '"';
+		for (string::size_type iChar = 0; iChar < sLabel.length(); ++iChar)
+		{
+			csv << ((sLabel[iChar] == '"') ? "\"\"" : sLabel.substr( iChar, 1 ));
+		}
+		csv << '"';
+	}
+	else
+	{
+		csv << sLabel;
+	}
+
+	csv << ',' << m_iNumFiles << ',' << m_iBytesRead << ',' << m_iAllocations << ','
+	    << m_iPeakBytes << ',' << GetTotalTime() * 1000.0;
+	for (TUInt32 iStage = 0; iStage < kNumImportStages; ++iStage)
+	{
+		const SImportStageStats& stage = m_aStages[iStage];
+		csv << ',' << stage.fTime * 1000.0 << ',' << stage.iCalls << ','
+		    << stage.iVerticesIn << ',' << stage.iVerticesOut << ','
+		    << stage.iFacesIn << ',' << stage.iFacesOut;
+	}
+	csv << '\n';
+	return csv.str();
+
+	GEN_ENDGUARD;
+}
+
+// Get the CSV header line matching the lines above
+string CImportStats::GetCSVHeader()
+{
+	GEN_GUARD;
+
+	string sHeader = "label,files,bytesRead,allocations,peakBytes,timeMs";
+	for (TUInt32 iStage = 0; iStage < kNumImportStages; ++iStage)
+	{
+		string sStage = kasStageNames[iStage];
+		sHeader += "," + sStage + "TimeMs," + sStage + "Calls," + sStage + "VerticesIn," +
+		           sStage + "VerticesOut," + sStage + "FacesIn," + sStage + "FacesOut";
+	}
+	return sHeader + "\n";
+
+	GEN_ENDGUARD;
+}
+
+
+// Save the statistics as JSON, replacing any existing file. Returns false on failure
+bool CImportStats::SaveJSONFile( const string& sFileName ) const
+{
+	GEN_GUARD;
+
+	FILE* pFile = fopen( sFileName.c_str(), "wb" );
+	if (!pFile)
+	{
+		return false;
+	}
+	string sJSON = GetJSON();
+	bool bWritten = (fwrite( sJSON.data(), 1, sJSON.length(), pFile ) == sJSON.length());
+	return (fclose( pFile ) == 0) && bWritten;
+
+	GEN_ENDGUARD;
+}
+
+// Append a line of statistics to a CSV file, writing the header first if the file is new.
+// Returns false on failure
+bool CImportStats::AppendCSVFile
+(
+	const string& sFileName,
+	const string& sLabel
+) const
+{
+	GEN_GUARD;
+
+	FILE* pFile = fopen( sFileName.c_str(), "ab" );
+	if (!pFile)
+	{
+		return false;
+	}
+	string sLines;
+	if (fseek( pFile, 0, SEEK_END ) == 0 && ftell( pFile ) == 0)
+	{
+		sLines = GetCSVHeader();
+	}
+	sLines += GetCSV( sLabel );
+	bool bWritten = (fwrite( sLines.data(), 1, sLines.length(), pFile ) == sLines.length());
+	return (fclose( pFile ) == 0) && bWritten;
+
+	GEN_ENDGUARD;
+}
+
+
+} // namespace gen
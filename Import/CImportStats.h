@@ -0,0 +1,242 @@
+/**************************************************************************************************
+	Module:       CImportStats.h
+	Date created: 18/10/26
+
+	Import profiling statistics - wall time, vertex / face counts and memory use for each stage
+	of importing a mesh, which can be collected across many imports and saved as JSON or CSV
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#ifndef GEN_C_IMPORT_STATS_H_INCLUDED
+#define GEN_C_IMPORT_STATS_H_INCLUDED
+
+#include <string>
+#include <chrono>
+using namespace std;
+
+#include "GenDefines.h"
+
+namespace gen
+{
+
+// Stages of an import that are timed separately. The time spent in a stage does not include
+// any stages started within it, e.g. welding is not counted as part of parsing
+enum EImportStage
+{
+	kStageRead,       // Opening, mapping and decompressing files
+	kStageParse,      // Parsing frames, meshes and materials
+	kStageWeld,       // Welding vertices (which also matches the normal and vertex face lists)
+	kStageMaterials,  // Building the global material list
+	kStageBones,      // Matching bones to frames
+	kStageSplit,      // Splitting meshes by material
+	kStageTangents,   // Calculating tangents
+	kStageVertexData, // Writing interleaved vertex data and faces for sub-meshes
+	kStageOptimise,   // Reordering sub-mesh faces and vertices for the GPU
+	kStageClusters,   // Partitioning sub-mesh faces into clusters for culling
+	kStageSimplify,   // Building levels of detail for sub-meshes
+	kStageBVH,        // Building bounding volume hierarchies over sub-mesh faces for ray queries
+	kStageEdges,      // Building the edge adjacency of sub-mesh faces for silhouettes
+	kStageCache,      // Hashing source files, reading and writing cooked files
+	kStageBuffers,    // Creating vertex and index buffers (by the application)
+	kNumImportStages
+};
+
+// Statistics for a single stage. Vertex and face counts are those going into and coming out of
+// the stage, e.g. welding takes in the vertices of the file and outputs the welded vertices
+struct SImportStageStats
+{
+	TFloat64 fTime; // Seconds
+	TUInt32  iCalls;
+	TUInt64  iVerticesIn;
+	TUInt64  iVerticesOut;
+	TUInt64  iFacesIn;
+	TUInt64  iFacesOut;
+};
+
+
+// Statistics are added to by each import that uses them (see CImportXFile::SetImportStats), so
+// a single object can collect a whole scene load, or objects from separate imports can be added
+// together. Not thread-safe, use a separate object for imports on each thread
+class CImportStats
+{
+	GEN_CLASS( CImportStats )
+
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+public:
+	// Constructor - all statistics start at zero
+	CImportStats()
+	{
+		Clear();
+	}
+
+
+/*-----------------------------------------------------------------------------------------
+	Public interface
+-----------------------------------------------------------------------------------------*/
+public:
+
+	/////////////////////////////////////
+	// Collection
+
+	// Reset all statistics to zero. Must not be called while a stage is being timed
+	void Clear();
+
+	// Add another set of statistics to this one. Times and counts are summed, peak memory is the
+	// larger of the two
+	void Add( const CImportStats& stats );
+
+	// Start timing the given stage, pausing the current stage if there is one. Returns the stage
+	// that was paused (or -1) to pass to EndStage. Use CImportStageTimer rather than calling
+	// these directly
+	TInt32 BeginStage( const EImportStage eStage );
+
+	// Finish timing the current stage and resume the given one (as returned by BeginStage)
+	void EndStage( const TInt32 iResumeStage );
+
+	// Add to the vertices and faces going into and out of a stage
+	void AddCounts
+	(
+		const EImportStage eStage,
+		const TUInt64      iVerticesIn,
+		const TUInt64      iVerticesOut,
+		const TUInt64      iFacesIn,
+		const TUInt64      iFacesOut
+	);
+
+	// Count a file loaded and the number of bytes read from it
+	void AddFile( const TUInt64 iBytesRead );
+
+	// Count allocations made for mesh data, and the amount of mesh data currently held. The
+	// peak of the amounts reported is kept
+	void AddAllocations( const TUInt64 iAllocations )
+	{
+		m_iAllocations += iAllocations;
+	}
+	void RecordMemory( const TUInt64 iBytes )
+	{
+		m_iPeakBytes = (iBytes > m_iPeakBytes) ? iBytes : m_iPeakBytes;
+	}
+
+
+	/////////////////////////////////////
+	// Data access
+
+	// Get the statistics for a single stage
+	const SImportStageStats& GetStage( const EImportStage eStage ) const
+	{
+		return m_aStages[eStage];
+	}
+
+	// Get the name of a stage as used in the JSON and CSV output
+	static const char* GetStageName( const EImportStage eStage );
+
+	// Total time of all stages (seconds)
+	TFloat64 GetTotalTime() const;
+
+	// Get the file, byte, allocation and peak memory counts
+	TUInt32 GetNumFiles() const
+	{
+		return m_iNumFiles;
+	}
+	TUInt64 GetBytesRead() const
+	{
+		return m_iBytesRead;
+	}
+	TUInt64 GetAllocations() const
+	{
+		return m_iAllocations;
+	}
+	TUInt64 GetPeakBytes() const
+	{
+		return m_iPeakBytes;
+	}
+
+
+	/////////////////////////////////////
+	// Output
+
+	// Get the statistics as a JSON object, with an entry for each stage. Times are in milliseconds
+	string GetJSON() const;
+
+	// Get the statistics as a single CSV line, starting with the given label (e.g. a build or
+	// scene name) then the totals and a time, call and count column for each stage. Lines from
+	// different runs can be collected in one file to track the statistics over time
+	string GetCSV( const string& sLabel ) const;
+
+	// Get the CSV header line matching the lines above
+	static string GetCSVHeader();
+
+	// Save the statistics as JSON, replacing any existing file. Returns false on failure
+	bool SaveJSONFile( const string& sFileName ) const;
+
+	// Append a line of statistics to a CSV file, writing the header first if the file is new.
+	// Returns false on failure
+	bool AppendCSVFile
+	(
+		const string& sFileName,
+		const string& sLabel
+	) const;
+
+
+/*-----------------------------------------------------------------------------------------
+	Data
+-----------------------------------------------------------------------------------------*/
+private:
+
+	typedef chrono::steady_clock TClock;
+
+	SImportStageStats  m_aStages[kNumImportStages];
+
+	TUInt32            m_iNumFiles;
+	TUInt64            m_iBytesRead;
+	TUInt64            m_iAllocations;
+	TUInt64            m_iPeakBytes;
+
+	// Stage being timed (-1 if none) and the time it was started or resumed
+	TInt32             m_iCurrStage;
+	TClock::time_point m_StageStart;
+};
+
+
+// Times a stage of an import for the lifetime of the object. Stages can be nested, the outer
+// stage is paused while the inner one runs. Does nothing if given null statistics
+class CImportStageTimer
+{
+	GEN_CLASS( CImportStageTimer )
+
+public:
+	CImportStageTimer
+	(
+		CImportStats*      pStats,
+		const EImportStage eStage
+	)
+	{
+		m_pStats = pStats;
+		m_iResumeStage = m_pStats ? m_pStats->BeginStage( eStage ) : -1;
+	}
+
+	~CImportStageTimer()
+	{
+		if (m_pStats)
+		{
+			m_pStats->EndStage( m_iResumeStage );
+		}
+	}
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CImportStageTimer( const CImportStageTimer& );
+	CImportStageTimer& operator=( const CImportStageTimer& );
+
+	CImportStats* m_pStats;
+	TInt32        m_iResumeStage;
+};
+
+
+} // namespace gen
+
+#endif // GEN_C_IMPORT_STATS_H_INCLUDED
@@ -13,15 +13,17 @@
 
 #include <algorithm>
 #include <numeric>
+#include <cstring>
+#include <cmath>
 using namespace std;
 
-#define INITGUID
-#include <windows.h>
-#include <dxfile.h>
-#include <rmxfguid.h>
-#include <rmxftmpl.h>
-
 #include "CImportXFile.h"
+#include "CXFileTextReader.h"
+#include "CXFileBinaryReader.h"
+#include "XFileCompression.h"
+#include "CMappedFile.h"
+#include "CThreadPool.h"
+#include "MeshTangents.h"
 
 namespace gen
 {
@@ -70,10 +72,11 @@ bool CImportXFile::IsXFile
 //		kFileError:			Missing file or not an X-file
 //		kInvalidData:		The file could not be parsed correctly, or contains invalid data
 //		kOutOfSystemMemory:	...
-//		kSystemFailure:		X-file API failure
 EImportError CImportXFile::ImportFile
 (
-	const string& sFileName
+	const string&    sFileName,
+	CImportCallback* pCallback /*= 0*/,
+	bool             bTangents /*= false*/
 )
 {
 	GEN_GUARD;
@@ -81,49 +84,137 @@ EImportError CImportXFile::ImportFile
 	// Wipe any existing data
 	m_Frames.clear();
 	m_Meshes.clear();
+	m_SubMeshArena.Reset();
+	m_Materials.clear();
+	m_MaterialIds.clear();
+	m_MaterialIndices.clear();
+	m_NamedMaterials.clear();
+	m_LazyFile.Close();
+	m_LazyData.clear();
+	m_LazyMeshes.clear();
+	m_SubMeshLazyMeshes.clear();
+	m_iNumLazyMeshesLeft = 0;
 	m_bImported = false;
+	m_iNumFileVertices = 0;
+	m_iNumWeldedVertices = 0;
+
+	// Meshes are passed to the callback as they are parsed if streaming
+	m_pCallback = pCallback;
+	m_bCallbackTangents = bTangents;
+	m_iNumReportedMaterials = 0;
+
+	// Map the file and ensure it is an X-file. For a lazy import the file is kept mapped so
+	// meshes can be read later
+	CMappedFile localFile;
+	vector<TUInt8> localData;
+	bool bLazy = m_bLazyImport && !m_pCallback;
+	CMappedFile& xFile = bLazy ? m_LazyFile : localFile;
+	const TUInt8* pData;
+	TUInt32 iSize;
+	EImportError eError = kSuccess;
+	{
+		CImportStageTimer readTimer( m_pStats, kStageRead );
+		if (!xFile.Open( sFileName ) || xFile.GetSize() < 4 || memcmp( xFile.GetData(), "xof ", 4 ) != 0)
+		{
+			xFile.Close();
+			m_pCallback = 0;
+			return kFileError;
+		}
+		if (m_pStats)
+		{
+			m_pStats->AddFile( xFile.GetSize() );
+		}
 
-	// Ensure the file is an X-file
-	if (!IsXFile( sFileName ))
-	{
-		return kFileError;
+		// Compressed files are decompressed to memory, then read as the equivalent uncompressed
+		// file
+		pData = xFile.GetData();
+		iSize = xFile.GetSize();
+		if (IsCompressedXFile( pData, iSize ))
+		{
+			vector<TUInt8>& xFileData = bLazy ? m_LazyData : localData;
+			if (DecompressXFile( pData, iSize, &xFileData ))
+			{
+				pData = &xFileData[0];
+				iSize = static_cast<TUInt32>(xFileData.size());
+			}
+			else
+			{
+				eError = kInvalidData;
+			}
+		}
 	}
 
-	// Create X-File object
-	ID3DXFile* pXFile;
-	EImportError eError = PrepareXFileObject( &pXFile );
 	if (eError != kSuccess)
 	{
-		return eError;
+		xFile.Close();
 	}
-
-	// Get X-File enumerator
-	ID3DXFileEnumObject* pXFileEnumer;
-	eError = GetXFileEnumerator( sFileName, pXFile, &pXFileEnumer );
-	if (eError != kSuccess)
+	else if (CXFileTextReader::IsTextXFile( pData, iSize ) || CXFileBinaryReader::IsBinaryXFile( pData, iSize ))
 	{
-		pXFile->Release();
-		return eError;
+		// Text and binary X-files are parsed natively in a single pass over the file data, or
+		// scanned for a lazy import (see ParseXFile)
+		CImportStageTimer parseTimer( m_pStats, kStageParse );
+		CXFileTextReader textReader( pData, iSize );
+		CXFileBinaryReader binaryReader( pData, iSize );
+		eError = ParseXFile( CXFileBinaryReader::IsBinaryXFile( pData, iSize ) ?
+		                     static_cast<CXFileReader&>(binaryReader) : textReader );
+		if (!m_LazyFile.IsOpen())
+		{
+			m_NamedMaterials.clear();
+		}
 	}
+	else
+	{
+		// Not a text or binary X-file, or an encoding that is not supported
+		xFile.Close();
+		eError = kInvalidData;
+	}
+
+	// Split into meshes containing only one material each. A lazy import has already created
+	// the sub-meshes, their data is split as each mesh is read
+	if (eError == kSuccess && !m_LazyFile.IsOpen())
+	{
+		RecordMeshMemory();
+		SplitMeshes();
 
-	// Parse X file to create frame hierachy and meshes
-	eError = ParseXFile( pXFileEnumer );
+		// When streaming, pass the meshes that were held until the end of the file (skinned meshes)
+		// and the root frame to the callback
+		if (m_pCallback)
+		{
+			eError = StreamSubMeshes( 0 );
+			if (eError == kSuccess)
+			{
+				FinishFrame( 0 );
+			}
+		}
+	}
+	m_pCallback = 0;
+	m_MaterialIndices.clear();
 
-	// Release X-File interfaces
-	pXFileEnumer->Release();
-	pXFile->Release();
+	// Release the file now if a lazy import found no meshes to read later
+	if (m_iNumLazyMeshesLeft == 0)
+	{
+		m_LazyFile.Close();
+		vector<TUInt8>().swap( m_LazyData );
+		m_NamedMaterials.clear();
+	}
 
 	// Check for errors
 	if (eError != kSuccess)
 	{
 		m_Frames.clear();
 		m_Meshes.clear();
+		m_SubMeshArena.Reset();
+		m_Materials.clear();
+		m_MaterialIds.clear();
+		m_NamedMaterials.clear();
+		m_LazyFile.Close();
+		vector<TUInt8>().swap( m_LazyData );
+		m_LazyMeshes.clear();
+		m_SubMeshLazyMeshes.clear();
+		m_iNumLazyMeshesLeft = 0;
 		return eError;
 	}
 
-	// Split into meshes containing only one material each
-	SplitMeshes();
-
 	// Mark file as loaded
 	m_bImported = true;
 
@@ -151,6 +242,7 @@ void CImportXFile::GetNode
 	pOutNode->numChildren = m_Frames[iNode].iNumChildren;
 	pOutNode->positionMatrix = m_Frames[iNode].defaultMatrix;
 	pOutNode->invMeshOffset = m_Frames[iNode].offsetMatrix;
+	pOutNode->bounds = m_Frames[iNode].meshBounds;
 
 	GEN_ENDGUARD;
 }
@@ -163,112 +255,161 @@ ERenderMethod CImportXFile::GetSubMeshRenderMethod( const TUInt32 iSubMesh ) con
 }
 
 
-// Get the specification and data for given sub-mesh, returned through a pointer. May request
-// tangents to be calculated
+// Get the bounding box of the given sub-mesh, returned through pointers. This is the box around
+// the whole file mesh that the sub-mesh was split from, so it may be larger than the sub-mesh
+void CImportXFile::GetSubMeshBounds
+(
+	const TUInt32 iSubMesh,
+	CVector3*     pMinBounds,
+	CVector3*     pMaxBounds
+) const
+{
+	*pMinBounds = m_Meshes[iSubMesh].minBounds;
+	*pMaxBounds = m_Meshes[iSubMesh].maxBounds;
+}
+
+
+// Read and process the geometry of the file mesh that the given sub-mesh was split from, if not
+// already done (lazy import only)
 // Possible return values:
 //		kSuccess:			...
-//		kOutOfSystemMemory:	...
-EImportError CImportXFile::GetSubMesh
+//		kInvalidData:		The mesh could not be parsed correctly, or contains invalid data
+EImportError CImportXFile::LoadSubMesh( const TUInt32 iSubMesh )
+{
+	GEN_GUARD;
+
+	if (m_SubMeshLazyMeshes.empty())
+	{
+		return kSuccess;
+	}
+
+	TUInt32 iLazyMesh = m_SubMeshLazyMeshes[iSubMesh];
+	if (!m_LazyMeshes[iLazyMesh].bLoaded)
+	{
+		LoadLazyMesh( iLazyMesh );
+	}
+	return m_LazyMeshes[iLazyMesh].eLoadError;
+
+	GEN_ENDGUARD;
+}
+
+
+// Get the specification of given sub-mesh without its data, returned through a pointer. The
+// vertex and face pointers are set to 0. May request tangents to be included in the vertices
+void CImportXFile::GetSubMeshLayout
 (
 	const TUInt32 iSubMesh,
 	SSubMesh*     pOutSubMesh,
 	bool          bTangents /*= false*/
-) const
+)
 {
 	GEN_GUARD;
 
-	// Set sub-mesh owner node
-	pOutSubMesh->node = m_Meshes[iSubMesh].iParentFrame;
+	// Read the mesh if necessary. If it can't be read the sub-mesh stays empty
+	LoadSubMesh( iSubMesh );
+	const SXFileMesh& mesh = m_Meshes[iSubMesh];
 
-	// Calculate tangents if required
-	TXFileVectors tangents;
-	pOutSubMesh->hasTangents = bTangents;
-	if (pOutSubMesh->hasTangents)
-	{
-		CalculateTangents( iSubMesh, &tangents );
-	}
+	// Set sub-mesh owner node and material (all faces in sub-mesh have the same material at
+	// this point)
+	pOutSubMesh->node = mesh.iParentFrame;
+	pOutSubMesh->material = mesh.materialMap.front();
 
 	// Find what vertex data there is and calculate total vertex size
-	pOutSubMesh->hasSkinningData = (m_Meshes[iSubMesh].bones.size() > 0);
-	pOutSubMesh->hasNormals = (m_Meshes[iSubMesh].normals.size() > 0);
-	pOutSubMesh->hasTextureCoords = (m_Meshes[iSubMesh].textureCoords.size() > 0);
-	pOutSubMesh->hasVertexColours = (m_Meshes[iSubMesh].vertexColours.size() > 0);
+	pOutSubMesh->hasSkinningData = (mesh.bones.size() > 0);
+	pOutSubMesh->hasNormals = (mesh.normals.size() > 0);
+	pOutSubMesh->hasTangents = bTangents;
+	pOutSubMesh->hasTextureCoords = (mesh.textureCoords.size() > 0);
+	pOutSubMesh->hasVertexColours = (mesh.vertexColours.size() > 0);
 	pOutSubMesh->vertexSize = sizeof(CVector3) + 
 							  (pOutSubMesh->hasSkinningData ? 4 * sizeof(TFloat32) + sizeof(TUInt32) : 0) +
 	                          (pOutSubMesh->hasNormals ? sizeof(CVector3) : 0) +
-	                          (pOutSubMesh->hasTangents ? sizeof(CVector3) : 0) +
+	                          (pOutSubMesh->hasTangents ? sizeof(CVector4) : 0) +
 	                          (pOutSubMesh->hasTextureCoords ? sizeof(SXFileUV) : 0) +
 	                          (pOutSubMesh->hasVertexColours ? sizeof(SXFileRGBAColour) : 0);
 	                          // Skinning data: assuming 4 float weights / 4 byte indices in TUInt32
 
-	// Set number of vertices and reserve space for vertex data
-	pOutSubMesh->numVertices = static_cast<TUInt32>(m_Meshes[iSubMesh].vertices.size());
-	pOutSubMesh->vertices = new TUInt8[pOutSubMesh->numVertices * pOutSubMesh->vertexSize];
-	if (!pOutSubMesh->vertices)
+	// Set number of vertices and faces, data is not fetched here
+	pOutSubMesh->numVertices = static_cast<TUInt32>(mesh.vertices.size());
+	pOutSubMesh->vertices = 0;
+	pOutSubMesh->numFaces = static_cast<TUInt32>(mesh.faces.size());
+	pOutSubMesh->indexSize = GetIndexSize( pOutSubMesh->numVertices );
+	pOutSubMesh->faces = 0;
+	pOutSubMesh->bounds = mesh.bounds;
+
+	GEN_ENDGUARD;
+}
+
+
+// Write the vertex and face data for given sub-mesh into memory supplied by the caller, e.g. a
+// mapped vertex buffer. The sub-mesh must have been filled in by GetSubMeshLayout, then its
+// vertex and face pointers set to space for numVertices * vertexSize bytes and numFaces faces
+// (numFaces * 3 * indexSize bytes)
+// Possible return values:
+//		kSuccess:			...
+//		kOutOfSystemMemory:	...
+EImportError CImportXFile::GetSubMeshData
+(
+	const TUInt32   iSubMesh,
+	const SSubMesh& subMesh
+)
+{
+	GEN_GUARD;
+
+	// Read the mesh if necessary (already done if the layout was fetched)
+	EImportError eError = LoadSubMesh( iSubMesh );
+	if (eError != kSuccess)
 	{
-		return kOutOfSystemMemory;
+		return eError;
+	}
+	const SXFileMesh& mesh = m_Meshes[iSubMesh];
+	CImportStageTimer vertexDataTimer( m_pStats, kStageVertexData );
+	if (m_pStats)
+	{
+		m_pStats->AddCounts( kStageVertexData, mesh.vertices.size(), subMesh.numVertices,
+		                     mesh.faces.size(), subMesh.numFaces );
 	}
 
-	// Prefetch relevant vertex list info
-	TXFileVectors::const_iterator itVertex = m_Meshes[iSubMesh].vertices.begin();
-	TXFileVectors::const_iterator itVertexEnd = m_Meshes[iSubMesh].vertices.end();
-	TXFileVectors::const_iterator itNormal = m_Meshes[iSubMesh].normals.begin();
-	TXFileVectors::const_iterator itTangent = tangents.begin();
-	TXFileUVs::const_iterator itTextureCooord = m_Meshes[iSubMesh].textureCoords.begin();
-	TXFileRGBAColours::const_iterator itVertexColour = m_Meshes[iSubMesh].vertexColours.begin();
-
-	// Loop through vertices, add each component present to the raw output stream
-	TUInt8* pVertexData = pOutSubMesh->vertices;
-	while (itVertex != itVertexEnd)
+	// Calculate tangents if required
+	TXFileTangents tangents;
+	if (subMesh.hasTangents)
 	{
-		*reinterpret_cast<CVector3*>(pVertexData) = *itVertex++;
-		pVertexData += sizeof(CVector3);
-		if (pOutSubMesh->hasSkinningData)
-		{
-			// Initialise vertex with no influencing bones
-			*reinterpret_cast<TFloat32*>(pVertexData) = 0.0f;
-			pVertexData += sizeof(TFloat32);
-			*reinterpret_cast<TFloat32*>(pVertexData) = 0.0f;
-			pVertexData += sizeof(TFloat32);
-			*reinterpret_cast<TFloat32*>(pVertexData) = 0.0f;
-			pVertexData += sizeof(TFloat32);
-			*reinterpret_cast<TFloat32*>(pVertexData) = 0.0f;
-			pVertexData += sizeof(TFloat32);
-			*reinterpret_cast<TUInt32*>(pVertexData) = 0;
-			pVertexData += sizeof(TUInt32);
-		}
-		if (pOutSubMesh->hasNormals)
-		{
-			*reinterpret_cast<CVector3*>(pVertexData) = *itNormal++;
-			pVertexData += sizeof(CVector3);
-		}
-		if (pOutSubMesh->hasTangents)
-		{
-			*reinterpret_cast<CVector3*>(pVertexData) = *itTangent++;
-			pVertexData += sizeof(CVector3);
-		}
-		if (pOutSubMesh->hasTextureCoords)
-		{
-			*reinterpret_cast<SXFileUV*>(pVertexData) = *itTextureCooord++;
-			pVertexData += sizeof(SXFileUV);
-		}
-		if (pOutSubMesh->hasVertexColours)
-		{
-			*reinterpret_cast<SXFileRGBAColour*>(pVertexData) = *itVertexColour++;
-			pVertexData += sizeof(SXFileRGBAColour);
-		}
+		CalculateTangents( iSubMesh, &tangents );
 	}
 
+	// Select the vertex writer for this combination of components once, rather than testing for
+	// each component on every vertex. Table is indexed by the component flags below
+	typedef void (*TInterleaveFn)( const SXFileMesh&, const TXFileTangents&, TUInt8* );
+	#define GEN_INTERLEAVE_FN(i) &InterleaveVertices<(i & 1) != 0, (i & 2) != 0, (i & 4) != 0, \
+	                                                 (i & 8) != 0, (i & 16) != 0>
+	static const TInterleaveFn apInterleaveFns[32] =
+	{
+		GEN_INTERLEAVE_FN(0),  GEN_INTERLEAVE_FN(1),  GEN_INTERLEAVE_FN(2),  GEN_INTERLEAVE_FN(3),
+		GEN_INTERLEAVE_FN(4),  GEN_INTERLEAVE_FN(5),  GEN_INTERLEAVE_FN(6),  GEN_INTERLEAVE_FN(7),
+		GEN_INTERLEAVE_FN(8),  GEN_INTERLEAVE_FN(9),  GEN_INTERLEAVE_FN(10), GEN_INTERLEAVE_FN(11),
+		GEN_INTERLEAVE_FN(12), GEN_INTERLEAVE_FN(13), GEN_INTERLEAVE_FN(14), GEN_INTERLEAVE_FN(15),
+		GEN_INTERLEAVE_FN(16), GEN_INTERLEAVE_FN(17), GEN_INTERLEAVE_FN(18), GEN_INTERLEAVE_FN(19),
+		GEN_INTERLEAVE_FN(20), GEN_INTERLEAVE_FN(21), GEN_INTERLEAVE_FN(22), GEN_INTERLEAVE_FN(23),
+		GEN_INTERLEAVE_FN(24), GEN_INTERLEAVE_FN(25), GEN_INTERLEAVE_FN(26), GEN_INTERLEAVE_FN(27),
+		GEN_INTERLEAVE_FN(28), GEN_INTERLEAVE_FN(29), GEN_INTERLEAVE_FN(30), GEN_INTERLEAVE_FN(31),
+	};
+	#undef GEN_INTERLEAVE_FN
+	TUInt32 iComponents = (subMesh.hasSkinningData  ? 1 : 0) |
+	                      (subMesh.hasNormals       ? 2 : 0) |
+	                      (subMesh.hasTangents      ? 4 : 0) |
+	                      (subMesh.hasTextureCoords ? 8 : 0) |
+	                      (subMesh.hasVertexColours ? 16 : 0);
+	apInterleaveFns[iComponents]( mesh, tangents, subMesh.vertices );
+
 	// Calculate bone influences if necessary
-	if (pOutSubMesh->hasSkinningData)
+	if (subMesh.hasSkinningData)
 	{
 		// Offsets to bone data in a vertex (data is immediately after vertex coord)
 		TUInt32 boneWeightsOffset = sizeof(CVector3);
 		int boneIndicesOffset = boneWeightsOffset + 4 * sizeof(TFloat32);
 
 		// For each bone...
-		TXFileBones::const_iterator itBone = m_Meshes[iSubMesh].bones.begin();
-		TXFileBones::const_iterator itBoneEnd = m_Meshes[iSubMesh].bones.end();
+		TXFileBones::const_iterator itBone = mesh.bones.begin();
+		TXFileBones::const_iterator itBoneEnd = mesh.bones.end();
 		while (itBone != itBoneEnd)
 		{
 			// For each bone weight (influence)...
@@ -277,8 +418,7 @@ EImportError CImportXFile::GetSubMesh
 			while (itBoneWeight != itBoneWeightEnd)
 			{
 				// Find affected vertex data - weights and bone indexes
-				TUInt8* pVert = pOutSubMesh->vertices + 
-					itBoneWeight->iVertexIndex * pOutSubMesh->vertexSize;
+				TUInt8* pVert = subMesh.vertices + itBoneWeight->iVertexIndex * subMesh.vertexSize;
 				TFloat32* pVertBoneWeights = reinterpret_cast<TFloat32*>(pVert + boneWeightsOffset);
 				TUInt8* pVertBoneIndices = reinterpret_cast<TUInt8*>(pVert + boneIndicesOffset);
 
@@ -291,8 +431,8 @@ EImportError CImportXFile::GetSubMesh
 		}
 
 		// Normalise vertex bone weights (ensure they add up to 1)
-		TUInt8* pVert = pOutSubMesh->vertices;
-		for (TUInt32 vert = 0; vert < pOutSubMesh->vertexSize; ++vert)
+		TUInt8* pVert = subMesh.vertices;
+		for (TUInt32 vert = 0; vert < subMesh.numVertices; ++vert)
 		{
 			TFloat32* pVertBoneWeights = reinterpret_cast<TFloat32*>(pVert + boneWeightsOffset);
 			TUInt8* pVertBoneIndices = reinterpret_cast<TUInt8*>(pVert + boneIndicesOffset);
@@ -303,7 +443,7 @@ EImportError CImportXFile::GetSubMesh
 			{
 				// Vertex with no weights - reference root bone only (model is probably not skinned)
 				pVertBoneWeights[0] = 1.0f;
-				pVertBoneIndices[0] = pOutSubMesh->node;
+				pVertBoneIndices[0] = subMesh.node;
 			}
 			else
 			{
@@ -312,34 +452,126 @@ EImportError CImportXFile::GetSubMesh
 				pVertBoneWeights[2] /= sum;
 				pVertBoneWeights[3] /= sum;
 			}
-			pVert += pOutSubMesh->vertexSize;
+			pVert += subMesh.vertexSize;
+		}
+	}
+
+	// Output faces to given sub-mesh, using 16-bit indices unless there are too many vertices
+	const SXFileFace* pFace = mesh.faces.empty() ? 0 : &mesh.faces[0];
+	if (subMesh.indexSize == sizeof(TUInt32))
+	{
+		memcpy( subMesh.faces, pFace, subMesh.numFaces * sizeof(SMeshFace32) );
+	}
+	else
+	{
+		SMeshFace* pOutFace = reinterpret_cast<SMeshFace*>(subMesh.faces);
+		for (TUInt32 iFace = 0; iFace < subMesh.numFaces; ++iFace)
+		{
+			pOutFace[iFace].aiVertex[0] = static_cast<TUInt16>(pFace->aiVertex[0]);
+			pOutFace[iFace].aiVertex[1] = static_cast<TUInt16>(pFace->aiVertex[1]);
+			pOutFace[iFace].aiVertex[2] = static_cast<TUInt16>(pFace->aiVertex[2]);
+			++pFace;
 		}
 	}
 
-	// Pre-size face array
-	pOutSubMesh->numFaces = static_cast<TUInt32>(m_Meshes[iSubMesh].faces.size());
-	pOutSubMesh->faces = new SMeshFace[pOutSubMesh->numFaces];
+	return kSuccess;
+
+	GEN_ENDGUARD;
+}
+
 
-	// Get material from material map (all faces in sub-mesh have the same material at this point)
-	pOutSubMesh->material = m_Meshes[iSubMesh].materialMap.front();
+// Get the specification and data for given sub-mesh, returned through a pointer to an object
+// that owns the data. May request tangents to be calculated
+// Possible return values:
+//		kSuccess:			...
+//		kOutOfSystemMemory:	...
+EImportError CImportXFile::GetSubMesh
+(
+	const TUInt32 iSubMesh,
+	CSubMeshData* pOutSubMesh,
+	bool          bTangents /*= false*/
+)
+{
+	GEN_GUARD;
 
-	// Loop through faces outputing to given sub-mesh
-	TXFileFaces::const_iterator itFace = m_Meshes[iSubMesh].faces.begin();
-	TXFileFaces::const_iterator itFaceEnd = m_Meshes[iSubMesh].faces.end();
-	for (TUInt32 iFace = 0; iFace < pOutSubMesh->numFaces; ++iFace)
+	EImportError eError = LoadSubMesh( iSubMesh );
+	if (eError != kSuccess)
 	{
-		pOutSubMesh->faces[iFace].aiVertex[0] = itFace->aiVertex[0];
-		pOutSubMesh->faces[iFace].aiVertex[1] = itFace->aiVertex[1];
-		pOutSubMesh->faces[iFace].aiVertex[2] = itFace->aiVertex[2];
-		++itFace;
+		return eError;
 	}
 
-	return kSuccess;
+	SSubMesh layout;
+	GetSubMeshLayout( iSubMesh, &layout, bTangents );
+	if (!pOutSubMesh->Allocate( layout ))
+	{
+		pOutSubMesh->Free();
+		return kOutOfSystemMemory;
+	}
+	return GetSubMeshData( iSubMesh, pOutSubMesh->Get() );
 
 	GEN_ENDGUARD;
 }
 
 
+// Write the vertices of the given mesh to a raw vertex stream. There is an instantiation for
+// each combination of vertex components so there are no tests in the per-vertex loop
+template <bool kbSkinning, bool kbNormals, bool kbTangents, bool kbUVs, bool kbColours>
+void CImportXFile::InterleaveVertices
+(
+	const SXFileMesh&     mesh,
+	const TXFileTangents& tangents,
+	TUInt8*               pVertices
+)
+{
+	// Use raw pointers to the source lists, only those for components present are used. Copies
+	// use memcpy as the destination may not be aligned (e.g. vertex size not a multiple of 4)
+	const TUInt32 iNumVertices = static_cast<TUInt32>(mesh.vertices.size());
+	if (iNumVertices == 0)
+	{
+		return;
+	}
+	const CVector3*         pVertex = &mesh.vertices[0];
+	const CVector3*         pNormal = kbNormals ? &mesh.normals[0] : 0;
+	const CVector4*         pTangent = kbTangents ? &tangents[0] : 0;
+	const SXFileUV*         pTextureCoord = kbUVs ? &mesh.textureCoords[0] : 0;
+	const SXFileRGBAColour* pVertexColour = kbColours ? &mesh.vertexColours[0] : 0;
+
+	// Initialise vertex with no influencing bones
+	static const TUInt8 aiNoBones[4 * sizeof(TFloat32) + sizeof(TUInt32)] = { 0 };
+
+	for (TUInt32 iVertex = 0; iVertex < iNumVertices; ++iVertex)
+	{
+		memcpy( pVertices, pVertex++, sizeof(CVector3) );
+		pVertices += sizeof(CVector3);
+		if (kbSkinning)
+		{
+			memcpy( pVertices, aiNoBones, sizeof(aiNoBones) );
+			pVertices += sizeof(aiNoBones);
+		}
+		if (kbNormals)
+		{
+			memcpy( pVertices, pNormal++, sizeof(CVector3) );
+			pVertices += sizeof(CVector3);
+		}
+		if (kbTangents)
+		{
+			memcpy( pVertices, pTangent++, sizeof(CVector4) );
+			pVertices += sizeof(CVector4);
+		}
+		if (kbUVs)
+		{
+			memcpy( pVertices, pTextureCoord++, sizeof(SXFileUV) );
+			pVertices += sizeof(SXFileUV);
+		}
+		if (kbColours)
+		{
+			memcpy( pVertices, pVertexColour++, sizeof(SXFileRGBAColour) );
+			pVertices += sizeof(SXFileRGBAColour);
+		}
+	}
+}
+
+
 // Get the render method used for the given material, optionaly return the number of textures
 // used by the method. The render method of a material specifies how to draw geometry with this
 // material. Can use the X-file material or texture names to select the appropriate method,
@@ -349,12 +581,36 @@ ERenderMethod CImportXFile::GetMaterialRenderMethod
 	const TUInt32 iMaterial,
 	TUInt32*      pNumTextures /*= 0*/
 ) const
+{
+	return GetRenderMethod( m_Materials[iMaterial], pNumTextures );
+}
+
+// Get specification of a given material, returned through a pointer
+// The render method of a material specifies how to draw geometry with this material. It is
+// selected with the function GetMaterialRenderMethod
+void CImportXFile::GetMaterial
+(
+	const TUInt32        iMaterial,
+	SMeshMaterial* const pOutMaterial
+) const
+{
+	ConvertMaterial( m_Materials[iMaterial], pOutMaterial );
+}
+
+
+// Get the render method used for an X-file material, optionally return the number of textures
+// used by the method (see GetMaterialRenderMethod)
+ERenderMethod CImportXFile::GetRenderMethod
+(
+	const SXFileMaterial& xFileMaterial,
+	TUInt32*              pNumTextures /*= 0*/
+)
 {
 	// Set up default rendering method - taking note of whether a texture is present
-	if (m_Materials[iMaterial].sTextureName == "")
+	if (xFileMaterial.sTextureName == "")
 	{
 		if (pNumTextures) *pNumTextures = 0;
-		if (m_Materials[iMaterial].sName.find( "Plain" ) != string::npos )
+		if (xFileMaterial.sName.find( "Plain" ) != string::npos )
 		{
 			return PlainColour;
 		}
@@ -366,7 +622,7 @@ ERenderMethod CImportXFile::GetMaterialRenderMethod
 	else
 	{
 		if (pNumTextures) *pNumTextures = 1;
-		if (m_Materials[iMaterial].sName.find( "Plain" ) != string::npos )
+		if (xFileMaterial.sName.find( "Plain" ) != string::npos )
 		{
 			return PlainTexture;
 		}
@@ -377,20 +633,14 @@ ERenderMethod CImportXFile::GetMaterialRenderMethod
 	}
 }
 
-// Get specification of a given material, returned through a pointer
-// The render method of a material specifies how to draw geometry with this material. It is
-// selected with the function GetMaterialRenderMethod
-void CImportXFile::GetMaterial
+// Convert an X-file material to the material specification returned by GetMaterial
+void CImportXFile::ConvertMaterial
 (
-	const TUInt32        iMaterial,
-	SMeshMaterial* const pOutMaterial
-) const
+	const SXFileMaterial& xFileMaterial,
+	SMeshMaterial* const  pOutMaterial
+)
 {
 	GEN_GUARD;
-	
-
-	// Unclutter code with a reference to the material 
-	const SXFileMaterial& xFileMaterial = m_Materials[iMaterial];
 
 	// Set constant colours
 	pOutMaterial->diffuseColour.r = xFileMaterial.faceColour.fRed;
@@ -413,7 +663,7 @@ void CImportXFile::GetMaterial
 		pOutMaterial->numTextures = 1;
 		pOutMaterial->textureFileNames[0] = xFileMaterial.sTextureName;
 	}
-	pOutMaterial->renderMethod = GetMaterialRenderMethod( iMaterial, &pOutMaterial->numTextures );
+	pOutMaterial->renderMethod = GetRenderMethod( xFileMaterial, &pOutMaterial->numTextures );
 	if (pOutMaterial->numTextures > 0)
 	{
 		pOutMaterial->textureFileNames[0] = xFileMaterial.sTextureName;
@@ -429,138 +679,17 @@ void CImportXFile::GetMaterial
 
 
 /*-----------------------------------------------------------------------------------------
-	X-File API support
------------------------------------------------------------------------------------------*/
-
-// Prepare and return an X-file object
-// Possible return values:
-//		kSuccess:			...
-//		kOutOfSystemMemory:	...
-//		kSystemFailure:		Problem registering X-file templates or other API error
-EImportError CImportXFile::PrepareXFileObject
-(
-	ID3DXFile** ppXFile
-)
-{
-	GEN_GUARD;
-
-	HRESULT xFileError = D3DXFileCreate( ppXFile );
-	if (xFileError != S_OK)
-	{
-		*ppXFile = 0;
-		switch (xFileError)
-		{
-		case E_OUTOFMEMORY:
-			return kOutOfSystemMemory;
-
-		case E_POINTER:
-			GEN_ERROR( "Invalid parameter to D3DXFileCreate" );
-
-		default:
-			return kSystemFailure;
-		}
-	}
-
-    // Register templates for d3drm, skinning and patch extensions.
-    xFileError = (*ppXFile)->RegisterTemplates( (void*)D3DRM_XTEMPLATES, D3DRM_XTEMPLATE_BYTES );
-	if (xFileError != S_OK)
-	{
-        (*ppXFile)->Release();
-		*ppXFile = 0;
-		switch (xFileError)
-		{
-		case D3DXFERR_BADVALUE: 
-			GEN_ERROR( "Invalid parameter to RegisterTemplates" );
-
-		default:
-			return kSystemFailure;
-		}
-    }
-
-    xFileError = (*ppXFile)->RegisterTemplates( (void*)XSKINEXP_TEMPLATES, strlen(XSKINEXP_TEMPLATES) );
-	if (xFileError != S_OK)
-	{
-        (*ppXFile)->Release();
-		switch (xFileError)
-		{
-		case D3DXFERR_BADVALUE:
-			GEN_ERROR( "Invalid parameter to RegisterTemplates" );
-
-		default:
-			return kSystemFailure;
-		}
-    }
-
-    xFileError = (*ppXFile)->RegisterTemplates( (void*)XEXTENSIONS_TEMPLATES, strlen(XEXTENSIONS_TEMPLATES) );
-	if (xFileError != S_OK)
-	{
-        (*ppXFile)->Release();
-		*ppXFile = 0;
-		switch (xFileError)
-		{
-		case D3DXFERR_BADVALUE:
-			GEN_ERROR( "Invalid parameter to RegisterTemplates" );
-
-		default:
-			return kInvalidData;
-		}
-    }
-
-	return kSuccess;
-
-	GEN_ENDGUARD;
-}
-
-
-// Prepare and return an X-file enumerator given a filename and an X-file object
-// Possible return values:
-//		kSuccess:			...
-//		kInvalidData:		The file could not be parsed correctly, or contains invalid data
-//		kSystemFailure:		X-file API error
-EImportError CImportXFile::GetXFileEnumerator
-(
-	const string&         sFilename,
-	ID3DXFile*            pXFile,
-	ID3DXFileEnumObject** ppXFileEnumer
-)
-{
-	GEN_GUARD;
-
-	HRESULT xFileError =
-		pXFile->CreateEnumObject( (LPVOID)sFilename.c_str(), DXFILELOAD_FROMFILE, ppXFileEnumer );
-	if (xFileError != S_OK)
-	{
-		switch (xFileError)
-		{
-		case D3DXFERR_PARSEERROR:
-			return kInvalidData;
-
-		case D3DXFERR_BADVALUE:
-			GEN_ERROR( "Invalid parameter to CreateEnumObject" );
-
-		default:
-			return kSystemFailure;
-		}
-	}
-
-	return kSuccess;
-
-	GEN_ENDGUARD;
-}
-
-
-/*-----------------------------------------------------------------------------------------
-	X-File parsing
+	Native X-File parsing
 -----------------------------------------------------------------------------------------*/
 
-// Create a single root frame and parse the X-File to add all the bottom level frames and
-// meshes. Any frames and meshes found will be children of this root frame, child frames are
-// recursively parsed to create a frame hierarchy
+// Parse a complete X-file. Creates a single root frame and adds all the top level frames
+// and meshes as children of it. Top-level materials are stored by name so meshes can reference
+// them
 // Possible return values:
 //		kInvalidData:		The file could not be parsed correctly, or contains invalid data
 EImportError CImportXFile::ParseXFile
 (
-	ID3DXFileEnumObject* pXFileEnumer
+	CXFileReader& reader
 )
 {
 	GEN_GUARD;
@@ -576,57 +705,64 @@ EImportError CImportXFile::ParseXFile
 	m_Frames[0].defaultMatrix = CMatrix4x4::kIdentity;
 	m_Frames[0].offsetMatrix = CMatrix4x4::kIdentity;
 
-	// Get number of child objects for the current object
-	TUInt32 iNumChildren;
-	EImportError eError = GetXFileNumChildren( pXFileEnumer, &iNumChildren );
-	if (eError != kSuccess)
+	// For each top level object
+	EImportError eError = kSuccess;
+	string sType, sName;
+	CXFileReader::EToken token;
+	while ((token = reader.PeekToken()) != CXFileReader::kTokenEnd)
 	{
-		return kInvalidData;
-	}
+		// Top-level references have no meaning here
+		if (token == CXFileReader::kTokenOpenBrace)
+		{
+			if (!reader.ReadReference( sName ))
+			{
+				return kInvalidData;
+			}
+			continue;
+		}
 
-	// For each child object
-	for (TUInt32 iChild = 0; iChild < iNumChildren; ++iChild)
-	{
-		// Get child data and ID
-		ID3DXFileData* pChildData;
-		GUID childGUID;
-		eError = GetXFileChild( pXFileEnumer, iChild, &pChildData, &childGUID );
-		if (eError != kSuccess)
+		if (!reader.ReadObjectHeader( sType, sName ))
 		{
 			return kInvalidData;
 		}
-		
+
 		// Found child frame
-		if (childGUID == TID_D3DRMFrame)
+		if (sType == "Frame")
 		{
 			++m_Frames[0].iNumChildren;
-			eError = ParseXFileFrame( pChildData, 0 );
+			eError = ParseXFileFrame( reader, sName, 0 );
 		}
 
 		// Found child frame transformation matrix
-		else if (childGUID == TID_D3DRMFrameTransformMatrix)
+		else if (sType == "FrameTransformMatrix")
+		{
+			eError = ReadFrameMatrix( reader, &m_Frames[0].defaultMatrix );
+		}
+
+		// Found child mesh, only scanned in a lazy import
+		else if (sType == "Mesh")
 		{
-			CMatrix4x4 transMat;
-			TUInt32 iSize = 16 * sizeof(TFloat32);
-			TUInt8* pDest = reinterpret_cast<TUInt8*>(&m_Frames[0].defaultMatrix.e00);
-			eError = CopyXFileData( pChildData, pDest, &iSize );
+			eError = m_LazyFile.IsOpen() ? ScanXFileMesh( reader, 0 ) : ParseXFileMesh( reader, 0 );
 		}
 
-		// Found child mesh
-		else if (childGUID == TID_D3DRMMesh)
+		// Found material that may be referenced by meshes
+		else if (sType == "Material")
 		{
-			eError = ParseXFileMesh( pChildData, 0 );
+			eError = ReadMaterial( reader, sName, &m_NamedMaterials[sName] );
 		}
 
-		// Release current child data before moving to the next or quiting on error
-		pChildData->Release();
+		// Templates, header and unknown data
+		else
+		{
+			eError = reader.SkipObject() ? kSuccess : kInvalidData;
+		}
 
 		// Return any errors found
 		if (eError != kSuccess)
 		{
 			return eError;
 		}
-	}		
+	}
 
 	// Make a single global material list for all meshes
 	MakeGlobalMaterialList();
@@ -643,16 +779,14 @@ EImportError CImportXFile::ParseXFile
 	GEN_ENDGUARD;
 }
 
-
-// Create a new frame and parse the X-File to add all the contained frames and meshes. Any
-// frames and meshes found will become children of this new frame. Child frames are recursively
-// parsed to create a frame hierarchy
+// Create a new frame and parse the X-File to add all the contained frames and meshes
 // Possible return values:
 //		kInvalidData:		The file could not be parsed correctly, or contains invalid data
 EImportError CImportXFile::ParseXFileFrame
 (
-	ID3DXFileData* pXFileData,
-	const TUInt32  iParentFrame
+	CXFileReader& reader,
+	const string& sName,
+	const TUInt32 iParentFrame
 )
 {
 	GEN_GUARD;
@@ -661,83 +795,93 @@ EImportError CImportXFile::ParseXFileFrame
 	TUInt32 iCurrFrame = static_cast<TUInt32>(m_Frames.size());
 	m_Frames.push_back( SXFileFrame() );
 
-	// Get name for frame
-	EImportError eError = GetXFileDataName( pXFileData, m_Frames[iCurrFrame].sName );
-	if (eError != kSuccess)
-	{
-		return eError;
-	}
-
-	// Initialise other frame values
+	// Initialise frame values
+	m_Frames[iCurrFrame].sName = sName;
 	m_Frames[iCurrFrame].iDepth = m_Frames[iParentFrame].iDepth + 1;
 	m_Frames[iCurrFrame].iParentIndex = iParentFrame;
 	m_Frames[iCurrFrame].iNumChildren = 0;
 	m_Frames[iCurrFrame].defaultMatrix = CMatrix4x4::kIdentity;
 	m_Frames[iCurrFrame].offsetMatrix = CMatrix4x4::kIdentity;
 
-	// Get number of child objects for the current object
-	TUInt32 iNumChildren;
-	eError = GetXFileNumChildren( pXFileData, &iNumChildren );
-	if (eError != kSuccess)
-	{
-		return kInvalidData;
-	}
-
 	// For each child object
-	for (TUInt32 iChild = 0; iChild < iNumChildren; ++iChild)
+	EImportError eError = kSuccess;
+	string sChildType, sChildName;
+	CXFileReader::EToken token;
+	while ((token = reader.PeekToken()) != CXFileReader::kTokenCloseBrace)
 	{
-		// Get child data and ID
-		ID3DXFileData* pChildData;
-		GUID childGUID;
-		eError = GetXFileChild( pXFileData, iChild, &pChildData, &childGUID );
-		if (eError != kSuccess)
+		if (token == CXFileReader::kTokenEnd)
+		{
+			return kInvalidData;
+		}
+
+		// Ignore references to other frames / meshes
+		if (token == CXFileReader::kTokenOpenBrace)
+		{
+			if (!reader.ReadReference( sChildName ))
+			{
+				return kInvalidData;
+			}
+			continue;
+		}
+
+		if (!reader.ReadObjectHeader( sChildType, sChildName ))
 		{
 			return kInvalidData;
 		}
-		
+
 		// Found child frame
-		if (childGUID == TID_D3DRMFrame)
+		if (sChildType == "Frame")
 		{
 			++m_Frames[iCurrFrame].iNumChildren;
-			eError = ParseXFileFrame( pChildData, iCurrFrame );
+			eError = ParseXFileFrame( reader, sChildName, iCurrFrame );
 		}
 
 		// Found child frame transformation matrix
-		else if (childGUID == TID_D3DRMFrameTransformMatrix)
+		else if (sChildType == "FrameTransformMatrix")
+		{
+			eError = ReadFrameMatrix( reader, &m_Frames[iCurrFrame].defaultMatrix );
+		}
+
+		// Found child mesh, only scanned in a lazy import
+		else if (sChildType == "Mesh")
 		{
-			CMatrix4x4 transMat;
-			TUInt32 iSize = 16 * sizeof(TFloat32);
-			TUInt8* pDest = reinterpret_cast<TUInt8*>(&m_Frames[iCurrFrame].defaultMatrix.e00);
-			eError = CopyXFileData( pChildData, pDest, &iSize );
+			eError = m_LazyFile.IsOpen() ? ScanXFileMesh( reader, iCurrFrame ) :
+			                               ParseXFileMesh( reader, iCurrFrame );
 		}
 
-		// Found child mesh
-		else if (childGUID == TID_D3DRMMesh)
+		// Found material that may be referenced by meshes
+		else if (sChildType == "Material")
 		{
-			eError = ParseXFileMesh( pChildData, iCurrFrame );
+			eError = ReadMaterial( reader, sChildName, &m_NamedMaterials[sChildName] );
 		}
 
-		// Release current child data before moving to the next or quiting on error
-		pChildData->Release();
+		// Found unknown frame data
+		else
+		{
+			eError = reader.SkipObject() ? kSuccess : kInvalidData;
+		}
 
 		// Return any errors found
 		if (eError != kSuccess)
 		{
 			return eError;
 		}
-	}		
+	}
+	reader.ReadCloseBrace();
+
+	// Pass the frame on if streaming
+	FinishFrame( iCurrFrame );
 
 	return kSuccess;
 
 	GEN_ENDGUARD;
 }
 
-
 // Create a new mesh in the given frame and parse its data from the X-File
 EImportError CImportXFile::ParseXFileMesh
 (
-	ID3DXFileData* pXFileData,
-	const TUInt32  iCurrFrame
+	CXFileReader& reader,
+	const TUInt32 iCurrFrame
 )
 {
 	GEN_GUARD;
@@ -753,7 +897,7 @@ EImportError CImportXFile::ParseXFileMesh
 	m_Meshes[iCurrMesh].iMaxBonesPerFace = 0;
 
 	// Read vertices and faces for the mesh
-	EImportError eError = ReadMeshData( pXFileData, iCurrMesh );
+	EImportError eError = ReadMeshData( reader, iCurrMesh );
 	if (eError != kSuccess)
 	{
 		return eError;
@@ -762,89 +906,77 @@ EImportError CImportXFile::ParseXFileMesh
 	// Counter for bones read from child data objects
 	TUInt32 iCurrBone = 0; 
 
-	// Get number of child objects for the current object
-	TUInt32 iNumChildren;
-	eError = GetXFileNumChildren( pXFileData, &iNumChildren );
-	if (eError != kSuccess)
-	{
-		return kInvalidData;
-	}
-
 	// For each child object
-	for (TUInt32 iChild = 0; iChild < iNumChildren; ++iChild)
+	string sChildType, sChildName;
+	CXFileReader::EToken token;
+	while ((token = reader.PeekToken()) != CXFileReader::kTokenCloseBrace)
 	{
-		// Get child data and ID
-		ID3DXFileData* pChildData;
-		GUID childGUID;
-		eError = GetXFileChild( pXFileData, iChild, &pChildData, &childGUID );
-		if (eError != kSuccess)
+		if (token == CXFileReader::kTokenEnd || !reader.ReadObjectHeader( sChildType, sChildName ))
 		{
 			return kInvalidData;
 		}
 
 		// Found normal data
-		if (childGUID == TID_D3DRMMeshNormals)
+		if (sChildType == "MeshNormals")
 		{
-			eError = ReadNormalData( pChildData, iCurrMesh );
+			eError = ReadNormalData( reader, iCurrMesh );
 		}
 
 		// Found texture coordinate data
-		else if (childGUID == TID_D3DRMMeshTextureCoords)
+		else if (sChildType == "MeshTextureCoords")
 		{
-			eError = ReadTextureUVData( pChildData, iCurrMesh );
+			eError = ReadTextureUVData( reader, iCurrMesh );
 		}
 
 		// Found vertex colour data
-		else if (childGUID == TID_D3DRMMeshVertexColors)
+		else if (sChildType == "MeshVertexColors")
 		{
-			eError = ReadVertexColourData( pChildData, iCurrMesh );
+			eError = ReadVertexColourData( reader, iCurrMesh );
 		}
 
 		// Found material list
-		else if (childGUID == TID_D3DRMMeshMaterialList)
+		else if (sChildType == "MeshMaterialList")
 		{
-			eError = ReadMaterialData( pChildData, iCurrMesh );
+			eError = ReadMaterialData( reader, iCurrMesh );
 		}
 
 		// Found vertex duplication list
-		else if (childGUID == DXFILEOBJ_VertexDuplicationIndices)
+		else if (sChildType == "VertexDuplicationIndices")
 		{
-			eError = ReadDuplicationData( pChildData, iCurrMesh );
+			eError = ReadDuplicationData( reader, iCurrMesh );
 		}
 
 		// Found face adjacency data
-		else if (childGUID == DXFILEOBJ_FaceAdjacency)
+		else if (sChildType == "FaceAdjacency")
 		{
-			eError = ReadAdjacencyData( pChildData, iCurrMesh );
+			eError = ReadAdjacencyData( reader, iCurrMesh );
 		}
 
 		// Found skinning definition
-		else if (childGUID == DXFILEOBJ_XSkinMeshHeader)
+		else if (sChildType == "XSkinMeshHeader")
 		{
-			eError = ReadSkinDefnData( pChildData, iCurrMesh );
+			eError = ReadSkinDefnData( reader, iCurrMesh );
 		}
 
 		// Found skin weights
-		else if (childGUID == DXFILEOBJ_SkinWeights)
+		else if (sChildType == "SkinWeights")
 		{
-			eError = ReadSkinWeightsData( pChildData, iCurrMesh, iCurrBone );
+			eError = ReadSkinWeightsData( reader, iCurrMesh, iCurrBone );
 			++iCurrBone;
 		}
 
 		// Found unknown mesh data
 		else
 		{
-			eError = kSuccess; // Won't flag this as failure though
+			eError = reader.SkipObject() ? kSuccess : kInvalidData;
 		}
 
 		if (eError != kSuccess)
 		{
 			return eError;
 		}
-
-		// Release current child data before moving to the next
-		pChildData->Release();
 	}
+	reader.ReadCloseBrace();
 
 	// Check if not enough bones
 	if (iCurrBone != m_Meshes[iCurrMesh].bones.size())
@@ -852,454 +984,690 @@ EImportError CImportXFile::ParseXFileMesh
 		return kInvalidData;
 	}
 
-	// Match the face lists of vertices and normals, so there is exactly one normal per vertex
-	MatchFaceLists( iCurrMesh );
+	// Weld identical vertices, this also ensures there is exactly one normal per vertex
+	CalculateBounds( m_Meshes[iCurrMesh] );
+	WeldVertices( iCurrMesh );
 
-	return kSuccess;
+	// Pass the mesh on if streaming
+	return FinishMesh( iCurrMesh );
 
 	GEN_ENDGUARD;
 }
 
-
-/*-----------------------------------------------------------------------------------------
-	X-File template parsing
------------------------------------------------------------------------------------------*/
-
-// Read vertex and face data from a mesh template
-EImportError CImportXFile::ReadMeshData
+// Scan a mesh during a lazy import, reading its size, bounds and materials and skipping the rest.
+// Adds a lazy mesh and a placeholder sub-mesh for each material used by its faces. The data is
+// checked as far as it is read, the rest is checked when the mesh is read
+// Possible return values:
+//		kInvalidData:		The file could not be parsed correctly, or contains invalid data
+EImportError CImportXFile::ScanXFileMesh
 (
-	ID3DXFileData* pXFileData,
-	const TUInt32  iMesh
+	CXFileReader& reader,
+	const TUInt32 iCurrFrame
 )
 {
 	GEN_GUARD;
 
-	// Lock mesh data pointer
-	TUInt32 iMeshDataSize = 0;
-	const TUInt8* pMeshDataStart;
-	EImportError eError = LockXFileData( pXFileData, &pMeshDataStart, &iMeshDataSize );
-	if (eError != kSuccess)
+	SXFileLazyMesh lazyMesh;
+	lazyMesh.iParentFrame = iCurrFrame;
+	lazyMesh.iDataOffset = reader.GetOffset();
+	lazyMesh.minBounds = CVector3::kZero;
+	lazyMesh.maxBounds = CVector3::kZero;
+	lazyMesh.iFirstSubMesh = static_cast<TUInt32>(m_Meshes.size());
+	lazyMesh.iNumSubMeshes = 0;
+	lazyMesh.bLoaded = false;
+	lazyMesh.eLoadError = kSuccess;
+
+	// Get the bounds of the vertices
+	if (!reader.ReadUInt( &lazyMesh.iNumVertices ))
 	{
 		return kInvalidData;
 	}
-	const TUInt8* pMeshData = pMeshDataStart;
-
-	// Get vertices
-	TUInt32 iNumVertices;
-	ReadXFileLockedUInt( pMeshData, &iNumVertices );
-	m_Meshes[iMesh].vertices.resize( iNumVertices );
-	for (TUInt32 iVertex = 0; iVertex < iNumVertices; ++iVertex)
+	for (TUInt32 iVertex = 0; iVertex < lazyMesh.iNumVertices; ++iVertex)
 	{
-		TUInt8* pDest = reinterpret_cast<TUInt8*>(&m_Meshes[iMesh].vertices[iVertex]);
-		ReadXFileLockedData( pMeshData, pDest, sizeof(CVector3) );
+		CVector3 vertex;
+		if (!reader.ReadFloats( &vertex.x, 3 ))
+		{
+			return kInvalidData;
+		}
+		if (iVertex == 0)
+		{
+			lazyMesh.minBounds = vertex;
+			lazyMesh.maxBounds = vertex;
+		}
+		else
+		{
+			lazyMesh.minBounds.x = Min( lazyMesh.minBounds.x, vertex.x );
+			lazyMesh.minBounds.y = Min( lazyMesh.minBounds.y, vertex.y );
+			lazyMesh.minBounds.z = Min( lazyMesh.minBounds.z, vertex.z );
+			lazyMesh.maxBounds.x = Max( lazyMesh.maxBounds.x, vertex.x );
+			lazyMesh.maxBounds.y = Max( lazyMesh.maxBounds.y, vertex.y );
+			lazyMesh.maxBounds.z = Max( lazyMesh.maxBounds.z, vertex.z );
+		}
 	}
 
-	// Read faces - they can be general polygons - convert them all to triangles
-	TUInt32 iNumFaces;
-	ReadXFileLockedUInt( pMeshData, &iNumFaces );
-	m_Meshes[iMesh].origFaceEdges.resize( iNumFaces ); // See below
-	for (TUInt32 iFace = 0; iFace < iNumFaces; ++iFace)
+	// Count the triangles in the face list
+	TUInt32 iNumOrigFaces;
+	if (!reader.ReadUInt( &iNumOrigFaces ))
+	{
+		return kInvalidData;
+	}
+	lazyMesh.iNumFaces = 0;
+	for (TUInt32 iOrigFace = 0; iOrigFace < iNumOrigFaces; ++iOrigFace)
 	{
 		TUInt32 iNumEdges;
-		ReadXFileLockedUInt( pMeshData, &iNumEdges );
+		if (!reader.ReadUInt( &iNumEdges ) || iNumEdges < 3)
+		{
+			return kInvalidData;
+		}
+		for (TUInt32 iEdge = 0; iEdge < iNumEdges; ++iEdge)
+		{
+			TUInt32 iIndex;
+			if (!reader.ReadUInt( &iIndex ) || iIndex >= lazyMesh.iNumVertices)
+			{
+				return kInvalidData;
+			}
+		}
+		lazyMesh.iNumFaces += iNumEdges - 2;
+	}
 
-		// Store original number of edges for normal face validation below
-		m_Meshes[iMesh].origFaceEdges[iFace] = iNumEdges;
+	// Read the material list and note which materials are used by faces, skip other child data
+	TXFileMaterials materials;
+	vector<bool> usedMaterials;
+	bool bMaterialList = false;
+	string sChildType, sChildName;
+	CXFileReader::EToken token;
+	while ((token = reader.PeekToken()) != CXFileReader::kTokenCloseBrace)
+	{
+		if (token == CXFileReader::kTokenEnd || !reader.ReadObjectHeader( sChildType, sChildName ))
+		{
+			return kInvalidData;
+		}
 
-		// Read first index of polygon, then use successive pairs of indices to form triangles
-		// with this first one
-		TUInt32 iFirstIndex, iIndexA, iIndexB;
-		ReadXFileLockedUInt( pMeshData, &iFirstIndex );
-		ReadXFileLockedUInt( pMeshData, &iIndexA );
-		for (TUInt32 iEdge = 2; iEdge < iNumEdges; ++iEdge)
+		if (sChildType == "MeshMaterialList")
 		{
-			ReadXFileLockedUInt( pMeshData, &iIndexB );
-			SXFileFace face = { iFirstIndex, iIndexA, iIndexB };
-			m_Meshes[iMesh].faces.push_back( face );
-			iIndexA = iIndexB;
+			// Only allow one material list in a mesh
+			TUInt32 iNumMaterials, iNumFaceMaterials;
+			if (bMaterialList || !reader.ReadUInt( &iNumMaterials ) ||
+			    !reader.ReadUInt( &iNumFaceMaterials ))
+			{
+				return kInvalidData;
+			}
+			bMaterialList = true;
+
+			// One face material for several faces means all faces use it (see ReadMaterialData)
+			usedMaterials.assign( iNumMaterials, false );
+			if (iNumFaceMaterials != iNumOrigFaces && (iNumFaceMaterials != 1 || iNumOrigFaces == 1))
+			{
+				return kInvalidData;
+			}
+			for (TUInt32 iFaceMaterial = 0; iFaceMaterial < iNumFaceMaterials; ++iFaceMaterial)
+			{
+				TUInt32 iMaterial;
+				if (!reader.ReadUInt( &iMaterial ) || iMaterial >= iNumMaterials)
+				{
+					return kInvalidData;
+				}
+				usedMaterials[iMaterial] = (lazyMesh.iNumFaces > 0);
+			}
+
+			EImportError eError = ReadMaterialList( reader, iNumMaterials, &materials );
+			if (eError != kSuccess)
+			{
+				return eError;
+			}
+		}
+		else if (!reader.SkipObject())
+		{
+			return kInvalidData;
 		}
 	}
+	reader.ReadCloseBrace();
 
-	// Unlock mesh data
-	pXFileData->Unlock();
+	// Add the materials to the global list and create a placeholder for each sub-mesh that the
+	// mesh will be split into when read
+	AddGlobalMaterials( materials, &lazyMesh.materialMap );
+	TUInt32 iLazyMesh = static_cast<TUInt32>(m_LazyMeshes.size());
+	for (TUInt32 iMaterial = 0; iMaterial < materials.size(); ++iMaterial)
+	{
+		if (usedMaterials[iMaterial])
+		{
+			m_Meshes.push_back( SXFileMesh() );
+			SXFileMesh& subMesh = m_Meshes.back();
+			subMesh.iParentFrame = iCurrFrame;
+			subMesh.materials.push_back( materials[iMaterial] );
+			subMesh.materialMap.push_back( lazyMesh.materialMap[iMaterial] );
+			subMesh.minBounds = lazyMesh.minBounds;
+			subMesh.maxBounds = lazyMesh.maxBounds;
+			MeshBoundsFromBox( lazyMesh.minBounds, lazyMesh.maxBounds, &subMesh.bounds );
+			m_SubMeshLazyMeshes.push_back( iLazyMesh );
+			++lazyMesh.iNumSubMeshes;
+		}
+	}
+	if (lazyMesh.iNumSubMeshes > 0)
+	{
+		AddFrameBounds( iCurrFrame, m_Meshes.back().bounds );
+	}
 
-	// Validate amount of data read
-	if (static_cast<TUInt32>(pMeshData - pMeshDataStart) != iMeshDataSize)
+	// Meshes with no sub-meshes never need to be read
+	lazyMesh.bLoaded = (lazyMesh.iNumSubMeshes == 0);
+	if (!lazyMesh.bLoaded)
 	{
-		return kInvalidData;
+		++m_iNumLazyMeshesLeft;
 	}
+	m_iNumFileVertices += lazyMesh.iNumVertices;
+	m_LazyMeshes.push_back( lazyMesh );
 
 	return kSuccess;
+
 	GEN_ENDGUARD;
 }
 
+// Read and process a mesh found by ScanXFileMesh, replacing its sub-mesh placeholders. The result
+// of reading the mesh is stored in the lazy mesh. Releases the file once all meshes are read
+EImportError CImportXFile::LoadLazyMesh
+(
+	const TUInt32 iLazyMesh
+)
+{
+	GEN_GUARD;
 
-// Read a normal data mesh template
-EImportError CImportXFile::ReadNormalData
+	SXFileLazyMesh& lazyMesh = m_LazyMeshes[iLazyMesh];
+	lazyMesh.bLoaded = true;
+
+	// Parse the mesh as in a full import, appending it to the mesh list temporarily. Its vertices
+	// were counted when it was scanned. Space for it is reserved first so the list only grows on
+	// the first load, before any sub-meshes hold data that growing would copy
+	const TUInt8* pData = m_LazyData.empty() ? m_LazyFile.GetData() : &m_LazyData[0];
+	TUInt32 iSize = m_LazyData.empty() ? m_LazyFile.GetSize() : static_cast<TUInt32>(m_LazyData.size());
+	CXFileTextReader textReader( pData, iSize );
+	CXFileBinaryReader binaryReader( pData, iSize );
+	CXFileReader& reader = CXFileBinaryReader::IsBinaryXFile( pData, iSize ) ?
+	                       static_cast<CXFileReader&>(binaryReader) : textReader;
+	reader.SetOffset( lazyMesh.iDataOffset );
+	TUInt32 iMesh = static_cast<TUInt32>(m_Meshes.size());
+	m_Meshes.reserve( iMesh + 1 );
+	TUInt32 iNumFileVertices = m_iNumFileVertices;
+	EImportError eError;
+	{
+		CImportStageTimer parseTimer( m_pStats, kStageParse );
+		eError = ParseXFileMesh( reader, lazyMesh.iParentFrame );
+	}
+	m_iNumFileVertices = iNumFileVertices;
+
+	// Use the material map from the scan, match bones and split the mesh into the sub-meshes
+	// that were created by the scan
+	if (eError == kSuccess)
+	{
+		SXFileMesh& mesh = m_Meshes[iMesh];
+		eError = (mesh.materials.size() == lazyMesh.materialMap.size()) ? MatchBones( mesh ) :
+		                                                                   kInvalidData;
+		if (eError == kSuccess)
+		{
+			mesh.materialMap = lazyMesh.materialMap;
+			CImportStageTimer splitTimer( m_pStats, kStageSplit );
+			TXFileMeshes splitMeshes;
+			SplitMesh( mesh, &splitMeshes, &m_SubMeshArena );
+			RecordMeshMemory( RecordSplit( mesh, splitMeshes.data(),
+			                               static_cast<TUInt32>(splitMeshes.size()) ) );
+			if (splitMeshes.size() == lazyMesh.iNumSubMeshes)
+			{
+				for (TUInt32 iSubMesh = 0; iSubMesh < lazyMesh.iNumSubMeshes; ++iSubMesh)
+				{
+					swap( m_Meshes[lazyMesh.iFirstSubMesh + iSubMesh], splitMeshes[iSubMesh] );
+				}
+			}
+			else
+			{
+				eError = kInvalidData;
+			}
+		}
+	}
+	m_Meshes.resize( iMesh );
+	lazyMesh.eLoadError = eError;
+
+	// Release the file when there is nothing left to read
+	if (--m_iNumLazyMeshesLeft == 0)
+	{
+		m_LazyFile.Close();
+		vector<TUInt8>().swap( m_LazyData );
+		m_NamedMaterials.clear();
+	}
+
+	return eError;
+
+	GEN_ENDGUARD;
+}
+
+// Read the members of a FrameTransformMatrix template
+EImportError CImportXFile::ReadFrameMatrix
 (
-	ID3DXFileData* pXFileData,
-	const TUInt32  iMesh
+	CXFileReader& reader,
+	CMatrix4x4*   pMatrix
 )
 {
 	GEN_GUARD;
 
-	// Only allow one vertex normal list in a mesh
-	if (m_Meshes[iMesh].normals.size() > 0)
+	if (!reader.ReadFloats( &pMatrix->e00, 16 ) || !reader.ReadCloseBrace())
 	{
 		return kInvalidData;
 	}
 
-	// Get normal data
-	const TUInt8* pNormalData;
-	EImportError eError = LockXFileData( pXFileData, &pNormalData );
-	if (eError != kSuccess)
+	return kSuccess;
+
+	GEN_ENDGUARD;
+}
+
+// Read a material template and its texture filename child
+EImportError CImportXFile::ReadMaterial
+(
+	CXFileReader&   reader,
+	const string&   sName,
+	SXFileMaterial* pMaterial
+)
+{
+	GEN_GUARD;
+
+	pMaterial->sName = sName;
+	pMaterial->sTextureName = "";
+
+	// Face colour, specular power, specular colour and emissive colour
+	if (!reader.ReadFloats( &pMaterial->faceColour.fRed, 4 ) ||
+	    !reader.ReadFloat( &pMaterial->fSpecularPower ) ||
+	    !reader.ReadFloats( &pMaterial->specularColour.fRed, 3 ) ||
+	    !reader.ReadFloats( &pMaterial->emmisiveColour.fRed, 3 ))
 	{
 		return kInvalidData;
 	}
 
-	// Read normals
-	TUInt32 iNumNormals;
-	ReadXFileLockedUInt( pNormalData, &iNumNormals );
-	m_Meshes[iMesh].normals.resize( iNumNormals );
-	for (TUInt32 iNormal = 0; iNormal < iNumNormals; ++iNormal)
+	// For each child object
+	string sChildType, sChildName;
+	CXFileReader::EToken token;
+	while ((token = reader.PeekToken()) != CXFileReader::kTokenCloseBrace)
+	{
+		if (token == CXFileReader::kTokenEnd || !reader.ReadObjectHeader( sChildType, sChildName ))
+		{
+			return kInvalidData;
+		}
+
+		// Found texture filename in material
+		if (sChildType == "TextureFilename" || sChildType == "TextureFileName")
+		{
+			if (!reader.ReadString( pMaterial->sTextureName ) || !reader.ReadCloseBrace())
+			{
+				return kInvalidData;
+			}
+		}
+
+		// Found unknown material data
+		else if (!reader.SkipObject())
+		{
+			return kInvalidData;
+		}
+	}
+	reader.ReadCloseBrace();
+
+	return kSuccess;
+
+	GEN_ENDGUARD;
+}
+
+// Read a list of polygonal faces, converting them to triangles. The number of edges of each
+// face is appended to pFaceEdges, or if pMatchEdges is given it is checked against it instead
+bool CImportXFile::ReadFaceList
+(
+	CXFileReader&     reader,
+	const TUInt32     iNumVertices,
+	TXFileFaces*      pFaces,
+	TXFileInts*       pFaceEdges,
+	const TXFileInts* pMatchEdges
+)
+{
+	GEN_GUARD;
+
+	TUInt32 iNumFaces;
+	if (!reader.ReadUInt( &iNumFaces ) || (pMatchEdges && iNumFaces != pMatchEdges->size()))
 	{
-		TUInt8* pDest = reinterpret_cast<TUInt8*>(&m_Meshes[iMesh].normals[iNormal]);
-		ReadXFileLockedData( pNormalData, pDest, sizeof(CVector3) );
+		return false;
 	}
 
-	// Verify that normal face list matches face list
-	TUInt32 iNumNormalFaces;
-	ReadXFileLockedUInt( pNormalData, &iNumNormalFaces );
-	if (iNumNormalFaces != m_Meshes[iMesh].origFaceEdges.size())
+	// Most faces are triangles, reserve for that case
+	pFaces->reserve( pFaces->size() + iNumFaces );
+	if (pFaceEdges)
 	{
-		pXFileData->Unlock();
-		return kInvalidData;
+		pFaceEdges->resize( iNumFaces );
 	}
 
-	// Read normal faces - they can be general polygons - convert them all to triangles
-	for (TUInt32 iFace = 0; iFace < iNumNormalFaces; ++iFace)
+	for (TUInt32 iFace = 0; iFace < iNumFaces; ++iFace)
 	{
 		TUInt32 iNumEdges;
-		ReadXFileLockedUInt( pNormalData, &iNumEdges );
-
-		// Check number of edges against original face data
-		if (iNumEdges != m_Meshes[iMesh].origFaceEdges[iFace])
+		if (!reader.ReadUInt( &iNumEdges ) || iNumEdges < 3 ||
+		    (pMatchEdges && iNumEdges != (*pMatchEdges)[iFace]))
 		{
-			pXFileData->Unlock();
-			return kInvalidData;
+			return false;
+		}
+		if (pFaceEdges)
+		{
+			(*pFaceEdges)[iFace] = iNumEdges;
 		}
 
 		// Read first index of polygon, then use successive pairs of indices to form triangles
 		// with this first one
 		TUInt32 iFirstIndex, iIndexA, iIndexB;
-		ReadXFileLockedUInt( pNormalData, &iFirstIndex );
-		ReadXFileLockedUInt( pNormalData, &iIndexA );
+		if (!reader.ReadUInt( &iFirstIndex ) || !reader.ReadUInt( &iIndexA ) ||
+		    iFirstIndex >= iNumVertices || iIndexA >= iNumVertices)
+		{
+			return false;
+		}
 		for (TUInt32 iEdge = 2; iEdge < iNumEdges; ++iEdge)
 		{
-			ReadXFileLockedUInt( pNormalData, &iIndexB );
+			if (!reader.ReadUInt( &iIndexB ) || iIndexB >= iNumVertices)
+			{
+				return false;
+			}
 			SXFileFace face = { iFirstIndex, iIndexA, iIndexB };
-			m_Meshes[iMesh].normalFaces.push_back( face );
+			pFaces->push_back( face );
 			iIndexA = iIndexB;
 		}
 	}
 
-	// Finished with normal data
-	pXFileData->Unlock();
-
-	return kSuccess;
+	return true;
 
 	GEN_ENDGUARD;
 }
 
-// Read a texture coordinate mesh template
-EImportError CImportXFile::ReadTextureUVData
+// Read vertex and face data from a mesh template
+EImportError CImportXFile::ReadMeshData
 (
-	ID3DXFileData* pXFileData,
-	const TUInt32  iMesh
+	CXFileReader& reader,
+	const TUInt32 iMesh
 )
 {
 	GEN_GUARD;
 
-	// Only allow one texture coordinate list in a mesh
-	if (m_Meshes[iMesh].textureCoords.size() > 0)
+	SXFileMesh& mesh = m_Meshes[iMesh];
+
+	// Get vertices
+	TUInt32 iNumVertices;
+	if (!reader.ReadUInt( &iNumVertices ))
 	{
 		return kInvalidData;
 	}
-
-	// Get texture coordinate data
-	const TUInt8* pTexCoordData;
-	EImportError eError = LockXFileData( pXFileData, &pTexCoordData );
-	if (eError != kSuccess)
+	mesh.vertices.resize( iNumVertices );
+	if (iNumVertices && !reader.ReadFloats( &mesh.vertices[0].x, iNumVertices * 3 ))
 	{
 		return kInvalidData;
 	}
 
-	// Read texture coordinates
-	TUInt32 iNumTextureCoords;
-	ReadXFileLockedUInt( pTexCoordData, &iNumTextureCoords );
-	if (iNumTextureCoords != m_Meshes[iMesh].vertices.size())
+	// Read faces - they can be general polygons - convert them all to triangles
+	if (!ReadFaceList( reader, iNumVertices, &mesh.faces, &mesh.origFaceEdges, 0 ))
 	{
-		pXFileData->Unlock();
 		return kInvalidData;
 	}
-	m_Meshes[iMesh].textureCoords.resize( iNumTextureCoords );
-	for (TUInt32 iUV = 0; iUV < iNumTextureCoords; ++iUV)
-	{
-		TUInt8* pDest = reinterpret_cast<TUInt8*>(&m_Meshes[iMesh].textureCoords[iUV]);
-		ReadXFileLockedData( pTexCoordData, pDest, sizeof(SXFileUV) );
-	}
-
-	// Finished with texture coordinate data
-	pXFileData->Unlock();
 
 	return kSuccess;
 
 	GEN_ENDGUARD;
 }
 
-// Read a vertex colour mesh template, any vertices not assigned a colour will get white
-EImportError CImportXFile::ReadVertexColourData
+// Read a normal data mesh template
+EImportError CImportXFile::ReadNormalData
 (
-	ID3DXFileData* pXFileData,
-	const TUInt32  iMesh
+	CXFileReader& reader,
+	const TUInt32 iMesh
 )
 {
 	GEN_GUARD;
 
-	// Only allow one vertex colour list in a mesh
-	if (m_Meshes[iMesh].vertexColours.size() > 0)
+	SXFileMesh& mesh = m_Meshes[iMesh];
+
+	// Only allow one vertex normal list in a mesh
+	if (mesh.normals.size() > 0)
 	{
 		return kInvalidData;
 	}
 
-	// Get vertex colour data
-	const TUInt8* pVertexColourData;
-	EImportError eError = LockXFileData( pXFileData, &pVertexColourData );
-	if (eError != kSuccess)
+	// Read normals
+	TUInt32 iNumNormals;
+	if (!reader.ReadUInt( &iNumNormals ))
 	{
 		return kInvalidData;
 	}
-
-	// Read vertex colours
-	TUInt32 iNumVertexColours;
-	ReadXFileLockedUInt( pVertexColourData, &iNumVertexColours );
-
-	// All colours default to white if not assigned
-	// TODO: Could split mesh into sections with and without vertex colours - not worth it?
-	SXFileRGBAColour defaultColour = { 1.0f, 1.0f, 1.0f, 1.0f };
-	m_Meshes[iMesh].vertexColours.resize( iNumVertexColours, defaultColour );
-	for (TUInt32 iColour = 0; iColour < iNumVertexColours; ++iColour)
+	mesh.normals.resize( iNumNormals );
+	if (iNumNormals && !reader.ReadFloats( &mesh.normals[0].x, iNumNormals * 3 ))
 	{
-		TUInt32 iVertexIndex;
-		ReadXFileLockedUInt( pVertexColourData, &iVertexIndex );
-		TUInt8* pDest = reinterpret_cast<TUInt8*>(&m_Meshes[iMesh].vertexColours[iVertexIndex]);
-		ReadXFileLockedData( pVertexColourData, pDest, sizeof(SXFileRGBAColour) );
+		return kInvalidData;
 	}
 
-	// Finished with vertex colour data
-	pXFileData->Unlock();
+	// Read normal faces, verifying that they match the original face list
+	if (!ReadFaceList( reader, iNumNormals, &mesh.normalFaces, 0, &mesh.origFaceEdges ) ||
+	    !reader.ReadCloseBrace())
+	{
+		return kInvalidData;
+	}
 
 	return kSuccess;
 
 	GEN_ENDGUARD;
 }
 
-// Read a vertex colour mesh template
-EImportError CImportXFile::ReadMaterialData
+// Read a texture coordinate mesh template
+EImportError CImportXFile::ReadTextureUVData
 (
-	ID3DXFileData* pXFileData,
-	const TUInt32  iMesh
+	CXFileReader& reader,
+	const TUInt32 iMesh
 )
 {
 	GEN_GUARD;
 
-	// Only allow one material list in a mesh
-	if (m_Meshes[iMesh].materials.size() > 0)
+	SXFileMesh& mesh = m_Meshes[iMesh];
+
+	// Only allow one texture coordinate list in a mesh
+	if (mesh.textureCoords.size() > 0)
 	{
 		return kInvalidData;
 	}
 
-	// Get material data
-	const TUInt8* pMaterialData;
-	EImportError eError = LockXFileData( pXFileData, &pMaterialData );
-	if (eError != kSuccess)
+	// Read texture coordinates
+	TUInt32 iNumTextureCoords;
+	if (!reader.ReadUInt( &iNumTextureCoords ) || iNumTextureCoords != mesh.vertices.size())
 	{
 		return kInvalidData;
 	}
-
-	// Read number of materials and initialise material list
-	TUInt32 iNumMaterials;
-	ReadXFileLockedUInt( pMaterialData, &iNumMaterials );
-	for (TUInt32 iMaterial = 0; iMaterial < iNumMaterials; ++iMaterial)
+	mesh.textureCoords.resize( iNumTextureCoords );
+	if (iNumTextureCoords && !reader.ReadFloats( &mesh.textureCoords[0].fU, iNumTextureCoords * 2 ))
 	{
-		SXFileMaterial material = 
-		{
-			"",
-			{ 1.0f, 1.0f, 1.0f, 1.0f },
-			20.0f, { 0.0f, 0.0f, 0.0f },
-			{ 0.0f, 0.0f, 0.0f },
-			""
-		};
-		m_Meshes[iMesh].materials.push_back( material );
+		return kInvalidData;
+	}
+
+	return reader.ReadCloseBrace() ? kSuccess : kInvalidData;
+
+	GEN_ENDGUARD;
+}
+
+// Read a vertex colour mesh template, any vertices not assigned a colour will get white
+EImportError CImportXFile::ReadVertexColourData
+(
+	CXFileReader& reader,
+	const TUInt32 iMesh
+)
+{
+	GEN_GUARD;
+
+	SXFileMesh& mesh = m_Meshes[iMesh];
+
+	// Only allow one vertex colour list in a mesh
+	if (mesh.vertexColours.size() > 0)
+	{
+		return kInvalidData;
+	}
+
+	// Read vertex colours
+	TUInt32 iNumVertexColours;
+	if (!reader.ReadUInt( &iNumVertexColours ))
+	{
+		return kInvalidData;
+	}
+
+	// All colours default to white if not assigned
+	SXFileRGBAColour defaultColour = { 1.0f, 1.0f, 1.0f, 1.0f };
+	mesh.vertexColours.resize( mesh.vertices.size(), defaultColour );
+	for (TUInt32 iColour = 0; iColour < iNumVertexColours; ++iColour)
+	{
+		TUInt32 iVertexIndex;
+		if (!reader.ReadUInt( &iVertexIndex ) || iVertexIndex >= mesh.vertexColours.size() ||
+		    !reader.ReadFloats( &mesh.vertexColours[iVertexIndex].fRed, 4 ))
+		{
+			return kInvalidData;
+		}
+	}
+
+	return reader.ReadCloseBrace() ? kSuccess : kInvalidData;
+
+	GEN_ENDGUARD;
+}
+
+// Read a material list mesh template. Materials may be given in place or as references to
+// top-level materials
+EImportError CImportXFile::ReadMaterialData
+(
+	CXFileReader& reader,
+	const TUInt32 iMesh
+)
+{
+	GEN_GUARD;
+
+	SXFileMesh& mesh = m_Meshes[iMesh];
+
+	// Only allow one material list in a mesh
+	if (mesh.materials.size() > 0)
+	{
+		return kInvalidData;
+	}
+
+	// Read number of materials, list is filled from child objects below
+	TUInt32 iNumMaterials;
+	if (!reader.ReadUInt( &iNumMaterials ))
+	{
+		return kInvalidData;
 	}
 
 	// Read face materials - matching the original face list before it was split into triangles.
 	// Will convert to match the new (triangle-only) face list
 	TUInt32 iNumFaceMaterials;
-	ReadXFileLockedUInt( pMaterialData, &iNumFaceMaterials );
+	if (!reader.ReadUInt( &iNumFaceMaterials ))
+	{
+		return kInvalidData;
+	}
 
 	// Handle undocumented case with only one face material - all faces use same material
-	if (iNumFaceMaterials == 1 && m_Meshes[iMesh].origFaceEdges.size() != 1)
+	if (iNumFaceMaterials == 1 && mesh.origFaceEdges.size() != 1)
 	{
-		// Read the single face material
 		TUInt32 iFaceMaterial;
-		ReadXFileLockedUInt( pMaterialData, &iFaceMaterial );
-
-		// Create a full face material list from this value
-		m_Meshes[iMesh].faceMaterials.resize( m_Meshes[iMesh].faces.size(), iFaceMaterial );
+		if (!reader.ReadUInt( &iFaceMaterial ) || iFaceMaterial >= iNumMaterials)
+		{
+			return kInvalidData;
+		}
+		mesh.faceMaterials.resize( mesh.faces.size(), iFaceMaterial );
 	}
 	else // Read standard face materials - one material reference for each face
 	{
-		if (iNumFaceMaterials != m_Meshes[iMesh].origFaceEdges.size())
+		if (iNumFaceMaterials != mesh.origFaceEdges.size())
 		{
-			pXFileData->Unlock();
 			return kInvalidData;
 		}
-		m_Meshes[iMesh].faceMaterials.resize( m_Meshes[iMesh].faces.size() );
+		mesh.faceMaterials.resize( mesh.faces.size() );
 		TUInt32 iFace = 0;
 		for (TUInt32 iOrigFace = 0; iOrigFace < iNumFaceMaterials; ++iOrigFace)
 		{
 			TUInt32 iMaterial;
-			ReadXFileLockedUInt( pMaterialData, &iMaterial );
-			m_Meshes[iMesh].faceMaterials[iFace] = iMaterial;
+			if (!reader.ReadUInt( &iMaterial ) || iMaterial >= iNumMaterials)
+			{
+				return kInvalidData;
+			}
+			mesh.faceMaterials[iFace] = iMaterial;
 			++iFace;
-			for (TUInt32 iEdge = 3; iEdge < m_Meshes[iMesh].origFaceEdges[iOrigFace]; ++iEdge)
+			for (TUInt32 iEdge = 3; iEdge < mesh.origFaceEdges[iOrigFace]; ++iEdge)
 			{
-				m_Meshes[iMesh].faceMaterials[iFace] = iMaterial;
+				mesh.faceMaterials[iFace] = iMaterial;
 				++iFace;
 			}
 		}
 	}
 
-	// Finished with material data
-	pXFileData->Unlock();
-
+	// Read the materials, either in place or referenced
+	return ReadMaterialList( reader, iNumMaterials, &mesh.materials );
 
-	// Counter for materials read from optional data objects
-	TUInt32 iMaterialsRead = 0;
+	GEN_ENDGUARD;
+}
 
-	// Get number of child objects for the current object
-	TUInt32 iNumMatListChildren;
-	eError = GetXFileNumChildren( pXFileData, &iNumMatListChildren );
-	if (eError != kSuccess)
-	{
-		return kInvalidData;
-	}
+// Read the materials in a material list template, which follow the face materials. Materials may
+// be given in place or as references to top-level materials
+EImportError CImportXFile::ReadMaterialList
+(
+	CXFileReader&    reader,
+	const TUInt32    iNumMaterials,
+	TXFileMaterials* pMaterials
+)
+{
+	GEN_GUARD;
 
-	// For each child object
-	for (TUInt32 iMatListChild = 0; iMatListChild < iNumMatListChildren; ++iMatListChild)
+	pMaterials->reserve( iNumMaterials );
+	string sChildType, sChildName;
+	CXFileReader::EToken token;
+	while ((token = reader.PeekToken()) != CXFileReader::kTokenCloseBrace)
 	{
-		// Get child data and ID
-		ID3DXFileData* pMatListChildData;
-		GUID matListChildGUID;
-		eError = GetXFileChild( pXFileData, iMatListChild, &pMatListChildData, &matListChildGUID );
-		if (eError != kSuccess)
+		if (token == CXFileReader::kTokenEnd)
 		{
 			return kInvalidData;
 		}
 
-		// Found material in material list
-		if (matListChildGUID == TID_D3DRMMaterial)
+		// Reference to a top level material
+		if (token == CXFileReader::kTokenOpenBrace)
 		{
-			// Check if too many materials
-			if (iMaterialsRead >= m_Meshes[iMesh].materials.size())
+			if (!reader.ReadReference( sChildName ))
 			{
-				pMatListChildData->Release();
 				return kInvalidData;
 			}
-
-			// Read material name
-			EImportError eError =
-				GetXFileDataName( pMatListChildData, m_Meshes[iMesh].materials[iMaterialsRead].sName );
-			if (eError != kSuccess)
+			TXFileNamedMaterials::const_iterator itMaterial = m_NamedMaterials.find( sChildName );
+			if (itMaterial == m_NamedMaterials.end() || pMaterials->size() >= iNumMaterials)
 			{
-				pMatListChildData->Release();
 				return kInvalidData;
 			}
+			pMaterials->push_back( itMaterial->second );
+			continue;
+		}
 
-			// Get material data (11 floats in material template up to optional data)
-			// Fills in all of SXFileMaterial between name & texture name TODO a bit dodgy
-			TUInt32 iSize = 11 * sizeof(TFloat32);
-			TUInt8* pDest = 
-				reinterpret_cast<TUInt8*>(&m_Meshes[iMesh].materials[iMaterialsRead].faceColour);
-			CopyXFileData( pMatListChildData, pDest, &iSize );
-
+		if (!reader.ReadObjectHeader( sChildType, sChildName ))
+		{
+			return kInvalidData;
+		}
 
-			// Get number of child objects for the current object
-			TUInt32 iNumMatChildren;
-			eError = GetXFileNumChildren( pMatListChildData, &iNumMatChildren );
-			if (eError != kSuccess)
+		// Found material in material list
+		if (sChildType == "Material")
+		{
+			// Check if too many materials
+			if (pMaterials->size() >= iNumMaterials)
 			{
-				pMatListChildData->Release();
 				return kInvalidData;
 			}
-
-			// For each child object
-			for (TUInt32 iMatChild = 0; iMatChild < iNumMatChildren; ++iMatChild)
+			pMaterials->push_back( SXFileMaterial() );
+			EImportError eError = ReadMaterial( reader, sChildName, &pMaterials->back() );
+			if (eError != kSuccess)
 			{
-				// Get child data and ID
-				ID3DXFileData* pMatChildData;
-				GUID matChildGUID;
-				eError = GetXFileChild( pMatListChildData, iMatChild,
-				                        &pMatChildData, &matChildGUID );
-				if (eError != kSuccess)
-				{
-					pMatListChildData->Release();
-					return kInvalidData;
-				}
-
-				// Found texture filename in material
-				if (matChildGUID == TID_D3DRMTextureFilename)
-				{
-					const TUInt8* pFileNameData;
-					EImportError eError = LockXFileData( pMatChildData, &pFileNameData );
-					if (eError != kSuccess)
-					{
-						pMatChildData->Release();
-						pMatListChildData->Release();
-						return kInvalidData;
-					}
-					m_Meshes[iMesh].materials[iMaterialsRead].sTextureName = 
-						reinterpret_cast<const char*>(pFileNameData);
-					pMatChildData->Unlock();
-				}
-
-				// Found unknown material data
-				else
-				{
-					// Ignore
-				}
-
-				// Release material child data before moving to the next
-				pMatChildData->Release();
+				return eError;
 			}
-
-			// Increase nubmer of materials that have been found and read
-			++iMaterialsRead;
 		}
 
 		// Found unknown material list data
-		else
+		else if (!reader.SkipObject())
 		{
-			// Ignore
+			return kInvalidData;
 		}
-
-		// Release material list child data before moving to the next
-		pMatListChildData->Release();
 	}
+	reader.ReadCloseBrace();
 
 	// Check if not enough materials
-	if (iMaterialsRead != m_Meshes[iMesh].materials.size())
+	if (pMaterials->size() != iNumMaterials)
 	{
 		return kInvalidData;
 	}
@@ -1312,45 +1680,38 @@ EImportError CImportXFile::ReadMaterialData
 // Read a vertex duplication mesh template
 EImportError CImportXFile::ReadDuplicationData
 (
-	ID3DXFileData* pXFileData,
-	const TUInt32  iMesh
+	CXFileReader& reader,
+	const TUInt32 iMesh
 )
 {
 	GEN_GUARD;
 
-	// Only allow one vertex duplication list in a mesh
-	if (m_Meshes[iMesh].duplicateIndices.size() > 0)
-	{
-		return kInvalidData;
-	}
+	SXFileMesh& mesh = m_Meshes[iMesh];
 
-	// Get vertex duplication data
-	const TUInt8* pDuplicationData;
-	EImportError eError = LockXFileData( pXFileData, &pDuplicationData );
-	if (eError != kSuccess)
+	// Only allow one vertex duplication list in a mesh
+	if (mesh.duplicateIndices.size() > 0)
 	{
 		return kInvalidData;
 	}
 
 	// Read duplicaton indices, also fetch number of unique vertices
 	TUInt32 iNumDuplicationIndices;
-	ReadXFileLockedUInt( pDuplicationData, &iNumDuplicationIndices );
-	if (iNumDuplicationIndices != m_Meshes[iMesh].vertices.size())
+	if (!reader.ReadUInt( &iNumDuplicationIndices ) ||
+	    iNumDuplicationIndices != mesh.vertices.size() ||
+	    !reader.ReadUInt( &mesh.iNumUniqueVertices ))
 	{
-		pXFileData->Unlock();
 		return kInvalidData;
 	}
-	ReadXFileLockedUInt( pDuplicationData, &m_Meshes[iMesh].iNumUniqueVertices );
-	m_Meshes[iMesh].duplicateIndices.resize( iNumDuplicationIndices );
+	mesh.duplicateIndices.resize( iNumDuplicationIndices );
 	for (TUInt32 iIndex = 0; iIndex < iNumDuplicationIndices; ++iIndex)
 	{
-		ReadXFileLockedUInt( pDuplicationData, &m_Meshes[iMesh].duplicateIndices[iIndex] );
+		if (!reader.ReadUInt( &mesh.duplicateIndices[iIndex] ))
+		{
+			return kInvalidData;
+		}
 	}
 
-	// Finished with vertex duplication data
-	pXFileData->Unlock();
-
-	return kSuccess;
+	return reader.ReadCloseBrace() ? kSuccess : kInvalidData;
 
 	GEN_ENDGUARD;
 }
@@ -1359,39 +1720,36 @@ EImportError CImportXFile::ReadDuplicationData
 // TODO: Unknown usage
 EImportError CImportXFile::ReadAdjacencyData
 (
-	ID3DXFileData* pXFileData,
-	const TUInt32  iMesh
+	CXFileReader& reader,
+	const TUInt32 iMesh
 )
 {
 	GEN_GUARD;
 
+	SXFileMesh& mesh = m_Meshes[iMesh];
+
 	// Only allow one face adjacency list in a mesh
-	if (m_Meshes[iMesh].adjacencyIndices.size() > 0)
+	if (mesh.adjacencyIndices.size() > 0)
 	{
 		return kInvalidData;
 	}
 
-	// Get face adjacency data
-	const TUInt8* pAdjacencyData;
-	EImportError eError = LockXFileData( pXFileData, &pAdjacencyData );
-	if (eError != kSuccess)
+	// Read face adjacency list
+	TUInt32 iNumAdjacencyIndices;
+	if (!reader.ReadUInt( &iNumAdjacencyIndices ))
 	{
 		return kInvalidData;
 	}
-
-	// Read face adjacency list
-	TUInt32 iNumAdjacencyIndices;
-	ReadXFileLockedUInt( pAdjacencyData, &iNumAdjacencyIndices );
-	m_Meshes[iMesh].adjacencyIndices.resize( iNumAdjacencyIndices );
+	mesh.adjacencyIndices.resize( iNumAdjacencyIndices );
 	for (TUInt32 iIndex = 0; iIndex < iNumAdjacencyIndices; ++iIndex)
 	{
-		ReadXFileLockedUInt( pAdjacencyData, &m_Meshes[iMesh].adjacencyIndices[iIndex] );
+		if (!reader.ReadUInt( &mesh.adjacencyIndices[iIndex] ))
+		{
+			return kInvalidData;
+		}
 	}
 
-	// Finished with face adjacency data
-	pXFileData->Unlock();
-
-	return kSuccess;
+	return reader.ReadCloseBrace() ? kSuccess : kInvalidData;
 
 	GEN_ENDGUARD;
 }
@@ -1399,44 +1757,39 @@ EImportError CImportXFile::ReadAdjacencyData
 // Read skinning header mesh template
 EImportError CImportXFile::ReadSkinDefnData
 (
-	ID3DXFileData* pXFileData,
-	const TUInt32  iMesh
+	CXFileReader& reader,
+	const TUInt32 iMesh
 )
 {
 	GEN_GUARD;
 
+	SXFileMesh& mesh = m_Meshes[iMesh];
+
 	// Only allow one skining definition in a mesh
-	if (m_Meshes[iMesh].bones.size() > 0)
+	if (mesh.bones.size() > 0)
 	{
 		return kInvalidData;
 	}
 
-	// Get skinning definition data
-	const TUInt8* pSkinDefnData;
-	EImportError eError = LockXFileData( pXFileData, &pSkinDefnData );
-	if (eError != kSuccess)
+	// Read maximum weights info and number of bones used
+	TUInt32 iMaxBonesPerVertex, iMaxBonesPerFace, iNumBones;
+	if (!reader.ReadUInt( &iMaxBonesPerVertex ) || !reader.ReadUInt( &iMaxBonesPerFace ) ||
+	    !reader.ReadUInt( &iNumBones ) || !reader.ReadCloseBrace())
 	{
 		return kInvalidData;
 	}
+	mesh.iMaxBonesPerVertex = static_cast<TUInt16>(iMaxBonesPerVertex);
+	mesh.iMaxBonesPerFace = static_cast<TUInt16>(iMaxBonesPerFace);
 
-	// Read maximum weights info
-	ReadXFileLockedUInt16( pSkinDefnData, &m_Meshes[iMesh].iMaxBonesPerVertex );
-	ReadXFileLockedUInt16( pSkinDefnData, &m_Meshes[iMesh].iMaxBonesPerFace );
-
-	// Get number of bones used and initialise bone structures
-	TUInt16 iNumBones;
-	ReadXFileLockedUInt16( pSkinDefnData, &iNumBones );
+	// Initialise bone structures
 	for (TUInt32 iBone = 0; iBone < iNumBones; ++iBone)
 	{
 		SXFileBone bone;
 		bone.iFrame = 0;
 		bone.offsetMatrix = CMatrix4x4::kIdentity;
-		m_Meshes[iMesh].bones.push_back( bone );
+		mesh.bones.push_back( bone );
 	}
 
-	// Finished with skinning definition data
-	pXFileData->Unlock();
-
 	return kSuccess;
 
 	GEN_ENDGUARD;
@@ -1445,55 +1798,49 @@ EImportError CImportXFile::ReadSkinDefnData
 // Read a skinning weights mesh template
 EImportError CImportXFile::ReadSkinWeightsData
 (
-	ID3DXFileData* pXFileData,
-	const TUInt32  iMesh,
-	const TUInt32  iBone
+	CXFileReader& reader,
+	const TUInt32 iMesh,
+	const TUInt32 iBone
 )
 {
 	GEN_GUARD;
 
+	SXFileMesh& mesh = m_Meshes[iMesh];
+
 	// Check if no skinning definition or too many bones
-	if (m_Meshes[iMesh].bones.size() == 0 || iBone >= m_Meshes[iMesh].bones.size())
+	if (mesh.bones.size() == 0 || iBone >= mesh.bones.size())
 	{
 		return kInvalidData;
 	}
+	SXFileBone& bone = mesh.bones[iBone];
 
-	// Get skin weights data
-	const TUInt8* pSkinWeightData;
-	EImportError eError = LockXFileData( pXFileData, &pSkinWeightData );
-	if (eError != kSuccess)
+	// Read name of bone and number of weights
+	TUInt32 iNumWeights;
+	if (!reader.ReadString( bone.sFrameName ) || !reader.ReadUInt( &iNumWeights ))
 	{
 		return kInvalidData;
 	}
-
-	// Read name of bone
-	m_Meshes[iMesh].bones[iBone].sFrameName = reinterpret_cast<const char*>(pSkinWeightData);
-	pSkinWeightData += m_Meshes[iMesh].bones[iBone].sFrameName.length() + 1;
-
-	// Read number of weights
-	TUInt32 iNumWeights;
-	ReadXFileLockedUInt( pSkinWeightData, &iNumWeights );
-	m_Meshes[iMesh].bones[iBone].weights.resize( iNumWeights );
+	bone.weights.resize( iNumWeights );
 
 	// Read skinning indices, weights and offset matrix
 	for (TUInt32 iIndex = 0; iIndex < iNumWeights; ++iIndex)
 	{
-		ReadXFileLockedUInt( pSkinWeightData,
-		                     &m_Meshes[iMesh].bones[iBone].weights[iIndex].iVertexIndex );
+		if (!reader.ReadUInt( &bone.weights[iIndex].iVertexIndex ))
+		{
+			return kInvalidData;
+		}
 	}
-
 	for (TUInt32 iWeight = 0; iWeight < iNumWeights; ++iWeight)
 	{
-		TUInt8* pDest = 
-			reinterpret_cast<TUInt8*>(&m_Meshes[iMesh].bones[iBone].weights[iWeight].fWeight);
-		ReadXFileLockedData( pSkinWeightData, pDest, sizeof(TFloat32) );
+		if (!reader.ReadFloat( &bone.weights[iWeight].fWeight ))
+		{
+			return kInvalidData;
+		}
+	}
+	if (!reader.ReadFloats( &bone.offsetMatrix.e00, 16 ) || !reader.ReadCloseBrace())
+	{
+		return kInvalidData;
 	}
-
-	TUInt8* pDest = reinterpret_cast<TUInt8*>(&m_Meshes[iMesh].bones[iBone].offsetMatrix);
-	ReadXFileLockedData( pSkinWeightData, pDest, 16 * sizeof(TFloat32) );
-
-	// Finished with skin weight data
-	pXFileData->Unlock();
 
 	return kSuccess;
 
@@ -1502,423 +1849,342 @@ EImportError CImportXFile::ReadSkinWeightsData
 
 
 /*-----------------------------------------------------------------------------------------
-	X-File parsing
+	Geometry processing
 -----------------------------------------------------------------------------------------*/
 
-EImportError CImportXFile::GetXFileNumChildren
-(
-	ID3DXFileEnumObject* pXFileEnumer, 
-	TUInt32*             iNumChildren
-)
+namespace
 {
-	GEN_GUARD;
-
-	HRESULT xFileError = pXFileEnumer->GetChildren( reinterpret_cast<DWORD*>(iNumChildren) );
-	if (xFileError != S_OK)
-	{
-		return kInvalidData;
+	// Add attribute values to a vertex weld key. Values are used exactly (with -0 the same as 0),
+	// or if an inverse epsilon is given, as the index of the epsilon sized cell they fall in
+	void AddWeldKey
+	(
+		const TFloat32* pfValues,
+		const TUInt32   iNumValues,
+		const TFloat32  fInvEpsilon,
+		TUInt32*        piKey,
+		TUInt32*        piKeySize
+	)
+	{
+		for (TUInt32 iValue = 0; iValue < iNumValues; ++iValue)
+		{
+			TFloat32 fValue = pfValues[iValue];
+			TUInt32 iWord;
+			if (fInvEpsilon > 0.0f)
+			{
+				double fCell = floor( static_cast<double>(fValue) * fInvEpsilon );
+				if (!(fCell >= -2147483648.0)) fCell = -2147483648.0;
+				if (fCell > 2147483647.0) fCell = 2147483647.0;
+				iWord = static_cast<TUInt32>(static_cast<TInt32>(fCell));
+			}
+			else
+			{
+				if (fValue == 0.0f) fValue = 0.0f;
+				memcpy( &iWord, &fValue, sizeof(TUInt32) );
+			}
+			piKey[(*piKeySize)++] = iWord;
+		}
 	}
-
-	return kSuccess;
-
-	GEN_ENDGUARD;
 }
 
-EImportError CImportXFile::GetXFileNumChildren
+// Weld the vertices of a mesh - create one vertex for each distinct combination of position,
+// normal, UV and colour used by its faces and remap the faces to them. This also matches the
+// face lists of vertices and normals, so there is exactly one normal per vertex. See the
+// comment to SXFileMesh::normalFaces in the header file
+void CImportXFile::WeldVertices
 (
-	ID3DXFileData* pXFileData,
-	TUInt32*       iNumChildren
+	const TUInt32  iMesh
 )
 {
 	GEN_GUARD;
 
-	HRESULT xFileError = pXFileData->GetChildren( reinterpret_cast<DWORD*>(iNumChildren) );
-	if (xFileError != S_OK)
-	{
-		return kInvalidData;
-	}
+	CImportStageTimer weldTimer( m_pStats, kStageWeld );
 
-	return kSuccess;
+	// Unclutter code with a reference to the mesh 
+	SXFileMesh& mesh = m_Meshes[iMesh];
+	const bool bNormals = !mesh.normals.empty();
+	const bool bUVs = !mesh.textureCoords.empty();
+	const bool bColours = !mesh.vertexColours.empty();
+	const bool bSkinned = !mesh.bones.empty();
+	const TUInt32 iNumFileVertices = static_cast<TUInt32>(mesh.vertices.size());
+	const TUInt32 iNumCorners = static_cast<TUInt32>(mesh.faces.size()) * 3;
+	m_iNumFileVertices += iNumFileVertices;
+
+	// The mesh has just been read, count its lists and its size as the output of parsing
+	if (m_pStats)
+	{
+		TUInt32 iNumLists;
+		GetMeshDataSize( mesh, &iNumLists );
+		m_pStats->AddAllocations( iNumLists );
+		m_pStats->AddCounts( kStageParse, 0, iNumFileVertices, 0, mesh.faces.size() );
+	}
+
+	// Each vertex is identified by a key of its attribute values as 32-bit words. Bone weights
+	// refer to vertices in the file, so vertices of skinned meshes also include their file vertex
+	// index in the key and are only merged with copies of themselves
+	const TUInt32 kiMaxKeySize = 13;
+	const TUInt32 iKeySize = 3 + (bNormals ? 3 : 0) + (bUVs ? 2 : 0) + (bColours ? 4 : 0) +
+	                         (bSkinned ? 1 : 0);
+	const TFloat32 fInvEpsilon = (m_fWeldEpsilon > 0.0f) ? 1.0f / m_fWeldEpsilon : 0.0f;
+
+	// Open addressing hash table of welded vertices, at least twice the size of the maximum number
+	// of vertices. For each welded vertex store its key and the file vertex and normal it uses
+	const TUInt32 kiEmpty = 0xffffffff;
+	TUInt32 iTableSize = 16;
+	while (iTableSize < iNumCorners * 2)
+	{
+		iTableSize <<= 1;
+	}
+	TXFileInts hashTable( iTableSize, kiEmpty );
+	TXFileInts keys;
+	TXFileInts vertexMap;
+	TXFileInts normalMap;
+	keys.reserve( iNumCorners * iKeySize );
+	vertexMap.reserve( iNumCorners );
+	normalMap.reserve( iNumCorners );
+
+	// Most corners use the same file vertex and normal as an earlier corner, so remember the
+	// last normal and welded vertex used by each file vertex to avoid hashing those corners
+	TXFileInts lastNormal( iNumFileVertices, kiEmpty );
+	TXFileInts lastWelded( iNumFileVertices );
+
+	// Find or create a welded vertex for each face corner
+	TUInt32 aiKey[kiMaxKeySize];
+	for (TUInt32 iFace = 0; iFace < mesh.faces.size(); ++iFace)
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			TUInt32 iVertex = mesh.faces[iFace].aiVertex[i];
+			TUInt32 iNormal = bNormals ? mesh.normalFaces[iFace].aiVertex[i] : 0;
+			if (lastNormal[iVertex] == iNormal)
+			{
+				mesh.faces[iFace].aiVertex[i] = lastWelded[iVertex];
+				continue;
+			}
 
-	GEN_ENDGUARD;
-}
+			// Build key from the attributes of this corner
+			TUInt32 iKey = 0;
+			AddWeldKey( &mesh.vertices[iVertex].x, 3, fInvEpsilon, aiKey, &iKey );
+			if (bNormals)
+			{
+				AddWeldKey( &mesh.normals[iNormal].x, 3, fInvEpsilon, aiKey, &iKey );
+			}
+			if (bUVs)
+			{
+				AddWeldKey( &mesh.textureCoords[iVertex].fU, 2, fInvEpsilon, aiKey, &iKey );
+			}
+			if (bColours)
+			{
+				AddWeldKey( &mesh.vertexColours[iVertex].fRed, 4, fInvEpsilon, aiKey, &iKey );
+			}
+			if (bSkinned)
+			{
+				aiKey[iKey++] = iVertex;
+			}
 
+			// Hash the key and look for a matching vertex, linear probing
+			TUInt32 iHash = 2166136261u;
+			for (TUInt32 iWord = 0; iWord < iKeySize; ++iWord)
+			{
+				iHash = (iHash ^ aiKey[iWord]) * 16777619u;
+			}
+			iHash ^= iHash >> 15;
+			TUInt32 iSlot = iHash & (iTableSize - 1);
+			while (hashTable[iSlot] != kiEmpty &&
+			       memcmp( &keys[hashTable[iSlot] * iKeySize], aiKey, iKeySize * sizeof(TUInt32) ) != 0)
+			{
+				iSlot = (iSlot + 1) & (iTableSize - 1);
+			}
 
-EImportError CImportXFile::GetXFileChild
-(
-	ID3DXFileEnumObject* pXFileEnumer,
-	const TUInt32        iChild, 
-	ID3DXFileData**      ppChildData, 
-	GUID*                pChildGUID
-)
-{
-	GEN_GUARD;
+			// Add a new vertex if there was no match
+			if (hashTable[iSlot] == kiEmpty)
+			{
+				hashTable[iSlot] = static_cast<TUInt32>(vertexMap.size());
+				keys.insert( keys.end(), aiKey, aiKey + iKeySize );
+				vertexMap.push_back( iVertex );
+				normalMap.push_back( iNormal );
+			}
+			mesh.faces[iFace].aiVertex[i] = hashTable[iSlot];
+			lastNormal[iVertex] = iNormal;
+			lastWelded[iVertex] = hashTable[iSlot];
+		}
+	}
 
-	HRESULT xFileError = pXFileEnumer->GetChild( iChild, ppChildData );
-	if (xFileError != S_OK)
+	// Build the welded vertex data
+	const TUInt32 iNumVertices = static_cast<TUInt32>(vertexMap.size());
+	TXFileVectors vertices( iNumVertices );
+	for (TUInt32 iVertex = 0; iVertex < iNumVertices; ++iVertex)
 	{
-		GEN_ASSERT( xFileError != D3DXFERR_NOMOREOBJECTS, "Invalid child ID" );
-		return kInvalidData;
+		vertices[iVertex] = mesh.vertices[vertexMap[iVertex]];
+	}
+	mesh.vertices.swap( vertices );
+	if (bNormals)
+	{
+		TXFileVectors normals( iNumVertices );
+		for (TUInt32 iVertex = 0; iVertex < iNumVertices; ++iVertex)
+		{
+			normals[iVertex] = mesh.normals[normalMap[iVertex]];
+		}
+		mesh.normals.swap( normals );
+	}
+	if (bUVs)
+	{
+		TXFileUVs textureCoords( iNumVertices );
+		for (TUInt32 iVertex = 0; iVertex < iNumVertices; ++iVertex)
+		{
+			textureCoords[iVertex] = mesh.textureCoords[vertexMap[iVertex]];
+		}
+		mesh.textureCoords.swap( textureCoords );
+	}
+	if (bColours)
+	{
+		TXFileRGBAColours vertexColours( iNumVertices );
+		for (TUInt32 iVertex = 0; iVertex < iNumVertices; ++iVertex)
+		{
+			vertexColours[iVertex] = mesh.vertexColours[vertexMap[iVertex]];
+		}
+		mesh.vertexColours.swap( vertexColours );
 	}
 
-	xFileError = (*ppChildData)->GetType( pChildGUID );
-	GEN_ASSERT( xFileError == S_OK, "Failure getting X-File GUID" );
+	// Bone weights refer to file vertices, make them refer to every welded copy of the vertex
+	// instead. List the copies of each file vertex, indexed by the first copy of each one
+	if (bSkinned)
+	{
+		TXFileInts firstCopy( iNumFileVertices + 1, 0 );
+		for (TUInt32 iVertex = 0; iVertex < iNumVertices; ++iVertex)
+		{
+			++firstCopy[vertexMap[iVertex] + 1];
+		}
+		partial_sum( firstCopy.begin(), firstCopy.end(), firstCopy.begin() );
+		TXFileInts copies( iNumVertices );
+		TXFileInts nextCopy( firstCopy.begin(), firstCopy.end() - 1 );
+		for (TUInt32 iVertex = 0; iVertex < iNumVertices; ++iVertex)
+		{
+			copies[nextCopy[vertexMap[iVertex]]++] = iVertex;
+		}
 
-	return kSuccess;
+		for (TUInt32 iBone = 0; iBone < mesh.bones.size(); ++iBone)
+		{
+			TXFileBoneWeights weights;
+			const TXFileBoneWeights& fileWeights = mesh.bones[iBone].weights;
+			for (TUInt32 iWeight = 0; iWeight < fileWeights.size(); ++iWeight)
+			{
+				TUInt32 iFileVertex = fileWeights[iWeight].iVertexIndex;
+				if (iFileVertex < iNumFileVertices)
+				{
+					for (TUInt32 iCopy = firstCopy[iFileVertex]; iCopy < firstCopy[iFileVertex + 1]; ++iCopy)
+					{
+						SXFileBoneWeight weight = { copies[iCopy], fileWeights[iWeight].fWeight };
+						weights.push_back( weight );
+					}
+				}
+			}
+			mesh.bones[iBone].weights.swap( weights );
+		}
+	}
+	m_iNumWeldedVertices += iNumVertices;
+	if (m_pStats)
+	{
+		m_pStats->AddCounts( kStageWeld, iNumFileVertices, iNumVertices, mesh.faces.size(), mesh.faces.size() );
+	}
+
+	// Data only needed to match the file's face lists. The file's vertex duplication list no
+	// longer matches the vertices
+	mesh.origFaceEdges.clear();
+	mesh.normalFaces.clear();
+	mesh.duplicateIndices.clear();
 
 	GEN_ENDGUARD;
 }
 
-EImportError CImportXFile::GetXFileChild
+// Calculate the bounding box of the vertices of a mesh
+void CImportXFile::CalculateBounds
 (
-	ID3DXFileData*  pXFileData,
-	const TUInt32   iChild, 
-	ID3DXFileData** ppChildData, 
-	GUID*           pChildGUID
+	SXFileMesh& mesh
 )
 {
 	GEN_GUARD;
 
-	HRESULT xFileError = pXFileData->GetChild( iChild, ppChildData );
-	if (xFileError != S_OK)
-	{
-		GEN_ASSERT( xFileError != D3DXFERR_NOMOREOBJECTS, "Invalid child ID" );
-		return kInvalidData;
-	}
-
-	xFileError = (*ppChildData)->GetType( pChildGUID );
-	GEN_ASSERT( xFileError == S_OK, "Failure getting X-File GUID" );
-
-	return kSuccess;
+	CalculateBoundingBox( reinterpret_cast<const TUInt8*>(mesh.vertices.data()), sizeof(CVector3),
+	                      static_cast<TUInt32>(mesh.vertices.size()), &mesh.minBounds,
+	                      &mesh.maxBounds );
 
 	GEN_ENDGUARD;
 }
 
 
-EImportError CImportXFile::GetXFileDataName
+// Add bounds of a sub-mesh to the bounds of the frame that holds it
+void CImportXFile::AddFrameBounds
 (
-	ID3DXFileData* pXFileData,
-	string&        sName
+	const TUInt32      iFrame,
+	const SMeshBounds& bounds
 )
 {
 	GEN_GUARD;
 
-	DWORD iDataSize;
-	HRESULT xFileError = pXFileData->GetName( NULL, &iDataSize );
-	if (!iDataSize)
+	SXFileFrame& frame = m_Frames[iFrame];
+	if (frame.bHasMeshBounds)
 	{
-		sName = "";
+		MergeMeshBounds( frame.meshBounds, bounds, &frame.meshBounds );
 	}
 	else
 	{
-		char* szName = new char[iDataSize];
-		if (!szName)
-		{
-			return kOutOfSystemMemory;
-		}
-		xFileError = pXFileData->GetName( szName, &iDataSize );
-		GEN_ASSERT( xFileError == S_OK, "Failure getting X-File name" );
-		sName = szName;
-		delete[] szName;
+		frame.meshBounds = bounds;
+		frame.bHasMeshBounds = true;
 	}
 
-	return kSuccess;
-
 	GEN_ENDGUARD;
 }
 
 
-EImportError CImportXFile::LockXFileData
-(
-	ID3DXFileData* pXFileData,
-    const TUInt8** ppLockData,
-    TUInt32*       pSize /*= 0*/
-)
+// Create a global list of materials used by all the meshes - removing any duplicates. Also 
+// create a list for each mesh mapping local material indices to global ones
+void CImportXFile::MakeGlobalMaterialList()
 {
 	GEN_GUARD;
- 
-	DWORD iActualSize;
-	HRESULT xFileError = 
-		pXFileData->Lock( &iActualSize, reinterpret_cast<const void**>(ppLockData) );
-	GEN_ASSERT( xFileError == S_OK, "Unexpected failure in Lock" );
-	if (pSize)
+
+	// Process each mesh
+	for (TUInt32 iMesh = 0; iMesh < m_Meshes.size(); ++iMesh)
 	{
-		if (*pSize != 0 && *pSize != iActualSize)
+		// Meshes already passed on during a streaming import have their material map
+		if (m_Meshes[iMesh].materialMap.size() != m_Meshes[iMesh].materials.size())
 		{
-			pXFileData->Unlock();
-			return kInvalidData;
+			AddGlobalMaterials( m_Meshes[iMesh].materials, &m_Meshes[iMesh].materialMap );
 		}
-		*pSize = iActualSize;
 	}
 
-	return kSuccess;
-
-	GEN_ENDGUARD;
-}
-
-void CImportXFile::UnlockXFileData
-(
-	ID3DXFileData* pXFileData
-)
-{
-	GEN_GUARD;
- 
-	pXFileData->Unlock();
-
-	GEN_ENDGUARD;
-}
-
-
-EImportError CImportXFile::CopyXFileData
-(
-	ID3DXFileData* pXFileData,
-    TUInt8*        pDest,
-    TUInt32*       pSize
-)
-{
-	GEN_GUARD;
- 
-	const TUInt8* pLockData;
-	EImportError eError = LockXFileData( pXFileData, &pLockData, pSize );
-	if (eError != kSuccess)
-	{
-		return eError;
-	}
-	memcpy( pDest, pLockData, *pSize );
-	UnlockXFileData( pXFileData );
-
-	return kSuccess;
-
-	GEN_ENDGUARD;
-}
-
-void CImportXFile::ReadXFileLockedData
-(
-	const TUInt8*& pMeshData,
-	TUInt8*        pDest,
-	const TUInt32  iSize
-)
-{
-	GEN_GUARD;
- 
-	memcpy( pDest, pMeshData, iSize );
-	pMeshData += iSize;
-
 	GEN_ENDGUARD;
 }
 
-void CImportXFile::ReadXFileLockedUInt
+// Add the materials of a single mesh to the global material list, creating its material map
+void CImportXFile::AddGlobalMaterials
 (
-	const TUInt8*& pMeshData,
-	TUInt32*       piDest
+	const TXFileMaterials& materials,
+	TXFileInts*            pMaterialMap
 )
 {
 	GEN_GUARD;
- 
-	memcpy( piDest, pMeshData, 4 );
-	pMeshData += 4;
-
-	GEN_ENDGUARD;
-}
 
-void CImportXFile::ReadXFileLockedUInt16
-(
-	const TUInt8*& pMeshData,
-	TUInt16*       piDest
-)
-{
-	GEN_GUARD;
- 
-	memcpy( piDest, pMeshData, 2 );
-	pMeshData += 2;
-
-	GEN_ENDGUARD;
-}
-
-
-/*-----------------------------------------------------------------------------------------
-	X-file type support
------------------------------------------------------------------------------------------*/
-
-// Equality operator for SXFileMaterial structure (needed for searching material lists)
-bool operator==
-(
-	const CImportXFile::SXFileMaterial& cmp1,
-	const CImportXFile::SXFileMaterial& cmp2
-)
-{
-	return cmp1.faceColour.fRed == cmp2.faceColour.fRed &&
-	       cmp1.faceColour.fGreen == cmp2.faceColour.fGreen &&
-	       cmp1.faceColour.fBlue == cmp2.faceColour.fBlue &&
-	       cmp1.faceColour.fAlpha == cmp2.faceColour.fAlpha &&
-	       cmp1.fSpecularPower == cmp2.fSpecularPower &&
-	       cmp1.specularColour.fRed == cmp2.specularColour.fRed &&
-	       cmp1.specularColour.fGreen == cmp2.specularColour.fGreen &&
-	       cmp1.specularColour.fBlue == cmp2.specularColour.fBlue &&
-	       cmp1.emmisiveColour.fRed == cmp2.emmisiveColour.fRed &&
-	       cmp1.emmisiveColour.fGreen == cmp2.emmisiveColour.fGreen &&
-	       cmp1.emmisiveColour.fBlue == cmp2.emmisiveColour.fBlue &&
-		   cmp1.sTextureName == cmp2.sTextureName;
-}
+	CImportStageTimer materialsTimer( m_pStats, kStageMaterials );
 
-
-/*-----------------------------------------------------------------------------------------
-	Geometry processing
------------------------------------------------------------------------------------------*/
-
-// Match the face lists of vertices and normals, so there is exactly one normal per vertex
-// See the comment to SXFileMesh::normalFaces in the header file
-void CImportXFile::MatchFaceLists
-(
-	const TUInt32  iMesh
-)
-{
-	GEN_GUARD;
-
-	// Unclutter code with a reference to the mesh 
-	SXFileMesh& mesh = m_Meshes[iMesh];
-
-	if (!mesh.normals.empty())
+	// Initialise material map for this mesh and look through each of its materials
+	pMaterialMap->resize( materials.size() );
+	for (TUInt32 iMaterial = 0; iMaterial < materials.size(); ++iMaterial)
 	{
-		// Maximum vertices (and normals) possible is the total number of indices in the original
-		// face lists (if each index was different). Use std library accumulate from <numeric>
-		TUInt32 iMaxVertices = accumulate( mesh.origFaceEdges.begin(), 
-		                                   mesh.origFaceEdges.end(), 0 );
-
-		// Create empty vertex and normal maps - use max vertex value as unused marker
-		TXFileInts vertexMap( iMaxVertices, iMaxVertices );
-		TXFileInts normalMap( iMaxVertices, iMaxVertices );
-
-		// Table of vertex duplicates created by this process, each entry is next copy of vertex
-		TXFileInts vertexDup( iMaxVertices, iMaxVertices );
-
-		// May need to duplicate vertices, count from original number of vertices
-		TUInt32 iNewNumVertices = static_cast<TUInt32>(mesh.vertices.size()); 
-
-		// Create vertex and normal mapping tables
-		for (TUInt32 iFace = 0; iFace != mesh.faces.size(); ++iFace)
-		{
-			// Unclutter code with references to current faces (vertex and normal)
-			SXFileFace& vertexFace = mesh.faces[iFace];
-			SXFileFace& normalFace = mesh.normalFaces[iFace];
-
-			// For each face edge
-			for (int i = 0; i < 3; ++i)
-			{
-				// Will try to use vertex face index for the normal face index, if unused then OK
-				if (normalMap[vertexFace.aiVertex[i]] == iMaxVertices) 
-				{
-					// Use the vertex face index for both vertices and normals
-					vertexMap[vertexFace.aiVertex[i]] = vertexFace.aiVertex[i];
-					normalMap[vertexFace.aiVertex[i]] = normalFace.aiVertex[i];
-				}
-				// otherwise the vertex face index has already been used...
-				else
-				{
-					// See if the normal face index is correct for this vertex or the duplicates
-					// already created
-					TUInt32 iVert = vertexFace.aiVertex[i];
-					while (normalMap[iVert] != normalFace.aiVertex[i] &&
-					       vertexDup[iVert] != iMaxVertices)
-					{
-						iVert = vertexDup[iVert];
-					}
-					// Can't find correct normal face index on any of this vertices copies, so
-					// create another copy
-					if (normalMap[iVert] != normalFace.aiVertex[i])
-					{
-						// Add new vertex index
-						vertexMap[iNewNumVertices] = vertexFace.aiVertex[i];
-						normalMap[iNewNumVertices] = normalFace.aiVertex[i];
-						vertexDup[iVert] = iNewNumVertices;
-
-						// Update the face indices to point at this new vertex
-						vertexFace.aiVertex[i] = iNewNumVertices;
-						++iNewNumVertices;
-					}
-					else
-					{
-						// Update the face indices to point at appropriate vertex duplicate
-						vertexFace.aiVertex[i] = iVert;
-					}
-				}
-			}
-		}
+		// Intern the material in the table, identical materials from any file get the same id
+		SMeshMaterial material;
+		ConvertMaterial( materials[iMaterial], &material );
+		TUInt32 iMaterialId = m_pMaterialTable->InternMaterial( material );
 
-		// Add any required duplicate vertex data (if necessary)
-		TUInt32 iOldNumVertices = static_cast<TUInt32>(mesh.vertices.size());
-		if (iNewNumVertices > iOldNumVertices)
+		// Add new global material if this id hasn't been seen in this file, otherwise refer to
+		// the existing material
+		pair<unordered_map<TUInt32, TUInt32>::iterator, bool> inserted =
+			m_MaterialIndices.insert( make_pair( iMaterialId, static_cast<TUInt32>(m_Materials.size()) ) );
+		if (inserted.second)
 		{
-			// For every added vertex...
-			for (TUInt32 iVertex = iOldNumVertices; iVertex < iNewNumVertices; ++iVertex)
-			{
-				// Use the vertex map to duplicate the various vertex data
-				mesh.vertices.push_back( mesh.vertices[vertexMap[iVertex]] );
-				if (!mesh.textureCoords.empty())
-				{
-					mesh.textureCoords.push_back( mesh.textureCoords[vertexMap[iVertex]] );
-				}
-				if (!mesh.vertexColours.empty())
-				{
-					mesh.vertexColours.push_back( mesh.vertexColours[vertexMap[iVertex]] );
-				}
-				if (!mesh.duplicateIndices.empty())
-				{
-					mesh.duplicateIndices.push_back( mesh.duplicateIndices[vertexMap[iVertex]] );
-				}
-			}
-		}
-
-		// Build full updated normal list and replace original normals
-		TXFileVectors newNormals( iNewNumVertices );
-		for (TUInt32 iNormal = 0; iNormal < iNewNumVertices; ++iNormal)
-		{
-			newNormals[iNormal] = mesh.normals[normalMap[iNormal]];
-		}
-		mesh.normals.swap( newNormals );
-	}
-
-	mesh.origFaceEdges.clear();
-	mesh.normalFaces.clear();
-
-	GEN_ENDGUARD;
-}
-
-
-// Create a global list of materials used by all the meshes - removing any duplicates. Also 
-// create a list for each mesh mapping local material indices to global ones
-void CImportXFile::MakeGlobalMaterialList()
-{
-	GEN_GUARD;
-
-	// Process each mesh
-	for (TUInt32 iMesh = 0; iMesh < m_Meshes.size(); ++iMesh)
-	{
-		// Unclutter code with a reference to the mesh 
-		SXFileMesh& mesh = m_Meshes[iMesh];
-		
-		// Initialise material map for this mesh and look through each of its materials
-		mesh.materialMap.resize( mesh.materials.size() );
-		for (TUInt32 iMaterial = 0; iMaterial < mesh.materials.size(); ++iMaterial)
-		{
-			// See if this material is already in the global list
-			TXFileMaterials::iterator duplicate = find( m_Materials.begin(), m_Materials.end(), 
-														mesh.materials[iMaterial] );
-			
-			// If not found...
-			if (duplicate == m_Materials.end())
-			{
-				// ...add new global material...
-				mesh.materialMap[iMaterial] = static_cast<TUInt32>(m_Materials.size());
-				m_Materials.push_back( mesh.materials[iMaterial] );
-			}
-			else
-			{
-				// ...otherwise refer to existing material
-				mesh.materialMap[iMaterial] =
-					static_cast<TUInt32>(duplicate - m_Materials.begin());
-			}
+			m_Materials.push_back( materials[iMaterial] );
+			m_MaterialIds.push_back( iMaterialId );
 		}
+		(*pMaterialMap)[iMaterial] = inserted.first->second;
 	}
 
 	GEN_ENDGUARD;
@@ -1983,23 +2249,46 @@ EImportError CImportXFile::ProcessBones()
 
 	for (TUInt32 iMesh = 0; iMesh < m_Meshes.size(); ++iMesh)
 	{
-		for (TUInt32 iBone = 0; iBone < m_Meshes[iMesh].bones.size(); ++iBone)
+		EImportError eError = MatchBones( m_Meshes[iMesh] );
+		if (eError != kSuccess)
 		{
-			bool bFoundFrame = false;
-			for (TUInt32 iFrame = 0; iFrame < m_Frames.size(); ++iFrame)
-			{
-				if (m_Meshes[iMesh].bones[iBone].sFrameName == m_Frames[iFrame].sName)
-				{
-					m_Meshes[iMesh].bones[iBone].iFrame = iFrame;
-					bFoundFrame = true;
-					break;
-				}
-			}
-			if (!bFoundFrame)
+			return eError;
+		}
+	}
+
+	return kSuccess;
+
+	GEN_ENDGUARD;
+}
+
+// Match the bones in a single mesh to their frames
+// Possible return values:
+//		kInvalidData:		Could not find a frame matching one of the bones
+EImportError CImportXFile::MatchBones
+(
+	SXFileMesh& mesh
+)
+{
+	GEN_GUARD;
+
+	CImportStageTimer bonesTimer( m_pStats, kStageBones );
+
+	for (TUInt32 iBone = 0; iBone < mesh.bones.size(); ++iBone)
+	{
+		bool bFoundFrame = false;
+		for (TUInt32 iFrame = 0; iFrame < m_Frames.size(); ++iFrame)
+		{
+			if (mesh.bones[iBone].sFrameName == m_Frames[iFrame].sName)
 			{
-				return kInvalidData;
+				mesh.bones[iBone].iFrame = iFrame;
+				bFoundFrame = true;
+				break;
 			}
 		}
+		if (!bFoundFrame)
+		{
+			return kInvalidData;
+		}
 	}
 
 	return kSuccess;
@@ -2012,134 +2301,475 @@ EImportError CImportXFile::ProcessBones()
 	Mesh processing
 -----------------------------------------------------------------------------------------*/
 
-// Split each mesh into a set of meshes - each of which contains only a single material
+// Split each mesh into a set of meshes - each of which contains only a single material. If a
+// thread pool has been set, the meshes are split in parallel
 void CImportXFile::SplitMeshes()
 {
 	GEN_GUARD;
 
-	TUInt32 iNumOrigMeshes = static_cast<TUInt32>(m_Meshes.size());
-	for (TUInt32 iMesh = 0; iMesh < iNumOrigMeshes; ++iMesh)
+	CImportStageTimer splitTimer( m_pStats, kStageSplit );
+
+	// Each mesh is split into its own list, then the lists are joined in mesh order. Sub-meshes
+	// are moved into the final list by swapping, a mesh is never copied when a list grows (which
+	// would also leave the copied data behind in the arena)
+	vector<TXFileMeshes> meshSplits( m_Meshes.size() );
+	if (m_pThreadPool && m_Meshes.size() > 1)
 	{
-		TUInt32 iMaxVertices = static_cast<TUInt32>(m_Meshes[iMesh].vertices.size());
+		// The result is the same as splitting serially. The arena can't be shared between threads,
+		// so these meshes use the heap
+		vector< future<void> > splitResults;
+		splitResults.reserve( m_Meshes.size() );
+		for (TUInt32 iMesh = 0; iMesh < m_Meshes.size(); ++iMesh)
+		{
+			const SXFileMesh* pMesh = &m_Meshes[iMesh];
+			TXFileMeshes* pMeshSplit = &meshSplits[iMesh];
+			splitResults.push_back( m_pThreadPool->Submit( [pMesh, pMeshSplit]() { SplitMesh( *pMesh, pMeshSplit ); } ) );
+		}
 
-		for (TUInt32 iMaterial = 0; iMaterial < m_Meshes[iMesh].materials.size(); ++iMaterial)
+		// Wait for every task before checking for errors, the tasks refer to the lists above
+		for (TUInt32 iMesh = 0; iMesh < m_Meshes.size(); ++iMesh)
+		{
+			splitResults[iMesh].wait();
+		}
+		for (TUInt32 iMesh = 0; iMesh < m_Meshes.size(); ++iMesh)
 		{
-			SXFileMesh newMesh;
-			newMesh.iParentFrame = m_Meshes[iMesh].iParentFrame;
-			newMesh.materials.push_back( m_Meshes[iMesh].materials[iMaterial] );
-			newMesh.materialMap.push_back( m_Meshes[iMesh].materialMap[iMaterial] );
+			splitResults[iMesh].get(); // Rethrows any exception from the task
+		}
+	}
+	else
+	{
+		// Sub-meshes are released as they are passed on in a streaming import, so only use the
+		// arena for a full import
+		for (TUInt32 iMesh = 0; iMesh < m_Meshes.size(); ++iMesh)
+		{
+			SplitMesh( m_Meshes[iMesh], &meshSplits[iMesh], m_pCallback ? 0 : &m_SubMeshArena );
+		}
+	}
+
+	TUInt32 iNumSplitMeshes = 0;
+	TUInt64 iSplitBytes = 0;
+	for (TUInt32 iMesh = 0; iMesh < m_Meshes.size(); ++iMesh)
+	{
+		iNumSplitMeshes += static_cast<TUInt32>(meshSplits[iMesh].size());
+		iSplitBytes += RecordSplit( m_Meshes[iMesh], meshSplits[iMesh].data(),
+		                            static_cast<TUInt32>(meshSplits[iMesh].size()) );
+	}
+	RecordMeshMemory( iSplitBytes );
+	TXFileMeshes splitMeshes;
+	splitMeshes.reserve( iNumSplitMeshes );
+	for (TUInt32 iMesh = 0; iMesh < m_Meshes.size(); ++iMesh)
+	{
+		for (TUInt32 iSplit = 0; iSplit < meshSplits[iMesh].size(); ++iSplit)
+		{
+			splitMeshes.push_back( SXFileMesh() );
+			swap( splitMeshes.back(), meshSplits[iMesh][iSplit] );
+			AddFrameBounds( splitMeshes.back().iParentFrame, splitMeshes.back().bounds );
+		}
+	}
+	m_Meshes.swap( splitMeshes );
+
+	GEN_ENDGUARD;
+}
+
+// Split a single mesh into meshes that each contain a single material, appending them to the
+// given list. The faces are bucketed by material in one pass (a counting sort), so the cost is
+// proportional to the number of faces rather than faces x materials. Faces keep their original
+// order within each material and vertices are numbered in order of first use
+void CImportXFile::SplitMesh
+(
+	const SXFileMesh& mesh,
+	TXFileMeshes*     pOutMeshes,
+	CArena*           pArena /*= 0*/
+)
+{
+	GEN_GUARD;
+
+	TUInt32 iNumMaterials = static_cast<TUInt32>(mesh.materials.size());
+	TUInt32 iNumFaces = static_cast<TUInt32>(mesh.faceMaterials.size());
+
+	// Count the faces using each material, then get the start of each material's faces in a
+	// bucketed face list. Faces with an invalid material are left out
+	TXFileInts materialStarts( iNumMaterials + 1, 0 );
+	for (TUInt32 iFace = 0; iFace < iNumFaces; ++iFace)
+	{
+		if (mesh.faceMaterials[iFace] < iNumMaterials)
+		{
+			++materialStarts[mesh.faceMaterials[iFace] + 1];
+		}
+	}
+	for (TUInt32 iMaterial = 0; iMaterial < iNumMaterials; ++iMaterial)
+	{
+		materialStarts[iMaterial + 1] += materialStarts[iMaterial];
+	}
+	TXFileInts bucketEnds( materialStarts.begin(), materialStarts.end() - 1 );
+	TXFileInts bucketedFaces( materialStarts[iNumMaterials] );
+	for (TUInt32 iFace = 0; iFace < iNumFaces; ++iFace)
+	{
+		if (mesh.faceMaterials[iFace] < iNumMaterials)
+		{
+			bucketedFaces[bucketEnds[mesh.faceMaterials[iFace]]++] = iFace;
+		}
+	}
+
+	// Count the meshes that will be added so the list is only resized once
+	TUInt32 iNumNewMeshes = 0;
+	for (TUInt32 iMaterial = 0; iMaterial < iNumMaterials; ++iMaterial)
+	{
+		if (materialStarts[iMaterial + 1] > materialStarts[iMaterial])
+		{
+			++iNumNewMeshes;
+		}
+	}
+	pOutMeshes->reserve( pOutMeshes->size() + iNumNewMeshes );
 
-			TXFileInts vertexMap( iMaxVertices, iMaxVertices );
+	// One vertex map is shared by all materials. An entry is only valid if its stamp matches the
+	// current material, so the map never needs to be cleared. The source vertex of each new vertex
+	// is also kept so vertex data can be copied once the number of vertices is known
+	TUInt32 iMaxVertices = static_cast<TUInt32>(mesh.vertices.size());
+	TXFileInts vertexMap( iMaxVertices );
+	TXFileInts vertexStamps( iMaxVertices, 0 );
+	TXFileInts sourceVertices( iMaxVertices );
 
-			for (TUInt32 iFace = 0; iFace < m_Meshes[iMesh].faceMaterials.size(); ++iFace)
+	bool bNormals = mesh.normals.size() > 0;
+	bool bUVs = mesh.textureCoords.size() > 0;
+	bool bColours = mesh.vertexColours.size() > 0;
+	for (TUInt32 iMaterial = 0; iMaterial < iNumMaterials; ++iMaterial)
+	{
+		TUInt32 iFirstFace = materialStarts[iMaterial];
+		TUInt32 iNumMaterialFaces = materialStarts[iMaterial + 1] - iFirstFace;
+		if (iNumMaterialFaces == 0)
+		{
+			continue;
+		}
+		TUInt32 iStamp = iMaterial + 1;
+
+		// Build the new mesh in place in the output list
+		pOutMeshes->push_back( SXFileMesh( pArena ) );
+		SXFileMesh& newMesh = pOutMeshes->back();
+		newMesh.iParentFrame = mesh.iParentFrame;
+		newMesh.materials.push_back( mesh.materials[iMaterial] );
+		newMesh.materialMap.push_back( mesh.materialMap[iMaterial] );
+		newMesh.minBounds = mesh.minBounds;
+		newMesh.maxBounds = mesh.maxBounds;
+
+		// Remap the faces, numbering vertices in order of first use
+		newMesh.faces.resize( iNumMaterialFaces );
+		newMesh.faceMaterials.resize( iNumMaterialFaces, 0 );
+		TUInt32 iNumMaterialVertices = 0;
+		for (TUInt32 iFace = 0; iFace < iNumMaterialFaces; ++iFace)
+		{
+			const SXFileFace& face = mesh.faces[bucketedFaces[iFirstFace + iFace]];
+			SXFileFace& newFace = newMesh.faces[iFace];
+			for (TUInt32 iIndex = 0; iIndex < 3; ++iIndex)
 			{
-				if (m_Meshes[iMesh].faceMaterials[iFace] == iMaterial)
+				TUInt32 iVert = face.aiVertex[iIndex];
+				if (vertexStamps[iVert] != iStamp)
 				{
-					newMesh.faceMaterials.push_back( 0 );
-					SXFileFace newFace;
-					for (TUInt32 iIndex = 0; iIndex < 3; ++iIndex)
-					{
-						TUInt32 iVert = m_Meshes[iMesh].faces[iFace].aiVertex[iIndex];
-						if (vertexMap[iVert] == iMaxVertices)
-						{
-							vertexMap[iVert] = static_cast<TUInt32>(newMesh.vertices.size());
-							newMesh.vertices.push_back( m_Meshes[iMesh].vertices[iVert] );
-							if (m_Meshes[iMesh].normals.size() > 0)
-							{
-								newMesh.normals.push_back( m_Meshes[iMesh].normals[iVert] );
-							}
-							if (m_Meshes[iMesh].textureCoords.size() > 0)
-							{
-								newMesh.textureCoords.push_back( m_Meshes[iMesh].textureCoords[iVert] );
-							}
-							if (m_Meshes[iMesh].vertexColours.size() > 0)
-							{
-								newMesh.vertexColours.push_back( m_Meshes[iMesh].vertexColours[iVert] );
-							}
-						}
-						newFace.aiVertex[iIndex] = vertexMap[iVert];
-					}
-					newMesh.faces.push_back( newFace );
+					vertexStamps[iVert] = iStamp;
+					vertexMap[iVert] = iNumMaterialVertices;
+					sourceVertices[iNumMaterialVertices++] = iVert;
 				}
+				newFace.aiVertex[iIndex] = vertexMap[iVert];
 			}
-			if (newMesh.vertices.size() > 0)
+		}
+
+		// Copy the vertex data used by this material
+		newMesh.vertices.resize( iNumMaterialVertices );
+		for (TUInt32 iVert = 0; iVert < iNumMaterialVertices; ++iVert)
+		{
+			newMesh.vertices[iVert] = mesh.vertices[sourceVertices[iVert]];
+		}
+		CalculateMeshBounds( reinterpret_cast<const TUInt8*>(newMesh.vertices.data()),
+		                     sizeof(CVector3), iNumMaterialVertices, &newMesh.bounds );
+		if (bNormals)
+		{
+			newMesh.normals.resize( iNumMaterialVertices );
+			for (TUInt32 iVert = 0; iVert < iNumMaterialVertices; ++iVert)
 			{
-				m_Meshes.push_back( newMesh );
+				newMesh.normals[iVert] = mesh.normals[sourceVertices[iVert]];
+			}
+		}
+		if (bUVs)
+		{
+			newMesh.textureCoords.resize( iNumMaterialVertices );
+			for (TUInt32 iVert = 0; iVert < iNumMaterialVertices; ++iVert)
+			{
+				newMesh.textureCoords[iVert] = mesh.textureCoords[sourceVertices[iVert]];
+			}
+		}
+		if (bColours)
+		{
+			newMesh.vertexColours.resize( iNumMaterialVertices );
+			for (TUInt32 iVert = 0; iVert < iNumMaterialVertices; ++iVert)
+			{
+				newMesh.vertexColours[iVert] = mesh.vertexColours[sourceVertices[iVert]];
 			}
 		}
 	}
-	m_Meshes.erase( m_Meshes.begin(), m_Meshes.begin() + iNumOrigMeshes );
 
 	GEN_ENDGUARD;
 }
 
 
-// Create a list of tangent vectors for the given mesh. The tangent vector is the direction of
-// a vertex's texture U axis in model-space. Returns true on success
+// Create a list of tangents for the given mesh (see CalculateTangentFrames). The tangent is the
+// direction of a vertex's texture U axis in model-space, with the handedness of the texture space
+// in w. Returns false if the mesh has no normals or UVs, the tangents are then all the X axis
 bool CImportXFile::CalculateTangents
 (
-	TUInt32 iMesh,
-	TXFileVectors* pTangents
+	TUInt32         iMesh,
+	TXFileTangents* pTangents
 ) const
 {
+	GEN_GUARD;
+
+	CImportStageTimer tangentsTimer( m_pStats, kStageTangents );
+	const SXFileMesh& mesh = m_Meshes[iMesh];
+	if (m_pStats)
+	{
+		m_pStats->AddCounts( kStageTangents, mesh.vertices.size(), mesh.vertices.size(),
+		                     mesh.faces.size(), mesh.faces.size() );
+	}
+	pTangents->resize( mesh.vertices.size() );
+
 	// Normals and UVs are required for tangent calculation
-	if (!m_Meshes[iMesh].normals.size() || !m_Meshes[iMesh].textureCoords.size())
+	if (!mesh.normals.size() || !mesh.textureCoords.size())
 	{
+		pTangents->assign( mesh.vertices.size(), CVector4( 1.0f, 0.0f, 0.0f, 1.0f ) );
 		return false;
 	}
+	if (mesh.vertices.empty())
+	{
+		return true;
+	}
+
+	// UVs are laid out as a pair of floats, the same as a CVector2
+	CalculateTangentFrames( &mesh.vertices[0], &mesh.normals[0],
+	                        reinterpret_cast<const CVector2*>(&mesh.textureCoords[0]),
+	                        static_cast<TUInt32>(mesh.vertices.size()),
+	                        mesh.faces.empty() ? 0 : &mesh.faces[0].aiVertex[0],
+	                        static_cast<TUInt32>(mesh.faces.size()),
+	                        &(*pTangents)[0], m_pThreadPool );
+	return true;
+
+	GEN_ENDGUARD;
+}
 
-	pTangents->clear();
-	pTangents->resize( m_Meshes[iMesh].vertices.size(), CVector3::kOrigin );
 
-	// Step through faces
-	for (TUInt32 iFace = 0; iFace < m_Meshes[iMesh].faces.size(); ++iFace)
+/*-----------------------------------------------------------------------------------------
+	Streaming import
+-----------------------------------------------------------------------------------------*/
+
+// Called when a mesh has been parsed. When streaming, the mesh is processed and passed to the
+// callback then released (unless it is skinned, see ImportFile)
+EImportError CImportXFile::FinishMesh
+(
+	const TUInt32 iMesh
+)
+{
+	GEN_GUARD;
+
+	// Skinned meshes are kept until the end of the file, the frames their bones refer to may
+	// not have been read yet
+	if (!m_pCallback || m_Meshes[iMesh].bones.size() > 0)
 	{
-		int i1 = m_Meshes[iMesh].faces[iFace].aiVertex[0];
-		int i2 = m_Meshes[iMesh].faces[iFace].aiVertex[1];
-		int i3 = m_Meshes[iMesh].faces[iFace].aiVertex[2];
+		return kSuccess;
+	}
 
-		CVector3 v1 = m_Meshes[iMesh].vertices[i1];
-		CVector3 v2 = m_Meshes[iMesh].vertices[i2];
-		CVector3 v3 = m_Meshes[iMesh].vertices[i3];
+	// Take the mesh out of the list (it is always the last one) and split it into single-material
+	// meshes appended to the list. The intermediate data for the mesh is released after splitting.
+	// Streamed sub-meshes are also released straight away, so they use the heap not the arena
+	AddGlobalMaterials( m_Meshes[iMesh].materials, &m_Meshes[iMesh].materialMap );
+	TUInt32 iFirstSplitMesh = iMesh;
+	{
+		CImportStageTimer splitTimer( m_pStats, kStageSplit );
+		SXFileMesh mesh;
+		swap( mesh, m_Meshes[iMesh] );
+		m_Meshes.pop_back();
+		SplitMesh( mesh, &m_Meshes );
+		RecordSplit( mesh, m_Meshes.data() + iFirstSplitMesh,
+		             static_cast<TUInt32>(m_Meshes.size()) - iFirstSplitMesh );
+		RecordMeshMemory( GetMeshDataSize( mesh ) );
+	}
+	for (TUInt32 iSplitMesh = iFirstSplitMesh; iSplitMesh < m_Meshes.size(); ++iSplitMesh)
+	{
+		AddFrameBounds( m_Meshes[iSplitMesh].iParentFrame, m_Meshes[iSplitMesh].bounds );
+	}
 
-		SXFileUV uv1 = m_Meshes[iMesh].textureCoords[i1];
-		SXFileUV uv2 = m_Meshes[iMesh].textureCoords[i2];
-		SXFileUV uv3 = m_Meshes[iMesh].textureCoords[i3];
+	return StreamSubMeshes( iFirstSplitMesh );
 
-		CVector3 edge1 = v2 - v1;
-		CVector3 edge2 = v3 - v1;
+	GEN_ENDGUARD;
+}
 
-		TFloat32 s1 = uv2.fU - uv1.fU;
-		TFloat32 s2 = uv3.fU - uv1.fU;
-		TFloat32 t1 = uv2.fV - uv1.fV;
-		TFloat32 t2 = uv3.fV - uv1.fV;
+// Called when a frame has been parsed. When streaming, the frame is passed to the callback
+void CImportXFile::FinishFrame
+(
+	const TUInt32 iFrame
+)
+{
+	GEN_GUARD;
+
+	if (m_pCallback)
+	{
+		SMeshNode node;
+		GetNode( iFrame, &node );
+		m_pCallback->OnNode( iFrame, node );
+	}
 
-		CVector3 tangent;
-		TFloat32 denom = s1 * t2 - s2 * t1;
-		if (!gen::IsZero(denom))
+	GEN_ENDGUARD;
+}
+
+// Pass the given single-material meshes to the callback, then remove them from the mesh list
+// (the meshes must be at the end of the list). Materials not yet reported are passed first
+EImportError CImportXFile::StreamSubMeshes
+(
+	const TUInt32 iFirstMesh
+)
+{
+	GEN_GUARD;
+
+	// Report any new materials
+	while (m_iNumReportedMaterials < m_Materials.size())
+	{
+		SMeshMaterial material;
+		GetMaterial( m_iNumReportedMaterials, &material );
+		m_pCallback->OnMaterial( m_iNumReportedMaterials, material );
+		++m_iNumReportedMaterials;
+	}
+
+	// Pass each mesh to the callback with its vertex data built, releasing the data afterwards
+	for (TUInt32 iMesh = iFirstMesh; iMesh < m_Meshes.size(); ++iMesh)
+	{
+		CSubMeshData subMesh;
+		EImportError eError = GetSubMesh( iMesh, &subMesh, m_bCallbackTangents );
+		if (eError != kSuccess)
 		{
-			tangent = (t2 * edge1 - t1 * edge2) / (s1 * t2 - s2 * t1);
+			return eError;
 		}
-		else
+		m_pCallback->OnSubMesh( subMesh.Get() );
+	}
+	m_Meshes.erase( m_Meshes.begin() + iFirstMesh, m_Meshes.end() );
+
+	return kSuccess;
+
+	GEN_ENDGUARD;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Import statistics
+-----------------------------------------------------------------------------------------*/
+
+namespace
+{
+	// Add the memory held by a list to a total, counting the list if it holds any
+	template <class TList>
+	void AddListSize
+	(
+		const TList& list,
+		TUInt64*     pSize,
+		TUInt32*     pNumLists
+	)
+	{
+		if (list.capacity() > 0)
 		{
-			tangent = CVector3::kXAxis;
+			*pSize += list.capacity() * sizeof(typename TList::value_type);
+			++*pNumLists;
 		}
+	}
+}
+
+// Get the memory used by the lists of a mesh, optionally returning the number of lists that hold
+// memory (one allocation each)
+TUInt64 CImportXFile::GetMeshDataSize
+(
+	const SXFileMesh& mesh,
+	TUInt32*          pNumLists /*= 0*/
+)
+{
+	GEN_GUARD;
 
-		(*pTangents)[i1] += tangent;
-		(*pTangents)[i2] += tangent;
-		(*pTangents)[i3] += tangent;
+	TUInt64 iSize = 0;
+	TUInt32 iNumLists = 0;
+	AddListSize( mesh.vertices, &iSize, &iNumLists );
+	AddListSize( mesh.normals, &iSize, &iNumLists );
+	AddListSize( mesh.textureCoords, &iSize, &iNumLists );
+	AddListSize( mesh.vertexColours, &iSize, &iNumLists );
+	AddListSize( mesh.faces, &iSize, &iNumLists );
+	AddListSize( mesh.faceMaterials, &iSize, &iNumLists );
+	AddListSize( mesh.origFaceEdges, &iSize, &iNumLists );
+	AddListSize( mesh.normalFaces, &iSize, &iNumLists );
+	AddListSize( mesh.materials, &iSize, &iNumLists );
+	AddListSize( mesh.materialMap, &iSize, &iNumLists );
+	AddListSize( mesh.adjacencyIndices, &iSize, &iNumLists );
+	AddListSize( mesh.duplicateIndices, &iSize, &iNumLists );
+	AddListSize( mesh.bones, &iSize, &iNumLists );
+	for (TUInt32 iBone = 0; iBone < mesh.bones.size(); ++iBone)
+	{
+		AddListSize( mesh.bones[iBone].weights, &iSize, &iNumLists );
 	}
 
-	// Orthogonalise normals and tangents
-	for (TUInt32 iVert = 0; iVert < m_Meshes[iMesh].vertices.size(); ++iVert)
+	if (pNumLists)
 	{
-		// Gram-Schmidt orthogonalize
-		TFloat32 dot = Dot( m_Meshes[iMesh].normals[iVert], (*pTangents)[iVert] );
-		(*pTangents)[iVert] -= dot * m_Meshes[iMesh].normals[iVert];
-		(*pTangents)[iVert].Normalise();
+		*pNumLists = iNumLists;
 	}
+	return iSize;
 
-	return true;
+	GEN_ENDGUARD;
+}
+
+// Report the mesh data currently held to the import statistics, adding the given amount held
+// outside the mesh list
+void CImportXFile::RecordMeshMemory
+(
+	const TUInt64 iExtraBytes /*= 0*/
+) const
+{
+	GEN_GUARD;
+
+	if (!m_pStats)
+	{
+		return;
+	}
+	TUInt64 iBytes = iExtraBytes;
+	for (TUInt32 iMesh = 0; iMesh < m_Meshes.size(); ++iMesh)
+	{
+		iBytes += GetMeshDataSize( m_Meshes[iMesh] );
+	}
+	m_pStats->RecordMemory( iBytes );
+
+	GEN_ENDGUARD;
+}
+
+// Add a mesh and the meshes it was split into to the statistics of the split stage. Returns the
+// memory used by the split meshes
+TUInt64 CImportXFile::RecordSplit
+(
+	const SXFileMesh& mesh,
+	const SXFileMesh* pSplitMeshes,
+	const TUInt32     iNumSplitMeshes
+) const
+{
+	GEN_GUARD;
+
+	if (!m_pStats)
+	{
+		return 0;
+	}
+	TUInt64 iBytes = 0;
+	TUInt64 iNumVertices = 0;
+	TUInt64 iNumFaces = 0;
+	for (TUInt32 iSplitMesh = 0; iSplitMesh < iNumSplitMeshes; ++iSplitMesh)
+	{
+		TUInt32 iNumLists;
+		iBytes += GetMeshDataSize( pSplitMeshes[iSplitMesh], &iNumLists );
+		m_pStats->AddAllocations( iNumLists );
+		iNumVertices += pSplitMeshes[iSplitMesh].vertices.size();
+		iNumFaces += pSplitMeshes[iSplitMesh].faces.size();
+	}
+	m_pStats->AddCounts( kStageSplit, mesh.vertices.size(), iNumVertices, mesh.faces.size(), iNumFaces );
+	return iBytes;
+
+	GEN_ENDGUARD;
 }
 
 
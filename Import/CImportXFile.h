@@ -9,23 +9,44 @@
 
 	Change history:
 		V1.0    Created 12/06/06 - LN
+		V1.1    Native parser for text X-files, D3DX only used for other encodings
+		V1.2    Streaming import through a callback
+		V1.3    Hash-based vertex welding replaces face list matching
+		V1.4    Single pass material split, meshes can be split in parallel
+		V1.5    Tangents include handedness (float4), generated in parallel
+		V1.6    Materials interned in a table shared across imports
+		V1.7    Lazy import, mesh geometry read when first requested
+		V1.8    Sub-mesh data held in a per-import arena
+		V1.9    Native parsing of binary and compressed X-files
+		V1.10   Import statistics for each stage of the import
+		V1.11   Bounding box and sphere of each sub-mesh and node
+		V1.12   D3DX X-file API removed, files are only read by the native parsers
 **************************************************************************************************/
 
 #ifndef GEN_C_IMPORT_XFILE_H_INCLUDED
 #define GEN_C_IMPORT_XFILE_H_INCLUDED
 
 #include <vector>
+#include <map>
+#include <unordered_map>
 using namespace std;
-#include <d3d9.h>
-#include <d3dx9.h>
 
 #include "CVector3.h"
+#include "CVector4.h"
 #include "CMatrix4x4.h"
 #include "MeshData.h"
+#include "MeshBounds.h"
+#include "CMaterialTable.h"
+#include "CMappedFile.h"
+#include "CArena.h"
+#include "CImportStats.h"
 
 namespace gen
 {
 
+class CXFileReader;
+class CThreadPool;
+
 // List of errors returned from import functions
 enum EImportError
 {
@@ -37,6 +58,38 @@ enum EImportError
 };
 
 
+// Receives the contents of a file during a streaming import (see CImportXFile::ImportFile). Each
+// function is called as soon as that part of the file is complete. Data passed to the functions
+// is only valid during the call
+class CImportCallback
+{
+public:
+	virtual ~CImportCallback() {}
+
+	// A node in the hierarchy. Nodes are numbered depth-first as for GetNode, but each node is
+	// reported when it is complete, i.e. after its sub-meshes and child nodes. Skinned sub-meshes
+	// are held until the end of the file, so are not included in the bounds of the nodes
+	virtual void OnNode
+	(
+		const TUInt32    iNode,
+		const SMeshNode& node
+	) = 0;
+
+	// A material, reported before the first sub-mesh that uses it
+	virtual void OnMaterial
+	(
+		const TUInt32        iMaterial,
+		const SMeshMaterial& material
+	) = 0;
+
+	// A finished sub-mesh, its vertex and face data is freed when this function returns
+	virtual void OnSubMesh
+	(
+		const SSubMesh& subMesh
+	) = 0;
+};
+
+
 class CImportXFile
 {
 	GEN_CLASS( CImportXFile )
@@ -49,6 +102,17 @@ public:
 	CImportXFile()
 	{
 		m_bImported = false;
+		m_fWeldEpsilon = 0.0f;
+		m_bLazyImport = false;
+		m_iNumLazyMeshesLeft = 0;
+		m_iNumFileVertices = 0;
+		m_iNumWeldedVertices = 0;
+		m_pThreadPool = 0;
+		m_pMaterialTable = &CMaterialTable::GetShared();
+		m_pStats = 0;
+		m_pCallback = 0;
+		m_bCallbackTangents = false;
+		m_iNumReportedMaterials = 0;
 	}
 
 private:
@@ -71,19 +135,99 @@ public:
 		return m_bImported;
 	}
 
-	// Import a Microsoft X-File into a list of meshes and a frame hierarchy
+	// Import a Microsoft X-File into a list of meshes and a frame hierarchy. Text, binary and
+	// compressed (MSZip) files are read natively, any other encoding is rejected as invalid data
+	// If a callback is given the import is streamed: each node, material and sub-mesh is passed
+	// to the callback as soon as it has been read and processed, then the mesh data is released.
+	// Peak memory use is then bounded by the largest mesh in the file rather than the whole file.
+	// No sub-meshes are kept after a streaming import, but nodes and materials are. Skinned
+	// meshes are held until the end of the file as their bones may refer to later frames
 	// Possible return values:
 	//		kSuccess:			...
 	//		kFileError:			Missing file or not an X-file
 	//		kInvalidData:		The file could not be parsed correctly, or contains invalid data
 	//		kOutOfSystemMemory:	...
-	//		kSystemFailure:		X-file API failure
 	EImportError ImportFile
 	(
-		const string& sXName
+		const string&    sXName,
+		CImportCallback* pCallback = 0,
+		bool             bTangents = false
 	);
 
 
+	/////////////////////////////////////
+	// Import options and statistics
+
+	// Set the tolerance used to weld vertices during import. Vertices are merged if their
+	// positions, normals, UVs and colours fall in the same cells of this size. The default of 0
+	// only merges vertices that are exactly equal
+	void SetWeldEpsilon( const TFloat32 fEpsilon )
+	{
+		m_fWeldEpsilon = fEpsilon;
+	}
+
+	// Set whether files are imported lazily (default false). A lazy import only reads the frame
+	// hierarchy, the materials and the size and bounds of each mesh. The geometry of a mesh is
+	// read and processed the first time one of its sub-meshes is requested, so the hierarchy can
+	// be used for culling or LOD selection before paying for the geometry. The file stays mapped
+	// until all of its meshes have been read (a compressed file is kept decompressed in memory).
+	// Streaming imports are always read in full
+	void SetLazyImport( const bool bLazy )
+	{
+		m_bLazyImport = bLazy;
+	}
+
+	// Set a thread pool used to process the meshes of a file in parallel, or 0 (the default) to
+	// process them on the calling thread. The import waits for the pool's tasks, so the import
+	// must not itself be running as a task on the same pool
+	void SetThreadPool( CThreadPool* pThreadPool )
+	{
+		m_pThreadPool = pThreadPool;
+	}
+
+	// Set the table that materials are interned in, by default the shared table. Materials in any
+	// files imported with the same table are given the same id if they are identical
+	void SetMaterialTable( CMaterialTable* pMaterialTable )
+	{
+		m_pMaterialTable = pMaterialTable;
+	}
+
+	// Get the table that materials are interned in
+	CMaterialTable* GetMaterialTable() const
+	{
+		return m_pMaterialTable;
+	}
+
+	// Set statistics that imports add to, or 0 (the default) to collect none. Each import adds
+	// the time and the vertex / face counts of each stage, and the file size. Requests for
+	// sub-mesh data add their tangent and vertex data stages, so must not be made from several
+	// threads at once while statistics are set. Allocations and peak memory count the lists of
+	// mesh data held (lists of each mesh as read and of each sub-mesh it is split into), not
+	// temporary working memory
+	void SetImportStats( CImportStats* pStats )
+	{
+		m_pStats = pStats;
+	}
+
+	// Get the statistics that imports add to
+	CImportStats* GetImportStats() const
+	{
+		return m_pStats;
+	}
+
+	// Get the total number of vertices in the meshes of the last imported file, as given in the
+	// file and after welding. After a lazy import the welded count only includes the meshes
+	// that have been read so far
+	TUInt32 GetNumFileVertices() const
+	{
+		return m_iNumFileVertices;
+	}
+	TUInt32 GetNumWeldedVertices() const
+	{
+		return m_iNumWeldedVertices;
+	}
+
+
 	/////////////////////////////////////
 	// Data access
 
@@ -93,7 +237,9 @@ public:
 		return static_cast<TUInt32>(m_Frames.size());
 	}
 
-	// Get a single node from the mesh hierarchy (a frame in an X-File), returned through a pointer
+	// Get a single node from the mesh hierarchy (a frame in an X-File), returned through a pointer.
+	// The node's bounds enclose the bounds of its sub-meshes. After a lazy import they are made
+	// from the boxes of the file meshes, so the box is exact but the sphere may be larger
 	void GetNode
 	(
 		const TUInt32    iNode,
@@ -109,18 +255,65 @@ public:
 
 	// Get the render method used for the given sub-mesh
 	ERenderMethod GetSubMeshRenderMethod( const TUInt32 iSubMesh ) const;
+
+	// Get the bounding box of the given sub-mesh, returned through pointers. This is the box
+	// around the whole file mesh that the sub-mesh was split from, so it may be larger than the
+	// sub-mesh. Available without reading the geometry after a lazy import
+	void GetSubMeshBounds
+	(
+		const TUInt32 iSubMesh,
+		CVector3*     pMinBounds,
+		CVector3*     pMaxBounds
+	) const;
+
+	// Read and process the geometry of the file mesh that the given sub-mesh was split from, if
+	// not already done. Only needed after a lazy import, and called by the functions below that
+	// need the geometry, so it need only be called directly to choose when the work is done. As
+	// this changes the imported data, it must not be called at the same time as any other
+	// function on this object
+	// Possible return values:
+	//		kSuccess:			...
+	//		kInvalidData:		The mesh could not be parsed correctly, or contains invalid data
+	EImportError LoadSubMesh( const TUInt32 iSubMesh );
 		
-	// Get the specification and data for given submesh, returned through a pointer. May request
-	// tangents to be calculated
+	// Get the specification of given submesh without its data, returned through a pointer. The
+	// vertex and face pointers are set to 0. May request tangents to be included in the vertices.
+	// The bounds of the vertex positions are calculated when the file mesh is split, so they are
+	// always tight. After a lazy import, a sub-mesh whose geometry could not be read has no
+	// vertices or faces
+	void GetSubMeshLayout
+	(
+		const TUInt32 iSubMesh,
+		SSubMesh*     pSubMesh,
+		bool          bTangents = false
+	);
+
+	// Write the vertex and face data for given submesh into memory supplied by the caller, e.g. a
+	// mapped vertex buffer. The sub-mesh must have been filled in by GetSubMeshLayout, then its
+	// vertex and face pointers set to space for numVertices * vertexSize bytes and numFaces faces
+	// (numFaces * 3 * indexSize bytes)
 	// Possible return values:
 	//		kSuccess:			...
 	//		kOutOfSystemMemory:	...
-	EImportError CImportXFile::GetSubMesh
+	//		kInvalidData:		Lazy import only, the geometry could not be read (see LoadSubMesh)
+	EImportError GetSubMeshData
+	(
+		const TUInt32   iSubMesh,
+		const SSubMesh& subMesh
+	);
+
+	// Get the specification and data for given submesh, returned through a pointer to an object
+	// that owns the data. May request tangents to be calculated
+	// Possible return values:
+	//		kSuccess:			...
+	//		kOutOfSystemMemory:	...
+	//		kInvalidData:		Lazy import only, the geometry could not be read (see LoadSubMesh)
+	EImportError GetSubMesh
 	(
 		const TUInt32 iSubMesh,
-		SSubMesh*     pSubMesh,
+		CSubMeshData* pSubMesh,
 		bool          bTangents = false
-	) const;
+	);
 
 
 	// Get the number of materials used in the mesh (across all submeshes - i.e. in all meshes
@@ -149,6 +342,16 @@ public:
 		SMeshMaterial* const pMaterial
 	) const;
 
+	// Get the id of a given material in the material table (see SetMaterialTable). The id is
+	// stable across imports, so can be used to share material state between files
+	TUInt32 GetMaterialId
+	(
+		const TUInt32 iMaterial
+	) const
+	{
+		return m_MaterialIds[iMaterial];
+	}
+
 
 	// TODO: bones
 
@@ -176,16 +379,17 @@ private:
 	/////////////////////////////////////
 	// X-File types
 
-	// Container types used
-	typedef vector<TUInt32>  TXFileInts;
-	typedef vector<CVector3> TXFileVectors;
+	// Container types used. The lists held by meshes can take their memory from an arena
+	typedef vector< TUInt32, CArenaAllocator<TUInt32> >   TXFileInts;
+	typedef vector< CVector3, CArenaAllocator<CVector3> > TXFileVectors;
+	typedef vector<CVector4> TXFileTangents; // Tangent in x, y & z, handedness in w
 
 	// Single face in an X-file - three vertex indices (will convert all faces to triangles)
 	struct SXFileFace
 	{
 		TUInt32 aiVertex[3];
 	};
-	typedef vector<SXFileFace> TXFileFaces;
+	typedef vector< SXFileFace, CArenaAllocator<SXFileFace> > TXFileFaces;
 
 
 	// 2D texture coordinate in an X-file
@@ -194,7 +398,7 @@ private:
 		TFloat32 fU;
 		TFloat32 fV;
 	};
-	typedef vector<SXFileUV> TXFileUVs;
+	typedef vector< SXFileUV, CArenaAllocator<SXFileUV> > TXFileUVs;
 
 
 	// RGB colour used in structures below
@@ -213,7 +417,7 @@ private:
 		TFloat32 fBlue;
 		TFloat32 fAlpha;
 	};
-	typedef vector<SXFileRGBAColour> TXFileRGBAColours;
+	typedef vector< SXFileRGBAColour, CArenaAllocator<SXFileRGBAColour> > TXFileRGBAColours;
 
 
 	// Material used in an X-file, material name, diffuse, specular and emmisive colours and a
@@ -227,14 +431,10 @@ private:
 		SXFileRGBColour  emmisiveColour;
 		string           sTextureName;
 	};
-	typedef vector<SXFileMaterial> TXFileMaterials;
+	typedef vector< SXFileMaterial, CArenaAllocator<SXFileMaterial> > TXFileMaterials;
 
-	// Equality operator for SXFileMaterial structure (needed for searching material lists)
-	friend bool operator==
-	(
-		const SXFileMaterial& cmp1,
-		const SXFileMaterial& cmp2
-	);
+	// Top-level materials in an X-file, looked up by name when referenced from a mesh
+	typedef map<string, SXFileMaterial> TXFileNamedMaterials;
 
 
 	// Single bone weight as used in the bone structure below, contains the index of the affected
@@ -263,12 +463,22 @@ private:
 	// Frame in an X-file hierarchy
 	struct SXFileFrame
 	{
-		string     sName;
-		TUInt32    iDepth;
-		TUInt32    iParentIndex;
-		TUInt32    iNumChildren;
-		CMatrix4x4 defaultMatrix; // TODO: Would like aligned matrices - but vector can't do it
-		CMatrix4x4 offsetMatrix;
+		SXFileFrame()
+		{
+			MeshBoundsFromBox( CVector3::kZero, CVector3::kZero, &meshBounds );
+			bHasMeshBounds = false;
+		}
+
+		string      sName;
+		TUInt32     iDepth;
+		TUInt32     iParentIndex;
+		TUInt32     iNumChildren;
+		CMatrix4x4  defaultMatrix; // TODO: Would like aligned matrices - but vector can't do it
+		CMatrix4x4  offsetMatrix;
+
+		// Bounds of the sub-meshes held by this frame (see AddFrameBounds), zero if it has none
+		SMeshBounds meshBounds;
+		bool        bHasMeshBounds;
 	};
 	typedef vector<SXFileFrame> TXFileFrames;
 
@@ -276,6 +486,22 @@ private:
 	// A single mesh in an X-File
 	struct SXFileMesh
 	{
+		// Constructor - the lists take their memory from the given arena, or the heap if none
+		explicit SXFileMesh( CArena* pArena = 0 )
+			: vertices( pArena ), normals( pArena ), textureCoords( pArena ), vertexColours( pArena ),
+			  faces( pArena ), faceMaterials( pArena ), origFaceEdges( pArena ), normalFaces( pArena ),
+			  materials( pArena ), materialMap( pArena ), adjacencyIndices( pArena ),
+			  duplicateIndices( pArena )
+		{
+			iParentFrame = 0;
+			iNumUniqueVertices = 0;
+			iMaxBonesPerVertex = 0;
+			iMaxBonesPerFace = 0;
+			minBounds = CVector3::kZero;
+			maxBounds = CVector3::kZero;
+			MeshBoundsFromBox( CVector3::kZero, CVector3::kZero, &bounds );
+		}
+
 		// Index of frame that holds this mesh
 		TUInt32           iParentFrame;
 
@@ -317,7 +543,9 @@ private:
 		// list CImportXFile::m_Materials
 		TXFileInts        materialMap;
 
-		// Adjacency data - usage unknown - TODO
+		// Adjacency data from the file (FaceAdjacency template, three neighbouring faces per face) - read
+		// but not used. It refers to the file's faces before welding and splitting, so edge adjacency
+		// is built on the final sub-meshes instead (see BuildEdgeAdjacency in MeshEdges.h)
 		TXFileInts        adjacencyIndices;
 
 		// Vertex duplication list - a per-vertex list of integers - each one the index of the 
@@ -334,254 +562,344 @@ private:
 		TUInt16           iMaxBonesPerVertex;
 		TUInt16           iMaxBonesPerFace;
 		TXFileBones       bones;
+
+		// Bounding box of the vertices of the mesh as given in the file. Meshes split from a mesh
+		// keep its bounds
+		CVector3          minBounds;
+		CVector3          maxBounds;
+
+		// Bounds of the vertices of a mesh split to a single material, calculated when it is split.
+		// The sub-mesh placeholders of a lazy import use the box above until they are read
+		SMeshBounds       bounds;
 	};
 	typedef vector<SXFileMesh> TXFileMeshes;
 
+	// A mesh in a lazily imported file. Holds what is needed to read the mesh later and to
+	// create its sub-meshes before it is read
+	struct SXFileLazyMesh
+	{
+		// Index of frame that holds this mesh, offset of the mesh data in the file (just after the
+		// opening brace)
+		TUInt32      iParentFrame;
+		TUInt32      iDataOffset;
+
+		// Number of vertices and faces (triangles) in the file, and bounding box of the vertices
+		TUInt32      iNumVertices;
+		TUInt32      iNumFaces;
+		CVector3     minBounds;
+		CVector3     maxBounds;
+
+		// Map from the mesh's material indexes to the global material list
+		TXFileInts   materialMap;
+
+		// The sub-meshes this mesh is split into, one for each material used by its faces
+		TUInt32      iFirstSubMesh;
+		TUInt32      iNumSubMeshes;
+
+		// Whether the mesh has been read and the result of reading it
+		bool         bLoaded;
+		EImportError eLoadError;
+	};
+	typedef vector<SXFileLazyMesh> TXFileLazyMeshes;
+
 
 	/////////////////////////////////////
-	// X-File API support
+	// Native X-File parsing
+	// Native parsing of the text and binary encodings. Each function reads the members and
+	// children of a data object whose header has been read, and consumes its closing brace
 
-	// Prepare and return an X-file object
-	// Possible return values:
-	//		kSuccess:			...
-	//		kOutOfSystemMemory:	...
-	//		kSystemFailure:		Problem registering X-file templates or other API error
-	EImportError PrepareXFileObject
+	// Parse a complete X-file into the frame hierarchy and meshes. Creates a single root frame,
+	// with all the top level frames and meshes as children of it
+	EImportError ParseXFile
 	(
-		ID3DXFile** ppXFile
+		CXFileReader& reader
 	);
 
-	// Prepare and return an X-file enumerator given a filename and an X-file object
-	// Possible return values:
-	//		kSuccess:			...
-	//		kInvalidData:		The file could not be parsed correctly, or contains invalid data
-	//		kSystemFailure:		X-file API error
-	EImportError GetXFileEnumerator
+	// Parse a frame and its child frames and meshes
+	EImportError ParseXFileFrame
 	(
-		const string&         sFilename,
-		ID3DXFile*            pXFile,
-		ID3DXFileEnumObject** ppXFileEnumer
+		CXFileReader& reader,
+		const string& sName,
+		const TUInt32 iParentFrame
 	);
 
-
-	/////////////////////////////////////
-	// X-File parsing
-
-	// Create a single root frame and parse the X-File to add all the bottom level frames and
-	// meshes. Any frames and meshes found will be children of this root frame, child frames are
-	// recursively parsed to create a frame hierarchy
-	// Possible return values:
-	//		kInvalidData:		The file could not be parsed correctly, or contains invalid data
-	EImportError ParseXFile
+	// Parse a mesh and its child data
+	EImportError ParseXFileMesh
 	(
-		ID3DXFileEnumObject* pXFileEnumer
+		CXFileReader& reader,
+		const TUInt32 iCurrFrame
 	);
 
-	// Create a new frame and parse the X-File to add all the contained frames and meshes. Any
-	// frames and meshes found will become children of this new frame. Child frames are recursively
-	// parsed to create a frame hierarchy
-	// Possible return values:
-	//		kInvalidData:		The file could not be parsed correctly, or contains invalid data
-	EImportError ParseXFileFrame
+	// Scan a mesh during a lazy import, reading its size, bounds and materials and skipping
+	// the rest. Adds a lazy mesh and placeholders for its sub-meshes
+	EImportError ScanXFileMesh
 	(
-		ID3DXFileData* pXFileData,
-		const TUInt32  iParentFrame
+		CXFileReader& reader,
+		const TUInt32 iCurrFrame
 	);
 
-
-	// X-File parsing - collect mesh data
-	EImportError ParseXFileMesh
+	// Read and process a mesh found by ScanXFileMesh, replacing its sub-mesh placeholders
+	EImportError LoadLazyMesh
 	(
-		ID3DXFileData* pXFileData,
-		const TUInt32  iCurrFrame
+		const TUInt32 iLazyMesh
 	);
 
+	// Read the members of a FrameTransformMatrix template
+	EImportError ReadFrameMatrix
+	(
+		CXFileReader& reader,
+		CMatrix4x4*   pMatrix
+	);
 
-	/////////////////////////////////////
-	// X-File template parsing
+	// Read a material template and its texture filename child
+	EImportError ReadMaterial
+	(
+		CXFileReader&   reader,
+		const string&   sName,
+		SXFileMaterial* pMaterial
+	);
 
 	// Read vertex and face data from a mesh template
 	EImportError ReadMeshData
 	(
-		ID3DXFileData* pXFileData,
-		const TUInt32  iMesh
+		CXFileReader& reader,
+		const TUInt32 iMesh
 	);
 
 	// Read a normal data mesh template
 	EImportError ReadNormalData
 	(
-		ID3DXFileData* pXFileData,
-		const TUInt32  iMesh
+		CXFileReader& reader,
+		const TUInt32 iMesh
 	);
 
 	// Read a texture coordinate mesh template
 	EImportError ReadTextureUVData
 	(
-		ID3DXFileData* pXFileData,
-		const TUInt32  iMesh
+		CXFileReader& reader,
+		const TUInt32 iMesh
 	);
 
 	// Read a vertex colour mesh template
 	EImportError ReadVertexColourData
 	(
-		ID3DXFileData* pXFileData,
-		const TUInt32  iMesh
+		CXFileReader& reader,
+		const TUInt32 iMesh
 	);
 
-	// Read a vertex colour mesh template
+	// Read a material list mesh template
 	EImportError ReadMaterialData
 	(
-		ID3DXFileData* pXFileData,
-		const TUInt32  iMesh
+		CXFileReader& reader,
+		const TUInt32 iMesh
+	);
+
+	// Read the materials in a material list template, which follow the face materials
+	EImportError ReadMaterialList
+	(
+		CXFileReader&    reader,
+		const TUInt32    iNumMaterials,
+		TXFileMaterials* pMaterials
 	);
 
 	// Read a vertex duplication mesh template
 	EImportError ReadDuplicationData
 	(
-		ID3DXFileData* pXFileData,
-		const TUInt32  iMesh
+		CXFileReader& reader,
+		const TUInt32 iMesh
 	);
 
 	// Read a adjacancy data mesh template
 	EImportError ReadAdjacencyData
 	(
-		ID3DXFileData* pXFileData,
-		const TUInt32  iMesh
+		CXFileReader& reader,
+		const TUInt32 iMesh
 	);
 
 	// Read skinning header mesh template
 	EImportError ReadSkinDefnData
 	(
-		ID3DXFileData* pXFileData,
-		const TUInt32  iMesh
+		CXFileReader& reader,
+		const TUInt32 iMesh
 	);
 
 	// Read a skinning weights mesh template
 	EImportError ReadSkinWeightsData
 	(
-		ID3DXFileData* pXFileData,
-		const TUInt32  iMesh,
-		const TUInt32  iBone
+		CXFileReader& reader,
+		const TUInt32 iMesh,
+		const TUInt32 iBone
 	);
 
-
-	/////////////////////////////////////
-	// X-File parsing support
-
-	EImportError GetXFileNumChildren
+	// Read a list of polygonal faces, converting them to triangles. The number of edges of each
+	// face is appended to pFaceEdges, or if pMatchEdges is given it is checked against it instead
+	bool ReadFaceList
 	(
-		ID3DXFileEnumObject* pXFileEnumer, 
-		TUInt32*             iNumChildren
+		CXFileReader&     reader,
+		const TUInt32     iNumVertices,
+		TXFileFaces*      pFaces,
+		TXFileInts*       pFaceEdges,
+		const TXFileInts* pMatchEdges
 	);
 
-	EImportError GetXFileNumChildren
-	(
-		ID3DXFileData* pXFileData,
-		TUInt32*       iNumChildren
-	);
 
+	/////////////////////////////////////
+	// Geometry processing
 
-	EImportError GetXFileChild
+	// Weld the vertices of a mesh - create one vertex for each distinct combination of position,
+	// normal, UV and colour used by its faces and remap the faces to them. This also matches the
+	// face lists of vertices and normals, so there is exactly one normal per vertex. See the
+	// comment to SXFileMesh::normalFaces above
+	void WeldVertices
 	(
-		ID3DXFileEnumObject* pXFileEnumer,
-		const TUInt32        iChild, 
-		ID3DXFileData**      ppChildData, 
-		GUID*                pChildGUID
+		const TUInt32  iMesh
 	);
 
-	EImportError GetXFileChild
+	// Calculate the bounding box of the vertices of a mesh
+	static void CalculateBounds
 	(
-		ID3DXFileData*  pXFileData,
-		const TUInt32   iChild, 
-		ID3DXFileData** ppChildData, 
-		GUID*           pChildGUID
+		SXFileMesh& mesh
 	);
 
-
-	EImportError GetXFileDataName
+	// Add bounds of a sub-mesh to the bounds of the frame that holds it. Called for each sub-mesh
+	// as it is created by splitting, or for each mesh found by a lazy import
+	void AddFrameBounds
 	(
-		ID3DXFileData* pXFileData,
-		string&        sName
+		const TUInt32      iFrame,
+		const SMeshBounds& bounds
 	);
 
+	// Create a global list of materials used by all the meshes - removing any duplicates. Also 
+	// create a list for each mesh mapping local material indices to global ones
+	void MakeGlobalMaterialList();
 
-	EImportError LockXFileData
+	// Add the materials of a single mesh to the global material list, creating its material map
+	void AddGlobalMaterials
 	(
-		ID3DXFileData* pXFileData,
-		const TUInt8** ppLockData,
-		TUInt32*       pSize = 0
+		const TXFileMaterials& materials,
+		TXFileInts*            pMaterialMap
 	);
 
-	void UnlockXFileData
+	// Get the render method used for an X-file material, optionally return the number of textures
+	// used by the method (see GetMaterialRenderMethod)
+	static ERenderMethod GetRenderMethod
 	(
-		ID3DXFileData* pXFileData
+		const SXFileMaterial& xFileMaterial,
+		TUInt32*              pNumTextures = 0
 	);
 
-	EImportError CopyXFileData
+	// Convert an X-file material to the material specification returned by GetMaterial
+	static void ConvertMaterial
 	(
-		ID3DXFileData* pXFileData,
-		TUInt8*        pDest,
-		TUInt32*       pSize
+		const SXFileMaterial& xFileMaterial,
+		SMeshMaterial* const  pOutMaterial
 	);
 
-	void ReadXFileLockedData
-	(
-		const   TUInt8*& pMeshData,
-		TUInt8*	         pDest,
-		const   TUInt32  iSize
-	);
 
-	void ReadXFileLockedUInt
-	(
-		const TUInt8*& pMeshData,
-		TUInt32*       piDest
-	);
+	/////////////////////////////////////
+	// Bone support functions
+
+	// Add new bone weight/index to a vertex - maximum of 4, removes least signficant if necessary
+	static void AddBoneInfluence( TUInt32 bone, TFloat32 weight,
+	                              TFloat32* vertWeights, TUInt8* vertBones );
 
-	void ReadXFileLockedUInt16
+	// Match the bones in each mesh to their frames
+	EImportError ProcessBones();
+
+	// Match the bones in a single mesh to their frames
+	EImportError MatchBones
 	(
-		const TUInt8*& pMeshData,
-		TUInt16*       piDest
+		SXFileMesh& mesh
 	);
 
 
 	/////////////////////////////////////
-	// Geometry processing
+	// Mesh processing
+
+	// Split each mesh into a set of meshes - each of which contains only a single material. If a
+	// thread pool has been set, the meshes are split in parallel
+	void SplitMeshes();
 
-	// Match the face lists of vertices and normals, so there is exactly one normal per vertex
-	// See the comment to SXFileMesh::normalFaces above
-	void MatchFaceLists
+	// Split a single mesh into meshes that each contain a single material, appending them to the
+	// given list. The new meshes take their memory from the given arena, or the heap if none.
+	// Only uses the given mesh and arena, so can be called for several meshes at once
+	static void SplitMesh
 	(
-		const TUInt32  iMesh
+		const SXFileMesh& mesh,
+		TXFileMeshes*     pOutMeshes,
+		CArena*           pArena = 0
 	);
 
-	// Create a global list of materials used by all the meshes - removing any duplicates. Also 
-	// create a list for each mesh mapping local material indices to global ones
-	void MakeGlobalMaterialList();
+	// Write the vertices of the given mesh to a raw vertex stream. There is an instantiation for
+	// each combination of vertex components so there are no tests in the per-vertex loop
+	template <bool kbSkinning, bool kbNormals, bool kbTangents, bool kbUVs, bool kbColours>
+	static void InterleaveVertices
+	(
+		const SXFileMesh&     mesh,
+		const TXFileTangents& tangents,
+		TUInt8*               pVertices
+	);
+
+	// Create a list of tangents for the given mesh (see CalculateTangentFrames). The tangent is the
+	// direction of a vertex's texture U axis in model-space, with the handedness of the texture
+	// space in w. Returns false if the mesh has no normals or UVs, the tangents are then all the
+	// X axis
+	bool CalculateTangents
+	(
+		TUInt32         iMesh,
+		TXFileTangents* pTangents
+	) const;
 
 
 	/////////////////////////////////////
-	// Bone support functions
+	// Streaming import
 
-	// Add new bone weight/index to a vertex - maximum of 4, removes least signficant if necessary
-	static void AddBoneInfluence( TUInt32 bone, TFloat32 weight,
-	                              TFloat32* vertWeights, TUInt8* vertBones );
+	// Called when a mesh has been parsed. When streaming, the mesh is processed and passed to the
+	// callback then released (unless it is skinned, see ImportFile)
+	EImportError FinishMesh
+	(
+		const TUInt32 iMesh
+	);
 
-	// Match the bones in each mesh to their frames
-	EImportError ProcessBones();
+	// Called when a frame has been parsed. When streaming, the frame is passed to the callback
+	void FinishFrame
+	(
+		const TUInt32 iFrame
+	);
+
+	// Pass the given single-material meshes to the callback, then remove them from the mesh list
+	// (the meshes must be at the end of the list). Materials not yet reported are passed first
+	EImportError StreamSubMeshes
+	(
+		const TUInt32 iFirstMesh
+	);
 
 
 	/////////////////////////////////////
-	// Mesh processing
+	// Import statistics
 
-	// Split each mesh into a set of meshes - each of which contains only a single material
-	void SplitMeshes();
+	// Get the memory used by the lists of a mesh, optionally returning the number of lists that
+	// hold memory (one allocation each)
+	static TUInt64 GetMeshDataSize
+	(
+		const SXFileMesh& mesh,
+		TUInt32*          pNumLists = 0
+	);
 
-	// Create a list of tangent vectors for the given mesh. The tangent vector is the direction of
-	// a vertex's texture U axis in model-space. Returns true on success
-	bool CalculateTangents
+	// Report the mesh data currently held to the import statistics, adding the given amount held
+	// outside the mesh list
+	void RecordMeshMemory
 	(
-		TUInt32 iMesh,
-		TXFileVectors* pTangents
+		const TUInt64 iExtraBytes = 0
+	) const;
+
+	// Add a mesh and the meshes it was split into to the statistics of the split stage. Returns
+	// the memory used by the split meshes
+	TUInt64 RecordSplit
+	(
+		const SXFileMesh& mesh,
+		const SXFileMesh* pSplitMeshes,
+		const TUInt32     iNumSplitMeshes
 	) const;
 
 
@@ -589,6 +907,11 @@ private:
 		Data
 	---------------------------------------------------------------------------------------------*/
 
+	// Arena holding the data of the meshes after they are split by material. The sub-mesh data
+	// is released all at once when the next file is imported or this object is destroyed, and is
+	// declared before the mesh list so it is destroyed after it
+	CArena          m_SubMeshArena;
+
 	// Has any data been loaded into the lists below
 	bool            m_bImported;
 
@@ -598,8 +921,46 @@ private:
 	// Each mesh is held by a frame in the hierarchy above
 	TXFileMeshes    m_Meshes;
 
-	// Global list of materials used by all the meshes
+	// Global list of materials used by all the meshes, the id of each in the material table and
+	// a lookup from material table id to index in the list (only used during import)
 	TXFileMaterials m_Materials;
+	TXFileInts      m_MaterialIds;
+	unordered_map<TUInt32, TUInt32> m_MaterialIndices;
+
+	// Named top-level materials found while parsing an X-file natively (only used during import, or
+	// until all meshes have been read after a lazy import)
+	TXFileNamedMaterials m_NamedMaterials;
+
+	// Lazy import setting. After a lazy import: the mapped file (and its decompressed contents
+	// if it is compressed), the meshes still to be read, the lazy mesh that each sub-mesh comes
+	// from and the number of lazy meshes not yet read. The lists are empty if the last import
+	// read everything
+	bool             m_bLazyImport;
+	CMappedFile      m_LazyFile;
+	vector<TUInt8>   m_LazyData;
+	TXFileLazyMeshes m_LazyMeshes;
+	TXFileInts       m_SubMeshLazyMeshes;
+	TUInt32          m_iNumLazyMeshesLeft;
+
+	// Vertex welding tolerance and vertex counts before and after welding
+	TFloat32        m_fWeldEpsilon;
+	TUInt32         m_iNumFileVertices;
+	TUInt32         m_iNumWeldedVertices;
+
+	// Thread pool used to process meshes in parallel, 0 if none
+	CThreadPool*    m_pThreadPool;
+
+	// Table that materials are interned in
+	CMaterialTable* m_pMaterialTable;
+
+	// Statistics that imports add to, 0 if none
+	CImportStats*   m_pStats;
+
+	// Callback for a streaming import, whether tangents are needed in the sub-meshes passed to it
+	// and the number of global materials passed to it so far (only used during import)
+	CImportCallback* m_pCallback;
+	bool             m_bCallbackTangents;
+	TUInt32          m_iNumReportedMaterials;
 };
 
 
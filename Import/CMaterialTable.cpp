@@ -0,0 +1,220 @@
+/**************************************************************************************************
+	Module:       CMaterialTable.cpp
+	Date created: 18/10/26
+
+	Table of unique materials and texture names shared by all imports. Each distinct material is
+	given a stable integer id, so materials from different files can be compared by id
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#include <cstring>
+
+#include "CMaterialTable.h"
+
+namespace gen
+{
+
+namespace
+{
+	// FNV-1a hash step for a 32-bit value
+	inline size_t HashCombine( size_t hash, TUInt32 value )
+	{
+		for (TUInt32 iByte = 0; iByte < 4; ++iByte)
+		{
+			hash ^= (value >> (iByte * 8)) & 0xff;
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+
+	// Hash a float so that values comparing equal hash equally (0 and -0)
+	inline size_t HashCombine( size_t hash, TFloat32 value )
+	{
+		TFloat32 fNormalised = value + 0.0f;
+		TUInt32 iBits;
+		memcpy( &iBits, &fNormalised, sizeof(iBits) );
+		return HashCombine( hash, iBits );
+	}
+
+	inline size_t HashCombine( size_t hash, const SColourRGBA& colour )
+	{
+		hash = HashCombine( hash, colour.r );
+		hash = HashCombine( hash, colour.g );
+		hash = HashCombine( hash, colour.b );
+		return HashCombine( hash, colour.a );
+	}
+
+	inline bool AreEqual( const SColourRGBA& colour1, const SColourRGBA& colour2 )
+	{
+		return colour1.r == colour2.r && colour1.g == colour2.g &&
+		       colour1.b == colour2.b && colour1.a == colour2.a;
+	}
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+
+// Constructor - the table initially holds only the empty string (id 0)
+CMaterialTable::CMaterialTable()
+{
+	InternStringLocked( "" );
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Public interface
+-----------------------------------------------------------------------------------------*/
+
+// The table used by imports unless they are given another one
+CMaterialTable& CMaterialTable::GetShared()
+{
+	static CMaterialTable sharedTable;
+	return sharedTable;
+}
+
+
+// Get the id of the given string, adding it to the table if not already present. The empty
+// string always has id 0
+TUInt32 CMaterialTable::InternString
+(
+	const string& s
+)
+{
+	lock_guard<mutex> lock( m_Mutex );
+	return InternStringLocked( s );
+}
+
+// Get the id of the given material, adding it to the table if not already present. Materials
+// are the same if their render method, colours, specular power and texture names all match
+TUInt32 CMaterialTable::InternMaterial
+(
+	const SMeshMaterial& material
+)
+{
+	GEN_GUARD;
+
+	lock_guard<mutex> lock( m_Mutex );
+
+	SMaterialKey key;
+	key.iRenderMethod = material.renderMethod;
+	key.diffuseColour = material.diffuseColour;
+	key.specularColour = material.specularColour;
+	key.fSpecularPower = material.specularPower;
+	key.iNumTextures = material.numTextures;
+	for (TUInt32 iTexture = 0; iTexture < kiMaxTextures; ++iTexture)
+	{
+		key.aiTextureNames[iTexture] = (iTexture < material.numTextures) ?
+		                               InternStringLocked( material.textureFileNames[iTexture] ) : 0;
+	}
+
+	TMaterialIds::const_iterator itMaterial = m_MaterialIds.find( key );
+	if (itMaterial != m_MaterialIds.end())
+	{
+		return itMaterial->second;
+	}
+	TUInt32 iMaterial = static_cast<TUInt32>(m_Materials.size());
+	m_Materials.push_back( material );
+	m_MaterialIds.insert( TMaterialIds::value_type( key, iMaterial ) );
+	return iMaterial;
+
+	GEN_ENDGUARD;
+}
+
+
+TUInt32 CMaterialTable::GetNumStrings() const
+{
+	lock_guard<mutex> lock( m_Mutex );
+	return static_cast<TUInt32>(m_Strings.size());
+}
+
+TUInt32 CMaterialTable::GetNumMaterials() const
+{
+	lock_guard<mutex> lock( m_Mutex );
+	return static_cast<TUInt32>(m_Materials.size());
+}
+
+// Get the string or material with the given id
+const string& CMaterialTable::GetString
+(
+	const TUInt32 iString
+) const
+{
+	lock_guard<mutex> lock( m_Mutex );
+	return m_Strings[iString];
+}
+
+const SMeshMaterial& CMaterialTable::GetMaterial
+(
+	const TUInt32 iMaterial
+) const
+{
+	lock_guard<mutex> lock( m_Mutex );
+	return m_Materials[iMaterial];
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Private interface
+-----------------------------------------------------------------------------------------*/
+
+// Get the id of the given string, adding it if necessary. The mutex must be locked
+TUInt32 CMaterialTable::InternStringLocked
+(
+	const string& s
+)
+{
+	TStringIds::const_iterator itString = m_StringIds.find( s );
+	if (itString != m_StringIds.end())
+	{
+		return itString->second;
+	}
+	TUInt32 iString = static_cast<TUInt32>(m_Strings.size());
+	m_Strings.push_back( s );
+	m_StringIds.insert( TStringIds::value_type( s, iString ) );
+	return iString;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Private types
+-----------------------------------------------------------------------------------------*/
+
+bool CMaterialTable::SMaterialKey::operator==( const SMaterialKey& key ) const
+{
+	if (iRenderMethod != key.iRenderMethod || !AreEqual( diffuseColour, key.diffuseColour ) ||
+	    !AreEqual( specularColour, key.specularColour ) || fSpecularPower != key.fSpecularPower ||
+	    iNumTextures != key.iNumTextures)
+	{
+		return false;
+	}
+	for (TUInt32 iTexture = 0; iTexture < kiMaxTextures; ++iTexture)
+	{
+		if (aiTextureNames[iTexture] != key.aiTextureNames[iTexture])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+size_t CMaterialTable::SMaterialKeyHash::operator()( const SMaterialKey& key ) const
+{
+	size_t hash = 2166136261u;
+	hash = HashCombine( hash, key.iRenderMethod );
+	hash = HashCombine( hash, key.diffuseColour );
+	hash = HashCombine( hash, key.specularColour );
+	hash = HashCombine( hash, key.fSpecularPower );
+	hash = HashCombine( hash, key.iNumTextures );
+	for (TUInt32 iTexture = 0; iTexture < kiMaxTextures; ++iTexture)
+	{
+		hash = HashCombine( hash, key.aiTextureNames[iTexture] );
+	}
+	return hash;
+}
+
+
+} // namespace gen
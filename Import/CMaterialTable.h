@@ -0,0 +1,147 @@
+/**************************************************************************************************
+	Module:       CMaterialTable.h
+	Date created: 18/10/26
+
+	Table of unique materials and texture names shared by all imports. Each distinct material is
+	given a stable integer id, so materials from different files can be compared by id
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#ifndef GEN_C_MATERIAL_TABLE_H_INCLUDED
+#define GEN_C_MATERIAL_TABLE_H_INCLUDED
+
+#include <string>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+using namespace std;
+
+#include "MeshData.h"
+
+namespace gen
+{
+
+// Materials and strings are interned: adding a value already in the table returns the id it was
+// given before. Ids are never reused and entries are never removed, so ids and references to
+// entries stay valid for the life of the table. All functions are thread-safe
+class CMaterialTable
+{
+	GEN_CLASS( CMaterialTable )
+
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+public:
+	// Constructor - the table initially holds only the empty string (id 0)
+	CMaterialTable();
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CMaterialTable( const CMaterialTable& );
+	CMaterialTable& operator=( const CMaterialTable& );
+
+
+/*-----------------------------------------------------------------------------------------
+	Public interface
+-----------------------------------------------------------------------------------------*/
+public:
+
+	// The table used by imports unless they are given another one
+	static CMaterialTable& GetShared();
+
+
+	/////////////////////////////////////
+	// Interning
+
+	// Get the id of the given string, adding it to the table if not already present. The empty
+	// string always has id 0
+	TUInt32 InternString
+	(
+		const string& s
+	);
+
+	// Get the id of the given material, adding it to the table if not already present. Materials
+	// are the same if their render method, colours, specular power and texture names all match
+	TUInt32 InternMaterial
+	(
+		const SMeshMaterial& material
+	);
+
+
+	/////////////////////////////////////
+	// Data access
+
+	TUInt32 GetNumStrings() const;
+	TUInt32 GetNumMaterials() const;
+
+	// Get the string or material with the given id
+	const string& GetString
+	(
+		const TUInt32 iString
+	) const;
+	const SMeshMaterial& GetMaterial
+	(
+		const TUInt32 iMaterial
+	) const;
+
+
+/*-----------------------------------------------------------------------------------------
+	Private interface
+-----------------------------------------------------------------------------------------*/
+private:
+
+	// Get the id of the given string, adding it if necessary. The mutex must be locked
+	TUInt32 InternStringLocked
+	(
+		const string& s
+	);
+
+
+/*-----------------------------------------------------------------------------------------
+	Private types
+-----------------------------------------------------------------------------------------*/
+private:
+
+	// Lookup key for a material, texture names are held as string ids so the key can be hashed
+	// and compared without touching the strings
+	struct SMaterialKey
+	{
+		TUInt32     iRenderMethod;
+		SColourRGBA diffuseColour;
+		SColourRGBA specularColour;
+		TFloat32    fSpecularPower;
+		TUInt32     iNumTextures;
+		TUInt32     aiTextureNames[kiMaxTextures];
+
+		bool operator==( const SMaterialKey& key ) const;
+	};
+
+	struct SMaterialKeyHash
+	{
+		size_t operator()( const SMaterialKey& key ) const;
+	};
+
+	typedef unordered_map<string, TUInt32> TStringIds;
+	typedef unordered_map<SMaterialKey, TUInt32, SMaterialKeyHash> TMaterialIds;
+
+
+/*-----------------------------------------------------------------------------------------
+	Data
+-----------------------------------------------------------------------------------------*/
+private:
+
+	// Interned values indexed by id (deques so references stay valid as entries are added) and
+	// hashed lookups from value to id. Protected by the mutex
+	deque<string>        m_Strings;
+	deque<SMeshMaterial> m_Materials;
+	TStringIds           m_StringIds;
+	TMaterialIds         m_MaterialIds;
+	mutable mutex        m_Mutex;
+};
+
+
+} // namespace gen
+
+#endif // GEN_C_MATERIAL_TABLE_H_INCLUDED
@@ -0,0 +1,478 @@
+/**************************************************************************************************
+	Module:       CXFileBinaryReader.cpp
+	Date created: 18/10/26
+
+	Tokeniser for the binary encoding of Microsoft DirectX .X files ("xof 0303bin"). Works directly
+	on a memory-mapped file and has no dependency on the D3DX X-file API
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#include <string.h>
+
+#include "CXFileBinaryReader.h"
+#include "Error.h"
+
+namespace gen
+{
+
+/*-----------------------------------------------------------------------------------------
+	Local helpers
+-----------------------------------------------------------------------------------------*/
+
+namespace
+{
+	// Size of the fixed X-file header: "xof 0303bin 0032"
+	const TUInt32 kiHeaderSize = 16;
+
+	// Size of a token and of the DWORD that follows many tokens
+	const TUInt32 kiTokenSize = 2;
+	const TUInt32 kiDWordSize = 4;
+	const TUInt32 kiGUIDSize = 16;
+
+	// Read little-endian values from unaligned data
+	inline TUInt32 ReadWord( const TUInt8* p )
+	{
+		return p[0] | (p[1] << 8);
+	}
+	inline TUInt32 ReadDWord( const TUInt8* p )
+	{
+		TUInt32 iValue;
+		memcpy( &iValue, p, sizeof(iValue) );
+		return iValue;
+	}
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+
+// Constructor takes the whole file contents, including the 16 byte file header
+CXFileBinaryReader::CXFileBinaryReader
+(
+	const TUInt8* pData,
+	const TUInt32 iSize
+)
+{
+	m_pStart = pData;
+	m_pEnd = m_pStart + iSize;
+	m_pCurr = m_pStart + (iSize < kiHeaderSize ? iSize : kiHeaderSize);
+	m_bDoubles = (iSize >= kiHeaderSize && memcmp( pData + 12, "0064", 4 ) == 0);
+	m_iListType = 0;
+	m_iListLeft = 0;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	File header
+-----------------------------------------------------------------------------------------*/
+
+// Tests if the given file contents start with a binary X-file header (any version, either
+// float size)
+bool CXFileBinaryReader::IsBinaryXFile
+(
+	const TUInt8* pData,
+	const TUInt32 iSize
+)
+{
+	return iSize >= kiHeaderSize && memcmp( pData, "xof ", 4 ) == 0 &&
+	       memcmp( pData + 8, "bin ", 4 ) == 0;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Tokens
+-----------------------------------------------------------------------------------------*/
+
+// Return the type of the next token without consuming it. Skips separator tokens
+CXFileReader::EToken CXFileBinaryReader::PeekToken()
+{
+	if (m_iListLeft)
+	{
+		return kTokenNumber;
+	}
+
+	switch (PeekBinaryToken())
+	{
+		case 0:
+			return kTokenEnd;
+		case kBinaryInteger:
+		case kBinaryIntegerList:
+		case kBinaryFloatList:
+			return kTokenNumber;
+		case kBinaryString:
+			return kTokenString;
+		case kBinaryGUID:
+			return kTokenGUID;
+		case kBinaryOpenBrace:
+			return kTokenOpenBrace;
+		case kBinaryCloseBrace:
+			return kTokenCloseBrace;
+		default:
+			return kTokenName; // Names, templates and unexpected tokens
+	}
+}
+
+
+// Read an identifier (template or object name)
+bool CXFileBinaryReader::ReadName( string& sName )
+{
+	if (m_iListLeft || PeekBinaryToken() != kBinaryName ||
+	    static_cast<TUInt32>(m_pEnd - m_pCurr) < kiTokenSize + kiDWordSize)
+	{
+		return false;
+	}
+	TUInt32 iLength = ReadDWord( m_pCurr + kiTokenSize );
+	const TUInt8* pName = m_pCurr + kiTokenSize + kiDWordSize;
+	if (static_cast<TUInt32>(m_pEnd - pName) < iLength)
+	{
+		return false;
+	}
+	sName.assign( reinterpret_cast<const char*>(pName), iLength );
+	m_pCurr = pName + iLength;
+	return true;
+}
+
+
+// Read a string
+bool CXFileBinaryReader::ReadString( string& sString )
+{
+	if (m_iListLeft || PeekBinaryToken() != kBinaryString ||
+	    static_cast<TUInt32>(m_pEnd - m_pCurr) < kiTokenSize + kiDWordSize)
+	{
+		return false;
+	}
+	TUInt32 iLength = ReadDWord( m_pCurr + kiTokenSize );
+	const TUInt8* pString = m_pCurr + kiTokenSize + kiDWordSize;
+	if (static_cast<TUInt32>(m_pEnd - pString) < iLength)
+	{
+		return false;
+	}
+
+	// Some writers include the null terminator in the length
+	TUInt32 iChars = iLength;
+	while (iChars && pString[iChars - 1] == 0)
+	{
+		--iChars;
+	}
+	sString.assign( reinterpret_cast<const char*>(pString), iChars );
+	m_pCurr = pString + iLength;
+	return true;
+}
+
+
+// Read an unsigned integer (DWORD or WORD members)
+bool CXFileBinaryReader::ReadUInt( TUInt32* piValue )
+{
+	if (!StartList() || m_iListType != kBinaryIntegerList)
+	{
+		return false;
+	}
+	*piValue = ReadDWord( m_pCurr );
+	m_pCurr += kiDWordSize;
+	--m_iListLeft;
+	return true;
+}
+
+
+// Read a floating point number. Integers are also accepted
+bool CXFileBinaryReader::ReadFloat( TFloat32* pfValue )
+{
+	if (!StartList())
+	{
+		return false;
+	}
+	if (m_iListType == kBinaryIntegerList)
+	{
+		*pfValue = static_cast<TFloat32>(ReadDWord( m_pCurr ));
+		m_pCurr += kiDWordSize;
+		--m_iListLeft;
+	}
+	else
+	{
+		*pfValue = ReadListFloat();
+	}
+	return true;
+}
+
+
+// Read a run of floating point numbers, e.g. an array of vectors
+bool CXFileBinaryReader::ReadFloats
+(
+	TFloat32*     pfValues,
+	const TUInt32 iCount
+)
+{
+	TUInt32 iValue = 0;
+	while (iValue < iCount)
+	{
+		if (!StartList())
+		{
+			return false;
+		}
+
+		// Copy single precision lists directly, the usual case
+		if (m_iListType == kBinaryFloatList && !m_bDoubles)
+		{
+			TUInt32 iNumValues = (m_iListLeft < iCount - iValue) ? m_iListLeft : iCount - iValue;
+			memcpy( pfValues + iValue, m_pCurr, iNumValues * sizeof(TFloat32) );
+			m_pCurr += iNumValues * sizeof(TFloat32);
+			m_iListLeft -= iNumValues;
+			iValue += iNumValues;
+		}
+		else if (!ReadFloat( pfValues + iValue++ ))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+// Read an opening brace
+bool CXFileBinaryReader::ReadOpenBrace()
+{
+	if (m_iListLeft || PeekBinaryToken() != kBinaryOpenBrace)
+	{
+		return false;
+	}
+	m_pCurr += kiTokenSize;
+	return true;
+}
+
+// Read a closing brace
+bool CXFileBinaryReader::ReadCloseBrace()
+{
+	if (m_iListLeft || PeekBinaryToken() != kBinaryCloseBrace)
+	{
+		return false;
+	}
+	m_pCurr += kiTokenSize;
+	return true;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Data objects
+-----------------------------------------------------------------------------------------*/
+
+// Read the header of a data object: "Type [Name] [GUID] {". The name will be empty for
+// unnamed objects. Template definitions are also read with this function (type "template")
+bool CXFileBinaryReader::ReadObjectHeader
+(
+	string& sType,
+	string& sName
+)
+{
+	if (m_iListLeft)
+	{
+		return false;
+	}
+	if (PeekBinaryToken() == kBinaryTemplate)
+	{
+		sType = "template";
+		m_pCurr += kiTokenSize;
+	}
+	else if (!ReadName( sType ))
+	{
+		return false;
+	}
+
+	// Optional name
+	sName.clear();
+	TUInt32 iToken = PeekBinaryToken();
+	if (iToken == kBinaryName)
+	{
+		ReadName( sName );
+		iToken = PeekBinaryToken();
+	}
+
+	// Optional GUID - ignored, objects are identified by template name
+	if (iToken == kBinaryGUID)
+	{
+		if (static_cast<TUInt32>(m_pEnd - m_pCurr) < kiTokenSize + kiGUIDSize)
+		{
+			return false;
+		}
+		m_pCurr += kiTokenSize + kiGUIDSize;
+	}
+
+	return ReadOpenBrace();
+}
+
+
+// Read a data reference: "{ Name [GUID] }"
+bool CXFileBinaryReader::ReadReference( string& sName )
+{
+	if (!ReadOpenBrace() || !ReadName( sName ))
+	{
+		return false;
+	}
+
+	// Skip optional GUID
+	if (PeekBinaryToken() == kBinaryGUID)
+	{
+		if (static_cast<TUInt32>(m_pEnd - m_pCurr) < kiTokenSize + kiGUIDSize)
+		{
+			return false;
+		}
+		m_pCurr += kiTokenSize + kiGUIDSize;
+	}
+	return ReadCloseBrace();
+}
+
+
+// Skip the remainder of a data object (including child objects) after its opening brace has
+// been read. Consumes the matching closing brace
+bool CXFileBinaryReader::SkipObject()
+{
+	// Skip the rest of any list being read
+	if (m_iListLeft)
+	{
+		TUInt32 iValueSize = (m_iListType == kBinaryFloatList && m_bDoubles) ? 8 : 4;
+		m_pCurr += m_iListLeft * iValueSize;
+		m_iListLeft = 0;
+	}
+
+	TUInt32 iDepth = 1;
+	while (static_cast<TUInt32>(m_pEnd - m_pCurr) >= kiTokenSize)
+	{
+		TUInt32 iToken = ReadWord( m_pCurr );
+		m_pCurr += kiTokenSize;
+
+		// Find the size of the data following the token
+		TUInt64 iDataSize = 0;
+		switch (iToken)
+		{
+			case kBinaryOpenBrace:
+				++iDepth;
+				break;
+			case kBinaryCloseBrace:
+				if (--iDepth == 0)
+				{
+					return true;
+				}
+				break;
+			case kBinaryInteger:
+				iDataSize = kiDWordSize;
+				break;
+			case kBinaryGUID:
+				iDataSize = kiGUIDSize;
+				break;
+			case kBinaryName:
+			case kBinaryString:
+			case kBinaryIntegerList:
+			case kBinaryFloatList:
+			{
+				if (static_cast<TUInt32>(m_pEnd - m_pCurr) < kiDWordSize)
+				{
+					return false;
+				}
+				TUInt64 iCount = ReadDWord( m_pCurr );
+				TUInt64 iValueSize = 1;
+				if (iToken == kBinaryIntegerList)
+				{
+					iValueSize = 4;
+				}
+				else if (iToken == kBinaryFloatList)
+				{
+					iValueSize = m_bDoubles ? 8 : 4;
+				}
+				iDataSize = kiDWordSize + iCount * iValueSize;
+				break;
+			}
+			default:
+				break; // Separators and template keywords have no data
+		}
+		if (static_cast<TUInt64>(m_pEnd - m_pCurr) < iDataSize)
+		{
+			return false;
+		}
+		m_pCurr += iDataSize;
+	}
+	return false;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Private interface
+-----------------------------------------------------------------------------------------*/
+
+// Skip separator tokens and return the next token without consuming it, or 0 at the end of
+// the data
+TUInt32 CXFileBinaryReader::PeekBinaryToken()
+{
+	while (static_cast<TUInt32>(m_pEnd - m_pCurr) >= kiTokenSize)
+	{
+		TUInt32 iToken = ReadWord( m_pCurr );
+		if (iToken != kBinaryComma && iToken != kBinarySemicolon)
+		{
+			return iToken;
+		}
+		m_pCurr += kiTokenSize;
+	}
+	return 0;
+}
+
+
+// Start reading the next number list (or single integer) if the current one is used up.
+// Returns false if the next token is not a number
+bool CXFileBinaryReader::StartList()
+{
+	while (!m_iListLeft)
+	{
+		TUInt32 iToken = PeekBinaryToken();
+		if (static_cast<TUInt32>(m_pEnd - m_pCurr) < kiTokenSize + kiDWordSize)
+		{
+			return false;
+		}
+		if (iToken == kBinaryInteger)
+		{
+			m_iListType = kBinaryIntegerList;
+			m_iListLeft = 1;
+			m_pCurr += kiTokenSize;
+		}
+		else if (iToken == kBinaryIntegerList || iToken == kBinaryFloatList)
+		{
+			// Check the whole list is present, empty lists are skipped
+			TUInt64 iCount = ReadDWord( m_pCurr + kiTokenSize );
+			TUInt64 iValueSize = (iToken == kBinaryFloatList && m_bDoubles) ? 8 : 4;
+			m_pCurr += kiTokenSize + kiDWordSize;
+			if (static_cast<TUInt64>(m_pEnd - m_pCurr) < iCount * iValueSize)
+			{
+				m_pCurr = m_pEnd;
+				return false;
+			}
+			m_iListType = iToken;
+			m_iListLeft = static_cast<TUInt32>(iCount);
+		}
+		else
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+// Read the next value from the current float list
+TFloat32 CXFileBinaryReader::ReadListFloat()
+{
+	--m_iListLeft;
+	if (m_bDoubles)
+	{
+		TFloat64 fValue;
+		memcpy( &fValue, m_pCurr, sizeof(fValue) );
+		m_pCurr += sizeof(fValue);
+		return static_cast<TFloat32>(fValue);
+	}
+	TFloat32 fValue;
+	memcpy( &fValue, m_pCurr, sizeof(fValue) );
+	m_pCurr += sizeof(fValue);
+	return fValue;
+}
+
+
+} // namespace gen
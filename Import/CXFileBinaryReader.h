@@ -0,0 +1,190 @@
+/**************************************************************************************************
+	Module:       CXFileBinaryReader.h
+	Date created: 18/10/26
+
+	Tokeniser for the binary encoding of Microsoft DirectX .X files ("xof 0303bin"). Works directly
+	on a memory-mapped file and has no dependency on the D3DX X-file API
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#ifndef GEN_C_XFILE_BINARY_READER_H_INCLUDED
+#define GEN_C_XFILE_BINARY_READER_H_INCLUDED
+
+#include "CXFileReader.h"
+
+namespace gen
+{
+
+// Reads the data objects of a binary X-file (see CXFileReader). A binary file is a stream of
+// 16-bit tokens, some followed by data. Template member data is held in integer and float list
+// tokens, which may hold any number of members or be split at any point, so the lists are read as
+// a single stream of numbers. Separator tokens are skipped
+class CXFileBinaryReader : public CXFileReader
+{
+	GEN_CLASS( CXFileBinaryReader )
+
+/*-----------------------------------------------------------------------------------------
+	Types
+-----------------------------------------------------------------------------------------*/
+public:
+
+	// Token values in a binary X-file
+	enum EBinaryToken
+	{
+		kBinaryName         = 1,  // DWORD length, characters
+		kBinaryString       = 2,  // DWORD length, characters, then a separator token
+		kBinaryInteger      = 3,  // DWORD
+		kBinaryGUID         = 5,  // 16 bytes
+		kBinaryIntegerList  = 6,  // DWORD count, DWORDs
+		kBinaryFloatList    = 7,  // DWORD count, floats or doubles (see file header)
+		kBinaryOpenBrace    = 10,
+		kBinaryCloseBrace   = 11,
+		kBinaryComma        = 19,
+		kBinarySemicolon    = 20,
+		kBinaryTemplate     = 31,
+	};
+
+
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+public:
+	// Constructor takes the whole file contents, including the 16 byte file header
+	CXFileBinaryReader
+	(
+		const TUInt8* pData,
+		const TUInt32 iSize
+	);
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CXFileBinaryReader( const CXFileBinaryReader& );
+	CXFileBinaryReader& operator=( const CXFileBinaryReader& );
+
+
+/*-----------------------------------------------------------------------------------------
+	Public interface
+-----------------------------------------------------------------------------------------*/
+public:
+
+	/////////////////////////////////////
+	// File header
+
+	// Tests if the given file contents start with a binary X-file header (any version, either
+	// float size)
+	static bool IsBinaryXFile
+	(
+		const TUInt8* pData,
+		const TUInt32 iSize
+	);
+
+
+	/////////////////////////////////////
+	// Tokens
+
+	// Return the type of the next token without consuming it. Skips separator tokens
+	virtual EToken PeekToken();
+
+	// Read an identifier (template or object name)
+	virtual bool ReadName( string& sName );
+
+	// Read a string
+	virtual bool ReadString( string& sString );
+
+	// Read an unsigned integer (DWORD or WORD members)
+	virtual bool ReadUInt( TUInt32* piValue );
+
+	// Read a floating point number. Integers are also accepted
+	virtual bool ReadFloat( TFloat32* pfValue );
+
+	// Read a run of floating point numbers, e.g. an array of vectors
+	virtual bool ReadFloats
+	(
+		TFloat32*     pfValues,
+		const TUInt32 iCount
+	);
+
+	// Read an opening / closing brace
+	virtual bool ReadOpenBrace();
+	virtual bool ReadCloseBrace();
+
+
+	/////////////////////////////////////
+	// Data objects
+
+	// Read the header of a data object: "Type [Name] [GUID] {". The name will be empty for
+	// unnamed objects. Template definitions are also read with this function (type "template")
+	virtual bool ReadObjectHeader
+	(
+		string& sType,
+		string& sName
+	);
+
+	// Read a data reference: "{ Name [GUID] }"
+	virtual bool ReadReference( string& sName );
+
+	// Skip the remainder of a data object (including child objects) after its opening brace has
+	// been read. Consumes the matching closing brace
+	virtual bool SkipObject();
+
+
+	/////////////////////////////////////
+	// Position
+
+	// Number of bytes consumed so far (including file header). Only valid between tokens, not
+	// part way through a number list
+	virtual TUInt32 GetOffset() const
+	{
+		return static_cast<TUInt32>(m_pCurr - m_pStart);
+	}
+
+	// Move to the given offset, as returned by GetOffset, to read from that point again
+	virtual void SetOffset( const TUInt32 iOffset )
+	{
+		m_pCurr = m_pStart + (iOffset < m_pEnd - m_pStart ? iOffset : m_pEnd - m_pStart);
+		m_iListLeft = 0;
+	}
+
+
+/*-----------------------------------------------------------------------------------------
+	Private interface
+-----------------------------------------------------------------------------------------*/
+private:
+
+	// Skip separator tokens and return the next token without consuming it, or 0 at the end of
+	// the data
+	TUInt32 PeekBinaryToken();
+
+	// Start reading the next number list (or single integer) if the current one is used up.
+	// Returns false if the next token is not a number
+	bool StartList();
+
+	// Read the next value from the current float list
+	TFloat32 ReadListFloat();
+
+
+/*-----------------------------------------------------------------------------------------
+	Data
+-----------------------------------------------------------------------------------------*/
+private:
+
+	// File data being read, current position and end of data
+	const TUInt8* m_pStart;
+	const TUInt8* m_pCurr;
+	const TUInt8* m_pEnd;
+
+	// Float lists hold doubles rather than floats (file header float size 0064)
+	bool          m_bDoubles;
+
+	// Type of the number list being read (kBinaryIntegerList or kBinaryFloatList) and the number
+	// of values left in it. A single integer token is read as a list of one
+	TUInt32       m_iListType;
+	TUInt32       m_iListLeft;
+};
+
+
+} // namespace gen
+
+#endif // GEN_C_XFILE_BINARY_READER_H_INCLUDED
@@ -0,0 +1,284 @@
+/**************************************************************************************************
+	Module:       CXFileBinaryWriter.cpp
+	Date created: 18/10/26
+
+	Writer for the binary encoding of Microsoft DirectX .X files ("xof 0303bin"), and conversion
+	of text X-files to binary
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#include <stdio.h>
+
+#include "CXFileBinaryWriter.h"
+#include "CXFileBinaryReader.h"
+#include "CXFileTextReader.h"
+#include "CMappedFile.h"
+
+namespace gen
+{
+
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+
+// Constructor writes the file header
+CXFileBinaryWriter::CXFileBinaryWriter()
+{
+	WriteBytes( "xof 0303bin 0032", 16 );
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Conversion
+-----------------------------------------------------------------------------------------*/
+
+// Convert a text X-file to a binary X-file, replacing any existing file. Template definitions
+// are not written, the standard templates are assumed
+EImportError CXFileBinaryWriter::ConvertTextFile
+(
+	const string& sTextFile,
+	const string& sBinaryFile
+)
+{
+	GEN_GUARD;
+
+	CMappedFile textFile;
+	if (!textFile.Open( sTextFile ) || !CXFileTextReader::IsTextXFile( textFile.GetData(), textFile.GetSize() ))
+	{
+		return kFileError;
+	}
+	CXFileTextReader reader( textFile.GetData(), textFile.GetSize() );
+	CXFileBinaryWriter writer;
+
+	// Copy the tokens across, collecting runs of numbers of the same type into lists
+	vector<TUInt32> integers;
+	vector<TFloat32> floats;
+	string sType, sName;
+	CXFileReader::EToken token;
+	while ((token = reader.PeekToken()) != CXFileReader::kTokenEnd)
+	{
+		if (token == CXFileReader::kTokenNumber)
+		{
+			if (reader.IsFloatNext())
+			{
+				TFloat32 fValue;
+				if (!reader.ReadFloat( &fValue ))
+				{
+					return kInvalidData;
+				}
+				if (!integers.empty())
+				{
+					writer.WriteIntegers( &integers[0], static_cast<TUInt32>(integers.size()) );
+					integers.clear();
+				}
+				floats.push_back( fValue );
+			}
+			else
+			{
+				TUInt32 iValue;
+				if (!reader.ReadUInt( &iValue ))
+				{
+					return kInvalidData;
+				}
+				if (!floats.empty())
+				{
+					writer.WriteFloats( &floats[0], static_cast<TUInt32>(floats.size()) );
+					floats.clear();
+				}
+				integers.push_back( iValue );
+			}
+			continue;
+		}
+
+		// Any other token ends a list
+		if (!integers.empty())
+		{
+			writer.WriteIntegers( &integers[0], static_cast<TUInt32>(integers.size()) );
+			integers.clear();
+		}
+		if (!floats.empty())
+		{
+			writer.WriteFloats( &floats[0], static_cast<TUInt32>(floats.size()) );
+			floats.clear();
+		}
+
+		// Data object, object GUIDs are not kept
+		if (token == CXFileReader::kTokenName)
+		{
+			if (!reader.ReadObjectHeader( sType, sName ))
+			{
+				return kInvalidData;
+			}
+			if (sType == "template")
+			{
+				if (!reader.SkipObject())
+				{
+					return kInvalidData;
+				}
+				continue;
+			}
+			writer.WriteName( sType );
+			if (!sName.empty())
+			{
+				writer.WriteName( sName );
+			}
+			writer.WriteOpenBrace();
+		}
+
+		// Reference to another data object
+		else if (token == CXFileReader::kTokenOpenBrace)
+		{
+			if (!reader.ReadReference( sName ))
+			{
+				return kInvalidData;
+			}
+			writer.WriteOpenBrace();
+			writer.WriteName( sName );
+			writer.WriteCloseBrace();
+		}
+
+		// End of data object
+		else if (token == CXFileReader::kTokenCloseBrace)
+		{
+			reader.ReadCloseBrace();
+			writer.WriteCloseBrace();
+		}
+
+		// String member
+		else if (token == CXFileReader::kTokenString)
+		{
+			if (!reader.ReadString( sName ))
+			{
+				return kInvalidData;
+			}
+			writer.WriteString( sName );
+		}
+
+		// GUIDs are only expected in object headers
+		else
+		{
+			return kInvalidData;
+		}
+	}
+
+	return writer.SaveFile( sBinaryFile ) ? kSuccess : kFileError;
+
+	GEN_ENDGUARD;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Tokens
+-----------------------------------------------------------------------------------------*/
+
+// Write an identifier (template or object name)
+void CXFileBinaryWriter::WriteName( const string& sName )
+{
+	WriteToken( CXFileBinaryReader::kBinaryName );
+	WriteDWord( static_cast<TUInt32>(sName.length()) );
+	WriteBytes( sName.data(), static_cast<TUInt32>(sName.length()) );
+}
+
+// Write a string, followed by a separator
+void CXFileBinaryWriter::WriteString( const string& sString )
+{
+	WriteToken( CXFileBinaryReader::kBinaryString );
+	WriteDWord( static_cast<TUInt32>(sString.length()) );
+	WriteBytes( sString.data(), static_cast<TUInt32>(sString.length()) );
+	WriteToken( CXFileBinaryReader::kBinarySemicolon );
+}
+
+
+// Write a list of integers or floats
+void CXFileBinaryWriter::WriteIntegers
+(
+	const TUInt32* piValues,
+	const TUInt32  iCount
+)
+{
+	WriteToken( CXFileBinaryReader::kBinaryIntegerList );
+	WriteDWord( iCount );
+	WriteBytes( piValues, iCount * sizeof(TUInt32) );
+}
+
+void CXFileBinaryWriter::WriteFloats
+(
+	const TFloat32* pfValues,
+	const TUInt32   iCount
+)
+{
+	WriteToken( CXFileBinaryReader::kBinaryFloatList );
+	WriteDWord( iCount );
+	WriteBytes( pfValues, iCount * sizeof(TFloat32) );
+}
+
+
+// Write an opening / closing brace
+void CXFileBinaryWriter::WriteOpenBrace()
+{
+	WriteToken( CXFileBinaryReader::kBinaryOpenBrace );
+}
+
+void CXFileBinaryWriter::WriteCloseBrace()
+{
+	WriteToken( CXFileBinaryReader::kBinaryCloseBrace );
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Output
+-----------------------------------------------------------------------------------------*/
+
+// Save the file written so far, replacing any existing file. Returns false on failure
+bool CXFileBinaryWriter::SaveFile( const string& sFileName ) const
+{
+	GEN_GUARD;
+
+	FILE* pFile = fopen( sFileName.c_str(), "wb" );
+	if (!pFile)
+	{
+		return false;
+	}
+	bool bWritten = (fwrite( &m_Data[0], 1, m_Data.size(), pFile ) == m_Data.size());
+	if (fclose( pFile ) != 0 || !bWritten)
+	{
+		remove( sFileName.c_str() );
+		return false;
+	}
+
+	return true;
+
+	GEN_ENDGUARD;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Private interface
+-----------------------------------------------------------------------------------------*/
+
+// Values are written little-endian, as the platforms using X-files are
+void CXFileBinaryWriter::WriteToken( const TUInt32 iToken )
+{
+	m_Data.push_back( static_cast<TUInt8>(iToken) );
+	m_Data.push_back( static_cast<TUInt8>(iToken >> 8) );
+}
+
+void CXFileBinaryWriter::WriteDWord( const TUInt32 iValue )
+{
+	WriteBytes( &iValue, sizeof(iValue) );
+}
+
+void CXFileBinaryWriter::WriteBytes
+(
+	const void*   pData,
+	const TUInt32 iSize
+)
+{
+	const TUInt8* pBytes = static_cast<const TUInt8*>(pData);
+	m_Data.insert( m_Data.end(), pBytes, pBytes + iSize );
+}
+
+
+} // namespace gen
@@ -0,0 +1,131 @@
+/**************************************************************************************************
+	Module:       CXFileBinaryWriter.h
+	Date created: 18/10/26
+
+	Writer for the binary encoding of Microsoft DirectX .X files ("xof 0303bin"), and conversion
+	of text X-files to binary
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#ifndef GEN_C_XFILE_BINARY_WRITER_H_INCLUDED
+#define GEN_C_XFILE_BINARY_WRITER_H_INCLUDED
+
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "CImportXFile.h"
+
+namespace gen
+{
+
+// Builds a binary X-file in memory from data object tokens (see CXFileBinaryReader). Floats are
+// written in single precision
+class CXFileBinaryWriter
+{
+	GEN_CLASS( CXFileBinaryWriter )
+
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+public:
+	// Constructor writes the file header
+	CXFileBinaryWriter();
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CXFileBinaryWriter( const CXFileBinaryWriter& );
+	CXFileBinaryWriter& operator=( const CXFileBinaryWriter& );
+
+
+/*-----------------------------------------------------------------------------------------
+	Public interface
+-----------------------------------------------------------------------------------------*/
+public:
+
+	/////////////////////////////////////
+	// Conversion
+
+	// Convert a text X-file to a binary X-file, replacing any existing file. Template definitions
+	// are not written, the standard templates are assumed. Numbers are written in integer lists
+	// unless they have a decimal point, exponent or sign, in which case they are written in float
+	// lists (CXFileBinaryReader reads either type for float members)
+	// Possible return values:
+	//		kSuccess:			...
+	//		kFileError:			Missing or not a text X-file, or binary file could not be written
+	//		kInvalidData:		The text file could not be parsed correctly
+	static EImportError ConvertTextFile
+	(
+		const string& sTextFile,
+		const string& sBinaryFile
+	);
+
+
+	/////////////////////////////////////
+	// Tokens
+
+	// Write an identifier (template or object name)
+	void WriteName( const string& sName );
+
+	// Write a string, followed by a separator
+	void WriteString( const string& sString );
+
+	// Write a list of integers or floats. Consecutive lists may be written for a single member
+	// or a single list may hold many members
+	void WriteIntegers
+	(
+		const TUInt32* piValues,
+		const TUInt32  iCount
+	);
+	void WriteFloats
+	(
+		const TFloat32* pfValues,
+		const TUInt32   iCount
+	);
+
+	// Write an opening / closing brace
+	void WriteOpenBrace();
+	void WriteCloseBrace();
+
+
+	/////////////////////////////////////
+	// Output
+
+	// The file written so far, including the header
+	const vector<TUInt8>& GetData() const
+	{
+		return m_Data;
+	}
+
+	// Save the file written so far, replacing any existing file. Returns false on failure
+	bool SaveFile( const string& sFileName ) const;
+
+
+/*-----------------------------------------------------------------------------------------
+	Private interface
+-----------------------------------------------------------------------------------------*/
+private:
+
+	void WriteToken( const TUInt32 iToken );
+	void WriteDWord( const TUInt32 iValue );
+	void WriteBytes
+	(
+		const void*   pData,
+		const TUInt32 iSize
+	);
+
+
+/*-----------------------------------------------------------------------------------------
+	Data
+-----------------------------------------------------------------------------------------*/
+private:
+
+	vector<TUInt8> m_Data;
+};
+
+
+} // namespace gen
+
+#endif // GEN_C_XFILE_BINARY_WRITER_H_INCLUDED
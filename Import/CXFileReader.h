@@ -0,0 +1,122 @@
+/**************************************************************************************************
+	Module:       CXFileReader.h
+	Date created: 18/10/26
+
+	Interface for readers of the data objects in Microsoft DirectX .X files. Implemented for the
+	text and binary encodings, so the native parser is independent of the file encoding
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#ifndef GEN_C_XFILE_READER_H_INCLUDED
+#define GEN_C_XFILE_READER_H_INCLUDED
+
+#include <string>
+using namespace std;
+
+#include "GenDefines.h"
+
+namespace gen
+{
+
+// Reads the data objects of an X-file. The data object layout is not described to the reader,
+// the caller reads template members in the order it knows them.
+// Separators between members are skipped, which is safe as every template member has a known
+// type and count
+class CXFileReader
+{
+/*-----------------------------------------------------------------------------------------
+	Types
+-----------------------------------------------------------------------------------------*/
+public:
+
+	// Types of token that can be found next in the file
+	enum EToken
+	{
+		kTokenEnd,
+		kTokenName,
+		kTokenNumber,
+		kTokenString,
+		kTokenGUID,
+		kTokenOpenBrace,
+		kTokenCloseBrace,
+	};
+
+
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+public:
+	virtual ~CXFileReader() {}
+
+
+/*-----------------------------------------------------------------------------------------
+	Public interface
+-----------------------------------------------------------------------------------------*/
+public:
+
+	/////////////////////////////////////
+	// Tokens
+
+	// Return the type of the next token without consuming it. Skips separators (and whitespace
+	// and comments in text files)
+	virtual EToken PeekToken() = 0;
+
+	// Read an identifier (template or object name)
+	virtual bool ReadName( string& sName ) = 0;
+
+	// Read a quoted string
+	virtual bool ReadString( string& sString ) = 0;
+
+	// Read an unsigned integer (DWORD or WORD members)
+	virtual bool ReadUInt( TUInt32* piValue ) = 0;
+
+	// Read a floating point number
+	virtual bool ReadFloat( TFloat32* pfValue ) = 0;
+
+	// Read a run of floating point numbers, e.g. an array of vectors
+	virtual bool ReadFloats
+	(
+		TFloat32*     pfValues,
+		const TUInt32 iCount
+	) = 0;
+
+	// Read an opening / closing brace
+	virtual bool ReadOpenBrace() = 0;
+	virtual bool ReadCloseBrace() = 0;
+
+
+	/////////////////////////////////////
+	// Data objects
+
+	// Read the header of a data object: "Type [Name] [<GUID>] {". The name will be empty for
+	// unnamed objects. Template definitions are also read with this function (type "template")
+	virtual bool ReadObjectHeader
+	(
+		string& sType,
+		string& sName
+	) = 0;
+
+	// Read a data reference: "{ Name [GUID] }"
+	virtual bool ReadReference( string& sName ) = 0;
+
+	// Skip the remainder of a data object (including child objects) after its opening brace has
+	// been read. Consumes the matching closing brace
+	virtual bool SkipObject() = 0;
+
+
+	/////////////////////////////////////
+	// Position
+
+	// Number of bytes consumed so far (including file header)
+	virtual TUInt32 GetOffset() const = 0;
+
+	// Move to the given offset, as returned by GetOffset, to read from that point again
+	virtual void SetOffset( const TUInt32 iOffset ) = 0;
+};
+
+
+} // namespace gen
+
+#endif // GEN_C_XFILE_READER_H_INCLUDED
@@ -0,0 +1,444 @@
+/**************************************************************************************************
+	Module:       CXFileTextReader.cpp
+	Date created: 18/10/26
+
+	Tokeniser for the text encoding of Microsoft DirectX .X files ("xof 0303txt"). Works directly
+	on a memory-mapped file and has no dependency on the D3DX X-file API
+
+	Change history:
+		V1.0    Created 18/10/26
+		V1.1    Implements the CXFileReader interface shared with the binary reader
+**************************************************************************************************/
+
+#include <string.h>
+
+#include "CXFileTextReader.h"
+#include "Error.h"
+
+namespace gen
+{
+
+/*-----------------------------------------------------------------------------------------
+	Local helpers
+-----------------------------------------------------------------------------------------*/
+
+namespace
+{
+	// Size of the fixed X-file header: "xof 0303txt 0032"
+	const TUInt32 kiHeaderSize = 16;
+
+	// Exact powers of ten representable in a double, used for number conversion
+	const TFloat64 kafPowersOfTen[] =
+	{
+		1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+	const TInt32 kiMaxExactPower = 22;
+
+	inline bool IsDigit( const char c )
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	// Characters that end an identifier
+	inline bool IsNameDelimiter( const char c )
+	{
+		return c <= ' ' || c == '{' || c == '}' || c == ';' || c == ',' || c == '"' || c == '<';
+	}
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+
+// Constructor takes the whole file contents, including the 16 byte file header
+CXFileTextReader::CXFileTextReader
+(
+	const TUInt8* pData,
+	const TUInt32 iSize
+)
+{
+	m_pStart = reinterpret_cast<const char*>(pData);
+	m_pEnd = m_pStart + iSize;
+	m_pCurr = m_pStart + (iSize < kiHeaderSize ? iSize : kiHeaderSize);
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	File header
+-----------------------------------------------------------------------------------------*/
+
+// Tests if the given file contents start with a text X-file header (any version, either
+// float size)
+bool CXFileTextReader::IsTextXFile
+(
+	const TUInt8* pData,
+	const TUInt32 iSize
+)
+{
+	return iSize >= kiHeaderSize && memcmp( pData, "xof ", 4 ) == 0 &&
+	       memcmp( pData + 8, "txt ", 4 ) == 0;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Tokens
+-----------------------------------------------------------------------------------------*/
+
+// Return the type of the next token without consuming it. Skips whitespace, separators and
+// comments
+CXFileTextReader::EToken CXFileTextReader::PeekToken()
+{
+	SkipWhitespace();
+	if (m_pCurr == m_pEnd)
+	{
+		return kTokenEnd;
+	}
+
+	const char c = *m_pCurr;
+	if (c == '{') return kTokenOpenBrace;
+	if (c == '}') return kTokenCloseBrace;
+	if (c == '"') return kTokenString;
+	if (c == '<') return kTokenGUID;
+	if (IsDigit( c ) || c == '-' || c == '+' || c == '.') return kTokenNumber;
+	return kTokenName;
+}
+
+
+// Read an identifier (template or object name)
+bool CXFileTextReader::ReadName( string& sName )
+{
+	SkipWhitespace();
+	const char* pNameStart = m_pCurr;
+	while (m_pCurr != m_pEnd && !IsNameDelimiter( *m_pCurr ))
+	{
+		++m_pCurr;
+	}
+	sName.assign( pNameStart, m_pCurr );
+	return m_pCurr != pNameStart;
+}
+
+
+// Read a quoted string
+bool CXFileTextReader::ReadString( string& sString )
+{
+	SkipWhitespace();
+	if (m_pCurr == m_pEnd || *m_pCurr != '"')
+	{
+		return false;
+	}
+	const char* pStringStart = ++m_pCurr;
+	while (m_pCurr != m_pEnd && *m_pCurr != '"')
+	{
+		++m_pCurr;
+	}
+	if (m_pCurr == m_pEnd)
+	{
+		return false;
+	}
+	sString.assign( pStringStart, m_pCurr );
+	++m_pCurr;
+	return true;
+}
+
+
+// Read an unsigned integer (DWORD or WORD members)
+bool CXFileTextReader::ReadUInt( TUInt32* piValue )
+{
+	SkipWhitespace();
+	if (m_pCurr == m_pEnd || !IsDigit( *m_pCurr ))
+	{
+		return false;
+	}
+	TUInt32 iValue = 0;
+	while (m_pCurr != m_pEnd && IsDigit( *m_pCurr ))
+	{
+		iValue = iValue * 10 + (*m_pCurr - '0');
+		++m_pCurr;
+	}
+	*piValue = iValue;
+	return true;
+}
+
+
+// Read a floating point number
+bool CXFileTextReader::ReadFloat( TFloat32* pfValue )
+{
+	SkipWhitespace();
+	const char* p = m_pCurr;
+
+	// Sign
+	bool bNegative = false;
+	if (p != m_pEnd && (*p == '-' || *p == '+'))
+	{
+		bNegative = (*p == '-');
+		++p;
+	}
+
+	// Accumulate up to 19 significant digits in an integer mantissa, tracking the decimal
+	// exponent separately. Further digits only affect the exponent
+	TUInt64 iMantissa = 0;
+	TInt32  iDigits = 0;
+	TInt32  iExponent = 0;
+	bool    bAnyDigits = false;
+	while (p != m_pEnd && IsDigit( *p ))
+	{
+		if (iDigits < 19)
+		{
+			iMantissa = iMantissa * 10 + (*p - '0');
+			if (iMantissa) ++iDigits;
+		}
+		else
+		{
+			++iExponent;
+		}
+		bAnyDigits = true;
+		++p;
+	}
+	if (p != m_pEnd && *p == '.')
+	{
+		++p;
+		while (p != m_pEnd && IsDigit( *p ))
+		{
+			if (iDigits < 19)
+			{
+				iMantissa = iMantissa * 10 + (*p - '0');
+				if (iMantissa) ++iDigits;
+				--iExponent;
+			}
+			bAnyDigits = true;
+			++p;
+		}
+	}
+	if (!bAnyDigits)
+	{
+		return false;
+	}
+
+	// Optional exponent
+	if (p != m_pEnd && (*p == 'e' || *p == 'E'))
+	{
+		++p;
+		bool bNegativeExp = false;
+		if (p != m_pEnd && (*p == '-' || *p == '+'))
+		{
+			bNegativeExp = (*p == '-');
+			++p;
+		}
+		TInt32 iExplicitExp = 0;
+		while (p != m_pEnd && IsDigit( *p ))
+		{
+			if (iExplicitExp < 1000) iExplicitExp = iExplicitExp * 10 + (*p - '0');
+			++p;
+		}
+		iExponent += bNegativeExp ? -iExplicitExp : iExplicitExp;
+	}
+	m_pCurr = p;
+
+	// Scale mantissa by exact powers of ten (in double precision, then round to float)
+	TFloat64 fValue = static_cast<TFloat64>(iMantissa);
+	if (iMantissa != 0)
+	{
+		while (iExponent > kiMaxExactPower)
+		{
+			fValue *= kafPowersOfTen[kiMaxExactPower];
+			iExponent -= kiMaxExactPower;
+		}
+		while (iExponent < -kiMaxExactPower)
+		{
+			fValue /= kafPowersOfTen[kiMaxExactPower];
+			iExponent += kiMaxExactPower;
+		}
+		if (iExponent >= 0)
+		{
+			fValue *= kafPowersOfTen[iExponent];
+		}
+		else
+		{
+			fValue /= kafPowersOfTen[-iExponent];
+		}
+	}
+	*pfValue = static_cast<TFloat32>(bNegative ? -fValue : fValue);
+	return true;
+}
+
+
+// Read a run of floating point numbers, e.g. an array of vectors
+bool CXFileTextReader::ReadFloats
+(
+	TFloat32*     pfValues,
+	const TUInt32 iCount
+)
+{
+	for (TUInt32 i = 0; i < iCount; ++i)
+	{
+		if (!ReadFloat( pfValues + i ))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+// Tests if the next number is written as a floating point number (with a decimal point,
+// exponent or sign) rather than an integer
+bool CXFileTextReader::IsFloatNext()
+{
+	SkipWhitespace();
+	for (const char* p = m_pCurr; p != m_pEnd && !IsNameDelimiter( *p ); ++p)
+	{
+		if (*p == '.' || *p == 'e' || *p == 'E' || *p == '-' || *p == '+')
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+
+// Read an opening brace
+bool CXFileTextReader::ReadOpenBrace()
+{
+	SkipWhitespace();
+	if (m_pCurr == m_pEnd || *m_pCurr != '{')
+	{
+		return false;
+	}
+	++m_pCurr;
+	return true;
+}
+
+// Read a closing brace
+bool CXFileTextReader::ReadCloseBrace()
+{
+	SkipWhitespace();
+	if (m_pCurr == m_pEnd || *m_pCurr != '}')
+	{
+		return false;
+	}
+	++m_pCurr;
+	return true;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Data objects
+-----------------------------------------------------------------------------------------*/
+
+// Read the header of a data object: "Type [Name] [<GUID>] {". The name will be empty for
+// unnamed objects. Template definitions are also read with this function (type "template")
+bool CXFileTextReader::ReadObjectHeader
+(
+	string& sType,
+	string& sName
+)
+{
+	if (!ReadName( sType ))
+	{
+		return false;
+	}
+
+	// Optional name (may start with a digit)
+	sName.clear();
+	EToken token = PeekToken();
+	if (token == kTokenName || token == kTokenNumber)
+	{
+		ReadName( sName );
+		token = PeekToken();
+	}
+
+	// Optional GUID - ignored, objects are identified by template name
+	if (token == kTokenGUID)
+	{
+		const char* pGUIDEnd = static_cast<const char*>(memchr( m_pCurr, '>', m_pEnd - m_pCurr ));
+		if (!pGUIDEnd)
+		{
+			return false;
+		}
+		m_pCurr = pGUIDEnd + 1;
+	}
+
+	return ReadOpenBrace();
+}
+
+
+// Read a data reference: "{ Name [GUID] }"
+bool CXFileTextReader::ReadReference( string& sName )
+{
+	if (!ReadOpenBrace() || !ReadName( sName ))
+	{
+		return false;
+	}
+
+	// Skip optional GUID (given in braces-less form in references)
+	SkipWhitespace();
+	while (m_pCurr != m_pEnd && *m_pCurr != '}')
+	{
+		++m_pCurr;
+	}
+	return ReadCloseBrace();
+}
+
+
+// Skip the remainder of a data object (including child objects) after its opening brace has
+// been read. Consumes the matching closing brace
+bool CXFileTextReader::SkipObject()
+{
+	TUInt32 iDepth = 1;
+	while (m_pCurr != m_pEnd)
+	{
+		const char c = *m_pCurr++;
+		if (c == '{')
+		{
+			++iDepth;
+		}
+		else if (c == '}')
+		{
+			if (--iDepth == 0)
+			{
+				return true;
+			}
+		}
+		else if (c == '"')
+		{
+			while (m_pCurr != m_pEnd && *m_pCurr != '"') ++m_pCurr;
+			if (m_pCurr != m_pEnd) ++m_pCurr;
+		}
+		else if (c == '#' || (c == '/' && m_pCurr != m_pEnd && *m_pCurr == '/'))
+		{
+			while (m_pCurr != m_pEnd && *m_pCurr != '\n') ++m_pCurr;
+		}
+	}
+	return false;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Private interface
+-----------------------------------------------------------------------------------------*/
+
+// Skip whitespace, separators and comments
+void CXFileTextReader::SkipWhitespace()
+{
+	while (m_pCurr != m_pEnd)
+	{
+		const char c = *m_pCurr;
+		if (c <= ' ' || c == ';' || c == ',')
+		{
+			++m_pCurr;
+		}
+		else if (c == '#' || (c == '/' && m_pCurr + 1 != m_pEnd && m_pCurr[1] == '/'))
+		{
+			while (m_pCurr != m_pEnd && *m_pCurr != '\n') ++m_pCurr;
+		}
+		else
+		{
+			break;
+		}
+	}
+}
+
+
+} // namespace gen
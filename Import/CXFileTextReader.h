@@ -0,0 +1,157 @@
+/**************************************************************************************************
+	Module:       CXFileTextReader.h
+	Date created: 18/10/26
+
+	Tokeniser for the text encoding of Microsoft DirectX .X files ("xof 0303txt"). Works directly
+	on a memory-mapped file and has no dependency on the D3DX X-file API
+
+	Change history:
+		V1.0    Created 18/10/26
+		V1.1    Implements the CXFileReader interface shared with the binary reader
+**************************************************************************************************/
+
+#ifndef GEN_C_XFILE_TEXT_READER_H_INCLUDED
+#define GEN_C_XFILE_TEXT_READER_H_INCLUDED
+
+#include <string>
+using namespace std;
+
+#include "CXFileReader.h"
+
+namespace gen
+{
+
+// Reads the data objects of a text X-file (see CXFileReader). The separators ';' and ',' are
+// treated as whitespace
+class CXFileTextReader : public CXFileReader
+{
+	GEN_CLASS( CXFileTextReader )
+
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+public:
+	// Constructor takes the whole file contents, including the 16 byte file header
+	CXFileTextReader
+	(
+		const TUInt8* pData,
+		const TUInt32 iSize
+	);
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CXFileTextReader( const CXFileTextReader& );
+	CXFileTextReader& operator=( const CXFileTextReader& );
+
+
+/*-----------------------------------------------------------------------------------------
+	Public interface
+-----------------------------------------------------------------------------------------*/
+public:
+
+	/////////////////////////////////////
+	// File header
+
+	// Tests if the given file contents start with a text X-file header (any version, either
+	// float size)
+	static bool IsTextXFile
+	(
+		const TUInt8* pData,
+		const TUInt32 iSize
+	);
+
+
+	/////////////////////////////////////
+	// Tokens
+
+	// Return the type of the next token without consuming it. Skips whitespace, separators and
+	// comments
+	virtual EToken PeekToken();
+
+	// Read an identifier (template or object name)
+	virtual bool ReadName( string& sName );
+
+	// Read a quoted string
+	virtual bool ReadString( string& sString );
+
+	// Read an unsigned integer (DWORD or WORD members)
+	virtual bool ReadUInt( TUInt32* piValue );
+
+	// Read a floating point number
+	virtual bool ReadFloat( TFloat32* pfValue );
+
+	// Tests if the next number is written as a floating point number (with a decimal point,
+	// exponent or sign) rather than an integer
+	bool IsFloatNext();
+
+	// Read a run of floating point numbers, e.g. an array of vectors
+	virtual bool ReadFloats
+	(
+		TFloat32*     pfValues,
+		const TUInt32 iCount
+	);
+
+	// Read an opening / closing brace
+	virtual bool ReadOpenBrace();
+	virtual bool ReadCloseBrace();
+
+
+	/////////////////////////////////////
+	// Data objects
+
+	// Read the header of a data object: "Type [Name] [<GUID>] {". The name will be empty for
+	// unnamed objects. Template definitions are also read with this function (type "template")
+	virtual bool ReadObjectHeader
+	(
+		string& sType,
+		string& sName
+	);
+
+	// Read a data reference: "{ Name [GUID] }"
+	virtual bool ReadReference( string& sName );
+
+	// Skip the remainder of a data object (including child objects) after its opening brace has
+	// been read. Consumes the matching closing brace
+	virtual bool SkipObject();
+
+
+	/////////////////////////////////////
+	// Position
+
+	// Number of bytes consumed so far (including file header)
+	virtual TUInt32 GetOffset() const
+	{
+		return static_cast<TUInt32>(m_pCurr - m_pStart);
+	}
+
+	// Move to the given offset, as returned by GetOffset, to read from that point again
+	virtual void SetOffset( const TUInt32 iOffset )
+	{
+		m_pCurr = m_pStart + (iOffset < m_pEnd - m_pStart ? iOffset : m_pEnd - m_pStart);
+	}
+
+
+/*-----------------------------------------------------------------------------------------
+	Private interface
+-----------------------------------------------------------------------------------------*/
+private:
+
+	// Skip whitespace, separators and comments
+	void SkipWhitespace();
+
+
+/*-----------------------------------------------------------------------------------------
+	Data
+-----------------------------------------------------------------------------------------*/
+private:
+
+	// File data being read, current position and end of data
+	const char* m_pStart;
+	const char* m_pCurr;
+	const char* m_pEnd;
+};
+
+
+} // namespace gen
+
+#endif // GEN_C_XFILE_TEXT_READER_H_INCLUDED
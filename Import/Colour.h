@@ -8,9 +8,6 @@
 #ifndef GEN_COLOUR_H_INCLUDED
 #define GEN_COLOUR_H_INCLUDED
 
-#include <d3d10.h>
-#include <d3dx10.h>
-
 #include "GenDefines.h"
 
 namespace gen
@@ -33,18 +30,6 @@ struct SColourRGBA
 };
 
 
-// Reinterpret a SColourRGBA as a D3DXCOLOR - in various forms (const & ptr)
-inline D3DXCOLOR& ToD3DXCOLOR( SColourRGBA& colour )
-{
-	return *reinterpret_cast<D3DXCOLOR*>(&colour);
-}
-
-inline const D3DXCOLOR& ToD3DXCOLOR( const SColourRGBA& colour )
-{
-	return *reinterpret_cast<const D3DXCOLOR*>(&colour);
-}
-
-
 } // namespace gen
 
 #endif // GEN_COLOUR_H_INCLUDED
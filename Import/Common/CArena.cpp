@@ -0,0 +1,125 @@
+/**************************************************************************************************
+	Module:       CArena.cpp
+	Date created: 18/10/26
+
+	Monotonic memory arena and an STL allocator that uses it. Used to hold many small arrays that
+	are all released together, e.g. the data of the meshes in an import
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#include "CArena.h"
+#include "Error.h"
+
+namespace gen
+{
+
+namespace
+{
+	// Blocks stop doubling in size at this limit
+	const size_t kiMaxBlockSize = 4 * 1024 * 1024;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+
+// Constructor - no memory is reserved until the first allocation. Blocks start at the given
+// size and double in size up to a limit, larger allocations get a block of their own
+CArena::CArena( const size_t iFirstBlockSize /*= 64 * 1024*/ )
+{
+	m_pCurr = 0;
+	m_pEnd = 0;
+	m_iFirstBlockSize = iFirstBlockSize;
+	m_iNextBlockSize = iFirstBlockSize;
+	m_iSize = 0;
+}
+
+// Destructor frees all blocks
+CArena::~CArena()
+{
+	Reset();
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Public interface
+-----------------------------------------------------------------------------------------*/
+
+// Allocate the given number of bytes with the given alignment (a power of two)
+void* CArena::Allocate
+(
+	const size_t iSize,
+	const size_t iAlignment
+)
+{
+	GEN_GUARD;
+
+	// Use the current block if there is room
+	size_t iPadding = (iAlignment - reinterpret_cast<size_t>(m_pCurr)) & (iAlignment - 1);
+	if (m_pCurr && iPadding + iSize <= static_cast<size_t>(m_pEnd - m_pCurr))
+	{
+		TUInt8* pMemory = m_pCurr + iPadding;
+		m_pCurr = pMemory + iSize;
+		return pMemory;
+	}
+
+	// Allocations larger than a block get a block of their own, placed before the current block
+	// so it stays in use. The heap aligns blocks for any type
+	m_Blocks.reserve( m_Blocks.size() + 1 );
+	if (iSize > m_iNextBlockSize)
+	{
+		TUInt8* pBlock = static_cast<TUInt8*>(::operator new( iSize ));
+		m_Blocks.insert( m_Blocks.empty() ? m_Blocks.end() : m_Blocks.end() - 1, pBlock );
+		m_iSize += iSize;
+		return pBlock;
+	}
+
+	// Otherwise start a new block, the rest of the previous block is left unused
+	size_t iBlockSize = m_iNextBlockSize;
+	if (m_iNextBlockSize < kiMaxBlockSize)
+	{
+		m_iNextBlockSize *= 2;
+	}
+	TUInt8* pBlock = static_cast<TUInt8*>(::operator new( iBlockSize ));
+	m_Blocks.push_back( pBlock );
+	m_iSize += iBlockSize;
+	m_pCurr = pBlock + iSize;
+	m_pEnd = pBlock + iBlockSize;
+	return pBlock;
+
+	GEN_ENDGUARD;
+}
+
+// Free an allocation. Only the most recent allocation is actually freed, other memory is released
+// when the arena is reset
+void CArena::Free
+(
+	void*        pMemory,
+	const size_t iSize
+)
+{
+	if (static_cast<TUInt8*>(pMemory) + iSize == m_pCurr)
+	{
+		m_pCurr = static_cast<TUInt8*>(pMemory);
+	}
+}
+
+// Free all allocations and return the blocks to the system
+void CArena::Reset()
+{
+	for (TUInt32 iBlock = 0; iBlock < m_Blocks.size(); ++iBlock)
+	{
+		::operator delete( m_Blocks[iBlock] );
+	}
+	m_Blocks.clear();
+	m_pCurr = 0;
+	m_pEnd = 0;
+	m_iNextBlockSize = m_iFirstBlockSize;
+	m_iSize = 0;
+}
+
+
+} // namespace gen
@@ -0,0 +1,163 @@
+/**************************************************************************************************
+	Module:       CArena.h
+	Date created: 18/10/26
+
+	Monotonic memory arena and an STL allocator that uses it. Used to hold many small arrays that
+	are all released together, e.g. the data of the meshes in an import
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#ifndef GEN_C_ARENA_H_INCLUDED
+#define GEN_C_ARENA_H_INCLUDED
+
+#include <cstddef>
+#include <vector>
+#include <type_traits>
+#include <new>
+using namespace std;
+
+#include "GenDefines.h"
+
+namespace gen
+{
+
+// Memory is taken from large blocks in order and is not returned to the system until the arena
+// is reset or destroyed. Freeing the most recent allocation makes its space available again, so
+// a container growing at the end of the arena does not waste space. Not thread-safe
+class CArena
+{
+	GEN_CLASS( CArena )
+
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+public:
+	// Constructor - no memory is reserved until the first allocation. Blocks start at the given
+	// size and double in size up to a limit, larger allocations get a block of their own
+	CArena( const size_t iFirstBlockSize = 64 * 1024 );
+
+	// Destructor frees all blocks
+	~CArena();
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CArena( const CArena& );
+	CArena& operator=( const CArena& );
+
+
+/*-----------------------------------------------------------------------------------------
+	Public interface
+-----------------------------------------------------------------------------------------*/
+public:
+
+	// Allocate the given number of bytes with the given alignment (a power of two)
+	void* Allocate
+	(
+		const size_t iSize,
+		const size_t iAlignment
+	);
+
+	// Free an allocation. Only the most recent allocation is actually freed, other memory is
+	// released when the arena is reset
+	void Free
+	(
+		void*        pMemory,
+		const size_t iSize
+	);
+
+	// Free all allocations and return the blocks to the system
+	void Reset();
+
+	// Number of blocks and the total size of the blocks held
+	TUInt32 GetNumBlocks() const
+	{
+		return static_cast<TUInt32>(m_Blocks.size());
+	}
+	size_t GetSize() const
+	{
+		return m_iSize;
+	}
+
+
+/*-----------------------------------------------------------------------------------------
+	Data
+-----------------------------------------------------------------------------------------*/
+private:
+
+	// Blocks held, and the current position and end of the block that allocations are taken from
+	vector<TUInt8*> m_Blocks;
+	TUInt8*         m_pCurr;
+	TUInt8*         m_pEnd;
+
+	// Size of the next block, and total size of the blocks held
+	size_t          m_iFirstBlockSize;
+	size_t          m_iNextBlockSize;
+	size_t          m_iSize;
+};
+
+
+// STL allocator taking memory from an arena, or from the heap if constructed without one. The
+// arena is chosen when a container is created and moves with its contents when containers are
+// moved or swapped. The arena must outlive any container using it
+template <class T>
+class CArenaAllocator
+{
+public:
+	typedef T         value_type;
+	typedef true_type propagate_on_container_copy_assignment;
+	typedef true_type propagate_on_container_move_assignment;
+	typedef true_type propagate_on_container_swap;
+
+	CArenaAllocator( CArena* pArena = 0 ) : m_pArena( pArena ) {}
+
+	template <class U>
+	CArenaAllocator( const CArenaAllocator<U>& allocator ) : m_pArena( allocator.GetArena() ) {}
+
+	T* allocate( const size_t iCount )
+	{
+		if (m_pArena)
+		{
+			return static_cast<T*>(m_pArena->Allocate( iCount * sizeof(T), alignof(T) ));
+		}
+		return static_cast<T*>(::operator new( iCount * sizeof(T) ));
+	}
+
+	void deallocate( T* p, const size_t iCount )
+	{
+		if (m_pArena)
+		{
+			m_pArena->Free( p, iCount * sizeof(T) );
+		}
+		else
+		{
+			::operator delete( p );
+		}
+	}
+
+	CArena* GetArena() const
+	{
+		return m_pArena;
+	}
+
+private:
+	CArena* m_pArena;
+};
+
+template <class T, class U>
+inline bool operator==( const CArenaAllocator<T>& a, const CArenaAllocator<U>& b )
+{
+	return a.GetArena() == b.GetArena();
+}
+
+template <class T, class U>
+inline bool operator!=( const CArenaAllocator<T>& a, const CArenaAllocator<U>& b )
+{
+	return a.GetArena() != b.GetArena();
+}
+
+
+} // namespace gen
+
+#endif // GEN_C_ARENA_H_INCLUDED
@@ -0,0 +1,155 @@
+/**************************************************************************************************
+	Module:       CMappedFile.cpp
+	Date created: 18/10/26
+
+	Read-only memory-mapped view of a whole file. Used by the importers to parse files in place
+	without copying them through stdio buffers
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#if defined(_WIN32)
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+#include "CMappedFile.h"
+#include "Error.h"
+
+namespace gen
+{
+
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+
+// Constructor - no file is mapped until Open is called
+CMappedFile::CMappedFile()
+{
+	m_pData = 0;
+	m_iSize = 0;
+	m_hFile = 0;
+	m_hMapping = 0;
+}
+
+// Destructor unmaps any open file
+CMappedFile::~CMappedFile()
+{
+	Close();
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Public interface
+-----------------------------------------------------------------------------------------*/
+
+// Map the entire given file into memory for reading, any previously mapped file is closed
+// first. Returns false if the file is missing, empty or cannot be mapped
+bool CMappedFile::Open( const string& sFileName )
+{
+	GEN_GUARD;
+
+	Close();
+
+#if defined(_WIN32)
+	HANDLE hFile = CreateFileA( sFileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+	                            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+	if (hFile == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	// Empty files cannot be mapped, large files are not supported by the 32-bit size
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx( hFile, &fileSize ) || fileSize.QuadPart == 0 || fileSize.HighPart != 0)
+	{
+		CloseHandle( hFile );
+		return false;
+	}
+
+	HANDLE hMapping = CreateFileMappingA( hFile, NULL, PAGE_READONLY, 0, 0, NULL );
+	if (!hMapping)
+	{
+		CloseHandle( hFile );
+		return false;
+	}
+
+	const void* pView = MapViewOfFile( hMapping, FILE_MAP_READ, 0, 0, 0 );
+	if (!pView)
+	{
+		CloseHandle( hMapping );
+		CloseHandle( hFile );
+		return false;
+	}
+
+	m_hFile = hFile;
+	m_hMapping = hMapping;
+	m_pData = static_cast<const TUInt8*>(pView);
+	m_iSize = fileSize.LowPart;
+
+#else
+	int iFile = open( sFileName.c_str(), O_RDONLY );
+	if (iFile < 0)
+	{
+		return false;
+	}
+
+	struct stat fileStat;
+	if (fstat( iFile, &fileStat ) != 0 || fileStat.st_size == 0 ||
+	    static_cast<TUInt64>(fileStat.st_size) > 0xffffffffu)
+	{
+		close( iFile );
+		return false;
+	}
+
+	void* pView = mmap( 0, fileStat.st_size, PROT_READ, MAP_PRIVATE, iFile, 0 );
+	close( iFile ); // Mapping remains valid after the descriptor is closed
+	if (pView == MAP_FAILED)
+	{
+		return false;
+	}
+	madvise( pView, fileStat.st_size, MADV_SEQUENTIAL );
+
+	m_pData = static_cast<const TUInt8*>(pView);
+	m_iSize = static_cast<TUInt32>(fileStat.st_size);
+#endif
+
+	return true;
+
+	GEN_ENDGUARD;
+}
+
+
+// Unmap the current file (if any)
+void CMappedFile::Close()
+{
+	GEN_GUARD;
+
+	if (!m_pData)
+	{
+		return;
+	}
+
+#if defined(_WIN32)
+	UnmapViewOfFile( m_pData );
+	CloseHandle( static_cast<HANDLE>(m_hMapping) );
+	CloseHandle( static_cast<HANDLE>(m_hFile) );
+#else
+	munmap( const_cast<TUInt8*>(m_pData), m_iSize );
+#endif
+
+	m_pData = 0;
+	m_iSize = 0;
+	m_hFile = 0;
+	m_hMapping = 0;
+
+	GEN_ENDGUARD;
+}
+
+
+} // namespace gen
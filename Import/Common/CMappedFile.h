@@ -0,0 +1,93 @@
+/**************************************************************************************************
+	Module:       CMappedFile.h
+	Date created: 18/10/26
+
+	Read-only memory-mapped view of a whole file. Used by the importers to parse files in place
+	without copying them through stdio buffers
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#ifndef GEN_C_MAPPED_FILE_H_INCLUDED
+#define GEN_C_MAPPED_FILE_H_INCLUDED
+
+#include <string>
+using namespace std;
+
+#include "GenDefines.h"
+
+namespace gen
+{
+
+class CMappedFile
+{
+	GEN_CLASS( CMappedFile )
+
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+public:
+	// Constructor - no file is mapped until Open is called
+	CMappedFile();
+
+	// Destructor unmaps any open file
+	~CMappedFile();
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CMappedFile( const CMappedFile& );
+	CMappedFile& operator=( const CMappedFile& );
+
+
+/*-----------------------------------------------------------------------------------------
+	Public interface
+-----------------------------------------------------------------------------------------*/
+public:
+
+	// Map the entire given file into memory for reading, any previously mapped file is closed
+	// first. Returns false if the file is missing, empty or cannot be mapped
+	bool Open( const string& sFileName );
+
+	// Unmap the current file (if any)
+	void Close();
+
+
+	// Is a file currently mapped
+	bool IsOpen() const
+	{
+		return m_pData != 0;
+	}
+
+	// Start of the mapped file data. The data is not null-terminated, use GetSize
+	const TUInt8* GetData() const
+	{
+		return m_pData;
+	}
+
+	// Size of the mapped file data in bytes
+	TUInt32 GetSize() const
+	{
+		return m_iSize;
+	}
+
+
+/*-----------------------------------------------------------------------------------------
+	Data
+-----------------------------------------------------------------------------------------*/
+private:
+
+	// Mapped view of the file and its size
+	const TUInt8* m_pData;
+	TUInt32       m_iSize;
+
+	// OS handles for the file and the mapping (unused on POSIX systems, where the file can be
+	// closed as soon as it is mapped)
+	void*         m_hFile;
+	void*         m_hMapping;
+};
+
+
+} // namespace gen
+
+#endif // GEN_C_MAPPED_FILE_H_INCLUDED
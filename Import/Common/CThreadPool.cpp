@@ -0,0 +1,100 @@
+/**************************************************************************************************
+	Module:       CThreadPool.cpp
+	Date created: 18/10/26
+
+	Fixed size pool of worker threads that run queued tasks. Used to run CPU-side import work
+	(parsing, mesh processing) in parallel
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#include "CThreadPool.h"
+
+namespace gen
+{
+
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+
+// Constructor starts the given number of worker threads, or one per hardware thread if 0
+CThreadPool::CThreadPool( const TUInt32 iNumThreads /*= 0*/ )
+{
+	m_bStopping = false;
+
+	TUInt32 iThreads = iNumThreads;
+	if (iThreads == 0)
+	{
+		iThreads = thread::hardware_concurrency();
+		if (iThreads == 0)
+		{
+			iThreads = 1;
+		}
+	}
+
+	m_Threads.reserve( iThreads );
+	for (TUInt32 iThread = 0; iThread < iThreads; ++iThread)
+	{
+		m_Threads.push_back( thread( &CThreadPool::WorkerThread, this ) );
+	}
+}
+
+// Destructor completes all queued tasks then stops the worker threads
+CThreadPool::~CThreadPool()
+{
+	{
+		lock_guard<mutex> lock( m_Mutex );
+		m_bStopping = true;
+	}
+	m_TaskAvailable.notify_all();
+
+	for (TUInt32 iThread = 0; iThread < m_Threads.size(); ++iThread)
+	{
+		m_Threads[iThread].join();
+	}
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Private interface
+-----------------------------------------------------------------------------------------*/
+
+// Add a task to the queue and wake a worker thread
+void CThreadPool::Enqueue( function<void()> task )
+{
+	{
+		lock_guard<mutex> lock( m_Mutex );
+		m_Tasks.push_back( task );
+	}
+	m_TaskAvailable.notify_one();
+}
+
+
+// Main function of each worker thread, runs tasks until the pool is stopped and the queue is empty
+void CThreadPool::WorkerThread()
+{
+	while (true)
+	{
+		function<void()> task;
+		{
+			unique_lock<mutex> lock( m_Mutex );
+			while (!m_bStopping && m_Tasks.empty())
+			{
+				m_TaskAvailable.wait( lock );
+			}
+			if (m_Tasks.empty())
+			{
+				return; // Stopping and no work left
+			}
+			task = m_Tasks.front();
+			m_Tasks.pop_front();
+		}
+
+		// Exceptions are captured by the packaged task in Submit, so none reach here
+		task();
+	}
+}
+
+
+} // namespace gen
@@ -0,0 +1,103 @@
+/**************************************************************************************************
+	Module:       CThreadPool.h
+	Date created: 18/10/26
+
+	Fixed size pool of worker threads that run queued tasks. Used to run CPU-side import work
+	(parsing, mesh processing) in parallel
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#ifndef GEN_C_THREAD_POOL_H_INCLUDED
+#define GEN_C_THREAD_POOL_H_INCLUDED
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+using namespace std;
+
+#include "GenDefines.h"
+
+namespace gen
+{
+
+class CThreadPool
+{
+	GEN_CLASS( CThreadPool )
+
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+public:
+	// Constructor starts the given number of worker threads, or one per hardware thread if 0
+	CThreadPool( const TUInt32 iNumThreads = 0 );
+
+	// Destructor completes all queued tasks then stops the worker threads
+	~CThreadPool();
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CThreadPool( const CThreadPool& );
+	CThreadPool& operator=( const CThreadPool& );
+
+
+/*-----------------------------------------------------------------------------------------
+	Public interface
+-----------------------------------------------------------------------------------------*/
+public:
+
+	// Number of worker threads in the pool
+	TUInt32 GetNumThreads() const
+	{
+		return static_cast<TUInt32>(m_Threads.size());
+	}
+
+	// Queue a task (any callable taking no parameters) to be run on a worker thread. Returns a
+	// future holding the task's result, or any exception it throws
+	template <class TTask>
+	future<typename result_of<TTask()>::type> Submit( TTask task )
+	{
+		typedef typename result_of<TTask()>::type TResult;
+		shared_ptr< packaged_task<TResult()> > pTask( new packaged_task<TResult()>( task ) );
+		future<TResult> result = pTask->get_future();
+		Enqueue( [pTask]() { (*pTask)(); } );
+		return result;
+	}
+
+
+/*-----------------------------------------------------------------------------------------
+	Private interface
+-----------------------------------------------------------------------------------------*/
+private:
+
+	// Add a task to the queue and wake a worker thread
+	void Enqueue( function<void()> task );
+
+	// Main function of each worker thread, runs tasks until the pool is stopped
+	void WorkerThread();
+
+
+/*-----------------------------------------------------------------------------------------
+	Data
+-----------------------------------------------------------------------------------------*/
+private:
+
+	vector<thread>           m_Threads;
+
+	// Queued tasks, protected by the mutex. Workers wait on the condition for new tasks
+	deque< function<void()> > m_Tasks;
+	mutex                    m_Mutex;
+	condition_variable       m_TaskAvailable;
+	bool                     m_bStopping;
+};
+
+
+} // namespace gen
+
+#endif // GEN_C_THREAD_POOL_H_INCLUDED
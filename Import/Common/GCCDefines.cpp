@@ -0,0 +1,54 @@
+/**************************************************************************************************
+	Module:       GCCDefines.cpp
+	Date created: 18/10/26
+
+	Utility functions for GCC and Clang platforms (Linux)
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+// Only built for GCC and Clang, so all platform sources can be compiled together
+#if defined(__GNUC__) && !defined(_MSC_VER)
+
+#include <cstdio>
+
+#include "GenDefines.h"
+#include "GCCDefines.h"
+#include "Error.h"
+
+namespace gen
+{
+
+/*------------------------------------------------------------------------------------------------
+	Console support
+ ------------------------------------------------------------------------------------------------*/
+
+// System message box used to display errors or warnings. There is no GUI, so the message is
+// written to stderr. If Yes/No buttons are requested the answer is read from stdin. Return value
+// is whether the answer was Yes, or true for an OK message
+bool SystemMessageBox
+(
+	const string& sMessage, // Main message to display
+	const string& sCaption, // Caption to display at top of box
+	const bool    bYesNo    // Display Yes and No buttons instead of OK
+)
+{
+	GEN_GUARD;
+
+	fprintf( stderr, "%s\n%s\n", sCaption.c_str(), sMessage.c_str() );
+	if (!bYesNo)
+	{
+		return true;
+	}
+	fprintf( stderr, "(y/n) " );
+	int iAnswer = getchar();
+	return (iAnswer == 'y' || iAnswer == 'Y');
+
+	GEN_ENDGUARD;
+}
+
+
+} // namespace gen
+
+#endif // defined(__GNUC__) && !defined(_MSC_VER)
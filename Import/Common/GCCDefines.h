@@ -0,0 +1,91 @@
+/**************************************************************************************************
+	Module:       GCCDefines.h
+	Date created: 18/10/26
+
+	Utility functions for GCC and Clang platforms (Linux)
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#ifndef GEN_GCC_DEFINES_H_INCLUDED
+#define GEN_GCC_DEFINES_H_INCLUDED
+
+#include <string>
+using namespace std;
+
+namespace gen
+{
+
+/*------------------------------------------------------------------------------------------------
+	Compiler settings
+ ------------------------------------------------------------------------------------------------*/
+
+// Check compiler options
+#if !defined(__EXCEPTIONS) && !defined(__cpp_exceptions)
+	#error "Bad compiler option: C++ exception handling must be enabled"
+#endif
+
+
+/*------------------------------------------------------------------------------------------------
+	Macros
+ ------------------------------------------------------------------------------------------------*/
+
+// Prefix to align a structure or class in memory to a multiple of the given amount
+#define GEN_ALIGN(a) __attribute__((aligned(a)))
+
+
+/*------------------------------------------------------------------------------------------------
+	Constants
+ ------------------------------------------------------------------------------------------------*/
+
+// Define compiler name
+#if defined(__clang__)
+	static const string ksCompiler = "Clang " __clang_version__;
+#else
+	static const string ksCompiler = "GCC " __VERSION__;
+#endif
+
+
+// String locale
+const string ksPathSeparator = "/";
+const string ksNewline = "\n";
+
+
+/*------------------------------------------------------------------------------------------------
+	Types
+ ------------------------------------------------------------------------------------------------*/
+
+// Typedefs for fixed size types
+typedef signed char        TInt8;
+typedef signed short       TInt16;
+typedef signed int         TInt32;
+typedef signed long long   TInt64;
+
+typedef unsigned char      TUInt8;
+typedef unsigned short     TUInt16;
+typedef unsigned int       TUInt32;
+typedef unsigned long long TUInt64;
+
+typedef float              TFloat32;
+typedef double             TFloat64;
+
+
+/*------------------------------------------------------------------------------------------------
+	Console support
+ ------------------------------------------------------------------------------------------------*/
+
+// System message box used to display errors or warnings. There is no GUI, so the message is
+// written to stderr. If Yes/No buttons are requested the answer is read from stdin. Return value
+// is whether the answer was Yes, or true for an OK message
+bool SystemMessageBox
+(
+	const string& sMessage,                       // Main message to display
+	const string& sCaption = "TL-Engine Extreme", // Caption to display at top of box
+	const bool    bYesNo = false                  // Display Yes and No buttons instead of OK
+);
+
+
+} // namespace gen
+
+#endif // GEN_GCC_DEFINES_H_INCLUDED
@@ -11,6 +11,9 @@
 		V1.0    Created 23/09/05 - LN
 **************************************************************************************************/
 
+// Only built for Microsoft compilers, so all platform sources can be compiled together
+#if defined(_MSC_VER)
+
 #include <Windows.h>
 #include <AtlBase.h> // Used for string conversion macros (CA2CT below)
 
@@ -72,3 +75,5 @@ bool SystemMessageBox
 
 
 } // namespace gen
+
+#endif // defined(_MSC_VER)
@@ -16,6 +16,7 @@
 #define GEN_C_BASE_MATH_H_INCLUDED
 
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 #include "GenDefines.h"
@@ -76,7 +77,7 @@ enum ERoundingMethod
 // Many versions provided here to allow mixing of parameter types for these basic functions
 
 inline TUInt32 Abs( const TInt32 x ) { return abs( static_cast<int>(x) ); }
-inline TUInt64 Abs( const TInt64 x ) { return _abs64( x ); }
+inline TUInt64 Abs( const TInt64 x ) { return llabs( x ); }
 inline TFloat32 Abs( const TFloat32 x ) { return fabsf( x ); }
 inline TFloat64 Abs( const TFloat64 x ) { return fabs( x ); }
 
@@ -401,8 +402,10 @@ inline bool AreEqual
 	const TUInt32  iEpsilonFrac = 4
 )
 {
-	// Reinterpret 32-bit float as 32-bit unsigned int
-    TInt32 xInt = *(TInt32*)&x;
+	// Reinterpret 32-bit float as 32-bit unsigned int (memcpy rather than a pointer cast, which
+	// breaks strict aliasing rules and can be miscompiled by GCC and Clang)
+    TInt32 xInt;
+    memcpy( &xInt, &x, sizeof(xInt) );
     if (xInt < 0)
 	{
 		// Reorder negative values so we can use integer comparison
@@ -410,7 +413,8 @@ inline bool AreEqual
 	}
 
 	// Same with second value
-    TInt32 yInt = *(TInt32*)&y;
+    TInt32 yInt;
+    memcpy( &yInt, &y, sizeof(yInt) );
     if (yInt < 0)
 	{
         yInt = 0x80000000 - yInt;
@@ -434,7 +438,8 @@ inline bool AreEqual
 )
 {
 	// Reinterpret 64-bit float as 64-bit unsigned int
-    TInt64 xInt = *(TInt64*)&x;
+    TInt64 xInt;
+    memcpy( &xInt, &x, sizeof(xInt) );
     if (xInt < 0)
 	{
 		// Reorder negative values so we can use integer comparison
@@ -442,7 +447,8 @@ inline bool AreEqual
 	}
 
 	// Same with second value
-    TInt64 yInt = *(TInt64*)&y;
+    TInt64 yInt;
+    memcpy( &yInt, &y, sizeof(yInt) );
     if (yInt < 0)
 	{
         yInt = 0x8000000000000000 - yInt;
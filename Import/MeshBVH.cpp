@@ -0,0 +1,666 @@
+/**************************************************************************************************
+	Module:       MeshBVH.cpp
+	Date created: 18/10/26
+
+	Bounding volume hierarchies for ray queries (picking, line of sight). Built over boxes with the
+	surface area heuristic on binned centres, stored as 32 byte nodes, and for triangles traversed
+	testing a leaf of four triangles at a time with SSE
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <xmmintrin.h>
+
+#include "MeshBVH.h"
+#include "BaseMath.h"
+#include "Error.h"
+
+namespace gen
+{
+
+namespace
+{
+	// Number of bins the box centres are sorted into on each axis to find a split
+	const TUInt32 kiNumBins = 12;
+
+	// Get the position of a vertex in a sub-mesh
+	inline CVector3 GetPosition
+	(
+		const SSubMesh& subMesh,
+		const TUInt32   iVertex
+	)
+	{
+		CVector3 vPosition;
+		memcpy( &vPosition, subMesh.vertices + iVertex * subMesh.vertexSize, sizeof(CVector3) );
+		return vPosition;
+	}
+
+	// Get the vertex indices of a face in a sub-mesh
+	inline void GetFace
+	(
+		const SSubMesh& subMesh,
+		const TUInt32   iFace,
+		TUInt32*        aiIndices
+	)
+	{
+		for (TUInt32 iCorner = 0; iCorner < 3; ++iCorner)
+		{
+			aiIndices[iCorner] = (subMesh.indexSize == sizeof(TUInt32)) ?
+			                     reinterpret_cast<const TUInt32*>(subMesh.faces)[iFace * 3 + iCorner] :
+			                     reinterpret_cast<const TUInt16*>(subMesh.faces)[iFace * 3 + iCorner];
+		}
+	}
+
+	// Grow a box to include another
+	inline void GrowBox
+	(
+		const CVector3& minBounds,
+		const CVector3& maxBounds,
+		CVector3*       pMinBounds,
+		CVector3*       pMaxBounds
+	)
+	{
+		*pMinBounds = CVector3( Min( pMinBounds->x, minBounds.x ), Min( pMinBounds->y, minBounds.y ),
+		                        Min( pMinBounds->z, minBounds.z ) );
+		*pMaxBounds = CVector3( Max( pMaxBounds->x, maxBounds.x ), Max( pMaxBounds->y, maxBounds.y ),
+		                        Max( pMaxBounds->z, maxBounds.z ) );
+	}
+
+	// Half the surface area of a box - the surface area heuristic only compares areas
+	inline TFloat32 HalfArea
+	(
+		const CVector3& minBounds,
+		const CVector3& maxBounds
+	)
+	{
+		CVector3 vSize = maxBounds - minBounds;
+		return vSize.x * vSize.y + vSize.y * vSize.z + vSize.z * vSize.x;
+	}
+
+	// An empty box, which any box grows to fit
+	const CVector3 kEmptyMin( 3.0e38f, 3.0e38f, 3.0e38f );
+	const CVector3 kEmptyMax( -3.0e38f, -3.0e38f, -3.0e38f );
+
+	// Items with their centres in a range of a bin axis
+	struct SBin
+	{
+		CVector3 minBounds;
+		CVector3 maxBounds;
+		TUInt32  iCount;
+	};
+
+	// A node waiting to be split, with its range of the item list
+	struct SBuildTask
+	{
+		TUInt32 iNode;
+		TUInt32 iStart;
+		TUInt32 iEnd;
+		TUInt32 iDepth;
+	};
+
+
+	// Horizontal minimum and maximum of the x, y & z components of a vector
+	inline __m128 Min3( const __m128 v )
+	{
+		return _mm_min_ss( _mm_min_ss( v, _mm_shuffle_ps( v, v, _MM_SHUFFLE(1, 1, 1, 1) ) ),
+		                   _mm_shuffle_ps( v, v, _MM_SHUFFLE(2, 2, 2, 2) ) );
+	}
+	inline __m128 Max3( const __m128 v )
+	{
+		return _mm_max_ss( _mm_max_ss( v, _mm_shuffle_ps( v, v, _MM_SHUFFLE(1, 1, 1, 1) ) ),
+		                   _mm_shuffle_ps( v, v, _MM_SHUFFLE(2, 2, 2, 2) ) );
+	}
+
+	// Cross and dot products of four vectors at once, each component in its own register
+	inline void Cross4
+	(
+		const __m128 ax, const __m128 ay, const __m128 az,
+		const __m128 bx, const __m128 by, const __m128 bz,
+		__m128* pX, __m128* pY, __m128* pZ
+	)
+	{
+		*pX = _mm_sub_ps( _mm_mul_ps( ay, bz ), _mm_mul_ps( az, by ) );
+		*pY = _mm_sub_ps( _mm_mul_ps( az, bx ), _mm_mul_ps( ax, bz ) );
+		*pZ = _mm_sub_ps( _mm_mul_ps( ax, by ), _mm_mul_ps( ay, bx ) );
+	}
+	inline __m128 Dot4
+	(
+		const __m128 ax, const __m128 ay, const __m128 az,
+		const __m128 bx, const __m128 by, const __m128 bz
+	)
+	{
+		return _mm_add_ps( _mm_add_ps( _mm_mul_ps( ax, bx ), _mm_mul_ps( ay, by ) ), _mm_mul_ps( az, bz ) );
+	}
+
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Building
+-----------------------------------------------------------------------------------------*/
+
+// Build a hierarchy over a list of boxes, splitting nodes with the surface area heuristic on
+// binned box centres
+void BuildBVH
+(
+	const CVector3*   pMinBounds,
+	const CVector3*   pMaxBounds,
+	const TUInt32     iNumItems,
+	vector<SBVHNode>* pNodes,
+	vector<TUInt32>*  pLeafItems
+)
+{
+	GEN_GUARD;
+
+	pNodes->clear();
+	pLeafItems->clear();
+	if (iNumItems == 0)
+	{
+		return;
+	}
+
+	// Items are sorted in place into the ranges of the nodes. Centres are doubled, which doesn't
+	// change the splits
+	vector<TUInt32> items( iNumItems );
+	vector<CVector3> centres( iNumItems );
+	SBVHNode root;
+	root.minBounds = kEmptyMin;
+	root.maxBounds = kEmptyMax;
+	for (TUInt32 iItem = 0; iItem < iNumItems; ++iItem)
+	{
+		items[iItem] = iItem;
+		centres[iItem] = pMinBounds[iItem] + pMaxBounds[iItem];
+		GrowBox( pMinBounds[iItem], pMaxBounds[iItem], &root.minBounds, &root.maxBounds );
+	}
+	pNodes->reserve( 2 * ((iNumItems + kiBVHLeafSize - 1) / kiBVHLeafSize) );
+	pNodes->push_back( root );
+
+	vector<SBuildTask> tasks;
+	SBuildTask rootTask = { 0, 0, iNumItems, 0 };
+	tasks.push_back( rootTask );
+	while (!tasks.empty())
+	{
+		SBuildTask task = tasks.back();
+		tasks.pop_back();
+		TUInt32 iCount = task.iEnd - task.iStart;
+
+		// Small nodes become leaves, with their items in the next group of leaf slots
+		if (iCount <= kiBVHLeafSize)
+		{
+			SBVHNode& leaf = (*pNodes)[task.iNode];
+			leaf.iFirst = static_cast<TUInt32>(pLeafItems->size()) / kiBVHLeafSize;
+			leaf.iCount = iCount;
+			for (TUInt32 iSlot = 0; iSlot < kiBVHLeafSize; ++iSlot)
+			{
+				pLeafItems->push_back( iSlot < iCount ? items[task.iStart + iSlot] : kiBVHNoItem );
+			}
+			continue;
+		}
+
+		// Find the range of the item centres, the bins divide it on each axis. Deep nodes skip the
+		// search and are split in half, so there are at most 32 more levels below them
+		CVector3 centreMin = kEmptyMin;
+		CVector3 centreMax = kEmptyMax;
+		if (task.iDepth < kiBVHMaxDepth / 2)
+		{
+			for (TUInt32 iItem = task.iStart; iItem < task.iEnd; ++iItem)
+			{
+				GrowBox( centres[items[iItem]], centres[items[iItem]], &centreMin, &centreMax );
+			}
+		}
+
+		// Sort the centres into bins on each axis, then sweep the bins from both ends to find the
+		// area and item count on each side of each bin boundary. The cost of a split is the area
+		// of each side times its items (the chance a ray enters a side times the work once it has)
+		TUInt32 iBestAxis = 0;
+		TUInt32 iBestSplit = 0;
+		TFloat32 fBestCost = 3.0e38f;
+		for (TUInt32 iAxis = 0; iAxis < 3; ++iAxis)
+		{
+			TFloat32 fExtent = centreMax[iAxis] - centreMin[iAxis];
+			if (fExtent <= 0.0f)
+			{
+				continue;
+			}
+			TFloat32 fBinScale = kiNumBins / fExtent;
+
+			SBin aBins[kiNumBins];
+			for (TUInt32 iBin = 0; iBin < kiNumBins; ++iBin)
+			{
+				aBins[iBin].minBounds = kEmptyMin;
+				aBins[iBin].maxBounds = kEmptyMax;
+				aBins[iBin].iCount = 0;
+			}
+			for (TUInt32 iItem = task.iStart; iItem < task.iEnd; ++iItem)
+			{
+				TUInt32 iIndex = items[iItem];
+				TUInt32 iBin = Min( static_cast<TUInt32>((centres[iIndex][iAxis] - centreMin[iAxis]) * fBinScale),
+				                    kiNumBins - 1 );
+				GrowBox( pMinBounds[iIndex], pMaxBounds[iIndex], &aBins[iBin].minBounds, &aBins[iBin].maxBounds );
+				++aBins[iBin].iCount;
+			}
+
+			// Area and count of all the bins to the right of each boundary
+			TFloat32 afRightCost[kiNumBins];
+			CVector3 rightMin = kEmptyMin;
+			CVector3 rightMax = kEmptyMax;
+			TUInt32 iRightCount = 0;
+			for (TUInt32 iBin = kiNumBins - 1; iBin > 0; --iBin)
+			{
+				GrowBox( aBins[iBin].minBounds, aBins[iBin].maxBounds, &rightMin, &rightMax );
+				iRightCount += aBins[iBin].iCount;
+				afRightCost[iBin] = iRightCount ? HalfArea( rightMin, rightMax ) * iRightCount : 0.0f;
+			}
+			CVector3 leftMin = kEmptyMin;
+			CVector3 leftMax = kEmptyMax;
+			TUInt32 iLeftCount = 0;
+			for (TUInt32 iSplit = 1; iSplit < kiNumBins; ++iSplit)
+			{
+				GrowBox( aBins[iSplit - 1].minBounds, aBins[iSplit - 1].maxBounds, &leftMin, &leftMax );
+				iLeftCount += aBins[iSplit - 1].iCount;
+				if (iLeftCount == 0 || iLeftCount == iCount)
+				{
+					continue;
+				}
+				TFloat32 fCost = HalfArea( leftMin, leftMax ) * iLeftCount + afRightCost[iSplit];
+				if (fCost < fBestCost)
+				{
+					fBestCost = fCost;
+					iBestAxis = iAxis;
+					iBestSplit = iSplit;
+				}
+			}
+		}
+
+		// Divide the items on the chosen bin boundary. If all the centres are in one place there is
+		// no boundary between them, so divide the items in half as they are
+		TUInt32 iMiddle;
+		if (iBestSplit > 0)
+		{
+			TFloat32 fBinScale = kiNumBins / (centreMax[iBestAxis] - centreMin[iBestAxis]);
+			TFloat32 fMin = centreMin[iBestAxis];
+			TUInt32* pMiddle = partition( &items[task.iStart], &items[0] + task.iEnd, [&]( TUInt32 iIndex )
+			{
+				return Min( static_cast<TUInt32>((centres[iIndex][iBestAxis] - fMin) * fBinScale), kiNumBins - 1 ) < iBestSplit;
+			} );
+			iMiddle = static_cast<TUInt32>(pMiddle - &items[0]);
+		}
+		else
+		{
+			iMiddle = task.iStart + iCount / 2;
+		}
+
+		// Add the two children next to each other, with boxes around their items
+		TUInt32 iFirstChild = static_cast<TUInt32>(pNodes->size());
+		TUInt32 aiStart[2] = { task.iStart, iMiddle };
+		TUInt32 aiEnd[2] = { iMiddle, task.iEnd };
+		for (TUInt32 iChild = 0; iChild < 2; ++iChild)
+		{
+			SBVHNode child;
+			child.minBounds = kEmptyMin;
+			child.maxBounds = kEmptyMax;
+			child.iFirst = 0;
+			child.iCount = 0;
+			for (TUInt32 iItem = aiStart[iChild]; iItem < aiEnd[iChild]; ++iItem)
+			{
+				GrowBox( pMinBounds[items[iItem]], pMaxBounds[items[iItem]], &child.minBounds, &child.maxBounds );
+			}
+			pNodes->push_back( child );
+		}
+		(*pNodes)[task.iNode].iFirst = iFirstChild;
+		(*pNodes)[task.iNode].iCount = 0;
+
+		// Split the right child after the left, so the nodes of each subtree are close together
+		SBuildTask rightTask = { iFirstChild + 1, iMiddle, task.iEnd, task.iDepth + 1 };
+		SBuildTask leftTask = { iFirstChild, task.iStart, iMiddle, task.iDepth + 1 };
+		tasks.push_back( rightTask );
+		tasks.push_back( leftTask );
+	}
+
+	GEN_ENDGUARD;
+}
+
+
+// Build a hierarchy over the faces of a sub-mesh
+void BuildMeshBVH
+(
+	const SSubMesh&   subMesh,
+	vector<SBVHNode>* pNodes,
+	vector<TUInt32>*  pLeafFaces
+)
+{
+	GEN_GUARD;
+
+	vector<CVector3> minBounds( subMesh.numFaces );
+	vector<CVector3> maxBounds( subMesh.numFaces );
+	for (TUInt32 iFace = 0; iFace < subMesh.numFaces; ++iFace)
+	{
+		TUInt32 aiIndices[3];
+		GetFace( subMesh, iFace, aiIndices );
+		minBounds[iFace] = maxBounds[iFace] = GetPosition( subMesh, aiIndices[0] );
+		for (TUInt32 iCorner = 1; iCorner < 3; ++iCorner)
+		{
+			CVector3 vPosition = GetPosition( subMesh, aiIndices[iCorner] );
+			GrowBox( vPosition, vPosition, &minBounds[iFace], &maxBounds[iFace] );
+		}
+	}
+	BuildBVH( minBounds.data(), maxBounds.data(), subMesh.numFaces, pNodes, pLeafFaces );
+
+	GEN_ENDGUARD;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Ray queries
+-----------------------------------------------------------------------------------------*/
+
+// Slab test of a ray against a node's box. Returns true if the ray enters the box before the
+// given distance, with the entry distance
+bool IntersectBVHNode
+(
+	const SBVHNode& node,
+	const CVector3& origin,
+	const CVector3& invDirection,
+	const TFloat32  fMaxDistance,
+	TFloat32*       pfEntry
+)
+{
+	// The w components are the node's first and count, they are left out of the min and max
+	__m128 o = _mm_setr_ps( origin.x, origin.y, origin.z, 0.0f );
+	__m128 invD = _mm_setr_ps( invDirection.x, invDirection.y, invDirection.z, 0.0f );
+	__m128 t1 = _mm_mul_ps( _mm_sub_ps( _mm_loadu_ps( &node.minBounds.x ), o ), invD );
+	__m128 t2 = _mm_mul_ps( _mm_sub_ps( _mm_loadu_ps( &node.maxBounds.x ), o ), invD );
+	__m128 tEntry = _mm_max_ss( Max3( _mm_min_ps( t1, t2 ) ), _mm_setzero_ps() );
+	__m128 tExit = _mm_min_ss( Min3( _mm_max_ps( t1, t2 ) ), _mm_set_ss( fMaxDistance ) );
+	*pfEntry = _mm_cvtss_f32( tEntry );
+	return _mm_comile_ss( tEntry, tExit ) != 0;
+}
+
+// Reciprocal of a ray direction for the node test, zero components are replaced by a tiny value
+CVector3 InverseRayDirection( const CVector3& direction )
+{
+	CVector3 invDirection;
+	for (TUInt32 iAxis = 0; iAxis < 3; ++iAxis)
+	{
+		TFloat32 f = direction[iAxis];
+		if (fabsf( f ) < 1.0e-30f)
+		{
+			f = (f < 0.0f) ? -1.0e-30f : 1.0e-30f;
+		}
+		invDirection[iAxis] = 1.0f / f;
+	}
+	return invDirection;
+}
+
+
+// Prepare the faces of a sub-mesh for ray queries, with a hierarchy built for it by BuildMeshBVH
+void CMeshBVH::Init
+(
+	const SSubMesh&   subMesh,
+	const SBVHNode*   pNodes,
+	const TUInt32     iNumNodes,
+	const TUInt32*    pLeafFaces,
+	const CMatrix4x4* pMatrix /*= 0*/
+)
+{
+	GEN_GUARD;
+
+	m_Nodes.assign( pNodes, pNodes + iNumNodes );
+	TUInt32 iNumLeaves = 0;
+	for (TUInt32 iNode = 0; iNode < iNumNodes; ++iNode)
+	{
+		if (pNodes[iNode].iCount > 0)
+		{
+			iNumLeaves = Max( iNumLeaves, pNodes[iNode].iFirst + 1 );
+		}
+	}
+	m_LeafFaces.assign( pLeafFaces, pLeafFaces + iNumLeaves * kiBVHLeafSize );
+
+	// Copy the triangles of each leaf into its packet, as a corner and two edges
+	m_Packets.resize( iNumLeaves );
+	if (iNumLeaves > 0)
+	{
+		memset( m_Packets.data(), 0, iNumLeaves * sizeof(STrianglePacket) );
+	}
+	for (TUInt32 iSlot = 0; iSlot < m_LeafFaces.size(); ++iSlot)
+	{
+		if (m_LeafFaces[iSlot] == kiBVHNoItem)
+		{
+			continue;
+		}
+		TUInt32 aiIndices[3];
+		GetFace( subMesh, m_LeafFaces[iSlot], aiIndices );
+		CVector3 aCorners[3];
+		for (TUInt32 iCorner = 0; iCorner < 3; ++iCorner)
+		{
+			aCorners[iCorner] = GetPosition( subMesh, aiIndices[iCorner] );
+			if (pMatrix)
+			{
+				aCorners[iCorner] = pMatrix->TransformPoint( aCorners[iCorner] );
+			}
+		}
+		STrianglePacket& packet = m_Packets[iSlot / kiBVHLeafSize];
+		TUInt32 iLane = iSlot % kiBVHLeafSize;
+		for (TUInt32 iAxis = 0; iAxis < 3; ++iAxis)
+		{
+			packet.afCorner[iAxis][iLane] = aCorners[0][iAxis];
+			packet.afEdge1[iAxis][iLane] = aCorners[1][iAxis] - aCorners[0][iAxis];
+			packet.afEdge2[iAxis][iLane] = aCorners[2][iAxis] - aCorners[0][iAxis];
+		}
+	}
+
+	// Refit the boxes around the transformed faces. Children always follow their parent, so
+	// working backwards fits every child before its parent
+	if (pMatrix)
+	{
+		for (TUInt32 iNode = iNumNodes; iNode-- > 0;)
+		{
+			SBVHNode& node = m_Nodes[iNode];
+			node.minBounds = kEmptyMin;
+			node.maxBounds = kEmptyMax;
+			if (node.iCount > 0)
+			{
+				const STrianglePacket& packet = m_Packets[node.iFirst];
+				for (TUInt32 iLane = 0; iLane < node.iCount; ++iLane)
+				{
+					CVector3 v0( packet.afCorner[0][iLane], packet.afCorner[1][iLane], packet.afCorner[2][iLane] );
+					CVector3 v1 = v0 + CVector3( packet.afEdge1[0][iLane], packet.afEdge1[1][iLane], packet.afEdge1[2][iLane] );
+					CVector3 v2 = v0 + CVector3( packet.afEdge2[0][iLane], packet.afEdge2[1][iLane], packet.afEdge2[2][iLane] );
+					GrowBox( v0, v0, &node.minBounds, &node.maxBounds );
+					GrowBox( v1, v1, &node.minBounds, &node.maxBounds );
+					GrowBox( v2, v2, &node.minBounds, &node.maxBounds );
+				}
+			}
+			else
+			{
+				for (TUInt32 iChild = 0; iChild < 2; ++iChild)
+				{
+					const SBVHNode& child = m_Nodes[node.iFirst + iChild];
+					GrowBox( child.minBounds, child.maxBounds, &node.minBounds, &node.maxBounds );
+				}
+			}
+		}
+	}
+
+	GEN_ENDGUARD;
+}
+
+// Build the hierarchy for a sub-mesh and prepare it for ray queries
+void CMeshBVH::Init
+(
+	const SSubMesh&   subMesh,
+	const CMatrix4x4* pMatrix /*= 0*/
+)
+{
+	GEN_GUARD;
+
+	vector<SBVHNode> nodes;
+	vector<TUInt32> leafFaces;
+	BuildMeshBVH( subMesh, &nodes, &leafFaces );
+	Init( subMesh, nodes.data(), static_cast<TUInt32>(nodes.size()), leafFaces.data(), pMatrix );
+
+	GEN_ENDGUARD;
+}
+
+
+// Find the closest intersection of a ray with the faces no further than the given distance
+bool CMeshBVH::IntersectRay
+(
+	const CVector3& origin,
+	const CVector3& direction,
+	const TFloat32  fMaxDistance,
+	SRayHit*        pHit
+) const
+{
+	return Traverse( origin, direction, fMaxDistance, pHit );
+}
+
+// Does a ray hit any face no further than the given distance
+bool CMeshBVH::IsRayBlocked
+(
+	const CVector3& origin,
+	const CVector3& direction,
+	const TFloat32  fMaxDistance
+) const
+{
+	return Traverse( origin, direction, fMaxDistance, 0 );
+}
+
+
+// Traverse the hierarchy for the closest intersection, or for any intersection if the hit pointer
+// is 0. Nodes are visited nearest first, and nodes entered beyond the closest hit so far are
+// skipped
+bool CMeshBVH::Traverse
+(
+	const CVector3& origin,
+	const CVector3& direction,
+	const TFloat32  fMaxDistance,
+	SRayHit*        pHit
+) const
+{
+	if (m_Nodes.empty())
+	{
+		return false;
+	}
+
+	const CVector3 invDirection = InverseRayDirection( direction );
+	const __m128 ox = _mm_set1_ps( origin.x ), oy = _mm_set1_ps( origin.y ), oz = _mm_set1_ps( origin.z );
+	const __m128 dx = _mm_set1_ps( direction.x ), dy = _mm_set1_ps( direction.y ), dz = _mm_set1_ps( direction.z );
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps( 1.0f );
+
+	TFloat32 fClosest = fMaxDistance;
+	bool bHit = false;
+
+	TFloat32 fEntry;
+	if (!IntersectBVHNode( m_Nodes[0], origin, invDirection, fClosest, &fEntry ))
+	{
+		return false;
+	}
+
+	// Stack of nodes still to visit and the distance the ray enters each, at most one for each
+	// level above the current node
+	TUInt32 aiStack[kiBVHMaxDepth];
+	TFloat32 afStackEntry[kiBVHMaxDepth];
+	TUInt32 iStackSize = 0;
+	TUInt32 iNode = 0;
+	while (true)
+	{
+		const SBVHNode& node = m_Nodes[iNode];
+		if (node.iCount > 0)
+		{
+			// Test the ray against the four triangles of the leaf at once
+			const STrianglePacket& packet = m_Packets[node.iFirst];
+			__m128 e1x = _mm_loadu_ps( packet.afEdge1[0] ), e1y = _mm_loadu_ps( packet.afEdge1[1] ), e1z = _mm_loadu_ps( packet.afEdge1[2] );
+			__m128 e2x = _mm_loadu_ps( packet.afEdge2[0] ), e2y = _mm_loadu_ps( packet.afEdge2[1] ), e2z = _mm_loadu_ps( packet.afEdge2[2] );
+			__m128 px, py, pz;
+			Cross4( dx, dy, dz, e2x, e2y, e2z, &px, &py, &pz );
+			__m128 det = Dot4( e1x, e1y, e1z, px, py, pz );
+			__m128 invDet = _mm_div_ps( one, det );
+			__m128 tx = _mm_sub_ps( ox, _mm_loadu_ps( packet.afCorner[0] ) );
+			__m128 ty = _mm_sub_ps( oy, _mm_loadu_ps( packet.afCorner[1] ) );
+			__m128 tz = _mm_sub_ps( oz, _mm_loadu_ps( packet.afCorner[2] ) );
+			__m128 u = _mm_mul_ps( Dot4( tx, ty, tz, px, py, pz ), invDet );
+			__m128 qx, qy, qz;
+			Cross4( tx, ty, tz, e1x, e1y, e1z, &qx, &qy, &qz );
+			__m128 v = _mm_mul_ps( Dot4( dx, dy, dz, qx, qy, qz ), invDet );
+			__m128 t = _mm_mul_ps( Dot4( e2x, e2y, e2z, qx, qy, qz ), invDet );
+
+			// Zero determinants (unused lanes and faces edge on to the ray) give infinities or NaNs,
+			// which fail the comparisons
+			__m128 hit = _mm_and_ps( _mm_cmpneq_ps( det, zero ), _mm_cmpge_ps( u, zero ) );
+			hit = _mm_and_ps( hit, _mm_cmpge_ps( v, zero ) );
+			hit = _mm_and_ps( hit, _mm_cmple_ps( _mm_add_ps( u, v ), one ) );
+			hit = _mm_and_ps( hit, _mm_cmpge_ps( t, zero ) );
+			hit = _mm_and_ps( hit, _mm_cmplt_ps( t, _mm_set1_ps( fClosest ) ) );
+			int iMask = _mm_movemask_ps( hit );
+			if (iMask)
+			{
+				if (!pHit)
+				{
+					return true;
+				}
+				TFloat32 afT[4], afU[4], afV[4];
+				_mm_storeu_ps( afT, t );
+				_mm_storeu_ps( afU, u );
+				_mm_storeu_ps( afV, v );
+				for (TUInt32 iLane = 0; iLane < kiBVHLeafSize; ++iLane)
+				{
+					if ((iMask & (1 << iLane)) && afT[iLane] < fClosest)
+					{
+						fClosest = afT[iLane];
+						pHit->fDistance = afT[iLane];
+						pHit->iFace = m_LeafFaces[node.iFirst * kiBVHLeafSize + iLane];
+						pHit->fU = afU[iLane];
+						pHit->fV = afV[iLane];
+					}
+				}
+				bHit = true;
+			}
+		}
+		else
+		{
+			// Visit the nearer child next and keep the further one for later
+			TFloat32 fEntry0, fEntry1;
+			bool bHit0 = IntersectBVHNode( m_Nodes[node.iFirst], origin, invDirection, fClosest, &fEntry0 );
+			bool bHit1 = IntersectBVHNode( m_Nodes[node.iFirst + 1], origin, invDirection, fClosest, &fEntry1 );
+			if (bHit0 && bHit1)
+			{
+				TUInt32 iNear = node.iFirst, iFar = node.iFirst + 1;
+				if (fEntry1 < fEntry0)
+				{
+					swap( iNear, iFar );
+					swap( fEntry0, fEntry1 );
+				}
+				GEN_ASSERT( iStackSize < kiBVHMaxDepth, "Bounding volume hierarchy too deep" );
+				aiStack[iStackSize] = iFar;
+				afStackEntry[iStackSize++] = fEntry1;
+				iNode = iNear;
+				continue;
+			}
+			if (bHit0 || bHit1)
+			{
+				iNode = bHit0 ? node.iFirst : node.iFirst + 1;
+				continue;
+			}
+		}
+
+		// Take the next node from the stack, skipping those entered beyond the closest hit
+		do
+		{
+			if (iStackSize == 0)
+			{
+				return bHit;
+			}
+			--iStackSize;
+		} while (afStackEntry[iStackSize] > fClosest);
+		iNode = aiStack[iStackSize];
+	}
+}
+
+
+} // namespace gen
@@ -0,0 +1,224 @@
+/**************************************************************************************************
+	Module:       MeshBVH.h
+	Date created: 18/10/26
+
+	Bounding volume hierarchies for ray queries (picking, line of sight). Built over boxes with the
+	surface area heuristic on binned centres, stored as 32 byte nodes, and for triangles traversed
+	testing a leaf of four triangles at a time with SSE
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#ifndef GEN_MESH_BVH_H_INCLUDED
+#define GEN_MESH_BVH_H_INCLUDED
+
+#include <vector>
+using namespace std;
+
+#include "GenDefines.h"
+#include "CVector3.h"
+#include "CMatrix4x4.h"
+#include "MeshData.h"
+
+namespace gen
+{
+
+// Most items in a leaf. Each leaf has this many item slots, so the triangles of a leaf are
+// tested together as one SSE packet
+const TUInt32 kiBVHLeafSize = 4;
+
+// Leaf item slots not used by a leaf with fewer items
+const TUInt32 kiBVHNoItem = 0xffffffff;
+
+// Deepest node of a hierarchy (the root has depth 0). Ray queries keep a stack this deep
+const TUInt32 kiBVHMaxDepth = 64;
+
+
+/////////////////////////////////////
+// Building
+
+// A node of a hierarchy (32 bytes). The two children of an inner node are stored next to each
+// other, after their parent. The root is node 0
+struct SBVHNode
+{
+	CVector3 minBounds;
+	TUInt32  iFirst;    // Inner node: index of the first child. Leaf: index of the leaf, its items
+	                    // are in slots iFirst * kiBVHLeafSize onwards of the leaf item list
+	CVector3 maxBounds;
+	TUInt32  iCount;    // Leaf: number of items, 1 to kiBVHLeafSize. Inner node: 0
+};
+
+// Build a hierarchy over a list of boxes (e.g. the boxes of triangles or models). Each node is
+// split where the surface area heuristic finds the cheapest split, estimated by sorting the box
+// centres into a small number of bins on each axis (Wald 2007). Nodes of kiBVHLeafSize items or
+// fewer become leaves. Nodes halfway to kiBVHMaxDepth are split in half instead, which keeps even
+// very unevenly spread items within the depth limit. The items of each leaf are written to the leaf item list as indices into
+// the boxes, kiBVHLeafSize slots per leaf with unused slots set to kiBVHNoItem. The node list is
+// empty if there are no boxes
+void BuildBVH
+(
+	const CVector3*   pMinBounds,
+	const CVector3*   pMaxBounds,
+	const TUInt32     iNumItems,
+	vector<SBVHNode>* pNodes,
+	vector<TUInt32>*  pLeafItems
+);
+
+// Build a hierarchy over the faces of a sub-mesh (its own faces only, not its levels of detail).
+// The leaf items are face indices
+void BuildMeshBVH
+(
+	const SSubMesh&   subMesh,
+	vector<SBVHNode>* pNodes,
+	vector<TUInt32>*  pLeafFaces
+);
+
+
+/////////////////////////////////////
+// Ray queries
+
+// Slab test of a ray against a node's box. The ray is given by its origin and the reciprocal of
+// its direction. Returns true if the ray enters the box before the given distance (distances in
+// units of the ray direction), with the entry distance (0 if the origin is inside)
+bool IntersectBVHNode
+(
+	const SBVHNode& node,
+	const CVector3& origin,
+	const CVector3& invDirection,
+	const TFloat32  fMaxDistance,
+	TFloat32*       pfEntry
+);
+
+// Reciprocal of a ray direction for the node test above. Zero components are replaced by a tiny
+// value of the same sign, so the slabs of those axes give very large distances rather than NaNs
+CVector3 InverseRayDirection( const CVector3& direction );
+
+// Closest intersection of a ray with a triangle mesh
+struct SRayHit
+{
+	TFloat32 fDistance; // Distance along the ray in units of the ray direction
+	TUInt32  iFace;     // Face of the sub-mesh hit
+	TFloat32 fU;        // Barycentric coordinates of the hit: the point is v0 + u(v1 - v0) +
+	TFloat32 fV;        // v(v2 - v0) for the face's vertices v0, v1, v2
+};
+
+// The triangles of a sub-mesh prepared for ray queries, with a hierarchy over them. The triangles
+// are copied into packets of four, one for each leaf of the hierarchy, stored as a corner and two
+// edges in SSE layout. Rays are tested against all four triangles of a leaf at once (Moller &
+// Trumbore 1997). Triangles are hit from both sides
+class CMeshBVH
+{
+	GEN_CLASS( CMeshBVH )
+
+/*-----------------------------------------------------------------------------------------
+	Public interface
+-----------------------------------------------------------------------------------------*/
+public:
+
+	/////////////////////////////////////
+	// Setup
+
+	// Prepare the faces of a sub-mesh for ray queries, with a hierarchy built for the sub-mesh
+	// by BuildMeshBVH (e.g. when the mesh was cooked). The vertex positions are copied, so the
+	// sub-mesh data is not needed afterwards. If a matrix is given the positions are transformed
+	// by it (e.g. into the space of the mesh root) and the node boxes are refitted around the
+	// transformed faces
+	void Init
+	(
+		const SSubMesh&   subMesh,
+		const SBVHNode*   pNodes,
+		const TUInt32     iNumNodes,
+		const TUInt32*    pLeafFaces,
+		const CMatrix4x4* pMatrix = 0
+	);
+
+	// Build the hierarchy for a sub-mesh and prepare it for ray queries as above
+	void Init
+	(
+		const SSubMesh&   subMesh,
+		const CMatrix4x4* pMatrix = 0
+	);
+
+
+	/////////////////////////////////////
+	// Queries
+
+	// Find the closest intersection of a ray with the faces no further than the given distance
+	// (in units of the ray direction, which need not be normalised). Returns false if there is
+	// no intersection, the hit is only written if there is one
+	bool IntersectRay
+	(
+		const CVector3& origin,
+		const CVector3& direction,
+		const TFloat32  fMaxDistance,
+		SRayHit*        pHit
+	) const;
+
+	// Does a ray hit any face no further than the given distance - a line of sight test. Stops at
+	// the first intersection found, so is quicker than finding the closest
+	bool IsRayBlocked
+	(
+		const CVector3& origin,
+		const CVector3& direction,
+		const TFloat32  fMaxDistance
+	) const;
+
+
+	/////////////////////////////////////
+	// Data access
+
+	// Get the number of nodes in the hierarchy, 0 if there are no faces
+	TUInt32 GetNumNodes() const
+	{
+		return static_cast<TUInt32>(m_Nodes.size());
+	}
+
+	// Get a node of the hierarchy, the root (node 0) bounds all the faces
+	const SBVHNode& GetNode( const TUInt32 iNode ) const
+	{
+		return m_Nodes[iNode];
+	}
+
+	// Get the memory used by the nodes, triangles and face list in bytes
+	TUInt32 GetMemorySize() const
+	{
+		return static_cast<TUInt32>(m_Nodes.size() * sizeof(SBVHNode) +
+		                            m_Packets.size() * sizeof(STrianglePacket) +
+		                            m_LeafFaces.size() * sizeof(TUInt32));
+	}
+
+
+/*-----------------------------------------------------------------------------------------
+	Private interface
+-----------------------------------------------------------------------------------------*/
+private:
+
+	// Four triangles as a corner and two edges, each component in a separate group of four
+	// floats. Unused triangles are all zero, which rays never hit
+	struct STrianglePacket
+	{
+		TFloat32 afCorner[3][4];
+		TFloat32 afEdge1[3][4];
+		TFloat32 afEdge2[3][4];
+	};
+
+	// Traverse the hierarchy for the closest intersection, or for any intersection if the hit
+	// pointer is 0
+	bool Traverse
+	(
+		const CVector3& origin,
+		const CVector3& direction,
+		const TFloat32  fMaxDistance,
+		SRayHit*        pHit
+	) const;
+
+	vector<SBVHNode>        m_Nodes;
+	vector<STrianglePacket> m_Packets;   // One for each leaf
+	vector<TUInt32>         m_LeafFaces; // kiBVHLeafSize for each leaf
+};
+
+
+} // namespace gen
+
+#endif // GEN_MESH_BVH_H_INCLUDED
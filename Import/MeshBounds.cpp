@@ -0,0 +1,191 @@
+/**************************************************************************************************
+	Module:       MeshBounds.cpp
+	Date created: 18/10/26
+
+	Bounding boxes and spheres of vertex positions, calculated with SSE, and merging of bounds
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#include <cmath>
+#include <xmmintrin.h>
+using namespace std;
+
+#include "MeshBounds.h"
+#include "BaseMath.h"
+#include "Error.h"
+
+namespace gen
+{
+
+namespace
+{
+	// Load a position into the x, y & z components of a vector, w is 0. Reads exactly three
+	// floats, so positions at the end of a buffer can be read safely
+	inline __m128 LoadPosition( const TUInt8* pPosition )
+	{
+		const TFloat32* pf = reinterpret_cast<const TFloat32*>(pPosition);
+		__m128 xy = _mm_loadl_pi( _mm_setzero_ps(), reinterpret_cast<const __m64*>(pf) );
+		return _mm_movelh_ps( xy, _mm_load_ss( pf + 2 ) );
+	}
+
+	// Store the x, y & z components of a vector in a position
+	inline void StorePosition( const __m128 v, CVector3* pPosition )
+	{
+		_mm_storel_pi( reinterpret_cast<__m64*>(&pPosition->x), v );
+		_mm_store_ss( &pPosition->z, _mm_movehl_ps( v, v ) );
+	}
+}
+
+
+// Calculate the axis aligned bounding box of a list of positions (CVector3) at the given stride.
+// The box is zero if there are no positions
+void CalculateBoundingBox
+(
+	const TUInt8*  pPositions,
+	const TUInt32  iStride,
+	const TUInt32  iNumPositions,
+	CVector3*      pMinBounds,
+	CVector3*      pMaxBounds
+)
+{
+	GEN_GUARD;
+
+	if (iNumPositions == 0)
+	{
+		*pMinBounds = CVector3::kZero;
+		*pMaxBounds = CVector3::kZero;
+		return;
+	}
+
+	// Two sets of minimums and maximums, so consecutive positions don't wait for each other
+	__m128 min0 = LoadPosition( pPositions );
+	__m128 max0 = min0;
+	__m128 min1 = min0;
+	__m128 max1 = min0;
+	const TUInt8* pPosition = pPositions + iStride;
+	TUInt32 iPosition = 1;
+	for (; iPosition + 4 <= iNumPositions; iPosition += 4)
+	{
+		__m128 p0 = LoadPosition( pPosition );
+		__m128 p1 = LoadPosition( pPosition + iStride );
+		__m128 p2 = LoadPosition( pPosition + 2 * iStride );
+		__m128 p3 = LoadPosition( pPosition + 3 * iStride );
+		min0 = _mm_min_ps( min0, _mm_min_ps( p0, p1 ) );
+		max0 = _mm_max_ps( max0, _mm_max_ps( p0, p1 ) );
+		min1 = _mm_min_ps( min1, _mm_min_ps( p2, p3 ) );
+		max1 = _mm_max_ps( max1, _mm_max_ps( p2, p3 ) );
+		pPosition += 4 * iStride;
+	}
+	for (; iPosition < iNumPositions; ++iPosition)
+	{
+		__m128 p = LoadPosition( pPosition );
+		min0 = _mm_min_ps( min0, p );
+		max0 = _mm_max_ps( max0, p );
+		pPosition += iStride;
+	}
+
+	StorePosition( _mm_min_ps( min0, min1 ), pMinBounds );
+	StorePosition( _mm_max_ps( max0, max1 ), pMaxBounds );
+
+	GEN_ENDGUARD;
+}
+
+
+// Calculate the bounding box of a list of positions, and the sphere centred on the box that just
+// encloses the positions
+void CalculateMeshBounds
+(
+	const TUInt8*  pPositions,
+	const TUInt32  iStride,
+	const TUInt32  iNumPositions,
+	SMeshBounds*   pBounds
+)
+{
+	GEN_GUARD;
+
+	CalculateBoundingBox( pPositions, iStride, iNumPositions, &pBounds->minBounds,
+	                      &pBounds->maxBounds );
+	pBounds->centre = (pBounds->minBounds + pBounds->maxBounds) * 0.5f;
+
+	// Find the largest squared distance from the centre, four positions at a time. The squared
+	// offsets of four positions are transposed so each component sum gives one distance
+	__m128 centre = _mm_set_ps( 0.0f, pBounds->centre.z, pBounds->centre.y, pBounds->centre.x );
+	__m128 maxDistanceSq = _mm_setzero_ps();
+	const TUInt8* pPosition = pPositions;
+	TUInt32 iPosition = 0;
+	for (; iPosition + 4 <= iNumPositions; iPosition += 4)
+	{
+		__m128 d0 = _mm_sub_ps( LoadPosition( pPosition ), centre );
+		__m128 d1 = _mm_sub_ps( LoadPosition( pPosition + iStride ), centre );
+		__m128 d2 = _mm_sub_ps( LoadPosition( pPosition + 2 * iStride ), centre );
+		__m128 d3 = _mm_sub_ps( LoadPosition( pPosition + 3 * iStride ), centre );
+		d0 = _mm_mul_ps( d0, d0 );
+		d1 = _mm_mul_ps( d1, d1 );
+		d2 = _mm_mul_ps( d2, d2 );
+		d3 = _mm_mul_ps( d3, d3 );
+		_MM_TRANSPOSE4_PS( d0, d1, d2, d3 );
+		maxDistanceSq = _mm_max_ps( maxDistanceSq, _mm_add_ps( _mm_add_ps( d0, d1 ), d2 ) );
+		pPosition += 4 * iStride;
+	}
+	for (; iPosition < iNumPositions; ++iPosition)
+	{
+		__m128 d = _mm_sub_ps( LoadPosition( pPosition ), centre );
+		d = _mm_mul_ps( d, d );
+		d = _mm_add_ss( _mm_add_ss( d, _mm_shuffle_ps( d, d, _MM_SHUFFLE(1, 1, 1, 1) ) ),
+		                _mm_shuffle_ps( d, d, _MM_SHUFFLE(2, 2, 2, 2) ) );
+		maxDistanceSq = _mm_max_ss( maxDistanceSq, d );
+		pPosition += iStride;
+	}
+	maxDistanceSq = _mm_max_ps( maxDistanceSq, _mm_movehl_ps( maxDistanceSq, maxDistanceSq ) );
+	maxDistanceSq = _mm_max_ss( maxDistanceSq, _mm_shuffle_ps( maxDistanceSq, maxDistanceSq,
+	                                                          _MM_SHUFFLE(1, 1, 1, 1) ) );
+	pBounds->radius = _mm_cvtss_f32( _mm_sqrt_ss( maxDistanceSq ) );
+
+	GEN_ENDGUARD;
+}
+
+
+// Make bounds from a box alone, the sphere is the sphere around the box
+void MeshBoundsFromBox
+(
+	const CVector3& minBounds,
+	const CVector3& maxBounds,
+	SMeshBounds*    pBounds
+)
+{
+	pBounds->minBounds = minBounds;
+	pBounds->maxBounds = maxBounds;
+	pBounds->centre = (minBounds + maxBounds) * 0.5f;
+	pBounds->radius = Length( maxBounds - minBounds ) * 0.5f;
+}
+
+
+// Get bounds enclosing two sets of bounds. The sphere is centred on the new box and is the smaller
+// of the sphere enclosing both spheres and the sphere around the box
+void MergeMeshBounds
+(
+	const SMeshBounds& bounds1,
+	const SMeshBounds& bounds2,
+	SMeshBounds*       pBounds
+)
+{
+	CVector3 minBounds( Min( bounds1.minBounds.x, bounds2.minBounds.x ),
+	                    Min( bounds1.minBounds.y, bounds2.minBounds.y ),
+	                    Min( bounds1.minBounds.z, bounds2.minBounds.z ) );
+	CVector3 maxBounds( Max( bounds1.maxBounds.x, bounds2.maxBounds.x ),
+	                    Max( bounds1.maxBounds.y, bounds2.maxBounds.y ),
+	                    Max( bounds1.maxBounds.z, bounds2.maxBounds.z ) );
+	CVector3 centre = (minBounds + maxBounds) * 0.5f;
+	TFloat32 fRadius = Max( Length( bounds1.centre - centre ) + bounds1.radius,
+	                        Length( bounds2.centre - centre ) + bounds2.radius );
+
+	pBounds->minBounds = minBounds;
+	pBounds->maxBounds = maxBounds;
+	pBounds->centre = centre;
+	pBounds->radius = Min( fRadius, Length( maxBounds - minBounds ) * 0.5f );
+}
+
+
+} // namespace gen
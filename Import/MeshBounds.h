@@ -0,0 +1,65 @@
+/**************************************************************************************************
+	Module:       MeshBounds.h
+	Date created: 18/10/26
+
+	Bounding boxes and spheres of vertex positions, calculated with SSE, and merging of bounds
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#ifndef GEN_MESH_BOUNDS_H_INCLUDED
+#define GEN_MESH_BOUNDS_H_INCLUDED
+
+#include "GenDefines.h"
+#include "CVector3.h"
+#include "MeshData.h"
+
+namespace gen
+{
+
+// Calculate the axis aligned bounding box of a list of positions (CVector3) at the given stride,
+// e.g. the positions in interleaved vertex data. The box is zero if there are no positions
+void CalculateBoundingBox
+(
+	const TUInt8*  pPositions,
+	const TUInt32  iStride,
+	const TUInt32  iNumPositions,
+	CVector3*      pMinBounds,
+	CVector3*      pMaxBounds
+);
+
+// Calculate the bounding box of a list of positions as above, and the sphere centred on the box
+// that just encloses the positions. Two passes over the positions
+void CalculateMeshBounds
+(
+	const TUInt8*  pPositions,
+	const TUInt32  iStride,
+	const TUInt32  iNumPositions,
+	SMeshBounds*   pBounds
+);
+
+// Make bounds from a box alone, when the positions inside it are not known. The sphere is the
+// sphere around the box
+void MeshBoundsFromBox
+(
+	const CVector3& minBounds,
+	const CVector3& maxBounds,
+	SMeshBounds*    pBounds
+);
+
+// Get bounds enclosing two sets of bounds (which must be in the same space). The box is exact.
+// The sphere is centred on the new box and is the smaller of the sphere enclosing both spheres
+// and the sphere around the box, so it encloses all of the positions in both sets. The output
+// may be one of the inputs
+void MergeMeshBounds
+(
+	const SMeshBounds& bounds1,
+	const SMeshBounds& bounds2,
+	SMeshBounds*       pBounds
+);
+
+
+} // namespace gen
+
+#endif // GEN_MESH_BOUNDS_H_INCLUDED
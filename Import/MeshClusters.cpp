@@ -0,0 +1,538 @@
+/**************************************************************************************************
+	Module:       MeshClusters.cpp
+	Date created: 18/10/26
+
+	Partitioning of indexed triangle meshes into small clusters of faces, each with a bounding
+	sphere and a cone bounding its face normals, and culling of the clusters against a view
+	frustum and for facing away from the viewpoint
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include "MeshClusters.h"
+#include "MeshOptimise.h"
+#include "BaseMath.h"
+#include "Error.h"
+
+namespace gen
+{
+
+namespace
+{
+	// Marks a face or vertex not yet in any cluster
+	const TUInt32 kiNoCluster = 0xffffffff;
+
+	// Clusters whose face normals spread further than this from the cone axis (as a cosine) are
+	// given no cone, it would only cull them from a small range of viewpoints
+	const TFloat32 kfMinConeSpread = 0.1f;
+
+	// Weight of the difference in facing against the distance from the cluster centre (in units
+	// of the cluster's size) when choosing the next face for a cluster
+	const TFloat32 kfConeWeight = 1.0f;
+
+
+	// Get the position of a vertex in a sub-mesh
+	inline CVector3 GetPosition
+	(
+		const SSubMesh& subMesh,
+		const TUInt32   iVertex
+	)
+	{
+		CVector3 vPosition;
+		memcpy( &vPosition, subMesh.vertices + iVertex * subMesh.vertexSize, sizeof(CVector3) );
+		return vPosition;
+	}
+
+	// Get all the vertex indices of a sub-mesh's faces, three per face
+	void GetIndices
+	(
+		const SSubMesh&  subMesh,
+		vector<TUInt32>* pIndices
+	)
+	{
+		pIndices->resize( subMesh.numFaces * 3 );
+		for (TUInt32 iIndex = 0; iIndex < subMesh.numFaces * 3; ++iIndex)
+		{
+			(*pIndices)[iIndex] = (subMesh.indexSize == sizeof(TUInt32)) ?
+			                      reinterpret_cast<const TUInt32*>(subMesh.faces)[iIndex] :
+			                      reinterpret_cast<const TUInt16*>(subMesh.faces)[iIndex];
+		}
+	}
+
+	// Write vertex indices back to a sub-mesh's faces, three per face
+	void SetIndices
+	(
+		const SSubMesh&        subMesh,
+		const vector<TUInt32>& indices
+	)
+	{
+		for (TUInt32 iIndex = 0; iIndex < subMesh.numFaces * 3; ++iIndex)
+		{
+			if (subMesh.indexSize == sizeof(TUInt32))
+			{
+				reinterpret_cast<TUInt32*>(subMesh.faces)[iIndex] = indices[iIndex];
+			}
+			else
+			{
+				reinterpret_cast<TUInt16*>(subMesh.faces)[iIndex] = static_cast<TUInt16>(indices[iIndex]);
+			}
+		}
+	}
+
+	// Get the (not normalised) normal of a face from the indices of its vertices
+	inline CVector3 GetFaceNormal
+	(
+		const SSubMesh& subMesh,
+		const TUInt32*  aiCorners
+	)
+	{
+		CVector3 p0 = GetPosition( subMesh, aiCorners[0] );
+		return Cross( GetPosition( subMesh, aiCorners[1] ) - p0, GetPosition( subMesh, aiCorners[2] ) - p0 );
+	}
+
+	// Calculate the bounding sphere and normal cone of a cluster of consecutive faces. The cone
+	// test follows meshoptimizer (Kapoulkine): the apex is moved back along the axis until it is
+	// behind the plane of every face, then a viewpoint sees none of the faces if the direction
+	// from it to the apex is within the cone
+	void CalculateClusterBounds
+	(
+		const SSubMesh&        subMesh,
+		const vector<TUInt32>& indices,
+		SMeshCluster*          pCluster
+	)
+	{
+		const TUInt32* pIndices = &indices[pCluster->iFirstFace * 3];
+		TUInt32 iNumIndices = pCluster->iNumFaces * 3;
+
+		// Sphere around the centre of the vertices' box
+		CVector3 vMin = GetPosition( subMesh, pIndices[0] ), vMax = vMin;
+		for (TUInt32 iIndex = 1; iIndex < iNumIndices; ++iIndex)
+		{
+			CVector3 vPosition = GetPosition( subMesh, pIndices[iIndex] );
+			vMin = CVector3( Min( vMin.x, vPosition.x ), Min( vMin.y, vPosition.y ), Min( vMin.z, vPosition.z ) );
+			vMax = CVector3( Max( vMax.x, vPosition.x ), Max( vMax.y, vPosition.y ), Max( vMax.z, vPosition.z ) );
+		}
+		pCluster->centre = (vMin + vMax) * 0.5f;
+		TFloat32 fRadiusSquared = 0.0f;
+		for (TUInt32 iIndex = 0; iIndex < iNumIndices; ++iIndex)
+		{
+			fRadiusSquared = Max( fRadiusSquared, DistanceSquared( pCluster->centre, GetPosition( subMesh, pIndices[iIndex] ) ) );
+		}
+		pCluster->fRadius = Sqrt( fRadiusSquared );
+
+		// Cone axis is the average of the face normals, degenerate faces are left out
+		CVector3 vAxis( 0.0f, 0.0f, 0.0f );
+		for (TUInt32 iFace = 0; iFace < pCluster->iNumFaces; ++iFace)
+		{
+			CVector3 vNormal = GetFaceNormal( subMesh, pIndices + iFace * 3 );
+			TFloat32 fLength = Length( vNormal );
+			if (fLength > 0.0f)
+			{
+				vAxis += vNormal / fLength;
+			}
+		}
+		pCluster->coneApex = pCluster->centre;
+		pCluster->coneAxis = CVector3( 0.0f, 0.0f, 0.0f );
+		pCluster->fConeCutoff = kfNoClusterCone;
+		TFloat32 fAxisLength = Length( vAxis );
+		if (fAxisLength <= 0.0f)
+		{
+			return;
+		}
+		vAxis /= fAxisLength;
+
+		// Widest normal from the axis, and the distance back along the axis that puts the apex
+		// behind every face
+		TFloat32 fMinDot = 1.0f, fMaxBack = 0.0f;
+		for (TUInt32 iFace = 0; iFace < pCluster->iNumFaces; ++iFace)
+		{
+			CVector3 vNormal = GetFaceNormal( subMesh, pIndices + iFace * 3 );
+			TFloat32 fLength = Length( vNormal );
+			if (fLength <= 0.0f)
+			{
+				continue;
+			}
+			vNormal /= fLength;
+			TFloat32 fNormalDot = Dot( vAxis, vNormal );
+			fMinDot = Min( fMinDot, fNormalDot );
+			if (fNormalDot > 0.0f)
+			{
+				TFloat32 fCentreDistance = Dot( pCluster->centre - GetPosition( subMesh, pIndices[iFace * 3] ), vNormal );
+				fMaxBack = Max( fMaxBack, fCentreDistance / fNormalDot );
+			}
+		}
+		pCluster->coneAxis = vAxis;
+		if (fMinDot <= kfMinConeSpread)
+		{
+			return;
+		}
+		pCluster->coneApex = pCluster->centre - vAxis * fMaxBack;
+		pCluster->fConeCutoff = Sqrt( 1.0f - fMinDot * fMinDot );
+	}
+}
+
+
+/////////////////////////////////////
+// Clusters
+
+// Partition the faces of a sub-mesh into clusters of at most kiMaxClusterVertices vertices and
+// kiMaxClusterFaces faces, reordering the faces so each cluster's faces are consecutive
+void BuildMeshClusters
+(
+	const SSubMesh&       subMesh,
+	vector<SMeshCluster>* pClusters
+)
+{
+	GEN_GUARD;
+
+	pClusters->clear();
+	TUInt32 iNumFaces = subMesh.numFaces;
+	if (iNumFaces == 0)
+	{
+		return;
+	}
+	vector<TUInt32> indices;
+	GetIndices( subMesh, &indices );
+
+	// Unit normal and centre of each face, and the size of an average face to measure distances
+	// between faces with
+	vector<CVector3> faceNormals( iNumFaces );
+	vector<CVector3> faceCentres( iNumFaces );
+	TFloat32 fFaceSize = 0.0f;
+	for (TUInt32 iFace = 0; iFace < iNumFaces; ++iFace)
+	{
+		const TUInt32* aiCorners = &indices[iFace * 3];
+		CVector3 vNormal = GetFaceNormal( subMesh, aiCorners );
+		TFloat32 fLength = Length( vNormal );
+		faceNormals[iFace] = (fLength > 0.0f) ? vNormal / fLength : CVector3( 0.0f, 0.0f, 0.0f );
+		CVector3 p0 = GetPosition( subMesh, aiCorners[0] );
+		CVector3 p1 = GetPosition( subMesh, aiCorners[1] );
+		CVector3 p2 = GetPosition( subMesh, aiCorners[2] );
+		faceCentres[iFace] = (p0 + p1 + p2) / 3.0f;
+		fFaceSize += Distance( p0, p1 );
+	}
+	fFaceSize = Max( fFaceSize / iNumFaces, 1.0e-6f );
+
+	// Faces using each vertex - faces of vertex v are vertexFaces[vertexFaceStart[v]] up to
+	// vertexFaces[vertexFaceStart[v + 1]]
+	vector<TUInt32> vertexFaceStart( subMesh.numVertices + 1, 0 );
+	for (TUInt32 iIndex = 0; iIndex < iNumFaces * 3; ++iIndex)
+	{
+		++vertexFaceStart[indices[iIndex] + 1];
+	}
+	for (TUInt32 iVertex = 0; iVertex < subMesh.numVertices; ++iVertex)
+	{
+		vertexFaceStart[iVertex + 1] += vertexFaceStart[iVertex];
+	}
+	vector<TUInt32> vertexFaces( iNumFaces * 3 );
+	vector<TUInt32> vertexFaceFill( vertexFaceStart.begin(), vertexFaceStart.end() - 1 );
+	for (TUInt32 iIndex = 0; iIndex < iNumFaces * 3; ++iIndex)
+	{
+		vertexFaces[vertexFaceFill[indices[iIndex]]++] = iIndex / 3;
+	}
+
+	// Grow each cluster from the first face not yet used. Faces sharing a vertex with the
+	// cluster are candidates to add next. Stamps of the cluster number mark the vertices in the
+	// current cluster and the faces already in its candidate list
+	vector<TUInt32> faceCluster( iNumFaces, kiNoCluster );
+	vector<TUInt32> faceCandidate( iNumFaces, kiNoCluster );
+	vector<TUInt32> vertexCluster( subMesh.numVertices, kiNoCluster );
+	vector<TUInt32> clusterOrder;             // Faces in cluster order
+	clusterOrder.reserve( iNumFaces );
+	vector<TUInt32> candidates;
+	TUInt32 iSeed = 0;
+	while (true)
+	{
+		while (iSeed < iNumFaces && faceCluster[iSeed] != kiNoCluster)
+		{
+			++iSeed;
+		}
+		if (iSeed == iNumFaces)
+		{
+			break;
+		}
+
+		TUInt32 iCluster = static_cast<TUInt32>(pClusters->size());
+		SMeshCluster cluster;
+		cluster.iFirstFace = static_cast<TUInt32>(clusterOrder.size());
+		cluster.iNumFaces = 0;
+		TUInt32 iNumVertices = 0;
+		CVector3 vNormalSum( 0.0f, 0.0f, 0.0f ), vCentreSum( 0.0f, 0.0f, 0.0f );
+		TFloat32 fExtent = fFaceSize;
+		candidates.clear();
+
+		TUInt32 iFace = iSeed;
+		while (iFace != kiNoCluster)
+		{
+			// Add the face and its new vertices, and the faces using those as candidates
+			faceCluster[iFace] = iCluster;
+			clusterOrder.push_back( iFace );
+			++cluster.iNumFaces;
+			for (TUInt32 iCorner = 0; iCorner < 3; ++iCorner)
+			{
+				TUInt32 iVertex = indices[iFace * 3 + iCorner];
+				if (vertexCluster[iVertex] == iCluster)
+				{
+					continue;
+				}
+				vertexCluster[iVertex] = iCluster;
+				++iNumVertices;
+				for (TUInt32 iUse = vertexFaceStart[iVertex]; iUse < vertexFaceStart[iVertex + 1]; ++iUse)
+				{
+					TUInt32 iUser = vertexFaces[iUse];
+					if (faceCluster[iUser] == kiNoCluster && faceCandidate[iUser] != iCluster)
+					{
+						faceCandidate[iUser] = iCluster;
+						candidates.push_back( iUser );
+					}
+				}
+			}
+			vNormalSum += faceNormals[iFace];
+			vCentreSum += faceCentres[iFace];
+			CVector3 vCentre = vCentreSum / static_cast<TFloat32>(cluster.iNumFaces);
+			fExtent = Max( fExtent, Distance( vCentre, faceCentres[iFace] ) );
+			if (cluster.iNumFaces == kiMaxClusterFaces)
+			{
+				break;
+			}
+
+			// Choose the candidate adding the fewest vertices, then the one facing closest to the
+			// cluster's average normal and nearest its centre. Used faces are dropped from the list
+			CVector3 vAxis = (LengthSquared( vNormalSum ) > 0.0f) ? Normalise( vNormalSum ) : vNormalSum;
+			iFace = kiNoCluster;
+			TUInt32 iBestNew = 4;
+			TFloat32 fBestScore = 0.0f;
+			TUInt32 iNumCandidates = 0;
+			for (TUInt32 iCandidate = 0; iCandidate < candidates.size(); ++iCandidate)
+			{
+				TUInt32 iTest = candidates[iCandidate];
+				if (faceCluster[iTest] != kiNoCluster)
+				{
+					continue;
+				}
+				candidates[iNumCandidates++] = iTest;
+
+				TUInt32 iNew = 0;
+				for (TUInt32 iCorner = 0; iCorner < 3; ++iCorner)
+				{
+					iNew += (vertexCluster[indices[iTest * 3 + iCorner]] == iCluster) ? 0 : 1;
+				}
+				if (iNumVertices + iNew > kiMaxClusterVertices || iNew > iBestNew)
+				{
+					continue;
+				}
+				TFloat32 fScore = kfConeWeight * (1.0f - Dot( faceNormals[iTest], vAxis )) + Distance( vCentre, faceCentres[iTest] ) / fExtent;
+				if (iNew < iBestNew || fScore < fBestScore)
+				{
+					iFace = iTest;
+					iBestNew = iNew;
+					fBestScore = fScore;
+				}
+			}
+			candidates.resize( iNumCandidates );
+		}
+
+		// Start from the existing order of the faces within the cluster
+		sort( clusterOrder.begin() + cluster.iFirstFace, clusterOrder.end() );
+		pClusters->push_back( cluster );
+	}
+
+	// Reorder the faces into cluster order
+	vector<TUInt32> newIndices( iNumFaces * 3 );
+	for (TUInt32 iFace = 0; iFace < iNumFaces; ++iFace)
+	{
+		memcpy( &newIndices[iFace * 3], &indices[clusterOrder[iFace] * 3], 3 * sizeof(TUInt32) );
+	}
+
+	// Order the faces within each cluster for the vertex cache, unless that makes it worse. The
+	// cluster's vertices are numbered from 0 so the optimisation works on only those
+	vector<TUInt32> localIndices, originalIndices, clusterVertices;
+	vector<TUInt32> localVertex( subMesh.numVertices );
+	fill( vertexCluster.begin(), vertexCluster.end(), kiNoCluster );
+	for (TUInt32 iCluster = 0; iCluster < pClusters->size(); ++iCluster)
+	{
+		const SMeshCluster& cluster = (*pClusters)[iCluster];
+		TUInt32* pIndices = &newIndices[cluster.iFirstFace * 3];
+		TUInt32 iNumIndices = cluster.iNumFaces * 3;
+		localIndices.resize( iNumIndices );
+		clusterVertices.clear();
+		for (TUInt32 iIndex = 0; iIndex < iNumIndices; ++iIndex)
+		{
+			TUInt32 iVertex = pIndices[iIndex];
+			if (vertexCluster[iVertex] != iCluster)
+			{
+				vertexCluster[iVertex] = iCluster;
+				localVertex[iVertex] = static_cast<TUInt32>(clusterVertices.size());
+				clusterVertices.push_back( iVertex );
+			}
+			localIndices[iIndex] = localVertex[iVertex];
+		}
+
+		TUInt32 iNumVertices = static_cast<TUInt32>(clusterVertices.size());
+		originalIndices = localIndices;
+		OptimiseVertexCache( localIndices.data(), cluster.iNumFaces, iNumVertices );
+		if (AnalyseVertexCache( localIndices.data(), cluster.iNumFaces, iNumVertices ).iNumTransformed >
+		    AnalyseVertexCache( originalIndices.data(), cluster.iNumFaces, iNumVertices ).iNumTransformed)
+		{
+			continue;
+		}
+		for (TUInt32 iIndex = 0; iIndex < iNumIndices; ++iIndex)
+		{
+			pIndices[iIndex] = clusterVertices[localIndices[iIndex]];
+		}
+	}
+
+	// Reorder the vertices for the new face order, as OptimiseSubMesh does
+	OptimiseVertexFetch( subMesh.vertices, subMesh.vertexSize, subMesh.numVertices, newIndices.data(), iNumFaces );
+	SetIndices( subMesh, newIndices );
+
+	// Calculate the bounds of each cluster
+	for (TUInt32 iCluster = 0; iCluster < pClusters->size(); ++iCluster)
+	{
+		CalculateClusterBounds( subMesh, newIndices, &(*pClusters)[iCluster] );
+	}
+
+	GEN_ENDGUARD;
+}
+
+
+// Transform a cluster's bounds by a matrix, the cone is turned off unless the matrix keeps angles
+void TransformMeshCluster
+(
+	SMeshCluster*     pCluster,
+	const CMatrix4x4& m
+)
+{
+	CVector3 vX = m.TransformVector( CVector3( 1.0f, 0.0f, 0.0f ) );
+	CVector3 vY = m.TransformVector( CVector3( 0.0f, 1.0f, 0.0f ) );
+	CVector3 vZ = m.TransformVector( CVector3( 0.0f, 0.0f, 1.0f ) );
+	TFloat32 fScaleX = Length( vX ), fScaleY = Length( vY ), fScaleZ = Length( vZ );
+	TFloat32 fMaxScale = Max( fScaleX, Max( fScaleY, fScaleZ ) );
+	TFloat32 fMinScale = Min( fScaleX, Min( fScaleY, fScaleZ ) );
+
+	pCluster->centre = m.TransformPoint( pCluster->centre );
+	pCluster->fRadius *= fMaxScale;
+	pCluster->coneApex = m.TransformPoint( pCluster->coneApex );
+	CVector3 vAxis = m.TransformVector( pCluster->coneAxis );
+	pCluster->coneAxis = (LengthSquared( vAxis ) > 0.0f) ? Normalise( vAxis ) : vAxis;
+
+	// Angles are only kept if the axes are the same length, at right angles to each other and
+	// not mirrored
+	const TFloat32 kfTolerance = 1.0e-3f;
+	bool bKeepsAngles = fMinScale > 0.0f && fMaxScale - fMinScale <= fMaxScale * kfTolerance &&
+	                    Abs( Dot( vX, vY ) ) <= fMaxScale * fMaxScale * kfTolerance &&
+	                    Abs( Dot( vY, vZ ) ) <= fMaxScale * fMaxScale * kfTolerance &&
+	                    Abs( Dot( vZ, vX ) ) <= fMaxScale * fMaxScale * kfTolerance &&
+	                    Dot( Cross( vX, vY ), vZ ) > 0.0f;
+	if (!bKeepsAngles)
+	{
+		pCluster->fConeCutoff = kfNoClusterCone;
+	}
+}
+
+
+/////////////////////////////////////
+// Culling
+
+// Get the six planes of the view frustum from a view-projection matrix (Gribb & Hartmann). With
+// row vectors the clip space position is p * M, so each plane is a sum of the matrix columns
+void GetFrustumPlanes
+(
+	const CMatrix4x4& viewProj,
+	CVector4          aPlanes[6]
+)
+{
+	CVector4 vColumnX = viewProj.GetColumn( 0 );
+	CVector4 vColumnY = viewProj.GetColumn( 1 );
+	CVector4 vColumnZ = viewProj.GetColumn( 2 );
+	CVector4 vColumnW = viewProj.GetColumn( 3 );
+	aPlanes[0] = vColumnW + vColumnX; // Left
+	aPlanes[1] = vColumnW - vColumnX; // Right
+	aPlanes[2] = vColumnW + vColumnY; // Bottom
+	aPlanes[3] = vColumnW - vColumnY; // Top
+	aPlanes[4] = vColumnZ;            // Near
+	aPlanes[5] = vColumnW - vColumnZ; // Far
+	for (TUInt32 iPlane = 0; iPlane < 6; ++iPlane)
+	{
+		TFloat32 fLength = Sqrt( aPlanes[iPlane].x * aPlanes[iPlane].x + aPlanes[iPlane].y * aPlanes[iPlane].y +
+		                         aPlanes[iPlane].z * aPlanes[iPlane].z );
+		if (fLength > 0.0f)
+		{
+			aPlanes[iPlane] /= fLength;
+		}
+	}
+}
+
+// Cull clusters outside the frustum or facing away from the viewpoint, appending draw ranges for
+// the faces of the others
+TUInt32 CullMeshClusters
+(
+	const SMeshCluster*        pClusters,
+	const TUInt32              iNumClusters,
+	const CVector4             aPlanes[6],
+	const CVector3&            viewPoint,
+	vector<SClusterDrawRange>* pRanges,
+	SClusterCullStats*         pStats /*= 0*/
+)
+{
+	TUInt32 iNumFrustumCulled = 0, iNumConeCulled = 0, iFacesDrawn = 0, iFacesCulled = 0;
+	for (TUInt32 iCluster = 0; iCluster < iNumClusters; ++iCluster)
+	{
+		const SMeshCluster& cluster = pClusters[iCluster];
+
+		// Outside the frustum if the sphere is entirely behind any plane
+		bool bOutside = false;
+		for (TUInt32 iPlane = 0; iPlane < 6; ++iPlane)
+		{
+			const CVector4& plane = aPlanes[iPlane];
+			bOutside |= plane.x * cluster.centre.x + plane.y * cluster.centre.y + plane.z * cluster.centre.z + plane.w <
+			            -cluster.fRadius;
+		}
+		if (bOutside)
+		{
+			++iNumFrustumCulled;
+			iFacesCulled += cluster.iNumFaces;
+			continue;
+		}
+
+		// Facing away if the direction from the viewpoint to the cone apex is inside the cone
+		CVector3 vToApex = cluster.coneApex - viewPoint;
+		TFloat32 fApexDistance = Length( vToApex );
+		if (Dot( vToApex, cluster.coneAxis ) >= cluster.fConeCutoff * fApexDistance)
+		{
+			++iNumConeCulled;
+			iFacesCulled += cluster.iNumFaces;
+			continue;
+		}
+
+		// Join onto the last range if the clusters are neighbours
+		if (!pRanges->empty() && pRanges->back().iFirstFace + pRanges->back().iNumFaces == cluster.iFirstFace)
+		{
+			pRanges->back().iNumFaces += cluster.iNumFaces;
+		}
+		else
+		{
+			SClusterDrawRange range = { cluster.iFirstFace, cluster.iNumFaces };
+			pRanges->push_back( range );
+		}
+		iFacesDrawn += cluster.iNumFaces;
+	}
+
+	if (pStats)
+	{
+		pStats->iNumClusters += iNumClusters;
+		pStats->iNumFrustumCulled += iNumFrustumCulled;
+		pStats->iNumConeCulled += iNumConeCulled;
+		pStats->iNumFacesDrawn += iFacesDrawn;
+		pStats->iNumFacesCulled += iFacesCulled;
+	}
+	return iFacesDrawn;
+}
+
+
+} // namespace gen
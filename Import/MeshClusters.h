@@ -0,0 +1,130 @@
+/**************************************************************************************************
+	Module:       MeshClusters.h
+	Date created: 18/10/26
+
+	Partitioning of indexed triangle meshes into small clusters of faces, each with a bounding
+	sphere and a cone bounding its face normals, and culling of the clusters against a view
+	frustum and for facing away from the viewpoint
+
+	Change history:
+		V1.0    Created 18/10/26
+		V1.1    Face count below which sub-meshes are not clustered
+**************************************************************************************************/
+
+#ifndef GEN_MESH_CLUSTERS_H_INCLUDED
+#define GEN_MESH_CLUSTERS_H_INCLUDED
+
+#include <vector>
+using namespace std;
+
+#include "GenDefines.h"
+#include "CVector3.h"
+#include "CVector4.h"
+#include "CMatrix4x4.h"
+#include "MeshData.h"
+
+namespace gen
+{
+
+// Maximum number of vertices and faces in a cluster. The same limits as used for mesh shader
+// meshlets, small enough that a cluster's faces are close together and face similar directions
+const TUInt32 kiMaxClusterVertices = 64;
+const TUInt32 kiMaxClusterFaces = 124;
+
+// Sub-meshes with fewer faces than this are not clustered when cooked (see CCookedMesh). Culling
+// their few clusters saves less than it costs each frame, and clustering loses some of the vertex
+// cache order of the whole sub-mesh
+const TUInt32 kiMinClusteredFaces = 1024;
+
+// Cone cutoff of a cluster whose faces face too many directions for the cone test to ever cull it
+const TFloat32 kfNoClusterCone = 2.0f;
+
+
+/////////////////////////////////////
+// Clusters
+
+// A cluster of consecutive faces in a sub-mesh (52 bytes). The cone contains the normals of all
+// the faces - the cluster can only be seen from viewpoints inside the opposite cone, so it can be
+// culled as a whole from anywhere else (see CullMeshClusters)
+struct SMeshCluster
+{
+	TUInt32  iFirstFace;
+	TUInt32  iNumFaces;
+	CVector3 centre;      // Bounding sphere of the vertices
+	TFloat32 fRadius;
+	CVector3 coneApex;    // Cone test point, behind all the faces
+	CVector3 coneAxis;    // Average direction of the face normals
+	TFloat32 fConeCutoff; // Sine of the cone half-angle, kfNoClusterCone if the cone is unused
+};
+
+// Partition the faces of a sub-mesh (its own faces only, not its levels of detail) into clusters
+// of at most kiMaxClusterVertices vertices and kiMaxClusterFaces faces. Each cluster is grown
+// from a face across shared vertices, preferring faces adding the fewest new vertices, then those
+// facing the same way and nearby. The faces of the sub-mesh are reordered in place so each
+// cluster's faces are consecutive, and ordered for the vertex cache within each cluster, then the
+// vertices are reordered for fetch (see OptimiseSubMesh). Face and vertex indices into the
+// sub-mesh (e.g. levels of detail, hierarchies and edges) must be built after this
+void BuildMeshClusters
+(
+	const SSubMesh&       subMesh,
+	vector<SMeshCluster>* pClusters
+);
+
+// Transform a cluster's bounds by a matrix (e.g. into the space of the mesh root). The cone is
+// only kept for rotations, translations and uniform scales - others do not keep the angles
+// between the face normals, so the cone test is turned off for the cluster
+void TransformMeshCluster
+(
+	SMeshCluster*     pCluster,
+	const CMatrix4x4& m
+);
+
+
+/////////////////////////////////////
+// Culling
+
+// Counts of clusters and faces culled by CullMeshClusters, added to on each call
+struct SClusterCullStats
+{
+	TUInt32 iNumClusters;        // Clusters tested
+	TUInt32 iNumFrustumCulled;   // Clusters outside the frustum
+	TUInt32 iNumConeCulled;      // Clusters inside the frustum, but facing away from the viewpoint
+	TUInt32 iNumFacesDrawn;
+	TUInt32 iNumFacesCulled;
+};
+
+// A range of consecutive faces to draw
+struct SClusterDrawRange
+{
+	TUInt32 iFirstFace;
+	TUInt32 iNumFaces;
+};
+
+// Get the six planes of the view frustum from a view-projection matrix (Direct3D conventions,
+// depth from 0 to 1). Pass the world matrix multiplied by the view-projection matrix to get the
+// planes in model space. Planes are normalised and face into the frustum: a point p is inside
+// all of them where Dot(plane.xyz, p) + plane.w >= 0
+void GetFrustumPlanes
+(
+	const CMatrix4x4& viewProj,
+	CVector4          aPlanes[6]
+);
+
+// Cull clusters whose bounding spheres are outside the frustum, or that face away from the
+// viewpoint (both in the space of the clusters). The faces of the remaining clusters are appended
+// to the list of draw ranges, with neighbouring clusters joined into a single range. Returns the
+// number of faces to draw. The test is conservative: only faces that could not be seen are culled
+TUInt32 CullMeshClusters
+(
+	const SMeshCluster*        pClusters,
+	const TUInt32              iNumClusters,
+	const CVector4             aPlanes[6],
+	const CVector3&            viewPoint,
+	vector<SClusterDrawRange>* pRanges,
+	SClusterCullStats*         pStats = 0
+);
+
+
+} // namespace gen
+
+#endif // GEN_MESH_CLUSTERS_H_INCLUDED
@@ -10,10 +10,12 @@
 
 #include <vector>
 #include <string>
+#include <new>
 using namespace std;
 
 #include "GenDefines.h"
 #include "Colour.h"
+#include "CVector3.h"
 #include "CMatrix4x4.h"
 
 namespace gen
@@ -40,40 +42,127 @@ enum ERenderMethod
 /////////////////////////////////////
 // Mesh definitions
 
+// Bounding volumes of a set of vertex positions - an axis aligned box and a sphere. The sphere is
+// centred on the box and just encloses the positions, which is usually much tighter than the
+// sphere around the box (see MeshBounds.h). Empty sets have zero bounds
+struct SMeshBounds
+{
+	CVector3 minBounds;
+	CVector3 maxBounds;
+	CVector3 centre;
+	TFloat32 radius;
+};
+
 // A single node in the hierarchy of a mesh. The hierarchy is flattened (depth-first) into a list
 struct SMeshNode
 { 
-	string     name;           // Name for the node
-	TUInt32    depth;          // Depth in hierachy of this node
-	TUInt32    parent;         // Index in hierarchy list of parent node
-	TUInt32    numChildren;    // Number of children of this node - the next node in the list will
-	                           // be the first child
-	CMatrix4x4 positionMatrix; // Default matrix of this node in parent space
-	CMatrix4x4 invMeshOffset;  // Inverse of the matrix of this node in mesh's root space
+	string      name;           // Name for the node
+	TUInt32     depth;          // Depth in hierachy of this node
+	TUInt32     parent;         // Index in hierarchy list of parent node
+	TUInt32     numChildren;    // Number of children of this node - the next node in the list will
+	                            // be the first child
+	CMatrix4x4  positionMatrix; // Default matrix of this node in parent space
+	CMatrix4x4  invMeshOffset;  // Inverse of the matrix of this node in mesh's root space
+	SMeshBounds bounds;         // Bounds of the sub-meshes controlled by this node, in the node's
+	                            // space. Does not include child nodes
 };
 
 
-// A single face in a mesh - all faces are triangles
+// A single face in a mesh - all faces are triangles. Sub-meshes with more vertices than can be
+// indexed with 16 bits use SMeshFace32 instead
 struct SMeshFace
 {
 	TUInt16 aiVertex[3];
 };
 typedef vector<SMeshFace> TMeshFaces;
 
+struct SMeshFace32
+{
+	TUInt32 aiVertex[3];
+};
+
+// Size in bytes of the vertex indices needed for a sub-mesh with the given number of vertices
+inline TUInt32 GetIndexSize( const TUInt32 numVertices )
+{
+	return (numVertices > 0x10000) ? sizeof(TUInt32) : sizeof(TUInt16);
+}
+
 // A sub-mesh is a single block of geometry that uses the same material. It contains a set of faces
 // and vertices and is controlled by a single node. The vertices are pointed to as raw bytes,
 // because of the flexibility of vertex data
 struct SSubMesh
 {
-	TUInt32    node;        // Node in heirarchy controlling this submesh
-	TUInt32    material;    // Index of material used by this submesh
-	TUInt32    numVertices;
-	TUInt8*    vertices;    // Pointer to raw vertex data as a byte stream
-	TUInt32    vertexSize;  // Size in bytes of a single vertex
-	bool       hasSkinningData, hasNormals, hasTangents, // Components of each vertex
-	           hasTextureCoords, hasVertexColours;       // (Vertex coordinate assumed)
-	TUInt32    numFaces;
-	SMeshFace* faces;
+	TUInt32     node;        // Node in heirarchy controlling this submesh
+	TUInt32     material;    // Index of material used by this submesh
+	TUInt32     numVertices;
+	TUInt8*     vertices;    // Pointer to raw vertex data as a byte stream
+	TUInt32     vertexSize;  // Size in bytes of a single vertex
+	bool        hasSkinningData, hasNormals, hasTangents, // Components of each vertex
+	            hasTextureCoords, hasVertexColours;       // (Vertex coordinate assumed)
+	TUInt32     numFaces;
+	TUInt32     indexSize;   // Size in bytes of each vertex index in the faces, 2 or 4
+	TUInt8*     faces;       // Pointer to raw face data - SMeshFace if index size is 2, otherwise
+	                         // SMeshFace32
+	SMeshBounds bounds;      // Bounds of the vertex positions, in the space of the node
+};
+
+// A sub-mesh that owns its vertex and face data, which is freed when this object is destroyed
+class CSubMeshData
+{
+public:
+	CSubMeshData()
+	{
+		m_SubMesh.numVertices = 0;
+		m_SubMesh.vertices = 0;
+		m_SubMesh.vertexSize = 0;
+		m_SubMesh.numFaces = 0;
+		m_SubMesh.indexSize = sizeof(TUInt16);
+		m_SubMesh.faces = 0;
+	}
+
+	~CSubMeshData()
+	{
+		Free();
+	}
+
+	// Take a sub-mesh specification (e.g. from an importer) and allocate space for its data.
+	// Returns false if out of memory
+	bool Allocate( const SSubMesh& layout )
+	{
+		Free();
+		m_SubMesh = layout;
+		m_SubMesh.vertices = new (nothrow) TUInt8[layout.numVertices * layout.vertexSize];
+		m_SubMesh.faces = new (nothrow) TUInt8[layout.numFaces * 3 * layout.indexSize];
+		return m_SubMesh.vertices && m_SubMesh.faces;
+	}
+
+	// Free the data, leaves an empty sub-mesh
+	void Free()
+	{
+		delete[] m_SubMesh.vertices;
+		delete[] m_SubMesh.faces;
+		m_SubMesh.numVertices = 0;
+		m_SubMesh.vertices = 0;
+		m_SubMesh.numFaces = 0;
+		m_SubMesh.faces = 0;
+	}
+
+	// Access the sub-mesh, the data pointers remain owned by this object
+	const SSubMesh& Get() const
+	{
+		return m_SubMesh;
+	}
+	const SSubMesh* operator->() const
+	{
+		return &m_SubMesh;
+	}
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CSubMeshData( const CSubMeshData& );
+	CSubMeshData& operator=( const CSubMeshData& );
+
+	SSubMesh m_SubMesh;
 };
 
 
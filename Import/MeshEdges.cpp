@@ -0,0 +1,405 @@
+/**************************************************************************************************
+	Module:       MeshEdges.cpp
+	Date created: 18/10/26
+
+	Edge adjacency for indexed triangle meshes - each edge with the two faces that share it - and
+	extraction of the silhouette edges seen from a viewpoint, e.g. to draw outlines as lines
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include "MeshEdges.h"
+#include "CThreadPool.h"
+#include "BaseMath.h"
+#include "Error.h"
+
+namespace gen
+{
+
+namespace
+{
+	// Minimum number of faces or edges processed by a single task when using a thread pool
+	const TUInt32 kiMinBatchSize = 4096;
+
+	// Get the number of batches to split a number of items into - a few batches per thread to
+	// even out the work, or a single batch if there is no thread pool or not enough work
+	TUInt32 GetNumBatches
+	(
+		const TUInt32 iCount,
+		CThreadPool*  pThreadPool
+	)
+	{
+		if (!pThreadPool || iCount <= kiMinBatchSize)
+		{
+			return 1;
+		}
+		TUInt32 iNumBatches = (iCount + kiMinBatchSize - 1) / kiMinBatchSize;
+		return Min( iNumBatches, pThreadPool->GetNumThreads() * 4 );
+	}
+
+	// Run a function on batches iBatch of ranges [iStart, iEnd) covering [0, iCount), in parallel
+	// if there is more than one batch. Returns when all batches are complete
+	template <class TFn>
+	void ParallelFor
+	(
+		const TUInt32 iCount,
+		const TUInt32 iNumBatches,
+		CThreadPool*  pThreadPool,
+		const TFn&    fn
+	)
+	{
+		if (iNumBatches <= 1)
+		{
+			fn( 0, 0, iCount );
+			return;
+		}
+
+		TUInt32 iBatchSize = (iCount + iNumBatches - 1) / iNumBatches;
+		vector< future<void> > results;
+		results.reserve( iNumBatches );
+		for (TUInt32 iBatch = 0; iBatch < iNumBatches; ++iBatch)
+		{
+			TUInt32 iStart = Min( iBatch * iBatchSize, iCount );
+			TUInt32 iEnd = Min( iStart + iBatchSize, iCount );
+			const TFn* pFn = &fn;
+			results.push_back( pThreadPool->Submit( [pFn, iBatch, iStart, iEnd]() { (*pFn)( iBatch, iStart, iEnd ); } ) );
+		}
+
+		// Wait for every task before checking for errors, the tasks refer to the caller's data
+		for (TUInt32 iResult = 0; iResult < results.size(); ++iResult)
+		{
+			results[iResult].wait();
+		}
+		for (TUInt32 iResult = 0; iResult < results.size(); ++iResult)
+		{
+			results[iResult].get(); // Rethrows any exception from the task
+		}
+	}
+
+
+	// Get the position of a vertex in a sub-mesh
+	inline CVector3 GetPosition
+	(
+		const SSubMesh& subMesh,
+		const TUInt32   iVertex
+	)
+	{
+		CVector3 vPosition;
+		memcpy( &vPosition, subMesh.vertices + iVertex * subMesh.vertexSize, sizeof(CVector3) );
+		return vPosition;
+	}
+
+	// Get the vertex indices of a face in a sub-mesh
+	inline void GetFace
+	(
+		const SSubMesh& subMesh,
+		const TUInt32   iFace,
+		TUInt32*        aiIndices
+	)
+	{
+		for (TUInt32 iCorner = 0; iCorner < 3; ++iCorner)
+		{
+			aiIndices[iCorner] = (subMesh.indexSize == sizeof(TUInt32)) ?
+			                     reinterpret_cast<const TUInt32*>(subMesh.faces)[iFace * 3 + iCorner] :
+			                     reinterpret_cast<const TUInt16*>(subMesh.faces)[iFace * 3 + iCorner];
+		}
+	}
+
+	// An edge of a face, going from its first vertex to its second in the face's winding. Sorted
+	// on the welded positions of its ends, lowest first, so both faces of an edge sort together
+	struct SHalfEdge
+	{
+		TUInt64 iKey;         // Welded position of the lower end in the top 32 bits, the higher end below
+		TUInt32 iFace;
+		TUInt32 aiVertices[2];
+		bool    bReversed;    // True if the edge goes from the higher welded position to the lower
+
+		bool operator<( const SHalfEdge& other ) const
+		{
+			if (iKey != other.iKey) return iKey < other.iKey;
+			return iFace < other.iFace;
+		}
+	};
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Edge adjacency
+-----------------------------------------------------------------------------------------*/
+
+// Build the edge adjacency of a sub-mesh's faces
+void BuildEdgeAdjacency
+(
+	const SSubMesh&    subMesh,
+	vector<SMeshEdge>* pEdges
+)
+{
+	GEN_GUARD;
+
+	pEdges->clear();
+
+	// Weld the vertices by position: sort them on position, then give each vertex the lowest
+	// index of the vertices with exactly the same position
+	vector<TUInt32> sortedVertices( subMesh.numVertices );
+	vector<CVector3> positions( subMesh.numVertices );
+	for (TUInt32 iVertex = 0; iVertex < subMesh.numVertices; ++iVertex)
+	{
+		sortedVertices[iVertex] = iVertex;
+		positions[iVertex] = GetPosition( subMesh, iVertex );
+	}
+	sort( sortedVertices.begin(), sortedVertices.end(), [&positions]( TUInt32 iA, TUInt32 iB )
+	{
+		const CVector3& a = positions[iA];
+		const CVector3& b = positions[iB];
+		if (a.x != b.x) return a.x < b.x;
+		if (a.y != b.y) return a.y < b.y;
+		if (a.z != b.z) return a.z < b.z;
+		return iA < iB;
+	} );
+	vector<TUInt32> welded( subMesh.numVertices );
+	for (TUInt32 iSorted = 0; iSorted < subMesh.numVertices; ++iSorted)
+	{
+		TUInt32 iVertex = sortedVertices[iSorted];
+		welded[iVertex] = (iSorted > 0 && positions[iVertex] == positions[sortedVertices[iSorted - 1]]) ?
+		                  welded[sortedVertices[iSorted - 1]] : iVertex;
+	}
+
+	// Collect the edges of every face and sort them so the faces of each edge are together
+	vector<SHalfEdge> halfEdges;
+	halfEdges.reserve( subMesh.numFaces * 3 );
+	for (TUInt32 iFace = 0; iFace < subMesh.numFaces; ++iFace)
+	{
+		TUInt32 aiIndices[3];
+		GetFace( subMesh, iFace, aiIndices );
+		for (TUInt32 iCorner = 0; iCorner < 3; ++iCorner)
+		{
+			TUInt32 iStart = aiIndices[iCorner];
+			TUInt32 iEnd = aiIndices[(iCorner + 1) % 3];
+			TUInt32 iWeldStart = welded[iStart];
+			TUInt32 iWeldEnd = welded[iEnd];
+			if (iWeldStart == iWeldEnd)
+			{
+				continue; // Degenerate
+			}
+			SHalfEdge halfEdge;
+			halfEdge.bReversed = iWeldStart > iWeldEnd;
+			halfEdge.iKey = halfEdge.bReversed ? (static_cast<TUInt64>(iWeldEnd) << 32) | iWeldStart :
+			                                     (static_cast<TUInt64>(iWeldStart) << 32) | iWeldEnd;
+			halfEdge.iFace = iFace;
+			halfEdge.aiVertices[0] = iStart;
+			halfEdge.aiVertices[1] = iEnd;
+			halfEdges.push_back( halfEdge );
+		}
+	}
+	sort( halfEdges.begin(), halfEdges.end() );
+
+	// Pair the faces using each edge in one direction with those using it in the other. A
+	// manifold mesh has exactly one of each
+	vector<TUInt32> forward, reversed;
+	pEdges->reserve( halfEdges.size() / 2 + 16 );
+	for (TUInt32 iFirst = 0; iFirst < halfEdges.size();)
+	{
+		TUInt32 iLast = iFirst + 1;
+		while (iLast < halfEdges.size() && halfEdges[iLast].iKey == halfEdges[iFirst].iKey)
+		{
+			++iLast;
+		}
+		forward.clear();
+		reversed.clear();
+		for (TUInt32 iHalfEdge = iFirst; iHalfEdge < iLast; ++iHalfEdge)
+		{
+			(halfEdges[iHalfEdge].bReversed ? reversed : forward).push_back( iHalfEdge );
+		}
+		TUInt32 iNumPairs = static_cast<TUInt32>(Min( forward.size(), reversed.size() ));
+		for (TUInt32 iHalfEdge = iFirst; iHalfEdge < iLast; ++iHalfEdge)
+		{
+			const SHalfEdge& halfEdge = halfEdges[iHalfEdge];
+			const vector<TUInt32>& same = halfEdge.bReversed ? reversed : forward;
+			const vector<TUInt32>& other = halfEdge.bReversed ? forward : reversed;
+			TUInt32 iPosition = static_cast<TUInt32>(find( same.begin(), same.end(), iHalfEdge ) - same.begin());
+
+			// Paired half-edges are added once, from the forward one
+			if (iPosition < iNumPairs && halfEdge.bReversed)
+			{
+				continue;
+			}
+			SMeshEdge edge;
+			edge.aiVertices[0] = halfEdge.aiVertices[0];
+			edge.aiVertices[1] = halfEdge.aiVertices[1];
+			edge.aiFaces[0] = halfEdge.iFace;
+			edge.aiFaces[1] = (iPosition < iNumPairs) ? halfEdges[other[iPosition]].iFace : kiNoEdgeFace;
+			pEdges->push_back( edge );
+		}
+		iFirst = iLast;
+	}
+
+	GEN_ENDGUARD;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Silhouettes
+-----------------------------------------------------------------------------------------*/
+
+// Prepare a sub-mesh for silhouette extraction, with edges built for it by BuildEdgeAdjacency
+void CMeshSilhouette::Init
+(
+	const SSubMesh&   subMesh,
+	const SMeshEdge*  pEdges,
+	const TUInt32     iNumEdges,
+	const CMatrix4x4* pMatrix /*= 0*/
+)
+{
+	GEN_GUARD;
+
+	m_Edges.assign( pEdges, pEdges + iNumEdges );
+
+	// A matrix that mirrors (negative determinant) reverses the winding of the faces, so the
+	// normals are flipped to keep them facing out
+	bool bMirrored = false;
+	if (pMatrix)
+	{
+		CVector3 vX = pMatrix->TransformVector( CVector3( 1.0f, 0.0f, 0.0f ) );
+		CVector3 vY = pMatrix->TransformVector( CVector3( 0.0f, 1.0f, 0.0f ) );
+		CVector3 vZ = pMatrix->TransformVector( CVector3( 0.0f, 0.0f, 1.0f ) );
+		bMirrored = Dot( Cross( vX, vY ), vZ ) < 0.0f;
+	}
+
+	m_Planes.resize( subMesh.numFaces );
+	for (TUInt32 iFace = 0; iFace < subMesh.numFaces; ++iFace)
+	{
+		TUInt32 aiIndices[3];
+		GetFace( subMesh, iFace, aiIndices );
+		CVector3 aCorners[3];
+		for (TUInt32 iCorner = 0; iCorner < 3; ++iCorner)
+		{
+			aCorners[iCorner] = GetPosition( subMesh, aiIndices[iCorner] );
+			if (pMatrix)
+			{
+				aCorners[iCorner] = pMatrix->TransformPoint( aCorners[iCorner] );
+			}
+		}
+
+		// Faces are clockwise seen from the front in a left-handed space (Direct3D convention), so
+		// this normal points out of the front, the same way as the vertex normals. Only the sign
+		// of the plane equation is used, so the normal is not normalised
+		CVector3 vNormal = Cross( aCorners[1] - aCorners[0], aCorners[2] - aCorners[0] );
+		if (bMirrored)
+		{
+			vNormal = -vNormal;
+		}
+		m_Planes[iFace].normal = vNormal;
+		m_Planes[iFace].fDistance = -Dot( vNormal, aCorners[0] );
+	}
+	m_FrontFacing.resize( subMesh.numFaces );
+
+	GEN_ENDGUARD;
+}
+
+// Build the edges for a sub-mesh and prepare it for silhouette extraction as above
+void CMeshSilhouette::Init
+(
+	const SSubMesh&   subMesh,
+	const CMatrix4x4* pMatrix /*= 0*/
+)
+{
+	GEN_GUARD;
+
+	vector<SMeshEdge> edges;
+	BuildEdgeAdjacency( subMesh, &edges );
+	Init( subMesh, edges.data(), static_cast<TUInt32>(edges.size()), pMatrix );
+
+	GEN_ENDGUARD;
+}
+
+
+// Find the silhouette edges seen from a viewpoint. Two passes: find the side of each face the
+// viewpoint is on, then find the edges with faces on different sides. Each pass is split into
+// batches in parallel if a thread pool is given, the edges of each batch are collected separately
+// then joined in batch order, so the list is the same as a single pass would give
+TUInt32 CMeshSilhouette::Extract
+(
+	const CVector3&  viewPoint,
+	vector<TUInt32>* pLineIndices,
+	const TUInt32    iBaseVertex /*= 0*/,
+	CThreadPool*     pThreadPool /*= 0*/
+)
+{
+	GEN_GUARD;
+
+	const SFacePlane* pPlanes = m_Planes.data();
+	TUInt8* pFrontFacing = m_FrontFacing.data();
+	TUInt32 iNumFaces = GetNumFaces();
+	ParallelFor( iNumFaces, GetNumBatches( iNumFaces, pThreadPool ), pThreadPool,
+	             [=]( TUInt32, TUInt32 iStart, TUInt32 iEnd )
+	             {
+	                 for (TUInt32 iFace = iStart; iFace < iEnd; ++iFace)
+	                 {
+	                     pFrontFacing[iFace] = (Dot( pPlanes[iFace].normal, viewPoint ) + pPlanes[iFace].fDistance > 0.0f) ? 1 : 0;
+	                 }
+	             } );
+
+	// A border edge has only one face, it is a silhouette edge if that face is towards the viewer.
+	// Every edge is written to the output and only kept (the output moved on) if it is on the
+	// silhouette, which avoids a hard to predict branch for each edge. So the output must have
+	// room for every edge and is trimmed afterwards
+	const SMeshEdge* pEdges = m_Edges.data();
+	auto findEdges = [=]( TUInt32 iStart, TUInt32 iEnd, TUInt32* pIndices ) -> TUInt32
+	{
+		TUInt32* pOut = pIndices;
+		for (TUInt32 iEdge = iStart; iEdge < iEnd; ++iEdge)
+		{
+			const SMeshEdge& edge = pEdges[iEdge];
+			TUInt32 iFront0 = pFrontFacing[edge.aiFaces[0]];
+			TUInt32 iFront1 = (edge.aiFaces[1] != kiNoEdgeFace) ? pFrontFacing[edge.aiFaces[1]] : 0;
+			pOut[0] = edge.aiVertices[0] + iBaseVertex;
+			pOut[1] = edge.aiVertices[1] + iBaseVertex;
+			pOut += (iFront0 ^ iFront1) * 2;
+		}
+		return static_cast<TUInt32>(pOut - pIndices) / 2;
+	};
+
+	size_t iOldSize = pLineIndices->size();
+	TUInt32 iNumEdges = GetNumEdges();
+	if (iNumEdges == 0)
+	{
+		return 0;
+	}
+	TUInt32 iNumBatches = GetNumBatches( iNumEdges, pThreadPool );
+	TUInt32 iBatchSize = (iNumEdges + iNumBatches - 1) / iNumBatches;
+	pLineIndices->resize( iOldSize + iNumEdges * 2 );
+	TUInt32* pOutput = pLineIndices->data() + iOldSize;
+	if (iNumBatches <= 1)
+	{
+		pLineIndices->resize( iOldSize + findEdges( 0, iNumEdges, pOutput ) * 2 );
+	}
+	else
+	{
+		// Each batch writes to its own part of the output, then the parts are moved together
+		vector<TUInt32> batchEdges( iNumBatches );
+		TUInt32* pBatchEdges = batchEdges.data();
+		ParallelFor( iNumEdges, iNumBatches, pThreadPool,
+		             [=]( TUInt32 iBatch, TUInt32 iStart, TUInt32 iEnd )
+		             {
+		                 pBatchEdges[iBatch] = findEdges( iStart, iEnd, pOutput + iStart * 2 );
+		             } );
+		TUInt32 iNumFound = 0;
+		for (TUInt32 iBatch = 0; iBatch < iNumBatches; ++iBatch)
+		{
+			memmove( pOutput + iNumFound * 2, pOutput + iBatch * iBatchSize * 2, batchEdges[iBatch] * 2 * sizeof(TUInt32) );
+			iNumFound += batchEdges[iBatch];
+		}
+		pLineIndices->resize( iOldSize + iNumFound * 2 );
+	}
+	return static_cast<TUInt32>((pLineIndices->size() - iOldSize) / 2);
+
+	GEN_ENDGUARD;
+}
+
+
+} // namespace gen
@@ -0,0 +1,157 @@
+/**************************************************************************************************
+	Module:       MeshEdges.h
+	Date created: 18/10/26
+
+	Edge adjacency for indexed triangle meshes - each edge with the two faces that share it - and
+	extraction of the silhouette edges seen from a viewpoint, e.g. to draw outlines as lines
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#ifndef GEN_MESH_EDGES_H_INCLUDED
+#define GEN_MESH_EDGES_H_INCLUDED
+
+#include <vector>
+using namespace std;
+
+#include "GenDefines.h"
+#include "CVector3.h"
+#include "CMatrix4x4.h"
+#include "MeshData.h"
+
+namespace gen
+{
+
+class CThreadPool;
+
+// Second face of an edge that only has one face (on the border of the mesh, or where more than
+// two faces meet)
+const TUInt32 kiNoEdgeFace = 0xffffffff;
+
+
+/////////////////////////////////////
+// Edge adjacency
+
+// An edge and the faces either side of it (16 bytes). The vertices are in the order they appear
+// in the first face
+struct SMeshEdge
+{
+	TUInt32 aiVertices[2];
+	TUInt32 aiFaces[2]; // Second is kiNoEdgeFace for a border edge
+};
+
+// Build the edge adjacency of a sub-mesh's faces (its own faces only, not its levels of detail).
+// Faces are joined where they share an edge position, not just a vertex index, so edges along
+// seams in the normals or UVs (where vertices are split) still join the faces either side. An
+// edge is shared by faces that use it in opposite directions. Where more than two faces meet at an
+// edge they are paired up where possible, faces left over (or with inconsistent winding) get
+// border edges of their own, which at worst gives extra silhouette edges. Degenerate edges (both
+// ends at one position) are left out
+void BuildEdgeAdjacency
+(
+	const SSubMesh&    subMesh,
+	vector<SMeshEdge>* pEdges
+);
+
+
+/////////////////////////////////////
+// Silhouettes
+
+// The faces and edges of a sub-mesh prepared for silhouette extraction. Each face is stored as a
+// plane, so the side of a face a viewpoint is on costs one dot product. A silhouette edge has one
+// face towards the viewpoint and one away, or is a border edge of a face towards the viewpoint.
+// Drawing the silhouette edges as lines outlines the mesh - far fewer vertices than drawing an
+// expanded copy of the whole mesh behind it
+class CMeshSilhouette
+{
+	GEN_CLASS( CMeshSilhouette )
+
+/*-----------------------------------------------------------------------------------------
+	Public interface
+-----------------------------------------------------------------------------------------*/
+public:
+
+	/////////////////////////////////////
+	// Setup
+
+	// Prepare a sub-mesh for silhouette extraction, with edges built for it by BuildEdgeAdjacency
+	// (e.g. when the mesh was cooked). The face planes are calculated here, so the sub-mesh data
+	// is not needed afterwards. If a matrix is given the faces are transformed by it (e.g. into
+	// the space of the mesh root) - viewpoints must then be given in that space
+	void Init
+	(
+		const SSubMesh&   subMesh,
+		const SMeshEdge*  pEdges,
+		const TUInt32     iNumEdges,
+		const CMatrix4x4* pMatrix = 0
+	);
+
+	// Build the edges for a sub-mesh and prepare it for silhouette extraction as above
+	void Init
+	(
+		const SSubMesh&   subMesh,
+		const CMatrix4x4* pMatrix = 0
+	);
+
+
+	/////////////////////////////////////
+	// Extraction
+
+	// Find the silhouette edges seen from a viewpoint (in the space of the faces). Appends two
+	// vertex indices for each edge to the given list - a line list - with the given base vertex
+	// added to each. Returns the number of edges found. If a thread pool is given, large meshes
+	// are processed in parallel, the result is the same in any case. Not thread-safe, the face
+	// sides are kept in this object
+	TUInt32 Extract
+	(
+		const CVector3&  viewPoint,
+		vector<TUInt32>* pLineIndices,
+		const TUInt32    iBaseVertex = 0,
+		CThreadPool*     pThreadPool = 0
+	);
+
+
+	/////////////////////////////////////
+	// Data access
+
+	// Get the number of edges and faces
+	TUInt32 GetNumEdges() const
+	{
+		return static_cast<TUInt32>(m_Edges.size());
+	}
+	TUInt32 GetNumFaces() const
+	{
+		return static_cast<TUInt32>(m_Planes.size());
+	}
+
+	// Get the memory used by the edges, face planes and face sides in bytes
+	TUInt32 GetMemorySize() const
+	{
+		return static_cast<TUInt32>(m_Edges.size() * sizeof(SMeshEdge) + m_Planes.size() * sizeof(SFacePlane) +
+		                            m_FrontFacing.size() * sizeof(TUInt8));
+	}
+
+
+/*-----------------------------------------------------------------------------------------
+	Private interface
+-----------------------------------------------------------------------------------------*/
+private:
+
+	// Plane of a face - points p on the face have Dot(normal, p) + fDistance = 0, and the face is
+	// towards viewpoints where the result is positive
+	struct SFacePlane
+	{
+		CVector3 normal;
+		TFloat32 fDistance;
+	};
+
+	vector<SMeshEdge>  m_Edges;
+	vector<SFacePlane> m_Planes;
+	vector<TUInt8>     m_FrontFacing; // For each face from the last extraction, 1 if towards the viewpoint
+};
+
+
+} // namespace gen
+
+#endif // GEN_MESH_EDGES_H_INCLUDED
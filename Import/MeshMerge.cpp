@@ -0,0 +1,245 @@
+/**************************************************************************************************
+	Module:       MeshMerge.cpp
+	Date created: 18/10/26
+
+	Merging of the vertices of several sub-meshes into a single vertex list - a vertex layout that
+	can hold all of them, and copying of vertices into that layout, optionally transforming them
+	into another space
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#include <cstring>
+using namespace std;
+
+#include "MeshMerge.h"
+#include "MeshBounds.h"
+#include "CVector4.h"
+#include "Error.h"
+
+namespace gen
+{
+
+namespace
+{
+	// Size in bytes of each component of an imported vertex (see CImportXFile::GetSubMeshLayout)
+	const TUInt32 kiPositionSize = 3 * sizeof(TFloat32);
+	const TUInt32 kiSkinningSize = 4 * sizeof(TFloat32) + sizeof(TUInt32);
+	const TUInt32 kiNormalSize   = 3 * sizeof(TFloat32);
+	const TUInt32 kiTangentSize  = 4 * sizeof(TFloat32);
+	const TUInt32 kiUVSize       = 2 * sizeof(TFloat32);
+	const TUInt32 kiColourSize   = 4 * sizeof(TFloat32);
+
+	// Size of an imported vertex with the components of the given layout
+	TUInt32 GetImportedVertexSize( const SSubMesh& layout )
+	{
+		return kiPositionSize + (layout.hasSkinningData ? kiSkinningSize : 0) +
+		       (layout.hasNormals ? kiNormalSize : 0) + (layout.hasTangents ? kiTangentSize : 0) +
+		       (layout.hasTextureCoords ? kiUVSize : 0) + (layout.hasVertexColours ? kiColourSize : 0);
+	}
+}
+
+
+/////////////////////////////////////
+// Merged layouts
+
+// Start the layout of a merged vertex list - no vertex components, vertices or faces
+void ClearMergedLayout
+(
+	SSubMesh* pLayout
+)
+{
+	pLayout->node = 0;
+	pLayout->material = 0;
+	pLayout->numVertices = 0;
+	pLayout->vertices = 0;
+	pLayout->hasSkinningData = false;
+	pLayout->hasNormals = false;
+	pLayout->hasTangents = false;
+	pLayout->hasTextureCoords = false;
+	pLayout->hasVertexColours = false;
+	pLayout->vertexSize = GetImportedVertexSize( *pLayout );
+	pLayout->numFaces = 0;
+	pLayout->indexSize = sizeof(TUInt16);
+	pLayout->faces = 0;
+	MeshBoundsFromBox( CVector3::kZero, CVector3::kZero, &pLayout->bounds );
+}
+
+// Add a sub-mesh to the layout of a merged vertex list, adding any components it has and its
+// vertex and face counts
+void AddToMergedLayout
+(
+	const SSubMesh& subMesh,
+	SSubMesh*       pLayout
+)
+{
+	pLayout->hasSkinningData  = pLayout->hasSkinningData  || subMesh.hasSkinningData;
+	pLayout->hasNormals       = pLayout->hasNormals       || subMesh.hasNormals;
+	pLayout->hasTangents      = pLayout->hasTangents      || subMesh.hasTangents;
+	pLayout->hasTextureCoords = pLayout->hasTextureCoords || subMesh.hasTextureCoords;
+	pLayout->hasVertexColours = pLayout->hasVertexColours || subMesh.hasVertexColours;
+	pLayout->vertexSize = GetImportedVertexSize( *pLayout );
+	pLayout->numVertices += subMesh.numVertices;
+	pLayout->numFaces += subMesh.numFaces;
+}
+
+
+/////////////////////////////////////
+// Copying vertices
+
+// Copy the vertices of a sub-mesh into a merged vertex list with the given layout, giving defaults
+// to missing components and optionally transforming by a matrix
+void CopyMergedVertices
+(
+	const SSubMesh&   subMesh,
+	const SSubMesh&   layout,
+	const CMatrix4x4* pMatrix,
+	TUInt8*           pOutVertices
+)
+{
+	GEN_GUARD;
+
+	// Normals are transformed by the inverse transpose of the matrix, so they stay perpendicular to
+	// the surface under non-uniform scaling. A matrix that mirrors (negative determinant) reverses
+	// the handedness of the texture space
+	CMatrix4x4 normalMatrix;
+	TFloat32 fHandedness = 1.0f;
+	if (pMatrix)
+	{
+		normalMatrix = Transpose( InverseAffine( *pMatrix ) );
+		CVector3 xAxis( pMatrix->e00, pMatrix->e01, pMatrix->e02 );
+		CVector3 yAxis( pMatrix->e10, pMatrix->e11, pMatrix->e12 );
+		CVector3 zAxis( pMatrix->e20, pMatrix->e21, pMatrix->e22 );
+		fHandedness = (Dot( Cross( xAxis, yAxis ), zAxis ) < 0.0f) ? -1.0f : 1.0f;
+	}
+
+	const CVector3 kDefaultNormal( 0.0f, 1.0f, 0.0f );
+	const CVector4 kDefaultTangent( 1.0f, 0.0f, 0.0f, 1.0f );
+	const TFloat32 kafDefaultColour[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+	// Vertices are copied with memcpy as they may not be aligned
+	const TUInt8* pVertex = subMesh.vertices;
+	TUInt8* pOut = pOutVertices;
+	for (TUInt32 iVertex = 0; iVertex < subMesh.numVertices; ++iVertex)
+	{
+		const TUInt8* pIn = pVertex;
+
+		CVector3 vPosition;
+		memcpy( &vPosition, pIn, kiPositionSize );
+		if (pMatrix)
+		{
+			vPosition = pMatrix->TransformPoint( vPosition );
+		}
+		memcpy( pOut, &vPosition, kiPositionSize );
+		pIn += kiPositionSize;
+		pOut += kiPositionSize;
+
+		if (subMesh.hasSkinningData)
+		{
+			memcpy( pOut, pIn, kiSkinningSize );
+			pIn += kiSkinningSize;
+		}
+		if (layout.hasSkinningData)
+		{
+			if (!subMesh.hasSkinningData)
+			{
+				// Fully weighted to the sub-mesh's node, as the import does for unweighted vertices
+				const TFloat32 kafWeights[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+				const TUInt8 kaiBones[4] = { static_cast<TUInt8>(subMesh.node), 0, 0, 0 };
+				memcpy( pOut, kafWeights, sizeof(kafWeights) );
+				memcpy( pOut + sizeof(kafWeights), kaiBones, sizeof(kaiBones) );
+			}
+			pOut += kiSkinningSize;
+		}
+
+		if (layout.hasNormals)
+		{
+			CVector3 vNormal = kDefaultNormal;
+			if (subMesh.hasNormals)
+			{
+				memcpy( &vNormal, pIn, kiNormalSize );
+				if (pMatrix)
+				{
+					vNormal = Normalise( normalMatrix.TransformVector( vNormal ) );
+				}
+			}
+			memcpy( pOut, &vNormal, kiNormalSize );
+			pOut += kiNormalSize;
+		}
+		if (subMesh.hasNormals)
+		{
+			pIn += kiNormalSize;
+		}
+
+		if (layout.hasTangents)
+		{
+			CVector4 vTangent = kDefaultTangent;
+			if (subMesh.hasTangents)
+			{
+				memcpy( &vTangent, pIn, kiTangentSize );
+				if (pMatrix)
+				{
+					CVector3 vDirection = Normalise( pMatrix->TransformVector( CVector3( vTangent ) ) );
+					vTangent = CVector4( vDirection.x, vDirection.y, vDirection.z, vTangent.w * fHandedness );
+				}
+			}
+			memcpy( pOut, &vTangent, kiTangentSize );
+			pOut += kiTangentSize;
+		}
+		if (subMesh.hasTangents)
+		{
+			pIn += kiTangentSize;
+		}
+
+		if (layout.hasTextureCoords)
+		{
+			if (subMesh.hasTextureCoords)
+			{
+				memcpy( pOut, pIn, kiUVSize );
+			}
+			else
+			{
+				memset( pOut, 0, kiUVSize );
+			}
+			pOut += kiUVSize;
+		}
+		if (subMesh.hasTextureCoords)
+		{
+			pIn += kiUVSize;
+		}
+
+		if (layout.hasVertexColours)
+		{
+			memcpy( pOut, subMesh.hasVertexColours ? pIn : reinterpret_cast<const TUInt8*>(kafDefaultColour),
+			        kiColourSize );
+			pOut += kiColourSize;
+		}
+
+		pVertex += subMesh.vertexSize;
+	}
+
+	GEN_ENDGUARD;
+}
+
+
+// Get the matrix of a node in the space of the root of its hierarchy
+CMatrix4x4 GetNodeRootMatrix
+(
+	const SMeshNode* pNodes,
+	const TUInt32    iNode
+)
+{
+	// Matrices are applied to row vectors, so each parent's matrix is applied after its child's
+	CMatrix4x4 rootMatrix = CMatrix4x4::kIdentity;
+	TUInt32 iCurrNode = iNode;
+	while (iCurrNode != 0)
+	{
+		rootMatrix = rootMatrix * pNodes[iCurrNode].positionMatrix;
+		iCurrNode = pNodes[iCurrNode].parent;
+	}
+	return rootMatrix * pNodes[0].positionMatrix;
+}
+
+
+} // namespace gen
@@ -0,0 +1,74 @@
+/**************************************************************************************************
+	Module:       MeshMerge.h
+	Date created: 18/10/26
+
+	Merging of the vertices of several sub-meshes into a single vertex list - a vertex layout that
+	can hold all of them, and copying of vertices into that layout, optionally transforming them
+	into another space
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#ifndef GEN_MESH_MERGE_H_INCLUDED
+#define GEN_MESH_MERGE_H_INCLUDED
+
+#include "GenDefines.h"
+#include "CMatrix4x4.h"
+#include "MeshData.h"
+
+namespace gen
+{
+
+/////////////////////////////////////
+// Merged layouts
+
+// Start the layout of a merged vertex list - no vertex components (other than the position),
+// vertices or faces. The node, material and data pointers are set to 0 and the bounds to zero
+void ClearMergedLayout
+(
+	SSubMesh* pLayout
+);
+
+// Add a sub-mesh to the layout of a merged vertex list. The layout gets any vertex components
+// the sub-mesh has that it does not, and the sub-mesh's vertices and faces are added to its
+// counts. The vertex size is updated for the components, as imported (full floats). The index
+// size and bounds are left for the caller, as they depend on how the faces are merged
+void AddToMergedLayout
+(
+	const SSubMesh& subMesh,
+	SSubMesh*       pLayout
+);
+
+
+/////////////////////////////////////
+// Copying vertices
+
+// Copy the vertices of a sub-mesh into a merged vertex list with the given layout, which must have
+// all of the sub-mesh's components. Components the sub-mesh doesn't have are given defaults: a
+// normal of (0,1,0), a tangent of (1,0,0) with handedness 1, UVs of (0,0), white vertex colours
+// and skinning to the sub-mesh's node. If a matrix is given, positions are transformed by it
+// and normals and tangents are transformed by it and renormalised (normals by the inverse
+// transpose, tangent handedness is flipped if the matrix mirrors). Skinning data is copied
+// unchanged. The output must have space for the sub-mesh's vertices at the layout's vertex size
+void CopyMergedVertices
+(
+	const SSubMesh&   subMesh,
+	const SSubMesh&   layout,
+	const CMatrix4x4* pMatrix,
+	TUInt8*           pOutVertices
+);
+
+// Get the matrix of a node in the space of the root of its hierarchy, i.e. its default matrix
+// combined with those of all its parents. Transforms the vertices of the node's sub-meshes into
+// root space
+CMatrix4x4 GetNodeRootMatrix
+(
+	const SMeshNode* pNodes,
+	const TUInt32    iNode
+);
+
+
+} // namespace gen
+
+#endif // GEN_MESH_MERGE_H_INCLUDED
@@ -0,0 +1,576 @@
+/**************************************************************************************************
+	Module:       MeshOptimise.cpp
+	Date created: 18/10/26
+
+	Optimisation of indexed triangle meshes for the GPU - triangle order for the post-transform
+	vertex cache and for overdraw, vertex order for vertex fetch - and analysis of vertex cache use
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include "MeshOptimise.h"
+#include "CVector3.h"
+#include "Error.h"
+
+namespace gen
+{
+
+namespace
+{
+	// Read / write the faces of a sub-mesh as 32-bit indices
+	void GetSubMeshIndices
+	(
+		const SSubMesh&  subMesh,
+		vector<TUInt32>* pIndices
+	)
+	{
+		TUInt32 iNumIndices = subMesh.numFaces * 3;
+		pIndices->resize( iNumIndices );
+		if (subMesh.indexSize == sizeof(TUInt32))
+		{
+			memcpy( pIndices->data(), subMesh.faces, iNumIndices * sizeof(TUInt32) );
+		}
+		else
+		{
+			const TUInt16* pIndex16 = reinterpret_cast<const TUInt16*>(subMesh.faces);
+			for (TUInt32 iIndex = 0; iIndex < iNumIndices; ++iIndex)
+			{
+				(*pIndices)[iIndex] = pIndex16[iIndex];
+			}
+		}
+	}
+
+	void SetSubMeshIndices
+	(
+		const SSubMesh&        subMesh,
+		const vector<TUInt32>& indices
+	)
+	{
+		TUInt32 iNumIndices = subMesh.numFaces * 3;
+		if (subMesh.indexSize == sizeof(TUInt32))
+		{
+			memcpy( subMesh.faces, indices.data(), iNumIndices * sizeof(TUInt32) );
+		}
+		else
+		{
+			TUInt16* pIndex16 = reinterpret_cast<TUInt16*>(subMesh.faces);
+			for (TUInt32 iIndex = 0; iIndex < iNumIndices; ++iIndex)
+			{
+				pIndex16[iIndex] = static_cast<TUInt16>(indices[iIndex]);
+			}
+		}
+	}
+
+
+	// Count the vertex cache misses for a range of faces, starting with an empty FIFO cache.
+	// Cache entries are time stamps - a vertex is in the cache if fewer than iCacheSize vertices
+	// have been added since it was
+	TUInt32 CountFIFOMisses
+	(
+		const TUInt32*   pIndices,
+		const TUInt32    iStartFace,
+		const TUInt32    iEndFace,
+		const TUInt32    iCacheSize,
+		vector<TUInt32>* pCacheTimes // One per vertex, 0 for never in the cache
+	)
+	{
+		// Start beyond the cache size so every vertex begins outside the cache
+		TUInt32 iTime = iCacheSize + 1;
+		TUInt32 iMisses = 0;
+		for (TUInt32 iIndex = iStartFace * 3; iIndex < iEndFace * 3; ++iIndex)
+		{
+			TUInt32& iCacheTime = (*pCacheTimes)[pIndices[iIndex]];
+			if (iTime - iCacheTime > iCacheSize)
+			{
+				iCacheTime = iTime++;
+				++iMisses;
+			}
+		}
+
+		// Leave the cache times ready for the next range
+		for (TUInt32 iIndex = iStartFace * 3; iIndex < iEndFace * 3; ++iIndex)
+		{
+			(*pCacheTimes)[pIndices[iIndex]] = 0;
+		}
+		return iMisses;
+	}
+
+
+	// Tipsify - choose the next vertex to fan around. Prefers vertices used by the last fan that
+	// have faces left and will still be in the cache after those faces are output, choosing the
+	// one that has been in the cache longest. Returns ~0u if none is suitable
+	TUInt32 GetNextFanVertex
+	(
+		const vector<TUInt32>& candidates,
+		const vector<TUInt32>& liveFaces,
+		const vector<TUInt32>& cacheTimes,
+		const TUInt32          iTime,
+		const TUInt32          iCacheSize
+	)
+	{
+		TUInt32 iBestVertex = ~0u;
+		TInt32 iBestPriority = -1;
+		for (TUInt32 iCandidate = 0; iCandidate < candidates.size(); ++iCandidate)
+		{
+			TUInt32 iVertex = candidates[iCandidate];
+			if (liveFaces[iVertex] > 0)
+			{
+				TInt32 iPriority = 0;
+				TUInt32 iAge = iTime - cacheTimes[iVertex];
+				if (iAge + 2 * liveFaces[iVertex] <= iCacheSize)
+				{
+					iPriority = static_cast<TInt32>(iAge);
+				}
+				if (iPriority > iBestPriority)
+				{
+					iBestPriority = iPriority;
+					iBestVertex = iVertex;
+				}
+			}
+		}
+		return iBestVertex;
+	}
+
+	// Tipsify - no suitable vertex in the last fan, take the most recent vertex output that still
+	// has faces left, otherwise the next such vertex in input order. Returns ~0u when all faces
+	// have been output
+	TUInt32 SkipDeadEnd
+	(
+		vector<TUInt32>*       pDeadEnds,
+		const vector<TUInt32>& liveFaces,
+		TUInt32*               piCursor
+	)
+	{
+		while (!pDeadEnds->empty())
+		{
+			TUInt32 iVertex = pDeadEnds->back();
+			pDeadEnds->pop_back();
+			if (liveFaces[iVertex] > 0)
+			{
+				return iVertex;
+			}
+		}
+		while (*piCursor < liveFaces.size())
+		{
+			if (liveFaces[*piCursor] > 0)
+			{
+				return *piCursor;
+			}
+			++*piCursor;
+		}
+		return ~0u;
+	}
+
+
+	// Sort key of a cluster for overdraw ordering
+	struct SClusterOrder
+	{
+		TFloat32 fKey;
+		TUInt32  iCluster;
+
+		bool operator<( const SClusterOrder& other ) const
+		{
+			return fKey > other.fKey; // Highest key first
+		}
+	};
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Analysis
+-----------------------------------------------------------------------------------------*/
+
+// Simulate the post-transform vertex cache on a triangle list and return the number of vertices
+// transformed
+SVertexCacheStats AnalyseVertexCache
+(
+	const TUInt32*          pIndices,
+	const TUInt32           iNumFaces,
+	const TUInt32           iNumVertices,
+	const TUInt32           iCacheSize /*= kiDefaultVertexCacheSize*/,
+	const EVertexCacheModel eModel /*= kCacheFIFO*/
+)
+{
+	GEN_GUARD;
+
+	SVertexCacheStats stats;
+	if (eModel == kCacheFIFO)
+	{
+		vector<TUInt32> cacheTimes( iNumVertices, 0 );
+		stats.iNumTransformed = CountFIFOMisses( pIndices, 0, iNumFaces, iCacheSize, &cacheTimes );
+	}
+	else
+	{
+		// Cache held in order of use, most recent first
+		vector<TUInt32> cache;
+		cache.reserve( iCacheSize + 1 );
+		stats.iNumTransformed = 0;
+		for (TUInt32 iIndex = 0; iIndex < iNumFaces * 3; ++iIndex)
+		{
+			vector<TUInt32>::iterator itEntry = find( cache.begin(), cache.end(), pIndices[iIndex] );
+			if (itEntry == cache.end())
+			{
+				++stats.iNumTransformed;
+				if (cache.size() == iCacheSize)
+				{
+					cache.pop_back();
+				}
+				cache.insert( cache.begin(), pIndices[iIndex] );
+			}
+			else
+			{
+				rotate( cache.begin(), itEntry, itEntry + 1 );
+			}
+		}
+	}
+
+	stats.fACMR = iNumFaces ? static_cast<TFloat32>(stats.iNumTransformed) / iNumFaces : 0.0f;
+	stats.fATVR = iNumVertices ? static_cast<TFloat32>(stats.iNumTransformed) / iNumVertices : 0.0f;
+	return stats;
+
+	GEN_ENDGUARD;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Optimisation
+-----------------------------------------------------------------------------------------*/
+
+// Reorder the faces of a triangle list for the post-transform vertex cache using Tipsify
+void OptimiseVertexCache
+(
+	TUInt32*      pIndices,
+	const TUInt32 iNumFaces,
+	const TUInt32 iNumVertices,
+	const TUInt32 iCacheSize /*= kiDefaultVertexCacheSize*/
+)
+{
+	GEN_GUARD;
+
+	if (iNumFaces == 0)
+	{
+		return;
+	}
+
+	// Faces using each vertex - counts, then offsets into a single list
+	vector<TUInt32> liveFaces( iNumVertices, 0 );
+	for (TUInt32 iIndex = 0; iIndex < iNumFaces * 3; ++iIndex)
+	{
+		++liveFaces[pIndices[iIndex]];
+	}
+	vector<TUInt32> faceOffsets( iNumVertices + 1 );
+	faceOffsets[0] = 0;
+	for (TUInt32 iVertex = 0; iVertex < iNumVertices; ++iVertex)
+	{
+		faceOffsets[iVertex + 1] = faceOffsets[iVertex] + liveFaces[iVertex];
+	}
+	vector<TUInt32> vertexFaces( iNumFaces * 3 );
+	{
+		vector<TUInt32> fill( faceOffsets.begin(), faceOffsets.end() - 1 );
+		for (TUInt32 iIndex = 0; iIndex < iNumFaces * 3; ++iIndex)
+		{
+			vertexFaces[fill[pIndices[iIndex]]++] = iIndex / 3;
+		}
+	}
+
+	// Fan around a vertex at a time, outputting all its remaining faces. The cache is simulated
+	// with time stamps as for CountFIFOMisses
+	vector<TUInt32> outIndices;
+	outIndices.reserve( iNumFaces * 3 );
+	vector<TUInt8> faceDone( iNumFaces, 0 );
+	vector<TUInt32> cacheTimes( iNumVertices, 0 );
+	vector<TUInt32> deadEnds;
+	vector<TUInt32> candidates;
+	TUInt32 iTime = iCacheSize + 1;
+	TUInt32 iCursor = 0;
+	TUInt32 iFanVertex = SkipDeadEnd( &deadEnds, liveFaces, &iCursor );
+	while (iFanVertex != ~0u)
+	{
+		candidates.clear();
+		for (TUInt32 iFace = faceOffsets[iFanVertex]; iFace < faceOffsets[iFanVertex + 1]; ++iFace)
+		{
+			TUInt32 iFaceIndex = vertexFaces[iFace];
+			if (!faceDone[iFaceIndex])
+			{
+				faceDone[iFaceIndex] = 1;
+				for (TUInt32 iCorner = 0; iCorner < 3; ++iCorner)
+				{
+					TUInt32 iVertex = pIndices[iFaceIndex * 3 + iCorner];
+					outIndices.push_back( iVertex );
+					deadEnds.push_back( iVertex );
+					candidates.push_back( iVertex );
+					--liveFaces[iVertex];
+					if (iTime - cacheTimes[iVertex] > iCacheSize)
+					{
+						cacheTimes[iVertex] = iTime++;
+					}
+				}
+			}
+		}
+
+		iFanVertex = GetNextFanVertex( candidates, liveFaces, cacheTimes, iTime, iCacheSize );
+		if (iFanVertex == ~0u)
+		{
+			iFanVertex = SkipDeadEnd( &deadEnds, liveFaces, &iCursor );
+		}
+	}
+
+	memcpy( pIndices, outIndices.data(), iNumFaces * 3 * sizeof(TUInt32) );
+
+	GEN_ENDGUARD;
+}
+
+
+// Reorder the clusters of a triangle list to reduce overdraw
+void OptimiseOverdraw
+(
+	TUInt32*       pIndices,
+	const TUInt32  iNumFaces,
+	const TUInt8*  pPositions,
+	const TUInt32  iStride,
+	const TUInt32  iNumVertices,
+	const TFloat32 fThreshold /*= kfDefaultOverdrawThreshold*/,
+	const TUInt32  iCacheSize /*= kiDefaultVertexCacheSize*/
+)
+{
+	GEN_GUARD;
+
+	if (iNumFaces == 0)
+	{
+		return;
+	}
+
+	// A face with no vertices in the cache starts a new part of the mesh, these clusters can be
+	// reordered freely
+	vector<TUInt32> clusters;
+	vector<TUInt32> cacheTimes( iNumVertices, 0 );
+	TUInt32 iTime = iCacheSize + 1;
+	for (TUInt32 iFace = 0; iFace < iNumFaces; ++iFace)
+	{
+		TUInt32 iMisses = 0;
+		for (TUInt32 iCorner = 0; iCorner < 3; ++iCorner)
+		{
+			TUInt32& iCacheTime = cacheTimes[pIndices[iFace * 3 + iCorner]];
+			if (iTime - iCacheTime > iCacheSize)
+			{
+				iCacheTime = iTime++;
+				++iMisses;
+			}
+		}
+		if (iFace == 0 || iMisses == 3)
+		{
+			clusters.push_back( iFace );
+		}
+	}
+	fill( cacheTimes.begin(), cacheTimes.end(), 0 );
+
+	// Split each cluster after the first face where the misses so far are within the threshold of
+	// the whole cluster's miss rate, starting a new cluster there with an empty cache. The last
+	// split of a cluster rarely reaches the threshold, so it is merged with the one before
+	vector<TUInt32> splitClusters;
+	for (TUInt32 iCluster = 0; iCluster < clusters.size(); ++iCluster)
+	{
+		TUInt32 iStart = clusters[iCluster];
+		TUInt32 iEnd = (iCluster + 1 < clusters.size()) ? clusters[iCluster + 1] : iNumFaces;
+		TFloat32 fClusterACMR = static_cast<TFloat32>(CountFIFOMisses( pIndices, iStart, iEnd,
+		                                              iCacheSize, &cacheTimes )) / (iEnd - iStart);
+		TFloat32 fMaxACMR = fClusterACMR * fThreshold;
+
+		splitClusters.push_back( iStart );
+		iTime = iCacheSize + 1;
+		TUInt32 iMisses = 0;
+		TUInt32 iSplitStart = iStart;
+		for (TUInt32 iFace = iStart; iFace < iEnd; ++iFace)
+		{
+			for (TUInt32 iCorner = 0; iCorner < 3; ++iCorner)
+			{
+				TUInt32& iCacheTime = cacheTimes[pIndices[iFace * 3 + iCorner]];
+				if (iTime - iCacheTime > iCacheSize)
+				{
+					iCacheTime = iTime++;
+					++iMisses;
+				}
+			}
+
+			// Split here unless this is the last face
+			if (iFace + 1 < iEnd && iMisses <= fMaxACMR * (iFace + 1 - iSplitStart))
+			{
+				splitClusters.push_back( iFace + 1 );
+				iSplitStart = iFace + 1;
+				iMisses = 0;
+				iTime += iCacheSize + 1; // Empty the cache
+			}
+		}
+		if (iSplitStart != iStart)
+		{
+			splitClusters.pop_back();
+		}
+		for (TUInt32 iIndex = iStart * 3; iIndex < iEnd * 3; ++iIndex)
+		{
+			cacheTimes[pIndices[iIndex]] = 0;
+		}
+	}
+
+	// Area-weighted centre of the whole mesh and of each cluster, and the area-weighted normal of
+	// each cluster. The cross product of a face's edges points out of the front face for
+	// clockwise faces in a left-handed system, as for counter-clockwise in a right-handed one
+	TUInt32 iNumClusters = static_cast<TUInt32>(splitClusters.size());
+	vector<CVector3> clusterCentres( iNumClusters, CVector3( 0.0f, 0.0f, 0.0f ) );
+	vector<CVector3> clusterNormals( iNumClusters, CVector3( 0.0f, 0.0f, 0.0f ) );
+	vector<TFloat32> clusterAreas( iNumClusters, 0.0f );
+	CVector3 meshCentre( 0.0f, 0.0f, 0.0f );
+	TFloat32 fMeshArea = 0.0f;
+	for (TUInt32 iCluster = 0; iCluster < iNumClusters; ++iCluster)
+	{
+		TUInt32 iEnd = (iCluster + 1 < iNumClusters) ? splitClusters[iCluster + 1] : iNumFaces;
+		for (TUInt32 iFace = splitClusters[iCluster]; iFace < iEnd; ++iFace)
+		{
+			const CVector3& p0 = *reinterpret_cast<const CVector3*>(pPositions + pIndices[iFace * 3] * iStride);
+			const CVector3& p1 = *reinterpret_cast<const CVector3*>(pPositions + pIndices[iFace * 3 + 1] * iStride);
+			const CVector3& p2 = *reinterpret_cast<const CVector3*>(pPositions + pIndices[iFace * 3 + 2] * iStride);
+			CVector3 normal = Cross( p1 - p0, p2 - p0 );
+			TFloat32 fArea = normal.Length();
+			CVector3 centre = (p0 + p1 + p2) * (fArea / 3.0f);
+			clusterCentres[iCluster] += centre;
+			clusterNormals[iCluster] += normal;
+			clusterAreas[iCluster] += fArea;
+			meshCentre += centre;
+			fMeshArea += fArea;
+		}
+	}
+	if (fMeshArea > 0.0f)
+	{
+		meshCentre /= fMeshArea;
+	}
+
+	// Sort on how far each cluster faces out from the centre of the mesh, keeping the cache order
+	// for clusters with the same key
+	vector<SClusterOrder> order( iNumClusters );
+	for (TUInt32 iCluster = 0; iCluster < iNumClusters; ++iCluster)
+	{
+		order[iCluster].iCluster = iCluster;
+		order[iCluster].fKey = 0.0f;
+		TFloat32 fNormalLength = clusterNormals[iCluster].Length();
+		if (clusterAreas[iCluster] > 0.0f && fNormalLength > 0.0f)
+		{
+			CVector3 offset = clusterCentres[iCluster] / clusterAreas[iCluster] - meshCentre;
+			order[iCluster].fKey = Dot( offset, clusterNormals[iCluster] ) / fNormalLength;
+		}
+	}
+	stable_sort( order.begin(), order.end() );
+
+	// Write the faces in cluster order
+	vector<TUInt32> outIndices;
+	outIndices.reserve( iNumFaces * 3 );
+	for (TUInt32 iOrder = 0; iOrder < iNumClusters; ++iOrder)
+	{
+		TUInt32 iCluster = order[iOrder].iCluster;
+		TUInt32 iEnd = (iCluster + 1 < iNumClusters) ? splitClusters[iCluster + 1] : iNumFaces;
+		outIndices.insert( outIndices.end(), pIndices + splitClusters[iCluster] * 3, pIndices + iEnd * 3 );
+	}
+	memcpy( pIndices, outIndices.data(), iNumFaces * 3 * sizeof(TUInt32) );
+
+	GEN_ENDGUARD;
+}
+
+
+// Reorder vertices into the order they are first used by the faces, and renumber the faces
+void OptimiseVertexFetch
+(
+	TUInt8*       pVertices,
+	const TUInt32 iVertexSize,
+	const TUInt32 iNumVertices,
+	TUInt32*      pIndices,
+	const TUInt32 iNumFaces
+)
+{
+	GEN_GUARD;
+
+	// New number for each vertex, ~0u until it is used
+	vector<TUInt32> remap( iNumVertices, ~0u );
+	TUInt32 iNextVertex = 0;
+	for (TUInt32 iIndex = 0; iIndex < iNumFaces * 3; ++iIndex)
+	{
+		TUInt32& iNewVertex = remap[pIndices[iIndex]];
+		if (iNewVertex == ~0u)
+		{
+			iNewVertex = iNextVertex++;
+		}
+		pIndices[iIndex] = iNewVertex;
+	}
+
+	// Unused vertices follow in their original order
+	for (TUInt32 iVertex = 0; iVertex < iNumVertices; ++iVertex)
+	{
+		if (remap[iVertex] == ~0u)
+		{
+			remap[iVertex] = iNextVertex++;
+		}
+	}
+
+	vector<TUInt8> vertices( pVertices, pVertices + iNumVertices * iVertexSize );
+	for (TUInt32 iVertex = 0; iVertex < iNumVertices; ++iVertex)
+	{
+		memcpy( pVertices + remap[iVertex] * iVertexSize, &vertices[iVertex * iVertexSize], iVertexSize );
+	}
+
+	GEN_ENDGUARD;
+}
+
+
+// Optimise a sub-mesh for the vertex cache, overdraw and vertex fetch
+void OptimiseSubMesh
+(
+	const SSubMesh& subMesh,
+	const TFloat32  fOverdrawThreshold /*= kfDefaultOverdrawThreshold*/,
+	const TUInt32   iCacheSize /*= kiDefaultVertexCacheSize*/
+)
+{
+	GEN_GUARD;
+
+	vector<TUInt32> indices;
+	GetSubMeshIndices( subMesh, &indices );
+
+	// Keep the original order if it was better for the cache
+	vector<TUInt32> optimised( indices );
+	OptimiseVertexCache( optimised.data(), subMesh.numFaces, subMesh.numVertices, iCacheSize );
+	TUInt32 iMisses = AnalyseVertexCache( indices.data(), subMesh.numFaces, subMesh.numVertices,
+	                                      iCacheSize ).iNumTransformed;
+	TUInt32 iOptimisedMisses = AnalyseVertexCache( optimised.data(), subMesh.numFaces,
+	                                               subMesh.numVertices, iCacheSize ).iNumTransformed;
+	if (iOptimisedMisses < iMisses)
+	{
+		indices.swap( optimised );
+		iMisses = iOptimisedMisses;
+	}
+
+	// Keep the overdraw order only if the cache misses are within the threshold. Vertex position
+	// is always first in the vertex
+	if (fOverdrawThreshold != 0.0f)
+	{
+		optimised = indices;
+		OptimiseOverdraw( optimised.data(), subMesh.numFaces, subMesh.vertices, subMesh.vertexSize,
+		                  subMesh.numVertices, fOverdrawThreshold, iCacheSize );
+		iOptimisedMisses = AnalyseVertexCache( optimised.data(), subMesh.numFaces,
+		                                       subMesh.numVertices, iCacheSize ).iNumTransformed;
+		if (iOptimisedMisses <= iMisses * fOverdrawThreshold)
+		{
+			indices.swap( optimised );
+		}
+	}
+
+	OptimiseVertexFetch( subMesh.vertices, subMesh.vertexSize, subMesh.numVertices,
+	                     indices.data(), subMesh.numFaces );
+
+	SetSubMeshIndices( subMesh, indices );
+
+	GEN_ENDGUARD;
+}
+
+
+} // namespace gen
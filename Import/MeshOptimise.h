@@ -0,0 +1,123 @@
+/**************************************************************************************************
+	Module:       MeshOptimise.h
+	Date created: 18/10/26
+
+	Optimisation of indexed triangle meshes for the GPU - triangle order for the post-transform
+	vertex cache and for overdraw, vertex order for vertex fetch - and analysis of vertex cache use
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#ifndef GEN_MESH_OPTIMISE_H_INCLUDED
+#define GEN_MESH_OPTIMISE_H_INCLUDED
+
+#include <vector>
+using namespace std;
+
+#include "GenDefines.h"
+#include "MeshData.h"
+
+namespace gen
+{
+
+// Cache size used when none is given. Triangles ordered for a cache of this size also do well on
+// larger caches
+const TUInt32 kiDefaultVertexCacheSize = 16;
+
+// Maximum increase in vertex cache misses allowed when ordering triangles to reduce overdraw,
+// e.g. 1.05 allows 5% more misses
+const TFloat32 kfDefaultOverdrawThreshold = 1.05f;
+
+
+/////////////////////////////////////
+// Analysis
+
+// Replacement policy of the simulated vertex cache
+enum EVertexCacheModel
+{
+	kCacheFIFO, // Oldest vertex replaced, hits do not change the order (most fixed-function GPUs)
+	kCacheLRU,  // Least recently used vertex replaced
+};
+
+// Vertex cache use of an index buffer
+struct SVertexCacheStats
+{
+	TUInt32  iNumTransformed; // Vertices transformed (cache misses)
+	TFloat32 fACMR;           // Average cache miss ratio - transformed vertices per face, from
+	                          // 3 (no reuse) down to about 0.5 for a large regular mesh
+	TFloat32 fATVR;           // Average transformed vertex ratio - transformed vertices per vertex,
+	                          // 1 is ideal (each vertex transformed once)
+};
+
+// Simulate the post-transform vertex cache on a triangle list and return the number of vertices
+// transformed. The cache is empty at the start
+SVertexCacheStats AnalyseVertexCache
+(
+	const TUInt32*          pIndices,    // Three per face
+	const TUInt32           iNumFaces,
+	const TUInt32           iNumVertices,
+	const TUInt32           iCacheSize = kiDefaultVertexCacheSize,
+	const EVertexCacheModel eModel = kCacheFIFO
+);
+
+
+/////////////////////////////////////
+// Optimisation
+
+// Reorder the faces of a triangle list so vertices are reused from the post-transform vertex
+// cache, using the Tipsify algorithm (Sander, Nehab & Barczak 2007), which is linear in the size
+// of the mesh. Faces are not changed, only their order
+void OptimiseVertexCache
+(
+	TUInt32*      pIndices,              // Three per face, reordered in place
+	const TUInt32 iNumFaces,
+	const TUInt32 iNumVertices,
+	const TUInt32 iCacheSize = kiDefaultVertexCacheSize
+);
+
+// Reorder clusters of faces in a triangle list already ordered for the vertex cache to reduce
+// overdraw. A cluster starts at each face with no vertices in the cache, then is split into
+// smaller clusters wherever its cache misses so far are within the given ratio of the whole
+// cluster's (e.g. 1.05), giving more freedom to reorder for a small loss of cache efficiency.
+// Clusters facing out from the centre of the mesh are drawn first, as they are most likely to
+// hide the others
+void OptimiseOverdraw
+(
+	TUInt32*       pIndices,             // Three per face, reordered in place
+	const TUInt32  iNumFaces,
+	const TUInt8*  pPositions,           // Vertex positions (CVector3), at the given stride
+	const TUInt32  iStride,
+	const TUInt32  iNumVertices,
+	const TFloat32 fThreshold = kfDefaultOverdrawThreshold,
+	const TUInt32  iCacheSize = kiDefaultVertexCacheSize
+);
+
+// Reorder vertices into the order they are first used by the faces, so vertex fetches move
+// steadily through memory, and renumber the faces to match. Vertices not used by any face are
+// moved to the end
+void OptimiseVertexFetch
+(
+	TUInt8*       pVertices,             // Reordered in place
+	const TUInt32 iVertexSize,
+	const TUInt32 iNumVertices,
+	TUInt32*      pIndices,              // Three per face, renumbered in place
+	const TUInt32 iNumFaces
+);
+
+// Optimise a sub-mesh for the vertex cache, then for overdraw if the threshold is not 0 (see
+// OptimiseOverdraw) and finally for vertex fetch. The vertex and face data is changed in place,
+// the number of vertices and faces and the index size are unchanged. A face order that would
+// have more cache misses than the original (or more than the threshold allows for overdraw) is
+// not used, so meshes exported in a good order are not made worse
+void OptimiseSubMesh
+(
+	const SSubMesh& subMesh,
+	const TFloat32  fOverdrawThreshold = kfDefaultOverdrawThreshold,
+	const TUInt32   iCacheSize = kiDefaultVertexCacheSize
+);
+
+
+} // namespace gen
+
+#endif // GEN_MESH_OPTIMISE_H_INCLUDED
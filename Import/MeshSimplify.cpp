@@ -0,0 +1,1042 @@
+/**************************************************************************************************
+	Module:       MeshSimplify.cpp
+	Date created: 18/10/26
+
+	Simplification of indexed triangle meshes by edge collapse with quadric error metrics, chains
+	of levels of detail built from it and selection of a level from the size of a model on screen
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include "MeshSimplify.h"
+#include "MeshOptimise.h"
+#include "CVector3.h"
+#include "Error.h"
+
+namespace gen
+{
+
+namespace
+{
+	// Read the faces of a sub-mesh as 32-bit indices
+	void GetSubMeshIndices
+	(
+		const SSubMesh&  subMesh,
+		vector<TUInt32>* pIndices
+	)
+	{
+		TUInt32 iNumIndices = subMesh.numFaces * 3;
+		pIndices->resize( iNumIndices );
+		if (subMesh.indexSize == sizeof(TUInt32))
+		{
+			memcpy( pIndices->data(), subMesh.faces, iNumIndices * sizeof(TUInt32) );
+		}
+		else
+		{
+			const TUInt16* pIndex16 = reinterpret_cast<const TUInt16*>(subMesh.faces);
+			for (TUInt32 iIndex = 0; iIndex < iNumIndices; ++iIndex)
+			{
+				(*pIndices)[iIndex] = pIndex16[iIndex];
+			}
+		}
+	}
+
+
+	// How a vertex may collapse, depending on the faces and other vertices at its position
+	enum EVertexKind
+	{
+		kVertexManifold, // The only vertex at its position, surrounded by faces - may collapse anywhere
+		kVertexBorder,   // The only vertex at its position, on the border of the mesh - may only
+		                 // collapse along the border
+		kVertexSeam,     // One of two vertices at its position with different attributes - may only
+		                 // collapse along the seam, together with the other vertex
+		kVertexLocked,   // Any other case, e.g. a corner of a seam - does not collapse
+	};
+
+	// Edge weight relative to face area for the quadrics that keep borders and seams in place
+	const TFloat64 kfBoundaryWeight = 10.0;
+
+	// Each pass collapses edges with error up to this multiple of the error of the last edge
+	// needed to reach the target - allows fewer, larger passes
+	const TFloat64 kfPassErrorBound = 1.5;
+
+	// A collapse that turns a face through more than about 89 degrees is treated as flipping it
+	const TFloat32 kfFlipThreshold = 1e-2f;
+
+	// Most cells along each side of the grid used to find the faces near a point
+	const TInt32 kiMaxErrorGridSize = 64;
+
+	// A level of detail is only kept if it has at most this fraction of the previous level's faces
+	const TFloat32 kfMinLODReduction = 0.8f;
+
+
+	// Quadric error metric - a symmetric matrix A, a vector b and a constant c giving the sum of
+	// weighted squared distances of a point p from a set of planes: p.A.p + 2b.p + c. The total
+	// weight is kept so the error can be given as an average squared distance
+	struct SQuadric
+	{
+		TFloat64 a00, a11, a22, a10, a20, a21;
+		TFloat64 b0, b1, b2;
+		TFloat64 c;
+		TFloat64 w;
+	};
+
+	// Add a plane n.p + d = 0 (n unit length) with the given weight to a quadric
+	void AddPlane
+	(
+		SQuadric*       pQuadric,
+		const CVector3& normal,
+		const TFloat32  fD,
+		const TFloat64  fWeight
+	)
+	{
+		TFloat64 x = normal.x, y = normal.y, z = normal.z, d = fD;
+		pQuadric->a00 += fWeight * x * x;
+		pQuadric->a11 += fWeight * y * y;
+		pQuadric->a22 += fWeight * z * z;
+		pQuadric->a10 += fWeight * y * x;
+		pQuadric->a20 += fWeight * z * x;
+		pQuadric->a21 += fWeight * z * y;
+		pQuadric->b0 += fWeight * x * d;
+		pQuadric->b1 += fWeight * y * d;
+		pQuadric->b2 += fWeight * z * d;
+		pQuadric->c += fWeight * d * d;
+		pQuadric->w += fWeight;
+	}
+
+	void AddQuadric
+	(
+		SQuadric*       pQuadric,
+		const SQuadric& other
+	)
+	{
+		pQuadric->a00 += other.a00;
+		pQuadric->a11 += other.a11;
+		pQuadric->a22 += other.a22;
+		pQuadric->a10 += other.a10;
+		pQuadric->a20 += other.a20;
+		pQuadric->a21 += other.a21;
+		pQuadric->b0 += other.b0;
+		pQuadric->b1 += other.b1;
+		pQuadric->b2 += other.b2;
+		pQuadric->c += other.c;
+		pQuadric->w += other.w;
+	}
+
+	// Average squared distance of a point from the planes of a quadric
+	TFloat64 QuadricError
+	(
+		const SQuadric& quadric,
+		const CVector3& point
+	)
+	{
+		TFloat64 x = point.x, y = point.y, z = point.z;
+		TFloat64 rx = quadric.a00 * x + quadric.a10 * y + quadric.a20 * z + 2.0 * quadric.b0;
+		TFloat64 ry = quadric.a10 * x + quadric.a11 * y + quadric.a21 * z + 2.0 * quadric.b1;
+		TFloat64 rz = quadric.a20 * x + quadric.a21 * y + quadric.a22 * z + 2.0 * quadric.b2;
+		TFloat64 fError = fabs( rx * x + ry * y + rz * z + quadric.c );
+		return quadric.w > 0.0 ? fError / quadric.w : fError;
+	}
+
+
+	// Lists of items for each vertex held in a single array - the items for vertex v are
+	// items[offsets[v]] to items[offsets[v + 1] - 1]
+	struct SVertexLists
+	{
+		vector<TUInt32> offsets;
+		vector<TUInt32> items;
+	};
+
+	// Get the vertices each vertex has a directed edge to (edges a->b, b->c and c->a of each face)
+	void GetVertexEdges
+	(
+		const TUInt32* pIndices,
+		const TUInt32  iNumFaces,
+		const TUInt32  iNumVertices,
+		SVertexLists*  pEdges
+	)
+	{
+		pEdges->offsets.assign( iNumVertices + 1, 0 );
+		for (TUInt32 iIndex = 0; iIndex < iNumFaces * 3; ++iIndex)
+		{
+			++pEdges->offsets[pIndices[iIndex] + 1];
+		}
+		for (TUInt32 iVertex = 0; iVertex < iNumVertices; ++iVertex)
+		{
+			pEdges->offsets[iVertex + 1] += pEdges->offsets[iVertex];
+		}
+		pEdges->items.resize( iNumFaces * 3 );
+		vector<TUInt32> fill( pEdges->offsets.begin(), pEdges->offsets.end() - 1 );
+		for (TUInt32 iFace = 0; iFace < iNumFaces; ++iFace)
+		{
+			for (TUInt32 iCorner = 0; iCorner < 3; ++iCorner)
+			{
+				TUInt32 iFrom = pIndices[iFace * 3 + iCorner];
+				TUInt32 iTo = pIndices[iFace * 3 + (iCorner + 1) % 3];
+				pEdges->items[fill[iFrom]++] = iTo;
+			}
+		}
+	}
+
+	// Get the faces using each vertex
+	void GetVertexFaces
+	(
+		const TUInt32* pIndices,
+		const TUInt32  iNumFaces,
+		const TUInt32  iNumVertices,
+		SVertexLists*  pFaces
+	)
+	{
+		pFaces->offsets.assign( iNumVertices + 1, 0 );
+		for (TUInt32 iIndex = 0; iIndex < iNumFaces * 3; ++iIndex)
+		{
+			++pFaces->offsets[pIndices[iIndex] + 1];
+		}
+		for (TUInt32 iVertex = 0; iVertex < iNumVertices; ++iVertex)
+		{
+			pFaces->offsets[iVertex + 1] += pFaces->offsets[iVertex];
+		}
+		pFaces->items.resize( iNumFaces * 3 );
+		vector<TUInt32> fill( pFaces->offsets.begin(), pFaces->offsets.end() - 1 );
+		for (TUInt32 iIndex = 0; iIndex < iNumFaces * 3; ++iIndex)
+		{
+			pFaces->items[fill[pIndices[iIndex]]++] = iIndex / 3;
+		}
+	}
+
+	// Is there a directed edge from one vertex to another
+	bool HasEdge
+	(
+		const SVertexLists& edges,
+		const TUInt32       iFrom,
+		const TUInt32       iTo
+	)
+	{
+		for (TUInt32 iEdge = edges.offsets[iFrom]; iEdge < edges.offsets[iFrom + 1]; ++iEdge)
+		{
+			if (edges.items[iEdge] == iTo)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Is the edge between two vertices used by faces on one side only - a border of the mesh or a
+	// seam between vertices with different attributes
+	bool IsOpenEdge
+	(
+		const SVertexLists& edges,
+		const TUInt32       iVertex0,
+		const TUInt32       iVertex1
+	)
+	{
+		return HasEdge( edges, iVertex0, iVertex1 ) != HasEdge( edges, iVertex1, iVertex0 );
+	}
+
+
+	// Squared distance from a point to the nearest point of a triangle, using the regions of the
+	// triangle's plane as in Ericson, Real-Time Collision Detection (2005)
+	TFloat32 PointTriangleDistanceSquared
+	(
+		const CVector3& p,
+		const CVector3& a,
+		const CVector3& b,
+		const CVector3& c
+	)
+	{
+		CVector3 ab = b - a, ac = c - a, ap = p - a;
+		TFloat32 d1 = Dot( ab, ap ), d2 = Dot( ac, ap );
+		if (d1 <= 0.0f && d2 <= 0.0f) return ap.LengthSquared();
+
+		CVector3 bp = p - b;
+		TFloat32 d3 = Dot( ab, bp ), d4 = Dot( ac, bp );
+		if (d3 >= 0.0f && d4 <= d3) return bp.LengthSquared();
+
+		TFloat32 vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+		{
+			return (ap - ab * (d1 / (d1 - d3))).LengthSquared();
+		}
+
+		CVector3 cp = p - c;
+		TFloat32 d5 = Dot( ab, cp ), d6 = Dot( ac, cp );
+		if (d6 >= 0.0f && d5 <= d6) return cp.LengthSquared();
+
+		TFloat32 vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+		{
+			return (ap - ac * (d2 / (d2 - d6))).LengthSquared();
+		}
+
+		TFloat32 va = d3 * d6 - d5 * d4;
+		if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+		{
+			return (bp - (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)))).LengthSquared();
+		}
+
+		TFloat32 fDenom = va + vb + vc;
+		if (fDenom <= 0.0f) // Degenerate triangle
+		{
+			return Min( ap.LengthSquared(), Min( bp.LengthSquared(), cp.LengthSquared() ) );
+		}
+		return (ap - ab * (vb / fDenom) - ac * (vc / fDenom)).LengthSquared();
+	}
+
+
+	// Cell of a grid over 0-1 holding the given coordinate, clamped to the grid
+	TInt32 GetGridCell
+	(
+		const TFloat32 fCoord,
+		const TInt32   iGridSize
+	)
+	{
+		if (fCoord <= 0.0f)
+		{
+			return 0;
+		}
+		TInt32 iCell = fCoord < 1.0f ? static_cast<TInt32>(fCoord * iGridSize) : iGridSize;
+		return iCell < iGridSize ? iCell : iGridSize - 1;
+	}
+
+
+	// Compare vertices by position for sorting
+	struct SPositionLess
+	{
+		const vector<CVector3>* pPositions;
+
+		bool operator()( const TUInt32 iVertex0, const TUInt32 iVertex1 ) const
+		{
+			const CVector3& p0 = (*pPositions)[iVertex0];
+			const CVector3& p1 = (*pPositions)[iVertex1];
+			if (p0.x != p1.x) return p0.x < p1.x;
+			if (p0.y != p1.y) return p0.y < p1.y;
+			if (p0.z != p1.z) return p0.z < p1.z;
+			return iVertex0 < iVertex1;
+		}
+	};
+
+	// A possible collapse of one vertex onto another
+	struct SCollapse
+	{
+		TUInt32  iVertex;
+		TUInt32  iTarget;
+		TFloat64 fError;
+
+		bool operator<( const SCollapse& other ) const
+		{
+			return fError < other.fError;
+		}
+	};
+
+
+	// State of a mesh being simplified
+	class CSimplifier
+	{
+		GEN_CLASS( CSimplifier )
+
+	public:
+		CSimplifier
+		(
+			TUInt32*      pIndices,
+			const TUInt32 iNumFaces,
+			const TUInt8* pPositions,
+			const TUInt32 iStride,
+			const TUInt32 iNumVertices
+		) : m_pIndices( pIndices ), m_iNumFaces( iNumFaces ), m_iNumVertices( iNumVertices )
+		{
+			GetPositions( pPositions, iStride );
+			GetPositionRemap();
+			GetVertexEdges( m_pIndices, m_iNumFaces, m_iNumVertices, &m_Edges );
+			ClassifyVertices();
+			GetQuadrics();
+		}
+
+		// Simplify towards the target, returns the number of faces left
+		TUInt32 Simplify
+		(
+			const TUInt32  iTargetFaces,
+			const TFloat32 fTargetError,
+			TFloat32*      pfError
+		);
+
+	private:
+		void GetPositions( const TUInt8* pPositions, const TUInt32 iStride );
+		void GetPositionRemap();
+		void ClassifyVertices();
+		void GetQuadrics();
+
+		bool CanCollapse( const TUInt32 iVertex, const TUInt32 iTarget ) const;
+		TUInt32 GetSeamTarget( const TUInt32 iVertex, const TUInt32 iTarget ) const;
+		bool FlipsFaces( const TUInt32 iVertex, const TUInt32 iTarget, TUInt32* piCollapsedFaces ) const;
+		TUInt32 RemoveFaces( const vector<TUInt32>& collapseRemap );
+		TFloat32 MeasureError();
+
+		// Faces being simplified
+		TUInt32* m_pIndices;
+		TUInt32  m_iNumFaces;
+		TUInt32  m_iNumVertices;
+
+		// Positions scaled to fit a unit box, and the scale used
+		vector<CVector3> m_Positions;
+		TFloat32         m_fScale;
+
+		// First vertex with the same position as each vertex, and a circular list of the other
+		// vertices with that position (a vertex on its own refers to itself)
+		vector<TUInt32> m_PositionRemap;
+		vector<TUInt32> m_Wedges;
+
+		vector<TUInt8>  m_Kinds;    // EVertexKind of each vertex
+		vector<SQuadric> m_Quadrics; // At each position (indexed by m_PositionRemap)
+
+		// Current edges and faces around each vertex
+		SVertexLists m_Edges;
+		SVertexLists m_Faces;
+
+		// Vertex each vertex has collapsed onto, itself if it has not
+		vector<TUInt32> m_Collapsed;
+
+		// Disallow use of copy constructor and assignment operator (private and not defined)
+		CSimplifier( const CSimplifier& );
+		CSimplifier& operator=( const CSimplifier& );
+	};
+
+
+	// Copy the positions, scaled so the largest side of the bounding box is 1. Keeps the quadric
+	// arithmetic in a similar range for meshes of any size
+	void CSimplifier::GetPositions( const TUInt8* pPositions, const TUInt32 iStride )
+	{
+		m_Positions.resize( m_iNumVertices );
+		CVector3 minBound( 0.0f, 0.0f, 0.0f ), maxBound( 0.0f, 0.0f, 0.0f );
+		for (TUInt32 iVertex = 0; iVertex < m_iNumVertices; ++iVertex)
+		{
+			const CVector3& position = *reinterpret_cast<const CVector3*>(pPositions + iVertex * iStride);
+			m_Positions[iVertex] = position;
+			if (iVertex == 0)
+			{
+				minBound = maxBound = position;
+			}
+			minBound.x = Min( minBound.x, position.x ); maxBound.x = Max( maxBound.x, position.x );
+			minBound.y = Min( minBound.y, position.y ); maxBound.y = Max( maxBound.y, position.y );
+			minBound.z = Min( minBound.z, position.z ); maxBound.z = Max( maxBound.z, position.z );
+		}
+		TFloat32 fExtent = Max( maxBound.x - minBound.x, Max( maxBound.y - minBound.y, maxBound.z - minBound.z ) );
+		m_fScale = fExtent > 0.0f ? 1.0f / fExtent : 1.0f;
+		for (TUInt32 iVertex = 0; iVertex < m_iNumVertices; ++iVertex)
+		{
+			m_Positions[iVertex] = (m_Positions[iVertex] - minBound) * m_fScale;
+		}
+	}
+
+	// Find the vertices sharing each position - the import splits vertices where faces meeting at
+	// a point have different normals or UVs
+	void CSimplifier::GetPositionRemap()
+	{
+		vector<TUInt32> order( m_iNumVertices );
+		for (TUInt32 iVertex = 0; iVertex < m_iNumVertices; ++iVertex)
+		{
+			order[iVertex] = iVertex;
+		}
+		SPositionLess positionLess = { &m_Positions };
+		sort( order.begin(), order.end(), positionLess );
+
+		m_PositionRemap.resize( m_iNumVertices );
+		m_Wedges.resize( m_iNumVertices );
+		TUInt32 iStart = 0;
+		while (iStart < m_iNumVertices)
+		{
+			TUInt32 iEnd = iStart + 1;
+			const CVector3& position = m_Positions[order[iStart]];
+			while (iEnd < m_iNumVertices && m_Positions[order[iEnd]].x == position.x &&
+			       m_Positions[order[iEnd]].y == position.y && m_Positions[order[iEnd]].z == position.z)
+			{
+				++iEnd;
+			}
+			for (TUInt32 iOrder = iStart; iOrder < iEnd; ++iOrder)
+			{
+				m_PositionRemap[order[iOrder]] = order[iStart];
+				m_Wedges[order[iOrder]] = order[iOrder + 1 < iEnd ? iOrder + 1 : iStart];
+			}
+			iStart = iEnd;
+		}
+	}
+
+	// Decide how each vertex may collapse from its open edges and the other vertices at its position
+	void CSimplifier::ClassifyVertices()
+	{
+		// The single open edge into and out of each vertex - ~0u for none, ~1u for more than one
+		vector<TUInt32> openIn( m_iNumVertices, ~0u );
+		vector<TUInt32> openOut( m_iNumVertices, ~0u );
+		for (TUInt32 iVertex = 0; iVertex < m_iNumVertices; ++iVertex)
+		{
+			for (TUInt32 iEdge = m_Edges.offsets[iVertex]; iEdge < m_Edges.offsets[iVertex + 1]; ++iEdge)
+			{
+				TUInt32 iTarget = m_Edges.items[iEdge];
+				if (!HasEdge( m_Edges, iTarget, iVertex ))
+				{
+					openOut[iVertex] = (openOut[iVertex] == ~0u || openOut[iVertex] == iTarget) ? iTarget : ~1u;
+					openIn[iTarget] = (openIn[iTarget] == ~0u || openIn[iTarget] == iVertex) ? iVertex : ~1u;
+				}
+			}
+		}
+
+		m_Kinds.resize( m_iNumVertices );
+		for (TUInt32 iVertex = 0; iVertex < m_iNumVertices; ++iVertex)
+		{
+			TUInt32 iWedge = m_Wedges[iVertex];
+			if (iWedge == iVertex)
+			{
+				if (openIn[iVertex] == ~0u && openOut[iVertex] == ~0u)
+				{
+					m_Kinds[iVertex] = kVertexManifold;
+				}
+				else if (openIn[iVertex] < ~1u && openOut[iVertex] < ~1u)
+				{
+					m_Kinds[iVertex] = kVertexBorder;
+				}
+				else
+				{
+					m_Kinds[iVertex] = kVertexLocked;
+				}
+			}
+			else if (m_Wedges[iWedge] == iVertex && openIn[iVertex] < ~1u && openOut[iVertex] < ~1u &&
+			         openIn[iWedge] < ~1u && openOut[iWedge] < ~1u &&
+			         m_PositionRemap[openOut[iVertex]] == m_PositionRemap[openIn[iWedge]] &&
+			         m_PositionRemap[openIn[iVertex]] == m_PositionRemap[openOut[iWedge]])
+			{
+				// Two vertices whose open edges run along the same line in opposite directions
+				m_Kinds[iVertex] = kVertexSeam;
+			}
+			else
+			{
+				m_Kinds[iVertex] = kVertexLocked;
+			}
+		}
+	}
+
+	// Sum the planes of the faces around each position, weighted by face area, plus planes at
+	// right angles to the faces through each open edge to hold borders and seams in place
+	void CSimplifier::GetQuadrics()
+	{
+		SQuadric zero;
+		memset( &zero, 0, sizeof(zero) );
+		m_Quadrics.assign( m_iNumVertices, zero );
+		for (TUInt32 iFace = 0; iFace < m_iNumFaces; ++iFace)
+		{
+			const TUInt32* pFace = m_pIndices + iFace * 3;
+			CVector3 normal = Cross( m_Positions[pFace[1]] - m_Positions[pFace[0]],
+			                         m_Positions[pFace[2]] - m_Positions[pFace[0]] );
+			TFloat32 fLength = normal.Length();
+			if (fLength == 0.0f)
+			{
+				continue;
+			}
+			normal /= fLength;
+			TFloat32 fD = -Dot( normal, m_Positions[pFace[0]] );
+			for (TUInt32 iCorner = 0; iCorner < 3; ++iCorner)
+			{
+				AddPlane( &m_Quadrics[m_PositionRemap[pFace[iCorner]]], normal, fD, fLength * 0.5f );
+			}
+
+			for (TUInt32 iCorner = 0; iCorner < 3; ++iCorner)
+			{
+				TUInt32 iVertex0 = pFace[iCorner];
+				TUInt32 iVertex1 = pFace[(iCorner + 1) % 3];
+				if (HasEdge( m_Edges, iVertex1, iVertex0 ))
+				{
+					continue;
+				}
+				CVector3 edge = m_Positions[iVertex1] - m_Positions[iVertex0];
+				CVector3 edgeNormal = Cross( edge, normal );
+				TFloat32 fEdgeLength = edgeNormal.Length();
+				if (fEdgeLength == 0.0f)
+				{
+					continue;
+				}
+				edgeNormal /= fEdgeLength;
+				TFloat32 fEdgeD = -Dot( edgeNormal, m_Positions[iVertex0] );
+				TFloat64 fWeight = fEdgeLength * fEdgeLength * kfBoundaryWeight;
+				AddPlane( &m_Quadrics[m_PositionRemap[iVertex0]], edgeNormal, fEdgeD, fWeight );
+				AddPlane( &m_Quadrics[m_PositionRemap[iVertex1]], edgeNormal, fEdgeD, fWeight );
+			}
+		}
+	}
+
+
+	// Can a vertex collapse onto another with the current faces
+	bool CSimplifier::CanCollapse( const TUInt32 iVertex, const TUInt32 iTarget ) const
+	{
+		switch (m_Kinds[iVertex])
+		{
+			case kVertexManifold:
+				return true;
+
+			case kVertexBorder:
+				return IsOpenEdge( m_Edges, iVertex, iTarget );
+
+			case kVertexSeam:
+				return m_Kinds[iTarget] != kVertexManifold && IsOpenEdge( m_Edges, iVertex, iTarget ) &&
+				       GetSeamTarget( iVertex, iTarget ) != ~0u;
+
+			default:
+				return false;
+		}
+	}
+
+	// Get the vertex on the other side of a seam that the other vertex at a seam vertex's position
+	// collapses onto when the seam vertex collapses onto the given target. Returns ~0u if there is
+	// none, e.g. if the seam has a different shape on each side
+	TUInt32 CSimplifier::GetSeamTarget( const TUInt32 iVertex, const TUInt32 iTarget ) const
+	{
+		TUInt32 iWedge = m_Wedges[iVertex];
+		TUInt32 iWedgeTarget = m_Wedges[iTarget];
+		while (iWedgeTarget != iTarget)
+		{
+			if (IsOpenEdge( m_Edges, iWedge, iWedgeTarget ))
+			{
+				return iWedgeTarget;
+			}
+			iWedgeTarget = m_Wedges[iWedgeTarget];
+		}
+		return ~0u;
+	}
+
+	// Would collapsing a vertex onto another turn any face round. Also returns the number of faces
+	// the collapse removes
+	bool CSimplifier::FlipsFaces( const TUInt32 iVertex, const TUInt32 iTarget, TUInt32* piCollapsedFaces ) const
+	{
+		const CVector3& target = m_Positions[iTarget];
+		for (TUInt32 iFace = m_Faces.offsets[iVertex]; iFace < m_Faces.offsets[iVertex + 1]; ++iFace)
+		{
+			const TUInt32* pFace = m_pIndices + m_Faces.items[iFace] * 3;
+			if (pFace[0] == iTarget || pFace[1] == iTarget || pFace[2] == iTarget)
+			{
+				++*piCollapsedFaces;
+				continue;
+			}
+
+			// Rotate the face so the collapsing vertex is first
+			TUInt32 iCorner = pFace[0] == iVertex ? 0 : (pFace[1] == iVertex ? 1 : 2);
+			const CVector3& p0 = m_Positions[iVertex];
+			const CVector3& p1 = m_Positions[pFace[(iCorner + 1) % 3]];
+			const CVector3& p2 = m_Positions[pFace[(iCorner + 2) % 3]];
+			CVector3 normal0 = Cross( p1 - p0, p2 - p0 );
+			CVector3 normal1 = Cross( p1 - target, p2 - target );
+			if (Dot( normal0, normal1 ) <= kfFlipThreshold * normal0.Length() * normal1.Length())
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Apply collapsed vertices to the faces and remove faces that have collapsed, returns the
+	// number of faces left
+	TUInt32 CSimplifier::RemoveFaces( const vector<TUInt32>& collapseRemap )
+	{
+		TUInt32 iNumFaces = 0;
+		for (TUInt32 iFace = 0; iFace < m_iNumFaces; ++iFace)
+		{
+			TUInt32 iVertex0 = collapseRemap[m_pIndices[iFace * 3]];
+			TUInt32 iVertex1 = collapseRemap[m_pIndices[iFace * 3 + 1]];
+			TUInt32 iVertex2 = collapseRemap[m_pIndices[iFace * 3 + 2]];
+			TUInt32 iPosition0 = m_PositionRemap[iVertex0];
+			TUInt32 iPosition1 = m_PositionRemap[iVertex1];
+			TUInt32 iPosition2 = m_PositionRemap[iVertex2];
+			if (iPosition0 != iPosition1 && iPosition1 != iPosition2 && iPosition2 != iPosition0)
+			{
+				m_pIndices[iNumFaces * 3] = iVertex0;
+				m_pIndices[iNumFaces * 3 + 1] = iVertex1;
+				m_pIndices[iNumFaces * 3 + 2] = iVertex2;
+				++iNumFaces;
+			}
+		}
+		return iNumFaces;
+	}
+
+
+	// Measure the distance of each collapsed vertex from the simplified faces, returns the largest.
+	// The quadric error is an average over the planes around a vertex, which can be much less than
+	// the distance the surface has actually moved, e.g. at thin parts of a mesh. The faces around
+	// the vertex a vertex collapsed onto give an upper bound on its distance, then only faces in a
+	// grid of cells within that distance can be closer
+	TFloat32 CSimplifier::MeasureError()
+	{
+		GetVertexFaces( m_pIndices, m_iNumFaces, m_iNumVertices, &m_Faces );
+
+		// Faces overlapping each cell of a grid over the unit box that holds the positions
+		TInt32 iGridSize = static_cast<TInt32>(powf( static_cast<TFloat32>(m_iNumFaces), 1.0f / 3.0f )) + 1;
+		iGridSize = Min( iGridSize, kiMaxErrorGridSize );
+		TUInt32 iNumCells = iGridSize * iGridSize * iGridSize;
+		SVertexLists cells;
+		cells.offsets.assign( iNumCells + 1, 0 );
+		for (TUInt32 iPass = 0; iPass < 2; ++iPass)
+		{
+			vector<TUInt32> fill( cells.offsets.begin(), cells.offsets.end() - 1 );
+			for (TUInt32 iFace = 0; iFace < m_iNumFaces; ++iFace)
+			{
+				const TUInt32* pFace = m_pIndices + iFace * 3;
+				TInt32 aiMin[3], aiMax[3];
+				for (TUInt32 iAxis = 0; iAxis < 3; ++iAxis)
+				{
+					TFloat32 fMin = Min( m_Positions[pFace[0]][iAxis], Min( m_Positions[pFace[1]][iAxis], m_Positions[pFace[2]][iAxis] ) );
+					TFloat32 fMax = Max( m_Positions[pFace[0]][iAxis], Max( m_Positions[pFace[1]][iAxis], m_Positions[pFace[2]][iAxis] ) );
+					aiMin[iAxis] = GetGridCell( fMin, iGridSize );
+					aiMax[iAxis] = GetGridCell( fMax, iGridSize );
+				}
+				for (TInt32 iZ = aiMin[2]; iZ <= aiMax[2]; ++iZ)
+				{
+					for (TInt32 iY = aiMin[1]; iY <= aiMax[1]; ++iY)
+					{
+						for (TInt32 iX = aiMin[0]; iX <= aiMax[0]; ++iX)
+						{
+							TUInt32 iCell = (iZ * iGridSize + iY) * iGridSize + iX;
+							if (iPass == 0)
+							{
+								++cells.offsets[iCell + 1];
+							}
+							else
+							{
+								cells.items[fill[iCell]++] = iFace;
+							}
+						}
+					}
+				}
+			}
+			if (iPass == 0)
+			{
+				for (TUInt32 iCell = 0; iCell < iNumCells; ++iCell)
+				{
+					cells.offsets[iCell + 1] += cells.offsets[iCell];
+				}
+				cells.items.resize( cells.offsets[iNumCells] );
+			}
+		}
+
+		TFloat32 fMaxDistance = 0.0f;
+		for (TUInt32 iVertex = 0; iVertex < m_iNumVertices; ++iVertex)
+		{
+			// Vertices that have not collapsed are on the surface, unless all their faces have gone,
+			// e.g. the tip of a spike whose base has collapsed
+			TUInt32 iTarget = m_Collapsed[iVertex];
+			if (iTarget == iVertex && m_Faces.offsets[iVertex] != m_Faces.offsets[iVertex + 1])
+			{
+				continue;
+			}
+			const CVector3& position = m_Positions[iVertex];
+			TFloat32 fDistance = HUGE_VALF;
+			for (TUInt32 iFace = m_Faces.offsets[iTarget]; iFace < m_Faces.offsets[iTarget + 1]; ++iFace)
+			{
+				const TUInt32* pFace = m_pIndices + m_Faces.items[iFace] * 3;
+				fDistance = Min( fDistance, PointTriangleDistanceSquared( position, m_Positions[pFace[0]],
+				                                                          m_Positions[pFace[1]], m_Positions[pFace[2]] ) );
+			}
+			if (fDistance <= fMaxDistance)
+			{
+				continue; // Cannot change the result
+			}
+
+			TInt32 aiMin[3], aiMax[3];
+			TFloat32 fRadius = sqrtf( fDistance );
+			for (TUInt32 iAxis = 0; iAxis < 3; ++iAxis)
+			{
+				aiMin[iAxis] = GetGridCell( position[iAxis] - fRadius, iGridSize );
+				aiMax[iAxis] = GetGridCell( position[iAxis] + fRadius, iGridSize );
+			}
+			for (TInt32 iZ = aiMin[2]; iZ <= aiMax[2]; ++iZ)
+			{
+				for (TInt32 iY = aiMin[1]; iY <= aiMax[1]; ++iY)
+				{
+					for (TInt32 iX = aiMin[0]; iX <= aiMax[0]; ++iX)
+					{
+						TUInt32 iCell = (iZ * iGridSize + iY) * iGridSize + iX;
+						for (TUInt32 iItem = cells.offsets[iCell]; iItem < cells.offsets[iCell + 1]; ++iItem)
+						{
+							const TUInt32* pFace = m_pIndices + cells.items[iItem] * 3;
+							fDistance = Min( fDistance, PointTriangleDistanceSquared( position, m_Positions[pFace[0]],
+							                                                          m_Positions[pFace[1]], m_Positions[pFace[2]] ) );
+						}
+					}
+				}
+			}
+			if (fDistance < HUGE_VALF)
+			{
+				fMaxDistance = Max( fMaxDistance, fDistance );
+			}
+		}
+		return sqrtf( fMaxDistance );
+	}
+
+
+	// Simplify in passes. Each pass finds the best way to collapse each edge, then collapses them
+	// in order of error, skipping edges next to others already collapsed in the pass, until enough
+	// faces are removed or the error is well beyond that needed to reach the target
+	TUInt32 CSimplifier::Simplify
+	(
+		const TUInt32  iTargetFaces,
+		const TFloat32 fTargetError,
+		TFloat32*      pfError
+	)
+	{
+		TFloat64 fErrorLimit = fTargetError > 0.0f ? fTargetError * m_fScale : 0.0;
+		fErrorLimit = fErrorLimit > 0.0 ? fErrorLimit * fErrorLimit : HUGE_VAL;
+		TFloat64 fResultError = 0.0;
+
+		vector<SCollapse> collapses;
+		vector<TUInt32> collapseRemap( m_iNumVertices );
+		vector<TUInt8> locked( m_iNumVertices );
+		m_Collapsed.resize( m_iNumVertices );
+		for (TUInt32 iVertex = 0; iVertex < m_iNumVertices; ++iVertex)
+		{
+			m_Collapsed[iVertex] = iVertex;
+		}
+		while (m_iNumFaces > iTargetFaces)
+		{
+			// Best collapse of each edge. Edges with a face on each side are seen twice, only
+			// consider them from one side
+			collapses.clear();
+			for (TUInt32 iFace = 0; iFace < m_iNumFaces; ++iFace)
+			{
+				for (TUInt32 iCorner = 0; iCorner < 3; ++iCorner)
+				{
+					TUInt32 iVertex0 = m_pIndices[iFace * 3 + iCorner];
+					TUInt32 iVertex1 = m_pIndices[iFace * 3 + (iCorner + 1) % 3];
+					if (iVertex0 > iVertex1 && HasEdge( m_Edges, iVertex1, iVertex0 ))
+					{
+						continue;
+					}
+
+					SCollapse collapse;
+					collapse.fError = HUGE_VAL;
+					if (CanCollapse( iVertex0, iVertex1 ))
+					{
+						collapse.iVertex = iVertex0;
+						collapse.iTarget = iVertex1;
+						collapse.fError = QuadricError( m_Quadrics[m_PositionRemap[iVertex0]], m_Positions[iVertex1] );
+					}
+					if (CanCollapse( iVertex1, iVertex0 ))
+					{
+						TFloat64 fError = QuadricError( m_Quadrics[m_PositionRemap[iVertex1]], m_Positions[iVertex0] );
+						if (fError < collapse.fError)
+						{
+							collapse.iVertex = iVertex1;
+							collapse.iTarget = iVertex0;
+							collapse.fError = fError;
+						}
+					}
+					if (collapse.fError < HUGE_VAL && collapse.fError <= fErrorLimit)
+					{
+						collapses.push_back( collapse );
+					}
+				}
+			}
+			if (collapses.empty())
+			{
+				break;
+			}
+			sort( collapses.begin(), collapses.end() );
+
+			// Most collapses remove two faces
+			TUInt32 iGoal = (m_iNumFaces - iTargetFaces + 1) / 2;
+			TFloat64 fPassLimit = fErrorLimit;
+			if (iGoal < collapses.size())
+			{
+				fPassLimit = Min( fPassLimit, collapses[iGoal].fError * kfPassErrorBound );
+			}
+
+			GetVertexFaces( m_pIndices, m_iNumFaces, m_iNumVertices, &m_Faces );
+			for (TUInt32 iVertex = 0; iVertex < m_iNumVertices; ++iVertex)
+			{
+				collapseRemap[iVertex] = iVertex;
+			}
+			fill( locked.begin(), locked.end(), 0 );
+
+			TUInt32 iCollapsedFaces = 0;
+			TUInt32 iNumCollapses = 0;
+			for (TUInt32 iCollapse = 0; iCollapse < collapses.size(); ++iCollapse)
+			{
+				const SCollapse& collapse = collapses[iCollapse];
+				if (collapse.fError > fPassLimit || m_iNumFaces - iCollapsedFaces <= iTargetFaces)
+				{
+					break;
+				}
+				TUInt32 iPosition = m_PositionRemap[collapse.iVertex];
+				TUInt32 iTargetPosition = m_PositionRemap[collapse.iTarget];
+				if (locked[iPosition] || locked[iTargetPosition])
+				{
+					continue;
+				}
+
+				// Seams collapse on both sides
+				TUInt32 iWedge = ~0u, iWedgeTarget = ~0u;
+				if (m_Kinds[collapse.iVertex] == kVertexSeam)
+				{
+					iWedge = m_Wedges[collapse.iVertex];
+					iWedgeTarget = GetSeamTarget( collapse.iVertex, collapse.iTarget );
+				}
+
+				TUInt32 iFaces = 0;
+				if (FlipsFaces( collapse.iVertex, collapse.iTarget, &iFaces ) ||
+				    (iWedge != ~0u && FlipsFaces( iWedge, iWedgeTarget, &iFaces )))
+				{
+					continue;
+				}
+
+				collapseRemap[collapse.iVertex] = collapse.iTarget;
+				if (iWedge != ~0u)
+				{
+					collapseRemap[iWedge] = iWedgeTarget;
+				}
+				AddQuadric( &m_Quadrics[iTargetPosition], m_Quadrics[iPosition] );
+				locked[iPosition] = 1;
+				locked[iTargetPosition] = 1;
+				iCollapsedFaces += iFaces;
+				fResultError = Max( fResultError, collapse.fError );
+				++iNumCollapses;
+			}
+			if (iNumCollapses == 0)
+			{
+				break;
+			}
+
+			m_iNumFaces = RemoveFaces( collapseRemap );
+			for (TUInt32 iVertex = 0; iVertex < m_iNumVertices; ++iVertex)
+			{
+				m_Collapsed[iVertex] = collapseRemap[m_Collapsed[iVertex]];
+			}
+			GetVertexEdges( m_pIndices, m_iNumFaces, m_iNumVertices, &m_Edges );
+		}
+
+		*pfError = Max( static_cast<TFloat32>(sqrt( fResultError )), MeasureError() ) / m_fScale;
+		return m_iNumFaces;
+	}
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Simplification
+-----------------------------------------------------------------------------------------*/
+
+// Simplify a triangle list towards the given number of faces by collapsing edges
+TUInt32 SimplifyMesh
+(
+	TUInt32*       pIndices,
+	const TUInt32  iNumFaces,
+	const TUInt8*  pPositions,
+	const TUInt32  iStride,
+	const TUInt32  iNumVertices,
+	const TUInt32  iTargetFaces,
+	const TFloat32 fTargetError,
+	TFloat32*      pfError
+)
+{
+	GEN_GUARD;
+
+	*pfError = 0.0f;
+	if (iNumFaces <= iTargetFaces)
+	{
+		return iNumFaces;
+	}
+	CSimplifier simplifier( pIndices, iNumFaces, pPositions, iStride, iNumVertices );
+	return simplifier.Simplify( iTargetFaces, fTargetError, pfError );
+
+	GEN_ENDGUARD;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Levels of detail
+-----------------------------------------------------------------------------------------*/
+
+// Build a chain of levels of detail for a sub-mesh
+TUInt32 BuildLODChain
+(
+	const SSubMesh&  subMesh,
+	SMeshLOD*        pLODs,
+	vector<TUInt32>* pLODIndices,
+	const TUInt32    iMaxLODs /*= kiMaxLODs*/,
+	const TFloat32   fReduction /*= kfDefaultLODReduction*/
+)
+{
+	GEN_GUARD;
+
+	pLODs[0].iFirstFace = 0;
+	pLODs[0].iNumFaces = subMesh.numFaces;
+	pLODs[0].fError = 0.0f;
+	pLODIndices->clear();
+
+	// Each level is simplified from the full mesh so its error is measured from it. Vertex
+	// position is always first in the vertex
+	vector<TUInt32> indices;
+	vector<TUInt32> lodIndices;
+	GetSubMeshIndices( subMesh, &indices );
+	TUInt32 iNumLODs = 1;
+	while (iNumLODs < iMaxLODs)
+	{
+		const SMeshLOD& previous = pLODs[iNumLODs - 1];
+		TUInt32 iTargetFaces = static_cast<TUInt32>(previous.iNumFaces * fReduction);
+		if (iTargetFaces < kiMinLODFaces)
+		{
+			break;
+		}
+
+		lodIndices = indices;
+		TFloat32 fError;
+		TUInt32 iNumFaces = SimplifyMesh( lodIndices.data(), subMesh.numFaces, subMesh.vertices,
+		                                  subMesh.vertexSize, subMesh.numVertices, iTargetFaces,
+		                                  0.0f, &fError );
+		if (iNumFaces > previous.iNumFaces * kfMinLODReduction)
+		{
+			break;
+		}
+		OptimiseVertexCache( lodIndices.data(), iNumFaces, subMesh.numVertices );
+
+		SMeshLOD& lod = pLODs[iNumLODs++];
+		lod.iFirstFace = subMesh.numFaces + static_cast<TUInt32>(pLODIndices->size()) / 3;
+		lod.iNumFaces = iNumFaces;
+		lod.fError = Max( fError, previous.fError );
+		pLODIndices->insert( pLODIndices->end(), lodIndices.begin(), lodIndices.begin() + iNumFaces * 3 );
+	}
+	return iNumLODs;
+
+	GEN_ENDGUARD;
+}
+
+
+// Choose the coarsest level of detail whose error on screen is within the given number of pixels
+TUInt32 SelectLOD
+(
+	const SMeshLOD* pLODs,
+	const TUInt32   iNumLODs,
+	const TFloat32  fDistance,
+	const TFloat32  fFOV,
+	const TFloat32  fViewportHeight,
+	const TFloat32  fPixelError /*= kfDefaultLODPixelError*/
+)
+{
+	GEN_GUARD;
+
+	if (fDistance <= 0.0f)
+	{
+		return 0;
+	}
+
+	// Pixels covered by a unit length at the given distance, facing the camera
+	TFloat32 fPixelsPerUnit = fViewportHeight / (2.0f * tanf( fFOV * 0.5f ) * fDistance);
+	TUInt32 iLOD = 0;
+	while (iLOD + 1 < iNumLODs && pLODs[iLOD + 1].fError * fPixelsPerUnit <= fPixelError)
+	{
+		++iLOD;
+	}
+	return iLOD;
+
+	GEN_ENDGUARD;
+}
+
+
+} // namespace gen
@@ -0,0 +1,109 @@
+/**************************************************************************************************
+	Module:       MeshSimplify.h
+	Date created: 18/10/26
+
+	Simplification of indexed triangle meshes by edge collapse with quadric error metrics, chains
+	of levels of detail built from it and selection of a level from the size of a model on screen
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#ifndef GEN_MESH_SIMPLIFY_H_INCLUDED
+#define GEN_MESH_SIMPLIFY_H_INCLUDED
+
+#include <vector>
+using namespace std;
+
+#include "GenDefines.h"
+#include "MeshData.h"
+
+namespace gen
+{
+
+// Most levels of detail in a chain, including the full mesh
+const TUInt32 kiMaxLODs = 6;
+
+// Each level of detail aims for this fraction of the faces of the previous one
+const TFloat32 kfDefaultLODReduction = 0.5f;
+
+// Levels of detail are not made with fewer faces than this
+const TUInt32 kiMinLODFaces = 32;
+
+// A level of detail is chosen when its error covers no more than this many pixels on screen
+const TFloat32 kfDefaultLODPixelError = 1.0f;
+
+
+/////////////////////////////////////
+// Simplification
+
+// Simplify a triangle list towards the given number of faces by collapsing edges, choosing the
+// collapses that least move the surface as measured by quadric error metrics (Garland &
+// Heckbert 1997). Vertices are not moved or created, faces are rewritten to use fewer of the
+// existing vertices, so the vertex data is shared by the original and the simplified faces.
+// Mesh borders are kept in place, and seams where vertices are duplicated with different
+// normals or UVs (as split by the import) can only collapse along the seam, with both sides
+// collapsing together. Vertices where more than two sets of attributes meet do not move.
+// Simplification stops early if the quadric error of a collapse (roughly the distance it moves
+// the surface) would exceed the given error (0 for no limit) or no more edges can collapse.
+// Returns the number of faces left. The error of the result, the largest distance of any of the
+// original vertices from the simplified faces (model units), is returned through the final
+// parameter
+TUInt32 SimplifyMesh
+(
+	TUInt32*       pIndices,           // Three per face, rewritten in place
+	const TUInt32  iNumFaces,
+	const TUInt8*  pPositions,         // Vertex positions (CVector3), at the given stride
+	const TUInt32  iStride,
+	const TUInt32  iNumVertices,
+	const TUInt32  iTargetFaces,
+	const TFloat32 fTargetError,
+	TFloat32*      pfError
+);
+
+
+/////////////////////////////////////
+// Levels of detail
+
+// A level of detail of a sub-mesh - a range of faces and the error of those faces from the full
+// mesh (model units)
+struct SMeshLOD
+{
+	TUInt32  iFirstFace;
+	TUInt32  iNumFaces;
+	TFloat32 fError;
+};
+
+// Build a chain of levels of detail for a sub-mesh, each simplified from the full mesh to the
+// given fraction of the faces of the previous level (see SimplifyMesh). All levels use the
+// sub-mesh's vertices. Level 0 is the sub-mesh's own faces, the faces of the later levels are
+// returned as 32-bit indices, with each level's first face counted from the start of the
+// sub-mesh's faces as if they were stored straight after them. Levels are ordered for the
+// vertex cache. The chain ends early when a level would be too small or simplification can no
+// longer reduce the faces much. Returns the number of levels
+TUInt32 BuildLODChain
+(
+	const SSubMesh&  subMesh,
+	SMeshLOD*        pLODs,            // Space for iMaxLODs levels
+	vector<TUInt32>* pLODIndices,      // Indices for levels after the first
+	const TUInt32    iMaxLODs = kiMaxLODs,
+	const TFloat32   fReduction = kfDefaultLODReduction
+);
+
+// Choose the coarsest level of detail whose error, projected on the screen, covers no more than
+// the given number of pixels. The distance is from the camera to the model in the model's own
+// units (i.e. divided by the model's scale). Returns the level to use
+TUInt32 SelectLOD
+(
+	const SMeshLOD* pLODs,
+	const TUInt32   iNumLODs,
+	const TFloat32  fDistance,
+	const TFloat32  fFOV,              // Vertical field of view of the camera (radians)
+	const TFloat32  fViewportHeight,   // Pixels
+	const TFloat32  fPixelError = kfDefaultLODPixelError
+);
+
+
+} // namespace gen
+
+#endif // GEN_MESH_SIMPLIFY_H_INCLUDED
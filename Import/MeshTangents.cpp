@@ -0,0 +1,415 @@
+/**************************************************************************************************
+	Module:       MeshTangents.cpp
+	Date created: 18/10/26
+
+	Tangent frame generation for indexed triangle meshes
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#include <vector>
+#include <cmath>
+#include <cfloat>
+#include <xmmintrin.h>
+using namespace std;
+
+#include "MeshTangents.h"
+#include "CThreadPool.h"
+
+namespace gen
+{
+
+namespace
+{
+	// Minimum number of faces or vertices processed by a single task when using a thread pool
+	const TUInt32 kiMinBatchSize = 4096;
+
+	// Run a function on ranges [iStart, iEnd) covering [0, iCount), in parallel if a thread pool
+	// is given and there is enough work. Returns when all ranges are complete
+	template <class TFn>
+	void ParallelFor
+	(
+		const TUInt32 iCount,
+		CThreadPool*  pThreadPool,
+		const TFn&    fn
+	)
+	{
+		if (!pThreadPool || iCount <= kiMinBatchSize)
+		{
+			fn( 0, iCount );
+			return;
+		}
+
+		// A few batches per thread to even out the work
+		TUInt32 iNumBatches = (iCount + kiMinBatchSize - 1) / kiMinBatchSize;
+		if (iNumBatches > pThreadPool->GetNumThreads() * 4)
+		{
+			iNumBatches = pThreadPool->GetNumThreads() * 4;
+		}
+		TUInt32 iBatchSize = (iCount + iNumBatches - 1) / iNumBatches;
+
+		vector< future<void> > results;
+		results.reserve( iNumBatches );
+		for (TUInt32 iStart = 0; iStart < iCount; iStart += iBatchSize)
+		{
+			TUInt32 iEnd = (iCount - iStart > iBatchSize) ? iStart + iBatchSize : iCount;
+			const TFn* pFn = &fn;
+			results.push_back( pThreadPool->Submit( [pFn, iStart, iEnd]() { (*pFn)( iStart, iEnd ); } ) );
+		}
+
+		// Wait for every task before checking for errors, the tasks refer to the caller's data
+		for (TUInt32 iResult = 0; iResult < results.size(); ++iResult)
+		{
+			results[iResult].wait();
+		}
+		for (TUInt32 iResult = 0; iResult < results.size(); ++iResult)
+		{
+			results[iResult].get(); // Rethrows any exception from the task
+		}
+	}
+
+
+	// SSE helpers working on the x, y & z components of a vector, the w component is kept at 0
+	inline __m128 Load3( const CVector3& v )
+	{
+		return _mm_set_ps( 0.0f, v.z, v.y, v.x );
+	}
+
+	// Dot product, result in all components
+	inline __m128 Dot3( const __m128 v1, const __m128 v2 )
+	{
+		__m128 m = _mm_mul_ps( v1, v2 );
+		return _mm_add_ps( _mm_add_ps( _mm_shuffle_ps( m, m, _MM_SHUFFLE(0, 0, 0, 0) ),
+		                               _mm_shuffle_ps( m, m, _MM_SHUFFLE(1, 1, 1, 1) ) ),
+		                               _mm_shuffle_ps( m, m, _MM_SHUFFLE(2, 2, 2, 2) ) );
+	}
+
+	// Remove the component of a vector along a unit normal
+	inline __m128 Project3( const __m128 v, const __m128 n )
+	{
+		return _mm_sub_ps( v, _mm_mul_ps( Dot3( v, n ), n ) );
+	}
+
+	// Normalise a vector, returns false (and leaves the vector) if it has zero length
+	inline bool Normalise3( __m128* pV )
+	{
+		__m128 lengthSq = Dot3( *pV, *pV );
+		if (_mm_cvtss_f32( lengthSq ) <= FLT_MIN)
+		{
+			return false;
+		}
+		*pV = _mm_div_ps( *pV, _mm_sqrt_ps( lengthSq ) );
+		return true;
+	}
+
+	// Reciprocal square root of each component, refined with a Newton-Raphson step to near
+	// full float precision
+	inline __m128 ReciprocalSqrt( const __m128 v )
+	{
+		__m128 r = _mm_rsqrt_ps( v );
+		return _mm_mul_ps( _mm_mul_ps( _mm_set1_ps( 0.5f ), r ),
+		                   _mm_sub_ps( _mm_set1_ps( 3.0f ), _mm_mul_ps( _mm_mul_ps( v, r ), r ) ) );
+	}
+
+	// Arc-cosine of each component (which must be in [-1, 1]), polynomial approximation with an
+	// error under 0.0001 radians (Abramowitz & Stegun 4.4.45). Only used for weights
+	inline __m128 ArcCos( const __m128 x )
+	{
+		__m128 signMask = _mm_set1_ps( -0.0f );
+		__m128 a = _mm_andnot_ps( signMask, x );
+		__m128 poly = _mm_add_ps( _mm_set1_ps( 0.0742610f ), _mm_mul_ps( a, _mm_set1_ps( -0.0187293f ) ) );
+		poly = _mm_add_ps( _mm_set1_ps( -0.2121144f ), _mm_mul_ps( a, poly ) );
+		poly = _mm_add_ps( _mm_set1_ps( 1.5707288f ), _mm_mul_ps( a, poly ) );
+		__m128 r = _mm_mul_ps( _mm_sqrt_ps( _mm_sub_ps( _mm_set1_ps( 1.0f ), a ) ), poly );
+
+		// acos(-x) = pi - acos(x)
+		__m128 negative = _mm_cmplt_ps( x, _mm_setzero_ps() );
+		return _mm_or_ps( _mm_andnot_ps( negative, r ),
+		                  _mm_and_ps( negative, _mm_sub_ps( _mm_set1_ps( kfPi ), r ) ) );
+	}
+
+
+	// Four vectors held component-wise, one vector in each SSE component
+	struct SVectors4
+	{
+		__m128 x, y, z;
+	};
+
+	// Gather the given corner's vector from four faces
+	inline SVectors4 Gather( const CVector3* pVectors, const TUInt32* const apFaces[4], const TUInt32 iCorner )
+	{
+		const CVector3& v0 = pVectors[apFaces[0][iCorner]];
+		const CVector3& v1 = pVectors[apFaces[1][iCorner]];
+		const CVector3& v2 = pVectors[apFaces[2][iCorner]];
+		const CVector3& v3 = pVectors[apFaces[3][iCorner]];
+		SVectors4 v;
+		v.x = _mm_set_ps( v3.x, v2.x, v1.x, v0.x );
+		v.y = _mm_set_ps( v3.y, v2.y, v1.y, v0.y );
+		v.z = _mm_set_ps( v3.z, v2.z, v1.z, v0.z );
+		return v;
+	}
+
+	inline SVectors4 Subtract( const SVectors4& v1, const SVectors4& v2 )
+	{
+		SVectors4 v;
+		v.x = _mm_sub_ps( v1.x, v2.x );
+		v.y = _mm_sub_ps( v1.y, v2.y );
+		v.z = _mm_sub_ps( v1.z, v2.z );
+		return v;
+	}
+
+	inline __m128 Dot( const SVectors4& v1, const SVectors4& v2 )
+	{
+		return _mm_add_ps( _mm_add_ps( _mm_mul_ps( v1.x, v2.x ), _mm_mul_ps( v1.y, v2.y ) ), _mm_mul_ps( v1.z, v2.z ) );
+	}
+
+	// Remove the components of vectors along unit normals
+	inline SVectors4 Project( const SVectors4& v, const SVectors4& n )
+	{
+		__m128 dot = Dot( v, n );
+		SVectors4 p;
+		p.x = _mm_sub_ps( v.x, _mm_mul_ps( dot, n.x ) );
+		p.y = _mm_sub_ps( v.y, _mm_mul_ps( dot, n.y ) );
+		p.z = _mm_sub_ps( v.z, _mm_mul_ps( dot, n.z ) );
+		return p;
+	}
+
+
+	// Calculate the weighted tangent contribution of each corner of four faces. The x, y & z
+	// components are the face tangent projected onto the corner normal and scaled by the corner
+	// angle. The w component is the corner angle, negated if the face's UVs are mirrored. Faces
+	// are processed together, one in each SSE component. Only the first iNumFaces faces are output
+	// (the others may repeat a face to fill the SSE registers)
+	void CalculateCornerTangents4
+	(
+		const CVector3*      pPositions,
+		const CVector3*      pNormals,
+		const CVector2*      pUVs,
+		const TUInt32* const apFaces[4],
+		const TUInt32        iNumFaces,
+		TFloat32* const      apCorners[4]
+	)
+	{
+		// Face tangents from positions and UVs (the direction of increasing U). They are not
+		// normalised as they are normalised after projection for each corner
+		SVectors4 positions[3] = { Gather( pPositions, apFaces, 0 ), Gather( pPositions, apFaces, 1 ),
+		                           Gather( pPositions, apFaces, 2 ) };
+		__m128 s[3], t[3];
+		for (TUInt32 iCorner = 0; iCorner < 3; ++iCorner)
+		{
+			s[iCorner] = _mm_set_ps( pUVs[apFaces[3][iCorner]].x, pUVs[apFaces[2][iCorner]].x,
+			                         pUVs[apFaces[1][iCorner]].x, pUVs[apFaces[0][iCorner]].x );
+			t[iCorner] = _mm_set_ps( pUVs[apFaces[3][iCorner]].y, pUVs[apFaces[2][iCorner]].y,
+			                         pUVs[apFaces[1][iCorner]].y, pUVs[apFaces[0][iCorner]].y );
+		}
+		__m128 s1 = _mm_sub_ps( s[1], s[0] );
+		__m128 t1 = _mm_sub_ps( t[1], t[0] );
+		__m128 s2 = _mm_sub_ps( s[2], s[0] );
+		__m128 t2 = _mm_sub_ps( t[2], t[0] );
+		SVectors4 edge1 = Subtract( positions[1], positions[0] );
+		SVectors4 edge2 = Subtract( positions[2], positions[0] );
+
+		// The tangent is flipped for faces with mirrored UVs (negative area) so it always points
+		// along increasing U. Faces with no UV area have no tangent
+		__m128 signMask = _mm_set1_ps( -0.0f );
+		__m128 signedArea = _mm_sub_ps( _mm_mul_ps( s1, t2 ), _mm_mul_ps( s2, t1 ) );
+		__m128 orientation = _mm_or_ps( _mm_and_ps( signMask, signedArea ), _mm_set1_ps( 1.0f ) );
+		__m128 hasArea = _mm_cmpgt_ps( _mm_andnot_ps( signMask, signedArea ), _mm_set1_ps( FLT_MIN ) );
+		t1 = _mm_mul_ps( t1, orientation );
+		t2 = _mm_mul_ps( t2, orientation );
+		SVectors4 faceTangent;
+		faceTangent.x = _mm_sub_ps( _mm_mul_ps( t2, edge1.x ), _mm_mul_ps( t1, edge2.x ) );
+		faceTangent.y = _mm_sub_ps( _mm_mul_ps( t2, edge1.y ), _mm_mul_ps( t1, edge2.y ) );
+		faceTangent.z = _mm_sub_ps( _mm_mul_ps( t2, edge1.z ), _mm_mul_ps( t1, edge2.z ) );
+
+		__m128 minLengthSq = _mm_set1_ps( FLT_MIN );
+		for (TUInt32 iCorner = 0; iCorner < 3; ++iCorner)
+		{
+			// Project the face tangent and the edges to the next and previous corners onto the
+			// plane of the corner normal
+			SVectors4 normal = Gather( pNormals, apFaces, iCorner );
+			SVectors4 tangent = Project( faceTangent, normal );
+			SVectors4 edgeNext = Project( Subtract( positions[(iCorner + 1) % 3], positions[iCorner] ), normal );
+			SVectors4 edgePrev = Project( Subtract( positions[(iCorner + 2) % 3], positions[iCorner] ), normal );
+
+			// Corners where any of the projected vectors has zero length contribute nothing
+			__m128 tangentLengthSq = Dot( tangent, tangent );
+			__m128 nextLengthSq = Dot( edgeNext, edgeNext );
+			__m128 prevLengthSq = Dot( edgePrev, edgePrev );
+			__m128 valid = _mm_and_ps( _mm_and_ps( hasArea, _mm_cmpgt_ps( tangentLengthSq, minLengthSq ) ),
+			                           _mm_and_ps( _mm_cmpgt_ps( nextLengthSq, minLengthSq ),
+			                                       _mm_cmpgt_ps( prevLengthSq, minLengthSq ) ) );
+
+			// Corner angle between the projected edges
+			__m128 cosAngle = _mm_mul_ps( Dot( edgeNext, edgePrev ),
+			                              ReciprocalSqrt( _mm_mul_ps( nextLengthSq, prevLengthSq ) ) );
+			cosAngle = _mm_max_ps( _mm_min_ps( cosAngle, _mm_set1_ps( 1.0f ) ), _mm_set1_ps( -1.0f ) );
+			__m128 angle = _mm_and_ps( valid, ArcCos( cosAngle ) );
+
+			// Weighted unit tangent in x, y & z and the signed weight in w, then transpose to one
+			// face per register for output. The weight is masked again as it is not finite where
+			// the tangent has zero length
+			__m128 weight = _mm_and_ps( valid, _mm_mul_ps( angle, ReciprocalSqrt( tangentLengthSq ) ) );
+			__m128 corner0 = _mm_mul_ps( tangent.x, weight );
+			__m128 corner1 = _mm_mul_ps( tangent.y, weight );
+			__m128 corner2 = _mm_mul_ps( tangent.z, weight );
+			__m128 corner3 = _mm_mul_ps( angle, orientation );
+			_MM_TRANSPOSE4_PS( corner0, corner1, corner2, corner3 );
+			__m128 aCorners[4] = { corner0, corner1, corner2, corner3 };
+			for (TUInt32 iFace = 0; iFace < iNumFaces; ++iFace)
+			{
+				_mm_storeu_ps( apCorners[iFace] + iCorner * 4, aCorners[iFace] );
+			}
+		}
+	}
+
+	// Add the corner tangents of a range of faces to the sums for their vertices. Corners are added
+	// in face order, so the sums are the same however the faces were divided between threads
+	inline void AddCornerTangents
+	(
+		const TUInt32*  pIndices,
+		const CVector4* pCorners,
+		const TUInt32   iFirstFace,
+		const TUInt32   iLastFace,
+		CVector4*       pSums
+	)
+	{
+		for (TUInt32 iCorner = iFirstFace * 3; iCorner < iLastFace * 3; ++iCorner)
+		{
+			TFloat32* pSum = &pSums[pIndices[iCorner]].x;
+			_mm_storeu_ps( pSum, _mm_add_ps( _mm_loadu_ps( pSum ), _mm_loadu_ps( &pCorners->x ) ) );
+			++pCorners;
+		}
+	}
+
+	// Calculate the weighted tangent contribution of each corner of a range of faces, see above.
+	// The corners are either stored in pCorners (indexed by face * 3 + corner) or, if pCorners is
+	// 0, added straight to the sums for their vertices
+	void CalculateCornerTangents
+	(
+		const CVector3* pPositions,
+		const CVector3* pNormals,
+		const CVector2* pUVs,
+		const TUInt32*  pIndices,
+		const TUInt32   iFirstFace,
+		const TUInt32   iLastFace,
+		CVector4*       pCorners,
+		CVector4*       pSums
+	)
+	{
+		CVector4 aGroupCorners[12];
+		for (TUInt32 iFace = iFirstFace; iFace < iLastFace; iFace += 4)
+		{
+			// Faces are processed in fours, the last group is filled out by repeating its last face
+			TUInt32 iNumFaces = (iLastFace - iFace < 4) ? iLastFace - iFace : 4;
+			const TUInt32* apFaces[4];
+			TFloat32* apCorners[4];
+			for (TUInt32 iGroupFace = 0; iGroupFace < 4; ++iGroupFace)
+			{
+				TUInt32 iSourceFace = (iGroupFace < iNumFaces) ? iGroupFace : iNumFaces - 1;
+				apFaces[iGroupFace] = pIndices + (iFace + iSourceFace) * 3;
+				apCorners[iGroupFace] = pCorners ? &pCorners[(iFace + iSourceFace) * 3].x : &aGroupCorners[iSourceFace * 3].x;
+			}
+			CalculateCornerTangents4( pPositions, pNormals, pUVs, apFaces, iNumFaces, apCorners );
+			if (!pCorners)
+			{
+				AddCornerTangents( pIndices + iFace * 3, aGroupCorners, 0, iNumFaces, pSums );
+			}
+		}
+	}
+
+	// Convert the summed corner tangents for a range of vertices to unit tangents orthogonal to
+	// the normals, with the handedness in w
+	void FinishTangents
+	(
+		const CVector3* pNormals,
+		const TUInt32   iFirstVertex,
+		const TUInt32   iLastVertex,
+		CVector4*       pTangents
+	)
+	{
+		for (TUInt32 iVertex = iFirstVertex; iVertex < iLastVertex; ++iVertex)
+		{
+			// Make the summed tangent exactly orthogonal to the normal (it is a sum of projected
+			// vectors so is only out by rounding)
+			const CVector4& sum = pTangents[iVertex];
+			__m128 normal = Load3( pNormals[iVertex] );
+			__m128 tangent = Project3( _mm_set_ps( 0.0f, sum.z, sum.y, sum.x ), normal );
+			if (!Normalise3( &tangent ))
+			{
+				// No valid contribution, use any direction perpendicular to the normal - cross the
+				// normal with the axis it is least aligned with
+				const CVector3& n = pNormals[iVertex];
+				CVector3 axis = (fabs( n.x ) < fabs( n.y ) && fabs( n.x ) < fabs( n.z )) ? CVector3::kXAxis :
+				                (fabs( n.y ) < fabs( n.z ) ? CVector3::kYAxis : CVector3::kZAxis);
+				tangent = Load3( Cross( n, axis ) );
+				if (!Normalise3( &tangent ))
+				{
+					tangent = Load3( CVector3::kXAxis );
+				}
+			}
+
+			TFloat32 fHandedness = (sum.w < 0.0f) ? -1.0f : 1.0f;
+			_mm_storeu_ps( &pTangents[iVertex].x, tangent );
+			pTangents[iVertex].w = fHandedness;
+		}
+	}
+
+} // anonymous namespace
+
+
+// Calculate a tangent for each vertex of an indexed triangle list. The tangent (x, y, z) is the
+// direction of the texture U axis in model-space, orthogonal to the vertex normal. The w component
+// is the handedness of the texture space (1 or -1) - the bitangent is cross(normal, tangent) * w
+void CalculateTangentFrames
+(
+	const CVector3* pPositions,
+	const CVector3* pNormals,
+	const CVector2* pUVs,
+	const TUInt32   iNumVertices,
+	const TUInt32*  pIndices,
+	const TUInt32   iNumFaces,
+	CVector4*       pTangents,
+	CThreadPool*    pThreadPool /*= 0*/
+)
+{
+	GEN_GUARD;
+
+	// Corner tangents are summed in the output list, then each sum is converted to a tangent
+	for (TUInt32 iVertex = 0; iVertex < iNumVertices; ++iVertex)
+	{
+		pTangents[iVertex] = CVector4( 0.0f, 0.0f, 0.0f, 0.0f );
+	}
+
+	if (!pThreadPool || iNumFaces <= kiMinBatchSize)
+	{
+		// Single thread - add each group of corners to the sums as soon as they are calculated
+		CalculateCornerTangents( pPositions, pNormals, pUVs, pIndices, 0, iNumFaces, 0, pTangents );
+	}
+	else
+	{
+		// Calculate the corner tangents in parallel over ranges of faces, then sum them for each
+		// vertex. The sums are made in the same order as above so the result is identical
+		vector<CVector4> corners( iNumFaces * 3 );
+		CVector4* pCorners = &corners[0];
+		ParallelFor( iNumFaces, pThreadPool,
+		             [=]( TUInt32 iStart, TUInt32 iEnd )
+		             {
+		                 CalculateCornerTangents( pPositions, pNormals, pUVs, pIndices, iStart, iEnd, pCorners, 0 );
+		             } );
+		AddCornerTangents( pIndices, pCorners, 0, iNumFaces, pTangents );
+	}
+
+	// Finish the tangents in parallel over ranges of vertices
+	ParallelFor( iNumVertices, pThreadPool,
+	             [=]( TUInt32 iStart, TUInt32 iEnd )
+	             {
+	                 FinishTangents( pNormals, iStart, iEnd, pTangents );
+	             } );
+
+	GEN_ENDGUARD;
+}
+
+
+} // namespace gen
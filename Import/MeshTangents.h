@@ -0,0 +1,51 @@
+/**************************************************************************************************
+	Module:       MeshTangents.h
+	Date created: 18/10/26
+
+	Tangent frame generation for indexed triangle meshes
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#ifndef GEN_MESH_TANGENTS_H_INCLUDED
+#define GEN_MESH_TANGENTS_H_INCLUDED
+
+#include "GenDefines.h"
+#include "CVector2.h"
+#include "CVector3.h"
+#include "CVector4.h"
+
+namespace gen
+{
+
+class CThreadPool;
+
+// Calculate a tangent for each vertex of an indexed triangle list. The tangent (x, y, z) is the
+// direction of the texture U axis in model-space, orthogonal to the vertex normal. The w component
+// is the handedness of the texture space (1 or -1) - the bitangent is cross(normal, tangent) * w,
+// so mirrored UVs are lit correctly
+// Follows the MikkTSpace rules: face tangents are normalised, projected onto the plane of each
+// corner's normal and weighted by the corner angle. Faces with no UV area contribute nothing,
+// vertices with no valid contribution get an arbitrary tangent perpendicular to their normal.
+// Vertices are never split, so a vertex shared by faces with opposite handedness takes the
+// handedness of the larger total corner angle
+// If a thread pool is given, large meshes are processed in parallel. The result does not depend
+// on the number of threads. The calling thread waits for the pool's tasks, so must not itself be
+// running as a task on the same pool
+void CalculateTangentFrames
+(
+	const CVector3* pPositions,
+	const CVector3* pNormals,
+	const CVector2* pUVs,
+	const TUInt32   iNumVertices,
+	const TUInt32*  pIndices,    // Three per face
+	const TUInt32   iNumFaces,
+	CVector4*       pTangents,   // Output, one per vertex
+	CThreadPool*    pThreadPool = 0
+);
+
+
+} // namespace gen
+
+#endif // GEN_MESH_TANGENTS_H_INCLUDED
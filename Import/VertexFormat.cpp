@@ -0,0 +1,533 @@
+/**************************************************************************************************
+	Module:       VertexFormat.cpp
+	Date created: 18/10/26
+
+	Compact vertex formats for the GPU - encoding of imported sub-mesh vertices with quantised
+	positions, octahedral normals and tangents, half-float texture coordinates and 8-bit colours,
+	a platform-neutral description of the encoded vertex elements, and analysis of the error
+	introduced by the encoding
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#include <cmath>
+#include <cstring>
+
+#include "VertexFormat.h"
+#include "CVector4.h"
+#include "BaseMath.h"
+#include "Error.h"
+
+namespace gen
+{
+
+namespace
+{
+	// Size in bytes of each element format, in the order of EVertexElementFormat
+	const TUInt32 kaiElementSizes[] = { 8, 12, 16, 4, 8, 4, 8, 4, 4 };
+
+	// Size of skinning data in imported vertices - 4 float weights then 4 byte bone indices
+	const TUInt32 kiSkinWeightsSize = 4 * sizeof(TFloat32);
+	const TUInt32 kiSkinIndicesSize = sizeof(TUInt32);
+
+	// Size of an imported vertex colour - 4 floats
+	const TUInt32 kiColourSize = 4 * sizeof(TFloat32);
+
+	// Add an element to a list, advancing the offset
+	void AddElement
+	(
+		const char*                sSemantic,
+		const EVertexElementFormat eFormat,
+		SVertexElement*            pElements,
+		TUInt32*                   piNumElements,
+		TUInt32*                   piOffset
+	)
+	{
+		SVertexElement& element = pElements[(*piNumElements)++];
+		element.sSemantic = sSemantic;
+		element.eFormat = eFormat;
+		element.iOffset = *piOffset;
+		*piOffset += kaiElementSizes[eFormat];
+	}
+
+
+	// Convert between floats in [-1,1] and 16-bit signed normalised values, decoding as the GPU
+	// does (-32768 and -32767 both give -1)
+	TInt16 FloatToSNorm16( const TFloat32 f )
+	{
+		TFloat32 fClamped = (f < -1.0f) ? -1.0f : ((f > 1.0f) ? 1.0f : f);
+		return static_cast<TInt16>(floorf( fClamped * 32767.0f + 0.5f ));
+	}
+
+	TFloat32 SNorm16ToFloat( const TInt16 i )
+	{
+		TFloat32 f = static_cast<TFloat32>(i) / 32767.0f;
+		return (f < -1.0f) ? -1.0f : f;
+	}
+
+	// Convert between floats in [0,1] and 8-bit unsigned normalised values
+	TUInt8 FloatToUNorm8( const TFloat32 f )
+	{
+		TFloat32 fClamped = (f < 0.0f) ? 0.0f : ((f > 1.0f) ? 1.0f : f);
+		return static_cast<TUInt8>(floorf( fClamped * 255.0f + 0.5f ));
+	}
+
+	TFloat32 UNorm8ToFloat( const TUInt8 i )
+	{
+		return static_cast<TFloat32>(i) / 255.0f;
+	}
+
+
+	// Decode a direction from the octahedral mapping. The vertex shader must use the same decoding
+	CVector3 OctDecode( const TInt16* aiOct )
+	{
+		CVector3 v( SNorm16ToFloat( aiOct[0] ), SNorm16ToFloat( aiOct[1] ), 0.0f );
+		v.z = 1.0f - fabsf( v.x ) - fabsf( v.y );
+		if (v.z < 0.0f)
+		{
+			TFloat32 fX = (1.0f - fabsf( v.y )) * ((v.x >= 0.0f) ? 1.0f : -1.0f);
+			v.y = (1.0f - fabsf( v.x )) * ((v.y >= 0.0f) ? 1.0f : -1.0f);
+			v.x = fX;
+		}
+		v.Normalise();
+		return v;
+	}
+
+	// Encode a direction with the octahedral mapping: project onto the octahedron |x|+|y|+|z| = 1
+	// and fold the lower half over the upper, then flatten onto the xy plane. Of the four
+	// quantised values around the exact one, the one decoding closest to the direction is used,
+	// which halves the worst error compared to simple rounding
+	void OctEncode
+	(
+		const CVector3& v,
+		TInt16*         aiOct
+	)
+	{
+		TFloat32 fSum = fabsf( v.x ) + fabsf( v.y ) + fabsf( v.z );
+		if (fSum == 0.0f)
+		{
+			aiOct[0] = aiOct[1] = 0;
+			return;
+		}
+		TFloat32 fU = v.x / fSum;
+		TFloat32 fV = v.y / fSum;
+		if (v.z < 0.0f)
+		{
+			TFloat32 fFoldU = (1.0f - fabsf( fV )) * ((fU >= 0.0f) ? 1.0f : -1.0f);
+			fV = (1.0f - fabsf( fU )) * ((fV >= 0.0f) ? 1.0f : -1.0f);
+			fU = fFoldU;
+		}
+
+		CVector3 vNormalised = v / Length( v );
+		TFloat32 fFloorU = floorf( fU * 32767.0f );
+		TFloat32 fFloorV = floorf( fV * 32767.0f );
+		TFloat32 fBestDot = -2.0f;
+		for (TUInt32 iCandidate = 0; iCandidate < 4; ++iCandidate)
+		{
+			TInt16 aiCandidate[2];
+			TFloat32 fCandU = fFloorU + static_cast<TFloat32>(iCandidate & 1);
+			TFloat32 fCandV = fFloorV + static_cast<TFloat32>(iCandidate >> 1);
+			aiCandidate[0] = static_cast<TInt16>(Max( -32767.0f, Min( 32767.0f, fCandU ) ));
+			aiCandidate[1] = static_cast<TInt16>(Max( -32767.0f, Min( 32767.0f, fCandV ) ));
+			TFloat32 fDot = vNormalised.Dot( OctDecode( aiCandidate ) );
+			if (fDot > fBestDot)
+			{
+				fBestDot = fDot;
+				aiOct[0] = aiCandidate[0];
+				aiOct[1] = aiCandidate[1];
+			}
+		}
+	}
+
+
+	// Angle between two directions in degrees, 0 if either has no length
+	TFloat32 AngleBetween
+	(
+		const CVector3& v1,
+		const CVector3& v2
+	)
+	{
+		TFloat32 fLengths = Length( v1 ) * Length( v2 );
+		if (fLengths == 0.0f)
+		{
+			return 0.0f;
+		}
+		TFloat32 fCos = v1.Dot( v2 ) / fLengths;
+		return ToDegrees( acosf( Max( -1.0f, Min( 1.0f, fCos ) ) ) );
+	}
+
+
+	// Encode a position already scaled and biased into [-1,1] with the given w, write it and
+	// return the decoded value (still scaled and biased)
+	CVector3 EncodePosition
+	(
+		const CVector3&         vPosition,
+		const TFloat32          fW,
+		const EPositionEncoding eEncoding,
+		const bool              bWriteW,
+		TUInt8*                 pOut
+	)
+	{
+		if (eEncoding == kPositionHalf)
+		{
+			TUInt16 aiHalf[4] = { FloatToHalf( vPosition.x ), FloatToHalf( vPosition.y ),
+			                      FloatToHalf( vPosition.z ), FloatToHalf( fW ) };
+			memcpy( pOut, aiHalf, sizeof(aiHalf) );
+			return CVector3( HalfToFloat( aiHalf[0] ), HalfToFloat( aiHalf[1] ), HalfToFloat( aiHalf[2] ) );
+		}
+		else if (eEncoding == kPositionSNorm16)
+		{
+			TInt16 aiSNorm[4] = { FloatToSNorm16( vPosition.x ), FloatToSNorm16( vPosition.y ),
+			                      FloatToSNorm16( vPosition.z ), FloatToSNorm16( fW ) };
+			memcpy( pOut, aiSNorm, sizeof(aiSNorm) );
+			return CVector3( SNorm16ToFloat( aiSNorm[0] ), SNorm16ToFloat( aiSNorm[1] ),
+			                 SNorm16ToFloat( aiSNorm[2] ) );
+		}
+		memcpy( pOut, &vPosition, sizeof(CVector3) );
+		if (bWriteW)
+		{
+			memcpy( pOut + sizeof(CVector3), &fW, sizeof(TFloat32) );
+		}
+		return vPosition;
+	}
+
+	// Encode a texture coordinate, write it and return the decoded value
+	TFloat32 EncodeTexCoord
+	(
+		const TFloat32          f,
+		const ETexCoordEncoding eEncoding,
+		TUInt8*                 pOut
+	)
+	{
+		if (eEncoding == kTexCoordHalf)
+		{
+			TUInt16 iHalf = FloatToHalf( f );
+			memcpy( pOut, &iHalf, sizeof(iHalf) );
+			return HalfToFloat( iHalf );
+		}
+		memcpy( pOut, &f, sizeof(f) );
+		return f;
+	}
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Vertex elements
+-----------------------------------------------------------------------------------------*/
+
+// Get the elements of vertices encoded in the given format for a sub-mesh with the given
+// components. Returns the number of elements and the vertex size
+TUInt32 GetVertexElements
+(
+	const SSubMesh&      layout,
+	const SVertexFormat& format,
+	SVertexElement*      pElements,
+	TUInt32*             piVertexSize
+)
+{
+	// Elements are in the same order as imported vertices. The tangent handedness moves to the
+	// position when tangents are compressed, which makes float positions 4 components
+	const bool bOctDirections = (format.directions == kDirectionOct16);
+	const bool bHandednessInPosition = layout.hasTangents && bOctDirections;
+	TUInt32 iNumElements = 0;
+	TUInt32 iOffset = 0;
+
+	EVertexElementFormat ePosition = bHandednessInPosition ? kElementFloat4 : kElementFloat3;
+	if (format.position == kPositionHalf)
+	{
+		ePosition = kElementHalf4;
+	}
+	else if (format.position == kPositionSNorm16)
+	{
+		ePosition = kElementSNorm16x4;
+	}
+	AddElement( "POSITION", ePosition, pElements, &iNumElements, &iOffset );
+	if (layout.hasSkinningData)
+	{
+		AddElement( "BLENDWEIGHT", kElementFloat4, pElements, &iNumElements, &iOffset );
+		AddElement( "BLENDINDICES", kElementUInt8x4, pElements, &iNumElements, &iOffset );
+	}
+	if (layout.hasNormals)
+	{
+		AddElement( "NORMAL", bOctDirections ? kElementSNorm16x2 : kElementFloat3,
+		            pElements, &iNumElements, &iOffset );
+	}
+	if (layout.hasTangents)
+	{
+		AddElement( "TANGENT", bOctDirections ? kElementSNorm16x2 : kElementFloat4,
+		            pElements, &iNumElements, &iOffset );
+	}
+	if (layout.hasTextureCoords)
+	{
+		AddElement( "TEXCOORD", (format.texCoords == kTexCoordHalf) ? kElementHalf2 : kElementFloat2,
+		            pElements, &iNumElements, &iOffset );
+	}
+	if (layout.hasVertexColours)
+	{
+		AddElement( "COLOR", (format.colours == kColourUNorm8) ? kElementUNorm8x4 : kElementFloat4,
+		            pElements, &iNumElements, &iOffset );
+	}
+
+	*piVertexSize = iOffset;
+	return iNumElements;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Encoding
+-----------------------------------------------------------------------------------------*/
+
+// Encode the vertices of a sub-mesh in the given format, returning the transform to decode
+// positions and optionally the largest errors introduced by the encoding
+void EncodeVertices
+(
+	const SSubMesh&      subMesh,
+	const SVertexFormat& format,
+	TUInt8*              pEncoded,
+	SVertexDecode*       pDecode,
+	SVertexFormatError*  pError /*= 0*/
+)
+{
+	GEN_GUARD;
+
+	SVertexFormatError error = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+	SVertexElement aElements[kiMaxVertexElements];
+	TUInt32 iEncodedSize;
+	GetVertexElements( subMesh, format, aElements, &iEncodedSize );
+	const bool bOctDirections = (format.directions == kDirectionOct16);
+	const bool bHandednessInPosition = subMesh.hasTangents && bOctDirections;
+
+	// Scale and bias positions from the bounding box into [-1,1]. Axes with no extent are only
+	// biased. Vertices are copied out with memcpy as they may not be aligned
+	pDecode->positionScale = CVector3( 1.0f, 1.0f, 1.0f );
+	pDecode->positionBias = CVector3( 0.0f, 0.0f, 0.0f );
+	if (format.position != kPositionFloat && subMesh.numVertices > 0)
+	{
+		CVector3 vMin, vMax;
+		memcpy( &vMin, subMesh.vertices, sizeof(CVector3) );
+		vMax = vMin;
+		const TUInt8* pVertex = subMesh.vertices + subMesh.vertexSize;
+		for (TUInt32 iVertex = 1; iVertex < subMesh.numVertices; ++iVertex)
+		{
+			CVector3 vPosition;
+			memcpy( &vPosition, pVertex, sizeof(CVector3) );
+			vMin = CVector3( Min( vMin.x, vPosition.x ), Min( vMin.y, vPosition.y ), Min( vMin.z, vPosition.z ) );
+			vMax = CVector3( Max( vMax.x, vPosition.x ), Max( vMax.y, vPosition.y ), Max( vMax.z, vPosition.z ) );
+			pVertex += subMesh.vertexSize;
+		}
+		pDecode->positionBias = (vMin + vMax) * 0.5f;
+		pDecode->positionScale = (vMax - vMin) * 0.5f;
+		for (TUInt32 iAxis = 0; iAxis < 3; ++iAxis)
+		{
+			if (pDecode->positionScale[iAxis] <= 0.0f)
+			{
+				pDecode->positionScale[iAxis] = 1.0f;
+			}
+		}
+	}
+	const CVector3 vInvScale( 1.0f / pDecode->positionScale.x, 1.0f / pDecode->positionScale.y,
+	                          1.0f / pDecode->positionScale.z );
+
+	const TUInt8* pVertex = subMesh.vertices;
+	TUInt8* pOut = pEncoded;
+	for (TUInt32 iVertex = 0; iVertex < subMesh.numVertices; ++iVertex)
+	{
+		const TUInt8* pIn = pVertex;
+		TUInt32 iElement = 0;
+
+		// Position, with the tangent handedness if it is moved there
+		CVector3 vPosition;
+		memcpy( &vPosition, pIn, sizeof(CVector3) );
+		pIn += sizeof(CVector3);
+		TFloat32 fHandedness = 1.0f;
+		if (bHandednessInPosition)
+		{
+			const TUInt32 iHandednessOffset = sizeof(CVector3) +
+			                                  (subMesh.hasSkinningData ? kiSkinWeightsSize + kiSkinIndicesSize : 0) +
+			                                  (subMesh.hasNormals ? sizeof(CVector3) : 0) + 3 * sizeof(TFloat32);
+			memcpy( &fHandedness, pVertex + iHandednessOffset, sizeof(TFloat32) );
+			fHandedness = (fHandedness < 0.0f) ? -1.0f : 1.0f;
+		}
+		CVector3 vScaled = vPosition - pDecode->positionBias;
+		vScaled = CVector3( vScaled.x * vInvScale.x, vScaled.y * vInvScale.y, vScaled.z * vInvScale.z );
+		CVector3 vDecoded = EncodePosition( vScaled, fHandedness, format.position, bHandednessInPosition,
+		                                    pOut + aElements[iElement++].iOffset );
+		vDecoded = CVector3( vDecoded.x * pDecode->positionScale.x, vDecoded.y * pDecode->positionScale.y,
+		                     vDecoded.z * pDecode->positionScale.z ) + pDecode->positionBias;
+		error.fPosition = Max( error.fPosition, Length( vDecoded - vPosition ) );
+
+		// Skinning data is copied unchanged
+		if (subMesh.hasSkinningData)
+		{
+			memcpy( pOut + aElements[iElement++].iOffset, pIn, kiSkinWeightsSize );
+			memcpy( pOut + aElements[iElement++].iOffset, pIn + kiSkinWeightsSize, kiSkinIndicesSize );
+			pIn += kiSkinWeightsSize + kiSkinIndicesSize;
+		}
+
+		// Normal and tangent
+		if (subMesh.hasNormals)
+		{
+			CVector3 vNormal;
+			memcpy( &vNormal, pIn, sizeof(CVector3) );
+			pIn += sizeof(CVector3);
+			TUInt8* pOutNormal = pOut + aElements[iElement++].iOffset;
+			if (bOctDirections)
+			{
+				TInt16 aiOct[2];
+				OctEncode( vNormal, aiOct );
+				memcpy( pOutNormal, aiOct, sizeof(aiOct) );
+				error.fNormal = Max( error.fNormal, AngleBetween( vNormal, OctDecode( aiOct ) ) );
+			}
+			else
+			{
+				memcpy( pOutNormal, &vNormal, sizeof(CVector3) );
+			}
+		}
+		if (subMesh.hasTangents)
+		{
+			TUInt8* pOutTangent = pOut + aElements[iElement++].iOffset;
+			if (bOctDirections)
+			{
+				CVector3 vTangent;
+				memcpy( &vTangent, pIn, sizeof(CVector3) );
+				TInt16 aiOct[2];
+				OctEncode( vTangent, aiOct );
+				memcpy( pOutTangent, aiOct, sizeof(aiOct) );
+				error.fTangent = Max( error.fTangent, AngleBetween( vTangent, OctDecode( aiOct ) ) );
+			}
+			else
+			{
+				memcpy( pOutTangent, pIn, sizeof(CVector4) );
+			}
+			pIn += sizeof(CVector4);
+		}
+
+		// Texture coordinates
+		if (subMesh.hasTextureCoords)
+		{
+			TFloat32 afUV[2];
+			memcpy( afUV, pIn, sizeof(afUV) );
+			pIn += sizeof(afUV);
+			TUInt8* pOutUV = pOut + aElements[iElement++].iOffset;
+			const TUInt32 iComponentSize = (format.texCoords == kTexCoordHalf) ? sizeof(TUInt16) : sizeof(TFloat32);
+			for (TUInt32 iComponent = 0; iComponent < 2; ++iComponent)
+			{
+				TFloat32 fDecoded = EncodeTexCoord( afUV[iComponent], format.texCoords, pOutUV + iComponent * iComponentSize );
+				error.fTexCoord = Max( error.fTexCoord, fabsf( fDecoded - afUV[iComponent] ) );
+			}
+		}
+
+		// Colour
+		if (subMesh.hasVertexColours)
+		{
+			TFloat32 afColour[4];
+			memcpy( afColour, pIn, kiColourSize );
+			pIn += kiColourSize;
+			TUInt8* pOutColour = pOut + aElements[iElement++].iOffset;
+			if (format.colours == kColourUNorm8)
+			{
+				for (TUInt32 iComponent = 0; iComponent < 4; ++iComponent)
+				{
+					pOutColour[iComponent] = FloatToUNorm8( afColour[iComponent] );
+					error.fColour = Max( error.fColour, fabsf( UNorm8ToFloat( pOutColour[iComponent] ) - afColour[iComponent] ) );
+				}
+			}
+			else
+			{
+				memcpy( pOutColour, afColour, kiColourSize );
+			}
+		}
+
+		pVertex += subMesh.vertexSize;
+		pOut += iEncodedSize;
+	}
+
+	if (pError)
+	{
+		*pError = error;
+	}
+
+	GEN_ENDGUARD;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Scalar conversion
+-----------------------------------------------------------------------------------------*/
+
+// Convert a 32-bit float to a 16-bit (half) float, rounding to nearest even. Values too large
+// for a half become infinity, NaNs stay NaN
+TUInt16 FloatToHalf( const TFloat32 f )
+{
+	TUInt32 iBits;
+	memcpy( &iBits, &f, sizeof(iBits) );
+	const TUInt16 iSign = static_cast<TUInt16>((iBits >> 16) & 0x8000);
+	const TUInt32 iAbs = iBits & 0x7fffffff;
+
+	// Infinity and NaN, then values that round to more than the largest half (65504)
+	if (iAbs >= 0x7f800000)
+	{
+		return iSign | 0x7c00 | ((iAbs > 0x7f800000) ? 0x200 : 0);
+	}
+	if (iAbs >= 0x477ff000)
+	{
+		return iSign | 0x7c00;
+	}
+
+	// Denormal halves (below 2^-14) - scale to the denormal unit of 2^-24 and round in float,
+	// which is exact as the result is small
+	if (iAbs < 0x38800000)
+	{
+		TFloat32 fAbs;
+		memcpy( &fAbs, &iAbs, sizeof(fAbs) );
+		TFloat32 fUnits = fAbs * 16777216.0f;
+		TFloat32 fRounded = floorf( fUnits );
+		TFloat32 fRemainder = fUnits - fRounded;
+		if (fRemainder > 0.5f || (fRemainder == 0.5f && fmodf( fRounded, 2.0f ) != 0.0f))
+		{
+			fRounded += 1.0f;
+		}
+		return iSign | static_cast<TUInt16>(fRounded);
+	}
+
+	// Normal halves - rebias the exponent (127 -> 15) and round away the low 13 mantissa bits. A
+	// carry out of the mantissa correctly increments the exponent
+	TUInt32 iHalf = (iAbs - 0x38000000) >> 13;
+	const TUInt32 iRemainder = iAbs & 0x1fff;
+	if (iRemainder > 0x1000 || (iRemainder == 0x1000 && (iHalf & 1)))
+	{
+		++iHalf;
+	}
+	return iSign | static_cast<TUInt16>(iHalf);
+}
+
+// Convert a 16-bit (half) float to a 32-bit float, which is exact
+TFloat32 HalfToFloat( const TUInt16 h )
+{
+	const TUInt32 iSign = static_cast<TUInt32>(h & 0x8000) << 16;
+	const TUInt32 iExponent = (h >> 10) & 0x1f;
+	const TUInt32 iMantissa = h & 0x3ff;
+
+	TUInt32 iBits;
+	if (iExponent == 0)
+	{
+		// Zero or denormal
+		TFloat32 f = static_cast<TFloat32>(iMantissa) / 16777216.0f;
+		return iSign ? -f : f;
+	}
+	else if (iExponent == 31)
+	{
+		iBits = iSign | 0x7f800000 | (iMantissa << 13);
+	}
+	else
+	{
+		iBits = iSign | ((iExponent + 112) << 23) | (iMantissa << 13);
+	}
+	TFloat32 f;
+	memcpy( &f, &iBits, sizeof(f) );
+	return f;
+}
+
+
+} // namespace gen
@@ -0,0 +1,176 @@
+/**************************************************************************************************
+	Module:       VertexFormat.h
+	Date created: 18/10/26
+
+	Compact vertex formats for the GPU - encoding of imported sub-mesh vertices with quantised
+	positions, octahedral normals and tangents, half-float texture coordinates and 8-bit colours,
+	a platform-neutral description of the encoded vertex elements, and analysis of the error
+	introduced by the encoding
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#ifndef GEN_VERTEX_FORMAT_H_INCLUDED
+#define GEN_VERTEX_FORMAT_H_INCLUDED
+
+#include "GenDefines.h"
+#include "CVector3.h"
+#include "MeshData.h"
+
+namespace gen
+{
+
+/////////////////////////////////////
+// Vertex formats
+
+// Encoding of vertex positions
+enum EPositionEncoding
+{
+	kPositionFloat,   // 3 x 32-bit float as imported (12 bytes). 4 floats (16 bytes) if the tangent
+	                  // handedness is stored with the position (see EDirectionEncoding)
+	kPositionHalf,    // 4 x 16-bit float (8 bytes), scaled and biased into [-1,1] (see SVertexDecode)
+	kPositionSNorm16, // 4 x 16-bit signed normalised (8 bytes), scaled and biased into [-1,1]. More
+	                  // precise than half floats and the usual choice
+};
+
+// Encoding of vertex normals and tangents
+enum EDirectionEncoding
+{
+	kDirectionFloat,  // Normal 3 x 32-bit float (12 bytes), tangent 4 x 32-bit float with the
+	                  // texture handedness in w (16 bytes), as imported
+	kDirectionOct16,  // Octahedral mapping of the unit sphere onto a square, 2 x 16-bit signed
+	                  // normalised (4 bytes each). The tangent handedness (+1 or -1) is moved to
+	                  // the w component of the position
+};
+
+// Encoding of texture coordinates
+enum ETexCoordEncoding
+{
+	kTexCoordFloat,   // 2 x 32-bit float (8 bytes)
+	kTexCoordHalf,    // 2 x 16-bit float (4 bytes), exact to 1/2048 of a texture repeat near 0-1
+};
+
+// Encoding of vertex colours
+enum EColourEncoding
+{
+	kColourFloat,     // 4 x 32-bit float (16 bytes)
+	kColourUNorm8,    // 4 x 8-bit unsigned normalised (4 bytes), clamped to 0-1
+};
+
+// Encoding of each vertex component. Components not present in a sub-mesh are ignored. Skinning
+// data (4 float weights and 4 byte bone indices) is always kept as imported
+struct SVertexFormat
+{
+	EPositionEncoding  position;
+	EDirectionEncoding directions; // Normals and tangents
+	ETexCoordEncoding  texCoords;
+	EColourEncoding    colours;
+};
+
+// Vertices exactly as imported
+const SVertexFormat kVertexFormatFloat = { kPositionFloat, kDirectionFloat, kTexCoordFloat,
+                                           kColourFloat };
+
+// Smallest format, with errors too small to see for typical models (see MeshBench -format). A
+// vertex with normal, tangent and UVs is 20 bytes rather than 48
+const SVertexFormat kVertexFormatCompact = { kPositionSNorm16, kDirectionOct16, kTexCoordHalf,
+                                             kColourUNorm8 };
+
+// Do two formats encode vertices the same way
+inline bool operator==( const SVertexFormat& a, const SVertexFormat& b )
+{
+	return a.position == b.position && a.directions == b.directions &&
+	       a.texCoords == b.texCoords && a.colours == b.colours;
+}
+
+
+/////////////////////////////////////
+// Vertex elements
+
+// Data format of a single element, named as the D3D DXGI formats they correspond to
+enum EVertexElementFormat
+{
+	kElementFloat2,      // R32G32_FLOAT
+	kElementFloat3,      // R32G32B32_FLOAT
+	kElementFloat4,      // R32G32B32A32_FLOAT
+	kElementHalf2,       // R16G16_FLOAT
+	kElementHalf4,       // R16G16B16A16_FLOAT
+	kElementSNorm16x2,   // R16G16_SNORM
+	kElementSNorm16x4,   // R16G16B16A16_SNORM
+	kElementUNorm8x4,    // R8G8B8A8_UNORM
+	kElementUInt8x4,     // R8G8B8A8_UINT
+};
+
+// A single element of an encoded vertex
+struct SVertexElement
+{
+	const char*          sSemantic; // Shader semantic, e.g. "POSITION", always semantic index 0
+	EVertexElementFormat eFormat;
+	TUInt32              iOffset;   // Offset in bytes from the start of the vertex
+};
+
+// Maximum number of elements in a vertex (position, bone weights, bone indices, normal,
+// tangent, texture coordinates, colour)
+const TUInt32 kiMaxVertexElements = 7;
+
+// Get the elements of vertices encoded in the given format for a sub-mesh with the given
+// components. Fills up to kiMaxVertexElements elements and returns the number used. The size of
+// an encoded vertex is returned through the final parameter
+TUInt32 GetVertexElements
+(
+	const SSubMesh&      layout,
+	const SVertexFormat& format,
+	SVertexElement*      pElements,
+	TUInt32*             piVertexSize
+);
+
+
+/////////////////////////////////////
+// Encoding
+
+// Scale and bias to decode encoded positions into model space, which must be passed to the
+// vertex shader: position = encoded.xyz * scale + bias. Identity for float positions
+struct SVertexDecode
+{
+	CVector3 positionScale;
+	CVector3 positionBias;
+};
+
+// Largest error of any vertex in an encoded sub-mesh, measured by decoding each vertex as the
+// GPU will. Errors for components not in the sub-mesh are 0
+struct SVertexFormatError
+{
+	TFloat32 fPosition;    // Distance from the original position (model units)
+	TFloat32 fNormal;      // Angle from the original normal (degrees)
+	TFloat32 fTangent;     // Angle from the original tangent (degrees)
+	TFloat32 fTexCoord;    // Difference of a texture coordinate
+	TFloat32 fColour;      // Difference of a colour component (0-1)
+};
+
+// Encode the vertices of a sub-mesh in the given format. The output must have space for the
+// sub-mesh's number of vertices times the vertex size from GetVertexElements. Positions are
+// scaled and biased to fill [-1,1] on each axis of the sub-mesh's bounding box, the decoding
+// transform is returned. Optionally returns the largest errors introduced by the encoding
+void EncodeVertices
+(
+	const SSubMesh&      subMesh,
+	const SVertexFormat& format,
+	TUInt8*              pEncoded,
+	SVertexDecode*       pDecode,
+	SVertexFormatError*  pError = 0
+);
+
+
+/////////////////////////////////////
+// Scalar conversion
+
+// Convert between 32-bit and 16-bit (half) floats. Rounds to nearest even, values too large
+// for a half become infinity
+TUInt16 FloatToHalf( const TFloat32 f );
+TFloat32 HalfToFloat( const TUInt16 h );
+
+
+} // namespace gen
+
+#endif // GEN_VERTEX_FORMAT_H_INCLUDED
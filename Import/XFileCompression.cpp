@@ -0,0 +1,546 @@
+/**************************************************************************************************
+	Module:       XFileCompression.cpp
+	Date created: 18/10/26
+
+	Decompression of the MSZip compressed encodings of Microsoft DirectX .X files ("xof 0303tzip"
+	and "xof 0303bzip"), with no dependency on the D3DX X-file API
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#include <string.h>
+
+#include "XFileCompression.h"
+#include "Error.h"
+
+namespace gen
+{
+
+namespace
+{
+	// Size of the fixed X-file header: "xof 0303tzip0032", and the largest uncompressed chunk
+	const TUInt32 kiHeaderSize = 16;
+	const TUInt32 kiMaxChunkSize = 32768;
+
+	// The most a deflate stream can expand, used to check the uncompressed size in the file
+	const TUInt32 kiMaxExpansion = 1032;
+
+	// Deflate Huffman codes are at most 15 bits. Codes of up to kiFastBits are decoded with a
+	// single table lookup, longer codes a bit at a time
+	const TUInt32 kiMaxCodeBits = 15;
+	const TUInt32 kiFastBits = 10;
+	const TUInt32 kiMaxSymbols = 288;
+
+	// Base values and extra bits for length and distance symbols, and the order that code length
+	// code lengths are stored in (RFC 1951 section 3.2.5 and 3.2.7)
+	const TUInt16 kaiLengthBase[29] =
+	{
+		3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115,
+		131, 163, 195, 227, 258
+	};
+	const TUInt8 kaiLengthExtraBits[29] =
+	{
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+	};
+	const TUInt16 kaiDistanceBase[30] =
+	{
+		1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537,
+		2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+	};
+	const TUInt8 kaiDistanceExtraBits[30] =
+	{
+		0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12,
+		13, 13
+	};
+	const TUInt8 kaiCodeLengthOrder[19] =
+	{
+		16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+	};
+
+	inline TUInt32 ReadWord( const TUInt8* p )
+	{
+		return p[0] | (p[1] << 8);
+	}
+	inline TUInt32 ReadDWord( const TUInt8* p )
+	{
+		return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<TUInt32>(p[3]) << 24);
+	}
+
+
+	// A canonical Huffman code, with a lookup table for the shorter codes
+	struct SHuffmanCode
+	{
+		TUInt16 aiFast[1 << kiFastBits];     // Symbol << 4 | code length, 0 for longer codes
+		TUInt16 aiCounts[kiMaxCodeBits + 1]; // Number of codes of each length
+		TUInt16 aiSymbols[kiMaxSymbols];     // Symbols ordered by code
+	};
+
+	// Build a Huffman code from the code length of each symbol (0 for unused symbols). Returns
+	// false if the lengths do not form a valid code. Incomplete codes are allowed, unused codes
+	// are an error when decoded
+	bool BuildCode
+	(
+		const TUInt8*  pLengths,
+		const TUInt32  iNumSymbols,
+		SHuffmanCode*  pCode
+	)
+	{
+		memset( pCode->aiCounts, 0, sizeof(pCode->aiCounts) );
+		for (TUInt32 iSymbol = 0; iSymbol < iNumSymbols; ++iSymbol)
+		{
+			++pCode->aiCounts[pLengths[iSymbol]];
+		}
+		pCode->aiCounts[0] = 0;
+
+		TInt32 iCodesLeft = 1;
+		for (TUInt32 iLength = 1; iLength <= kiMaxCodeBits; ++iLength)
+		{
+			iCodesLeft = (iCodesLeft << 1) - pCode->aiCounts[iLength];
+			if (iCodesLeft < 0)
+			{
+				return false;
+			}
+		}
+
+		// Order the symbols by code length, then by symbol
+		TUInt16 aiOffsets[kiMaxCodeBits + 1];
+		aiOffsets[1] = 0;
+		for (TUInt32 iLength = 1; iLength < kiMaxCodeBits; ++iLength)
+		{
+			aiOffsets[iLength + 1] = aiOffsets[iLength] + pCode->aiCounts[iLength];
+		}
+		for (TUInt32 iSymbol = 0; iSymbol < iNumSymbols; ++iSymbol)
+		{
+			if (pLengths[iSymbol])
+			{
+				pCode->aiSymbols[aiOffsets[pLengths[iSymbol]]++] = static_cast<TUInt16>(iSymbol);
+			}
+		}
+
+		// Fill the lookup table for the short codes. Codes are stored most significant bit first
+		// but bits are read from the least significant end, so the table index is the reversed code
+		memset( pCode->aiFast, 0, sizeof(pCode->aiFast) );
+		TUInt32 iCode = 0;
+		TUInt32 iIndex = 0;
+		for (TUInt32 iLength = 1; iLength <= kiFastBits; ++iLength)
+		{
+			for (TUInt32 iCount = 0; iCount < pCode->aiCounts[iLength]; ++iCount, ++iCode, ++iIndex)
+			{
+				TUInt32 iReversed = 0;
+				for (TUInt32 iBit = 0; iBit < iLength; ++iBit)
+				{
+					iReversed |= ((iCode >> iBit) & 1) << (iLength - 1 - iBit);
+				}
+				TUInt16 iEntry = static_cast<TUInt16>((pCode->aiSymbols[iIndex] << 4) | iLength);
+				for (TUInt32 iFast = iReversed; iFast < (1u << kiFastBits); iFast += 1u << iLength)
+				{
+					pCode->aiFast[iFast] = iEntry;
+				}
+			}
+			iCode <<= 1;
+		}
+		return true;
+	}
+
+
+	// Decoder for a single deflate stream. Output is written to a buffer that also holds the data
+	// from earlier chunks, which the stream may copy from
+	class CInflater
+	{
+	public:
+		CInflater
+		(
+			const TUInt8* pInput,
+			const TUInt32 iInputSize
+		)
+		{
+			m_pIn = pInput;
+			m_pInEnd = pInput + iInputSize;
+			m_iBits = 0;
+			m_iNumBits = 0;
+			m_iNumPadBits = 0;
+		}
+
+		// Decode the stream into [pOut, pOutEnd), which must be filled exactly. Data before pOut
+		// back to pHistory may be referred to by the stream
+		bool Inflate
+		(
+			const TUInt8* pHistory,
+			TUInt8*       pOut,
+			TUInt8*       pOutEnd
+		)
+		{
+			m_pHistory = pHistory;
+			m_pOut = pOut;
+			m_pOutEnd = pOutEnd;
+
+			bool bFinalBlock;
+			do
+			{
+				bFinalBlock = (GetBits( 1 ) != 0);
+				TUInt32 iBlockType = GetBits( 2 );
+				bool bValid;
+				if (iBlockType == 0)
+				{
+					bValid = InflateStored();
+				}
+				else if (iBlockType == 1)
+				{
+					bValid = InflateFixed();
+				}
+				else if (iBlockType == 2)
+				{
+					bValid = InflateDynamic();
+				}
+				else
+				{
+					bValid = false;
+				}
+				if (!bValid || IsOverrun())
+				{
+					return false;
+				}
+			} while (!bFinalBlock);
+
+			return m_pOut == m_pOutEnd;
+		}
+
+	private:
+		// Keep at least 57 bits in the bit buffer, padding with zeros past the end of the input
+		void Refill()
+		{
+			while (m_iNumBits <= 56)
+			{
+				TUInt64 iByte = 0;
+				if (m_pIn != m_pInEnd)
+				{
+					iByte = *m_pIn++;
+				}
+				else
+				{
+					m_iNumPadBits += 8;
+				}
+				m_iBits |= iByte << m_iNumBits;
+				m_iNumBits += 8;
+			}
+		}
+
+		// Have more bits been used than were in the input
+		bool IsOverrun() const
+		{
+			return m_iNumBits < m_iNumPadBits;
+		}
+
+		TUInt32 GetBits( const TUInt32 iNumBits )
+		{
+			if (m_iNumBits < iNumBits)
+			{
+				Refill();
+			}
+			TUInt32 iValue = static_cast<TUInt32>(m_iBits & ((1ull << iNumBits) - 1));
+			m_iBits >>= iNumBits;
+			m_iNumBits -= iNumBits;
+			return iValue;
+		}
+
+		// Decode a symbol with the given code, returns -1 for an invalid code
+		TInt32 Decode( const SHuffmanCode& code )
+		{
+			if (m_iNumBits < kiMaxCodeBits)
+			{
+				Refill();
+			}
+			TUInt32 iEntry = code.aiFast[m_iBits & ((1u << kiFastBits) - 1)];
+			if (iEntry)
+			{
+				m_iBits >>= iEntry & 15;
+				m_iNumBits -= iEntry & 15;
+				return iEntry >> 4;
+			}
+
+			// Longer codes, read a bit at a time
+			TInt32 iCode = 0;
+			TInt32 iFirst = 0;
+			TInt32 iIndex = 0;
+			for (TUInt32 iLength = 1; iLength <= kiMaxCodeBits; ++iLength)
+			{
+				iCode |= static_cast<TInt32>(m_iBits & 1);
+				m_iBits >>= 1;
+				--m_iNumBits;
+				TInt32 iCount = code.aiCounts[iLength];
+				if (iCode - iFirst < iCount)
+				{
+					return code.aiSymbols[iIndex + iCode - iFirst];
+				}
+				iIndex += iCount;
+				iFirst = (iFirst + iCount) << 1;
+				iCode <<= 1;
+			}
+			return -1;
+		}
+
+		// Uncompressed block: byte aligned length, its complement, then the data
+		bool InflateStored()
+		{
+			GetBits( m_iNumBits & 7 );
+			TUInt32 iLength = GetBits( 16 );
+			if (GetBits( 16 ) != (~iLength & 0xffff) || iLength > static_cast<TUInt32>(m_pOutEnd - m_pOut))
+			{
+				return false;
+			}
+
+			// Use the bytes left in the bit buffer, then copy directly from the input
+			while (iLength && m_iNumBits >= 8)
+			{
+				*m_pOut++ = static_cast<TUInt8>(GetBits( 8 ));
+				--iLength;
+			}
+			if (IsOverrun() || iLength > static_cast<TUInt32>(m_pInEnd - m_pIn))
+			{
+				return false;
+			}
+			memcpy( m_pOut, m_pIn, iLength );
+			m_pOut += iLength;
+			m_pIn += iLength;
+			return true;
+		}
+
+		// Block compressed with the fixed codes
+		bool InflateFixed()
+		{
+			TUInt8 aiLengths[kiMaxSymbols];
+			memset( aiLengths, 8, 144 );
+			memset( aiLengths + 144, 9, 112 );
+			memset( aiLengths + 256, 7, 24 );
+			memset( aiLengths + 280, 8, 8 );
+			BuildCode( aiLengths, kiMaxSymbols, &m_LiteralCode );
+			memset( aiLengths, 5, 30 );
+			BuildCode( aiLengths, 30, &m_DistanceCode );
+			return InflateCodes();
+		}
+
+		// Block compressed with codes given at the start of the block, which are themselves
+		// compressed with a code length code
+		bool InflateDynamic()
+		{
+			TUInt32 iNumLiteralCodes = GetBits( 5 ) + 257;
+			TUInt32 iNumDistanceCodes = GetBits( 5 ) + 1;
+			TUInt32 iNumLengthCodes = GetBits( 4 ) + 4;
+			if (iNumLiteralCodes > 286 || iNumDistanceCodes > 30)
+			{
+				return false;
+			}
+
+			TUInt8 aiLengths[286 + 30];
+			memset( aiLengths, 0, 19 );
+			for (TUInt32 iCode = 0; iCode < iNumLengthCodes; ++iCode)
+			{
+				aiLengths[kaiCodeLengthOrder[iCode]] = static_cast<TUInt8>(GetBits( 3 ));
+			}
+			if (!BuildCode( aiLengths, 19, &m_LiteralCode ))
+			{
+				return false;
+			}
+
+			// Read the literal / length and distance code lengths as one list
+			TUInt32 iNumLengths = iNumLiteralCodes + iNumDistanceCodes;
+			TUInt32 iLength = 0;
+			while (iLength < iNumLengths)
+			{
+				TInt32 iSymbol = Decode( m_LiteralCode );
+				if (iSymbol < 0)
+				{
+					return false;
+				}
+				if (iSymbol < 16)
+				{
+					aiLengths[iLength++] = static_cast<TUInt8>(iSymbol);
+					continue;
+				}
+
+				// Repeat the previous length, or zeros
+				TUInt8  iRepeatLength = 0;
+				TUInt32 iRepeat;
+				if (iSymbol == 16)
+				{
+					if (iLength == 0)
+					{
+						return false;
+					}
+					iRepeatLength = aiLengths[iLength - 1];
+					iRepeat = 3 + GetBits( 2 );
+				}
+				else if (iSymbol == 17)
+				{
+					iRepeat = 3 + GetBits( 3 );
+				}
+				else
+				{
+					iRepeat = 11 + GetBits( 7 );
+				}
+				if (iLength + iRepeat > iNumLengths)
+				{
+					return false;
+				}
+				memset( aiLengths + iLength, iRepeatLength, iRepeat );
+				iLength += iRepeat;
+			}
+
+			// There must be an end of block code
+			if (aiLengths[256] == 0 || IsOverrun() ||
+			    !BuildCode( aiLengths, iNumLiteralCodes, &m_LiteralCode ) ||
+			    !BuildCode( aiLengths + iNumLiteralCodes, iNumDistanceCodes, &m_DistanceCode ))
+			{
+				return false;
+			}
+			return InflateCodes();
+		}
+
+		// Decode literals and length / distance pairs until the end of block code
+		bool InflateCodes()
+		{
+			while (!IsOverrun())
+			{
+				TInt32 iSymbol = Decode( m_LiteralCode );
+				if (iSymbol < 256)
+				{
+					if (iSymbol < 0 || m_pOut == m_pOutEnd)
+					{
+						return false;
+					}
+					*m_pOut++ = static_cast<TUInt8>(iSymbol);
+				}
+				else if (iSymbol == 256)
+				{
+					return true;
+				}
+				else
+				{
+					// Copy earlier output, the source may overlap the destination
+					iSymbol -= 257;
+					if (iSymbol >= 29)
+					{
+						return false;
+					}
+					TUInt32 iLength = kaiLengthBase[iSymbol] + GetBits( kaiLengthExtraBits[iSymbol] );
+					TInt32 iDistanceSymbol = Decode( m_DistanceCode );
+					if (iDistanceSymbol < 0 || iDistanceSymbol >= 30)
+					{
+						return false;
+					}
+					TUInt32 iDistance = kaiDistanceBase[iDistanceSymbol] +
+					                    GetBits( kaiDistanceExtraBits[iDistanceSymbol] );
+					if (iDistance > static_cast<TUInt32>(m_pOut - m_pHistory) ||
+					    iLength > static_cast<TUInt32>(m_pOutEnd - m_pOut))
+					{
+						return false;
+					}
+					const TUInt8* pCopy = m_pOut - iDistance;
+					if (iDistance >= iLength)
+					{
+						memcpy( m_pOut, pCopy, iLength );
+					}
+					else
+					{
+						for (TUInt32 iByte = 0; iByte < iLength; ++iByte)
+						{
+							m_pOut[iByte] = pCopy[iByte];
+						}
+					}
+					m_pOut += iLength;
+				}
+			}
+			return false;
+		}
+
+		// Input data and the bit buffer. Bits are read from the least significant end. Zeros
+		// added past the end of the input are counted to detect reading too far
+		const TUInt8* m_pIn;
+		const TUInt8* m_pInEnd;
+		TUInt64       m_iBits;
+		TUInt32       m_iNumBits;
+		TUInt32       m_iNumPadBits;
+
+		// Start of the data that may be copied from, and the output position and end
+		const TUInt8* m_pHistory;
+		TUInt8*       m_pOut;
+		TUInt8*       m_pOutEnd;
+
+		// Codes for the current block
+		SHuffmanCode  m_LiteralCode;
+		SHuffmanCode  m_DistanceCode;
+	};
+}
+
+
+// Tests if the given file contents start with a compressed X-file header (text or binary, any
+// version, either float size)
+bool IsCompressedXFile
+(
+	const TUInt8* pData,
+	const TUInt32 iSize
+)
+{
+	return iSize >= kiHeaderSize && memcmp( pData, "xof ", 4 ) == 0 &&
+	       (memcmp( pData + 8, "tzip", 4 ) == 0 || memcmp( pData + 8, "bzip", 4 ) == 0);
+}
+
+
+// Decompress a compressed X-file. The output is the equivalent uncompressed file, starting with
+// a text or binary header, so can be read with CXFileTextReader or CXFileBinaryReader
+bool DecompressXFile
+(
+	const TUInt8*   pData,
+	const TUInt32   iSize,
+	vector<TUInt8>* pDecompressed
+)
+{
+	GEN_GUARD;
+
+	if (!IsCompressedXFile( pData, iSize ) || iSize < kiHeaderSize + 4)
+	{
+		return false;
+	}
+
+	// Copy the header, changing the format to the uncompressed equivalent. The total size is
+	// only a hint, it is not consistently given with or without the header
+	pDecompressed->assign( pData, pData + kiHeaderSize );
+	memcpy( &(*pDecompressed)[8], pData[8] == 't' ? "txt " : "bin ", 4 );
+	TUInt32 iTotalSize = ReadDWord( pData + kiHeaderSize );
+	if (iTotalSize / kiMaxExpansion <= iSize)
+	{
+		pDecompressed->reserve( iTotalSize + kiHeaderSize );
+	}
+
+	// Decompress each chunk onto the end of the output
+	const TUInt8* pChunk = pData + kiHeaderSize + 4;
+	const TUInt8* pEnd = pData + iSize;
+	while (pEnd - pChunk >= 4)
+	{
+		TUInt32 iChunkSize = ReadWord( pChunk );
+		TUInt32 iCompressedSize = ReadWord( pChunk + 2 );
+		pChunk += 4;
+		if (iChunkSize > kiMaxChunkSize || iCompressedSize < 2 ||
+		    iCompressedSize > static_cast<TUInt32>(pEnd - pChunk) || pChunk[0] != 'C' || pChunk[1] != 'K')
+		{
+			return false;
+		}
+
+		size_t iChunkStart = pDecompressed->size();
+		pDecompressed->resize( iChunkStart + iChunkSize );
+		TUInt8* pOut = &(*pDecompressed)[0];
+		CInflater inflater( pChunk + 2, iCompressedSize - 2 );
+		if (!inflater.Inflate( pOut + kiHeaderSize, pOut + iChunkStart, pOut + iChunkStart + iChunkSize ))
+		{
+			return false;
+		}
+		pChunk += iCompressedSize;
+	}
+	return true;
+
+	GEN_ENDGUARD;
+}
+
+
+} // namespace gen
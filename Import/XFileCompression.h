@@ -0,0 +1,47 @@
+/**************************************************************************************************
+	Module:       XFileCompression.h
+	Date created: 18/10/26
+
+	Decompression of the MSZip compressed encodings of Microsoft DirectX .X files ("xof 0303tzip"
+	and "xof 0303bzip"), with no dependency on the D3DX X-file API
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#ifndef GEN_XFILE_COMPRESSION_H_INCLUDED
+#define GEN_XFILE_COMPRESSION_H_INCLUDED
+
+#include <vector>
+using namespace std;
+
+#include "GenDefines.h"
+
+namespace gen
+{
+
+// Tests if the given file contents start with a compressed X-file header (text or binary, any
+// version, either float size)
+bool IsCompressedXFile
+(
+	const TUInt8* pData,
+	const TUInt32 iSize
+);
+
+// Decompress a compressed X-file. The output is the equivalent uncompressed file, starting with
+// a text or binary header, so can be read with CXFileTextReader or CXFileBinaryReader
+// A compressed file has a DWORD total uncompressed size after the header, then a series of
+// chunks of up to 32KB of uncompressed data. Each chunk is a WORD uncompressed size, a WORD
+// compressed size and the compressed data: "CK" then a deflate stream (RFC 1951) that may refer
+// back to the data of earlier chunks. Returns false if the data is not valid
+bool DecompressXFile
+(
+	const TUInt8*   pData,
+	const TUInt32   iSize,
+	vector<TUInt8>* pDecompressed
+);
+
+
+} // namespace gen
+
+#endif // GEN_XFILE_COMPRESSION_H_INCLUDED
@@ -0,0 +1,53 @@
+/**************************************************************************************************
+	Module:       HeapCounter.cpp
+	Date created: 18/10/26
+
+	Count of the heap allocations made by MeshBench, through a replacement of the global operator
+	new that counts each call. Used to report the allocations of an import
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#include <cstdlib>
+#include <new>
+#include <atomic>
+
+#include "HeapCounter.h"
+
+namespace
+{
+	// Relaxed, only the total is needed and not an order with other memory operations
+	std::atomic<gen::TUInt64> NumHeapAllocations( 0 );
+}
+
+
+// Replacements of the global allocation functions. The array and nothrow forms call these, so
+// only the single forms are replaced
+void* operator new( size_t iSize )
+{
+	NumHeapAllocations.fetch_add( 1, std::memory_order_relaxed );
+	void* pMemory = malloc( iSize ? iSize : 1 );
+	if (!pMemory)
+	{
+		throw std::bad_alloc();
+	}
+	return pMemory;
+}
+
+void operator delete( void* pMemory ) noexcept
+{
+	free( pMemory );
+}
+
+
+namespace gen
+{
+
+TUInt64 GetNumHeapAllocations()
+{
+	return NumHeapAllocations.load( std::memory_order_relaxed );
+}
+
+
+} // namespace gen
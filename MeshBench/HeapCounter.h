@@ -0,0 +1,27 @@
+/**************************************************************************************************
+	Module:       HeapCounter.h
+	Date created: 18/10/26
+
+	Count of the heap allocations made by MeshBench, through a replacement of the global operator
+	new that counts each call. Used to report the allocations of an import
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#ifndef GEN_HEAP_COUNTER_H_INCLUDED
+#define GEN_HEAP_COUNTER_H_INCLUDED
+
+#include "GenDefines.h"
+
+namespace gen
+{
+
+// Number of calls to the global operator new (single and array forms) since the program started,
+// on any thread. Take the difference of two calls to count the allocations made in between
+TUInt64 GetNumHeapAllocations();
+
+
+} // namespace gen
+
+#endif // GEN_HEAP_COUNTER_H_INCLUDED
@@ -0,0 +1,1055 @@
+/**************************************************************************************************
+	Module:       ImportBenchmarks.cpp
+	Date created: 18/10/26
+
+	Benchmarks of the import library, run on X-files without a GPU. Each benchmark reads the file
+	itself, as many times as it needs to time it
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <fstream>
+#if defined(_MSC_VER)
+	#define NOMINMAX
+	#include <windows.h>
+	#include <psapi.h>
+	#pragma comment(lib, "psapi.lib")
+#endif
+
+#include "ImportBenchmarks.h"
+#include "SyntheticMesh.h"
+#include "HeapCounter.h"
+#include "CXFileTextReader.h"
+#include "CXFileBinaryWriter.h"
+#include "CMappedFile.h"
+#include "CCookedMesh.h"
+#include "CThreadPool.h"
+#include "Error.h"
+
+namespace gen
+{
+
+namespace
+{
+	// Imports are repeated until both of these are reached
+	const TUInt32  kiMinImports = 3;
+	const TFloat64 kfMinSeconds = 0.5;
+
+	// Import a file repeatedly, adding the statistics of every import to the given object.
+	// Returns the number of imports through piNumImports
+	EImportError TimeImports
+	(
+		const string& sFileName,
+		CImportStats* pStats,
+		TUInt32*      piNumImports
+	)
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		TFloat64 fTime;
+		*piNumImports = 0;
+		do
+		{
+			CImportXFile importFile;
+			importFile.SetImportStats( pStats );
+			EImportError eError = importFile.ImportFile( sFileName );
+			if (eError != kSuccess)
+			{
+				return eError;
+			}
+			++*piNumImports;
+			fTime = chrono::duration<TFloat64>( chrono::steady_clock::now() - start ).count();
+		} while (*piNumImports < kiMinImports || fTime < kfMinSeconds);
+		return kSuccess;
+	}
+
+	// Save data to a file, replacing any existing file. Returns false on failure
+	bool SaveFile
+	(
+		const string&         sFileName,
+		const vector<TUInt8>& data
+	)
+	{
+		FILE* pFile = fopen( sFileName.c_str(), "wb" );
+		if (!pFile)
+		{
+			return false;
+		}
+		bool bWritten = fwrite( &data[0], 1, data.size(), pFile ) == data.size();
+		return (fclose( pFile ) == 0) && bWritten;
+	}
+
+
+	// Load a list of files with CCookedMesh on a pool of threads, one task per file, and wait for
+	// all of them. If bCook is set every file is cooked (a cold import that writes the cooked file),
+	// otherwise loaded from the cooked file written by an earlier cook
+	EImportError LoadFiles
+	(
+		const vector<string>& fileNames,
+		const bool            bCook,
+		CThreadPool*          pThreadPool
+	)
+	{
+		vector< future<EImportError> > results;
+		for (TUInt32 iFile = 0; iFile < fileNames.size(); ++iFile)
+		{
+			const string& sFileName = fileNames[iFile];
+			results.push_back( pThreadPool->Submit( [&sFileName, bCook]() -> EImportError
+			{
+				if (bCook)
+				{
+					return CCookedMesh::CookFile( sFileName );
+				}
+				CCookedMesh cookedMesh;
+				EImportError eError = cookedMesh.Load( sFileName );
+				return (eError == kSuccess && !cookedMesh.IsFromCache()) ? kFileError : eError;
+			} ) );
+		}
+		EImportError eError = kSuccess;
+		for (TUInt32 iFile = 0; iFile < results.size(); ++iFile)
+		{
+			EImportError eFileError = results[iFile].get();
+			eError = (eError == kSuccess) ? eFileError : eError;
+		}
+		return eError;
+	}
+
+	// Process memory in bytes, the current resident set (working set on Windows) and its peak
+	// since the process started or the last successful ResetPeakMemory
+	void GetProcessMemory
+	(
+		TUInt64* piCurrent,
+		TUInt64* piPeak
+	)
+	{
+		*piCurrent = *piPeak = 0;
+	#if defined(_MSC_VER)
+		PROCESS_MEMORY_COUNTERS counters;
+		if (GetProcessMemoryInfo( GetCurrentProcess(), &counters, sizeof(counters) ))
+		{
+			*piCurrent = counters.WorkingSetSize;
+			*piPeak = counters.PeakWorkingSetSize;
+		}
+	#else
+		ifstream status( "/proc/self/status" );
+		string sLine;
+		while (getline( status, sLine ))
+		{
+			TUInt64* piValue = (sLine.compare( 0, 6, "VmRSS:" ) == 0) ? piCurrent :
+			                   (sLine.compare( 0, 6, "VmHWM:" ) == 0) ? piPeak : 0;
+			if (piValue)
+			{
+				*piValue = strtoull( sLine.c_str() + 6, 0, 10 ) * 1024; // Given in kB
+			}
+		}
+	#endif
+	}
+
+	// Reset the peak of the process memory to its current size. Only supported on Linux, returns
+	// false elsewhere or on failure
+	bool ResetPeakMemory()
+	{
+	#if defined(_MSC_VER)
+		return false;
+	#else
+		ofstream clearRefs( "/proc/self/clear_refs" );
+		clearRefs << "5";
+		clearRefs.close();
+		return !clearRefs.fail();
+	#endif
+	}
+
+	// Streaming import callback that ignores the data, it is freed when each call returns
+	class CDiscardCallback : public CImportCallback
+	{
+	public:
+		void OnNode( const TUInt32, const SMeshNode& ) {}
+		void OnMaterial( const TUInt32, const SMeshMaterial& ) {}
+		void OnSubMesh( const SSubMesh& ) {}
+	};
+
+	/////////////////////////////////////
+	// MSZip compression
+
+	// Length and distance codes of the deflate format (RFC 1951)
+	const TUInt16 kaiLengthBase[29] =
+	{
+		3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115,
+		131, 163, 195, 227, 258
+	};
+	const TUInt8 kaiLengthExtraBits[29] =
+	{
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+	};
+	const TUInt16 kaiDistanceBase[30] =
+	{
+		1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537,
+		2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+	};
+	const TUInt8 kaiDistanceExtraBits[30] =
+	{
+		0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+	};
+
+	// Size of the X-file header and of the uncompressed data in each chunk of a compressed file
+	const TUInt32 kiHeaderSize = 16;
+	const TUInt32 kiChunkSize = 32768;
+
+	// Matches are searched for in the previous 32KB, following a chain of earlier positions with
+	// the same hash of their first three bytes
+	const TUInt32 kiWindowSize = 32768;
+	const TUInt32 kiMinMatch = 3;
+	const TUInt32 kiMaxMatch = 258;
+	const TUInt32 kiMaxChainSteps = 32;
+	const TUInt32 kiHashBits = 15;
+
+	// Writes a deflate block with the fixed codes onto the end of a byte vector
+	class CDeflateWriter
+	{
+	public:
+		CDeflateWriter( vector<TUInt8>* pOut )
+		{
+			m_pOut = pOut;
+			m_iBits = 0;
+			m_iNumBits = 0;
+		}
+
+		// Write bits, least significant first
+		void PutBits
+		(
+			const TUInt32 iValue,
+			const TUInt32 iNumBits
+		)
+		{
+			m_iBits |= static_cast<TUInt64>(iValue) << m_iNumBits;
+			m_iNumBits += iNumBits;
+			while (m_iNumBits >= 8)
+			{
+				m_pOut->push_back( static_cast<TUInt8>(m_iBits) );
+				m_iBits >>= 8;
+				m_iNumBits -= 8;
+			}
+		}
+
+		// Write a Huffman code, most significant bit first
+		void PutCode
+		(
+			TUInt32       iCode,
+			const TUInt32 iLength
+		)
+		{
+			TUInt32 iReversed = 0;
+			for (TUInt32 iBit = 0; iBit < iLength; ++iBit)
+			{
+				iReversed = (iReversed << 1) | (iCode & 1);
+				iCode >>= 1;
+			}
+			PutBits( iReversed, iLength );
+		}
+
+		// Write a literal / length symbol (256 ends the block)
+		void PutSymbol( const TUInt32 iSymbol )
+		{
+			if (iSymbol < 144)
+			{
+				PutCode( 0x30 + iSymbol, 8 );
+			}
+			else if (iSymbol < 256)
+			{
+				PutCode( 0x190 + iSymbol - 144, 9 );
+			}
+			else if (iSymbol < 280)
+			{
+				PutCode( iSymbol - 256, 7 );
+			}
+			else
+			{
+				PutCode( 0xc0 + iSymbol - 280, 8 );
+			}
+		}
+
+		// Write a copy of earlier output
+		void PutMatch
+		(
+			const TUInt32 iLength,
+			const TUInt32 iDistance
+		)
+		{
+			TUInt32 iCode = 28;
+			while (kaiLengthBase[iCode] > iLength) --iCode;
+			PutSymbol( 257 + iCode );
+			PutBits( iLength - kaiLengthBase[iCode], kaiLengthExtraBits[iCode] );
+
+			iCode = 29;
+			while (kaiDistanceBase[iCode] > iDistance) --iCode;
+			PutCode( iCode, 5 );
+			PutBits( iDistance - kaiDistanceBase[iCode], kaiDistanceExtraBits[iCode] );
+		}
+
+		// Write any bits left over, padded to a whole byte
+		void Flush()
+		{
+			if (m_iNumBits > 0)
+			{
+				PutBits( 0, 8 - m_iNumBits );
+			}
+		}
+
+	private:
+		vector<TUInt8>* m_pOut;
+		TUInt64         m_iBits;
+		TUInt32         m_iNumBits;
+	};
+
+	// Hash of the three bytes starting at the given position
+	TUInt32 MatchHash( const TUInt8* pData )
+	{
+		return ((pData[0] << 10) ^ (pData[1] << 5) ^ pData[2]) & ((1 << kiHashBits) - 1);
+	}
+
+	// Compress a text or binary X-file to the equivalent MSZip encoding, as read by DecompressXFile.
+	// Each chunk is a single block using the fixed codes, with matches that may refer back to
+	// earlier chunks. Compresses less than dynamic codes would, but exercises the same decoding
+	void CompressXFile
+	(
+		const TUInt8*   pData,
+		const TUInt32   iSize,
+		vector<TUInt8>* pCompressed
+	)
+	{
+		// Header with the format changed to the compressed equivalent, then the total size
+		pCompressed->assign( pData, pData + kiHeaderSize );
+		memcpy( &(*pCompressed)[8], pData[8] == 't' ? "tzip" : "bzip", 4 );
+		for (TUInt32 iByte = 0; iByte < 4; ++iByte)
+		{
+			pCompressed->push_back( static_cast<TUInt8>(iSize >> (iByte * 8)) );
+		}
+
+		const TUInt8* pBody = pData + kiHeaderSize;
+		const TUInt32 iBodySize = iSize - kiHeaderSize;
+		vector<TInt32> chainHeads( 1 << kiHashBits, -1 );
+		vector<TInt32> chainLinks( iBodySize );
+		for (TUInt32 iChunk = 0; iChunk < iBodySize; iChunk += kiChunkSize)
+		{
+			// Chunk sizes are filled in once the chunk has been written
+			const TUInt32 iChunkEnd = min( iChunk + kiChunkSize, iBodySize );
+			const size_t iChunkHeader = pCompressed->size();
+			pCompressed->resize( iChunkHeader + 4 );
+			pCompressed->push_back( 'C' );
+			pCompressed->push_back( 'K' );
+
+			// A single final block with the fixed codes
+			CDeflateWriter writer( pCompressed );
+			writer.PutBits( 1, 1 );
+			writer.PutBits( 1, 2 );
+			TUInt32 iPos = iChunk;
+			while (iPos < iChunkEnd)
+			{
+				// Find the longest match within the chunk
+				TUInt32 iLength = 0;
+				TUInt32 iDistance = 0;
+				if (iPos + kiMinMatch <= iChunkEnd)
+				{
+					const TUInt32 iMaxLength = min( kiMaxMatch, iChunkEnd - iPos );
+					TInt32 iCandidate = chainHeads[MatchHash( pBody + iPos )];
+					for (TUInt32 iStep = 0; iStep < kiMaxChainSteps && iCandidate >= 0 &&
+					     iPos - iCandidate <= kiWindowSize; ++iStep)
+					{
+						TUInt32 iMatch = 0;
+						while (iMatch < iMaxLength && pBody[iCandidate + iMatch] == pBody[iPos + iMatch]) ++iMatch;
+						if (iMatch > iLength)
+						{
+							iLength = iMatch;
+							iDistance = iPos - iCandidate;
+						}
+						iCandidate = chainLinks[iCandidate];
+					}
+				}
+				if (iLength >= kiMinMatch)
+				{
+					writer.PutMatch( iLength, iDistance );
+				}
+				else
+				{
+					writer.PutSymbol( pBody[iPos] );
+					iLength = 1;
+				}
+
+				// Add the positions written to the hash chains
+				for (TUInt32 iEnd = iPos + iLength; iPos < iEnd; ++iPos)
+				{
+					if (iPos + kiMinMatch <= iBodySize)
+					{
+						TUInt32 iHash = MatchHash( pBody + iPos );
+						chainLinks[iPos] = chainHeads[iHash];
+						chainHeads[iHash] = iPos;
+					}
+				}
+			}
+			writer.PutSymbol( 256 );
+			writer.Flush();
+
+			// Uncompressed size, then compressed size including the "CK" signature
+			const TUInt32 iUncompressed = iChunkEnd - iChunk;
+			const TUInt32 iCompressed = static_cast<TUInt32>(pCompressed->size() - iChunkHeader - 4);
+			(*pCompressed)[iChunkHeader + 0] = static_cast<TUInt8>(iUncompressed);
+			(*pCompressed)[iChunkHeader + 1] = static_cast<TUInt8>(iUncompressed >> 8);
+			(*pCompressed)[iChunkHeader + 2] = static_cast<TUInt8>(iCompressed);
+			(*pCompressed)[iChunkHeader + 3] = static_cast<TUInt8>(iCompressed >> 8);
+		}
+	}
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	X-file parsing
+-----------------------------------------------------------------------------------------*/
+
+// Time importing an X-file, with the read and parse stages reported separately
+EImportError BenchmarkParse
+(
+	const string& sFileName,
+	string*       psReport
+)
+{
+	GEN_GUARD;
+
+	CImportStats stats;
+	TUInt32 iNumImports;
+	EImportError eError = TimeImports( sFileName, &stats, &iNumImports );
+	if (eError != kSuccess)
+	{
+		return eError;
+	}
+
+	// Size in KB, times in milliseconds per import, throughput in MB/s
+	TFloat64 fRead = stats.GetStage( kStageRead ).fTime / iNumImports;
+	TFloat64 fParse = stats.GetStage( kStageParse ).fTime / iNumImports;
+	TFloat64 fMB = static_cast<TFloat64>(stats.GetBytesRead() / iNumImports) / (1024.0 * 1024.0);
+	stringstream report;
+	report << fixed << setprecision( 2 );
+	report << "Parse throughput, average of " << iNumImports << " imports\n";
+	report << "  " << fMB * 1024.0 << "KB, " << fRead * 1000.0 << "ms read, " << fParse * 1000.0
+	       << "ms parse, " << fMB / fParse << " MB/s parsed, "
+	       << stats.GetTotalTime() / iNumImports * 1000.0 << "ms whole import\n";
+	*psReport = report.str();
+	return kSuccess;
+
+	GEN_ENDGUARD;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	X-file encodings
+-----------------------------------------------------------------------------------------*/
+
+// Time reading and parsing a text X-file and its binary and compressed encodings
+EImportError BenchmarkEncodings
+(
+	const string& sFileName,
+	string*       psReport
+)
+{
+	GEN_GUARD;
+
+	// The other encodings are written beside the text file, e.g. Cube.bin.tmp
+	enum EEncoding { kText, kBinary, kCompressedText, kCompressedBinary, kNumEncodings };
+	const char* const asEncodingNames[kNumEncodings] =
+		{ "text", "binary", "compressed text", "compressed binary" };
+	size_t iExtension = sFileName.rfind( '.' );
+	string sBaseName = sFileName.substr( 0, iExtension );
+	string asFileNames[kNumEncodings] =
+		{ sFileName, sBaseName + ".bin.tmp", sBaseName + ".tzip.tmp", sBaseName + ".bzip.tmp" };
+
+	CMappedFile textFile;
+	if (!textFile.Open( sFileName ) || !CXFileTextReader::IsTextXFile( textFile.GetData(), textFile.GetSize() ))
+	{
+		return kFileError;
+	}
+	const TUInt32 iTextSize = textFile.GetSize();
+	EImportError eError = CXFileBinaryWriter::ConvertTextFile( sFileName, asFileNames[kBinary] );
+	if (eError == kSuccess)
+	{
+		vector<TUInt8> compressed;
+		CompressXFile( textFile.GetData(), iTextSize, &compressed );
+		CMappedFile binaryFile;
+		if (!SaveFile( asFileNames[kCompressedText], compressed ) || !binaryFile.Open( asFileNames[kBinary] ))
+		{
+			eError = kFileError;
+		}
+		else
+		{
+			CompressXFile( binaryFile.GetData(), binaryFile.GetSize(), &compressed );
+			binaryFile.Close();
+			if (!SaveFile( asFileNames[kCompressedBinary], compressed ))
+			{
+				eError = kFileError;
+			}
+		}
+	}
+	textFile.Close();
+
+	// Sizes in KB, times in milliseconds per import, throughput in MB/s
+	stringstream report;
+	report << fixed << setprecision( 2 );
+	report << "Read (including decompression) and parse time of each encoding\n";
+	const TFloat64 fTextMB = iTextSize / (1024.0 * 1024.0);
+	for (TUInt32 iEncoding = 0; iEncoding < kNumEncodings && eError == kSuccess; ++iEncoding)
+	{
+		CImportStats stats;
+		TUInt32 iNumImports;
+		eError = TimeImports( asFileNames[iEncoding], &stats, &iNumImports );
+		if (eError == kSuccess)
+		{
+			TFloat64 fRead = stats.GetStage( kStageRead ).fTime / iNumImports;
+			TFloat64 fParse = stats.GetStage( kStageParse ).fTime / iNumImports;
+			TFloat64 fMB = static_cast<TFloat64>(stats.GetBytesRead() / iNumImports) / (1024.0 * 1024.0);
+			report << "  " << asEncodingNames[iEncoding] << ": " << fMB * 1024.0 << "KB, "
+			       << fRead * 1000.0 << "ms read, " << fParse * 1000.0 << "ms parse, "
+			       << fMB / (fRead + fParse) << " MB/s (" << fTextMB / (fRead + fParse)
+			       << " MB/s of text)\n";
+		}
+	}
+
+	for (TUInt32 iEncoding = kBinary; iEncoding < kNumEncodings; ++iEncoding)
+	{
+		remove( asFileNames[iEncoding].c_str() );
+	}
+	if (eError != kSuccess)
+	{
+		return eError;
+	}
+	*psReport = report.str();
+	return kSuccess;
+
+	GEN_ENDGUARD;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Cooking
+-----------------------------------------------------------------------------------------*/
+
+// Cook an X-file, without and with tangents, and compare the time of a cold import with a load
+// of the cooked file
+EImportError BenchmarkCooking
+(
+	const string& sFileName,
+	string*       psReport
+)
+{
+	GEN_GUARD;
+
+	// Sizes in KB, times in milliseconds per load
+	stringstream report;
+	report << fixed << setprecision( 2 );
+	report << "Cold import and cook compared with a load of the cooked file\n";
+	for (TUInt32 iTangents = 0; iTangents < 2; ++iTangents)
+	{
+		const bool bTangents = (iTangents == 1);
+
+		// Each cook is a cold import of the source file, with all processing, and writes the
+		// cooked file. The last one written is left for the cached loads and kept afterwards
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		TFloat64 fTime;
+		TUInt32 iNumCooks = 0;
+		do
+		{
+			EImportError eError = CCookedMesh::CookFile( sFileName, bTangents );
+			if (eError != kSuccess)
+			{
+				return eError;
+			}
+			++iNumCooks;
+			fTime = chrono::duration<TFloat64>( chrono::steady_clock::now() - start ).count();
+		} while (iNumCooks < kiMinImports || fTime < kfMinSeconds);
+		const TFloat64 fCook = fTime / iNumCooks;
+
+		start = chrono::steady_clock::now();
+		TUInt32 iNumLoads = 0;
+		TUInt32 iCookedSize = 0;
+		do
+		{
+			CCookedMesh cookedMesh;
+			EImportError eError = cookedMesh.Load( sFileName, bTangents );
+			if (eError != kSuccess)
+			{
+				return eError;
+			}
+			if (!cookedMesh.IsFromCache())
+			{
+				return kFileError;
+			}
+			iCookedSize = static_cast<TUInt32>(cookedMesh.GetImportStats().GetBytesRead());
+			++iNumLoads;
+			fTime = chrono::duration<TFloat64>( chrono::steady_clock::now() - start ).count();
+		} while (iNumLoads < kiMinImports || fTime < kfMinSeconds);
+		const TFloat64 fLoad = fTime / iNumLoads;
+
+		report << "  " << (bTangents ? "with tangents" : "no tangents") << ": "
+		       << CCookedMesh::GetCookedFileName( sFileName, bTangents ) << " "
+		       << iCookedSize / 1024.0 << "KB, " << fCook * 1000.0 << "ms cold import and cook ("
+		       << iNumCooks << "), " << fLoad * 1000.0 << "ms cooked load (" << iNumLoads << "), "
+		       << fCook / fLoad << "x faster\n";
+	}
+	*psReport = report.str();
+	return kSuccess;
+
+	GEN_ENDGUARD;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Load threads
+-----------------------------------------------------------------------------------------*/
+
+// Time loading a list of X-files on 1, 2, 4 and one per hardware thread, both cold and cooked
+EImportError BenchmarkLoadThreads
+(
+	const vector<string>& fileNames,
+	string*               psReport
+)
+{
+	GEN_GUARD;
+
+	// Each file once only, two tasks must not write the same cooked file
+	vector<string> uniqueNames( fileNames );
+	sort( uniqueNames.begin(), uniqueNames.end() );
+	uniqueNames.erase( unique( uniqueNames.begin(), uniqueNames.end() ), uniqueNames.end() );
+
+	TUInt32 aiNumThreads[4] = { 1, 2, 4, thread::hardware_concurrency() };
+	TUInt32 iNumCounts = (aiNumThreads[3] > 4) ? 4 : 3;
+
+	// Times in milliseconds per load of all the files
+	stringstream report;
+	report << fixed << setprecision( 2 );
+	report << "Load time of " << uniqueNames.size() << " files by number of threads, cold (import "
+	       << "and cook) and from the cooked files\n";
+	TFloat64 fOneThread[2] = { 0.0, 0.0 };
+	for (TUInt32 iCount = 0; iCount < iNumCounts; ++iCount)
+	{
+		CThreadPool threadPool( aiNumThreads[iCount] );
+		report << "  " << aiNumThreads[iCount] << (iCount == 0 ? " thread: " : " threads: ");
+
+		// Cook first, which leaves the cooked files for the cooked loads
+		for (TUInt32 iCooked = 0; iCooked < 2; ++iCooked)
+		{
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			TFloat64 fTime;
+			TUInt32 iNumLoads = 0;
+			do
+			{
+				EImportError eError = LoadFiles( uniqueNames, iCooked == 0, &threadPool );
+				if (eError != kSuccess)
+				{
+					return eError;
+				}
+				++iNumLoads;
+				fTime = chrono::duration<TFloat64>( chrono::steady_clock::now() - start ).count();
+			} while (iNumLoads < kiMinImports || fTime < kfMinSeconds);
+			fTime /= iNumLoads;
+			fOneThread[iCooked] = (iCount == 0) ? fTime : fOneThread[iCooked];
+			report << (iCooked == 0 ? "" : ", ") << fTime * 1000.0 << "ms "
+			       << (iCooked == 0 ? "cold" : "cooked") << " (" << fOneThread[iCooked] / fTime << "x)";
+		}
+		report << "\n";
+	}
+	*psReport = report.str();
+	return kSuccess;
+
+	GEN_ENDGUARD;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Vertex interleaving
+-----------------------------------------------------------------------------------------*/
+
+// Time writing the vertex data of a synthetic grid with each layout of vertex components
+EImportError BenchmarkInterleave
+(
+	string* psReport
+)
+{
+	GEN_GUARD;
+
+	const TUInt32 kiGridSize = 256;
+	const string sFileName = "InterleaveGrid.x";
+	const char* const asComponentNames[3] = { "normal", "uv", "colour" };
+
+	// Times in milliseconds per sub-mesh, throughput in millions of vertices per second
+	stringstream report;
+	report << fixed << setprecision( 2 );
+	report << "Vertex interleaving of a " << kiGridSize << "x" << kiGridSize << " grid for each "
+	       << "layout (tangent calculation timed separately)\n";
+	EImportError eError = kSuccess;
+	for (TUInt32 iComponents = 0; iComponents <= kGridAllComponents && eError == kSuccess; ++iComponents)
+	{
+		if (!SaveTextFile( sFileName, MakeGridXFile( kiGridSize, 1, iComponents ) ))
+		{
+			eError = kFileError;
+			break;
+		}
+		CImportXFile importFile;
+		eError = importFile.ImportFile( sFileName );
+		remove( sFileName.c_str() );
+		for (TUInt32 iTangents = 0; iTangents < 2 && eError == kSuccess; ++iTangents)
+		{
+			// Write the sub-mesh repeatedly into the same memory, as into a mapped vertex buffer
+			SSubMesh subMesh;
+			importFile.GetSubMeshLayout( 0, &subMesh, iTangents == 1 );
+			vector<TUInt8> vertices( subMesh.numVertices * subMesh.vertexSize );
+			vector<TUInt8> faces( subMesh.numFaces * 3 * subMesh.indexSize );
+			subMesh.vertices = &vertices[0];
+			subMesh.faces = &faces[0];
+			CImportStats stats;
+			importFile.SetImportStats( &stats );
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			TFloat64 fTime;
+			TUInt32 iNumWrites = 0;
+			do
+			{
+				eError = importFile.GetSubMeshData( 0, subMesh );
+				++iNumWrites;
+				fTime = chrono::duration<TFloat64>( chrono::steady_clock::now() - start ).count();
+			} while (eError == kSuccess && (iNumWrites < kiMinImports || fTime < kfMinSeconds));
+			importFile.SetImportStats( 0 );
+			if (eError != kSuccess)
+			{
+				break;
+			}
+
+			// The vertex data stage is paused while the tangent stage within it runs
+			TFloat64 fTangents = stats.GetStage( kStageTangents ).fTime / iNumWrites;
+			TFloat64 fInterleave = stats.GetStage( kStageVertexData ).fTime / iNumWrites;
+			string sLayout = "position";
+			for (TUInt32 iComponent = 0; iComponent < 3; ++iComponent)
+			{
+				if (iComponents & (1 << iComponent))
+				{
+					sLayout += string( "+" ) + asComponentNames[iComponent];
+				}
+			}
+			sLayout += (iTangents == 1) ? "+tangent" : "";
+			report << "  " << sLayout << " (" << subMesh.vertexSize << " bytes): " << fInterleave * 1000.0
+			       << "ms, " << subMesh.numVertices / fInterleave / 1000000.0 << "M vertices/s";
+			if (iTangents == 1)
+			{
+				report << ", tangents " << fTangents * 1000.0 << "ms";
+			}
+			report << "\n";
+		}
+	}
+	if (eError != kSuccess)
+	{
+		return eError;
+	}
+	*psReport = report.str();
+	return kSuccess;
+
+	GEN_ENDGUARD;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Import memory
+-----------------------------------------------------------------------------------------*/
+
+// Compare the peak memory of a streaming import of an X-file with a full import
+EImportError BenchmarkImportMemory
+(
+	const string& sFileName,
+	string*       psReport
+)
+{
+	GEN_GUARD;
+
+	// Sizes in MB
+	const TFloat64 kfMB = 1024.0 * 1024.0;
+	stringstream report;
+	report << fixed << setprecision( 2 );
+	report << "Peak memory of a streaming import and a full import (with sub-mesh data fetched)\n";
+
+	// Streaming first, where the process peak cannot be reset it then only limits the full import
+	bool bReset = true;
+	for (TUInt32 iImport = 0; iImport < 2; ++iImport)
+	{
+		const bool bStreaming = (iImport == 0);
+		bReset = ResetPeakMemory() && bReset;
+		TUInt64 iStartMemory, iPeakMemory;
+		GetProcessMemory( &iStartMemory, &iPeakMemory );
+
+		CImportStats stats;
+		{
+			CImportXFile importFile;
+			importFile.SetImportStats( &stats );
+			EImportError eError;
+			if (bStreaming)
+			{
+				CDiscardCallback discard;
+				eError = importFile.ImportFile( sFileName, &discard );
+			}
+			else
+			{
+				eError = importFile.ImportFile( sFileName );
+				const TUInt32 iNumSubMeshes = importFile.GetNumSubMeshes();
+				for (TUInt32 iSubMesh = 0; iSubMesh < iNumSubMeshes && eError == kSuccess; ++iSubMesh)
+				{
+					CSubMeshData subMeshData;
+					eError = importFile.GetSubMesh( iSubMesh, &subMeshData );
+				}
+			}
+			if (eError != kSuccess)
+			{
+				return eError;
+			}
+			TUInt64 iMemory;
+			GetProcessMemory( &iMemory, &iPeakMemory );
+		}
+
+		report << "  " << (bStreaming ? "streaming" : "full") << ": " << stats.GetPeakBytes() / kfMB
+		       << "MB peak mesh data, " << iPeakMemory / kfMB << "MB peak process memory (+"
+		       << (iPeakMemory - min( iStartMemory, iPeakMemory )) / kfMB << "MB), "
+		       << stats.GetTotalTime() * 1000.0 << "ms\n";
+	}
+	if (!bReset)
+	{
+		report << "  (process peak is not reset on this platform, it includes earlier imports)\n";
+	}
+	*psReport = report.str();
+	return kSuccess;
+
+	GEN_ENDGUARD;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Material splitting
+-----------------------------------------------------------------------------------------*/
+
+// Time splitting a synthetic grid by material, with one and with many materials
+EImportError BenchmarkSplit
+(
+	string* psReport
+)
+{
+	GEN_GUARD;
+
+	const TUInt32 kiGridSize = 256;
+	const TUInt32 aiNumMaterials[3] = { 1, 8, 64 };
+	const string sFileName = "SplitGrid.x";
+
+	// Times in milliseconds per import, throughput in millions of faces per second
+	stringstream report;
+	report << fixed << setprecision( 2 );
+	report << "Material split of a " << kiGridSize << "x" << kiGridSize << " grid with the materials "
+	       << "interleaved square by square\n";
+	EImportError eError = kSuccess;
+	for (TUInt32 iCase = 0; iCase < 3 && eError == kSuccess; ++iCase)
+	{
+		if (!SaveTextFile( sFileName, MakeGridXFile( kiGridSize, aiNumMaterials[iCase] ) ))
+		{
+			eError = kFileError;
+			break;
+		}
+		CImportStats stats;
+		TUInt32 iNumImports;
+		eError = TimeImports( sFileName, &stats, &iNumImports );
+		CImportXFile importFile;
+		if (eError == kSuccess)
+		{
+			eError = importFile.ImportFile( sFileName );
+		}
+		remove( sFileName.c_str() );
+		if (eError == kSuccess)
+		{
+			const SImportStageStats& split = stats.GetStage( kStageSplit );
+			TFloat64 fSplit = split.fTime / iNumImports;
+			TFloat64 fFaces = static_cast<TFloat64>(split.iFacesIn / iNumImports);
+			report << "  " << aiNumMaterials[iCase] << (iCase == 0 ? " material: " : " materials: ")
+			       << importFile.GetNumSubMeshes() << " sub-meshes, " << fSplit * 1000.0 << "ms split, "
+			       << fFaces / fSplit / 1000000.0 << "M faces/s, "
+			       << stats.GetTotalTime() / iNumImports * 1000.0 << "ms whole import\n";
+		}
+	}
+	if (eError != kSuccess)
+	{
+		return eError;
+	}
+	*psReport = report.str();
+	return kSuccess;
+
+	GEN_ENDGUARD;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Tangents
+-----------------------------------------------------------------------------------------*/
+
+// Time calculating the tangents of an X-file's sub-meshes, on one thread and on a pool
+EImportError BenchmarkTangents
+(
+	const string& sFileName,
+	CThreadPool*  pThreadPool,
+	string*       psReport
+)
+{
+	GEN_GUARD;
+
+	CImportXFile importFile;
+	EImportError eError = importFile.ImportFile( sFileName );
+	if (eError != kSuccess)
+	{
+		return eError;
+	}
+
+	// Only sub-meshes with normals and texture coordinates have tangents calculated. Space for
+	// each is allocated once, the sub-meshes are then written repeatedly into the same memory
+	vector<SSubMesh> subMeshes;
+	vector< vector<TUInt8> > subMeshData;
+	subMeshData.reserve( importFile.GetNumSubMeshes() );
+	for (TUInt32 iSubMesh = 0; iSubMesh < importFile.GetNumSubMeshes(); ++iSubMesh)
+	{
+		SSubMesh subMesh;
+		importFile.GetSubMeshLayout( iSubMesh, &subMesh, true );
+		if (subMesh.hasNormals && subMesh.hasTextureCoords && subMesh.numFaces > 0)
+		{
+			TUInt32 iVertexBytes = subMesh.numVertices * subMesh.vertexSize;
+			subMeshData.push_back( vector<TUInt8>( iVertexBytes + subMesh.numFaces * 3 * subMesh.indexSize ) );
+			subMesh.vertices = &subMeshData.back()[0];
+			subMesh.faces = &subMeshData.back()[iVertexBytes];
+			subMeshes.push_back( subMesh );
+		}
+		else
+		{
+			subMeshes.push_back( SSubMesh() );
+			subMeshes.back().numFaces = 0;
+		}
+	}
+
+	// Times in milliseconds per calculation of all the tangents, throughput in millions of
+	// vertices per second
+	stringstream report;
+	report << fixed << setprecision( 2 );
+	report << "Tangent calculation of the sub-meshes with normals and texture coordinates\n";
+	for (TUInt32 iPool = 0; iPool < 2 && eError == kSuccess; ++iPool)
+	{
+		importFile.SetThreadPool( iPool == 1 ? pThreadPool : 0 );
+		CImportStats stats;
+		importFile.SetImportStats( &stats );
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		TFloat64 fTime;
+		TUInt32 iNumRuns = 0;
+		do
+		{
+			for (TUInt32 iSubMesh = 0; iSubMesh < subMeshes.size() && eError == kSuccess; ++iSubMesh)
+			{
+				if (subMeshes[iSubMesh].numFaces > 0)
+				{
+					eError = importFile.GetSubMeshData( iSubMesh, subMeshes[iSubMesh] );
+				}
+			}
+			++iNumRuns;
+			fTime = chrono::duration<TFloat64>( chrono::steady_clock::now() - start ).count();
+		} while (eError == kSuccess && (iNumRuns < kiMinImports || fTime < kfMinSeconds));
+		importFile.SetImportStats( 0 );
+		importFile.SetThreadPool( 0 );
+
+		const SImportStageStats& tangents = stats.GetStage( kStageTangents );
+		if (eError == kSuccess && tangents.iCalls == 0)
+		{
+			report << "  (no sub-meshes with normals and texture coordinates)\n";
+			break;
+		}
+		if (eError == kSuccess)
+		{
+			TFloat64 fTangents = tangents.fTime / iNumRuns;
+			TUInt64 iVertices = tangents.iVerticesIn / iNumRuns;
+			if (iPool == 0)
+			{
+				report << "  calling thread: ";
+			}
+			else
+			{
+				report << "  pool of " << pThreadPool->GetNumThreads() << " threads: ";
+			}
+			report << tangents.iCalls / iNumRuns << " sub-meshes, " << iVertices << " vertices, "
+			       << fTangents * 1000.0 << "ms, " << iVertices / fTangents / 1000000.0 << "M vertices/s\n";
+		}
+	}
+	if (eError != kSuccess)
+	{
+		return eError;
+	}
+	*psReport = report.str();
+	return kSuccess;
+
+	GEN_ENDGUARD;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Allocations
+-----------------------------------------------------------------------------------------*/
+
+// Count the heap allocations of importing an X-file and fetching its sub-meshes, and time it
+EImportError BenchmarkAllocations
+(
+	const string& sFileName,
+	string*       psReport
+)
+{
+	GEN_GUARD;
+
+	// Import as the app does, fetching the data of every sub-mesh, until long enough to time
+	CImportStats stats;
+	TUInt64 iStartAllocations = GetNumHeapAllocations();
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	TFloat64 fTime;
+	TUInt32 iNumImports = 0;
+	do
+	{
+		CImportXFile importFile;
+		importFile.SetImportStats( &stats );
+		EImportError eError = importFile.ImportFile( sFileName );
+		const TUInt32 iNumSubMeshes = importFile.GetNumSubMeshes();
+		for (TUInt32 iSubMesh = 0; iSubMesh < iNumSubMeshes && eError == kSuccess; ++iSubMesh)
+		{
+			CSubMeshData subMeshData;
+			eError = importFile.GetSubMesh( iSubMesh, &subMeshData );
+		}
+		if (eError != kSuccess)
+		{
+			return eError;
+		}
+		++iNumImports;
+		fTime = chrono::duration<TFloat64>( chrono::steady_clock::now() - start ).count();
+	} while (iNumImports < kiMinImports || fTime < kfMinSeconds);
+	TUInt64 iAllocations = (GetNumHeapAllocations() - iStartAllocations) / iNumImports;
+
+	// Times in milliseconds per import
+	stringstream report;
+	report << fixed << setprecision( 2 );
+	report << "Allocations of an import with every sub-mesh fetched, average of " << iNumImports
+	       << " imports\n";
+	report << "  " << iAllocations << " heap allocations, " << stats.GetAllocations() / iNumImports
+	       << " mesh lists, " << stats.GetPeakBytes() / 1024.0 << "KB peak mesh data, "
+	       << fTime / iNumImports * 1000.0 << "ms\n";
+	*psReport = report.str();
+	return kSuccess;
+
+	GEN_ENDGUARD;
+}
+
+
+} // namespace gen
@@ -0,0 +1,160 @@
+/**************************************************************************************************
+	Module:       ImportBenchmarks.h
+	Date created: 18/10/26
+
+	Benchmarks of the import library, run on X-files without a GPU. Each benchmark reads the file
+	itself, as many times as it needs to time it
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#ifndef GEN_IMPORT_BENCHMARKS_H_INCLUDED
+#define GEN_IMPORT_BENCHMARKS_H_INCLUDED
+
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "GenDefines.h"
+#include "CImportXFile.h"
+#include "CThreadPool.h"
+
+namespace gen
+{
+
+// Each benchmark imports a file repeatedly, for long enough to time it reliably, and reports
+// the average time of an import. The report is text, a heading line followed by a line per case
+
+
+// Time importing an X-file. Reports the file size, the read and parse times and the parse
+// throughput in megabytes of the file per second, and the time of the whole import
+// Possible return values:
+//		kSuccess:			...
+//		(Errors from CImportXFile::ImportFile)
+EImportError BenchmarkParse
+(
+	const string& sFileName,
+	string*       psReport
+);
+
+// Convert a text X-file to the binary, compressed text and compressed binary encodings (written
+// beside it, then deleted) and time reading and parsing each encoding. Reports the file size,
+// read time (including decompression), parse time and throughput of each encoding, with the
+// throughput also given in megabytes of the text file per second for comparison
+// Possible return values:
+//		kSuccess:			...
+//		kFileError:			Missing or not a text X-file, or converted files could not be written
+//		(Errors from CImportXFile::ImportFile)
+EImportError BenchmarkEncodings
+(
+	const string& sFileName,
+	string*       psReport
+);
+
+
+// Cook an X-file with CCookedMesh::CookFile, without and with tangents, leaving the cooked files
+// beside it. Reports the size of each cooked file, the time of a cold import and cook of the
+// source file and the time of a load of the cooked file
+// Possible return values:
+//		kSuccess:			...
+//		kFileError:			Missing source file, or cooked file could not be written or read back
+//		(Errors from CImportXFile::ImportFile)
+EImportError BenchmarkCooking
+(
+	const string& sFileName,
+	string*       psReport
+);
+
+
+// Load a list of X-files as the app does at startup, with a task per file on a CThreadPool of 1,
+// 2, 4 and one thread per hardware thread (if more than 4). Each count is timed cold, with every
+// file cooked by CCookedMesh::CookFile (which leaves the cooked files beside them), then loaded
+// from the cooked files. Reports the time of each and the speedup over a single thread
+// Possible return values:
+//		kSuccess:			...
+//		kFileError:			Missing source file, or cooked file could not be written or read back
+//		(Errors from CImportXFile::ImportFile)
+EImportError BenchmarkLoadThreads
+(
+	const vector<string>& fileNames,
+	string*               psReport
+);
+
+
+// Time writing the vertex data of a synthetic 256x256 grid with CImportXFile::GetSubMeshData,
+// for every layout of normals, texture coordinates, vertex colours and tangents (skinned layouts
+// are not covered). Reports each layout's vertex size, the time and vertices per second of the
+// interleaving, and the time of the tangent calculation where there are tangents. The grid file
+// is written to the current directory and deleted after import
+// Possible return values:
+//		kSuccess:			...
+//		kFileError:			The grid file could not be written
+//		(Errors from CImportXFile::ImportFile or CImportXFile::GetSubMeshData)
+EImportError BenchmarkInterleave
+(
+	string* psReport
+);
+
+
+// Import an X-file streamed through a callback (see CImportXFile::ImportFile), then in full with
+// the data of every sub-mesh fetched. Reports the peak mesh data of each import (see
+// CImportStats::GetPeakBytes), the peak resident memory of the process and its increase during
+// the import, and the import time. The process peak is reset before each import on Linux only,
+// elsewhere the streaming import runs first so that it does not hide the peak of the full import
+// Possible return values:
+//		kSuccess:			...
+//		(Errors from CImportXFile::ImportFile or CImportXFile::GetSubMesh)
+EImportError BenchmarkImportMemory
+(
+	const string& sFileName,
+	string*       psReport
+);
+
+
+// Import a synthetic 256x256 grid with 1, 8 and 64 materials, the material changing on each grid
+// square so every sub-mesh is gathered from the whole grid. Reports the number of sub-meshes, the
+// time and faces per second of the split by material, and the time of the whole import. The grid
+// file is written to the current directory and deleted after import
+// Possible return values:
+//		kSuccess:			...
+//		kFileError:			The grid file could not be written
+//		(Errors from CImportXFile::ImportFile)
+EImportError BenchmarkSplit
+(
+	string* psReport
+);
+
+
+// Time the tangent calculation of every sub-mesh of an X-file that has normals and texture
+// coordinates, through CImportXFile::GetSubMeshData, first on the calling thread and then split
+// over the given pool. Reports the number of sub-meshes and vertices, and the time and vertices
+// per second of each
+// Possible return values:
+//		kSuccess:			...
+//		(Errors from CImportXFile::ImportFile or CImportXFile::GetSubMeshData)
+EImportError BenchmarkTangents
+(
+	const string& sFileName,
+	CThreadPool*  pThreadPool,
+	string*       psReport
+);
+
+
+// Import an X-file and fetch the data of every sub-mesh, repeatedly, counting the calls to the
+// global operator new (see HeapCounter.h). Reports the heap allocations of an import, the number
+// of mesh lists the import created (see CImportStats::GetAllocations), the peak mesh data and the
+// time of an import. Allocations on other threads at the same time are included in the count
+// Possible return values:
+//		kSuccess:			...
+//		(Errors from CImportXFile::ImportFile or CImportXFile::GetSubMesh)
+EImportError BenchmarkAllocations
+(
+	const string& sFileName,
+	string*       psReport
+);
+
+
+} // namespace gen
+
+#endif // GEN_IMPORT_BENCHMARKS_H_INCLUDED
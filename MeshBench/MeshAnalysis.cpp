@@ -0,0 +1,814 @@
+/**************************************************************************************************
+	Module:       MeshAnalysis.cpp
+	Date created: 18/10/26
+
+	Reports on the mesh processing of the import library, run on imported X-files without a GPU:
+	vertex cache optimisation, compact vertex formats, levels of detail, bounding volume
+	hierarchies, silhouette edges and clusters
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+
+#include "MeshAnalysis.h"
+#include "MeshOptimise.h"
+#include "MeshSimplify.h"
+#include "MeshBVH.h"
+#include "MeshEdges.h"
+#include "MeshClusters.h"
+#include "BaseMath.h"
+#include "Error.h"
+
+namespace gen
+{
+
+namespace
+{
+	// Marks a vertex not yet in any cluster
+	const TUInt32 kiNoCluster = 0xffffffff;
+
+	// Read the faces of a sub-mesh as 32-bit indices
+	void GetSubMeshIndices
+	(
+		const SSubMesh&  subMesh,
+		vector<TUInt32>* pIndices
+	)
+	{
+		TUInt32 iNumIndices = subMesh.numFaces * 3;
+		pIndices->resize( iNumIndices );
+		if (subMesh.indexSize == sizeof(TUInt32))
+		{
+			memcpy( pIndices->data(), subMesh.faces, iNumIndices * sizeof(TUInt32) );
+		}
+		else
+		{
+			const TUInt16* pIndex16 = reinterpret_cast<const TUInt16*>(subMesh.faces);
+			for (TUInt32 iIndex = 0; iIndex < iNumIndices; ++iIndex)
+			{
+				(*pIndices)[iIndex] = pIndex16[iIndex];
+			}
+		}
+	}
+
+	// Get the position of a vertex in a sub-mesh
+	inline CVector3 GetPosition
+	(
+		const SSubMesh& subMesh,
+		const TUInt32   iVertex
+	)
+	{
+		CVector3 vPosition;
+		memcpy( &vPosition, subMesh.vertices + iVertex * subMesh.vertexSize, sizeof(CVector3) );
+		return vPosition;
+	}
+
+	// Get the (not normalised) normal of a face from the indices of its vertices
+	inline CVector3 GetFaceNormal
+	(
+		const SSubMesh& subMesh,
+		const TUInt32*  aiCorners
+	)
+	{
+		CVector3 p0 = GetPosition( subMesh, aiCorners[0] );
+		return Cross( GetPosition( subMesh, aiCorners[1] ) - p0, GetPosition( subMesh, aiCorners[2] ) - p0 );
+	}
+
+	// Get the vertex indices of a face in a sub-mesh
+	inline void GetFace
+	(
+		const SSubMesh& subMesh,
+		const TUInt32   iFace,
+		TUInt32*        aiIndices
+	)
+	{
+		for (TUInt32 iCorner = 0; iCorner < 3; ++iCorner)
+		{
+			aiIndices[iCorner] = (subMesh.indexSize == sizeof(TUInt32)) ?
+			                     reinterpret_cast<const TUInt32*>(subMesh.faces)[iFace * 3 + iCorner] :
+			                     reinterpret_cast<const TUInt16*>(subMesh.faces)[iFace * 3 + iCorner];
+		}
+	}
+
+	// Closest intersection of a ray with the faces of a sub-mesh, testing every face. Used to check
+	// and time the hierarchy against
+	bool IntersectFaces
+	(
+		const SSubMesh& subMesh,
+		const CVector3& origin,
+		const CVector3& direction,
+		TFloat32        fMaxDistance,
+		SRayHit*        pHit
+	)
+	{
+		bool bHit = false;
+		for (TUInt32 iFace = 0; iFace < subMesh.numFaces; ++iFace)
+		{
+			TUInt32 aiIndices[3];
+			GetFace( subMesh, iFace, aiIndices );
+			CVector3 v0 = GetPosition( subMesh, aiIndices[0] );
+			CVector3 edge1 = GetPosition( subMesh, aiIndices[1] ) - v0;
+			CVector3 edge2 = GetPosition( subMesh, aiIndices[2] ) - v0;
+			CVector3 p = Cross( direction, edge2 );
+			TFloat32 fDet = Dot( edge1, p );
+			if (fDet == 0.0f)
+			{
+				continue;
+			}
+			TFloat32 fInvDet = 1.0f / fDet;
+			CVector3 toOrigin = origin - v0;
+			TFloat32 fU = Dot( toOrigin, p ) * fInvDet;
+			CVector3 q = Cross( toOrigin, edge1 );
+			TFloat32 fV = Dot( direction, q ) * fInvDet;
+			TFloat32 fT = Dot( edge2, q ) * fInvDet;
+			if (fU >= 0.0f && fV >= 0.0f && fU + fV <= 1.0f && fT >= 0.0f && fT < fMaxDistance)
+			{
+				fMaxDistance = fT;
+				pHit->fDistance = fT;
+				pHit->iFace = iFace;
+				pHit->fU = fU;
+				pHit->fV = fV;
+				bHit = true;
+			}
+		}
+		return bHit;
+	}
+
+	// Pseudo-random number from 0 to 1 (xorshift), repeatable for any platform
+	inline TFloat32 NextRandom( TUInt32* piState )
+	{
+		*piState ^= *piState << 13;
+		*piState ^= *piState >> 17;
+		*piState ^= *piState << 5;
+		return static_cast<TFloat32>(*piState >> 8) / 16777216.0f;
+	}
+
+	// Perspective projection matrix (Direct3D, left-handed, depth from 0 to 1)
+	CMatrix4x4 MatrixPerspective
+	(
+		const TFloat32 fFOV,     // Vertical, in radians
+		const TFloat32 fAspect,
+		const TFloat32 fNearClip,
+		const TFloat32 fFarClip
+	)
+	{
+		TFloat32 fScaleY = 1.0f / tan( fFOV * 0.5f );
+		TFloat32 fScaleZ = fFarClip / (fFarClip - fNearClip);
+		CMatrix4x4 m;
+		m.SetRows( CVector4( fScaleY / fAspect, 0.0f, 0.0f, 0.0f ), CVector4( 0.0f, fScaleY, 0.0f, 0.0f ),
+		           CVector4( 0.0f, 0.0f, fScaleZ, 1.0f ), CVector4( 0.0f, 0.0f, -fNearClip * fScaleZ, 0.0f ) );
+		return m;
+	}
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Vertex cache
+-----------------------------------------------------------------------------------------*/
+
+// Analyse the vertex cache use of each sub-mesh of an X-file before and after optimisation
+EImportError AnalyseOptimisation
+(
+	CImportXFile& importFile,
+	string*       psReport,
+	const TUInt32 iCacheSize /*= kiDefaultVertexCacheSize*/
+)
+{
+	GEN_GUARD;
+
+	// Cache models reported, totals are summed over all sub-meshes
+	const EVertexCacheModel aeModels[2] = { kCacheFIFO, kCacheLRU };
+	const char* const asModelNames[2] = { "FIFO", "LRU" };
+	TUInt32 aiTotalBefore[2] = { 0, 0 };
+	TUInt32 aiTotalAfter[2] = { 0, 0 };
+	TUInt32 iTotalVertices = 0;
+	TUInt32 iTotalFaces = 0;
+
+	stringstream report;
+	report << fixed << setprecision( 3 );
+	report << "Vertex cache size " << iCacheSize << ", ACMR / ATVR before -> after\n";
+	vector<TUInt32> indices;
+	for (TUInt32 iSubMesh = 0; iSubMesh < importFile.GetNumSubMeshes(); ++iSubMesh)
+	{
+		CSubMeshData subMeshData;
+		EImportError eError = importFile.GetSubMesh( iSubMesh, &subMeshData );
+		if (eError != kSuccess)
+		{
+			return eError;
+		}
+		const SSubMesh& subMesh = subMeshData.Get();
+		iTotalVertices += subMesh.numVertices;
+		iTotalFaces += subMesh.numFaces;
+
+		SVertexCacheStats aBefore[2], aAfter[2];
+		GetSubMeshIndices( subMesh, &indices );
+		for (TUInt32 iModel = 0; iModel < 2; ++iModel)
+		{
+			aBefore[iModel] = AnalyseVertexCache( indices.data(), subMesh.numFaces,
+			                                      subMesh.numVertices, iCacheSize, aeModels[iModel] );
+		}
+		OptimiseSubMesh( subMesh, kfDefaultOverdrawThreshold, iCacheSize );
+		GetSubMeshIndices( subMesh, &indices );
+		for (TUInt32 iModel = 0; iModel < 2; ++iModel)
+		{
+			aAfter[iModel] = AnalyseVertexCache( indices.data(), subMesh.numFaces,
+			                                     subMesh.numVertices, iCacheSize, aeModels[iModel] );
+		}
+
+		report << "  Sub-mesh " << iSubMesh << ": " << subMesh.numVertices << " vertices, "
+		       << subMesh.numFaces << " faces";
+		for (TUInt32 iModel = 0; iModel < 2; ++iModel)
+		{
+			report << ", " << asModelNames[iModel] << " " << aBefore[iModel].fACMR << " / "
+			       << aBefore[iModel].fATVR << " -> " << aAfter[iModel].fACMR << " / "
+			       << aAfter[iModel].fATVR;
+			aiTotalBefore[iModel] += aBefore[iModel].iNumTransformed;
+			aiTotalAfter[iModel] += aAfter[iModel].iNumTransformed;
+		}
+		report << "\n";
+	}
+
+	report << "  Total: " << iTotalVertices << " vertices, " << iTotalFaces << " faces";
+	for (TUInt32 iModel = 0; iModel < 2; ++iModel)
+	{
+		TFloat32 fFaces = iTotalFaces ? static_cast<TFloat32>(iTotalFaces) : 1.0f;
+		TFloat32 fVertices = iTotalVertices ? static_cast<TFloat32>(iTotalVertices) : 1.0f;
+		report << ", " << asModelNames[iModel] << " " << aiTotalBefore[iModel] / fFaces << " / "
+		       << aiTotalBefore[iModel] / fVertices << " -> " << aiTotalAfter[iModel] / fFaces
+		       << " / " << aiTotalAfter[iModel] / fVertices;
+	}
+	report << "\n";
+
+	*psReport = report.str();
+	return kSuccess;
+
+	GEN_ENDGUARD;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Vertex formats
+-----------------------------------------------------------------------------------------*/
+
+// Analyse the error of encoding each sub-mesh of an X-file (with tangents) in the given format
+EImportError AnalyseVertexFormat
+(
+	CImportXFile&        importFile,
+	const SVertexFormat& format,
+	string*              psReport
+)
+{
+	GEN_GUARD;
+
+	// Totals are summed over all sub-meshes, errors are the largest of any sub-mesh
+	SVertexFormatError maxError = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+	TUInt32 iTotalVertices = 0;
+	TUInt32 iTotalSizeBefore = 0;
+	TUInt32 iTotalSizeAfter = 0;
+
+	stringstream report;
+	report << "Vertex size before -> after, largest position error (model units "
+	       << "and fraction of size), normal / tangent angle (degrees), UV and colour error\n";
+	vector<TUInt8> encoded;
+	for (TUInt32 iSubMesh = 0; iSubMesh < importFile.GetNumSubMeshes(); ++iSubMesh)
+	{
+		CSubMeshData subMeshData;
+		EImportError eError = importFile.GetSubMesh( iSubMesh, &subMeshData, true );
+		if (eError != kSuccess)
+		{
+			return eError;
+		}
+		const SSubMesh& subMesh = subMeshData.Get();
+
+		SVertexElement aElements[kiMaxVertexElements];
+		TUInt32 iEncodedSize;
+		GetVertexElements( subMesh, format, aElements, &iEncodedSize );
+		encoded.resize( subMesh.numVertices * iEncodedSize + 1 );
+		SVertexDecode decode;
+		SVertexFormatError error;
+		EncodeVertices( subMesh, format, &encoded[0], &decode, &error );
+
+		// Position error relative to the largest dimension of the sub-mesh
+		TFloat32 fSize = 2.0f * Max( decode.positionScale.x, Max( decode.positionScale.y, decode.positionScale.z ) );
+		report << "  Sub-mesh " << iSubMesh << ": " << subMesh.numVertices << " vertices, "
+		       << subMesh.vertexSize << " -> " << iEncodedSize << " bytes, position "
+		       << setprecision( 3 ) << scientific << error.fPosition << " ("
+		       << error.fPosition / fSize << "), angle " << fixed << error.fNormal << " / "
+		       << error.fTangent << ", UV " << scientific << error.fTexCoord << ", colour "
+		       << fixed << error.fColour << "\n";
+
+		iTotalVertices += subMesh.numVertices;
+		iTotalSizeBefore += subMesh.numVertices * subMesh.vertexSize;
+		iTotalSizeAfter += subMesh.numVertices * iEncodedSize;
+		maxError.fPosition = Max( maxError.fPosition, error.fPosition );
+		maxError.fNormal = Max( maxError.fNormal, error.fNormal );
+		maxError.fTangent = Max( maxError.fTangent, error.fTangent );
+		maxError.fTexCoord = Max( maxError.fTexCoord, error.fTexCoord );
+		maxError.fColour = Max( maxError.fColour, error.fColour );
+	}
+
+	report << "  Total: " << iTotalVertices << " vertices, " << iTotalSizeBefore << " -> "
+	       << iTotalSizeAfter << " bytes, position " << setprecision( 3 ) << scientific
+	       << maxError.fPosition << ", angle " << fixed << maxError.fNormal << " / "
+	       << maxError.fTangent << ", UV " << scientific << maxError.fTexCoord << ", colour "
+	       << fixed << maxError.fColour << "\n";
+	*psReport = report.str();
+	return kSuccess;
+
+	GEN_ENDGUARD;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Levels of detail
+-----------------------------------------------------------------------------------------*/
+
+// Build the level of detail chain of each sub-mesh of an X-file and report on each level
+EImportError AnalyseMeshLODs
+(
+	CImportXFile& importFile,
+	string*       psReport
+)
+{
+	GEN_GUARD;
+
+	// Faces at each level summed over all sub-meshes (sub-meshes with fewer levels count their
+	// last level)
+	TUInt32 aiTotalFaces[kiMaxLODs];
+	memset( aiTotalFaces, 0, sizeof(aiTotalFaces) );
+	TFloat64 fTotalTime = 0.0;
+
+	stringstream report;
+	report << "Faces (error) of each level of detail\n";
+	SMeshLOD aLODs[kiMaxLODs];
+	vector<TUInt32> lodIndices;
+	for (TUInt32 iSubMesh = 0; iSubMesh < importFile.GetNumSubMeshes(); ++iSubMesh)
+	{
+		CSubMeshData subMeshData;
+		EImportError eError = importFile.GetSubMesh( iSubMesh, &subMeshData );
+		if (eError != kSuccess)
+		{
+			return eError;
+		}
+		const SSubMesh& subMesh = subMeshData.Get();
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		TUInt32 iNumLODs = BuildLODChain( subMesh, aLODs, &lodIndices );
+		TFloat64 fTime = chrono::duration<TFloat64>( chrono::steady_clock::now() - start ).count();
+		fTotalTime += fTime;
+
+		report << "  Sub-mesh " << iSubMesh << ": " << subMesh.numVertices << " vertices";
+		for (TUInt32 iLOD = 0; iLOD < kiMaxLODs; ++iLOD)
+		{
+			const SMeshLOD& lod = aLODs[iLOD < iNumLODs ? iLOD : iNumLODs - 1];
+			aiTotalFaces[iLOD] += lod.iNumFaces;
+			if (iLOD < iNumLODs)
+			{
+				report << ", " << lod.iNumFaces << " (" << setprecision( 3 ) << lod.fError << ")";
+			}
+		}
+		report << fixed << setprecision( 2 ) << " in " << fTime * 1000.0 << "ms\n";
+		report.unsetf( ios::fixed );
+	}
+
+	report << "  Total faces";
+	for (TUInt32 iLOD = 0; iLOD < kiMaxLODs; ++iLOD)
+	{
+		report << (iLOD ? ", " : " ") << aiTotalFaces[iLOD];
+	}
+	report << fixed << setprecision( 2 ) << " in " << fTotalTime * 1000.0 << "ms\n";
+
+	*psReport = report.str();
+	return kSuccess;
+
+	GEN_ENDGUARD;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Bounding volume hierarchies
+-----------------------------------------------------------------------------------------*/
+
+// Build the hierarchy of each sub-mesh of an X-file and time ray queries against it, compared to
+// testing every face
+EImportError AnalyseMeshBVH
+(
+	CImportXFile& importFile,
+	string*       psReport
+)
+{
+	GEN_GUARD;
+
+	const TUInt32 kiNumRays = 100000;
+	const TUInt32 kiNumBruteRays = 2000; // Testing every face is slow, so fewer rays are timed
+	TFloat64 fTotalBuild = 0.0, fTotalBVH = 0.0, fTotalBrute = 0.0;
+	TUInt32 iTotalFaces = 0, iTotalNodes = 0, iMismatches = 0;
+
+	stringstream report;
+	report << "Bounding volume hierarchy of each sub-mesh\n";
+	for (TUInt32 iSubMesh = 0; iSubMesh < importFile.GetNumSubMeshes(); ++iSubMesh)
+	{
+		CSubMeshData subMeshData;
+		EImportError eError = importFile.GetSubMesh( iSubMesh, &subMeshData );
+		if (eError != kSuccess)
+		{
+			return eError;
+		}
+		const SSubMesh& subMesh = subMeshData.Get();
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		CMeshBVH bvh;
+		bvh.Init( subMesh );
+		TFloat64 fBuild = chrono::duration<TFloat64>( chrono::steady_clock::now() - start ).count();
+
+		// Rays start on a sphere around the bounds and pass through a random point inside them
+		CVector3 vCentre = subMesh.bounds.centre;
+		CVector3 vSize = subMesh.bounds.maxBounds - subMesh.bounds.minBounds;
+		TFloat32 fRadius = Max( Length( vSize ), 1.0e-3f );
+		vector<CVector3> origins( kiNumRays ), directions( kiNumRays );
+		TUInt32 iRandom = 12345 + iSubMesh;
+		for (TUInt32 iRay = 0; iRay < kiNumRays; ++iRay)
+		{
+			CVector3 vOut( NextRandom( &iRandom ) - 0.5f, NextRandom( &iRandom ) - 0.5f, NextRandom( &iRandom ) - 0.5f );
+			if (LengthSquared( vOut ) < 1.0e-6f)
+			{
+				vOut = CVector3( 0.0f, 1.0f, 0.0f );
+			}
+			origins[iRay] = vCentre + Normalise( vOut ) * fRadius;
+			CVector3 vTarget = subMesh.bounds.minBounds + CVector3( vSize.x * NextRandom( &iRandom ), vSize.y * NextRandom( &iRandom ),
+			                                                        vSize.z * NextRandom( &iRandom ) );
+			directions[iRay] = vTarget - origins[iRay];
+		}
+
+		// Time the hierarchy, then check a subset of rays against every face
+		start = chrono::steady_clock::now();
+		TUInt32 iHits = 0;
+		SRayHit hit;
+		for (TUInt32 iRay = 0; iRay < kiNumRays; ++iRay)
+		{
+			iHits += bvh.IntersectRay( origins[iRay], directions[iRay], 3.0e38f, &hit ) ? 1 : 0;
+		}
+		TFloat64 fBVH = chrono::duration<TFloat64>( chrono::steady_clock::now() - start ).count();
+
+		start = chrono::steady_clock::now();
+		vector<SRayHit> bruteHits( kiNumBruteRays );
+		vector<bool> bruteHit( kiNumBruteRays );
+		for (TUInt32 iRay = 0; iRay < kiNumBruteRays; ++iRay)
+		{
+			bruteHit[iRay] = IntersectFaces( subMesh, origins[iRay], directions[iRay], 3.0e38f, &bruteHits[iRay] );
+		}
+		TFloat64 fBrute = chrono::duration<TFloat64>( chrono::steady_clock::now() - start ).count();
+		for (TUInt32 iRay = 0; iRay < kiNumBruteRays; ++iRay)
+		{
+			bool bHit = bvh.IntersectRay( origins[iRay], directions[iRay], 3.0e38f, &hit );
+			if (bHit != bruteHit[iRay] || (bHit && fabsf( hit.fDistance - bruteHits[iRay].fDistance ) > 1.0e-4f))
+			{
+				++iMismatches;
+			}
+		}
+
+		fTotalBuild += fBuild;
+		fTotalBVH += fBVH;
+		fTotalBrute += fBrute * kiNumRays / kiNumBruteRays;
+		iTotalFaces += subMesh.numFaces;
+		iTotalNodes += bvh.GetNumNodes();
+		report << "  Sub-mesh " << iSubMesh << ": " << subMesh.numFaces << " faces, " << bvh.GetNumNodes() << " nodes, "
+		       << bvh.GetMemorySize() / 1024 << "KB, " << fixed << setprecision( 2 ) << fBuild * 1000.0 << "ms build, "
+		       << setprecision( 0 ) << kiNumRays / fBVH / 1.0e3 << "K rays/s (" << kiNumBruteRays / fBrute / 1.0e3
+		       << "K testing every face), " << 100.0 * iHits / kiNumRays << "% hit\n";
+		report.unsetf( ios::fixed );
+	}
+
+	report << "  Total " << iTotalFaces << " faces, " << iTotalNodes << " nodes, " << fixed << setprecision( 2 )
+	       << fTotalBuild * 1000.0 << "ms build, " << setprecision( 0 ) << kiNumRays * importFile.GetNumSubMeshes() / fTotalBVH / 1.0e3
+	       << "K rays/s (" << kiNumRays * importFile.GetNumSubMeshes() / fTotalBrute / 1.0e3 << "K testing every face), "
+	       << iMismatches << " mismatches\n";
+
+	*psReport = report.str();
+	return kSuccess;
+
+	GEN_ENDGUARD;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Silhouettes
+-----------------------------------------------------------------------------------------*/
+
+// Build the edge adjacency of each sub-mesh of an X-file and extract its silhouette from random
+// viewpoints around it
+EImportError AnalyseSilhouettes
+(
+	CImportXFile& importFile,
+	string*       psReport,
+	CThreadPool*  pThreadPool /*= 0*/
+)
+{
+	GEN_GUARD;
+
+	const TUInt32 kiNumViews = 1000;
+	TFloat64 fTotalBuild = 0.0, fTotalExtract = 0.0, fTotalParallel = 0.0;
+	TUInt32 iTotalFaces = 0, iTotalHullVertices = 0, iTotalEdges = 0;
+	TFloat64 fTotalSilhouetteEdges = 0.0, fTotalUniqueVertices = 0.0;
+
+	stringstream report;
+	report << "Silhouette edges of each sub-mesh\n";
+	for (TUInt32 iSubMesh = 0; iSubMesh < importFile.GetNumSubMeshes(); ++iSubMesh)
+	{
+		CSubMeshData subMeshData;
+		EImportError eError = importFile.GetSubMesh( iSubMesh, &subMeshData );
+		if (eError != kSuccess)
+		{
+			return eError;
+		}
+		const SSubMesh& subMesh = subMeshData.Get();
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		vector<SMeshEdge> edges;
+		BuildEdgeAdjacency( subMesh, &edges );
+		TFloat64 fBuild = chrono::duration<TFloat64>( chrono::steady_clock::now() - start ).count();
+		TUInt32 iBorderEdges = 0;
+		for (TUInt32 iEdge = 0; iEdge < edges.size(); ++iEdge)
+		{
+			iBorderEdges += (edges[iEdge].aiFaces[1] == kiNoEdgeFace) ? 1 : 0;
+		}
+		CMeshSilhouette silhouette;
+		silhouette.Init( subMesh, edges.data(), static_cast<TUInt32>(edges.size()) );
+
+		// Viewpoints on a sphere a few times the size of the bounds
+		CVector3 vSize = subMesh.bounds.maxBounds - subMesh.bounds.minBounds;
+		TFloat32 fRadius = Max( Length( vSize ), 1.0e-3f ) * 2.0f;
+		vector<CVector3> viewPoints( kiNumViews );
+		TUInt32 iRandom = 12345 + iSubMesh;
+		for (TUInt32 iView = 0; iView < kiNumViews; ++iView)
+		{
+			CVector3 vOut( NextRandom( &iRandom ) - 0.5f, NextRandom( &iRandom ) - 0.5f, NextRandom( &iRandom ) - 0.5f );
+			if (LengthSquared( vOut ) < 1.0e-6f)
+			{
+				vOut = CVector3( 0.0f, 1.0f, 0.0f );
+			}
+			viewPoints[iView] = subMesh.bounds.centre + Normalise( vOut ) * fRadius;
+		}
+
+		// Time the extraction, and count the vertices the lines use - each at least once, at most
+		// twice (no vertex cache)
+		vector<TUInt32> lineIndices;
+		vector<TUInt8> vertexUsed( subMesh.numVertices );
+		TFloat64 fExtract = 0.0;
+		TUInt64 iSilhouetteEdges = 0, iUniqueVertices = 0;
+		for (TUInt32 iView = 0; iView < kiNumViews; ++iView)
+		{
+			lineIndices.clear();
+			start = chrono::steady_clock::now();
+			iSilhouetteEdges += silhouette.Extract( viewPoints[iView], &lineIndices );
+			fExtract += chrono::duration<TFloat64>( chrono::steady_clock::now() - start ).count();
+
+			fill( vertexUsed.begin(), vertexUsed.end(), 0 );
+			for (TUInt32 iIndex = 0; iIndex < lineIndices.size(); ++iIndex)
+			{
+				iUniqueVertices += vertexUsed[lineIndices[iIndex]] ? 0 : 1;
+				vertexUsed[lineIndices[iIndex]] = 1;
+			}
+		}
+
+		// Parallel extraction must give exactly the same lines
+		TFloat64 fParallel = 0.0;
+		if (pThreadPool)
+		{
+			vector<TUInt32> parallelIndices;
+			for (TUInt32 iView = 0; iView < kiNumViews; ++iView)
+			{
+				parallelIndices.clear();
+				start = chrono::steady_clock::now();
+				silhouette.Extract( viewPoints[iView], &parallelIndices, 0, pThreadPool );
+				fParallel += chrono::duration<TFloat64>( chrono::steady_clock::now() - start ).count();
+			}
+			lineIndices.clear();
+			silhouette.Extract( viewPoints[kiNumViews - 1], &lineIndices );
+			if (parallelIndices != lineIndices)
+			{
+				report << "  Sub-mesh " << iSubMesh << ": parallel extraction differs\n";
+			}
+		}
+
+		TFloat64 fEdges = static_cast<TFloat64>(iSilhouetteEdges) / kiNumViews;
+		TFloat64 fUnique = static_cast<TFloat64>(iUniqueVertices) / kiNumViews;
+		fTotalBuild += fBuild;
+		fTotalExtract += fExtract;
+		fTotalParallel += fParallel;
+		iTotalFaces += subMesh.numFaces;
+		iTotalHullVertices += subMesh.numVertices;
+		iTotalEdges += static_cast<TUInt32>(edges.size());
+		fTotalSilhouetteEdges += fEdges;
+		fTotalUniqueVertices += fUnique;
+		report << "  Sub-mesh " << iSubMesh << ": " << subMesh.numFaces << " faces, " << edges.size() << " edges ("
+		       << iBorderEdges << " border), " << fixed << setprecision( 2 ) << fBuild * 1000.0 << "ms build, "
+		       << setprecision( 0 ) << fEdges << " silhouette edges, " << fUnique << "-" << fEdges * 2.0
+		       << " line vertices vs " << subMesh.numVertices << " hull vertices and " << subMesh.numFaces << " hull faces, "
+		       << setprecision( 1 ) << fExtract * 1.0e6 / kiNumViews << "us extract";
+		if (pThreadPool)
+		{
+			report << " (" << fParallel * 1.0e6 / kiNumViews << "us parallel)";
+		}
+		report << "\n";
+		report.unsetf( ios::fixed );
+	}
+
+	report << "  Total " << iTotalFaces << " faces, " << iTotalEdges << " edges, " << fixed << setprecision( 2 )
+	       << fTotalBuild * 1000.0 << "ms build, " << setprecision( 0 ) << fTotalSilhouetteEdges << " silhouette edges, "
+	       << fTotalUniqueVertices << "-" << fTotalSilhouetteEdges * 2.0 << " line vertices vs " << iTotalHullVertices
+	       << " hull vertices (" << setprecision( 1 ) << 100.0 * fTotalSilhouetteEdges * 2.0 / Max( iTotalHullVertices, 1u )
+	       << "%), " << fTotalExtract * 1.0e6 / kiNumViews << "us extract";
+	if (pThreadPool)
+	{
+		report << " (" << fTotalParallel * 1.0e6 / kiNumViews << "us parallel)";
+	}
+	report << "\n";
+
+	*psReport = report.str();
+	return kSuccess;
+
+	GEN_ENDGUARD;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Clusters
+-----------------------------------------------------------------------------------------*/
+
+// Optimise and cluster each sub-mesh of an X-file, then fly a camera along paths through it,
+// culling the clusters each frame
+EImportError AnalyseMeshClusters
+(
+	CImportXFile& importFile,
+	string*       psReport
+)
+{
+	GEN_GUARD;
+
+	const TUInt32 kiNumFrames = 360;
+	const TFloat32 kfFOV = kfPi / 3.0f;
+	const TFloat32 kfAspect = 4.0f / 3.0f;
+	const char* asPathNames[2] = { "fly-through", "orbit" };
+
+	stringstream report;
+	report << "Clusters of each sub-mesh, culled along a " << kiNumFrames << " frame fly-through "
+	       << "(close, looking ahead and down) and orbit (whole mesh in view)\n";
+	for (TUInt32 iSubMesh = 0; iSubMesh < importFile.GetNumSubMeshes(); ++iSubMesh)
+	{
+		CSubMeshData subMeshData;
+		EImportError eError = importFile.GetSubMesh( iSubMesh, &subMeshData );
+		if (eError != kSuccess)
+		{
+			return eError;
+		}
+		const SSubMesh& subMesh = subMeshData.Get();
+		if (subMesh.numFaces == 0)
+		{
+			continue;
+		}
+
+		// Cluster the faces in the order they would be cooked, checking the cost to the vertex cache
+		OptimiseSubMesh( subMesh );
+		vector<TUInt32> indices;
+		GetSubMeshIndices( subMesh, &indices );
+		SVertexCacheStats before = AnalyseVertexCache( indices.data(), subMesh.numFaces, subMesh.numVertices );
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		vector<SMeshCluster> clusters;
+		BuildMeshClusters( subMesh, &clusters );
+		TFloat64 fBuild = chrono::duration<TFloat64>( chrono::steady_clock::now() - start ).count();
+		GetSubMeshIndices( subMesh, &indices );
+		SVertexCacheStats after = AnalyseVertexCache( indices.data(), subMesh.numFaces, subMesh.numVertices );
+
+		TUInt32 iNumClusters = static_cast<TUInt32>(clusters.size());
+		TUInt32 iTotalVertices = 0, iNoCone = 0;
+		vector<TUInt32> vertexCluster( subMesh.numVertices, kiNoCluster );
+		for (TUInt32 iCluster = 0; iCluster < iNumClusters; ++iCluster)
+		{
+			const SMeshCluster& cluster = clusters[iCluster];
+			for (TUInt32 iIndex = cluster.iFirstFace * 3; iIndex < (cluster.iFirstFace + cluster.iNumFaces) * 3; ++iIndex)
+			{
+				iTotalVertices += (vertexCluster[indices[iIndex]] == iCluster) ? 0 : 1;
+				vertexCluster[indices[iIndex]] = iCluster;
+			}
+			iNoCone += (cluster.fConeCutoff == kfNoClusterCone) ? 1 : 0;
+		}
+		report << "  Sub-mesh " << iSubMesh << ": " << subMesh.numFaces << " faces, " << iNumClusters << " clusters ("
+		       << fixed << setprecision( 1 ) << static_cast<TFloat32>(subMesh.numFaces) / iNumClusters << " faces, "
+		       << static_cast<TFloat32>(iTotalVertices) / iNumClusters << " vertices average, " << iNoCone << " without cone), "
+		       << setprecision( 2 ) << fBuild * 1000.0 << "ms build, ACMR " << setprecision( 3 ) << before.fACMR
+		       << " -> " << after.fACMR << (subMesh.numFaces < kiMinClusteredFaces ? ", not clustered when cooked" : "")
+		       << "\n";
+
+		// Face planes to check that culled faces could not be seen
+		vector<CVector3> facePoints( subMesh.numFaces ), faceNormals( subMesh.numFaces );
+		for (TUInt32 iFace = 0; iFace < subMesh.numFaces; ++iFace)
+		{
+			facePoints[iFace] = GetPosition( subMesh, indices[iFace * 3] );
+			faceNormals[iFace] = GetFaceNormal( subMesh, &indices[iFace * 3] );
+		}
+
+		// The fly-through circles just above the mesh looking ahead and down, so much of the mesh
+		// is behind or beside the camera. The orbit circles further out looking at the centre
+		CVector3 vSize = subMesh.bounds.maxBounds - subMesh.bounds.minBounds;
+		TFloat32 fRadius = Max( Length( vSize ) * 0.5f, 1.0e-3f );
+		for (TUInt32 iPath = 0; iPath < 2; ++iPath)
+		{
+			SClusterCullStats stats = { 0, 0, 0, 0, 0 };
+			vector<SClusterDrawRange> ranges;
+			TUInt64 iNumRanges = 0, iBackFaces = 0;
+			TUInt32 iNumErrors = 0;
+			TFloat64 fCull = 0.0;
+			for (TUInt32 iFrame = 0; iFrame < kiNumFrames; ++iFrame)
+			{
+				TFloat32 fAngle = 2.0f * kfPi * iFrame / kiNumFrames;
+				CVector3 vAround( sin( fAngle ), 0.0f, cos( fAngle ) );
+				CVector3 vPosition, vDirection;
+				if (iPath == 0)
+				{
+					vPosition = CVector3( subMesh.bounds.centre.x + vAround.x * vSize.x * 0.3f, subMesh.bounds.maxBounds.y + vSize.y * 0.1f,
+					                      subMesh.bounds.centre.z + vAround.z * vSize.z * 0.3f );
+					vDirection = CVector3( vAround.z, -0.6f, -vAround.x );
+				}
+				else
+				{
+					vPosition = subMesh.bounds.centre + vAround * fRadius * 2.5f + CVector3( 0.0f, fRadius * 0.5f, 0.0f );
+					vDirection = subMesh.bounds.centre - vPosition;
+				}
+				CMatrix4x4 view = InverseAffine( MatrixFaceDirection( vPosition, vDirection ) );
+				CMatrix4x4 viewProj = view * MatrixPerspective( kfFOV, kfAspect, fRadius * 0.001f, fRadius * 10.0f );
+
+				ranges.clear();
+				TUInt32 iFacesCulled = stats.iNumFacesCulled;
+				start = chrono::steady_clock::now();
+				CVector4 aPlanes[6];
+				GetFrustumPlanes( viewProj, aPlanes );
+				CullMeshClusters( clusters.data(), iNumClusters, aPlanes, vPosition, &ranges, &stats );
+				fCull += chrono::duration<TFloat64>( chrono::steady_clock::now() - start ).count();
+				iNumRanges += ranges.size();
+
+				// Every face not drawn must face away or be outside a plane
+				vector<TUInt8> drawn( subMesh.numFaces, 0 );
+				for (TUInt32 iRange = 0; iRange < ranges.size(); ++iRange)
+				{
+					fill( drawn.begin() + ranges[iRange].iFirstFace, drawn.begin() + ranges[iRange].iFirstFace + ranges[iRange].iNumFaces, 1 );
+				}
+				TUInt32 iNumCulled = 0;
+				for (TUInt32 iFace = 0; iFace < subMesh.numFaces; ++iFace)
+				{
+					bool bBackFace = Dot( faceNormals[iFace], vPosition - facePoints[iFace] ) <= 0.0f;
+					iBackFaces += bBackFace ? 1 : 0;
+					if (drawn[iFace])
+					{
+						continue;
+					}
+					++iNumCulled;
+					bool bOutside = false;
+					for (TUInt32 iPlane = 0; iPlane < 6 && !bOutside; ++iPlane)
+					{
+						bOutside = true;
+						for (TUInt32 iCorner = 0; iCorner < 3; ++iCorner)
+						{
+							CVector3 p = GetPosition( subMesh, indices[iFace * 3 + iCorner] );
+							bOutside &= aPlanes[iPlane].x * p.x + aPlanes[iPlane].y * p.y + aPlanes[iPlane].z * p.z +
+							            aPlanes[iPlane].w <= fRadius * 1.0e-4f;
+						}
+					}
+					if (!bOutside && Dot( faceNormals[iFace], vPosition - facePoints[iFace] ) > Length( faceNormals[iFace] ) * fRadius * 1.0e-4f)
+					{
+						++iNumErrors;
+					}
+				}
+				iNumErrors += (iNumCulled == stats.iNumFacesCulled - iFacesCulled) ? 0 : 1;
+			}
+
+			TFloat64 fFrames = static_cast<TFloat64>(kiNumFrames);
+			report << "    " << asPathNames[iPath] << ": " << setprecision( 1 ) << stats.iNumFrustumCulled / fFrames
+			       << " frustum + " << stats.iNumConeCulled / fFrames << " cone culled of " << iNumClusters << " clusters, "
+			       << stats.iNumFacesCulled / fFrames << " of " << subMesh.numFaces << " faces culled ("
+			       << 100.0 * stats.iNumFacesCulled / (fFrames * subMesh.numFaces) << "%, "
+			       << 100.0 * iBackFaces / (fFrames * subMesh.numFaces) << "% face away), "
+			       << iNumRanges / fFrames << " draw ranges, " << fCull * 1.0e6 / fFrames << "us cull";
+			if (iNumErrors)
+			{
+				report << ", " << iNumErrors << " visible faces culled";
+			}
+			report << "\n";
+		}
+		report.unsetf( ios::fixed );
+	}
+
+	*psReport = report.str();
+	return kSuccess;
+
+	GEN_ENDGUARD;
+}
+
+
+} // namespace gen
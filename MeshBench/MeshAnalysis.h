@@ -0,0 +1,113 @@
+/**************************************************************************************************
+	Module:       MeshAnalysis.h
+	Date created: 18/10/26
+
+	Reports on the mesh processing of the import library, run on imported X-files without a GPU:
+	vertex cache optimisation, compact vertex formats, levels of detail, bounding volume
+	hierarchies, silhouette edges and clusters
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#ifndef GEN_MESH_ANALYSIS_H_INCLUDED
+#define GEN_MESH_ANALYSIS_H_INCLUDED
+
+#include <string>
+using namespace std;
+
+#include "GenDefines.h"
+#include "CImportXFile.h"
+#include "MeshOptimise.h"
+#include "VertexFormat.h"
+
+namespace gen
+{
+
+class CThreadPool;
+
+// Each function reports on every sub-mesh of an imported file. The report is text, a line per
+// sub-mesh followed by totals for the file. The sub-meshes are read from the file again for each
+// report, so one import can be shared by any number of them
+
+
+// Analyse the vertex cache use of each sub-mesh before and after optimisation (see
+// OptimiseSubMesh), with FIFO and LRU caches of the given size
+// Possible return values:
+//		kSuccess:			...
+//		(Errors from CImportXFile::GetSubMesh)
+EImportError AnalyseOptimisation
+(
+	CImportXFile& importFile,
+	string*       psReport,
+	const TUInt32 iCacheSize = kiDefaultVertexCacheSize
+);
+
+// Analyse the error of encoding each sub-mesh (with tangents) in the given format. Reports the
+// vertex size before and after encoding and the largest errors
+// Possible return values:
+//		kSuccess:			...
+//		(Errors from CImportXFile::GetSubMesh)
+EImportError AnalyseVertexFormat
+(
+	CImportXFile&        importFile,
+	const SVertexFormat& format,
+	string*              psReport
+);
+
+// Build the level of detail chain of each sub-mesh and report the faces and error of each level
+// and the time taken
+// Possible return values:
+//		kSuccess:			...
+//		(Errors from CImportXFile::GetSubMesh)
+EImportError AnalyseMeshLODs
+(
+	CImportXFile& importFile,
+	string*       psReport
+);
+
+// Build the hierarchy of each sub-mesh and time ray queries against it, compared to testing every
+// face. Random rays are fired from points around each sub-mesh's bounds through points inside
+// them. Reports the nodes, build time and rays per second of both methods, and checks both
+// methods find the same hits
+// Possible return values:
+//		kSuccess:			...
+//		(Errors from CImportXFile::GetSubMesh)
+EImportError AnalyseMeshBVH
+(
+	CImportXFile& importFile,
+	string*       psReport
+);
+
+// Build the edge adjacency of each sub-mesh and extract its silhouette from random viewpoints
+// around it. Compares the vertices processed drawing the silhouette edges as lines against
+// drawing an expanded copy of the whole mesh for the outline. Reports the edges, border edges,
+// average silhouette edges, vertices processed both ways and the extraction time
+// Possible return values:
+//		kSuccess:			...
+//		(Errors from CImportXFile::GetSubMesh)
+EImportError AnalyseSilhouettes
+(
+	CImportXFile& importFile,
+	string*       psReport,
+	CThreadPool*  pThreadPool = 0
+);
+
+// Optimise and cluster each sub-mesh, then move a camera along two paths - a close fly-through
+// and an orbit with the whole mesh in view - and cull the clusters each frame. Reports the
+// clusters, their average size and the vertex cache miss ratio before and after clustering, then
+// a line per path with the average clusters and faces culled per frame, draw ranges and culling
+// time. Every culled face is checked to be outside the frustum or facing away
+// Possible return values:
+//		kSuccess:			...
+//		(Errors from CImportXFile::GetSubMesh)
+EImportError AnalyseMeshClusters
+(
+	CImportXFile& importFile,
+	string*       psReport
+);
+
+
+} // namespace gen
+
+#endif // GEN_MESH_ANALYSIS_H_INCLUDED
@@ -0,0 +1,296 @@
+/**************************************************************************************************
+	Module:       MeshBench.cpp
+	Date created: 18/10/26
+
+	Console tool printing reports on the mesh processing of the import library for X-files (see
+	MeshAnalysis.h), and running benchmarks and conversions on them (see ImportBenchmarks.h).
+	Usage:
+		MeshBench [-cache] [-format] [-lod] [-bvh] [-silhouette] [-cluster] [-parse]
+		          [-convert] [-parse-encodings] [-cook] [-memory] [-allocations] [-tangents]
+		          [-threads] [-index-size] [-interleave] [-split] <file.x> ...
+	Each option selects a report, all of the mesh processing reports are printed if none are given.
+	Checks and benchmarks on synthetic meshes (see MeshChecks.h and SyntheticMesh.h) are run once
+	and need no files
+	  -parse             Time importing an X-file, reporting the parse throughput in MB/s
+	  -convert           Convert a text X-file to binary, written beside it as <file>.bin.x
+	  -parse-encodings   Time parsing a text X-file and its binary and compressed encodings
+	  -cook              Cook an X-file, written beside it as <file>.cooked and <file>.tan.cooked
+	                     (with tangents), and time a cold import against a load of the cooked file
+	  -memory            Compare the peak memory of a streaming import with a full import
+	  -allocations       Count the heap allocations of an import, and time it
+	  -tangents          Time the tangent calculation of a file on one thread and on all of them
+	  -threads           Time loading all of the files together on 1, 2, 4 and N threads, as the app
+	                     does at startup, cold and from cooked files (left beside them)
+	  -index-size        Check the index size of grids either side of the 16-bit index limit
+	  -interleave        Time writing the vertex data of a grid with each layout, in vertices/s
+	  -split             Time splitting a grid with 1, 8 and 64 materials into sub-meshes
+
+	On Windows build MeshBench.vcxproj in GraphicsAssign1.sln. On Linux (GCC or Clang) build from
+	the MeshBench directory with:
+		g++ -std=c++14 -O2 -pthread -I../Import -I../Import/Common -I../Import/Math *.cpp
+		    ../Import/*.cpp ../Import/Common/*.cpp ../Import/Math/*.cpp -o MeshBench
+	e.g. then "./MeshBench -cache ../Troll.x" for the ACMR / ATVR of the troll before and after
+	vertex cache optimisation
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "MeshAnalysis.h"
+#include "ImportBenchmarks.h"
+#include "MeshChecks.h"
+#include "CImportXFile.h"
+#include "CXFileBinaryWriter.h"
+#include "CThreadPool.h"
+#include "Error.h"
+
+using namespace gen;
+
+
+//-----------------------------------------------------------------------------
+// Reports
+//-----------------------------------------------------------------------------
+
+enum EReport
+{
+	// Reports on an imported file (see MeshAnalysis.h), all of these are printed by default
+	kReportCache,
+	kReportFormat,
+	kReportLOD,
+	kReportBVH,
+	kReportSilhouette,
+	kReportCluster,
+
+	// Benchmarks and conversions that read the file themselves
+	kReportParse,
+	kReportConvert,
+	kReportEncodings,
+	kReportCook,
+	kReportMemory,
+	kReportAllocations,
+	kReportTangents,
+
+	// Benchmarks on all of the files together
+	kReportThreads,
+
+	// Checks and benchmarks on synthetic meshes, run once rather than for each file
+	kReportIndexSize,
+	kReportInterleave,
+	kReportSplit,
+	kNumReports
+};
+const int kNumImportReports = kReportParse;   // Reports before this are on an imported file
+const int kNumFileReports = kReportThreads;   // Reports before this are run for each file
+const int kNumListReports = kReportIndexSize; // Reports before this need files
+
+// Command line option for each report
+const char* const ReportOptions[kNumReports] =
+{
+	"-cache", "-format", "-lod", "-bvh", "-silhouette", "-cluster", "-parse", "-convert",
+	"-parse-encodings", "-cook", "-memory", "-allocations", "-tangents", "-threads",
+	"-index-size", "-interleave", "-split"
+};
+
+// Convert a text X-file to a binary X-file beside it, <file>.bin.x
+EImportError ConvertFile
+(
+	const string& fileName,
+	string*       report
+)
+{
+	string binaryFileName = fileName.substr( 0, fileName.rfind( '.' ) ) + ".bin.x";
+	EImportError error = CXFileBinaryWriter::ConvertTextFile( fileName, binaryFileName );
+	if (error == kSuccess)
+	{
+		*report = "Converted to " + binaryFileName + "\n";
+	}
+	return error;
+}
+
+// Print the selected reports for a single file. Returns false if the file could not be imported
+// or read
+bool ReportFile
+(
+	const string& fileName,
+	const bool*   reports,
+	CThreadPool*  threadPool
+)
+{
+	cout << fileName << "\n";
+
+	// The file is imported once for all of the reports that need it
+	CImportXFile importFile;
+	EImportError error = kSuccess;
+	for (int i = 0; i < kNumImportReports; ++i)
+	{
+		if (reports[i])
+		{
+			error = importFile.ImportFile( fileName );
+			break;
+		}
+	}
+
+	string report;
+	for (int i = 0; i < kNumFileReports && error == kSuccess; ++i)
+	{
+		if (!reports[i]) continue;
+		switch (i)
+		{
+			case kReportCache:       error = AnalyseOptimisation( importFile, &report );                       break;
+			case kReportFormat:      error = AnalyseVertexFormat( importFile, kVertexFormatCompact, &report ); break;
+			case kReportLOD:         error = AnalyseMeshLODs( importFile, &report );                           break;
+			case kReportBVH:         error = AnalyseMeshBVH( importFile, &report );                            break;
+			case kReportSilhouette:  error = AnalyseSilhouettes( importFile, &report, threadPool );            break;
+			case kReportCluster:     error = AnalyseMeshClusters( importFile, &report );                       break;
+			case kReportParse:       error = BenchmarkParse( fileName, &report );                              break;
+			case kReportConvert:     error = ConvertFile( fileName, &report );                                 break;
+			case kReportEncodings:   error = BenchmarkEncodings( fileName, &report );                          break;
+			case kReportCook:        error = BenchmarkCooking( fileName, &report );                            break;
+			case kReportMemory:      error = BenchmarkImportMemory( fileName, &report );                       break;
+			case kReportAllocations: error = BenchmarkAllocations( fileName, &report );                        break;
+			case kReportTangents:    error = BenchmarkTangents( fileName, threadPool, &report );               break;
+		}
+		if (error == kSuccess)
+		{
+			cout << report;
+		}
+	}
+
+	if (error != kSuccess)
+	{
+		cerr << "Error " << error << " reading " << fileName << "\n";
+		return false;
+	}
+	cout << "\n";
+	return true;
+}
+
+// Print the selected reports on all of the files together. Returns false if any could not be run
+bool ReportFileList
+(
+	const vector<string>& fileNames,
+	const bool*           reports
+)
+{
+	bool success = true;
+	for (int i = kNumFileReports; i < kNumListReports; ++i)
+	{
+		if (!reports[i]) continue;
+		string report;
+		EImportError error = kSuccess;
+		switch (i)
+		{
+			case kReportThreads: error = BenchmarkLoadThreads( fileNames, &report ); break;
+		}
+		if (error != kSuccess)
+		{
+			cerr << "Error " << error << " running " << ReportOptions[i] << "\n";
+			success = false;
+		}
+		else
+		{
+			cout << report << "\n";
+		}
+	}
+	return success;
+}
+
+// Print the selected reports that are run once, without files. Returns false if any could not be
+// run or a check failed
+bool ReportOnce( const bool* reports )
+{
+	bool success = true;
+	for (int i = kNumListReports; i < kNumReports; ++i)
+	{
+		if (!reports[i]) continue;
+		string report;
+		bool passed = true;
+		EImportError error = kSuccess;
+		switch (i)
+		{
+			case kReportIndexSize:  error = CheckIndexSizes( &report, &passed ); break;
+			case kReportInterleave: error = BenchmarkInterleave( &report );      break;
+			case kReportSplit:      error = BenchmarkSplit( &report );           break;
+		}
+		if (error != kSuccess)
+		{
+			cerr << "Error " << error << " running " << ReportOptions[i] << "\n";
+			success = false;
+		}
+		else
+		{
+			cout << report << "\n";
+			success = success && passed;
+		}
+	}
+	return success;
+}
+
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main( int argc, char* argv[] )
+{
+	GEN_SENTRY
+
+	// Read options and file names
+	bool reports[kNumReports] = { false };
+	bool anyReports = false;
+	vector<string> fileNames;
+	for (int arg = 1; arg < argc; ++arg)
+	{
+		int option = 0;
+		while (option < kNumReports && strcmp( argv[arg], ReportOptions[option] ) != 0) ++option;
+		if (option < kNumReports)
+		{
+			reports[option] = true;
+			anyReports = true;
+		}
+		else if (argv[arg][0] == '-')
+		{
+			cerr << "Unknown option " << argv[arg] << "\n";
+			return EXIT_FAILURE;
+		}
+		else
+		{
+			fileNames.push_back( argv[arg] );
+		}
+	}
+	if (!anyReports)
+	{
+		for (int i = 0; i < kNumImportReports; ++i) reports[i] = true;
+	}
+	bool anyFileReports = false;
+	bool anyListReports = false;
+	for (int i = 0; i < kNumFileReports; ++i) anyFileReports = anyFileReports || reports[i];
+	for (int i = kNumFileReports; i < kNumListReports; ++i) anyListReports = anyListReports || reports[i];
+	if ((anyFileReports || anyListReports) == fileNames.empty())
+	{
+		cerr << "Usage: MeshBench [-cache] [-format] [-lod] [-bvh] [-silhouette] [-cluster] [-parse]\n"
+		     << "                 [-convert] [-parse-encodings] [-cook] [-memory] [-allocations] [-tangents]\n"
+		     << "                 [-threads] [-index-size] [-interleave] [-split] <file.x> ...\n";
+		return EXIT_FAILURE;
+	}
+
+	// Checks and benchmarks on synthetic meshes first, then the reports on each file and on all of the files.
+	// Silhouette extraction is split over the threads of a pool
+	bool success = ReportOnce( reports );
+	CThreadPool threadPool;
+	for (unsigned int file = 0; anyFileReports && file < fileNames.size(); ++file)
+	{
+		success = ReportFile( fileNames[file], reports, &threadPool ) && success;
+	}
+	success = ReportFileList( fileNames, reports ) && success;
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+
+	GEN_ENDSENTRY
+}
@@ -0,0 +1,173 @@
+/**************************************************************************************************
+	Module:       MeshChecks.cpp
+	Date created: 18/10/26
+
+	Checks of the import library on synthetic meshes (see SyntheticMesh.h), for limits that the
+	scene's models do not reach
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+#include "MeshChecks.h"
+#include "SyntheticMesh.h"
+#include "CCookedMesh.h"
+#include "Error.h"
+
+namespace gen
+{
+
+namespace
+{
+	// Largest vertex index in the faces of a sub-mesh, and whether every index is in range
+	TUInt32 GetLargestIndex
+	(
+		const SSubMesh& subMesh,
+		bool*           pbInRange
+	)
+	{
+		TUInt32 iLargest = 0;
+		for (TUInt32 iIndex = 0; iIndex < subMesh.numFaces * 3; ++iIndex)
+		{
+			TUInt32 iVertex = (subMesh.indexSize == sizeof(TUInt32)) ?
+			                  reinterpret_cast<const TUInt32*>(subMesh.faces)[iIndex] :
+			                  reinterpret_cast<const TUInt16*>(subMesh.faces)[iIndex];
+			iLargest = (iVertex > iLargest) ? iVertex : iLargest;
+		}
+		*pbInRange = (iLargest < subMesh.numVertices);
+		return iLargest;
+	}
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Index sizes
+-----------------------------------------------------------------------------------------*/
+
+// Check the index size of grids either side of the 16-bit index limit
+EImportError CheckIndexSizes
+(
+	string* psReport,
+	bool*   pbPassed
+)
+{
+	GEN_GUARD;
+
+	const TUInt32 aiGridSizes[2] = { 256, 257 };
+
+	stringstream report;
+	report << "Index size of grids either side of the 16-bit index limit\n";
+	*pbPassed = true;
+	EImportError eError = kSuccess;
+	for (TUInt32 iGrid = 0; iGrid < 2 && eError == kSuccess; ++iGrid)
+	{
+		const TUInt32 iGridSize = aiGridSizes[iGrid];
+		const TUInt32 iNumVertices = iGridSize * iGridSize;
+		const TUInt32 iIndexSize = (iNumVertices <= 0x10000) ? sizeof(TUInt16) : sizeof(TUInt32);
+		stringstream gridName;
+		gridName << "IndexGrid" << iGridSize << ".x";
+		const string sFileName = gridName.str();
+		if (!SaveTextFile( sFileName, MakeGridXFile( iGridSize ) ))
+		{
+			eError = kFileError;
+			break;
+		}
+		remove( CCookedMesh::GetCookedFileName( sFileName ).c_str() );
+
+		// Import the grid and check its single sub-mesh
+		CImportXFile importFile;
+		CSubMeshData subMeshData;
+		eError = importFile.ImportFile( sFileName );
+		if (eError == kSuccess)
+		{
+			eError = importFile.GetSubMesh( 0, &subMeshData );
+		}
+
+		// Cook the grid, then load it again from the cooked file
+		CCookedMesh cooked;
+		CCookedMesh cached;
+		if (eError == kSuccess)
+		{
+			eError = cooked.Load( sFileName );
+		}
+		if (eError == kSuccess)
+		{
+			eError = cached.Load( sFileName );
+		}
+		remove( CCookedMesh::GetCookedFileName( sFileName ).c_str() );
+		remove( sFileName.c_str() );
+		if (eError != kSuccess)
+		{
+			break;
+		}
+
+		const SSubMesh& subMesh = subMeshData.Get();
+		bool bInRange;
+		TUInt32 iLargest = GetLargestIndex( subMesh, &bInRange );
+		report << "  " << iGridSize << "x" << iGridSize << ": " << subMesh.numVertices
+		       << " vertices, " << subMesh.numFaces << " faces, " << subMesh.indexSize
+		       << " byte indices, largest index " << iLargest;
+		string sFailure;
+		if (importFile.GetNumSubMeshes() != 1 || subMesh.numVertices != iNumVertices)
+		{
+			sFailure = "expected a single sub-mesh with every grid vertex";
+		}
+		else if (subMesh.indexSize != iIndexSize)
+		{
+			sFailure = "wrong index size";
+		}
+		else if (iLargest != iNumVertices - 1 || !bInRange)
+		{
+			sFailure = "indices out of range";
+		}
+		else if (cooked.IsFromCache() || !cached.IsFromCache() || cached.GetNumSubMeshes() != 1)
+		{
+			sFailure = "cooked file not written or not read back";
+		}
+		else
+		{
+			const SSubMesh& cookedMesh = cooked.GetSubMesh( 0 );
+			const SSubMesh& cachedMesh = cached.GetSubMesh( 0 );
+			GetLargestIndex( cachedMesh, &bInRange );
+			report << ", cooked " << cachedMesh.indexSize << " byte indices";
+			if (cookedMesh.indexSize != iIndexSize || cachedMesh.indexSize != iIndexSize || !bInRange)
+			{
+				sFailure = "wrong index size after cooking";
+			}
+			else if (cachedMesh.numVertices != cookedMesh.numVertices ||
+			         cachedMesh.numFaces != cookedMesh.numFaces ||
+			         cachedMesh.vertexSize != cookedMesh.vertexSize ||
+			         memcmp( cachedMesh.faces, cookedMesh.faces, cookedMesh.numFaces * 3 * iIndexSize ) != 0 ||
+			         memcmp( cachedMesh.vertices, cookedMesh.vertices,
+			                 cookedMesh.numVertices * cookedMesh.vertexSize ) != 0)
+			{
+				sFailure = "cooked file read back differs";
+			}
+		}
+		if (sFailure.empty())
+		{
+			report << ", ok\n";
+		}
+		else
+		{
+			report << ", FAILED: " << sFailure << "\n";
+			*pbPassed = false;
+		}
+	}
+
+	if (eError != kSuccess)
+	{
+		return eError;
+	}
+	*psReport = report.str();
+	return kSuccess;
+
+	GEN_ENDGUARD;
+}
+
+
+} // namespace gen
@@ -0,0 +1,47 @@
+/**************************************************************************************************
+	Module:       MeshChecks.h
+	Date created: 18/10/26
+
+	Checks of the import library on synthetic meshes (see SyntheticMesh.h), for limits that the
+	scene's models do not reach
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#ifndef GEN_MESH_CHECKS_H_INCLUDED
+#define GEN_MESH_CHECKS_H_INCLUDED
+
+#include <string>
+using namespace std;
+
+#include "GenDefines.h"
+#include "CImportXFile.h"
+
+namespace gen
+{
+
+// Each check reports a line per case, ending "ok" or "FAILED" with the reason, and returns
+// whether every case passed through pbPassed. Files are written to the current directory while
+// a check runs and deleted after it
+
+
+// Check the index size of grids either side of the 16-bit index limit - 256x256 vertices (largest
+// index 65535) must use 16-bit indices and 257x257 vertices 32-bit indices. Checks the imported
+// sub-mesh's index size, largest index and that every index is in range, then that the cooked
+// file written and read back by CCookedMesh::Load has the same index size and identical faces
+// and vertices
+// Possible return values:
+//		kSuccess:			The check was run, see pbPassed for its result
+//		kFileError:			The grid files could not be written
+//		(Errors from CImportXFile::ImportFile or CCookedMesh::Load)
+EImportError CheckIndexSizes
+(
+	string* psReport,
+	bool*   pbPassed
+);
+
+
+} // namespace gen
+
+#endif // GEN_MESH_CHECKS_H_INCLUDED
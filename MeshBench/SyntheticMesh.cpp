@@ -0,0 +1,129 @@
+/**************************************************************************************************
+	Module:       SyntheticMesh.cpp
+	Date created: 18/10/26
+
+	Synthetic X-files built in memory, for checks and benchmarks that need meshes of an exact
+	size or shape rather than the scene's models
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#include <cstdio>
+#include <sstream>
+#include <iomanip>
+
+#include "SyntheticMesh.h"
+
+namespace gen
+{
+
+// Build a text X-file of a flat grid with the given number of materials
+string MakeGridXFile
+(
+	const TUInt32 iGridSize,
+	const TUInt32 iNumMaterials /*= 1*/,
+	const TUInt32 iComponents /*= 0*/
+)
+{
+	const TUInt32 iNumVertices = iGridSize * iGridSize;
+	const TUInt32 iNumSquares = (iGridSize - 1) * (iGridSize - 1);
+
+	stringstream file;
+	file << fixed << setprecision( 6 );
+	file << "xof 0303txt 0032\n";
+	file << "Mesh Grid {\n";
+
+	// Vertices row by row, then two faces for each square between four of them
+	file << iNumVertices << ";\n";
+	for (TUInt32 iVertex = 0; iVertex < iNumVertices; ++iVertex)
+	{
+		file << static_cast<TFloat32>(iVertex % iGridSize) << ";0.000000;"
+		     << static_cast<TFloat32>(iVertex / iGridSize) << ";"
+		     << (iVertex + 1 < iNumVertices ? ",\n" : ";\n");
+	}
+	file << iNumSquares * 2 << ";\n";
+	for (TUInt32 iSquare = 0; iSquare < iNumSquares; ++iSquare)
+	{
+		TUInt32 iCorner = (iSquare / (iGridSize - 1)) * iGridSize + iSquare % (iGridSize - 1);
+		file << "3;" << iCorner << ";" << iCorner + iGridSize << ";" << iCorner + 1 << ";,\n";
+		file << "3;" << iCorner + 1 << ";" << iCorner + iGridSize << ";" << iCorner + iGridSize + 1
+		     << ";" << (iSquare + 1 < iNumSquares ? ",\n" : ";\n");
+	}
+
+	// Optional vertex components, each with a value for every vertex
+	if (iComponents & kGridNormals)
+	{
+		file << "MeshNormals {\n";
+		file << "1;\n0.000000;1.000000;0.000000;;\n";
+		file << iNumSquares * 2 << ";\n";
+		for (TUInt32 iFace = 0; iFace < iNumSquares * 2; ++iFace)
+		{
+			file << "3;0;0;0;" << (iFace + 1 < iNumSquares * 2 ? ",\n" : ";\n");
+		}
+		file << "}\n";
+	}
+	if (iComponents & kGridTextureCoords)
+	{
+		file << "MeshTextureCoords {\n";
+		file << iNumVertices << ";\n";
+		for (TUInt32 iVertex = 0; iVertex < iNumVertices; ++iVertex)
+		{
+			file << static_cast<TFloat32>(iVertex % iGridSize) << ";"
+			     << static_cast<TFloat32>(iVertex / iGridSize) << ";"
+			     << (iVertex + 1 < iNumVertices ? ",\n" : ";\n");
+		}
+		file << "}\n";
+	}
+	if (iComponents & kGridVertexColours)
+	{
+		file << "MeshVertexColors {\n";
+		file << iNumVertices << ";\n";
+		for (TUInt32 iVertex = 0; iVertex < iNumVertices; ++iVertex)
+		{
+			file << iVertex << ";" << static_cast<TFloat32>(iVertex % iGridSize) / iGridSize << ";"
+			     << static_cast<TFloat32>(iVertex / iGridSize) / iGridSize << ";1.000000;1.000000;;"
+			     << (iVertex + 1 < iNumVertices ? ",\n" : ";\n");
+		}
+		file << "}\n";
+	}
+
+	// Material of each face, then the materials themselves
+	file << "MeshMaterialList {\n";
+	file << iNumMaterials << ";\n" << iNumSquares * 2 << ";\n";
+	for (TUInt32 iFace = 0; iFace < iNumSquares * 2; ++iFace)
+	{
+		file << (iFace / 2) % iNumMaterials << (iFace + 1 < iNumSquares * 2 ? ",\n" : ";\n");
+	}
+	for (TUInt32 iMaterial = 0; iMaterial < iNumMaterials; ++iMaterial)
+	{
+		TFloat32 fShade = static_cast<TFloat32>(iMaterial + 1) / iNumMaterials;
+		file << "Material {\n";
+		file << fShade << ";" << 1.0f - fShade << ";1.000000;1.000000;;\n";
+		file << "0.000000;\n0.000000;0.000000;0.000000;;\n0.000000;0.000000;0.000000;;\n";
+		file << "}\n";
+	}
+	file << "}\n";
+	file << "}\n";
+	return file.str();
+}
+
+
+// Save text to a file, replacing any existing file
+bool SaveTextFile
+(
+	const string& sFileName,
+	const string& sText
+)
+{
+	FILE* pFile = fopen( sFileName.c_str(), "wb" );
+	if (!pFile)
+	{
+		return false;
+	}
+	bool bWritten = fwrite( sText.c_str(), 1, sText.size(), pFile ) == sText.size();
+	return (fclose( pFile ) == 0) && bWritten;
+}
+
+
+} // namespace gen
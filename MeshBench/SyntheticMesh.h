@@ -0,0 +1,55 @@
+/**************************************************************************************************
+	Module:       SyntheticMesh.h
+	Date created: 18/10/26
+
+	Synthetic X-files built in memory, for checks and benchmarks that need meshes of an exact
+	size or shape rather than the scene's models
+
+	Change history:
+		V1.0    Created 18/10/26
+**************************************************************************************************/
+
+#ifndef GEN_SYNTHETIC_MESH_H_INCLUDED
+#define GEN_SYNTHETIC_MESH_H_INCLUDED
+
+#include <string>
+using namespace std;
+
+#include "GenDefines.h"
+
+namespace gen
+{
+
+// Optional vertex components of a synthetic grid, combined with |
+enum EGridComponents
+{
+	kGridNormals       = 1,
+	kGridTextureCoords = 2,
+	kGridVertexColours = 4,
+	kGridAllComponents = 7,
+};
+
+// Build a text X-file of a flat square grid of iGridSize x iGridSize vertices in the XZ plane,
+// one unit apart, with two faces per grid square. Each grid square uses the next of iNumMaterials
+// materials in turn (each a different colour), so the faces of every material are spread over
+// the whole grid. The vertices have positions and the given components (EGridComponents):
+// upward normals, texture coordinates one repeat per square and colours that vary over the grid.
+// Every vertex is distinct, so none are welded. Returns the file contents
+string MakeGridXFile
+(
+	const TUInt32 iGridSize,
+	const TUInt32 iNumMaterials = 1,
+	const TUInt32 iComponents = 0
+);
+
+// Save text to a file, replacing any existing file. Returns false on failure
+bool SaveTextFile
+(
+	const string& sFileName,
+	const string& sText
+);
+
+
+} // namespace gen
+
+#endif // GEN_SYNTHETIC_MESH_H_INCLUDED
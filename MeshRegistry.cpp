@@ -0,0 +1,514 @@
+//--------------------------------------------------------------------------------------
+//	MeshRegistry.cpp
+//
+//	The mesh registry shares geometry (vertex/index buffers and vertex layouts) between
+//	all models that load the same file, so each file is only imported and uploaded once
+//--------------------------------------------------------------------------------------
+
+#include <stdio.h>
+
+#include "Defines.h"      // General definitions shared by all source files
+#include "MeshRegistry.h" // Declaration of this class
+
+#include "CCookedMesh.h"  // Cache of pre-processed meshes, avoids re-importing unchanged files
+#include "CImportStats.h" // Timings and counts for each stage of loading a mesh
+#include "MeshMerge.h"    // Merging the vertices of several sub-meshes into one list
+
+
+// DirectX formats of the vertex elements described by the import code, in the order of gen::EVertexElementFormat
+static const DXGI_FORMAT VertexEltFormats[] =
+{
+	DXGI_FORMAT_R32G32_FLOAT, DXGI_FORMAT_R32G32B32_FLOAT, DXGI_FORMAT_R32G32B32A32_FLOAT, DXGI_FORMAT_R16G16_FLOAT,
+	DXGI_FORMAT_R16G16B16A16_FLOAT, DXGI_FORMAT_R16G16_SNORM, DXGI_FORMAT_R16G16B16A16_SNORM, DXGI_FORMAT_R8G8B8A8_UNORM,
+	DXGI_FORMAT_R8G8B8A8_UINT,
+};
+
+
+///////////////////////////////
+// Mesh geometry
+
+// Constructor - geometry is empty until loaded
+CMeshGeometry::CMeshGeometry()
+{
+	VertexBuffer = NULL;
+	NumVertices = 0;
+	NumVertexElts = 0;
+	VertexSize = 0;
+	PositionBuffer = NULL;
+	memset( &PositionElt, 0, sizeof(PositionElt) );
+	PositionSize = 0;
+	PositionScale = D3DXVECTOR3( 1.0f, 1.0f, 1.0f );
+	PositionBias = D3DXVECTOR3( 0.0f, 0.0f, 0.0f );
+	IndexBuffer = NULL;
+	NumIndices = 0;
+	IndexFormat = DXGI_FORMAT_R16_UINT;
+	SilhouetteBuffer = NULL;
+	SilhouetteBufferSize = 0;
+	gen::MeshBoundsFromBox( gen::CVector3::kZero, gen::CVector3::kZero, &Bounds );
+	Tangents = false;
+	VertexFormat = gen::kVertexFormatFloat;
+	m_RefCount = 0;
+}
+
+// Destructor - release buffers and all vertex layouts
+CMeshGeometry::~CMeshGeometry()
+{
+	for (unsigned int i = 0; i < m_VertexLayouts.size(); ++i)
+	{
+		SAFE_RELEASE( m_VertexLayouts[i] );
+	}
+	SAFE_RELEASE( SilhouetteBuffer );
+	SAFE_RELEASE( IndexBuffer );
+	SAFE_RELEASE( PositionBuffer );
+	SAFE_RELEASE( VertexBuffer );
+}
+
+
+// Create vertex/index buffers and the vertex element list from a loaded mesh, with vertices encoded in the given format. The vertices and
+// faces of all the sub-meshes are merged into the two buffers, with a range of the index buffer for each sub-mesh so models can bind
+// the buffers once and draw each range. Returns true on success
+bool CMeshGeometry::Create( const gen::CCookedMesh& mesh, const gen::SVertexFormat& vertexFormat )
+{
+	// Find a vertex layout that holds the components of every sub-mesh (sub-meshes missing a component are given a default for it), and
+	// the total number of vertices. The faces use 32-bit indices if any sub-mesh does - indices are relative to the start of each
+	// sub-mesh's vertices, so 16-bit indices are enough unless a single sub-mesh has too many vertices
+	unsigned int numSubMeshes = mesh.GetNumSubMeshes();
+	gen::SSubMesh merged;
+	gen::ClearMergedLayout( &merged );
+	for (unsigned int sub = 0; sub < numSubMeshes; ++sub)
+	{
+		const gen::SSubMesh& subMesh = mesh.GetSubMesh( sub );
+		gen::AddToMergedLayout( subMesh, &merged );
+		if (subMesh.indexSize == sizeof(gen::TUInt32))
+		{
+			merged.indexSize = sizeof(gen::TUInt32);
+		}
+	}
+
+
+	// Copy the vertices of each sub-mesh into a single list. Each sub-mesh's vertices are in the space of its node in the file's hierarchy,
+	// so they are transformed into the space of the root, where the parts of the model fit together. Sub-meshes already in root space
+	// are copied exactly, and skinned sub-meshes are left alone as their vertices are placed by their bones. The faces for ray queries,
+	// silhouettes and the clusters for culling are transformed the same way
+	vector<gen::TUInt8> mergedVertices( merged.numVertices * merged.vertexSize );
+	Ranges.resize( numSubMeshes );
+	RangeBVHs.resize( numSubMeshes );
+	RangeSilhouettes.resize( numSubMeshes );
+	unsigned int baseVertex = 0;
+	for (unsigned int sub = 0; sub < numSubMeshes; ++sub)
+	{
+		const gen::SSubMesh& subMesh = mesh.GetSubMesh( sub );
+		gen::CMatrix4x4 rootMatrix = gen::GetNodeRootMatrix( &mesh.GetNode( 0 ), subMesh.node );
+		bool transform = !subMesh.hasSkinningData && !rootMatrix.IsIdentity();
+		gen::CopyMergedVertices( subMesh, merged, transform ? &rootMatrix : NULL, &mergedVertices[baseVertex * merged.vertexSize] );
+		Ranges[sub].BaseVertex = baseVertex;
+		RangeBVHs[sub].Init( subMesh, mesh.GetBVHNodes( sub ), mesh.GetNumBVHNodes( sub ), mesh.GetBVHLeafFaces( sub ),
+		                     transform ? &rootMatrix : NULL );
+		if (!subMesh.hasSkinningData)
+		{
+			RangeSilhouettes[sub].Init( subMesh, mesh.GetEdges( sub ), mesh.GetNumEdges( sub ), transform ? &rootMatrix : NULL );
+			SilhouetteBufferSize += RangeSilhouettes[sub].GetNumEdges() * 2;
+		}
+		Ranges[sub].FirstCluster = static_cast<unsigned int>(Clusters.size());
+		Ranges[sub].NumClusters = subMesh.hasSkinningData ? 0 : mesh.GetNumClusters( sub );
+		for (unsigned int cluster = 0; cluster < Ranges[sub].NumClusters; ++cluster)
+		{
+			Clusters.push_back( mesh.GetClusters( sub )[cluster] );
+			if (transform)
+			{
+				gen::TransformMeshCluster( &Clusters.back(), rootMatrix );
+			}
+		}
+		baseVertex += subMesh.numVertices;
+	}
+	merged.vertices = mergedVertices.data();
+
+
+	// Copy the faces of each sub-mesh into a single index list, one range after another. The faces of the simplified levels of detail follow
+	// the full mesh in each sub-mesh's face data, so each range holds all its levels. Indices are widened if the list uses 32-bit indices
+	// and the sub-mesh doesn't
+	vector<gen::TUInt8> indices;
+	for (unsigned int sub = 0; sub < numSubMeshes; ++sub)
+	{
+		const gen::SSubMesh& subMesh = mesh.GetSubMesh( sub );
+		SMeshDrawRange& range = Ranges[sub];
+		range.NumLODs = mesh.GetNumLODs( sub );
+		for (unsigned int lod = 0; lod < range.NumLODs; ++lod)
+		{
+			range.LODs[lod] = mesh.GetLOD( sub, lod );
+		}
+		range.Material = subMesh.material;
+		range.MaterialId = subMesh.material < mesh.GetNumMaterials() ? mesh.GetMaterialId( subMesh.material ) : 0;
+		range.NumIndices = static_cast<unsigned int>(subMesh.numFaces) * 3;
+		range.FirstIndex = static_cast<unsigned int>(indices.size()) / merged.indexSize;
+
+		unsigned int rangeIndices = (range.LODs[range.NumLODs - 1].iFirstFace + range.LODs[range.NumLODs - 1].iNumFaces) * 3;
+		indices.resize( indices.size() + rangeIndices * merged.indexSize );
+		gen::TUInt8* rangeData = &indices[range.FirstIndex * merged.indexSize];
+		if (subMesh.indexSize == merged.indexSize)
+		{
+			memcpy( rangeData, subMesh.faces, rangeIndices * merged.indexSize );
+		}
+		else
+		{
+			const gen::TUInt16* index16 = reinterpret_cast<const gen::TUInt16*>(subMesh.faces);
+			gen::TUInt32* index32 = reinterpret_cast<gen::TUInt32*>(rangeData);
+			for (unsigned int index = 0; index < rangeIndices; ++index)
+			{
+				index32[index] = index16[index];
+			}
+		}
+	}
+
+	if (!CreateBuffers( merged, indices, vertexFormat ))
+	{
+		return false;
+	}
+
+	// Create the silhouette index buffer, written by the CPU whenever a model draws its silhouette. It must hold the worst case of every
+	// edge on the silhouette, but a typical silhouette uses a small fraction of it
+	if (SilhouetteBufferSize > 0)
+	{
+		D3D10_BUFFER_DESC bufferDesc;
+		bufferDesc.BindFlags = D3D10_BIND_INDEX_BUFFER;
+		bufferDesc.Usage = D3D10_USAGE_DYNAMIC;
+		bufferDesc.ByteWidth = SilhouetteBufferSize * sizeof(gen::TUInt32);
+		bufferDesc.CPUAccessFlags = D3D10_CPU_ACCESS_WRITE;
+		bufferDesc.MiscFlags = 0;
+		if (FAILED( g_pd3dDevice->CreateBuffer( &bufferDesc, NULL, &SilhouetteBuffer )))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+// Create the vertex element list and vertex/index buffers from merged vertices (full floats) and the indices of all the draw ranges, which
+// must already be set up. The vertices are encoded in the given format. Returns true on success
+bool CMeshGeometry::CreateBuffers( const gen::SSubMesh& merged, const vector<gen::TUInt8>& indices, const gen::SVertexFormat& vertexFormat )
+{
+	// Create vertex element list. We need a vertex layout to say what data we have per vertex in this model (e.g. position, normal, uv, etc.)
+	// In previous projects the element list was a manually typed in array as we knew what data we would provide. However, as we can load models with
+	// different vertex data this time we need flexible code. The import code describes each element the mesh has in the chosen vertex format
+	// (which components are present and how each is encoded), and each is converted to a line of the array here
+	gen::SVertexElement elements[gen::kiMaxVertexElements];
+	gen::TUInt32 vertexSize;
+	NumVertexElts = gen::GetVertexElements( merged, vertexFormat, elements, &vertexSize );
+	VertexSize = vertexSize;
+	for (unsigned int elt = 0; elt < NumVertexElts; ++elt)
+	{
+		VertexElts[elt].SemanticName = elements[elt].sSemantic;      // Semantic in HLSL (what is this data for)
+		VertexElts[elt].SemanticIndex = 0;                            // Index to add to semantic (a count for this kind of data, when using multiple of the same type, e.g. TEXCOORD0, TEXCOORD1)
+		VertexElts[elt].Format = VertexEltFormats[elements[elt].eFormat]; // Type of data - e.g. R32G32B32_FLOAT will be a float3 in the shader. Most data communicated as though it were colours
+		VertexElts[elt].AlignedByteOffset = elements[elt].iOffset;    // Offset of element from start of vertex data (e.g. if we have position (float3), uv (float2) then normal, the normal's offset is 5 floats = 5*4 = 20)
+		VertexElts[elt].InputSlot = 0;                                // For when using multiple vertex buffers (e.g. instancing - an advanced topic)
+		VertexElts[elt].InputSlotClass = D3D10_INPUT_PER_VERTEX_DATA; // Use this value for most cases (only changed for instancing)
+		VertexElts[elt].InstanceDataStepRate = 0;                     // --"--
+	}
+
+
+	// The bounds of the sub-meshes were found by the import, but in the space of their nodes. Find the bounds of the merged vertices
+	gen::CalculateMeshBounds( merged.vertices, merged.vertexSize, merged.numVertices, &Bounds );
+
+
+	// Encode the merged vertex data in the vertex format. Compact formats store positions relative to the mesh bounds, keep the scale and bias that
+	// the vertex shader needs to decode them
+	NumVertices = merged.numVertices;
+	vector<gen::TUInt8> vertices( NumVertices * VertexSize );
+	gen::SVertexDecode decode;
+	gen::EncodeVertices( merged, vertexFormat, vertices.data(), &decode );
+	PositionScale = D3DXVECTOR3( decode.positionScale.x, decode.positionScale.y, decode.positionScale.z );
+	PositionBias = D3DXVECTOR3( decode.positionBias.x, decode.positionBias.y, decode.positionBias.z );
+
+	// Create the vertex buffer and fill it with the encoded vertex data
+	D3D10_BUFFER_DESC bufferDesc;
+	bufferDesc.BindFlags = D3D10_BIND_VERTEX_BUFFER;
+	bufferDesc.Usage = D3D10_USAGE_DEFAULT; // Not a dynamic buffer
+	bufferDesc.ByteWidth = NumVertices * VertexSize; // Buffer size
+	bufferDesc.CPUAccessFlags = 0;   // Indicates that CPU won't access this buffer at all after creation
+	bufferDesc.MiscFlags = 0;
+	D3D10_SUBRESOURCE_DATA initData; // Initial data
+	initData.pSysMem = vertices.data();
+	if (FAILED( g_pd3dDevice->CreateBuffer( &bufferDesc, &initData, &VertexBuffer )))
+	{
+		return false;
+	}
+
+
+	// Create the position buffer, the positions alone for techniques that need nothing else. Encoding the merged vertices as if they had
+	// no other components gives just the position element, with the same scale and bias as the main buffer (it depends only on the positions).
+	// Skinned vertices can't be placed without their bone weights, so they have no position buffer
+	if (!merged.hasSkinningData)
+	{
+		gen::SSubMesh positions = merged; // Same vertices at the same stride, the other components are skipped
+		positions.hasNormals = false;
+		positions.hasTangents = false;
+		positions.hasTextureCoords = false;
+		positions.hasVertexColours = false;
+		gen::SVertexElement positionElements[gen::kiMaxVertexElements];
+		gen::TUInt32 positionSize;
+		gen::GetVertexElements( positions, vertexFormat, positionElements, &positionSize );
+		PositionSize = positionSize;
+		PositionElt.SemanticName = positionElements[0].sSemantic;
+		PositionElt.SemanticIndex = 0;
+		PositionElt.Format = VertexEltFormats[positionElements[0].eFormat];
+		PositionElt.AlignedByteOffset = 0;
+		PositionElt.InputSlot = 0;
+		PositionElt.InputSlotClass = D3D10_INPUT_PER_VERTEX_DATA;
+		PositionElt.InstanceDataStepRate = 0;
+
+		vector<gen::TUInt8> positionData( NumVertices * PositionSize );
+		gen::SVertexDecode positionDecode;
+		gen::EncodeVertices( positions, vertexFormat, positionData.data(), &positionDecode );
+		bufferDesc.ByteWidth = NumVertices * PositionSize;
+		initData.pSysMem = positionData.data();
+		if (FAILED( g_pd3dDevice->CreateBuffer( &bufferDesc, &initData, &PositionBuffer )))
+		{
+			return false;
+		}
+	}
+
+
+	// Create the index buffer - the importer uses 2-byte (WORD) index data unless there are more vertices than that can index
+	NumIndices = 0;
+	for (unsigned int range = 0; range < Ranges.size(); ++range)
+	{
+		NumIndices += Ranges[range].NumIndices;
+	}
+	IndexFormat = (merged.indexSize == sizeof(gen::TUInt32)) ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT;
+	bufferDesc.BindFlags = D3D10_BIND_INDEX_BUFFER;
+	bufferDesc.Usage = D3D10_USAGE_DEFAULT;
+	bufferDesc.ByteWidth = static_cast<unsigned int>(indices.size());
+	bufferDesc.CPUAccessFlags = 0;
+	bufferDesc.MiscFlags = 0;
+	initData.pSysMem = indices.data();
+	if (FAILED( g_pd3dDevice->CreateBuffer( &bufferDesc, &initData, &IndexBuffer )))
+	{
+		return false;
+	}
+
+	return true;
+}
+
+
+// Number of buffers the geometry has created - vertex and index buffers, and the position and silhouette buffers if it has them
+unsigned int CMeshGeometry::GetNumBuffers() const
+{
+	return (VertexBuffer ? 1 : 0) + (IndexBuffer ? 1 : 0) + (PositionBuffer ? 1 : 0) + (SilhouetteBuffer ? 1 : 0);
+}
+
+
+// Find or create a vertex layout matching the vertex input of the given technique, for the main vertex buffer or the position buffer
+ID3D10InputLayout* CMeshGeometry::GetVertexLayout( ID3D10EffectTechnique* exampleTechnique, bool positionOnly /*= false*/ )
+{
+	// Get the input signature of the technique's first pass - that is what the layout is validated against
+	D3D10_PASS_DESC PassDesc;
+	exampleTechnique->GetPassByIndex( 0 )->GetDesc( &PassDesc );
+	const BYTE* signature = PassDesc.pIAInputSignature;
+	SIZE_T signatureSize = PassDesc.IAInputSignatureSize;
+
+	// Reuse an existing layout if one was created for an identical signature and the same buffer
+	for (unsigned int i = 0; i < m_VertexLayouts.size(); ++i)
+	{
+		if (m_LayoutPositionOnly[i] == positionOnly && m_LayoutSignatures[i].size() == signatureSize &&
+		    memcmp( &m_LayoutSignatures[i][0], signature, signatureSize ) == 0)
+		{
+			++CMeshRegistry::m_Stats.LayoutCreationsAvoided;
+			return m_VertexLayouts[i];
+		}
+	}
+
+	// Given the vertex element list, pass it to DirectX to create a vertex layout. We also need to pass an example of a technique that will
+	// render this model. We will only be able to render this model with techniques that have the same vertex input as the example we use here
+	// The position buffer has a single element, so its layout only validates against techniques that read nothing but the position
+	ID3D10InputLayout* vertexLayout = NULL;
+	const D3D10_INPUT_ELEMENT_DESC* elts = positionOnly ? &PositionElt : VertexElts;
+	unsigned int numElts = positionOnly ? 1 : NumVertexElts;
+	if (FAILED( g_pd3dDevice->CreateInputLayout( elts, numElts, signature, signatureSize, &vertexLayout ) ))
+	{
+		return NULL;
+	}
+	++CMeshRegistry::m_Stats.LayoutCreations;
+	m_LayoutSignatures.push_back( vector<BYTE>( signature, signature + signatureSize ) );
+	m_LayoutPositionOnly.push_back( positionOnly );
+	m_VertexLayouts.push_back( vertexLayout );
+	return vertexLayout;
+}
+
+
+///////////////////////////////
+// Mesh registry
+
+CMeshRegistry::TGeometryMap CMeshRegistry::m_Geometry;
+SMeshRegistryStats          CMeshRegistry::m_Stats = { 0, 0, 0, 0, 0, 0 };
+gen::CImportStats           CMeshRegistry::m_ImportStats;
+
+
+// Get geometry for the given file, loading it if it is not already in use (or using the given mesh if it was loaded elsewhere). Also returns a vertex layout matching the given example technique
+CMeshGeometry* CMeshRegistry::Acquire( const string& fileName, ID3D10EffectTechnique* exampleTechnique, bool tangents,
+                                       const gen::SVertexFormat* vertexFormat, ID3D10InputLayout** vertexLayout,
+                                       const gen::CCookedMesh* preloadedMesh /*= NULL*/ )
+{
+	string key = MakeKey( fileName, tangents, vertexFormat );
+
+	// Load the geometry if this is the first use
+	CMeshGeometry* geometry;
+	TGeometryMap::iterator found = m_Geometry.find( key );
+	if (found != m_Geometry.end())
+	{
+		geometry = found->second;
+		++m_Stats.ImportsAvoided;
+		m_Stats.BufferCreationsAvoided += geometry->GetNumBuffers();
+	}
+	else
+	{
+		geometry = new CMeshGeometry;
+		geometry->m_Key = key;
+		geometry->FileName = fileName;
+		geometry->Tangents = tangents;
+		geometry->VertexFormat = vertexFormat ? *vertexFormat : gen::kVertexFormatFloat;
+		gen::CCookedMesh loadedMesh;
+		if (!preloadedMesh)
+		{
+			if (!LoadMesh( fileName, tangents, &loadedMesh ))
+			{
+				delete geometry;
+				return NULL;
+			}
+			preloadedMesh = &loadedMesh;
+		}
+		++m_Stats.Imports;
+		m_ImportStats.Add( preloadedMesh->GetImportStats() );
+
+		gen::CImportStageTimer bufferTimer( &m_ImportStats, gen::kStageBuffers );
+		if (!geometry->Create( *preloadedMesh, vertexFormat ? *vertexFormat : gen::kVertexFormatFloat ))
+		{
+			delete geometry;
+			return NULL;
+		}
+		m_Stats.BufferCreations += geometry->GetNumBuffers();
+		m_ImportStats.AddCounts( gen::kStageBuffers, 0, geometry->NumVertices, 0, geometry->NumIndices / 3 );
+		m_Geometry[key] = geometry;
+	}
+
+	// Get a layout for the requested technique
+	*vertexLayout = geometry->GetVertexLayout( exampleTechnique );
+	if (!*vertexLayout)
+	{
+		if (geometry->m_RefCount == 0)
+		{
+			m_Geometry.erase( key );
+			delete geometry;
+		}
+		return NULL;
+	}
+
+	++geometry->m_RefCount;
+	return geometry;
+}
+
+
+// Create geometry from vertices and indices merged elsewhere. The geometry is not shared so it is not added to the registry, but is released
+// in the same way as shared geometry. Also returns a vertex layout matching the given example technique
+CMeshGeometry* CMeshRegistry::CreateUnshared( const gen::SSubMesh& merged, const vector<gen::TUInt8>& indices, const vector<SMeshDrawRange>& ranges,
+                                              ID3D10EffectTechnique* exampleTechnique, const gen::SVertexFormat* vertexFormat,
+                                              ID3D10InputLayout** vertexLayout )
+{
+	CMeshGeometry* geometry = new CMeshGeometry;
+	geometry->VertexFormat = vertexFormat ? *vertexFormat : gen::kVertexFormatFloat;
+	geometry->Ranges = ranges;
+	if (!geometry->CreateBuffers( merged, indices, geometry->VertexFormat ))
+	{
+		delete geometry;
+		return NULL;
+	}
+	m_Stats.BufferCreations += geometry->GetNumBuffers();
+
+	*vertexLayout = geometry->GetVertexLayout( exampleTechnique );
+	if (!*vertexLayout)
+	{
+		delete geometry;
+		return NULL;
+	}
+
+	geometry->m_RefCount = 1;
+	return geometry;
+}
+
+
+// Load the file for the given geometry without creating any buffers - the CPU side of Acquire
+bool CMeshRegistry::LoadMesh( const string& fileName, bool tangents, gen::CCookedMesh* mesh )
+{
+	// Use CCookedMesh class (from another application) to load the given file. It only imports the file with the CImportXFile class if the file has
+	// changed since it was last loaded, otherwise it uses a pre-processed (cooked) copy saved next to the file. The import code is wrapped in the namespace 'gen'
+	return mesh->Load( fileName, tangents ) == gen::kSuccess && mesh->GetNumSubMeshes() > 0;
+}
+
+
+// Key of the geometry for the given file and options - the file name followed by the options, with a digit for the encoding of each vertex
+// component. No vertex format is the same as full floats
+string CMeshRegistry::MakeKey( const string& fileName, bool tangents, const gen::SVertexFormat* vertexFormat )
+{
+	const gen::SVertexFormat& format = vertexFormat ? *vertexFormat : gen::kVertexFormatFloat;
+	char encoding[16];
+	sprintf_s( encoding, "|%d%d%d%d", format.position, format.directions, format.texCoords, format.colours );
+	return fileName + (tangents ? "|tangents" : "|") + encoding;
+}
+
+
+// Get a vertex layout for the position buffer of the given geometry matching the given position only technique. NULL if there is no position buffer
+ID3D10InputLayout* CMeshRegistry::GetPositionLayout( CMeshGeometry* geometry, ID3D10EffectTechnique* positionTechnique )
+{
+	if (!geometry || !geometry->PositionBuffer)
+	{
+		return NULL;
+	}
+	return geometry->GetVertexLayout( positionTechnique, true );
+}
+
+
+// Stop using the given geometry, it is destroyed when no models use it
+void CMeshRegistry::Release( CMeshGeometry* geometry )
+{
+	if (!geometry)
+	{
+		return;
+	}
+
+	if (--geometry->m_RefCount == 0)
+	{
+		// Unshared geometry has no key and is not in the registry
+		if (!geometry->m_Key.empty())
+		{
+			m_Geometry.erase( geometry->m_Key );
+		}
+		delete geometry;
+	}
+}
+
+
+// Write the registry counters to the debugger output
+void CMeshRegistry::OutputStats()
+{
+	char text[256];
+	sprintf_s( text, "Mesh registry: %u imports (%u avoided), %u buffers created (%u avoided), %u layouts created (%u avoided)\n",
+	           m_Stats.Imports, m_Stats.ImportsAvoided, m_Stats.BufferCreations, m_Stats.BufferCreationsAvoided,
+	           m_Stats.LayoutCreations, m_Stats.LayoutCreationsAvoided );
+	OutputDebugStringA( text );
+
+	// Time of each import stage, stages that weren't used are left out
+	string stages;
+	for (int stage = 0; stage < gen::kNumImportStages; ++stage)
+	{
+		const gen::SImportStageStats& stageStats = m_ImportStats.GetStage( static_cast<gen::EImportStage>(stage) );
+		if (stageStats.iCalls > 0)
+		{
+			sprintf_s( text, " %s %.2fms", gen::CImportStats::GetStageName( static_cast<gen::EImportStage>(stage) ), stageStats.fTime * 1000.0 );
+			stages += text;
+		}
+	}
+	sprintf_s( text, "Mesh imports: %u files, %.2fms total, peak mesh data %uKB -", m_ImportStats.GetNumFiles(),
+	           m_ImportStats.GetTotalTime() * 1000.0, static_cast<unsigned int>(m_ImportStats.GetPeakBytes() / 1024) );
+	OutputDebugStringA( (text + stages + "\n").c_str() );
+}
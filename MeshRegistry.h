@@ -0,0 +1,247 @@
+//--------------------------------------------------------------------------------------
+//	MeshRegistry.h
+//
+//	The mesh registry shares geometry (vertex/index buffers and vertex layouts) between
+//	all models that load the same file, so each file is only imported and uploaded once
+//--------------------------------------------------------------------------------------
+
+#ifndef MESH_REGISTRY_H_INCLUDED // Header guard - prevents file being included more than once (would cause errors)
+#define MESH_REGISTRY_H_INCLUDED
+
+#include <string>
+#include <vector>
+#include <map>
+using namespace std;
+
+#include <d3d10.h>
+#include <d3dx10.h>
+
+#include "MeshSimplify.h" // Levels of detail (from the import code)
+#include "MeshBounds.h"   // Bounding volumes (from the import code)
+#include "MeshBVH.h"      // Bounding volume hierarchies for ray queries (from the import code)
+#include "MeshEdges.h"    // Edge adjacency and silhouettes (from the import code)
+#include "MeshClusters.h" // Clusters of faces for culling (from the import code)
+#include "VertexFormat.h" // Compact encodings of vertex data (from the import code)
+
+namespace gen { class CCookedMesh; class CImportStats; }
+
+
+// A range of a geometry's index buffer drawn with one call - the faces of one sub-mesh of the file. All ranges share the geometry's
+// vertex and index buffers, so a model binds the buffers once and draws each range in turn
+struct SMeshDrawRange
+{
+	unsigned int  FirstIndex; // Start of the range in the index buffer
+	unsigned int  NumIndices; // Indices in the full detail faces of the range
+	unsigned int  BaseVertex; // First vertex of the range in the vertex buffer, added to each of its indices
+	unsigned int  Material;   // Material of the sub-mesh in the file
+	unsigned int  MaterialId; // Id of the material in the shared material table (see CMaterialTable.h), the same for identical materials in any file
+
+	// Levels of detail, each a range of faces counted from the start of this range. Level 0 is the full detail faces, the simplified
+	// levels follow them. Each level records how far it is from the full mesh (see MeshSimplify.h)
+	gen::SMeshLOD LODs[gen::kiMaxLODs];
+	unsigned int  NumLODs;
+
+	// Clusters of the full detail faces of the range in the geometry's cluster list (see CMeshGeometry::Clusters). The faces of each cluster
+	// are counted from the start of this range. No clusters for skinned ranges, small ranges (see gen::kiMinClusteredFaces) or geometry
+	// not loaded from a file, they are drawn whole
+	unsigned int  FirstCluster;
+	unsigned int  NumClusters;
+};
+
+
+// Geometry loaded from a single file, shared by any number of models. Created and destroyed only by the registry below, models
+// just hold a pointer to it
+class CMeshGeometry
+{
+	friend class CMeshRegistry;
+
+/////////////////////////////
+// Public member variables - read only for models
+public:
+	// Vertex data stored in a vertex buffer and the number of the vertices in the buffer
+	ID3D10Buffer*            VertexBuffer;
+	unsigned int             NumVertices;
+
+	// Description of the elements in a single vertex (position, normal, UVs etc.)
+	static const int         MAX_VERTEX_ELTS = 64;
+	D3D10_INPUT_ELEMENT_DESC VertexElts[MAX_VERTEX_ELTS];
+	unsigned int             NumVertexElts;
+	unsigned int             VertexSize; // Size of vertex calculated from contained elements
+
+	// Positions alone in a second vertex buffer, for techniques that only read the position (e.g. plain colour or depth passes, see
+	// CModel::AddPositionOnlyTechniques). Encoded as the positions in the main buffer and decoded with the same scale and bias, but without
+	// the tangent handedness, so at most 12 bytes a vertex. NULL for skinned geometry, whose positions are placed by the bone weights
+	ID3D10Buffer*            PositionBuffer;
+	D3D10_INPUT_ELEMENT_DESC PositionElt;
+	unsigned int             PositionSize;
+
+	// Scale and bias to decode vertex positions into model space (position * scale + bias). Identity unless the geometry was loaded with
+	// a compact vertex format, which stores positions relative to the mesh bounds (see VertexFormat.h)
+	D3DXVECTOR3              PositionScale;
+	D3DXVECTOR3              PositionBias;
+
+	// Index data stored in a index buffer, the number of indices in the full detail mesh and their format (16-bit unless a sub-mesh
+	// has too many vertices, then 32-bit)
+	ID3D10Buffer*            IndexBuffer;
+	unsigned int             NumIndices;
+	DXGI_FORMAT              IndexFormat;
+
+	// Ranges of the index buffer drawn separately, one for each sub-mesh in the file. The vertices of all sub-meshes are in the one
+	// vertex buffer, and the indices of each range are relative to its base vertex
+	vector<SMeshDrawRange>   Ranges;
+
+	// Bounding box and sphere of the vertices in model space, calculated when the file was imported (see MeshBounds.h). Models transform
+	// them into world space for culling, level of detail selection and picking
+	gen::SMeshBounds         Bounds;
+
+	// Faces of each draw range prepared for ray queries such as picking and line of sight, in model space like the vertices (see MeshBVH.h).
+	// Built from the hierarchy cooked with the file, only the full detail faces are included. Skinned ranges are in their bind pose. Empty
+	// for geometry not loaded from a file
+	vector<gen::CMeshBVH>    RangeBVHs;
+
+	// Edges of each draw range prepared for silhouette extraction, in model space like the vertices (see MeshEdges.h). Built from the edge
+	// adjacency cooked with the file, only the full detail faces are included. Skinned ranges have no edges, their silhouette depends on the
+	// bones. Empty for geometry not loaded from a file
+	vector<gen::CMeshSilhouette> RangeSilhouettes;
+
+	// Clusters of the full detail faces of all the draw ranges, with the bounding sphere and normal cone of each in model space (see
+	// MeshClusters.h). Built when the file was cooked, each range has a run of them. Models cull them against the camera each frame and draw
+	// only the faces of the clusters left (see CModel::CullClusters)
+	vector<gen::SMeshCluster> Clusters;
+
+	// Dynamic index buffer (32-bit) for the silhouette edges of the geometry as a line list, rewritten each time a model draws its silhouette
+	// (see CModel::RenderSilhouette). Large enough for every edge of every range, NULL if there are no edges
+	ID3D10Buffer*            SilhouetteBuffer;
+	unsigned int             SilhouetteBufferSize; // In indices
+
+	// File the geometry was loaded from and the options it was loaded with, so the file can be loaded again to process the vertices on
+	// the CPU (e.g. for a static batch). The file name is empty for geometry not loaded from a file
+	string                   FileName;
+	bool                     Tangents;
+	gen::SVertexFormat       VertexFormat;
+
+
+/////////////////////////////
+// Private member functions / variables
+private:
+	CMeshGeometry();
+	~CMeshGeometry();
+
+	// Disallow copying, geometry is always shared through pointers (private and not defined)
+	CMeshGeometry( const CMeshGeometry& );
+	CMeshGeometry& operator=( const CMeshGeometry& );
+
+	// Create vertex/index buffers and the vertex element list from a loaded mesh, with vertices encoded in the given format. The vertices
+	// and faces of all the sub-meshes are merged into the buffers, with a draw range for each sub-mesh. Returns true on success
+	bool Create( const gen::CCookedMesh& mesh, const gen::SVertexFormat& vertexFormat );
+
+	// Create the vertex element list and vertex/index buffers from merged vertices (full floats, see MeshMerge.h) and the indices of all
+	// the draw ranges, which must already be set up. The vertices are encoded in the given format. Returns true on success
+	bool CreateBuffers( const gen::SSubMesh& merged, const vector<gen::TUInt8>& indices, const gen::SVertexFormat& vertexFormat );
+
+	// Find or create a vertex layout matching the vertex input of the given technique, for the main vertex buffer or the position buffer.
+	// A layout depends on both the vertex elements and the shader's input signature, so one is kept for each different signature and
+	// buffer that uses this geometry
+	ID3D10InputLayout* GetVertexLayout( ID3D10EffectTechnique* exampleTechnique, bool positionOnly = false );
+
+	// Number of buffers the geometry has created - vertex and index buffers, and the position and silhouette buffers if it has them
+	unsigned int GetNumBuffers() const;
+
+	// Key of this geometry in the registry and number of models using it
+	string                      m_Key;
+	int                         m_RefCount;
+
+	// Vertex layouts created for this geometry, the shader input signatures they were created for and whether each is for the position buffer
+	vector<vector<BYTE> >       m_LayoutSignatures;
+	vector<bool>                m_LayoutPositionOnly;
+	vector<ID3D10InputLayout*>  m_VertexLayouts;
+};
+
+
+// Counters showing how much work the registry has saved
+struct SMeshRegistryStats
+{
+	unsigned int Imports;                // Files imported
+	unsigned int ImportsAvoided;         // Loads that used already imported geometry
+	unsigned int BufferCreations;        // Vertex, position, index and silhouette buffers created
+	unsigned int BufferCreationsAvoided; // Vertex, position, index and silhouette buffers shared instead of being created
+	unsigned int LayoutCreations;        // Vertex layouts created
+	unsigned int LayoutCreationsAvoided; // Vertex layouts shared instead of being created
+};
+
+
+// Reference counted registry of mesh geometry. Geometry is keyed by file name, tangent option and vertex format (which together fix
+// the vertex data), so every model loading the same file with the same options uses a single copy
+class CMeshRegistry
+{
+	friend class CMeshGeometry; // Geometry updates the layout counters
+
+/////////////////////////////
+// Public member functions
+public:
+	// Get geometry for the given file, loading it if it is not already in use. Also returns a vertex layout matching the given
+	// example technique (owned by the geometry). Every successful call must be matched by a call to Release. Returns NULL on failure
+	// If the file has already been loaded (e.g. on a worker thread) it can be passed as preloadedMesh, then only the vertex/index
+	// buffers are created here. Must be called on the thread that uses the device
+	// Vertices are encoded in the given format (see VertexFormat.h), or kept as imported (full floats) if it is NULL
+	static CMeshGeometry* Acquire( const string& fileName, ID3D10EffectTechnique* exampleTechnique, bool tangents,
+	                               const gen::SVertexFormat* vertexFormat, ID3D10InputLayout** vertexLayout,
+	                               const gen::CCookedMesh* preloadedMesh = NULL );
+
+	// Is geometry for the given file already in use - if so there is no need to load the file again
+	static bool IsLoaded( const string& fileName, bool tangents, const gen::SVertexFormat* vertexFormat = NULL )
+	{
+		return m_Geometry.find( MakeKey( fileName, tangents, vertexFormat ) ) != m_Geometry.end();
+	}
+
+	// Load the file for the given geometry without creating any buffers - the CPU side of Acquire. Does not use the device or the
+	// registry, so can be called on any thread. The loaded mesh does not depend on the vertex format, which is applied in Acquire
+	static bool LoadMesh( const string& fileName, bool tangents, gen::CCookedMesh* mesh );
+
+	// Create geometry from vertices and indices merged elsewhere (e.g. a static batch, see StaticBatch.h). The geometry is not shared, it
+	// is used by a single model and released as usual. The merged vertices are full floats as imported with the layout given by the
+	// sub-mesh (see MeshMerge.h), and are encoded in the given format (full floats if NULL). The indices are those of all the draw ranges,
+	// at the sub-mesh's index size. Also returns a vertex layout matching the given example technique. Returns NULL on failure
+	static CMeshGeometry* CreateUnshared( const gen::SSubMesh& merged, const vector<gen::TUInt8>& indices, const vector<SMeshDrawRange>& ranges,
+	                                      ID3D10EffectTechnique* exampleTechnique, const gen::SVertexFormat* vertexFormat,
+	                                      ID3D10InputLayout** vertexLayout );
+
+	// Get a vertex layout for the position buffer of the given geometry matching the given technique, which must only read positions (owned
+	// by the geometry). Returns NULL if the geometry has no position buffer or the technique needs more than positions
+	static ID3D10InputLayout* GetPositionLayout( CMeshGeometry* geometry, ID3D10EffectTechnique* positionTechnique );
+
+	// Stop using the given geometry, it is destroyed when no models use it
+	static void Release( CMeshGeometry* geometry );
+
+	// Get counters showing how many imports and buffer creations have been avoided
+	static const SMeshRegistryStats& GetStats()
+	{
+		return m_Stats;
+	}
+
+	// Write the counters above and a summary of the import statistics to the debugger output
+	static void OutputStats();
+
+	// Get the import statistics of all the files loaded through the registry, with the time taken to create their vertex/index buffers.
+	// Can be saved as JSON or CSV to track loading performance (see CImportStats.h)
+	static const gen::CImportStats& GetImportStats()
+	{
+		return m_ImportStats;
+	}
+
+
+/////////////////////////////
+// Private member functions / variables
+private:
+	// Key of the geometry for the given file and options. The vertex data depends only on the file contents, the tangent option and
+	// the vertex format
+	static string MakeKey( const string& fileName, bool tangents, const gen::SVertexFormat* vertexFormat );
+
+	typedef map<string, CMeshGeometry*> TGeometryMap;
+	static TGeometryMap       m_Geometry;
+	static SMeshRegistryStats m_Stats;
+	static gen::CImportStats  m_ImportStats;
+};
+
+
+#endif // End of header guard - see top of file
@@ -5,11 +5,43 @@
 //	also manages it's positioning with a world matrix
 //--------------------------------------------------------------------------------------
 
+#include <stdio.h>
+#include <math.h>
+
 #include "Defines.h" // General definitions shared by all source files
 #include "Model.h"   // Declaration of this class
+#include "ModelLoadBatch.h"
+#include "Camera.h"
 
 #include "CImportXFile.h"    // Class to load meshes (taken from a full graphics engine)
 using namespace gen;
+
+// Triangle counts for all models, see OutputLODStats
+unsigned int CModel::m_TrianglesRendered = 0;
+unsigned int CModel::m_TrianglesFullDetail = 0;
+
+// Draw call and bind counts for all models, see OutputDrawStats
+unsigned int CModel::m_DrawCalls = 0;
+unsigned int CModel::m_Binds = 0;
+unsigned int CModel::m_BindsSeparate = 0;
+unsigned int CModel::m_PassApplies = 0;
+unsigned int CModel::m_PassAppliesSeparate = 0;
+
+// Vertex data bound by all models, see OutputVertexStreamStats
+unsigned long long CModel::m_VertexBytesBound = 0;
+unsigned long long CModel::m_VertexBytesBoundFull = 0;
+
+// Outline vertices for all models, see OutputOutlineStats
+unsigned long long CModel::m_OutlineVertices = 0;
+unsigned long long CModel::m_OutlineVerticesHull = 0;
+vector<gen::TUInt32> CModel::m_SilhouetteIndices;
+
+// Clusters culled by all models, see OutputClusterStats
+gen::SClusterCullStats CModel::m_ClusterStats = { 0, 0, 0, 0, 0 };
+
+// Techniques rendered from the position buffer, see AddPositionOnlyTechniques
+vector<ID3D10EffectTechnique*> CModel::m_PositionOnlyTechniques;
+
 ///////////////////////////////
 // Constructors / Destructors
 
@@ -19,18 +51,17 @@ CModel::CModel( D3DXVECTOR3 position, D3DXVECTOR3 rotation, float scale )
 	m_Position = position;
 	m_Rotation = rotation;
 	SetScale( scale );
-	UpdateMatrix();
 
 	// Good practice to ensure all private data is sensibly initialised
-	m_VertexBuffer = NULL;
-	m_NumVertices = 0;
-	m_VertexSize = 0;
+	m_IsStatic = false;
+	m_Geometry = NULL;
 	m_VertexLayout = NULL;
 
-	m_IndexBuffer = NULL;
-	m_NumIndices = 0;
-
 	m_HasGeometry = false;
+	m_ClustersCulled = false;
+
+	// The bounds depend on the geometry, so update the matrix after the geometry is initialised
+	UpdateMatrix();
 }
 
 // Model destructor
@@ -42,11 +73,16 @@ CModel::~CModel()
 // Release resources used by model
 void CModel::ReleaseResources()
 {
-	// Release resources
-	SAFE_RELEASE( m_IndexBuffer );  // Using a DirectX helper macro to simplify code here - look it up in Defines.h
-	SAFE_RELEASE( m_VertexBuffer );
-	SAFE_RELEASE( m_VertexLayout );
+	// Stop using the shared geometry, the registry releases the buffers when no other model uses them
+	CMeshRegistry::Release( m_Geometry );
+	m_Geometry = NULL;
+	m_VertexLayout = NULL;
+	m_PositionLayouts.clear();
+	m_LODs.clear();
+	m_VisibleFaces.clear();
+	m_ClustersCulled = false;
 	m_HasGeometry = false;
+	UpdateBounds();
 }
 /////////////////////////////
 // Model facing
@@ -88,135 +124,93 @@ void CModel::FaceDirection(D3DXVECTOR3 dir)
 // The loading and parsing of ".X" files is supported using a class taken from another application. We will not look at the process (more to do with parsing than graphics). Ultimately
 // we end up with arrays of data exactly as we have previously manually typed in
 
-// Load the model geometry from a file. This function only reads the geometry using the first material in the file, so multi-material
-// models will load but will have parts missing. May optionally request for tangents to be created for the model (for normal or parallax mapping)
+// Load the model geometry from a file. The geometry of every material in the file is loaded into a single vertex and index buffer, with a range
+// of indices for each material. May optionally request for tangents to be created for the model (for normal or parallax mapping)
 // We need to pass an example technique that the model will use to help DirectX understand how to connect this data with the vertex shaders
-// Returns true if the load was successful
-bool CModel::Load( const string& fileName, ID3D10EffectTechnique* exampleTechnique, bool tangents /*= false*/ ) // The commented out bit is the default parameter (can't write it here, only in the declaration)
+// The vertex data can be stored in a compact format, which needs a technique that decodes it (see VertexFormat.h)
+// Returns true if the load was successful. If the file has already been loaded on another thread it can be passed as preloadedMesh
+bool CModel::Load( const string& fileName, ID3D10EffectTechnique* exampleTechnique, bool tangents /*= false*/, // The commented out bit is the default parameter (can't write it here, only in the declaration)
+                   const gen::SVertexFormat* vertexFormat /*= NULL*/, const gen::CCookedMesh* preloadedMesh /*= NULL*/ )
 {
 	// Release any existing geometry in this object
 	ReleaseResources();
 
-	// Use CImportXFile class (from another application) to load the given file. The import code is wrapped in the namespace 'gen'
-	gen::CImportXFile mesh;
-	if (mesh.ImportFile( fileName.c_str() ) != gen::kSuccess)
+	// Get the geometry from the mesh registry. It only loads the file and creates vertex/index buffers the first time the file is used, other models
+	// loading the same file share the same geometry
+	m_Geometry = CMeshRegistry::Acquire( fileName, exampleTechnique, tangents, vertexFormat, &m_VertexLayout, preloadedMesh );
+	if (!m_Geometry)
 	{
 		return false;
 	}
 
-	// Get first sub-mesh from loaded file
-	gen::SSubMesh subMesh;
-	if (mesh.GetSubMesh( 0, &subMesh, tangents ) != gen::kSuccess)
+	// Start each draw range at full detail, with every cluster drawn
+	m_LODs.assign( m_Geometry->Ranges.size(), 0 );
+	m_VisibleFaces.resize( m_Geometry->Ranges.size() );
+	GetPositionLayouts();
+
+	m_HasGeometry = true;
+	UpdateBounds();
+	return true;
+}
+
+
+// Use geometry already acquired from the registry, along with a vertex layout for it. The model takes over the reference to the geometry
+void CModel::SetGeometry( CMeshGeometry* geometry, ID3D10InputLayout* vertexLayout )
+{
+	// Release any existing geometry in this object
+	ReleaseResources();
+	if (!geometry)
 	{
-		return false;
+		return;
 	}
 
+	m_Geometry = geometry;
+	m_VertexLayout = vertexLayout;
+	m_LODs.assign( m_Geometry->Ranges.size(), 0 );
+	m_VisibleFaces.resize( m_Geometry->Ranges.size() );
+	GetPositionLayouts();
+	m_HasGeometry = true;
+	UpdateBounds();
+}
+
 
-	// Create vertex element list & layout. We need a vertex layout to say what data we have per vertex in this model (e.g. position, normal, uv, etc.)
-	// In previous projects the element list was a manually typed in array as we knew what data we would provide. However, as we can load models with
-	// different vertex data this time we need flexible code. The array is built up one element at a time: ask the import class if it loaded normals, 
-	// if so then add a normal line to the array, then ask if it loaded UVS...etc
-	unsigned int numElts = 0;
-	unsigned int offset = 0;
-	// Position is always required
-	m_VertexElts[numElts].SemanticName = "POSITION";   // Semantic in HLSL (what is this data for)
-	m_VertexElts[numElts].SemanticIndex = 0;           // Index to add to semantic (a count for this kind of data, when using multiple of the same type, e.g. TEXCOORD0, TEXCOORD1)
-	m_VertexElts[numElts].Format = DXGI_FORMAT_R32G32B32_FLOAT; // Type of data - this one will be a float3 in the shader. Most data communicated as though it were colours
-	m_VertexElts[numElts].AlignedByteOffset = offset;  // Offset of element from start of vertex data (e.g. if we have position (float3), uv (float2) then normal, the normal's offset is 5 floats = 5*4 = 20)
-	m_VertexElts[numElts].InputSlot = 0;               // For when using multiple vertex buffers (e.g. instancing - an advanced topic)
-	m_VertexElts[numElts].InputSlotClass = D3D10_INPUT_PER_VERTEX_DATA; // Use this value for most cases (only changed for instancing)
-	m_VertexElts[numElts].InstanceDataStepRate = 0;                     // --"--
-	offset += 12;
-	++numElts;
-	// Repeat for each kind of vertex data
-	if (subMesh.hasNormals)
-	{
-		m_VertexElts[numElts].SemanticName = "NORMAL";
-		m_VertexElts[numElts].SemanticIndex = 0;
-		m_VertexElts[numElts].Format = DXGI_FORMAT_R32G32B32_FLOAT;
-		m_VertexElts[numElts].AlignedByteOffset = offset;
-		m_VertexElts[numElts].InputSlot = 0;
-		m_VertexElts[numElts].InputSlotClass = D3D10_INPUT_PER_VERTEX_DATA;
-		m_VertexElts[numElts].InstanceDataStepRate = 0;
-		offset += 12;
-		++numElts;
-	}
-	if (subMesh.hasTangents)
-	{
-		m_VertexElts[numElts].SemanticName = "TANGENT";
-		m_VertexElts[numElts].SemanticIndex = 0;
-		m_VertexElts[numElts].Format = DXGI_FORMAT_R32G32B32_FLOAT;
-		m_VertexElts[numElts].AlignedByteOffset = offset;
-		m_VertexElts[numElts].InputSlot = 0;
-		m_VertexElts[numElts].InputSlotClass = D3D10_INPUT_PER_VERTEX_DATA;
-		m_VertexElts[numElts].InstanceDataStepRate = 0;
-		offset += 12;
-		++numElts;
-	}
-	if (subMesh.hasTextureCoords)
-	{
-		m_VertexElts[numElts].SemanticName = "TEXCOORD";
-		m_VertexElts[numElts].SemanticIndex = 0;
-		m_VertexElts[numElts].Format = DXGI_FORMAT_R32G32_FLOAT;
-		m_VertexElts[numElts].AlignedByteOffset = offset;
-		m_VertexElts[numElts].InputSlot = 0;
-		m_VertexElts[numElts].InputSlotClass = D3D10_INPUT_PER_VERTEX_DATA;
-		m_VertexElts[numElts].InstanceDataStepRate = 0;
-		offset += 8;
-		++numElts;
-	}
-	if (subMesh.hasVertexColours)
-	{
-		m_VertexElts[numElts].SemanticName = "COLOR";
-		m_VertexElts[numElts].SemanticIndex = 0;
-		m_VertexElts[numElts].Format = DXGI_FORMAT_R8G8B8A8_UNORM; // A RGBA colour with 1 byte (0-255) per component
-		m_VertexElts[numElts].AlignedByteOffset = offset;
-		m_VertexElts[numElts].InputSlot = 0;
-		m_VertexElts[numElts].InputSlotClass = D3D10_INPUT_PER_VERTEX_DATA;
-		m_VertexElts[numElts].InstanceDataStepRate = 0;
-		offset += 4;
-		++numElts;
-	}
-	m_VertexSize = offset;
-
-	// Given the vertex element list, pass it to DirectX to create a vertex layout. We also need to pass an example of a technique that will
-	// render this model. We will only be able to render this model with techniques that have the same vertex input as the example we use here
-	D3D10_PASS_DESC PassDesc;
-	exampleTechnique->GetPassByIndex( 0 )->GetDesc( &PassDesc );
-	g_pd3dDevice->CreateInputLayout( m_VertexElts, numElts, PassDesc.pIAInputSignature, PassDesc.IAInputSignatureSize, &m_VertexLayout );
-
-
-	// Create the vertex buffer and fill it with the loaded vertex data
-	m_NumVertices = subMesh.numVertices;
-	D3D10_BUFFER_DESC bufferDesc;
-	bufferDesc.BindFlags = D3D10_BIND_VERTEX_BUFFER;
-	bufferDesc.Usage = D3D10_USAGE_DEFAULT; // Not a dynamic buffer
-	bufferDesc.ByteWidth = m_NumVertices * m_VertexSize; // Buffer size
-	bufferDesc.CPUAccessFlags = 0;   // Indicates that CPU won't access this buffer at all after creation
-	bufferDesc.MiscFlags = 0;
-	D3D10_SUBRESOURCE_DATA initData; // Initial data
-	initData.pSysMem = subMesh.vertices;   
-	if (FAILED( g_pd3dDevice->CreateBuffer( &bufferDesc, &initData, &m_VertexBuffer )))
+// Find the techniques in an effect declared to read only vertex positions, with the annotation <bool PositionOnly = true;>
+void CModel::AddPositionOnlyTechniques( ID3D10Effect* effect )
+{
+	D3D10_EFFECT_DESC effectDesc;
+	effect->GetDesc( &effectDesc );
+	for (UINT t = 0; t < effectDesc.Techniques; ++t)
 	{
-		return false;
+		ID3D10EffectTechnique* technique = effect->GetTechniqueByIndex( t );
+		ID3D10EffectVariable* annotation = technique->GetAnnotationByName( "PositionOnly" );
+		BOOL positionOnly = FALSE;
+		if (annotation->IsValid() && SUCCEEDED( annotation->AsScalar()->GetBool( &positionOnly ) ) && positionOnly)
+		{
+			m_PositionOnlyTechniques.push_back( technique );
+		}
 	}
+}
 
 
-	// Create the index buffer - assuming 2-byte (WORD) index data
-	m_NumIndices = static_cast<unsigned int>(subMesh.numFaces) * 3;
-	bufferDesc.BindFlags = D3D10_BIND_INDEX_BUFFER;
-	bufferDesc.Usage = D3D10_USAGE_DEFAULT;
-	bufferDesc.ByteWidth = m_NumIndices * sizeof(WORD);
-	bufferDesc.CPUAccessFlags = 0;
-	bufferDesc.MiscFlags = 0;
-	initData.pSysMem = subMesh.faces;   
-	if (FAILED( g_pd3dDevice->CreateBuffer( &bufferDesc, &initData, &m_IndexBuffer )))
+// Get the layouts of the geometry's position buffer for the position only techniques. A layout is NULL if the geometry has no position buffer
+void CModel::GetPositionLayouts()
+{
+	m_PositionLayouts.resize( m_PositionOnlyTechniques.size() );
+	for (unsigned int t = 0; t < m_PositionOnlyTechniques.size(); ++t)
 	{
-		return false;
+		m_PositionLayouts[t] = CMeshRegistry::GetPositionLayout( m_Geometry, m_PositionOnlyTechniques[t] );
 	}
+}
 
-	m_HasGeometry = true;
-	return true;
+
+// Start loading the model geometry on the worker threads of the given batch. The model has no geometry until the batch's Finish function is called
+void CModel::LoadAsync( CModelLoadBatch& batch, const string& fileName, ID3D10EffectTechnique* exampleTechnique, bool tangents /*= false*/,
+                        const gen::SVertexFormat* vertexFormat /*= NULL*/ )
+{
+	// Release any existing geometry in this object
+	ReleaseResources();
+
+	batch.Add( this, fileName, exampleTechnique, tangents, vertexFormat );
 }
 
 
@@ -237,6 +231,55 @@ void CModel::UpdateMatrix()
 	// Multiply above matrices together to get the effect of them all combined - this makes the world matrix for the rendering pipeline
 	// Order of multiplication is important, get slightly different control mechanism depending on order
 	m_WorldMatrix = matrixScaling * matrixZRot * matrixXRot * matrixYRot * matrixTranslation;
+
+	// Keep the world space bounds in step with the matrix
+	UpdateBounds();
+}
+
+
+// Transform the model space bounds of the geometry into world space with the world matrix
+void CModel::UpdateBounds()
+{
+	if (!m_HasGeometry)
+	{
+		m_BoundsMin = m_BoundsMax = m_BoundsCentre = m_Position;
+		m_BoundsRadius = 0.0f;
+		return;
+	}
+	const gen::SMeshBounds& bounds = m_Geometry->Bounds;
+
+	// World box - start at the translation and add the smallest and largest contribution of each model axis to each world axis. Gives the
+	// same box as transforming all eight corners of the model box, with far less work (Arvo, Graphics Gems 1990)
+	m_BoundsMin = m_BoundsMax = D3DXVECTOR3( m_WorldMatrix._41, m_WorldMatrix._42, m_WorldMatrix._43 );
+	const float* modelMin = &bounds.minBounds.x;
+	const float* modelMax = &bounds.maxBounds.x;
+	float* worldMin = m_BoundsMin;
+	float* worldMax = m_BoundsMax;
+	for (int modelAxis = 0; modelAxis < 3; ++modelAxis)
+	{
+		for (int worldAxis = 0; worldAxis < 3; ++worldAxis)
+		{
+			float fromMin = m_WorldMatrix( modelAxis, worldAxis ) * modelMin[modelAxis];
+			float fromMax = m_WorldMatrix( modelAxis, worldAxis ) * modelMax[modelAxis];
+			worldMin[worldAxis] += fromMin < fromMax ? fromMin : fromMax;
+			worldMax[worldAxis] += fromMin < fromMax ? fromMax : fromMin;
+		}
+	}
+
+	// World sphere - transform the centre, and scale the radius by the longest model axis in world space so the sphere still encloses
+	// the model when it is scaled unevenly
+	D3DXVec3TransformCoord( &m_BoundsCentre, reinterpret_cast<const D3DXVECTOR3*>(&bounds.centre), &m_WorldMatrix );
+	float maxScaleSq = 0.0f;
+	for (int modelAxis = 0; modelAxis < 3; ++modelAxis)
+	{
+		D3DXVECTOR3 axis( m_WorldMatrix( modelAxis, 0 ), m_WorldMatrix( modelAxis, 1 ), m_WorldMatrix( modelAxis, 2 ) );
+		float scaleSq = D3DXVec3LengthSq( &axis );
+		if (scaleSq > maxScaleSq)
+		{
+			maxScaleSq = scaleSq;
+		}
+	}
+	m_BoundsRadius = bounds.radius * sqrtf( maxScaleSq );
 }
 
 
@@ -285,6 +328,145 @@ void CModel::Control( float frameTime, EKeyCode turnUp, EKeyCode turnDown, EKeyC
 }
 
 
+// Choose the level of detail to render from the size of the model on screen with the given camera
+void CModel::SelectLOD( CCamera* camera, float viewportHeight, float pixelError /*= gen::kfDefaultLODPixelError*/ )
+{
+	m_LODs.assign( m_LODs.size(), 0 );
+	if (!m_HasGeometry)
+	{
+		return;
+	}
+
+	// Distance from the camera to the nearest point of the model's world bounding sphere (see UpdateBounds). The largest scale of the model
+	// converts model units to world units, so the errors of the levels are not underestimated. Always use full detail if the camera is
+	// inside the bounds
+	D3DXVECTOR3 toCamera = camera->GetPosition() - m_BoundsCentre;
+	float scale = m_Scale.x > m_Scale.y ? (m_Scale.x > m_Scale.z ? m_Scale.x : m_Scale.z) : (m_Scale.y > m_Scale.z ? m_Scale.y : m_Scale.z);
+	float distance = D3DXVec3Length( &toCamera ) - m_BoundsRadius;
+	if (distance <= 0.0f || scale <= 0.0f)
+	{
+		return;
+	}
+
+	// Levels of detail are chosen in model units, the level selection projects their errors onto the screen using the camera's vertical FOV
+	// Each draw range has its own levels, all chosen from the distance to the whole model
+	for (unsigned int range = 0; range < m_LODs.size(); ++range)
+	{
+		const SMeshDrawRange& drawRange = m_Geometry->Ranges[range];
+		m_LODs[range] = gen::SelectLOD( drawRange.LODs, drawRange.NumLODs, distance / scale, camera->GetFOV(), viewportHeight, pixelError );
+	}
+}
+
+
+// Cull the clusters of the model's full detail faces that are outside the view of the given camera or face away from it
+void CModel::CullClusters( CCamera* camera )
+{
+	m_ClustersCulled = false;
+	if (!camera || !m_HasGeometry || m_Geometry->Clusters.empty())
+	{
+		return;
+	}
+
+	// The clusters are in model space, so find the camera position and frustum planes in model space. A mirroring world matrix flips the
+	// winding of the faces on screen, so the faces the GPU culls are not those facing away in model space - draw every cluster
+	D3DXMATRIX invWorldMatrix;
+	float determinant;
+	if (!D3DXMatrixInverse( &invWorldMatrix, &determinant, &m_WorldMatrix ) || determinant < 0.0f)
+	{
+		return;
+	}
+	D3DXVECTOR3 cameraPos = camera->GetPosition();
+	D3DXVECTOR3 modelCameraPos;
+	D3DXVec3TransformCoord( &modelCameraPos, &cameraPos, &invWorldMatrix );
+	gen::CVector3 viewPoint( modelCameraPos.x, modelCameraPos.y, modelCameraPos.z );
+	D3DXMATRIX worldViewProj = m_WorldMatrix * camera->GetViewProjectionMatrix();
+	gen::CVector4 frustumPlanes[6];
+	gen::GetFrustumPlanes( gen::CMatrix4x4( &worldViewProj._11 ), frustumPlanes );
+
+	// Each range's clusters give a list of face ranges to draw, neighbouring clusters are joined into one. The clusters only cover the full
+	// detail faces, so ranges drawn at a lower level of detail (chosen by SelectLOD beforehand) are skipped
+	for (unsigned int range = 0; range < m_VisibleFaces.size(); ++range)
+	{
+		const SMeshDrawRange& drawRange = m_Geometry->Ranges[range];
+		m_VisibleFaces[range].clear();
+		if (drawRange.NumClusters > 0 && m_LODs[range] == 0)
+		{
+			gen::CullMeshClusters( &m_Geometry->Clusters[drawRange.FirstCluster], drawRange.NumClusters, frustumPlanes, viewPoint,
+			                       &m_VisibleFaces[range], &m_ClusterStats );
+		}
+	}
+	m_ClustersCulled = true;
+}
+
+
+// Find the closest intersection of a world space ray with the model's full detail faces, no further than the given distance along the ray
+bool CModel::IntersectRay( const D3DXVECTOR3& origin, const D3DXVECTOR3& direction, float maxDistance, SModelRayHit* hit )
+{
+	gen::CVector3 modelOrigin, modelDirection;
+	if (!GetModelSpaceRay( origin, direction, &modelOrigin, &modelDirection ))
+	{
+		return false;
+	}
+
+	// Each draw range has its own hierarchy, later ranges only need to beat the closest hit so far
+	bool found = false;
+	for (unsigned int range = 0; range < m_Geometry->RangeBVHs.size(); ++range)
+	{
+		gen::SRayHit rangeHit;
+		if (m_Geometry->RangeBVHs[range].IntersectRay( modelOrigin, modelDirection, maxDistance, &rangeHit ))
+		{
+			maxDistance = rangeHit.fDistance;
+			hit->Range = range;
+			hit->Face = rangeHit.iFace;
+			hit->U = rangeHit.fU;
+			hit->V = rangeHit.fV;
+			hit->Distance = rangeHit.fDistance;
+			found = true;
+		}
+	}
+	return found;
+}
+
+// Does a world space ray hit any of the model's faces no further than the given distance
+bool CModel::IsRayBlocked( const D3DXVECTOR3& origin, const D3DXVECTOR3& direction, float maxDistance )
+{
+	gen::CVector3 modelOrigin, modelDirection;
+	if (!GetModelSpaceRay( origin, direction, &modelOrigin, &modelDirection ))
+	{
+		return false;
+	}
+	for (unsigned int range = 0; range < m_Geometry->RangeBVHs.size(); ++range)
+	{
+		if (m_Geometry->RangeBVHs[range].IsRayBlocked( modelOrigin, modelDirection, maxDistance ))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// Transform a world space ray into model space with the inverse of the world matrix. The direction is transformed as a vector without
+// normalising, so a point at a given distance along the world ray is at the same distance along the model ray
+bool CModel::GetModelSpaceRay( const D3DXVECTOR3& origin, const D3DXVECTOR3& direction, gen::CVector3* modelOrigin, gen::CVector3* modelDirection )
+{
+	if (!m_HasGeometry || m_Geometry->RangeBVHs.empty())
+	{
+		return false;
+	}
+	D3DXMATRIX invWorldMatrix;
+	if (!D3DXMatrixInverse( &invWorldMatrix, NULL, &m_WorldMatrix ))
+	{
+		return false;
+	}
+	D3DXVECTOR3 rayOrigin, rayDirection;
+	D3DXVec3TransformCoord( &rayOrigin, &origin, &invWorldMatrix );
+	D3DXVec3TransformNormal( &rayDirection, &direction, &invWorldMatrix );
+	*modelOrigin = gen::CVector3( rayOrigin.x, rayOrigin.y, rayOrigin.z );
+	*modelDirection = gen::CVector3( rayDirection.x, rayDirection.y, rayDirection.z );
+	return true;
+}
+
+
 // Render the model with the given technique. Assumes any shader variables for the technique have already been set up (e.g. matrices and textures)
 void CModel::Render( ID3D10EffectTechnique* technique )
 {
@@ -294,21 +476,231 @@ void CModel::Render( ID3D10EffectTechnique* technique )
 		return;
 	}
 
+	// Position only techniques use the position buffer if the geometry has one, which needs far less vertex bandwidth than the full vertices
+	ID3D10Buffer* vertexBuffer;
+	UINT vertexSize;
+	ID3D10InputLayout* vertexLayout;
+	GetVertexStream( technique, &vertexBuffer, &vertexSize, &vertexLayout );
+
 	// Select vertex and index buffer - assuming all data will be as triangle lists
 	UINT offset = 0;
-	g_pd3dDevice->IASetVertexBuffers( 0, 1, &m_VertexBuffer, &m_VertexSize, &offset );
-	g_pd3dDevice->IASetInputLayout( m_VertexLayout );
-	g_pd3dDevice->IASetIndexBuffer( m_IndexBuffer, DXGI_FORMAT_R16_UINT, 0 );
+	g_pd3dDevice->IASetVertexBuffers( 0, 1, &vertexBuffer, &vertexSize, &offset );
+	g_pd3dDevice->IASetInputLayout( vertexLayout );
+	g_pd3dDevice->IASetIndexBuffer( m_Geometry->IndexBuffer, m_Geometry->IndexFormat, 0 );
 	g_pd3dDevice->IASetPrimitiveTopology( D3D10_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
 
 	// Render the model. All the data and shader variables are prepared, now select the technique to use and draw.
 	// The loop is for advanced techniques that need multiple passes - we will only use techniques with one pass
+	// Each draw range (sub-mesh) is drawn with its own call from the same buffers, its indices are offset by its base vertex. Only the
+	// faces of the chosen level of detail of each range are drawn. At full detail, if the clusters were culled, only the faces of the
+	// clusters left are drawn - a call for each run of neighbouring clusters
+	unsigned int numRanges = static_cast<unsigned int>(m_Geometry->Ranges.size());
+	unsigned int numDraws = 0;
+	D3D10_TECHNIQUE_DESC techDesc;
+	technique->GetDesc( &techDesc );
+	for( UINT p = 0; p < techDesc.Passes; ++p )
+	{
+		technique->GetPassByIndex( p )->Apply( 0 );
+		numDraws = 0;
+		for (unsigned int range = 0; range < numRanges; ++range)
+		{
+			const SMeshDrawRange& drawRange = m_Geometry->Ranges[range];
+			if (m_ClustersCulled && m_LODs[range] == 0 && drawRange.NumClusters > 0)
+			{
+				const vector<gen::SClusterDrawRange>& visibleFaces = m_VisibleFaces[range];
+				for (unsigned int faces = 0; faces < visibleFaces.size(); ++faces)
+				{
+					g_pd3dDevice->DrawIndexed( visibleFaces[faces].iNumFaces * 3, drawRange.FirstIndex + visibleFaces[faces].iFirstFace * 3,
+					                           drawRange.BaseVertex );
+				}
+				numDraws += static_cast<unsigned int>(visibleFaces.size());
+			}
+			else
+			{
+				const gen::SMeshLOD& lod = drawRange.LODs[m_LODs[range]];
+				g_pd3dDevice->DrawIndexed( lod.iNumFaces * 3, drawRange.FirstIndex + lod.iFirstFace * 3, drawRange.BaseVertex );
+				++numDraws;
+			}
+		}
+	}
+
+	for (unsigned int range = 0; range < numRanges; ++range)
+	{
+		const SMeshDrawRange& drawRange = m_Geometry->Ranges[range];
+		if (m_ClustersCulled && m_LODs[range] == 0 && drawRange.NumClusters > 0)
+		{
+			for (unsigned int faces = 0; faces < m_VisibleFaces[range].size(); ++faces)
+			{
+				m_TrianglesRendered += m_VisibleFaces[range][faces].iNumFaces;
+			}
+		}
+		else
+		{
+			m_TrianglesRendered += drawRange.LODs[m_LODs[range]].iNumFaces;
+		}
+		m_TrianglesFullDetail += drawRange.LODs[0].iNumFaces;
+	}
+
+	// Vertex buffer, input layout and index buffer are bound once, a model for each sub-mesh would bind them for each range. The same
+	// for the pass applies
+	m_DrawCalls += techDesc.Passes * numDraws;
+	m_Binds += 3;
+	m_BindsSeparate += 3 * numRanges;
+	m_PassApplies += techDesc.Passes;
+	m_PassAppliesSeparate += techDesc.Passes * numRanges;
+	m_VertexBytesBound += m_Geometry->NumVertices * vertexSize;
+	m_VertexBytesBoundFull += m_Geometry->NumVertices * m_Geometry->VertexSize;
+}
+
+
+// Render the silhouette edges of the model seen from the given camera as lines
+void CModel::RenderSilhouette( ID3D10EffectTechnique* technique, CCamera* camera, gen::CThreadPool* threadPool )
+{
+	if (!m_HasGeometry || !m_Geometry->SilhouetteBuffer)
+	{
+		return;
+	}
+
+	// The edges are in model space, so find the camera position in model space. The side of each face the camera is on is unchanged by the
+	// transform, so the silhouette is the same as it would be in world space
+	D3DXMATRIX invWorldMatrix;
+	if (!D3DXMatrixInverse( &invWorldMatrix, NULL, &m_WorldMatrix ))
+	{
+		return;
+	}
+	D3DXVECTOR3 cameraPos = camera->GetPosition();
+	D3DXVECTOR3 modelCameraPos;
+	D3DXVec3TransformCoord( &modelCameraPos, &cameraPos, &invWorldMatrix );
+	gen::CVector3 viewPoint( modelCameraPos.x, modelCameraPos.y, modelCameraPos.z );
+
+	// Find the silhouette edges of every draw range as one line list, each range's indices offset by its base vertex so they can be drawn
+	// with one call
+	m_SilhouetteIndices.clear();
+	for (unsigned int range = 0; range < m_Geometry->RangeSilhouettes.size(); ++range)
+	{
+		m_Geometry->RangeSilhouettes[range].Extract( viewPoint, &m_SilhouetteIndices, m_Geometry->Ranges[range].BaseVertex, threadPool );
+	}
+	unsigned int numIndices = static_cast<unsigned int>(m_SilhouetteIndices.size());
+	if (numIndices == 0)
+	{
+		return;
+	}
+
+	// Copy the lines into the geometry's silhouette buffer. Discarding the previous contents lets the GPU keep drawing from them while the
+	// new lines are written to fresh memory
+	void* bufferData;
+	if (FAILED( m_Geometry->SilhouetteBuffer->Map( D3D10_MAP_WRITE_DISCARD, 0, &bufferData ) ))
+	{
+		return;
+	}
+	memcpy( bufferData, m_SilhouetteIndices.data(), numIndices * sizeof(gen::TUInt32) );
+	m_Geometry->SilhouetteBuffer->Unmap();
+
+	ID3D10Buffer* vertexBuffer;
+	UINT vertexSize;
+	ID3D10InputLayout* vertexLayout;
+	GetVertexStream( technique, &vertexBuffer, &vertexSize, &vertexLayout );
+	UINT offset = 0;
+	g_pd3dDevice->IASetVertexBuffers( 0, 1, &vertexBuffer, &vertexSize, &offset );
+	g_pd3dDevice->IASetInputLayout( vertexLayout );
+	g_pd3dDevice->IASetIndexBuffer( m_Geometry->SilhouetteBuffer, DXGI_FORMAT_R32_UINT, 0 );
+	g_pd3dDevice->IASetPrimitiveTopology( D3D10_PRIMITIVE_TOPOLOGY_LINELIST );
+
 	D3D10_TECHNIQUE_DESC techDesc;
 	technique->GetDesc( &techDesc );
 	for( UINT p = 0; p < techDesc.Passes; ++p )
 	{
 		technique->GetPassByIndex( p )->Apply( 0 );
-		g_pd3dDevice->DrawIndexed( m_NumIndices, 0, 0 );
+		g_pd3dDevice->DrawIndexed( numIndices, 0, 0 );
+	}
+
+	// Without a vertex cache each line vertex is processed once per line, an expanded copy of the mesh processes every vertex (and rasterises
+	// every face)
+	m_DrawCalls += techDesc.Passes;
+	m_OutlineVertices += numIndices;
+	m_OutlineVerticesHull += m_Geometry->NumVertices;
+}
+
+
+// Get the vertex buffer, vertex size and layout to render the geometry with the given technique
+void CModel::GetVertexStream( ID3D10EffectTechnique* technique, ID3D10Buffer** vertexBuffer, UINT* vertexSize, ID3D10InputLayout** vertexLayout )
+{
+	*vertexBuffer = m_Geometry->VertexBuffer;
+	*vertexSize = m_Geometry->VertexSize;
+	*vertexLayout = m_VertexLayout;
+	for (unsigned int t = 0; t < m_PositionLayouts.size(); ++t)
+	{
+		if (m_PositionOnlyTechniques[t] == technique && m_PositionLayouts[t])
+		{
+			*vertexBuffer = m_Geometry->PositionBuffer;
+			*vertexSize = m_Geometry->PositionSize;
+			*vertexLayout = m_PositionLayouts[t];
+			break;
+		}
+	}
+}
+
+
+// Write the number of triangles rendered by all models since the start, compared to rendering every model at full detail, to the debugger output
+void CModel::OutputLODStats()
+{
+	char text[256];
+	sprintf_s( text, "Levels of detail: %u triangles rendered, %u at full detail (%.1f%%)\n", m_TrianglesRendered, m_TrianglesFullDetail,
+	           m_TrianglesFullDetail ? 100.0f * m_TrianglesRendered / m_TrianglesFullDetail : 100.0f );
+	OutputDebugStringA( text );
+}
+
+
+// Write the number of draw calls, binds and pass applies made by all models since the start, compared to loading each sub-mesh as a separate model,
+// to the debugger output
+void CModel::OutputDrawStats()
+{
+	char text[256];
+	sprintf_s( text, "Draw calls: %u draws, %u binds (%u as separate models), %u pass applies (%u as separate models)\n", m_DrawCalls,
+	           m_Binds, m_BindsSeparate, m_PassApplies, m_PassAppliesSeparate );
+	OutputDebugStringA( text );
+}
+
+
+// Write the bytes of vertex data bound by all models per frame, compared to binding the full vertices for every technique, to the debugger output
+void CModel::OutputVertexStreamStats( unsigned int frames )
+{
+	if (frames == 0)
+	{
+		return;
+	}
+	char text[256];
+	sprintf_s( text, "Vertex streams: %.1fKB bound per frame, %.1fKB with full vertices for every technique (%.1f%%)\n",
+	           m_VertexBytesBound / 1024.0f / frames, m_VertexBytesBoundFull / 1024.0f / frames,
+	           m_VertexBytesBoundFull ? 100.0f * m_VertexBytesBound / m_VertexBytesBoundFull : 100.0f );
+	OutputDebugStringA( text );
+}
+
+
+// Write the vertices of the silhouette lines drawn by all models since the start, compared to outlining each model with an expanded copy of
+// its mesh, to the debugger output
+void CModel::OutputOutlineStats()
+{
+	char text[256];
+	sprintf_s( text, "Outlines: %llu silhouette line vertices processed, %llu for expanded meshes (%.1f%%)\n", m_OutlineVertices,
+	           m_OutlineVerticesHull, m_OutlineVerticesHull ? 100.0 * m_OutlineVertices / m_OutlineVerticesHull : 100.0 );
+	OutputDebugStringA( text );
+}
+
+
+// Write the clusters and faces culled by all models per frame to the debugger output
+void CModel::OutputClusterStats( unsigned int frames )
+{
+	if (frames == 0)
+	{
+		return;
 	}
-	g_pd3dDevice->DrawIndexed( m_NumIndices, 0, 0 );
+	const gen::SClusterCullStats& stats = m_ClusterStats;
+	char text[256];
+	sprintf_s( text, "Cluster culling: %.1f clusters per frame, %.1f outside the view and %.1f facing away, %.1f of %.1f triangles culled (%.1f%%)\n",
+	           static_cast<float>(stats.iNumClusters) / frames, static_cast<float>(stats.iNumFrustumCulled) / frames,
+	           static_cast<float>(stats.iNumConeCulled) / frames, static_cast<float>(stats.iNumFacesCulled) / frames,
+	           static_cast<float>(stats.iNumFacesDrawn + stats.iNumFacesCulled) / frames,
+	           (stats.iNumFacesDrawn + stats.iNumFacesCulled) ? 100.0f * stats.iNumFacesCulled / (stats.iNumFacesDrawn + stats.iNumFacesCulled) : 0.0f );
+	OutputDebugStringA( text );
 }
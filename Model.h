@@ -9,11 +9,26 @@
 #define MODEL_H_INCLUDED
 
 #include <string>
+#include <vector>
 using namespace std;
 
 #include <d3d10.h>
 #include <d3dx10.h>
 #include "Input.h"
+#include "MeshRegistry.h"
+
+class CModelLoadBatch; // Loads the files for several models in parallel, see ModelLoadBatch.h
+class CCamera;
+
+
+// Closest intersection of a ray with a model's faces, see CModel::IntersectRay
+struct SModelRayHit
+{
+	unsigned int Range;    // Draw range of the geometry hit - one for each sub-mesh of the file (see MeshRegistry.h)
+	unsigned int Face;     // Face hit, counted from the first full detail face of the range
+	float        U, V;     // Barycentric coordinates of the hit in the face (see gen::SRayHit)
+	float        Distance; // Distance along the ray, in units of the ray direction
+};
 
 
 class CModel
@@ -32,6 +47,16 @@ private:
 	// World matrix for the model - built from the above
 	D3DXMATRIX m_WorldMatrix;
 
+	// Static models don't move once placed, so they can be merged into a static batch (see StaticBatch.h)
+	bool          m_IsStatic;
+
+	// Bounding box and sphere of the model in world space, updated with the world matrix. The box is the world aligned box around the
+	// transformed model space box, the sphere is the model space sphere scaled by the largest scale of the model
+	D3DXVECTOR3   m_BoundsMin;
+	D3DXVECTOR3   m_BoundsMax;
+	D3DXVECTOR3   m_BoundsCentre;
+	float         m_BoundsRadius;
+
 	
 	//-----------------
 	// Geometry data
@@ -39,19 +64,51 @@ private:
 	// Does this model have any geometry to render
 	bool                     m_HasGeometry;
 
-	// Vertex data for the model stored in a vertex buffer and the number of the vertices in the buffer
-	ID3D10Buffer*            m_VertexBuffer;
-	unsigned int             m_NumVertices;
+	// Geometry (vertex and index buffers) for the model. Shared with all other models loaded from the same file, see MeshRegistry.h
+	CMeshGeometry*           m_Geometry;
+	ID3D10InputLayout*       m_VertexLayout; // Layout of a vertex for the technique used to load the model (owned by the geometry)
+
+	// Layouts of the geometry's position buffer for each position only technique (see AddPositionOnlyTechniques), created when the geometry is
+	// loaded. NULL for each technique if the geometry has no position buffer
+	vector<ID3D10InputLayout*> m_PositionLayouts;
+
+	// Techniques declared in the effect file to read only vertex positions, rendered from the position buffer of each model's geometry
+	static vector<ID3D10EffectTechnique*> m_PositionOnlyTechniques;
+
+	// Level of detail rendered for each draw range of the geometry, chosen each frame from the model's size on screen (see SelectLOD)
+	vector<unsigned int>     m_LODs;
+
+	// Faces of each draw range left after culling its clusters against the camera (see CullClusters), drawn when the range is at full detail.
+	// Only used if the clusters were culled this frame, ranges without clusters are drawn whole
+	vector<vector<gen::SClusterDrawRange> > m_VisibleFaces;
+	bool                     m_ClustersCulled;
+
+	// Triangles rendered by all models, and the triangles that would have been rendered if every model used its full detail mesh
+	static unsigned int      m_TrianglesRendered;
+	static unsigned int      m_TrianglesFullDetail;
+
+	// Draw calls, buffer / layout binds and technique pass applies made by all models. Also the binds and applies that would have been made
+	// if each sub-mesh of each file was loaded as a separate model, rather than sharing one set of buffers (the draw calls are the same)
+	static unsigned int      m_DrawCalls;
+	static unsigned int      m_Binds;
+	static unsigned int      m_BindsSeparate;
+	static unsigned int      m_PassApplies;
+	static unsigned int      m_PassAppliesSeparate;
+
+	// Bytes of vertex data in the vertex buffers bound by all models, and the bytes if every technique was given the full vertices
+	static unsigned long long m_VertexBytesBound;
+	static unsigned long long m_VertexBytesBoundFull;
+
+	// Vertices of the silhouette lines drawn by all models, and the vertices an outline drawn as an expanded copy of each model would have
+	// processed (the whole mesh, see RenderSilhouette)
+	static unsigned long long m_OutlineVertices;
+	static unsigned long long m_OutlineVerticesHull;
 
-	// Description of the elements in a single vertex (position, normal, UVs etc.)
-	static const int         MAX_VERTEX_ELTS = 64;
-	D3D10_INPUT_ELEMENT_DESC m_VertexElts[MAX_VERTEX_ELTS];
-	ID3D10InputLayout*       m_VertexLayout; // Layout of a vertex (derived from above)
-	unsigned int             m_VertexSize;   // Size of vertex calculated from contained elements
+	// Silhouette edges of the model being drawn as a line list, kept between calls to save allocating it each time
+	static vector<gen::TUInt32> m_SilhouetteIndices;
 
-	// Index data for the model stored in a index buffer and the number of indices in the buffer
-	ID3D10Buffer*            m_IndexBuffer;
-	unsigned int             m_NumIndices;
+	// Clusters tested and culled by all models, and the full detail faces culled with them (see CullClusters)
+	static gen::SClusterCullStats m_ClusterStats;
 
 
 /////////////////////////////
@@ -93,6 +150,48 @@ public:
 		return m_WorldMatrix;
 	}
 
+	// World space bounding box and sphere of the model, as of the last call to UpdateMatrix. Zero size at the model's position if the model
+	// has no geometry
+	const D3DXVECTOR3& GetBoundsMin()
+	{
+		return m_BoundsMin;
+	}
+	const D3DXVECTOR3& GetBoundsMax()
+	{
+		return m_BoundsMax;
+	}
+	const D3DXVECTOR3& GetBoundsCentre()
+	{
+		return m_BoundsCentre;
+	}
+	float GetBoundsRadius()
+	{
+		return m_BoundsRadius;
+	}
+
+	// Geometry used by the model, shared with other models loaded from the same file. NULL if the model has no geometry
+	CMeshGeometry* GetGeometry()
+	{
+		return m_HasGeometry ? m_Geometry : NULL;
+	}
+
+	// Is the model static - placed once and never moved, so it can be merged into a static batch (see StaticBatch.h)
+	bool IsStatic()
+	{
+		return m_IsStatic;
+	}
+
+	// Scale and bias to decode the model's vertex positions (position * scale + bias), for techniques that render compact vertices.
+	// Send to the shader along with the world matrix. Identity for models loaded with full float vertices
+	D3DXVECTOR3 GetPositionScale()
+	{
+		return m_HasGeometry ? m_Geometry->PositionScale : D3DXVECTOR3( 1.0f, 1.0f, 1.0f );
+	}
+	D3DXVECTOR3 GetPositionBias()
+	{
+		return m_HasGeometry ? m_Geometry->PositionBias : D3DXVECTOR3( 0.0f, 0.0f, 0.0f );
+	}
+
 
 	// Setters
 	void SetPosition( D3DXVECTOR3 position )
@@ -111,6 +210,11 @@ public:
 	{
 		m_Scale = D3DXVECTOR3( scale, scale, scale );
 	}
+	// Mark the model as static, it must not be moved after it is added to a static batch
+	void SetStatic( bool isStatic )
+	{
+		m_IsStatic = isStatic;
+	}
 	// Added these functions for the shadow mapping lab - want spotlight models to face in a given directions
 	D3DXVECTOR3 GetFacing();
 	void FacePoint(D3DXVECTOR3 point);   // Make the model face a given point
@@ -120,25 +224,122 @@ public:
 	/////////////////////////////
 	// Model Loading
 
-	// Load the model geometry from a file. This function only reads the geometry using the first material in the file, so multi-material
-	// models will load but will have parts missing. May optionally request for tangents to be created for the model (for normal or parallax mapping)
+	// Load the model geometry from a file. The geometry of every material in the file is loaded into a single vertex and index buffer, with
+	// a range of indices for each material. Textures are set by the caller for the whole model, so each range is drawn with the same
+	// textures. May optionally request for tangents to be created for the model (for normal or parallax mapping)
 	// We need to pass an example technique that the model will use to help DirectX understand how to connect this data with the vertex shaders
+	// May also pass a compact vertex format (e.g. &gen::kVertexFormatCompact, see VertexFormat.h) to use less memory and bandwidth, the
+	// technique must then decode the vertices. Vertices are kept as full floats if no format is given
 	// Returns true if the load was successful
-	bool Load( const string& fileName, ID3D10EffectTechnique* shaderCode, bool tangents = false );
+	// If the file has already been loaded on another thread it can be passed as preloadedMesh (see CModelLoadBatch)
+	bool Load( const string& fileName, ID3D10EffectTechnique* shaderCode, bool tangents = false,
+	           const gen::SVertexFormat* vertexFormat = NULL, const gen::CCookedMesh* preloadedMesh = NULL );
+
+	// Start loading the model geometry on the worker threads of the given batch, parameters as above. The model has no geometry until the
+	// batch's Finish function is called, which returns false if any model in the batch failed to load
+	void LoadAsync( CModelLoadBatch& batch, const string& fileName, ID3D10EffectTechnique* shaderCode, bool tangents = false,
+	                const gen::SVertexFormat* vertexFormat = NULL );
+
+
+	// Find the techniques in an effect declared to read only vertex positions, with the annotation <bool PositionOnly = true;>. Models render
+	// these techniques from the position buffer of their geometry (see MeshRegistry.h), which is far smaller than the full vertices. Call
+	// before loading models, the position buffer layouts are created when the geometry is loaded
+	static void AddPositionOnlyTechniques( ID3D10Effect* effect );
+
+	// Use geometry already acquired from the registry (e.g. created for a static batch by CMeshRegistry::CreateUnshared), along with
+	// a vertex layout for it. The model takes over the reference to the geometry and releases it as if the model had loaded it
+	void SetGeometry( CMeshGeometry* geometry, ID3D10InputLayout* vertexLayout );
 
 
 	/////////////////////////////
 	// Model Usage
 
-	// Update the world matrix of the model from its position, rotation and scaling
+	// Update the world matrix of the model from its position, rotation and scaling, and the world space bounds from the matrix
 	void UpdateMatrix();
 	
 	// Control the model's position and rotation using keys provided. Amount of motion performed depends on frame time
 	void Control( float frameTime, EKeyCode turnUp, EKeyCode turnDown, EKeyCode turnLeft, EKeyCode turnRight,  
 				  EKeyCode turnCW, EKeyCode turnCCW, EKeyCode moveForward, EKeyCode moveBackward );
 
+	// Choose the level of detail to render from the size of the model on screen with the given camera. Uses the coarsest level of each
+	// draw range whose difference from the full mesh covers no more than the given number of pixels. Call after updating the model and
+	// camera matrices
+	void SelectLOD( CCamera* camera, float viewportHeight, float pixelError = gen::kfDefaultLODPixelError );
+
+	// Cull the clusters of the model's full detail faces (see MeshRegistry.h) that are outside the view of the given camera or face away from
+	// it. Render then only draws the faces of the clusters left, for draw ranges at full detail - a few draw calls for each range, as
+	// neighbouring clusters are drawn together. The result is used for every Render until the next call, so the model must be rendered from
+	// this camera. Call after updating the model and camera matrices and after SelectLOD, ranges at a lower level of detail are not culled.
+	// Pass NULL to draw every cluster again. Models with a mirroring world matrix are drawn whole, their faces are flipped
+	void CullClusters( CCamera* camera );
+
+	// Find the closest intersection of a world space ray with the model's full detail faces, no further than the given distance along the ray
+	// (in units of the ray direction). Uses the model's world matrix as of the last UpdateMatrix, skinned models are tested in their bind
+	// pose. Returns false if the ray misses or the model has no geometry, the hit is only written if there is one
+	bool IntersectRay( const D3DXVECTOR3& origin, const D3DXVECTOR3& direction, float maxDistance, SModelRayHit* hit );
+
+	// Does a world space ray hit any of the model's faces no further than the given distance - a line of sight test, quicker than finding
+	// the closest hit
+	bool IsRayBlocked( const D3DXVECTOR3& origin, const D3DXVECTOR3& direction, float maxDistance );
+
+	// Get the level of detail chosen by SelectLOD for a draw range of the geometry (see MeshRegistry.h), 0 is the full detail mesh
+	unsigned int GetLOD( unsigned int range = 0 )
+	{
+		return range < m_LODs.size() ? m_LODs[range] : 0;
+	}
+
 	// Render the model with the given technique. Assumes any shader variables for the technique have already been set up (e.g. matrices and textures)
+	// The buffers are bound once and each draw range of the geometry is drawn with its own call. Position only techniques are given the
+	// geometry's position buffer rather than the full vertices
 	void Render( ID3D10EffectTechnique* technique );
+
+	// Render the silhouette edges of the model seen from the given camera as lines, e.g. to outline it. The edges are found on the CPU each
+	// call - those between faces towards and away from the camera - and only they are drawn, rather than an expanded copy of the whole mesh
+	// behind the model. The technique must draw a line list with the geometry's positions, set up as for Render. Skinned draw ranges have
+	// no silhouette (see MeshRegistry.h). If a thread pool is given, the edges of large meshes are found on its worker threads
+	void RenderSilhouette( ID3D10EffectTechnique* technique, CCamera* camera, gen::CThreadPool* threadPool = NULL );
+
+	// Write the number of triangles rendered by all models since the start, compared to rendering every model at full detail, to the debugger output
+	static void OutputLODStats();
+
+	// Get the number of draw calls made by all models since the start
+	static unsigned int GetNumDrawCalls()
+	{
+		return m_DrawCalls;
+	}
+
+	// Write the number of draw calls, binds and pass applies made by all models since the start, compared to loading each sub-mesh as a
+	// separate model, to the debugger output
+	static void OutputDrawStats();
+
+	// Write the bytes of vertex data bound by all models per frame over the given number of frames, compared to binding the full vertices
+	// for every technique, to the debugger output
+	static void OutputVertexStreamStats( unsigned int frames );
+
+	// Write the vertices of the silhouette lines drawn by all models since the start, compared to outlining each model with an expanded copy
+	// of its mesh, to the debugger output
+	static void OutputOutlineStats();
+
+	// Write the clusters and faces culled by all models per frame over the given number of frames to the debugger output
+	static void OutputClusterStats( unsigned int frames );
+
+
+/////////////////////////////
+// Private member functions
+private:
+	// Transform the model space bounds of the geometry into world space with the world matrix
+	void UpdateBounds();
+
+	// Get the layouts of the geometry's position buffer for the position only techniques, after the geometry is set
+	void GetPositionLayouts();
+
+	// Get the vertex buffer, vertex size and layout to render the geometry with the given technique - the position buffer for position only
+	// techniques if the geometry has one, otherwise the full vertices
+	void GetVertexStream( ID3D10EffectTechnique* technique, ID3D10Buffer** vertexBuffer, UINT* vertexSize, ID3D10InputLayout** vertexLayout );
+
+	// Transform a world space ray into model space, where the geometry's faces are. The direction is not normalised, so distances along the
+	// ray are the same in both spaces. Returns false if the model has no faces to test or is scaled to nothing
+	bool GetModelSpaceRay( const D3DXVECTOR3& origin, const D3DXVECTOR3& direction, gen::CVector3* modelOrigin, gen::CVector3* modelDirection );
 };
 
 
@@ -0,0 +1,113 @@
+//--------------------------------------------------------------------------------------
+//	ModelLoadBatch.cpp
+//
+//	A model load batch loads the files for a set of models on worker threads, then
+//	creates the vertex/index buffers on the thread that owns the device
+//--------------------------------------------------------------------------------------
+
+#include "Defines.h"        // General definitions shared by all source files
+#include "ModelLoadBatch.h" // Declaration of this class
+#include "Model.h"
+
+#include "CCookedMesh.h"    // Cache of pre-processed meshes, avoids re-importing unchanged files
+
+
+// Constructor - the batch will run its loads on the given thread pool
+CModelLoadBatch::CModelLoadBatch( gen::CThreadPool* threadPool )
+{
+	m_ThreadPool = threadPool;
+}
+
+// Destructor - waits for any loads that have not been finished, the worker threads still refer to the pending meshes
+CModelLoadBatch::~CModelLoadBatch()
+{
+	for (unsigned int i = 0; i < m_PendingMeshes.size(); ++i)
+	{
+		if (m_PendingMeshes[i].result.valid())
+		{
+			m_PendingMeshes[i].result.wait();
+		}
+	}
+}
+
+
+// Start loading the geometry for a model on a worker thread
+void CModelLoadBatch::Add( CModel* model, const string& fileName, ID3D10EffectTechnique* exampleTechnique, bool tangents /*= false*/,
+                           const gen::SVertexFormat* vertexFormat /*= NULL*/ )
+{
+	SModelRequest request;
+	request.model = model;
+	request.fileName = fileName;
+	request.exampleTechnique = exampleTechnique;
+	request.tangents = tangents;
+	request.vertexFormat = vertexFormat ? *vertexFormat : gen::kVertexFormatFloat;
+	request.pendingMesh = -1;
+
+	// Only load the file if no other model has already requested it and the geometry isn't already in use. Models using different vertex
+	// formats share the load, the vertices are only encoded when the buffers are created
+	if (!CMeshRegistry::IsLoaded( fileName, tangents, &request.vertexFormat ))
+	{
+		for (unsigned int i = 0; i < m_PendingMeshes.size(); ++i)
+		{
+			if (m_PendingMeshes[i].fileName == fileName && m_PendingMeshes[i].tangents == tangents)
+			{
+				request.pendingMesh = i;
+				break;
+			}
+		}
+		if (request.pendingMesh < 0)
+		{
+			SPendingMesh pending;
+			pending.fileName = fileName;
+			pending.tangents = tangents;
+			pending.mesh.reset( new gen::CCookedMesh );
+
+			// The worker only touches the mesh object, which is kept alive by its own shared pointer
+			shared_ptr<gen::CCookedMesh> mesh = pending.mesh;
+			pending.result = m_ThreadPool->Submit( [fileName, tangents, mesh]() { return CMeshRegistry::LoadMesh( fileName, tangents, mesh.get() ); } );
+
+			request.pendingMesh = static_cast<int>(m_PendingMeshes.size());
+			m_PendingMeshes.push_back( move( pending ) );
+		}
+	}
+
+	m_Requests.push_back( request );
+}
+
+
+// Wait for all loads to complete and create the vertex/index buffers for each model. Must be called on the thread that uses the device
+bool CModelLoadBatch::Finish()
+{
+	// Models are completed in the order they were added. Buffers for each file are created by the first model using it, later models
+	// share the geometry through the mesh registry
+	bool success = true;
+	for (unsigned int i = 0; i < m_Requests.size(); ++i)
+	{
+		SModelRequest& request = m_Requests[i];
+		const gen::CCookedMesh* mesh = NULL;
+		if (request.pendingMesh >= 0)
+		{
+			SPendingMesh& pending = m_PendingMeshes[request.pendingMesh];
+			if (pending.result.valid() && !pending.result.get())
+			{
+				pending.mesh.reset(); // Load failed, mark as failed for any other models using this file
+			}
+			if (!pending.mesh)
+			{
+				success = false;
+				continue;
+			}
+			mesh = pending.mesh.get();
+		}
+
+		if (!request.model->Load( request.fileName, request.exampleTechnique, request.tangents, &request.vertexFormat, mesh ))
+		{
+			success = false;
+		}
+	}
+
+	// Loaded meshes are no longer needed once the buffers have been created
+	m_Requests.clear();
+	m_PendingMeshes.clear();
+	return success;
+}
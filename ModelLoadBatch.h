@@ -0,0 +1,81 @@
+//--------------------------------------------------------------------------------------
+//	ModelLoadBatch.h
+//
+//	A model load batch loads the files for a set of models on worker threads, then
+//	creates the vertex/index buffers on the thread that owns the device
+//--------------------------------------------------------------------------------------
+
+#ifndef MODEL_LOAD_BATCH_H_INCLUDED // Header guard - prevents file being included more than once (would cause errors)
+#define MODEL_LOAD_BATCH_H_INCLUDED
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <future>
+using namespace std;
+
+#include <d3d10.h>
+
+#include "CThreadPool.h"  // Worker threads (from the import code)
+#include "VertexFormat.h" // Compact encodings of vertex data (from the import code)
+
+namespace gen { class CCookedMesh; }
+class CModel;
+
+
+class CModelLoadBatch
+{
+/////////////////////////////
+// Public member functions
+public:
+	// Constructor - the batch will run its loads on the given thread pool, which must exist until Finish returns
+	CModelLoadBatch( gen::CThreadPool* threadPool );
+
+	// Destructor - waits for any loads that have not been finished
+	~CModelLoadBatch();
+
+	// Start loading the geometry for a model. The file is loaded (parsed, processed etc.) on a worker thread straight away, but the model
+	// has no geometry until Finish is called. Files used by several models in the batch, or already in use, are only loaded once
+	// Vertices are encoded in the given vertex format, or kept as full floats if none is given (see CModel::Load)
+	void Add( CModel* model, const string& fileName, ID3D10EffectTechnique* exampleTechnique, bool tangents = false,
+	          const gen::SVertexFormat* vertexFormat = NULL );
+
+	// Wait for all loads to complete and create the vertex/index buffers for each model. Must be called on the thread that uses the device.
+	// Returns true if every model was loaded successfully
+	bool Finish();
+
+
+/////////////////////////////
+// Private member functions / variables
+private:
+	// Disallow copying (private and not defined)
+	CModelLoadBatch( const CModelLoadBatch& );
+	CModelLoadBatch& operator=( const CModelLoadBatch& );
+
+	// A file being loaded on a worker thread. The result is true if the load succeeded
+	struct SPendingMesh
+	{
+		string                      fileName;
+		bool                        tangents;
+		shared_ptr<gen::CCookedMesh> mesh;
+		future<bool>                result;
+	};
+
+	// A model waiting for its geometry, refers to an entry in the pending mesh list (or -1 if its geometry was already in use)
+	struct SModelRequest
+	{
+		CModel*                model;
+		string                 fileName;
+		ID3D10EffectTechnique* exampleTechnique;
+		bool                   tangents;
+		gen::SVertexFormat     vertexFormat;
+		int                    pendingMesh;
+	};
+
+	gen::CThreadPool*     m_ThreadPool;
+	vector<SPendingMesh>  m_PendingMeshes;
+	vector<SModelRequest> m_Requests;
+};
+
+
+#endif // End of header guard - see top of file
@@ -0,0 +1,151 @@
+//--------------------------------------------------------------------------------------
+//	ModelPicker.cpp
+//
+//	The model picker finds which model a ray hits (e.g. from the camera through the mouse),
+//	and whether anything blocks the line of sight between two points
+//--------------------------------------------------------------------------------------
+
+#include "Defines.h"      // General definitions shared by all source files
+#include "ModelPicker.h"  // Declaration of this class
+
+
+// Add a model that rays can hit
+void CModelPicker::Add( CModel* model )
+{
+	m_Models.push_back( model );
+}
+
+// Remove all models
+void CModelPicker::Clear()
+{
+	m_Models.clear();
+	m_Nodes.clear();
+	m_LeafModels.clear();
+}
+
+
+// Build the hierarchy over the current world bounds of the models added
+void CModelPicker::Build()
+{
+	vector<gen::CVector3> boundsMin( m_Models.size() );
+	vector<gen::CVector3> boundsMax( m_Models.size() );
+	for (unsigned int model = 0; model < m_Models.size(); ++model)
+	{
+		const D3DXVECTOR3& modelMin = m_Models[model]->GetBoundsMin();
+		const D3DXVECTOR3& modelMax = m_Models[model]->GetBoundsMax();
+		boundsMin[model] = gen::CVector3( modelMin.x, modelMin.y, modelMin.z );
+		boundsMax[model] = gen::CVector3( modelMax.x, modelMax.y, modelMax.z );
+	}
+	gen::BuildBVH( boundsMin.data(), boundsMax.data(), static_cast<gen::TUInt32>(m_Models.size()), &m_Nodes, &m_LeafModels );
+}
+
+
+// Find the closest model hit by a world space ray, no further than the given distance along the ray
+bool CModelPicker::Pick( const D3DXVECTOR3& origin, const D3DXVECTOR3& direction, float maxDistance, SModelPick* pick )
+{
+	if (!Traverse( origin, direction, maxDistance, pick ))
+	{
+		return false;
+	}
+	pick->Position = origin + direction * pick->Hit.Distance;
+	return true;
+}
+
+// Is there a clear line of sight between two points
+bool CModelPicker::IsLineOfSight( const D3DXVECTOR3& from, const D3DXVECTOR3& to, CModel* ignoreFrom /*= NULL*/, CModel* ignoreTo /*= NULL*/ )
+{
+	// The ray direction is the whole line, so the line ends at a distance of 1
+	return !Traverse( from, to - from, 1.0f, NULL, ignoreFrom, ignoreTo );
+}
+
+
+// Traverse the hierarchy for the closest model hit, or for any hit if pick is NULL. Nodes are visited nearest first, and nodes the ray
+// enters beyond the closest hit so far are skipped, so most models behind the hit model are never tested
+bool CModelPicker::Traverse( const D3DXVECTOR3& origin, const D3DXVECTOR3& direction, float maxDistance, SModelPick* pick,
+                             CModel* ignoreA /*= NULL*/, CModel* ignoreB /*= NULL*/ )
+{
+	if (m_Nodes.empty())
+	{
+		return false;
+	}
+	gen::CVector3 rayOrigin( origin.x, origin.y, origin.z );
+	gen::CVector3 invDirection = gen::InverseRayDirection( gen::CVector3( direction.x, direction.y, direction.z ) );
+
+	float entry;
+	if (!gen::IntersectBVHNode( m_Nodes[0], rayOrigin, invDirection, maxDistance, &entry ))
+	{
+		return false;
+	}
+
+	// Nodes still to visit and the distance the ray enters each
+	unsigned int stack[gen::kiBVHMaxDepth];
+	float stackEntry[gen::kiBVHMaxDepth];
+	unsigned int stackSize = 0;
+	unsigned int node = 0;
+	bool found = false;
+	while (true)
+	{
+		const gen::SBVHNode& current = m_Nodes[node];
+		if (current.iCount > 0)
+		{
+			// Test the faces of each model in the leaf
+			for (unsigned int slot = 0; slot < current.iCount; ++slot)
+			{
+				CModel* model = m_Models[m_LeafModels[current.iFirst * gen::kiBVHLeafSize + slot]];
+				if (model == ignoreA || model == ignoreB)
+				{
+					continue;
+				}
+				if (!pick)
+				{
+					if (model->IsRayBlocked( origin, direction, maxDistance ))
+					{
+						return true;
+					}
+				}
+				else if (model->IntersectRay( origin, direction, maxDistance, &pick->Hit ))
+				{
+					maxDistance = pick->Hit.Distance;
+					pick->Model = model;
+					found = true;
+				}
+			}
+		}
+		else
+		{
+			// Visit the nearer child next and keep the further one for later
+			float entry0, entry1;
+			bool hit0 = gen::IntersectBVHNode( m_Nodes[current.iFirst], rayOrigin, invDirection, maxDistance, &entry0 );
+			bool hit1 = gen::IntersectBVHNode( m_Nodes[current.iFirst + 1], rayOrigin, invDirection, maxDistance, &entry1 );
+			if (hit0 && hit1)
+			{
+				unsigned int nearNode = current.iFirst, farNode = current.iFirst + 1;
+				if (entry1 < entry0)
+				{
+					swap( nearNode, farNode );
+					swap( entry0, entry1 );
+				}
+				stack[stackSize] = farNode;
+				stackEntry[stackSize++] = entry1;
+				node = nearNode;
+				continue;
+			}
+			if (hit0 || hit1)
+			{
+				node = hit0 ? current.iFirst : current.iFirst + 1;
+				continue;
+			}
+		}
+
+		// Take the next node from the stack, skipping those entered beyond the closest hit
+		do
+		{
+			if (stackSize == 0)
+			{
+				return found;
+			}
+			--stackSize;
+		} while (stackEntry[stackSize] > maxDistance);
+		node = stack[stackSize];
+	}
+}
@@ -0,0 +1,84 @@
+//--------------------------------------------------------------------------------------
+//	ModelPicker.h
+//
+//	The model picker finds which model a ray hits (e.g. from the camera through the mouse),
+//	and whether anything blocks the line of sight between two points
+//--------------------------------------------------------------------------------------
+
+#ifndef MODEL_PICKER_H_INCLUDED // Header guard - prevents file being included more than once (would cause errors)
+#define MODEL_PICKER_H_INCLUDED
+
+#include <vector>
+using namespace std;
+
+#include <d3d10.h>
+#include <d3dx10.h>
+
+#include "Model.h"
+#include "MeshBVH.h" // Bounding volume hierarchies for ray queries (from the import code)
+
+
+// Closest model hit by a ray, see CModelPicker::Pick
+struct SModelPick
+{
+	CModel*      Model;    // Model hit
+	SModelRayHit Hit;      // Draw range, face and barycentric coordinates of the hit within the model, and the distance along the ray
+	D3DXVECTOR3  Position; // World space point hit
+};
+
+
+// The picker holds a bounding volume hierarchy over the world bounds of a set of models (see CModel::GetBoundsMin), so a ray only tests
+// the faces of models whose bounds it passes through. The faces of each model have a hierarchy of their own, built when its file was
+// cooked (see MeshBVH.h), so the whole query is two levels of hierarchy
+class CModelPicker
+{
+/////////////////////////////
+// Public member functions
+public:
+	// Add a model that rays can hit. The model is not copied, it must remain alive while it is in the picker
+	void Add( CModel* model );
+
+	// Remove all models
+	void Clear();
+
+	// Build the hierarchy over the current world bounds of the models added. Call after adding models, and whenever any of them move (after
+	// their UpdateMatrix). Building is quick enough to do every frame for hundreds of models
+	void Build();
+
+	// Find the closest model hit by a world space ray, no further than the given distance along the ray (in units of the ray direction). Uses
+	// the hierarchy as of the last Build. Returns false if no model is hit, the pick is only written if there is a hit
+	bool Pick( const D3DXVECTOR3& origin, const D3DXVECTOR3& direction, float maxDistance, SModelPick* pick );
+
+	// Is there a clear line of sight between two points - no model's faces cross the line between them. Models at either end (e.g. the
+	// viewer and its target) can be left out of the test
+	bool IsLineOfSight( const D3DXVECTOR3& from, const D3DXVECTOR3& to, CModel* ignoreFrom = NULL, CModel* ignoreTo = NULL );
+
+
+	/////////////////////////////
+	// Data access
+
+	// Number of models added and the number of nodes in the hierarchy over them
+	unsigned int GetNumModels()
+	{
+		return static_cast<unsigned int>(m_Models.size());
+	}
+	unsigned int GetNumNodes()
+	{
+		return static_cast<unsigned int>(m_Nodes.size());
+	}
+
+
+/////////////////////////////
+// Private member functions / variables
+private:
+	// Traverse the hierarchy for the closest model hit, or for any hit if pick is NULL (skipping the ignored models)
+	bool Traverse( const D3DXVECTOR3& origin, const D3DXVECTOR3& direction, float maxDistance, SModelPick* pick,
+	               CModel* ignoreA = NULL, CModel* ignoreB = NULL );
+
+	vector<CModel*>          m_Models;
+	vector<gen::SBVHNode>    m_Nodes;
+	vector<gen::TUInt32>     m_LeafModels; // Index into the model list of each leaf slot, gen::kiBVHLeafSize for each leaf
+};
+
+
+#endif // End of header guard - see top of file
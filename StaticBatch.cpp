@@ -0,0 +1,253 @@
+//--------------------------------------------------------------------------------------
+//	StaticBatch.cpp
+//
+//	A static batch merges models that never move into a few large vertex/index buffers,
+//	so a whole static scene renders with one draw call for each technique and texture set
+//--------------------------------------------------------------------------------------
+
+#include <map>
+#include <memory>
+
+#include "Defines.h"      // General definitions shared by all source files
+#include "StaticBatch.h"  // Declaration of this class
+#include "Model.h"
+
+#include "CCookedMesh.h"  // Cache of pre-processed meshes, avoids re-importing unchanged files
+#include "MeshMerge.h"    // Merging the vertices of several sub-meshes into one list
+
+
+// Constructor - the batch sets the given shader variables for each group of models it renders
+CStaticBatch::CStaticBatch( ID3D10EffectMatrixVariable* worldMatrixVar, ID3D10EffectShaderResourceVariable* diffuseMapVar,
+                            ID3D10EffectShaderResourceVariable* normalMapVar, ID3D10EffectVectorVariable* modelColourVar,
+                            ID3D10EffectVectorVariable* positionScaleVar, ID3D10EffectVectorVariable* positionBiasVar )
+{
+	m_WorldMatrixVar = worldMatrixVar;
+	m_DiffuseMapVar = diffuseMapVar;
+	m_NormalMapVar = normalMapVar;
+	m_ModelColourVar = modelColourVar;
+	m_PositionScaleVar = positionScaleVar;
+	m_PositionBiasVar = positionBiasVar;
+}
+
+// Destructor - releases the merged geometry
+CStaticBatch::~CStaticBatch()
+{
+	ReleaseResources();
+}
+
+
+// Add a static model to the batch, with the technique, textures and colour it is rendered with. Returns false if the model is not static or has no geometry
+bool CStaticBatch::Add( CModel* model, ID3D10EffectTechnique* technique, ID3D10ShaderResourceView* diffuseMap /*= NULL*/,
+                        ID3D10ShaderResourceView* normalMap /*= NULL*/, D3DXVECTOR3 colour /*= D3DXVECTOR3(0, 0, 0)*/ )
+{
+	CMeshGeometry* geometry = model->GetGeometry();
+	if (!model->IsStatic() || !geometry || geometry->FileName.empty())
+	{
+		return false;
+	}
+	m_Models.push_back( model );
+
+	// A model scaled to nothing has no visible geometry (and its normals can't be transformed), it is left out of the groups
+	D3DXMATRIX worldMatrix = model->GetWorldMatrix();
+	if (D3DXMatrixDeterminant( &worldMatrix ) == 0.0f)
+	{
+		return true;
+	}
+
+	// Find a group with the same render state and vertex data, or start a new one
+	const gen::SVertexFormat& format = geometry->VertexFormat;
+	unsigned int group = 0;
+	while (group < m_Groups.size())
+	{
+		const SBatchGroup& existing = m_Groups[group];
+		if (existing.technique == technique && existing.diffuseMap == diffuseMap && existing.normalMap == normalMap &&
+		    existing.colour == colour && existing.tangents == geometry->Tangents && existing.vertexFormat.position == format.position &&
+		    existing.vertexFormat.directions == format.directions && existing.vertexFormat.texCoords == format.texCoords &&
+		    existing.vertexFormat.colours == format.colours)
+		{
+			break;
+		}
+		++group;
+	}
+	if (group == m_Groups.size())
+	{
+		SBatchGroup newGroup;
+		newGroup.technique = technique;
+		newGroup.diffuseMap = diffuseMap;
+		newGroup.normalMap = normalMap;
+		newGroup.colour = colour;
+		newGroup.vertexFormat = format;
+		newGroup.tangents = geometry->Tangents;
+		newGroup.mergedModel = NULL;
+		m_Groups.push_back( newGroup );
+	}
+
+	m_Groups[group].models.push_back( model );
+	return true;
+}
+
+
+// Merge the models added into a vertex and index buffer for each group, with the vertices transformed into world space
+bool CStaticBatch::Build()
+{
+	ReleaseResources();
+
+	// Each file used is loaded once, the registry only keeps the buffers on the GPU. The cooked cache makes this much quicker than the first load
+	typedef map<string, shared_ptr<gen::CCookedMesh> > TMeshMap;
+	TMeshMap meshes;
+
+	for (unsigned int group = 0; group < m_Groups.size(); ++group)
+	{
+		SBatchGroup& batchGroup = m_Groups[group];
+
+		// Find a vertex layout for every sub-mesh of every model in the group, and the total number of vertices
+		vector<const gen::CCookedMesh*> groupMeshes( batchGroup.models.size() );
+		gen::SSubMesh merged;
+		gen::ClearMergedLayout( &merged );
+		for (unsigned int model = 0; model < batchGroup.models.size(); ++model)
+		{
+			CMeshGeometry* geometry = batchGroup.models[model]->GetGeometry();
+			string key = geometry->FileName + (geometry->Tangents ? "|tangents" : "|");
+			TMeshMap::iterator found = meshes.find( key );
+			if (found == meshes.end())
+			{
+				shared_ptr<gen::CCookedMesh> mesh( new gen::CCookedMesh );
+				if (!CMeshRegistry::LoadMesh( geometry->FileName, geometry->Tangents, mesh.get() ))
+				{
+					ReleaseResources();
+					return false;
+				}
+				found = meshes.insert( make_pair( key, mesh ) ).first;
+			}
+			groupMeshes[model] = found->second.get();
+
+			for (unsigned int sub = 0; sub < groupMeshes[model]->GetNumSubMeshes(); ++sub)
+			{
+				const gen::SSubMesh& subMesh = groupMeshes[model]->GetSubMesh( sub );
+				if (subMesh.hasSkinningData)
+				{
+					ReleaseResources();
+					return false;
+				}
+				gen::AddToMergedLayout( subMesh, &merged );
+			}
+		}
+
+		// The group is drawn as a single range, so indices refer to the whole vertex list. Use 32-bit indices if 16 bits can't reach every vertex
+		merged.indexSize = (merged.numVertices > 0xffff) ? sizeof(gen::TUInt32) : sizeof(gen::TUInt16);
+
+		// Copy the vertices of each sub-mesh into the world, through the root of its file's hierarchy then the model's world matrix (both
+		// transform row vectors, so the node to root matrix comes first). Copy the full detail faces, offset to the sub-mesh's vertices
+		vector<gen::TUInt8> vertices( merged.numVertices * merged.vertexSize );
+		vector<gen::TUInt8> indices( merged.numFaces * 3 * merged.indexSize );
+		unsigned int baseVertex = 0;
+		unsigned int firstIndex = 0;
+		for (unsigned int model = 0; model < batchGroup.models.size(); ++model)
+		{
+			const gen::CCookedMesh& mesh = *groupMeshes[model];
+			D3DXMATRIX worldMatrix = batchGroup.models[model]->GetWorldMatrix();
+			gen::CMatrix4x4 modelMatrix( &worldMatrix._11 );
+			for (unsigned int sub = 0; sub < mesh.GetNumSubMeshes(); ++sub)
+			{
+				const gen::SSubMesh& subMesh = mesh.GetSubMesh( sub );
+				gen::CMatrix4x4 subMeshMatrix = gen::GetNodeRootMatrix( &mesh.GetNode( 0 ), subMesh.node ) * modelMatrix;
+				gen::CopyMergedVertices( subMesh, merged, &subMeshMatrix, &vertices[baseVertex * merged.vertexSize] );
+
+				unsigned int numIndices = subMesh.numFaces * 3;
+				for (unsigned int index = 0; index < numIndices; ++index)
+				{
+					unsigned int vertex = baseVertex + ((subMesh.indexSize == sizeof(gen::TUInt32)) ?
+					                                    reinterpret_cast<const gen::TUInt32*>(subMesh.faces)[index] :
+					                                    reinterpret_cast<const gen::TUInt16*>(subMesh.faces)[index]);
+					if (merged.indexSize == sizeof(gen::TUInt32))
+					{
+						reinterpret_cast<gen::TUInt32*>(indices.data())[firstIndex + index] = vertex;
+					}
+					else
+					{
+						reinterpret_cast<gen::TUInt16*>(indices.data())[firstIndex + index] = static_cast<gen::TUInt16>(vertex);
+					}
+				}
+				baseVertex += subMesh.numVertices;
+				firstIndex += numIndices;
+			}
+		}
+		merged.vertices = vertices.data();
+
+		// One draw range for the whole group, with a single level of detail and no clusters
+		vector<SMeshDrawRange> ranges( 1 );
+		ranges[0].FirstIndex = 0;
+		ranges[0].NumIndices = firstIndex;
+		ranges[0].BaseVertex = 0;
+		ranges[0].Material = 0;
+		ranges[0].MaterialId = 0;
+		ranges[0].LODs[0].iFirstFace = 0;
+		ranges[0].LODs[0].iNumFaces = merged.numFaces;
+		ranges[0].LODs[0].fError = 0.0f;
+		ranges[0].NumLODs = 1;
+		ranges[0].FirstCluster = 0;
+		ranges[0].NumClusters = 0;
+
+		// Create the buffers and hold them in a model at the origin, which renders them like any other model
+		ID3D10InputLayout* vertexLayout;
+		CMeshGeometry* geometry = CMeshRegistry::CreateUnshared( merged, indices, ranges, batchGroup.technique, &batchGroup.vertexFormat,
+		                                                         &vertexLayout );
+		if (!geometry)
+		{
+			ReleaseResources();
+			return false;
+		}
+		batchGroup.mergedModel = new CModel;
+		batchGroup.mergedModel->SetStatic( true );
+		batchGroup.mergedModel->SetGeometry( geometry, vertexLayout );
+	}
+
+	return true;
+}
+
+
+// Render every group, setting the shader variables for each
+void CStaticBatch::Render()
+{
+	for (unsigned int group = 0; group < m_Groups.size(); ++group)
+	{
+		SBatchGroup& batchGroup = m_Groups[group];
+		CModel* model = batchGroup.mergedModel;
+		if (!model)
+		{
+			continue;
+		}
+
+		// The vertices are already in world space, the merged model's world matrix is the identity
+		if (m_WorldMatrixVar)   m_WorldMatrixVar->SetMatrix( (float*)model->GetWorldMatrix() );
+		if (m_DiffuseMapVar)    m_DiffuseMapVar->SetResource( batchGroup.diffuseMap );
+		if (m_NormalMapVar)     m_NormalMapVar->SetResource( batchGroup.normalMap );
+		if (m_ModelColourVar)   m_ModelColourVar->SetRawValue( batchGroup.colour, 0, 12 );
+		if (m_PositionScaleVar) m_PositionScaleVar->SetRawValue( model->GetPositionScale(), 0, 12 );
+		if (m_PositionBiasVar)  m_PositionBiasVar->SetRawValue( model->GetPositionBias(), 0, 12 );
+		model->Render( batchGroup.technique );
+	}
+}
+
+
+// Release the merged geometry, the models added remain in the batch
+void CStaticBatch::ReleaseResources()
+{
+	for (unsigned int group = 0; group < m_Groups.size(); ++group)
+	{
+		delete m_Groups[group].mergedModel;
+		m_Groups[group].mergedModel = NULL;
+	}
+}
+
+
+// Draw calls that rendering each model added would make - one for each draw range of its geometry
+unsigned int CStaticBatch::GetNumDrawsUnbatched()
+{
+	unsigned int draws = 0;
+	for (unsigned int model = 0; model < m_Models.size(); ++model)
+	{
+		draws += static_cast<unsigned int>(m_Models[model]->GetGeometry()->Ranges.size());
+	}
+	return draws;
+}
@@ -0,0 +1,111 @@
+//--------------------------------------------------------------------------------------
+//	StaticBatch.h
+//
+//	A static batch merges models that never move into a few large vertex/index buffers,
+//	so a whole static scene renders with one draw call for each technique and texture set
+//--------------------------------------------------------------------------------------
+
+#ifndef STATIC_BATCH_H_INCLUDED // Header guard - prevents file being included more than once (would cause errors)
+#define STATIC_BATCH_H_INCLUDED
+
+#include <vector>
+using namespace std;
+
+#include <d3d10.h>
+#include <d3dx10.h>
+
+#include "VertexFormat.h" // Compact encodings of vertex data (from the import code)
+
+class CModel;
+
+
+class CStaticBatch
+{
+/////////////////////////////
+// Public member functions
+public:
+	// Constructor - the batch sets the given shader variables for each group of models it renders (any may be NULL if the effect doesn't
+	// use them): the world matrix, the diffuse and normal maps, the plain model colour and the decoding of compact vertex positions
+	CStaticBatch( ID3D10EffectMatrixVariable* worldMatrixVar, ID3D10EffectShaderResourceVariable* diffuseMapVar,
+	              ID3D10EffectShaderResourceVariable* normalMapVar, ID3D10EffectVectorVariable* modelColourVar,
+	              ID3D10EffectVectorVariable* positionScaleVar, ID3D10EffectVectorVariable* positionBiasVar );
+
+	// Destructor - releases the merged geometry, the models added are not affected
+	~CStaticBatch();
+
+	// Add a static model to the batch (see CModel::SetStatic), with the technique, textures and colour it is rendered with. Models with the
+	// same technique, textures, colour and vertex format are merged into one group. The model must have its geometry and be in place,
+	// changes to the model after Build are not seen. Models scaled to nothing are accepted but not drawn. Returns false if the model is
+	// not static or has no geometry
+	bool Add( CModel* model, ID3D10EffectTechnique* technique, ID3D10ShaderResourceView* diffuseMap = NULL,
+	          ID3D10ShaderResourceView* normalMap = NULL, D3DXVECTOR3 colour = D3DXVECTOR3(0, 0, 0) );
+
+	// Merge the models added into a vertex and index buffer for each group. The vertices of each model are transformed into world space
+	// with its world matrix (normals and tangents too), so the groups are rendered with an identity world matrix. The model files are
+	// loaded again for their vertices (from the cooked cache, see CCookedMesh.h). Only the full detail faces are used. Can be called
+	// again after adding more models. Returns false on failure, or if a model is skinned (its vertices are placed by its bones)
+	bool Build();
+
+	// Render every group, setting the shader variables for each. Other shader variables (e.g. camera and lights) must already be set
+	void Render();
+
+	// Release the merged geometry, the models added remain in the batch and it can be built again
+	void ReleaseResources();
+
+
+	/////////////////////////////
+	// Data access
+
+	// Number of models added to the batch and number of groups they are merged into
+	unsigned int GetNumModels()
+	{
+		return static_cast<unsigned int>(m_Models.size());
+	}
+	unsigned int GetNumGroups()
+	{
+		return static_cast<unsigned int>(m_Groups.size());
+	}
+
+	// Draw calls made rendering the batch (in a single pass technique), and the draw calls that rendering each model added would make
+	unsigned int GetNumDraws()
+	{
+		return static_cast<unsigned int>(m_Groups.size());
+	}
+	unsigned int GetNumDrawsUnbatched();
+
+
+/////////////////////////////
+// Private member functions / variables
+private:
+	// Disallow copying (private and not defined)
+	CStaticBatch( const CStaticBatch& );
+	CStaticBatch& operator=( const CStaticBatch& );
+
+	// Models rendered with the same render state, which can be merged into a single draw call. After Build the merged geometry is held in a
+	// model of its own at the origin
+	struct SBatchGroup
+	{
+		ID3D10EffectTechnique*    technique;
+		ID3D10ShaderResourceView* diffuseMap;
+		ID3D10ShaderResourceView* normalMap;
+		D3DXVECTOR3               colour;
+		gen::SVertexFormat        vertexFormat;
+		bool                      tangents;
+		vector<CModel*>           models;
+		CModel*                   mergedModel;
+	};
+
+	// Shader variables set for each group
+	ID3D10EffectMatrixVariable*         m_WorldMatrixVar;
+	ID3D10EffectShaderResourceVariable* m_DiffuseMapVar;
+	ID3D10EffectShaderResourceVariable* m_NormalMapVar;
+	ID3D10EffectVectorVariable*         m_ModelColourVar;
+	ID3D10EffectVectorVariable*         m_PositionScaleVar;
+	ID3D10EffectVectorVariable*         m_PositionBiasVar;
+
+	vector<CModel*>      m_Models;
+	vector<SBatchGroup>  m_Groups;
+};
+
+
+#endif // End of header guard - see top of file